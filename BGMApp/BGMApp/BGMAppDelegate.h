@@ -24,6 +24,7 @@
 
 // Local Includes
 #import "BGMAudioDeviceManager.h"
+#import "BGMUserDefaults.h"
 
 // System Includes
 #import <Cocoa/Cocoa.h>
@@ -54,5 +55,8 @@ static NSInteger const kSeparatorBelowVolumesMenuItemTag = 4;
 
 @property (readonly) BGMAudioDeviceManager* audioDevices;
 
+// Persistently stores user settings and data.
+@property (readonly) BGMUserDefaults* userDefaults;
+
 @end
 
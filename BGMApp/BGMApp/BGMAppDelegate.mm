@@ -43,6 +43,8 @@
 
 // System Includes
 #import <AVFoundation/AVCaptureDevice.h>
+#import <mach/mach.h>
+#import <mach/mach_time.h>
 
 
 #pragma clang assume_nonnull begin
@@ -57,8 +59,8 @@ static NSString* const kOptShowDockIcon      = @"--show-dock-icon";
     // Only show the 'BGMXPCHelper is missing' error dialog once.
     BOOL haveShownXPCHelperErrorMessage;
 
-    // Persistently stores user settings and data.
-    BGMUserDefaults* userDefaults;
+    // When BGMApp started launching, in absolute time. See logLaunchStep.
+    UInt64 launchStartTime;
 
     BGMAutoPauseMusic* autoPauseMusic;
     BGMAutoPauseMenuItem* autoPauseMenuItem;
@@ -73,9 +75,12 @@ static NSString* const kOptShowDockIcon      = @"--show-dock-icon";
 }
 
 @synthesize audioDevices = audioDevices;
+@synthesize userDefaults = userDefaults;
 
 - (void) awakeFromNib {
     [super awakeFromNib];
+
+    launchStartTime = mach_absolute_time();
     
     // Show BGMApp in the dock, if the command-line option for that was passed. This is used by the
     // UI tests.
@@ -91,6 +96,8 @@ static NSString* const kOptShowDockIcon      = @"--show-dock-icon";
         return;
     }
 
+    [self logLaunchStep:"Created BGMAudioDeviceManager"];
+
     // Stored user settings
     userDefaults = [self createUserDefaults];
 
@@ -98,6 +105,8 @@ static NSString* const kOptShowDockIcon      = @"--show-dock-icon";
     statusBarItem = [[BGMStatusBarItem alloc] initWithMenu:self.bgmMenu
                                               audioDevices:audioDevices
                                               userDefaults:userDefaults];
+
+    [self logLaunchStep:"Created the status bar item"];
 }
 
 - (void) applicationDidFinishLaunching:(NSNotification*)aNotification {
@@ -117,11 +126,16 @@ static NSString* const kOptShowDockIcon      = @"--show-dock-icon";
     preferredOutputDevices =
         [[BGMPreferredOutputDevices alloc] initWithDevices:audioDevices userDefaults:userDefaults];
 
+    // Set this before choosing the output device so BGMDevice's sample rate only has to be set once.
+    [audioDevices setFixedSampleRate:userDefaults.fixedSampleRate];
+
     // Choose an output device for BGMApp to use to play audio.
     if (![self setInitialOutputDevice]) {
         return;
     }
 
+    [self logLaunchStep:"Set the output device"];
+
     // Make BGMDevice the default device.
     [self setBGMDeviceAsDefault];
 
@@ -134,8 +148,12 @@ static NSString* const kOptShowDockIcon      = @"--show-dock-icon";
 
     autoPauseMusic = [[BGMAutoPauseMusic alloc] initWithAudioDevices:audioDevices
                                                         musicPlayers:musicPlayers];
+
+    [self logLaunchStep:"Created the music players"];
     
     [self setUpMainMenu];
+
+    [self logLaunchStep:"Set up the main menu"];
     
     xpcListener = [[BGMXPCListener alloc] initWithAudioDevices:audioDevices
                                   helperConnectionErrorHandler:^(NSError* error) {
@@ -144,6 +162,31 @@ static NSString* const kOptShowDockIcon      = @"--show-dock-icon";
                                             error);
                                       [self showXPCHelperErrorMessage:error];
                                   }];
+
+    [self logLaunchStep:"Finished launching"];
+}
+
+// Logs how long BGMApp has been launching for and how much memory it's using, so changes that
+// affect its start-up time can be measured. Only logs if debug logging is enabled.
+- (void) logLaunchStep:(const char*)step {
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    UInt64 elapsedNsec =
+        (mach_absolute_time() - launchStartTime) * timebase.numer / timebase.denom;
+
+    // Get the resident memory size.
+    mach_task_basic_info_data_t taskInfo;
+    mach_msg_type_number_t taskInfoCount = MACH_TASK_BASIC_INFO_COUNT;
+    kern_return_t result = task_info(mach_task_self(),
+                                     MACH_TASK_BASIC_INFO,
+                                     reinterpret_cast<task_info_t>(&taskInfo),
+                                     &taskInfoCount);
+    UInt64 residentKB = (result == KERN_SUCCESS) ? (taskInfo.resident_size / 1024) : 0;
+
+    DebugMsg("BGMAppDelegate::logLaunchStep: %s. elapsed=%.2f ms resident=%llu KB",
+             step,
+             elapsedNsec / static_cast<double>(NSEC_PER_MSEC),
+             residentKB);
 }
 
 // Returns NO if (and only if) BGMApp is about to terminate because of a fatal error.
@@ -304,6 +347,9 @@ static NSString* const kOptShowDockIcon      = @"--show-dock-icon";
     
     DebugMsg("BGMAppDelegate::applicationWillTerminate");
 
+    // Finish the recording, if there is one, so its file headers are complete.
+    [audioDevices stopRecording];
+
     // Change the user's default output device back.
     NSError* error = [audioDevices unsetBGMDeviceAsOSDefault];
     
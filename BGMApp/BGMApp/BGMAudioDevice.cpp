@@ -25,6 +25,14 @@
 
 // Local Includes
 #include "BGM_Types.h"
+#include "BGMAudioPropertyCache.h"
+
+// PublicUtility Includes
+#include "CAPropertyAddress.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstddef>
 
 // System Includes
 #include <AudioToolbox/AudioServices.h>
@@ -56,20 +64,88 @@ BGMAudioDevice::~BGMAudioDevice()
 
 bool    BGMAudioDevice::CanBeOutputDeviceInBGMApp() const
 {
-    CFStringRef uid = CopyDeviceUID();
-    bool isNullDevice = CFEqual(uid, CFSTR(kBGMNullDeviceUID));
-    CFRelease(uid);
+    // The output device menu calls this for every device each time it's shown, so all of these are
+    // read through the cache.
+    BGMAudioPropertyCache& cache = BGMAudioPropertyCache::GetInstance();
+
+    CFStringRef uid = CopyCachedDeviceUID();
+    bool isNullDevice = uid && CFEqual(uid, CFSTR(kBGMNullDeviceUID));
+    if(uid)
+    {
+        CFRelease(uid);
+    }
+
+    bool isHidden =
+        cache.GetValue<UInt32>(GetObjectID(), CAPropertyAddress(kAudioDevicePropertyIsHidden)) != 0;
+
+    // Count the output channels. See CAHALAudioDevice::GetTotalNumberChannels.
+    std::vector<UInt8> streamConfig =
+        cache.GetData(GetObjectID(),
+                      CAPropertyAddress(kAudioDevicePropertyStreamConfiguration,
+                                        kAudioObjectPropertyScopeOutput));
+    UInt32 numOutputChannels = 0;
 
-    bool hasOutputChannels = GetTotalNumberChannels(/* inIsInput = */ false) > 0;
-    bool canBeDefault = CanBeDefaultDevice(/* inIsInput = */ false, /* inIsSystem = */ false);
+    if(streamConfig.size() >= offsetof(AudioBufferList, mBuffers))
+    {
+        const AudioBufferList* bufferList =
+            reinterpret_cast<const AudioBufferList*>(streamConfig.data());
+        const size_t maxBuffers =
+            (streamConfig.size() - offsetof(AudioBufferList, mBuffers)) / sizeof(AudioBuffer);
+
+        for(UInt32 i = 0; i < std::min<size_t>(bufferList->mNumberBuffers, maxBuffers); i++)
+        {
+            numOutputChannels += bufferList->mBuffers[i].mNumberChannels;
+        }
+    }
+
+    bool canBeDefault =
+        cache.GetValue<UInt32>(GetObjectID(),
+                               CAPropertyAddress(kAudioDevicePropertyDeviceCanBeDefaultDevice,
+                                                 kAudioObjectPropertyScopeOutput)) != 0;
 
     return !IsBGMDeviceInstance() &&
             !isNullDevice &&
-            !IsHidden() &&
-            hasOutputChannels &&
+            !isHidden &&
+            numOutputChannels > 0 &&
             canBeDefault;
 }
 
+#pragma mark Cached Properties
+
+CFStringRef    BGMAudioDevice::CopyCachedName() const
+{
+    return static_cast<CFStringRef>(
+        BGMAudioPropertyCache::GetInstance().CopyCFValue(GetObjectID(),
+                                                         CAPropertyAddress(kAudioObjectPropertyName)));
+}
+
+CFStringRef    BGMAudioDevice::CopyCachedDeviceUID() const
+{
+    return static_cast<CFStringRef>(
+        BGMAudioPropertyCache::GetInstance().CopyCFValue(GetObjectID(),
+                                                         CAPropertyAddress(kAudioDevicePropertyDeviceUID)));
+}
+
+UInt32    BGMAudioDevice::GetCachedTransportType() const
+{
+    return BGMAudioPropertyCache::GetInstance().GetValue<UInt32>(
+        GetObjectID(),
+        CAPropertyAddress(kAudioDevicePropertyTransportType));
+}
+
+std::vector<UInt32>    BGMAudioDevice::GetCachedAvailableDataSources(AudioObjectPropertyScope inScope,
+                                                                     UInt32 inChannel) const
+{
+    std::vector<UInt8> data =
+        BGMAudioPropertyCache::GetInstance().GetData(GetObjectID(),
+                                                     CAPropertyAddress(kAudioDevicePropertyDataSources,
+                                                                       inScope,
+                                                                       inChannel));
+    std::vector<UInt32> dataSources(data.size() / sizeof(UInt32));
+    memcpy(dataSources.data(), data.data(), dataSources.size() * sizeof(UInt32));
+    return dataSources;
+}
+
 #pragma mark Available Controls
 
 bool    BGMAudioDevice::HasSettableMasterVolume(AudioObjectPropertyScope inScope) const
@@ -338,14 +414,18 @@ bool    BGMAudioDevice::IsBGMDevice(bool inIncludeUISoundsInstance) const
 
     if(GetObjectID() != kAudioObjectUnknown)
     {
-        // Check the device's UID to see whether it's BGMDevice.
-        CFStringRef uid = CopyDeviceUID();
+        // Check the device's UID to see whether it's BGMDevice. UIDs never change, so this only
+        // queries the HAL the first time it's called for each device.
+        CFStringRef uid = CopyCachedDeviceUID();
 
-        isBGMDevice =
-            CFEqual(uid, CFSTR(kBGMDeviceUID)) ||
-                    (inIncludeUISoundsInstance && CFEqual(uid, CFSTR(kBGMDeviceUID_UISounds)));
+        if(uid)
+        {
+            isBGMDevice =
+                CFEqual(uid, CFSTR(kBGMDeviceUID)) ||
+                        (inIncludeUISoundsInstance && CFEqual(uid, CFSTR(kBGMDeviceUID_UISounds)));
 
-        CFRelease(uid);
+            CFRelease(uid);
+        }
     }
 
     return isBGMDevice;
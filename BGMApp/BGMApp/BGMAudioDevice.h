@@ -27,6 +27,9 @@
 // PublicUtility Includes
 #include "CAHALAudioDevice.h"
 
+// STL Includes
+#include <vector>
+
 
 class BGMAudioDevice
 :
@@ -78,6 +81,28 @@ public:
      */
     bool               CanBeOutputDeviceInBGMApp() const;
 
+#pragma mark Cached Properties
+
+    // These read the properties through BGMAudioPropertyCache, so they only make calls to the HAL
+    // the first time they're called for a device and after the properties change. The values can
+    // be briefly out of date, so don't use them just after changing the property.
+
+    /*!
+     @return The device's name. The caller is responsible for releasing it.
+     @throws CAException If the HAL returns an error when queried.
+     */
+    CFStringRef        CopyCachedName() const;
+    /*!
+     @return The device's UID. The caller is responsible for releasing it.
+     @throws CAException If the HAL returns an error when queried.
+     */
+    CFStringRef        CopyCachedDeviceUID() const;
+    /*! @throws CAException If the HAL returns an error when queried. */
+    UInt32             GetCachedTransportType() const;
+    /*! @throws CAException If the HAL returns an error when queried. */
+    std::vector<UInt32> GetCachedAvailableDataSources(AudioObjectPropertyScope inScope,
+                                                      UInt32 inChannel) const;
+
 #pragma mark Available Controls
 
     bool               HasSettableMasterVolume(AudioObjectPropertyScope inScope) const;
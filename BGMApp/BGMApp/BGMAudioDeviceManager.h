@@ -46,6 +46,20 @@
 
 static const int kBGMErrorCode_OutputDeviceNotFound = 1;
 static const int kBGMErrorCode_ReturningEarly       = 2;
+static const int kBGMErrorCode_AlreadyRecording     = 3;
+
+// The file formats for recordings. See BGMRecordingFormat.
+typedef NS_ENUM(NSInteger, BGMRecordingFileType) {
+    BGMRecordingFileTypeWAV = 0,
+    BGMRecordingFileTypeCAF  = 1,
+    BGMRecordingFileTypeFLAC = 2
+};
+
+typedef NS_ENUM(NSInteger, BGMRecordingSampleFormat) {
+    BGMRecordingSampleFormatInt16   = 0,
+    BGMRecordingSampleFormatInt24   = 1,
+    BGMRecordingSampleFormatFloat32 = 2
+};
 
 @interface BGMAudioDeviceManager : NSObject
 
@@ -94,6 +108,12 @@ static const int kBGMErrorCode_ReturningEarly       = 2;
                                  dataSourceID:(UInt32)dataSourceID
                               revertOnFailure:(BOOL)revertOnFailure;
 
+// Keep BGMDevice at the given sample rate, converting its audio to the output device's sample
+// rate if they're different, so changing the output device doesn't make BGMDevice change its rate
+// and restart other apps' IO. Pass 0 to make BGMDevice follow the output device's sample rate,
+// which is the default. See BGMPlayThrough::SetFixedInputSampleRate.
+- (void) setFixedSampleRate:(Float64)sampleRate;
+
 // Start playthrough synchronously. Blocks until IO has started on the output device and playthrough
 // is running. See BGMPlayThrough.
 //
@@ -101,6 +121,27 @@ static const int kBGMErrorCode_ReturningEarly       = 2;
 // code received from the HAL.
 - (OSStatus) startPlayThroughSync:(BOOL)forUISoundsDevice;
 
+// Start recording the audio BGMApp plays through to the output device, i.e. the system mix, to
+// files in the given directory. A new file is started whenever the current one would exceed
+// maxFileBytes or maxFileSeconds. Pass 0 for either to disable that limit. See BGMRecorder.
+//
+// Playthrough keeps running while recording, even if no audio is playing, so the recording doesn't
+// skip the silent parts. If the output device changes to one with a different sample rate, the
+// recording continues in a new file.
+//
+// Returns an error if recording is already running or the first file couldn't be created.
+- (NSError* __nullable) startRecordingToDirectory:(NSURL*)directory
+                                         fileType:(BGMRecordingFileType)fileType
+                                     sampleFormat:(BGMRecordingSampleFormat)sampleFormat
+                                     maxFileBytes:(UInt64)maxFileBytes
+                                   maxFileSeconds:(UInt32)maxFileSeconds;
+
+// Finish the current file and stop recording. Blocks while the last of the audio is written. Does
+// nothing if recording isn't running.
+- (void) stopRecording;
+
+- (BOOL) isRecording;
+
 // When the output device is changed, BGMAudioDeviceManager will send the ID of the new output
 // device to BGMXPCHelper through this connection.
 - (void) setBGMXPCHelperConnection:(NSXPCConnection* __nullable)connection;
@@ -31,6 +31,7 @@
 #import "BGMOutputDeviceMenuSection.h"
 #import "BGMOutputVolumeMenuItem.h"
 #import "BGMPlayThrough.h"
+#import "BGMRecorder.h"
 #import "BGMXPCProtocols.h"
 
 // PublicUtility Includes
@@ -38,6 +39,9 @@
 #import "CAAutoDisposer.h"
 #import "CAHALAudioSystemObject.h"
 
+// STL Includes
+#import <memory>
+
 
 #pragma clang assume_nonnull begin
 
@@ -57,6 +61,10 @@
     BGMPlayThrough playThrough;
     BGMPlayThrough playThrough_UISounds;
 
+    // Null when we aren't recording. The recorder's tap is set on playThrough.
+    std::unique_ptr<BGMRecorder> recorder;
+    BGMRecorder::Settings recorderSettings;
+
     // A connection to BGMXPCHelper so we can send it the ID of the output device.
     NSXPCConnection* __nullable bgmXPCHelperConnection;
 
@@ -92,6 +100,8 @@
     @try {
         [stateLock lock];
 
+        [self stopRecording];
+
         if (bgmDevice) {
             delete bgmDevice;
             bgmDevice = nullptr;
@@ -279,6 +289,9 @@
         // But stop playthrough if audio isn't playing, since it uses CPU.
         playThrough.StopIfIdle();
         playThrough_UISounds.StopIfIdle();
+
+        // Changing the output device can change BGMDevice's sample rate.
+        [self restartRecordingIfSampleRateChanged];
     }
 
     CFStringRef outputDeviceUID = outputDevice.CopyDeviceUID();
@@ -364,6 +377,24 @@
     return [NSError errorWithDomain:@kBGMAppBundleID code:errorCode userInfo:info];
 }
 
+- (void) setFixedSampleRate:(Float64)sampleRate {
+    @try {
+        [stateLock lock];
+
+        BGMLogAndSwallowExceptions("BGMAudioDeviceManager::setFixedSampleRate", [&] {
+            playThrough.SetFixedInputSampleRate(sampleRate);
+        });
+        BGMLogAndSwallowExceptions("BGMAudioDeviceManager::setFixedSampleRate", [&] {
+            playThrough_UISounds.SetFixedInputSampleRate(sampleRate);
+        });
+
+        // BGMDevice's sample rate might have changed.
+        [self restartRecordingIfSampleRateChanged];
+    } @finally {
+        [stateLock unlock];
+    }
+}
+
 - (OSStatus) startPlayThroughSync:(BOOL)forUISoundsDevice {
     // We can only try for stateLock because setOutputDeviceWithID might have already taken it, then made a
     // HAL request to BGMDevice and be waiting for the response. Some of the requests setOutputDeviceWithID
@@ -429,6 +460,135 @@
     return err;
 }
 
+#pragma mark Recording
+
+- (NSError* __nullable) startRecordingToDirectory:(NSURL*)directory
+                                         fileType:(BGMRecordingFileType)fileType
+                                     sampleFormat:(BGMRecordingSampleFormat)sampleFormat
+                                     maxFileBytes:(UInt64)maxFileBytes
+                                   maxFileSeconds:(UInt32)maxFileSeconds {
+    BGMRecorder::Settings settings;
+    settings.mDirectory = directory.fileSystemRepresentation;
+    settings.mContainer = (fileType == BGMRecordingFileTypeCAF) ?
+                          BGMRecordingFormat::Container::CAF :
+                          (fileType == BGMRecordingFileTypeFLAC) ?
+                                  BGMRecordingFormat::Container::FLAC :
+                                  BGMRecordingFormat::Container::WAV;
+    settings.mSampleFormat = (sampleFormat == BGMRecordingSampleFormatInt16) ?
+                             BGMRecordingFormat::SampleFormat::Int16 :
+                             (sampleFormat == BGMRecordingSampleFormatFloat32) ?
+                                     BGMRecordingFormat::SampleFormat::Float32 :
+                                     BGMRecordingFormat::SampleFormat::Int24;
+
+    // FLAC can't store floating point samples, so use the closest format it can store rather than
+    // failing. The two settings are chosen separately, so this combination isn't a mistake.
+    if (settings.mContainer == BGMRecordingFormat::Container::FLAC &&
+            settings.mSampleFormat == BGMRecordingFormat::SampleFormat::Float32) {
+        settings.mSampleFormat = BGMRecordingFormat::SampleFormat::Int24;
+    }
+    settings.mMaxFileBytes = maxFileBytes;
+    settings.mMaxFileSeconds = maxFileSeconds;
+
+    @try {
+        [stateLock lock];
+
+        if (recorder) {
+            return [NSError errorWithDomain:@kBGMAppBundleID
+                                       code:kBGMErrorCode_AlreadyRecording
+                                   userInfo:nil];
+        }
+
+        recorderSettings = settings;
+
+        try {
+            [self startRecorder];
+        } catch (const CAException& e) {
+            BGMLogExceptionIn("BGMAudioDeviceManager::startRecordingToDirectory", e);
+            return [NSError errorWithDomain:@kBGMAppBundleID code:e.GetError() userInfo:nil];
+        }
+
+        // Make sure playthrough is running, so we record from now on even if nothing is playing
+        // yet. It won't stop while we're recording.
+        BGMLogAndSwallowExceptionsMsg("BGMAudioDeviceManager::startRecordingToDirectory",
+                                      "Starting playthrough", [&] {
+            playThrough.Start();
+        });
+    } @finally {
+        [stateLock unlock];
+    }
+
+    return nil;
+}
+
+// Creates and starts the recorder with the current recorderSettings and the sample rate BGMDevice
+// is using now. Throws CAException.
+- (void) startRecorder {
+    BGMAssert(!recorder, "BGMAudioDeviceManager::startRecorder: Already recording");
+
+    // BGMDevice's streams are always interleaved stereo.
+    std::unique_ptr<BGMRecorder> newRecorder(
+            new BGMRecorder(recorderSettings, bgmDevice->GetNominalSampleRate(), 2));
+    newRecorder->Start();
+
+    playThrough.SetRecorderTap(&newRecorder->GetTap());
+    recorder = std::move(newRecorder);
+}
+
+- (void) stopRecording {
+    @try {
+        [stateLock lock];
+
+        if (recorder) {
+            // Remove the tap first so the IOProc stops using it before we destroy it.
+            playThrough.SetRecorderTap(nullptr);
+            recorder->Stop();
+
+            if (recorder->HasFailed()) {
+                NSLog(@"BGMAudioDeviceManager::stopRecording: Recording failed. See the log for "
+                       "details.");
+            }
+
+            recorder.reset();
+
+            // Playthrough was kept running for the recorder.
+            BGMLogAndSwallowExceptions("BGMAudioDeviceManager::stopRecording", [&] {
+                playThrough.StopIfIdle();
+            });
+        }
+    } @finally {
+        [stateLock unlock];
+    }
+}
+
+- (BOOL) isRecording {
+    @try {
+        [stateLock lock];
+        return recorder != nullptr;
+    } @finally {
+        [stateLock unlock];
+    }
+}
+
+// Called with stateLock held after the output device changes.
+- (void) restartRecordingIfSampleRateChanged {
+    if (!recorder) {
+        return;
+    }
+
+    BGMLogAndSwallowExceptions("BGMAudioDeviceManager::restartRecordingIfSampleRateChanged", [&] {
+        if (bgmDevice->GetNominalSampleRate() != recorder->GetSampleRate()) {
+            DebugMsg("BGMAudioDeviceManager::restartRecordingIfSampleRateChanged: Sample rate "
+                     "changed. Starting a new recording.");
+
+            playThrough.SetRecorderTap(nullptr);
+            recorder->Stop();
+            recorder.reset();
+
+            [self startRecorder];
+        }
+    });
+}
+
 #pragma mark BGMXPCHelper Communication
 
 - (void) setBGMXPCHelperConnection:(NSXPCConnection* __nullable)connection {
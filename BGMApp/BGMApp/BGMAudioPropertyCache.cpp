@@ -0,0 +1,444 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMAudioPropertyCache.cpp
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMAudioPropertyCache.h"
+
+// Local Includes
+#include "BGM_Utils.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+#include "CAHALAudioObject.h"
+#include "CAHALAudioSystemObject.h"
+#include "CAPropertyAddress.h"
+
+// STL Includes
+#include <tuple>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Construction/Destruction
+
+// static
+BGMAudioPropertyCache&  BGMAudioPropertyCache::GetInstance()
+{
+    // Never destroyed, so it can't be destroyed at exit while another thread is still using it.
+    static BGMAudioPropertyCache* sInstance = new BGMAudioPropertyCache;
+    return *sInstance;
+}
+
+BGMAudioPropertyCache::BGMAudioPropertyCache()
+{
+}
+
+BGMAudioPropertyCache::~BGMAudioPropertyCache()
+{
+    StopListening();
+}
+
+#pragma mark Property Values
+
+CFTypeRef __nullable    BGMAudioPropertyCache::CopyCFValue(AudioObjectID inObjectID,
+                                                           const AudioObjectPropertyAddress& inAddress)
+{
+    Entry theEntry = GetEntry(inObjectID, inAddress, true, sizeof(CFTypeRef));
+
+    if(theEntry.mCFValue)
+    {
+        CFRetain(theEntry.mCFValue.get());
+    }
+
+    return theEntry.mCFValue.get();
+}
+
+std::vector<UInt8>  BGMAudioPropertyCache::GetData(AudioObjectID inObjectID,
+                                                   const AudioObjectPropertyAddress& inAddress,
+                                                   UInt32 inFixedSize)
+{
+    return GetEntry(inObjectID, inAddress, false, inFixedSize).mData;
+}
+
+BGMAudioPropertyCache::Entry    BGMAudioPropertyCache::GetEntry(AudioObjectID inObjectID,
+                                                                const AudioObjectPropertyAddress& inAddress,
+                                                                bool inIsCFValue,
+                                                                UInt32 inFixedSize)
+{
+    const Key theKey { inObjectID, inAddress };
+    UInt64 theGeneration;
+    bool theListeningToDevices;
+
+    {
+        CAMutex::Locker theLocker(mMutex);
+
+        auto theEntry = mEntries.find(theKey);
+
+        if(theEntry != mEntries.end())
+        {
+            mHits++;
+            return theEntry->second;
+        }
+
+        mMisses++;
+        theGeneration = mGeneration;
+        theListeningToDevices = mListeningToDevices;
+    }
+
+    // Listen for objects being removed, so we don't keep their values forever.
+    if(!theListeningToDevices)
+    {
+        BGMLogAndSwallowExceptions("BGMAudioPropertyCache::GetEntry", [&] {
+            CAHALAudioSystemObject().AddPropertyListener(CAPropertyAddress(kAudioHardwarePropertyDevices),
+                                                         &BGMAudioPropertyCache::PropertyListenerProc,
+                                                         this);
+            CAMutex::Locker theLocker(mMutex);
+            mListeningToDevices = true;
+        });
+    }
+
+    // Start listening before reading the value, so the value can't change between reading it and
+    // adding the listener without us finding out.
+    const bool theCanCache = IsConstantProperty(inAddress.mSelector) || StartListening(theKey);
+
+    Entry theEntry = FetchEntry(inObjectID, inAddress, inIsCFValue, inFixedSize);
+
+    if(theCanCache)
+    {
+        CAMutex::Locker theLocker(mMutex);
+
+        // If anything was invalidated while we were reading the value, the value we read might
+        // already be out of date.
+        if(theGeneration == mGeneration)
+        {
+            mEntries[theKey] = theEntry;
+        }
+    }
+
+    return theEntry;
+}
+
+// static
+BGMAudioPropertyCache::Entry    BGMAudioPropertyCache::FetchEntry(AudioObjectID inObjectID,
+                                                                  const AudioObjectPropertyAddress& inAddress,
+                                                                  bool inIsCFValue,
+                                                                  UInt32 inFixedSize)
+{
+    CAHALAudioObject theObject(inObjectID);
+    Entry theEntry;
+
+    if(inIsCFValue)
+    {
+        CFTypeRef theValue = nullptr;
+        UInt32 theSize = sizeof(CFTypeRef);
+        theObject.GetPropertyData(inAddress, 0, nullptr, theSize, &theValue);
+
+        if(theValue)
+        {
+            theEntry.mCFValue = std::shared_ptr<const void>(theValue, CFRelease);
+        }
+    }
+    else
+    {
+        UInt32 theSize =
+                (inFixedSize != 0) ? inFixedSize : theObject.GetPropertyDataSize(inAddress, 0, nullptr);
+        theEntry.mData.resize(theSize);
+
+        if(theSize > 0)
+        {
+            theObject.GetPropertyData(inAddress, 0, nullptr, theSize, theEntry.mData.data());
+            // The size can be smaller than the HAL said it would be, e.g. if a list got shorter.
+            theEntry.mData.resize(theSize);
+        }
+    }
+
+    return theEntry;
+}
+
+// static
+bool    BGMAudioPropertyCache::IsConstantProperty(AudioObjectPropertySelector inSelector)
+{
+    switch(inSelector)
+    {
+        case kAudioObjectPropertyClass:
+        case kAudioObjectPropertyBaseClass:
+        case kAudioObjectPropertyCreator:
+        case kAudioDevicePropertyDeviceUID:
+        case kAudioDevicePropertyModelUID:
+        case kAudioDevicePropertyTransportType:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+#pragma mark Invalidation
+
+void    BGMAudioPropertyCache::Invalidate(AudioObjectID inObjectID,
+                                          AudioObjectPropertySelector inSelector)
+{
+    CAMutex::Locker theLocker(mMutex);
+    mInvalidations += EraseEntries([&](const Key& inKey) {
+        return inKey.mObjectID == inObjectID && inKey.mAddress.mSelector == inSelector;
+    });
+}
+
+void    BGMAudioPropertyCache::Invalidate(AudioObjectID inObjectID)
+{
+    CAMutex::Locker theLocker(mMutex);
+    mInvalidations += EraseEntries([&](const Key& inKey) {
+        return inKey.mObjectID == inObjectID;
+    });
+}
+
+void    BGMAudioPropertyCache::InvalidateAll()
+{
+    CAMutex::Locker theLocker(mMutex);
+    mInvalidations += EraseEntries([](const Key&) {
+        return true;
+    });
+}
+
+template<typename Predicate>
+UInt64  BGMAudioPropertyCache::EraseEntries(Predicate inPredicate)
+{
+    // Always start a new generation, even if nothing is erased, because the value being
+    // invalidated might be being read at the moment. See GetEntry.
+    mGeneration++;
+
+    UInt64 theNumberErased = 0;
+
+    for(auto theEntry = mEntries.begin(); theEntry != mEntries.end(); )
+    {
+        if(inPredicate(theEntry->first))
+        {
+            theEntry = mEntries.erase(theEntry);
+            theNumberErased++;
+        }
+        else
+        {
+            ++theEntry;
+        }
+    }
+
+    return theNumberErased;
+}
+
+#pragma mark Statistics
+
+BGMAudioPropertyCache::Statistics   BGMAudioPropertyCache::GetStatistics() const
+{
+    return { mHits, mMisses, mInvalidations };
+}
+
+void    BGMAudioPropertyCache::ResetStatistics()
+{
+    mHits = 0;
+    mMisses = 0;
+    mInvalidations = 0;
+}
+
+#pragma mark Implementation
+
+bool    BGMAudioPropertyCache::Key::operator<(const Key& inOther) const
+{
+    return std::tie(mObjectID, mAddress.mSelector, mAddress.mScope, mAddress.mElement) <
+            std::tie(inOther.mObjectID,
+                     inOther.mAddress.mSelector,
+                     inOther.mAddress.mScope,
+                     inOther.mAddress.mElement);
+}
+
+bool    BGMAudioPropertyCache::StartListening(const Key& inKey)
+{
+    const Key theDeviceHasChangedKey {
+        inKey.mObjectID, CAPropertyAddress(kAudioDevicePropertyDeviceHasChanged)
+    };
+    bool theAddDeviceHasChangedListener;
+
+    {
+        CAMutex::Locker theLocker(mMutex);
+
+        if(mListeningTo.count(inKey) != 0)
+        {
+            return true;
+        }
+
+        // Add the key now so other threads don't add the same listener. It's removed below if
+        // adding the listener fails.
+        mListeningTo.insert(inKey);
+        theAddDeviceHasChangedListener = mListeningTo.insert(theDeviceHasChangedKey).second;
+    }
+
+    // The HAL sends kAudioDevicePropertyDeviceHasChanged when a device changes in a way that could
+    // affect any of its properties. Objects other than devices will just never send it.
+    if(theAddDeviceHasChangedListener)
+    {
+        try
+        {
+            CAHALAudioObject(inKey.mObjectID).AddPropertyListener(theDeviceHasChangedKey.mAddress,
+                                                                  &BGMAudioPropertyCache::PropertyListenerProc,
+                                                                  this);
+        }
+        catch(...)
+        {
+            CAMutex::Locker theLocker(mMutex);
+            mListeningTo.erase(theDeviceHasChangedKey);
+        }
+    }
+
+    try
+    {
+        CAHALAudioObject(inKey.mObjectID).AddPropertyListener(inKey.mAddress,
+                                                              &BGMAudioPropertyCache::PropertyListenerProc,
+                                                              this);
+        return true;
+    }
+    catch(...)
+    {
+        // Without the listener, we wouldn't know when the value becomes out of date.
+        DebugMsg("BGMAudioPropertyCache::StartListening: Failed to add listener. Not caching the "
+                 "property. mObjectID = %u, mSelector = %u",
+                 inKey.mObjectID,
+                 inKey.mAddress.mSelector);
+
+        CAMutex::Locker theLocker(mMutex);
+        mListeningTo.erase(inKey);
+        return false;
+    }
+}
+
+void    BGMAudioPropertyCache::StopListening()
+{
+    std::set<Key> theListeningTo;
+    bool theListeningToDevices;
+
+    {
+        CAMutex::Locker theLocker(mMutex);
+        theListeningTo.swap(mListeningTo);
+        theListeningToDevices = mListeningToDevices;
+        mListeningToDevices = false;
+    }
+
+    for(const Key& theKey : theListeningTo)
+    {
+        // The HAL removes the listeners of objects that have been removed.
+        if(CAHALAudioObject::ObjectExists(theKey.mObjectID))
+        {
+            BGMLogAndSwallowExceptions("BGMAudioPropertyCache::StopListening", [&] {
+                CAHALAudioObject(theKey.mObjectID).RemovePropertyListener(theKey.mAddress,
+                                                                          &BGMAudioPropertyCache::PropertyListenerProc,
+                                                                          this);
+            });
+        }
+    }
+
+    if(theListeningToDevices)
+    {
+        BGMLogAndSwallowExceptions("BGMAudioPropertyCache::StopListening", [&] {
+            CAHALAudioSystemObject().RemovePropertyListener(CAPropertyAddress(kAudioHardwarePropertyDevices),
+                                                            &BGMAudioPropertyCache::PropertyListenerProc,
+                                                            this);
+        });
+    }
+}
+
+void    BGMAudioPropertyCache::RemoveDeadObjects()
+{
+    std::set<AudioObjectID> theObjects;
+
+    {
+        CAMutex::Locker theLocker(mMutex);
+
+        for(const auto& theEntry : mEntries)
+        {
+            theObjects.insert(theEntry.first.mObjectID);
+        }
+
+        for(const Key& theKey : mListeningTo)
+        {
+            theObjects.insert(theKey.mObjectID);
+        }
+    }
+
+    // Check which objects still exist without holding the mutex, since it's a call to the HAL.
+    std::set<AudioObjectID> theDeadObjects;
+
+    for(AudioObjectID theObjectID : theObjects)
+    {
+        if(!CAHALAudioObject::ObjectExists(theObjectID))
+        {
+            theDeadObjects.insert(theObjectID);
+        }
+    }
+
+    if(!theDeadObjects.empty())
+    {
+        CAMutex::Locker theLocker(mMutex);
+
+        mInvalidations += EraseEntries([&](const Key& inKey) {
+            return theDeadObjects.count(inKey.mObjectID) != 0;
+        });
+
+        for(auto theKey = mListeningTo.begin(); theKey != mListeningTo.end(); )
+        {
+            theKey = (theDeadObjects.count(theKey->mObjectID) != 0) ? mListeningTo.erase(theKey)
+                                                                    : std::next(theKey);
+        }
+    }
+}
+
+// static
+OSStatus    BGMAudioPropertyCache::PropertyListenerProc(AudioObjectID inObjectID,
+                                                        UInt32 inNumberAddresses,
+                                                        const AudioObjectPropertyAddress* inAddresses,
+                                                        void* __nullable inClientData)
+{
+    BGMAudioPropertyCache* const theCache = static_cast<BGMAudioPropertyCache*>(inClientData);
+    BGMAssertNonNull(theCache);
+
+    for(UInt32 i = 0; i < inNumberAddresses; i++)
+    {
+        const AudioObjectPropertySelector theSelector = inAddresses[i].mSelector;
+
+        if(inObjectID == kAudioObjectSystemObject && theSelector == kAudioHardwarePropertyDevices)
+        {
+            BGMLogAndSwallowExceptions("BGMAudioPropertyCache::PropertyListenerProc", [&] {
+                theCache->RemoveDeadObjects();
+            });
+        }
+        else if(theSelector == kAudioDevicePropertyDeviceHasChanged)
+        {
+            theCache->Invalidate(inObjectID);
+        }
+        else
+        {
+            theCache->Invalidate(inObjectID, theSelector);
+        }
+    }
+
+    return noErr;
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,217 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMAudioPropertyCache.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Caches the values of HAL audio object properties, so code that asks the HAL for the same
+//  properties of every device, like the code that builds the output device menu, doesn't have to
+//  make a call to coreaudiod for each one every time.
+//
+//  The first time a property is read, the cache adds a HAL property listener for it and removes
+//  the value from the cache when the listener is called. A few properties never change for the
+//  lifetime of an audio object, e.g. device UIDs, so the cache doesn't listen for those. All of an
+//  object's values are removed when it's removed from the system or it sends
+//  kAudioDevicePropertyDeviceHasChanged.
+//
+//  The HAL calls the listeners asynchronously, so a value read just after it changes can still be
+//  the old one. Code that has to have the current value, e.g. because it just changed the property
+//  itself, should ask the HAL directly.
+//
+//  Properties that take qualifier data, e.g. kAudioDevicePropertyDataSourceNameForIDCFString, can't
+//  be cached.
+//
+
+#ifndef BGMApp__BGMAudioPropertyCache
+#define BGMApp__BGMAudioPropertyCache
+
+// PublicUtility Includes
+#include "CAMutex.h"
+
+// STL Includes
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+// System Includes
+#include <CoreAudio/CoreAudio.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMAudioPropertyCache
+{
+
+#pragma mark Construction/Destruction
+
+public:
+    /*! The cache shared by BGMAudioDevice and the rest of BGMApp. */
+    static BGMAudioPropertyCache&   GetInstance();
+
+                        BGMAudioPropertyCache();
+                        ~BGMAudioPropertyCache();
+                        // Disallow copying
+                        BGMAudioPropertyCache(const BGMAudioPropertyCache&) = delete;
+                        BGMAudioPropertyCache& operator=(const BGMAudioPropertyCache&) = delete;
+
+#pragma mark Property Values
+
+    /*!
+     Get the value of a property whose type has a fixed size, e.g. UInt32 or Float64, from the
+     cache, or from the HAL if it isn't cached.
+
+     @throws CAException If the HAL returns an error when queried.
+     */
+    template<typename T>
+    T                   GetValue(AudioObjectID inObjectID,
+                                 const AudioObjectPropertyAddress& inAddress)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "BGMAudioPropertyCache::GetValue: Use CopyCFValue for CF types");
+
+        std::vector<UInt8> theData = GetData(inObjectID, inAddress, sizeof(T));
+        T theValue {};
+        memcpy(&theValue, theData.data(), std::min(theData.size(), sizeof(T)));
+        return theValue;
+    }
+
+    /*!
+     Get the value of a property whose type is a CF object, e.g. a CFStringRef.
+
+     @return The value, which the caller is responsible for releasing. Can be null if the HAL
+             returns null.
+     @throws CAException If the HAL returns an error when queried.
+     */
+    CFTypeRef __nullable CopyCFValue(AudioObjectID inObjectID,
+                                     const AudioObjectPropertyAddress& inAddress);
+
+    /*!
+     Get the raw value of a property.
+
+     @param inFixedSize The size of the property's value, or 0 to ask the HAL for its size. Use 0
+                        for properties with variable-length values, e.g. lists of object IDs.
+     @throws CAException If the HAL returns an error when queried.
+     */
+    std::vector<UInt8>  GetData(AudioObjectID inObjectID,
+                                const AudioObjectPropertyAddress& inAddress,
+                                UInt32 inFixedSize = 0);
+
+#pragma mark Invalidation
+
+    /*!
+     Remove the cached values of a property from the cache. Removes the values for every scope and
+     element, since the HAL sometimes only notifies listeners about one of them.
+     */
+    void                Invalidate(AudioObjectID inObjectID, AudioObjectPropertySelector inSelector);
+    /*! Remove all of an audio object's cached values. */
+    void                Invalidate(AudioObjectID inObjectID);
+    /*! Remove every value from the cache. */
+    void                InvalidateAll();
+
+#pragma mark Statistics
+
+    struct Statistics
+    {
+        /*! The number of values that were returned from the cache. */
+        UInt64          mHits;
+        /*! The number of values that had to be read from the HAL. */
+        UInt64          mMisses;
+        /*! The number of cached values removed because they changed or their objects went away. */
+        UInt64          mInvalidations;
+    };
+
+    Statistics          GetStatistics() const;
+    void                ResetStatistics();
+
+#pragma mark Implementation
+
+private:
+    struct Key
+    {
+        AudioObjectID                   mObjectID;
+        AudioObjectPropertyAddress      mAddress;
+
+        bool            operator<(const Key& inOther) const;
+    };
+
+    struct Entry
+    {
+        std::vector<UInt8>              mData;
+        // Set instead of mData for properties with CF values.
+        std::shared_ptr<const void>     mCFValue;
+    };
+
+    Entry               GetEntry(AudioObjectID inObjectID,
+                                 const AudioObjectPropertyAddress& inAddress,
+                                 bool inIsCFValue,
+                                 UInt32 inFixedSize);
+    /*! @throws CAException If the HAL returns an error. */
+    static Entry        FetchEntry(AudioObjectID inObjectID,
+                                   const AudioObjectPropertyAddress& inAddress,
+                                   bool inIsCFValue,
+                                   UInt32 inFixedSize);
+
+    /*! @return True if values of the property never change for the lifetime of the object. */
+    static bool         IsConstantProperty(AudioObjectPropertySelector inSelector);
+
+    /*!
+     Add a listener for the property, unless we already have.
+     @return True if the cache will be notified when the property's value changes.
+     */
+    bool                StartListening(const Key& inKey);
+    void                StopListening();
+
+    /*! Remove the values of objects that have been removed from the system. */
+    void                RemoveDeadObjects();
+
+    static OSStatus     PropertyListenerProc(AudioObjectID inObjectID,
+                                             UInt32 inNumberAddresses,
+                                             const AudioObjectPropertyAddress* inAddresses,
+                                             void* __nullable inClientData);
+
+    /*! Removes matching entries. Returns the number removed. Must be called with mMutex held. */
+    template<typename Predicate>
+    UInt64              EraseEntries(Predicate inPredicate);
+
+private:
+    mutable CAMutex         mMutex { "Audio Property Cache" };
+
+    std::map<Key, Entry>    mEntries;
+    // The properties we've added listeners for.
+    std::set<Key>           mListeningTo;
+    bool                    mListeningToDevices = false;
+
+    // Incremented whenever values are invalidated, so we don't cache values that were read from
+    // the HAL while they were changing.
+    UInt64                  mGeneration = 0;
+
+    std::atomic<UInt64>     mHits { 0 };
+    std::atomic<UInt64>     mMisses { 0 };
+    std::atomic<UInt64>     mInvalidations { 0 };
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMApp__BGMAudioPropertyCache */
+
@@ -26,6 +26,7 @@
 // Local Includes
 #include "BGM_Types.h"
 #import "BGMMusicPlayer.h"
+#import "BGMMusicPlayerState.h"
 
 // STL Includes
 #import <algorithm>  // std::max, std::min
@@ -54,6 +55,9 @@ static UInt64 const kMaxUnpauseDelayNSec = 3500 * NSEC_PER_MSEC;
 static UInt64 const kMinUnpauseDelayNSec = kMaxUnpauseDelayNSec / 10;
 // We multiply the time spent paused by this factor to calculate the delay before we consider unpausing.
 static Float32 const kUnpauseDelayWeightingFactor = 0.1f;
+// How often to ask the music player whether it's playing while auto-pause is enabled. Music players
+// that post notifications when they start and stop playing are only asked once.
+static NSTimeInterval const kMusicPlayerStatePollingIntervalSecs = 10;
 
 @implementation BGMAutoPauseMusic {
     BOOL enabled;
@@ -66,6 +70,9 @@ static Float32 const kUnpauseDelayWeightingFactor = 0.1f;
     AudioObjectPropertyListenerBlock listenerBlock;
     
     dispatch_queue_t pauseUnpauseMusicQueue;
+    // Sends the Apple events to the selected music player and caches its state. Guarded by
+    // @synchronized(self) because the user can select a different music player at any time.
+    BGMMusicPlayerState* __nullable musicPlayerState;
     
     // True if BGMApp has paused musicPlayer and hasn't unpaused it yet. (Will be out of sync with the music player app if the
     // user has unpaused it themselves.)
@@ -144,6 +151,27 @@ static Float32 const kUnpauseDelayWeightingFactor = 0.1f;
     };
 }
 
+- (BGMMusicPlayerState*) selectedMusicPlayerState {
+    @synchronized (self) {
+        id<BGMMusicPlayer> selectedMusicPlayer = musicPlayers.selectedMusicPlayer;
+
+        if (!musicPlayerState || musicPlayerState.musicPlayer != selectedMusicPlayer) {
+            [musicPlayerState stopPolling];
+
+            // Use pauseUnpauseMusicQueue so the pause and unpause blocks can check the result of
+            // pausing/unpausing before they return.
+            musicPlayerState = [[BGMMusicPlayerState alloc] initWithMusicPlayer:selectedMusicPlayer
+                                                                          queue:pauseUnpauseMusicQueue];
+
+            if (enabled) {
+                [musicPlayerState startPollingWithInterval:kMusicPlayerStatePollingIntervalSecs];
+            }
+        }
+
+        return (BGMMusicPlayerState*)musicPlayerState;
+    }
+}
+
 - (BGMDeviceAudibleState) deviceAudibleState {
     return [audioDevices bgmDevice].GetAudibleState();
 }
@@ -168,7 +196,21 @@ static Float32 const kUnpauseDelayWeightingFactor = 0.1f;
                        // state hasn't changed since this block was queued. Also set wePaused to true if the player wasn't
                        // already paused.
                        if (!wePaused && (startedPauseDelay == wentAudible) && stillAudible) {
-                           wePaused = ([musicPlayers.selectedMusicPlayer pause] || wePaused);
+                           BGMMusicPlayerState* playerState = [self selectedMusicPlayerState];
+
+                           // If the music player's notifications say it isn't playing, there's no
+                           // need to send it any Apple events.
+                           if (playerState.playbackStateFollowsNotifications &&
+                                   playerState.playbackState != BGMMusicPlayerPlaybackStatePlaying) {
+                               DebugMsg("BGMAutoPauseMusic::queuePauseBlock: Not pausing because the music player isn't playing.");
+                               return;
+                           }
+
+                           // This block is running on pauseUnpauseMusicQueue, so the completion
+                           // handler is called before pauseWithCompletion returns.
+                           [playerState pauseWithCompletion:^(BOOL didPause) {
+                               wePaused = (didPause || wePaused);
+                           }];
                        }
                    });
 }
@@ -214,7 +256,7 @@ static Float32 const kUnpauseDelayWeightingFactor = 0.1f;
                        // device is still silent, which means the audible state hasn't changed since this block was queued.
                        if (wePaused && (startedUnpauseDelay == wentSilent) && stillSilent) {
                            wePaused = NO;
-                           [musicPlayers.selectedMusicPlayer unpause];
+                           [[self selectedMusicPlayerState] unpauseWithCompletion:nil];
                        }
                    });
 }
@@ -223,6 +265,7 @@ static Float32 const kUnpauseDelayWeightingFactor = 0.1f;
     if (!enabled) {
         [audioDevices bgmDevice].AddPropertyListenerBlock(kBGMAudibleStateAddress, listenerQueue, listenerBlock);
         enabled = YES;
+        [[self selectedMusicPlayerState] startPollingWithInterval:kMusicPlayerStatePollingIntervalSecs];
     }
 }
 
@@ -230,6 +273,10 @@ static Float32 const kUnpauseDelayWeightingFactor = 0.1f;
     if (enabled) {
         [audioDevices bgmDevice].RemovePropertyListenerBlock(kBGMAudibleStateAddress, listenerQueue, listenerBlock);
         enabled = NO;
+
+        @synchronized (self) {
+            [musicPlayerState stopPolling];
+        }
     }
 }
 
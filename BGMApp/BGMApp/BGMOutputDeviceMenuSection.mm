@@ -36,6 +36,7 @@
 
 // STL Includes
 #import <set>
+#import <vector>
 
 
 #pragma clang assume_nonnull begin
@@ -196,7 +197,7 @@ static NSInteger const kOutputDeviceMenuItemTag = 5;
     }
 }
 
-- (NSArray<NSMenuItem*>*) createMenuItemsForDevice:(CAHALAudioDevice)device {
+- (NSArray<NSMenuItem*>*) createMenuItemsForDevice:(BGMAudioDevice)device {
     // We fill this array with a menu item for each output device (or each data source for each device) on
     // the system.
     NSMutableArray<NSMenuItem*>* items = [NSMutableArray new];
@@ -210,21 +211,20 @@ static NSInteger const kOutputDeviceMenuItemTag = 5;
     //
     // TODO: Handle data destinations as well? I don't have (or know of) any hardware with them.
     // TODO: Use the current data source's name when the control isn't settable, but only add one menu item.
-    UInt32 numDataSources = 0;
+    //
+    // The device's properties are read through BGMAudioPropertyCache where possible, since this is
+    // called for every device each time the menu is populated.
+    std::vector<UInt32> dataSourceIDs;
 
     BGM_Utils::LogAndSwallowExceptions(BGMDbgArgs, [&] {
         if (device.HasDataSourceControl(scope, channel) &&
                 device.DataSourceControlIsSettable(scope, channel)) {
-            numDataSources = device.GetNumberAvailableDataSources(scope, channel);
+            dataSourceIDs = device.GetCachedAvailableDataSources(scope, channel);
         }
     });
     
-    if (numDataSources > 0) {
-        UInt32 dataSourceIDs[numDataSources];
-        // This call updates numDataSources to the real number of IDs it added to our array.
-        device.GetAvailableDataSources(scope, channel, numDataSources, dataSourceIDs);
-        
-        for (UInt32 i = 0; i < numDataSources; i++) {
+    if (!dataSourceIDs.empty()) {
+        for (size_t i = 0; i < dataSourceIDs.size(); i++) {
             DebugMsg("BGMOutputDeviceMenuSection::createMenuItemsForDevice: "
                      "Creating item. %s%u %s%u",
                      "Device ID:", device.GetObjectID(),
@@ -233,7 +233,7 @@ static NSInteger const kOutputDeviceMenuItemTag = 5;
             BGM_Utils::LogAndSwallowExceptions(BGMDbgArgs, "(DS)", [&] {
                 NSString* dataSourceName =
                     CFBridgingRelease(device.CopyDataSourceNameForID(scope, channel, dataSourceIDs[i]));
-                NSString* deviceName = CFBridgingRelease(device.CopyName());
+                NSString* deviceName = CFBridgingRelease(device.CopyCachedName());
                 
                 [items addObject:[self createMenuItemForDevice:device
                                                   dataSourceID:@(dataSourceIDs[i])
@@ -248,7 +248,7 @@ static NSInteger const kOutputDeviceMenuItemTag = 5;
         BGM_Utils::LogAndSwallowExceptions(BGMDbgArgs, [&] {
             [items addObject:[self createMenuItemForDevice:device
                                               dataSourceID:nil
-                                                     title:CFBridgingRelease(device.CopyName())
+                                                     title:CFBridgingRelease(device.CopyCachedName())
                                                    toolTip:nil]];
         });
     }
@@ -256,7 +256,7 @@ static NSInteger const kOutputDeviceMenuItemTag = 5;
     return items;
 }
 
-- (NSMenuItem*) createMenuItemForDevice:(CAHALAudioDevice)device
+- (NSMenuItem*) createMenuItemForDevice:(BGMAudioDevice)device
                            dataSourceID:(NSNumber* __nullable)dataSourceID
                                   title:(NSString* __nullable)title
                                 toolTip:(NSString* __nullable)toolTip {
@@ -273,7 +273,7 @@ static NSInteger const kOutputDeviceMenuItemTag = 5;
     //
     // TODO: Test this with real hardware that supports AirPlay. (I don't have any.)
     BGM_Utils::LogAndSwallowExceptions(BGMDbgArgs, [&] {
-        if (device.GetTransportType() == kAudioDeviceTransportTypeAirPlay) {
+        if (device.GetCachedTransportType() == kAudioDeviceTransportTypeAirPlay) {
             item.image = [NSImage imageNamed:@"AirPlayIcon"];
             
             // Make the icon a "template image" so it gets drawn colour-inverted when it's highlighted or
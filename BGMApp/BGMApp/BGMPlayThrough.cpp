@@ -33,17 +33,27 @@
 
 // STL Includes
 #include <algorithm>  // For std::max
+#include <cmath>      // For std::fabs
 
 // System Includes
 #include <mach/mach_init.h>
 #include <mach/mach_time.h>
 #include <mach/task.h>
+#include <pthread.h>
 
 
 // The number of IO cycles (roughly) to wait for our IOProcs to stop themselves before assuming something
 // went wrong. If that happens, we try to stop them from a non-IO thread and continue anyway. 
 static const UInt32 kStopIOProcTimeoutInIOCycles = 600;
 
+// Samples quieter than this are treated as silent when deciding whether to suspend the output IOProc.
+// The same margin BGMDriver uses for kAudioDeviceCustomPropertyDeviceAudibleState.
+static const Float32 kIdleSuspendSilenceThreshold = 0.0001f;
+
+// How long to wait for the output IOProc to finish stopping itself after it's been suspended, if it's
+// resumed straight away. It should only take one IO cycle.
+static const UInt32 kResumeAfterIdleMaxWaitMs = 100;
+
 #pragma mark Construction/Destruction
 
 BGMPlayThrough::BGMPlayThrough(BGMAudioDevice inInputDevice, BGMAudioDevice inOutputDevice)
@@ -56,6 +66,9 @@ BGMPlayThrough::BGMPlayThrough(BGMAudioDevice inInputDevice, BGMAudioDevice inOu
 
 BGMPlayThrough::~BGMPlayThrough()
 {
+    // Stop the idle resume thread first because it takes mStateMutex.
+    DestroyIdleResumeThread();
+
     CAMutex::Locker stateLocker(mStateMutex);
 
     BGMLogAndSwallowExceptionsMsg("BGMPlayThrough::~BGMPlayThrough", "Deactivate", [&]() {
@@ -76,6 +89,16 @@ BGMPlayThrough::~BGMPlayThrough()
         kern_return_t theError = semaphore_destroy(mach_task_self(), mOutputDeviceIOProcSemaphore);
         BGM_Utils::LogIfMachError("BGMPlayThrough::~BGMPlayThrough", "semaphore_destroy", theError);
     }
+
+    // Destroyed last because the input IOProc can signal it until it's stopped.
+    if(mIdleResumeSemaphore != SEMAPHORE_NULL)
+    {
+        semaphore_t semaphore = mIdleResumeSemaphore;
+        mIdleResumeSemaphore = SEMAPHORE_NULL;
+
+        kern_return_t theError = semaphore_destroy(mach_task_self(), semaphore);
+        BGM_Utils::LogIfMachError("BGMPlayThrough::~BGMPlayThrough", "semaphore_destroy", theError);
+    }
 }
 
 void    BGMPlayThrough::Init(BGMAudioDevice inInputDevice, BGMAudioDevice inOutputDevice)
@@ -103,6 +126,24 @@ void    BGMPlayThrough::Init(BGMAudioDevice inInputDevice, BGMAudioDevice inOutp
                     CAException(kAudioHardwareUnspecifiedError),
                     "BGMPlayThrough::BGMPlayThrough: Could not create semaphore");
         }
+
+        // Init the semaphore and thread for resuming the output IOProc after it's been suspended.
+        // The thread is created now, rather than when it's needed, so it can start the output
+        // IOProc as soon as the input IOProc reads audio.
+        if(mIdleResumeSemaphore == SEMAPHORE_NULL)
+        {
+            kern_return_t theError = semaphore_create(mach_task_self(), &mIdleResumeSemaphore, SYNC_POLICY_FIFO, 0);
+            BGM_Utils::ThrowIfMachError("BGMPlayThrough::BGMPlayThrough", "semaphore_create", theError);
+
+            ThrowIf(mIdleResumeSemaphore == SEMAPHORE_NULL,
+                    CAException(kAudioHardwareUnspecifiedError),
+                    "BGMPlayThrough::BGMPlayThrough: Could not create semaphore");
+        }
+
+        if(!mIdleResumeThread.joinable())
+        {
+            mIdleResumeThread = std::thread(&BGMPlayThrough::IdleResumeThreadEntry, this);
+        }
     }
     catch (...)
     {
@@ -126,11 +167,18 @@ void    BGMPlayThrough::Activate()
         
         // TODO: This code (the next two blocks) should be in BGMDeviceControlSync.
         
-        // Set BGMDevice's sample rate to match the output device.
+        // Set BGMDevice's sample rate to match the output device, unless it's been fixed. If the
+        // rates end up different, the output IOProc converts between them.
         try
         {
-            Float64 outputSampleRate = mOutputDevice.GetNominalSampleRate();
-            mInputDevice.SetNominalSampleRate(outputSampleRate);
+            Float64 inputSampleRate = mFixedInputSampleRate;
+
+            if(inputSampleRate == 0.0)
+            {
+                inputSampleRate = mOutputDevice.GetNominalSampleRate();
+            }
+
+            mInputDevice.SetNominalSampleRate(inputSampleRate);
         }
         catch (CAException e)
         {
@@ -169,6 +217,16 @@ void    BGMPlayThrough::Activate()
             mInputDevice.AddPropertyListener(kBGMRunningSomewhereOtherThanBGMAppAddress,
                                              &BGMPlayThrough::BGMDeviceListenerProc,
                                              this);
+            mInputDevice.AddPropertyListener(kBGMAudibleStateAddress,
+                                             &BGMPlayThrough::BGMDeviceListenerProc,
+                                             this);
+
+            // If we can't tell, assume it isn't silent so the output IOProc won't be suspended.
+            mBGMDeviceIsSilent = false;
+
+            BGMLogAndSwallowExceptions("BGMPlayThrough::Activate", [&] {
+                mBGMDeviceIsSilent = IsSilent(mInputDevice);
+            });
         }
         else
         {
@@ -215,6 +273,12 @@ void    BGMPlayThrough::Deactivate()
                                                     &BGMPlayThrough::BGMDeviceListenerProc,
                                                     this);
             });
+
+            BGMLogAndSwallowExceptions("BGMPlayThrough::Deactivate", [&] {
+                mInputDevice.RemovePropertyListener(kBGMAudibleStateAddress,
+                                                    &BGMPlayThrough::BGMDeviceListenerProc,
+                                                    this);
+            });
         }
 
         BGMLogAndSwallowExceptions("BGMPlayThrough::Deactivate", [&] {
@@ -248,13 +312,21 @@ void    BGMPlayThrough::AllocateBuffer()
 
     mBuffer = std::unique_ptr<CARingBuffer>(new CARingBuffer);
 
+    // The buffer holds the input device's audio. If its sample rate is fixed higher than the output
+    // device's, e.g. at 192 kHz for a 44.1 kHz output device, the buffer needs proportionally more
+    // frames to hold the same length of audio.
+    const Float64 outputSampleRate = mOutputDevice.GetNominalSampleRate();
+    const Float64 inputFramesPerOutputFrame =
+        (outputSampleRate > 0.0) ? std::max(1.0, mFixedInputSampleRate / outputSampleRate) : 1.0;
+
     // The calculation for the size of the buffer is from Apple's CAPlayThrough.cpp sample code
     //
     // TODO: Test playthrough with hardware with more than 2 channels per frame, a sample (virtual) format other than
     //       32-bit floats and/or an IO buffer size other than 512 frames
     mBuffer->Allocate(outputFormat[0].mChannelsPerFrame,
                       outputFormat[0].mBytesPerFrame,
-                      mOutputDevice.GetIOBufferSize() * 20);
+                      static_cast<UInt32>(std::ceil(mOutputDevice.GetIOBufferSize() * 20 *
+                                                    inputFramesPerOutputFrame)));
 }
 
 void    BGMPlayThrough::DeallocateBuffer()
@@ -441,7 +513,13 @@ void    BGMPlayThrough::Start()
     {
         DebugMsg("BGMPlayThrough::Start: Already started/starting.");
 
-        if(mOutputDeviceIOProcState == IOState::Running)
+        if(mOutputSuspendedForIdle)
+        {
+            // A client has started IO on BGMDevice, so it might be about to play audio. Start the
+            // output IOProc now so WaitForOutputDeviceToStart can wait for it.
+            ResumeOutputAfterIdle();
+        }
+        else if(mOutputDeviceIOProcState == IOState::Running)
         {
             ReleaseThreadsWaitingForOutputToStart();
         }
@@ -474,6 +552,14 @@ void    BGMPlayThrough::Start()
     }
     
     DebugMsg("BGMPlayThrough::Start: Starting playthrough");
+
+    CATry
+    UpdateIdleSuspendDelayFrames();
+    CACatch
+
+    CATry
+    ConfigureSampleRateConverter();
+    CACatch
     
     // Start our IOProcs.
     try
@@ -671,7 +757,12 @@ OSStatus    BGMPlayThrough::Stop()
         CACatch
 
         mInputDeviceIOProcState = inputDeviceAlive ? IOState::Stopping : IOState::Stopped;
-        mOutputDeviceIOProcState = outputDeviceAlive ? IOState::Stopping : IOState::Stopped;
+
+        // If the output IOProc has been suspended, it's already stopped.
+        if(mOutputDeviceIOProcState != IOState::Stopped)
+        {
+            mOutputDeviceIOProcState = outputDeviceAlive ? IOState::Stopping : IOState::Stopped;
+        }
         
         // Wait for the IOProcs to stop themselves. This is so the IOProcs don't get called after the BGMPlayThrough instance
         // (pointed to by the client data they get from the HAL) is deallocated.
@@ -742,10 +833,15 @@ OSStatus    BGMPlayThrough::Stop()
         
         mPlayingThrough = false;
     }
+
+    mOutputSuspendedForIdle = false;
+    mResumeAfterIdleRequested = false;
     
     mFirstInputSampleTime = -1;
     mLastInputSampleTime = -1;
     mLastOutputSampleTime = -1;
+    mInputSilentSinceSampleTime = -1;
+    mConverterReadSampleTime = -1;
     
     return noErr; // TODO: Why does this return anything and why always noErr?
 }
@@ -760,6 +856,13 @@ void    BGMPlayThrough::StopIfIdle()
     
     BGMAssert(mInputDevice.IsBGMDeviceInstance(),
               "BGMDevice not set as input device. StopIfIdle can't tell if other devices are idle.");
+
+    // Keep playing through while we're recording so the recording doesn't skip the silent parts.
+    if(HasRecorderTap())
+    {
+        DebugMsg("BGMPlayThrough::StopIfIdle: Recording. Not stopping playthrough.");
+        return;
+    }
     
     if(!IsRunningSomewhereOtherThanBGMApp(mInputDevice))
     {
@@ -794,7 +897,8 @@ void    BGMPlayThrough::StopIfIdle()
                                // this block was queued
                                if(mPlayingThrough
                                   && !IsRunningSomewhereOtherThanBGMApp(mInputDevice)
-                                  && queuedAt == mLastNotifiedIOStoppedOnBGMDevice)
+                                  && queuedAt == mLastNotifiedIOStoppedOnBGMDevice
+                                  && !HasRecorderTap())
                                {
                                    DebugMsg("BGMPlayThrough::StopIfIdle: BGMDevice is only running IO for BGMApp. "
                                             "Stopping playthrough.");
@@ -805,6 +909,344 @@ void    BGMPlayThrough::StopIfIdle()
     }
 }
 
+#pragma mark Recording
+
+void    BGMPlayThrough::SetRecorderTap(BGMRecorderTap* __nullable inTap)
+{
+    // The input IOProc only tries to lock mBufferInputMutex, so it can't be using the old tap once
+    // we have the lock.
+    CAMutex::Locker lockerInput(mBufferInputMutex);
+    mRecorderTap = inTap;
+}
+
+bool    BGMPlayThrough::HasRecorderTap()
+{
+    CAMutex::Locker lockerInput(mBufferInputMutex);
+    return mRecorderTap != nullptr;
+}
+
+#pragma mark Idle Suspension
+
+void    BGMPlayThrough::SetIdleSuspendDelay(Float64 inSeconds)
+{
+    CAMutex::Locker stateLocker(mStateMutex);
+
+    DebugMsg("BGMPlayThrough::SetIdleSuspendDelay: %f seconds", inSeconds);
+
+    mIdleSuspendDelaySeconds = std::max(inSeconds, 0.0);
+
+    CATry
+    UpdateIdleSuspendDelayFrames();
+    CACatch
+
+    if(mIdleSuspendDelaySeconds == 0.0)
+    {
+        ResumeOutputAfterIdle();
+    }
+}
+
+void    BGMPlayThrough::UpdateIdleSuspendDelayFrames()
+{
+    Float64 delayFrames = 0.0;
+
+    if(mIdleSuspendDelaySeconds > 0.0)
+    {
+        delayFrames = mIdleSuspendDelaySeconds * mInputDevice.GetNominalSampleRate();
+    }
+
+    mIdleSuspendDelayFrames = delayFrames;
+}
+
+void    BGMPlayThrough::UpdateIdleSuspendRT(const AudioBufferList* inInputData,
+                                            UInt32 inFrames,
+                                            Float64 inSampleTime)
+{
+    if(!IsBufferSilent(inInputData))
+    {
+        mInputSilentSinceSampleTime = -1;
+
+        if(mOutputSuspendedForIdle)
+        {
+            RequestResumeAfterIdle();
+        }
+
+        return;
+    }
+
+    // Also restart the count if the sample times have been restarted.
+    if(mInputSilentSinceSampleTime == -1 || inSampleTime < mInputSilentSinceSampleTime)
+    {
+        mInputSilentSinceSampleTime = inSampleTime;
+    }
+
+    const Float64 delayFrames = mIdleSuspendDelayFrames;
+    const Float64 silentFrames = inSampleTime + inFrames - mInputSilentSinceSampleTime;
+
+    // BGMDriver's audible state is checked as well because it knows whether the clients are silent
+    // or just haven't sent it any audio for a moment. It takes too long to change back to audible
+    // to use it for resuming, though.
+    if(delayFrames > 0.0 &&
+       silentFrames >= delayFrames &&
+       mBGMDeviceIsSilent &&
+       !mOutputSuspendedForIdle)
+    {
+        // Tell the output IOProc to stop itself. This will only fail if it's starting or already
+        // stopping, in which case we just try again next cycle.
+        IOState expectedState = IOState::Running;
+
+        if(mOutputDeviceIOProcState.compare_exchange_strong(expectedState, IOState::Stopping))
+        {
+            mSuspendedForIdleAt = mach_absolute_time();
+            mResumeAfterIdleRequested = false;
+            mOutputSuspendedForIdle = true;
+        }
+    }
+}
+
+void    BGMPlayThrough::RequestResumeAfterIdle()
+{
+    // Only signal the resume thread once per suspension.
+    if(!mResumeAfterIdleRequested.exchange(true))
+    {
+        semaphore_t semaphore = mIdleResumeSemaphore;
+
+        if(semaphore == SEMAPHORE_NULL || semaphore_signal(semaphore) != KERN_SUCCESS)
+        {
+            // Try again next cycle.
+            mResumeAfterIdleRequested = false;
+        }
+    }
+}
+
+void    BGMPlayThrough::ResumeOutputAfterIdle()
+{
+    if(!mOutputSuspendedForIdle)
+    {
+        mResumeAfterIdleRequested = false;
+        return;
+    }
+
+    if(!mActive || !mPlayingThrough || mOutputDeviceIOProcID == nullptr)
+    {
+        // Playthrough was stopped while the output IOProc was suspended.
+        mOutputSuspendedForIdle = false;
+        mResumeAfterIdleRequested = false;
+        return;
+    }
+
+    // If the output IOProc was suspended very recently, it might not have stopped itself yet. It
+    // should only take one IO cycle.
+    UInt32 waitedMs = 0;
+
+    while(mOutputDeviceIOProcState == IOState::Stopping && waitedMs < kResumeAfterIdleMaxWaitMs)
+    {
+        struct timespec rmtp;
+        nanosleep((const struct timespec[]){{0, NSEC_PER_MSEC}}, &rmtp);
+        waitedMs++;
+    }
+
+    if(mOutputDeviceIOProcState == IOState::Stopping)
+    {
+        LogError("BGMPlayThrough::ResumeOutputAfterIdle: The output IOProc didn't stop itself in "
+                 "time. Stopping it from outside of the IO thread.");
+
+        BGMLogUnexpectedExceptions("BGMPlayThrough::ResumeOutputAfterIdle", [&]() {
+            mOutputDevice.StopIOProc(mOutputDeviceIOProcID);
+        });
+
+        mOutputDeviceIOProcState = IOState::Stopped;
+    }
+
+    if(BGMDebugLoggingIsEnabled())
+    {
+        struct mach_timebase_info baseInfo = { 0, 0 };
+        mach_timebase_info(&baseInfo);
+
+        DebugMsg("BGMPlayThrough::ResumeOutputAfterIdle: Resuming the output IOProc after %f ms",
+                 static_cast<Float64>(mach_absolute_time() - mSuspendedForIdleAt) *
+                         baseInfo.numer / baseInfo.denom / NSEC_PER_MSEC);
+    }
+
+    // The output IOProc recalculates its offset from the input when mLastOutputSampleTime is -1,
+    // the same as when playthrough starts.
+    mLastOutputSampleTime = -1;
+
+    try
+    {
+        mOutputDeviceIOProcState = IOState::Starting;
+        mOutputDevice.StartIOProc(mOutputDeviceIOProcID);
+    }
+    catch(CAException e)
+    {
+        mOutputDeviceIOProcState = IOState::Stopped;
+
+        OSStatus err = e.GetError();
+        char err4CC[5] = CA4CCToCString(err);
+        LogError("BGMPlayThrough::ResumeOutputAfterIdle: Failed to start output device. Error: %d (%s)",
+                 err,
+                 err4CC);
+
+        // Leave mResumeAfterIdleRequested set so the input IOProc doesn't keep retrying. Start will
+        // try again the next time a client starts IO on BGMDevice.
+        return;
+    }
+
+    mOutputSuspendedForIdle = false;
+    mResumeAfterIdleRequested = false;
+}
+
+// static
+bool    BGMPlayThrough::IsBufferSilent(const AudioBufferList* inBufferList) noexcept
+{
+    for(UInt32 i = 0; i < inBufferList->mNumberBuffers; i++)
+    {
+        const Float32* samples = static_cast<const Float32*>(inBufferList->mBuffers[i].mData);
+        const UInt32 numSamples = inBufferList->mBuffers[i].mDataByteSize / SizeOf32(Float32);
+
+        if(samples == nullptr)
+        {
+            continue;
+        }
+
+        // Find the peak without branching in the loop so the compiler can vectorise it.
+        Float32 peak = 0.0f;
+
+        for(UInt32 j = 0; j < numSamples; j++)
+        {
+            peak = std::max(peak, std::fabs(samples[j]));
+        }
+
+        if(peak >= kIdleSuspendSilenceThreshold)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// static
+void    BGMPlayThrough::IdleResumeThreadEntry(BGMPlayThrough* inRefCon)
+{
+    DebugMsg("BGMPlayThrough::IdleResumeThreadEntry: Starting the idle resume thread");
+
+    // Resuming is on the critical path for the first audio after a silence, so run at the same
+    // priority as HandleBGMDeviceIsRunning.
+    pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+
+    while(true)
+    {
+        kern_return_t error = semaphore_wait(inRefCon->mIdleResumeSemaphore);
+
+        if(inRefCon->mIdleResumeThreadShouldExit)
+        {
+            break;
+        }
+
+        if(error == KERN_ABORTED)
+        {
+            // A spurious wake-up.
+            continue;
+        }
+
+        if(error != KERN_SUCCESS)
+        {
+            BGM_Utils::LogIfMachError("BGMPlayThrough::IdleResumeThreadEntry", "semaphore_wait", error);
+            break;
+        }
+
+        BGMLogAndSwallowExceptions("BGMPlayThrough::IdleResumeThreadEntry", [&] {
+            CAMutex::Locker stateLocker(inRefCon->mStateMutex);
+            inRefCon->ResumeOutputAfterIdle();
+        });
+    }
+
+    DebugMsg("BGMPlayThrough::IdleResumeThreadEntry: Idle resume thread exiting");
+}
+
+void    BGMPlayThrough::DestroyIdleResumeThread()
+{
+    if(!mIdleResumeThread.joinable())
+    {
+        return;
+    }
+
+    mIdleResumeThreadShouldExit = true;
+    kern_return_t error = semaphore_signal(mIdleResumeSemaphore);
+
+    BGM_Utils::LogIfMachError("BGMPlayThrough::DestroyIdleResumeThread", "semaphore_signal", error);
+
+    if(error == KERN_SUCCESS)
+    {
+        mIdleResumeThread.join();
+    }
+    else
+    {
+        // If we couldn't tell it to wake up, it's not safe to wait for it to stop. We have to
+        // detach it so its destructor doesn't cause a crash.
+        mIdleResumeThread.detach();
+    }
+}
+
+#pragma mark Sample Rate Conversion
+
+void    BGMPlayThrough::SetFixedInputSampleRate(Float64 inSampleRate)
+{
+    ThrowIf(inSampleRate < 0.0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMPlayThrough::SetFixedInputSampleRate: Invalid sample rate");
+
+    CAMutex::Locker stateLocker(mStateMutex);
+
+    if(mFixedInputSampleRate == inSampleRate)
+    {
+        return;
+    }
+
+    DebugMsg("BGMPlayThrough::SetFixedInputSampleRate: Setting fixed input sample rate to %f",
+             inSampleRate);
+
+    mFixedInputSampleRate = inSampleRate;
+
+    if(mActive)
+    {
+        // Reactivate playthrough (and restart it if it's running) so Activate sets the input
+        // device's sample rate and Start reconfigures mConverter.
+        SetDevices(nullptr, nullptr);
+    }
+}
+
+void    BGMPlayThrough::ConfigureSampleRateConverter()
+{
+    const Float64 inputSampleRate = mInputDevice.GetNominalSampleRate();
+    const Float64 outputSampleRate = mOutputDevice.GetNominalSampleRate();
+
+    // The output IOProc asks for around this many frames each cycle. Leave room for it to ask for
+    // a few times as many, since the HAL doesn't always give IOProcs the same number of frames and
+    // the converter needs a filter's length of extra input after it's been reset.
+    const UInt32 maxOutputFrames = mOutputDevice.GetIOBufferSize() * 4;
+    const UInt32 maxInputFrames =
+        static_cast<UInt32>(std::ceil(maxOutputFrames * inputSampleRate / outputSampleRate)) + 2;
+
+    CAMutex::Locker lockerOutput(mBufferOutputMutex);
+
+    if(inputSampleRate != outputSampleRate)
+    {
+        DebugMsg("BGMPlayThrough::ConfigureSampleRateConverter: Converting from %f Hz to %f Hz",
+                 inputSampleRate,
+                 outputSampleRate);
+    }
+
+    mConverter.SetRates(inputSampleRate, outputSampleRate, maxInputFrames);
+    mConverterInput.assign(static_cast<size_t>(maxInputFrames) * mConverter.GetChannels(), 0.0f);
+
+    // Enough for an IO cycle of each device, plus half again for scheduling jitter. See
+    // FetchConvertedRT.
+    const Float64 cycleFrames =
+        mInputDevice.GetIOBufferSize() + mOutputDevice.GetIOBufferSize() * inputSampleRate / outputSampleRate;
+    mConverterSlackFrames = static_cast<UInt32>(std::ceil(1.5 * cycleFrames));
+}
+
 #pragma mark BGMDevice Listener
 
 // TODO: Listen for changes to the sample rate and IO buffer size of the output device and update the input device to match
@@ -853,6 +1295,10 @@ OSStatus    BGMPlayThrough::BGMDeviceListenerProc(AudioObjectID inObjectID,
             case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp:
                 HandleBGMDeviceIsRunningSomewhereOtherThanBGMApp(refCon);
                 break;
+
+            case kAudioDeviceCustomPropertyDeviceAudibleState:
+                HandleBGMDeviceAudibleState(refCon);
+                break;
                 
             default:
                 // We might get properties we didn't ask for, so we just ignore them.
@@ -930,6 +1376,24 @@ void    BGMPlayThrough::HandleBGMDeviceIsRunningSomewhereOtherThanBGMApp(BGMPlay
     });
 }
 
+// static
+void    BGMPlayThrough::HandleBGMDeviceAudibleState(BGMPlayThrough* refCon)
+{
+    // This only updates a flag the input IOProc reads, so it doesn't take the state mutex, but it's
+    // dispatched anyway because it requests the property from BGMDriver.
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        if(refCon->mActive)
+        {
+            BGMLogAndSwallowExceptions("HandleBGMDeviceAudibleState", [&refCon]() {
+                refCon->mBGMDeviceIsSilent = IsSilent(refCon->mInputDevice);
+
+                DebugMsg("BGMPlayThrough::HandleBGMDeviceAudibleState: BGMDevice is %s",
+                         refCon->mBGMDeviceIsSilent ? "silent" : "audible");
+            });
+        }
+    });
+}
+
 // static
 bool    BGMPlayThrough::IsRunningSomewhereOtherThanBGMApp(const BGMAudioDevice& inBGMDevice)
 {
@@ -938,6 +1402,32 @@ bool    BGMPlayThrough::IsRunningSomewhereOtherThanBGMApp(const BGMAudioDevice&
             inBGMDevice.GetPropertyData_CFType(kBGMRunningSomewhereOtherThanBGMAppAddress)));
 }
 
+// static
+bool    BGMPlayThrough::IsSilent(const BGMAudioDevice& inBGMDevice)
+{
+    CFTypeRef propertyDataRef = inBGMDevice.GetPropertyData_CFType(kBGMAudibleStateAddress);
+
+    ThrowIfNULL(propertyDataRef,
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGMPlayThrough::IsSilent: !propertyDataRef");
+
+    ThrowIf(CFGetTypeID(propertyDataRef) != CFNumberGetTypeID(),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMPlayThrough::IsSilent: Property was not a CFNumber");
+
+    BGMDeviceAudibleState audibleState;
+    Boolean success = CFNumberGetValue(static_cast<CFNumberRef>(propertyDataRef),
+                                       kCFNumberSInt32Type,
+                                       &audibleState);
+    CFRelease(propertyDataRef);
+
+    ThrowIf(!success,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMPlayThrough::IsSilent: CFNumberGetValue failed");
+
+    return audibleState == kBGMDeviceIsSilent;
+}
+
 #pragma mark IOProcs
 
 // Note that the IOProcs will very likely not run on the same thread and that they intentionally
@@ -998,12 +1488,26 @@ OSStatus    BGMPlayThrough::InputDeviceIOProc(AudioObjectID           inDevice,
         refCon->mRTLogger.LogIfRingBufferError_Store(err);
 
         refCon->mLastInputSampleTime = inInputTime->mSampleTime;
+
+        // Copy the audio for BGMRecorder. This is just a memcpy. The recorder encodes and writes
+        // it on its own thread. (The thread safety analysis can't tell that tryer holds
+        // mBufferInputMutex here.)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wthread-safety"
+        if(refCon->mRecorderTap)
+        {
+            refCon->mRecorderTap->WriteRT(static_cast<const Float32*>(inInputData->mBuffers[0].mData),
+                                          framesToStore);
+        }
+#pragma clang diagnostic pop
     }
     else
     {
         refCon->mRTLogger.LogRingBufferUnavailable("InputDeviceIOProc", tryer.HasLock());
     }
 
+    refCon->UpdateIdleSuspendRT(inInputData, framesToStore, inInputTime->mSampleTime);
+
     return noErr;
 }
 
@@ -1065,6 +1569,9 @@ OSStatus    BGMPlayThrough::OutputDeviceIOProc(AudioObjectID           inDevice,
         // Log if we dropped frames
         refCon->mRTLogger.LogIfDroppedFrames(refCon->mFirstInputSampleTime,
                                              refCon->mLastInputSampleTime);
+
+        // Start converting from the latest input.
+        refCon->mConverterReadSampleTime = -1;
     }
     
     CARingBuffer::SampleTime readHeadSampleTime =
@@ -1092,7 +1599,12 @@ OSStatus    BGMPlayThrough::OutputDeviceIOProc(AudioObjectID           inDevice,
     // in a given IO cycle, so it's safe for them to read and write at the same time.
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wthread-safety"
-    if(tryer.HasLock() && refCon->mBuffer)
+    if(tryer.HasLock() && refCon->mBuffer && !refCon->mConverter.IsPassthrough())
+    {
+        // The devices are running at different sample rates.
+        refCon->FetchConvertedRT(outOutputData, framesToOutput, lastInputSampleTime);
+    }
+    else if(tryer.HasLock() && refCon->mBuffer)
     {
         // Very occasionally (at least for me) our read head gets ahead of input, i.e. we haven't
         // received any new input since this IOProc was last called, and we have to recalculate its
@@ -1148,6 +1660,97 @@ OSStatus    BGMPlayThrough::OutputDeviceIOProc(AudioObjectID           inDevice,
     return noErr;
 }
 
+void    BGMPlayThrough::FetchConvertedRT(AudioBufferList* outOutputData,
+                                         UInt32 inFrames,
+                                         CARingBuffer::SampleTime inLastInputSampleTime)
+{
+    UInt32 inputFrames = mConverter.GetInputFramesRequired(inFrames);
+    const UInt32 maxInputFrames = static_cast<UInt32>(mConverterInput.size() / mConverter.GetChannels());
+
+    if(inputFrames > maxInputFrames)
+    {
+        // The HAL gave us more frames to fill than ConfigureSampleRateConverter allowed for.
+        mRTLogger.LogIfRingBufferError_Fetch(kCARingBufferError_TooMuch);
+        FillWithSilence(outOutputData);
+        return;
+    }
+
+    // The ring buffer is only accessed while the caller holds mBufferOutputMutex. See
+    // OutputDeviceIOProc.
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wthread-safety"
+    SInt64 bufferStartTime, bufferEndTime;
+    CARingBufferError err = mBuffer->GetTimeBounds(bufferStartTime, bufferEndTime);
+
+    if(err != kCARingBufferError_OK)
+    {
+        mRTLogger.LogIfRingBufferError_Fetch(err);
+        FillWithSilence(outOutputData);
+        return;
+    }
+
+    // The converter reads the input continuously, so it only needs to skip or repeat frames if the
+    // read head gets too close to (or too far from) the input. Like the unconverted path, that
+    // mostly happens because of clock drift or because a device's sample times were restarted.
+    //
+    // Because the devices' IO cycles aren't the same length, the amount of unread input goes up
+    // and down by about a cycle of each device. So, unlike the unconverted path, we keep
+    // mConverterSlackFrames of input in reserve.
+    CARingBuffer::SampleTime readHeadSampleTime =
+        static_cast<CARingBuffer::SampleTime>(mConverterReadSampleTime);
+    const SInt64 unreadFrames = bufferEndTime - (readHeadSampleTime + inputFrames);
+
+    if(mConverterReadSampleTime == -1 ||
+       readHeadSampleTime < bufferStartTime ||
+       unreadFrames < 0 ||
+       unreadFrames > 3 * static_cast<SInt64>(mConverterSlackFrames))
+    {
+        if(mConverterReadSampleTime != -1)
+        {
+            mRTLogger.LogNoSamplesReady(inLastInputSampleTime,
+                                        readHeadSampleTime,
+                                        mInToOutSampleOffset);
+        }
+
+        mConverter.Reset();
+        inputFrames = mConverter.GetInputFramesRequired(inFrames);
+        readHeadSampleTime = bufferEndTime - inputFrames - mConverterSlackFrames;
+
+        if(readHeadSampleTime < bufferStartTime)
+        {
+            // Wait until enough input has been stored. Usually this means playthrough just started.
+            mConverterReadSampleTime = -1;
+            FillWithSilence(outOutputData);
+            return;
+        }
+    }
+
+    AudioBufferList inputBufferList;
+    inputBufferList.mNumberBuffers = 1;
+    inputBufferList.mBuffers[0].mNumberChannels = mConverter.GetChannels();
+    inputBufferList.mBuffers[0].mDataByteSize =
+        inputFrames * mConverter.GetChannels() * SizeOf32(Float32);
+    inputBufferList.mBuffers[0].mData = mConverterInput.data();
+
+    err = mBuffer->Fetch(&inputBufferList, inputFrames, readHeadSampleTime);
+#pragma clang diagnostic pop
+    mRTLogger.LogIfRingBufferError_Fetch(err);
+
+    if(err != kCARingBufferError_OK)
+    {
+        mConverterReadSampleTime = -1;
+        FillWithSilence(outOutputData);
+        return;
+    }
+
+    mConverter.Process(mConverterInput.data(),
+                       inputFrames,
+                       static_cast<Float32*>(outOutputData->mBuffers[0].mData),
+                       inFrames);
+
+    mConverterReadSampleTime = readHeadSampleTime + inputFrames;
+}
+
 // static
 inline void BGMPlayThrough::FillWithSilence(AudioBufferList* ioBuffer)
 {
@@ -27,6 +27,15 @@
 //  (https://github.com/mattingalls/Soundflower/blob/master/SoundflowerBed/AudioThruEngine.h) that seems to be based on Apple
 //  sample code from 2004. This class's main addition is pausing playthrough when idle to save CPU.
 //
+//  Playthrough is stopped completely when no other clients are doing IO on BGMDevice. When clients are doing IO, but
+//  only sending silence, e.g. a browser with a paused video, we stop the output device's IOProc after a while, which
+//  lets the output device stop. The input IOProc keeps running and starts the output IOProc again as soon as it reads
+//  any audio. See SetIdleSuspendDelay.
+//
+//  Normally BGMDevice's sample rate is set to match the output device's, so changing to an output device with a different
+//  rate makes BGMDevice restart IO for all of its clients. SetFixedInputSampleRate keeps BGMDevice at one rate instead and
+//  the output IOProc converts the audio to the output device's rate with a BGMSampleRateConverter.
+//
 //  Playing audio with this class uses more CPU, mostly in the coreaudiod process, than playing audio normally because we need
 //  an input IOProc as well as an output one, and BGMDriver is running in addition to the output device's driver. For me, it
 //  usually adds around 1-2% (as a percentage of total usage -- it doesn't seem to be relative to the CPU used when playing
@@ -42,6 +51,8 @@
 // Local Includes
 #include "BGMAudioDevice.h"
 #include "BGMPlayThroughRTLogger.h"
+#include "BGMRecorderTap.h"
+#include "BGMSampleRateConverter.h"
 
 // PublicUtility Includes
 #include "CAMutex.h"
@@ -52,6 +63,8 @@
 #include <atomic>
 #include <algorithm>
 #include <memory>
+#include <thread>
+#include <vector>
 
 // System Includes
 #include <mach/semaphore.h>
@@ -66,6 +79,9 @@ public:
     // Error codes
     static const OSStatus kDeviceNotStarting = 100;
 
+    // The default for SetIdleSuspendDelay.
+    static constexpr Float64 kIdleSuspendDelaySecondsDefault = 10.0;
+
 public:
                         BGMPlayThrough(BGMAudioDevice inInputDevice, BGMAudioDevice inOutputDevice);
                         ~BGMPlayThrough();
@@ -126,6 +142,71 @@ private:
 public:
     OSStatus            Stop();
     void                StopIfIdle();
+
+    /*!
+     Set the tap the input IOProc should copy the audio it reads from the input device into, e.g.
+     for BGMRecorder. Pass null to remove the tap. The IOProc won't access the old tap after this
+     returns, so it can be destroyed. The tap has to accept the input device's format, which is
+     interleaved stereo Float32 for BGMDevice.
+     */
+    void                SetRecorderTap(BGMRecorderTap* __nullable inTap);
+
+private:
+    bool                HasRecorderTap();
+
+public:
+    /*!
+     Set how long BGMDevice has to be silent for, while playthrough is running, before the output
+     IOProc is suspended to save CPU. It's only suspended while BGMDevice's
+     kAudioDeviceCustomPropertyDeviceAudibleState is kBGMDeviceIsSilent, and it's resumed as soon as
+     the input IOProc reads any audio. Pass 0 to never suspend it.
+     */
+    void                SetIdleSuspendDelay(Float64 inSeconds);
+    /*! True while the output IOProc is suspended because BGMDevice has been silent. */
+    bool                IsOutputSuspendedForIdle() const noexcept { return mOutputSuspendedForIdle; }
+
+    /*!
+     Keep the input device (BGMDevice) at inSampleRate, instead of changing it to match the output
+     device's sample rate, and convert the audio to the output device's rate if they're different.
+     Pass 0 to go back to matching the output device. Takes effect immediately if playthrough is
+     active.
+
+     @throws CAException
+     */
+    void                SetFixedInputSampleRate(Float64 inSampleRate);
+
+private:
+    /*!
+     Set up mConverter for the devices' current sample rates. Not real-time safe. Called before
+     starting the IOProcs.
+     */
+    void                ConfigureSampleRateConverter() REQUIRES(mStateMutex);
+    /*!
+     Called by the output IOProc instead of fetching from the ring buffer directly when the devices'
+     sample rates are different. Fetches the input frames needed to fill outOutputData and converts
+     them to the output device's sample rate. Real-time safe.
+     */
+    void                FetchConvertedRT(AudioBufferList* outOutputData,
+                                         UInt32 inFrames,
+                                         CARingBuffer::SampleTime inLastInputSampleTime)
+                            REQUIRES(mBufferOutputMutex);
+
+    /*! Called by the input IOProc each cycle to suspend or resume the output IOProc. Real-time safe. */
+    void                UpdateIdleSuspendRT(const AudioBufferList* inInputData,
+                                            UInt32 inFrames,
+                                            Float64 inSampleTime);
+    /*! Start the output IOProc again if it's been suspended. */
+    void                ResumeOutputAfterIdle() REQUIRES(mStateMutex);
+    /*! Update mIdleSuspendDelayFrames for the input device's current sample rate. */
+    void                UpdateIdleSuspendDelayFrames() REQUIRES(mStateMutex);
+    /*! Wakes the idle resume thread. Real-time safe. */
+    void                RequestResumeAfterIdle();
+    /*! Stop the idle resume thread. Its semaphore is destroyed separately, in the destructor. */
+    void                DestroyIdleResumeThread();
+
+    static void         IdleResumeThreadEntry(BGMPlayThrough* inRefCon);
+    /*! True if every sample in the buffer list is (practically) silent. Real-time safe. */
+    static bool         IsBufferSilent(const AudioBufferList* inBufferList) noexcept;
     
 private:
     
@@ -135,8 +216,10 @@ private:
                                               void* __nullable inClientData);
     static void         HandleBGMDeviceIsRunning(BGMPlayThrough* refCon);
     static void         HandleBGMDeviceIsRunningSomewhereOtherThanBGMApp(BGMPlayThrough* refCon);
+    static void         HandleBGMDeviceAudibleState(BGMPlayThrough* refCon);
     
     static bool         IsRunningSomewhereOtherThanBGMApp(const BGMAudioDevice& inBGMDevice);
+    static bool         IsSilent(const BGMAudioDevice& inBGMDevice);
 
     static OSStatus     InputDeviceIOProc(AudioObjectID           inDevice,
                                           const AudioTimeStamp*   inNow,
@@ -175,6 +258,9 @@ private:
 private:
     std::unique_ptr<CARingBuffer>    mBuffer PT_GUARDED_BY(mBufferInputMutex)
                                         PT_GUARDED_BY(mBufferOutputMutex) { nullptr };
+
+    // Not owned by this object. Only used by the input IOProc.
+    BGMRecorderTap* __nullable mRecorderTap GUARDED_BY(mBufferInputMutex) { nullptr };
     
     AudioDeviceIOProcID __nullable mInputDeviceIOProcID { nullptr };
     AudioDeviceIOProcID __nullable mOutputDeviceIOProcID { nullptr };
@@ -218,6 +304,36 @@ private:
     // For debug logging.
     UInt64              mToldOutputDeviceToStartAt { 0 };
 
+    // Idle suspension. See SetIdleSuspendDelay.
+    Float64             mIdleSuspendDelaySeconds GUARDED_BY(mStateMutex) { kIdleSuspendDelaySecondsDefault };
+    // mIdleSuspendDelaySeconds converted to frames at the input device's sample rate, for the input
+    // IOProc. Zero if disabled.
+    std::atomic<Float64> mIdleSuspendDelayFrames { 0.0 };
+    // True if BGMDevice's audible state is kBGMDeviceIsSilent.
+    std::atomic<bool>   mBGMDeviceIsSilent { false };
+    // Set by the input IOProc when it suspends the output IOProc and cleared when it's resumed.
+    std::atomic<bool>   mOutputSuspendedForIdle { false };
+    // So the input IOProc only wakes the resume thread once per suspension.
+    std::atomic<bool>   mResumeAfterIdleRequested { false };
+    // A thread that waits to start the output IOProc again, so the input IOProc can start it without
+    // dispatching (which isn't real-time safe) and without waiting for a new thread.
+    std::thread         mIdleResumeThread;
+    semaphore_t         mIdleResumeSemaphore { SEMAPHORE_NULL };
+    std::atomic<bool>   mIdleResumeThreadShouldExit { false };
+    // For debug logging.
+    UInt64              mSuspendedForIdleAt { 0 };
+
+    // The sample rate the input device is kept at. 0 if it should match the output device.
+    Float64             mFixedInputSampleRate GUARDED_BY(mStateMutex) { 0.0 };
+    // Converts from the input device's sample rate to the output device's. A passthrough if they're
+    // the same.
+    BGMSampleRateConverter mConverter GUARDED_BY(mBufferOutputMutex) { 2 };
+    // The interleaved input frames fetched from the ring buffer for mConverter.
+    std::vector<Float32> mConverterInput GUARDED_BY(mBufferOutputMutex);
+    // How many frames of input the output IOProc keeps unread when converting, in case the next
+    // input IO cycle is late relative to the next output IO cycle.
+    UInt32              mConverterSlackFrames GUARDED_BY(mBufferOutputMutex) { 0 };
+
     // IOProc vars. (Should only be used inside IOProcs.)
     
     // The earliest/latest sample times seen by the IOProcs since starting playthrough. -1 for unset.
@@ -228,6 +344,14 @@ private:
     // Subtract this from the output time to get the input time.
     Float64             mInToOutSampleOffset { 0.0 };
 
+    // The input sample time of the next frame the output IOProc will pass to mConverter. -1 if it
+    // needs to be recalculated.
+    Float64             mConverterReadSampleTime = -1;
+
+    // The sample time of the first frame of the silence the input IOProc is currently reading. -1
+    // if it's reading audio.
+    Float64             mInputSilentSinceSampleTime = -1;
+
     BGMPlayThroughRTLogger mRTLogger;
 
 };
@@ -355,10 +355,16 @@ NSString* const kAudioSystemSettingsPlist =
 
             BGM_Utils::LogAndSwallowExceptions(BGMDbgArgs, [&] {
                 // Skip devices we can't use, e.g. BGMDevice.
-                if (BGMAudioDevice(devices[i]).CanBeOutputDeviceInBGMApp()) {
+                //
+                // This loop checks each device once per preferred device, so these read the
+                // devices' properties through BGMAudioPropertyCache instead of asking the HAL
+                // every time.
+                BGMAudioDevice connectedDevice(devices[i]);
+
+                if (connectedDevice.CanBeOutputDeviceInBGMApp()) {
                     // Get the connected device's UID.
                     connectedDeviceUID =
-                        (__bridge NSString* __nullable)CAHALAudioDevice(devices[i]).CopyDeviceUID();
+                        (__bridge_transfer NSString* __nullable)connectedDevice.CopyCachedDeviceUID();
                 }
             });
 
@@ -0,0 +1,275 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMRecorder.cpp
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMRecorder.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+#include "CADebugMacros.h"
+
+// STL Includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <limits>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+#include <unistd.h>
+
+
+#pragma clang assume_nonnull begin
+
+// The most frames the worker thread encodes at a time.
+static const UInt32 kMaxFramesPerRead = 4096;
+
+static UInt64 MaxFramesPerFile(const BGMRecorder::Settings& inSettings, const BGMRecordingFormat& inFormat)
+{
+    UInt64 theMaxFrames = std::numeric_limits<UInt64>::max();
+
+    if(inSettings.mMaxFileBytes > 0)
+    {
+        // Always allow at least one frame, so a tiny limit can't stop us from recording anything.
+        const UInt64 theHeaderBytes = inFormat.GetHeaderSize();
+        const UInt64 theDataBytes =
+                (inSettings.mMaxFileBytes > theHeaderBytes) ? (inSettings.mMaxFileBytes - theHeaderBytes) : 0;
+        theMaxFrames = std::max<UInt64>(1, theDataBytes / inFormat.GetBytesPerFrame());
+    }
+
+    if(inSettings.mMaxFileSeconds > 0)
+    {
+        const UInt64 theFrames =
+                static_cast<UInt64>(llround(inSettings.mMaxFileSeconds * inFormat.GetSampleRate()));
+        theMaxFrames = std::min(theMaxFrames, std::max<UInt64>(1, theFrames));
+    }
+
+    return theMaxFrames;
+}
+
+#pragma mark Construction/Destruction
+
+BGMRecorder::BGMRecorder(const Settings& inSettings, Float64 inSampleRate, UInt32 inChannels)
+:
+    mSettings(inSettings),
+    mFormat(inSettings.mContainer, inSettings.mSampleFormat, inSampleRate, inChannels),
+    mMaxFramesPerFile(MaxFramesPerFile(inSettings, mFormat)),
+    mTap(inChannels, static_cast<UInt32>(std::min(inSampleRate * kTapSeconds, 16777216.0))),
+    mReadBuffer(static_cast<size_t>(kMaxFramesPerRead) * inChannels)
+{
+    ThrowIf(inSettings.mDirectory.empty(),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMRecorder::BGMRecorder: No directory");
+}
+
+BGMRecorder::~BGMRecorder()
+{
+    Stop();
+}
+
+#pragma mark Starting/Stopping
+
+void    BGMRecorder::Start()
+{
+    ThrowIf(mRunning,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMRecorder::Start: Already recording");
+
+    mStopRequested = false;
+    mFailed = false;
+
+    // Create the first file now, rather than on the worker thread, so the caller finds out if it
+    // can't be created.
+    StartNextFile();
+
+    mWorker = std::thread(&BGMRecorder::WorkerMain, this);
+    mRunning = true;
+
+    DebugMsg("BGMRecorder::Start: Recording to %s", mSettings.mDirectory.c_str());
+}
+
+void    BGMRecorder::Stop()
+{
+    if(!mRunning)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> theLock(mMutex);
+        mStopRequested = true;
+    }
+
+    mStopCondition.notify_all();
+    mWorker.join();
+    mRunning = false;
+
+    DebugMsg("BGMRecorder::Stop: Recorded %llu frames",
+             static_cast<unsigned long long>(mFramesRecorded.load()));
+}
+
+std::vector<std::string>    BGMRecorder::GetFilePaths() const
+{
+    std::lock_guard<std::mutex> theLock(mMutex);
+    return mFilePaths;
+}
+
+#pragma mark Worker Thread
+
+void    BGMRecorder::WorkerMain()
+{
+    bool theStopRequested = false;
+
+    while(!theStopRequested && !mFailed)
+    {
+        {
+            std::unique_lock<std::mutex> theLock(mMutex);
+            theStopRequested = mStopCondition.wait_for(theLock,
+                                                       std::chrono::milliseconds(kWorkerIntervalMS),
+                                                       [&] { return mStopRequested; });
+        }
+
+        try
+        {
+            // When we've been asked to stop, this writes the last of the audio.
+            DrainTap();
+        }
+        catch(const CAException& e)
+        {
+            LogError("BGMRecorder::WorkerMain: Recording failed (%d)", e.GetError());
+            mFailed = true;
+        }
+    }
+
+    try
+    {
+        if(mFile)
+        {
+            mFile->Close();
+        }
+    }
+    catch(const CAException& e)
+    {
+        LogError("BGMRecorder::WorkerMain: Failed to close the file (%d)", e.GetError());
+        mFailed = true;
+    }
+
+    mFile.reset();
+}
+
+void    BGMRecorder::DrainTap()
+{
+    UInt32 theFramesRead;
+
+    do
+    {
+        theFramesRead = mTap.Read(mReadBuffer.data(), kMaxFramesPerRead);
+
+        if(theFramesRead > 0)
+        {
+            WriteFrames(mReadBuffer.data(), theFramesRead);
+        }
+    }
+    while(theFramesRead == kMaxFramesPerRead);
+
+    const UInt64 theDroppedFrames = mTap.GetDroppedFrames();
+
+    if(theDroppedFrames != mLastDroppedFrames)
+    {
+        LogWarning("BGMRecorder::DrainTap: The tap overflowed. %llu frames dropped.",
+                   static_cast<unsigned long long>(theDroppedFrames - mLastDroppedFrames));
+        mLastDroppedFrames = theDroppedFrames;
+    }
+}
+
+void    BGMRecorder::WriteFrames(const Float32* inFrames, UInt32 inFrameCount)
+{
+    while(inFrameCount > 0)
+    {
+        UInt64 theRoomInFile = 0;
+
+        if(mFile)
+        {
+            theRoomInFile = std::min(mMaxFramesPerFile - std::min(mMaxFramesPerFile, mFile->GetFramesWritten()),
+                                     mFile->GetRemainingFrameCapacity());
+        }
+
+        if(theRoomInFile == 0)
+        {
+            // Only rotate when there's audio for the next file, so we don't leave an empty file at
+            // the end of the recording.
+            StartNextFile();
+            continue;
+        }
+
+        const UInt32 theFramesToWrite = static_cast<UInt32>(std::min<UInt64>(inFrameCount, theRoomInFile));
+
+        mFile->WriteFrames(inFrames, theFramesToWrite);
+        mFramesRecorded += theFramesToWrite;
+
+        inFrames += static_cast<size_t>(theFramesToWrite) * mFormat.GetChannels();
+        inFrameCount -= theFramesToWrite;
+    }
+}
+
+void    BGMRecorder::StartNextFile()
+{
+    if(mFile)
+    {
+        mFile->Close();
+        mFile.reset();
+    }
+
+    const std::string thePath = GetNextFilePath();
+    mFile.reset(new BGMRecordingFile(thePath, mFormat));
+
+    std::lock_guard<std::mutex> theLock(mMutex);
+    mFilePaths.push_back(thePath);
+}
+
+std::string BGMRecorder::GetNextFilePath() const
+{
+    char theTimestamp[32];
+    const time_t theTime = time(nullptr);
+    struct tm theLocalTime;
+    localtime_r(&theTime, &theLocalTime);
+    strftime(theTimestamp, sizeof(theTimestamp), "%Y-%m-%d %H.%M.%S", &theLocalTime);
+
+    const std::string theBasePath =
+            mSettings.mDirectory + "/" + mSettings.mFileNamePrefix + " " + theTimestamp;
+    const std::string theExtension = std::string(".") + mFormat.GetFileExtension();
+
+    // If we've already started a file this second, e.g. because the files are very short, add a
+    // number to the name. BGMRecordingFile won't overwrite a file, so this is just to avoid failing.
+    std::string thePath = theBasePath + theExtension;
+
+    for(UInt32 theNumber = 2; access(thePath.c_str(), F_OK) == 0 && theNumber < 10000; theNumber++)
+    {
+        thePath = theBasePath + " " + std::to_string(theNumber) + theExtension;
+    }
+
+    return thePath;
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,172 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMRecorder.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Records the audio BGMApp plays through to the output device, i.e. the system mix, to a series
+//  of files.
+//
+//  BGMPlayThrough copies the audio into the recorder's tap (see BGMRecorderTap) from its input
+//  IOProc. The recorder's worker thread wakes up every few milliseconds, reads whatever is in the
+//  tap, encodes it and writes it to the current file. When the file reaches the size or length
+//  limit, the recorder closes it and continues in a new one, so recordings can run unattended for
+//  as long as there's disk space.
+//
+//  The files are named "<prefix> <date and time>.<extension>", using the time each file was
+//  started.
+//
+
+#ifndef BGMApp__BGMRecorder
+#define BGMApp__BGMRecorder
+
+// Local Includes
+#include "BGMRecorderTap.h"
+#include "BGMRecordingFile.h"
+#include "BGMRecordingFormat.h"
+
+// STL Includes
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMRecorder
+{
+
+public:
+    struct Settings
+    {
+        // The directory to create the files in. Must already exist.
+        std::string                         mDirectory;
+        std::string                         mFileNamePrefix { "Background Music" };
+        BGMRecordingFormat::Container       mContainer { BGMRecordingFormat::Container::WAV };
+        BGMRecordingFormat::SampleFormat    mSampleFormat { BGMRecordingFormat::SampleFormat::Int24 };
+        // Start a new file when the current one would grow larger than this. 0 for no limit, except
+        // for the file format's own limit. FLAC files are compressed, so for them this limits the size
+        // of the audio before it's compressed.
+        UInt64                              mMaxFileBytes = 0;
+        // Start a new file after this many seconds of audio. 0 for no limit.
+        UInt32                              mMaxFileSeconds = 0;
+    };
+
+    // The amount of audio the tap can hold, in seconds. If the worker thread can't write the audio
+    // for longer than this, e.g. because the disk is too slow, some audio will be dropped.
+    static const UInt32     kTapSeconds = 8;
+    // How often the worker thread empties the tap.
+    static const UInt32     kWorkerIntervalMS = 10;
+
+    /*!
+     @param inSampleRate The sample rate of the audio that will be written to the tap.
+     @param inChannels The number of interleaved channels in the audio that will be written to the
+                       tap.
+     @throws CAException if the settings or format are invalid.
+     */
+                            BGMRecorder(const Settings& inSettings,
+                                        Float64 inSampleRate,
+                                        UInt32 inChannels);
+    /*! Stops recording if it's still running. */
+                            ~BGMRecorder();
+                            // Disallow copying
+                            BGMRecorder(const BGMRecorder&) = delete;
+                            BGMRecorder& operator=(const BGMRecorder&) = delete;
+
+    /*! The tap to write the audio to. Writing to it before Start is called is allowed. */
+    BGMRecorderTap&         GetTap() noexcept { return mTap; }
+
+    Float64                 GetSampleRate() const noexcept { return mFormat.GetSampleRate(); }
+
+    /*!
+     Create the first file and start the worker thread.
+
+     @throws CAException if the file can't be created or recording has already been started.
+     */
+    void                    Start();
+
+    /*!
+     Write the audio still in the tap, close the current file and stop the worker thread. Blocks
+     until the worker thread has finished. Audio written to the tap after this is called might not
+     be recorded.
+
+     Does nothing if recording isn't running.
+     */
+    void                    Stop();
+
+    /*!
+     True if recording stopped because of an error, e.g. because the disk became full. Errors are
+     logged when they happen. Stop still needs to be called.
+     */
+    bool                    HasFailed() const noexcept { return mFailed; }
+
+    /*! The paths of the files created so far, in order. */
+    std::vector<std::string> GetFilePaths() const;
+
+    /*! The total number of frames written to the files so far. */
+    UInt64                  GetFramesRecorded() const noexcept { return mFramesRecorded; }
+
+private:
+    void                    WorkerMain();
+
+    /*! Write the audio in the tap to the files. @throws CAException */
+    void                    DrainTap();
+
+    /*! @throws CAException */
+    void                    WriteFrames(const Float32* inFrames, UInt32 inFrameCount);
+    /*! Close the current file, if any, and create the next one. @throws CAException */
+    void                    StartNextFile();
+    std::string             GetNextFilePath() const;
+
+    const Settings          mSettings;
+    const BGMRecordingFormat mFormat;
+    // The most frames a file is allowed to hold, based on mSettings.
+    const UInt64            mMaxFramesPerFile;
+
+    BGMRecorderTap          mTap;
+
+    // Only accessed by the worker thread while it's running.
+    std::unique_ptr<BGMRecordingFile> mFile;
+    std::vector<Float32>    mReadBuffer;
+    UInt64                  mLastDroppedFrames = 0;
+
+    std::thread             mWorker;
+    bool                    mRunning = false;
+
+    // Guards mStopRequested and mFilePaths.
+    mutable std::mutex      mMutex;
+    std::condition_variable mStopCondition;
+    bool                    mStopRequested = false;
+    std::vector<std::string> mFilePaths;
+
+    std::atomic<bool>       mFailed { false };
+    std::atomic<UInt64>     mFramesRecorded { 0 };
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMApp__BGMRecorder */
+
@@ -0,0 +1,136 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMRecorderTap.cpp
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMRecorderTap.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstring>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+
+
+#pragma clang assume_nonnull begin
+
+static UInt32 RoundUpToPowerOfTwo(UInt32 inValue)
+{
+    UInt32 thePowerOfTwo = 1;
+
+    while(thePowerOfTwo < inValue && thePowerOfTwo < (1u << 31))
+    {
+        thePowerOfTwo <<= 1;
+    }
+
+    return thePowerOfTwo;
+}
+
+BGMRecorderTap::BGMRecorderTap(UInt32 inChannels, UInt32 inCapacityFrames)
+:
+    mChannels(inChannels),
+    mCapacityFrames(RoundUpToPowerOfTwo(inCapacityFrames))
+{
+    ThrowIf(inChannels == 0 || inCapacityFrames == 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMRecorderTap::BGMRecorderTap: Invalid argument");
+
+    // Value-initialise the buffer so its pages are mapped before the IO thread first writes to it.
+    mBuffer.reset(new Float32[static_cast<size_t>(mCapacityFrames) * mChannels]());
+}
+
+UInt32  BGMRecorderTap::WriteRT(const Float32* inFrames, UInt32 inFrameCount) noexcept
+{
+    const UInt64 theWriteCount = mWriteCount.load(std::memory_order_relaxed);
+    const UInt64 theReadCount = mReadCount.load(std::memory_order_acquire);
+    const UInt32 theFreeFrames = mCapacityFrames - static_cast<UInt32>(theWriteCount - theReadCount);
+    const UInt32 theFramesToWrite = std::min(inFrameCount, theFreeFrames);
+
+    if(theFramesToWrite < inFrameCount)
+    {
+        mDroppedFrames.fetch_add(inFrameCount - theFramesToWrite, std::memory_order_relaxed);
+    }
+
+    CopyFrames(inFrames, mBuffer.get(), theWriteCount, theFramesToWrite, true);
+
+    // Publish the frames to the consumer.
+    mWriteCount.store(theWriteCount + theFramesToWrite, std::memory_order_release);
+
+    return theFramesToWrite;
+}
+
+UInt32  BGMRecorderTap::Read(Float32* outFrames, UInt32 inMaxFrames) noexcept
+{
+    const UInt64 theReadCount = mReadCount.load(std::memory_order_relaxed);
+    const UInt64 theWriteCount = mWriteCount.load(std::memory_order_acquire);
+    const UInt32 theFramesToRead = std::min(inMaxFrames, static_cast<UInt32>(theWriteCount - theReadCount));
+
+    CopyFrames(mBuffer.get(), outFrames, theReadCount, theFramesToRead, false);
+
+    // Let the producer reuse the space.
+    mReadCount.store(theReadCount + theFramesToRead, std::memory_order_release);
+
+    return theFramesToRead;
+}
+
+UInt32  BGMRecorderTap::GetReadableFrames() const noexcept
+{
+    return static_cast<UInt32>(mWriteCount.load(std::memory_order_acquire) -
+                               mReadCount.load(std::memory_order_relaxed));
+}
+
+void    BGMRecorderTap::CopyFrames(const Float32* inSource,
+                                   Float32* outDestination,
+                                   UInt64 inRingPosition,
+                                   UInt32 inFrameCount,
+                                   bool inIntoRing) const noexcept
+{
+    // Copy in up to two parts because the ring might wrap.
+    const UInt32 theRingOffset = static_cast<UInt32>(inRingPosition & (mCapacityFrames - 1));
+    const UInt32 theFirstPart = std::min(inFrameCount, mCapacityFrames - theRingOffset);
+    const size_t theBytesPerFrame = sizeof(Float32) * mChannels;
+
+    if(inIntoRing)
+    {
+        memcpy(outDestination + (static_cast<size_t>(theRingOffset) * mChannels),
+               inSource,
+               theFirstPart * theBytesPerFrame);
+        memcpy(outDestination,
+               inSource + (static_cast<size_t>(theFirstPart) * mChannels),
+               (inFrameCount - theFirstPart) * theBytesPerFrame);
+    }
+    else
+    {
+        memcpy(outDestination,
+               inSource + (static_cast<size_t>(theRingOffset) * mChannels),
+               theFirstPart * theBytesPerFrame);
+        memcpy(outDestination + (static_cast<size_t>(theFirstPart) * mChannels),
+               inSource,
+               (inFrameCount - theFirstPart) * theBytesPerFrame);
+    }
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,107 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMRecorderTap.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  A lock-free, single-producer/single-consumer FIFO of interleaved Float32 frames. BGMPlayThrough's
+//  input IOProc writes the audio it receives from BGMDevice into one of these and BGMRecorder's
+//  worker thread reads it out to encode it.
+//
+//  WriteRT only copies the frames and updates an atomic counter, so it's safe to call on an IO
+//  thread. If the FIFO is full, it drops the frames that don't fit rather than waiting. The
+//  dropped frames are counted so the recorder can log them.
+//
+
+#ifndef BGMApp__BGMRecorderTap
+#define BGMApp__BGMRecorderTap
+
+// STL Includes
+#include <atomic>
+#include <memory>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMRecorderTap
+{
+
+public:
+    /*!
+     @param inChannels The number of interleaved channels in each frame.
+     @param inCapacityFrames The minimum number of frames the FIFO can hold. Rounded up to a power
+                             of two.
+     @throws CAException if either argument is 0.
+     */
+                        BGMRecorderTap(UInt32 inChannels, UInt32 inCapacityFrames);
+                        ~BGMRecorderTap() = default;
+                        // Disallow copying
+                        BGMRecorderTap(const BGMRecorderTap&) = delete;
+                        BGMRecorderTap& operator=(const BGMRecorderTap&) = delete;
+
+    UInt32              GetChannels() const noexcept { return mChannels; }
+    UInt32              GetCapacityFrames() const noexcept { return mCapacityFrames; }
+
+    /*!
+     Copy some frames into the FIFO. Real-time safe. Must only be called by one thread at a time.
+
+     @return The number of frames copied. Less than inFrameCount if the FIFO was full.
+     */
+    UInt32              WriteRT(const Float32* inFrames, UInt32 inFrameCount) noexcept;
+
+    /*!
+     Copy up to inMaxFrames frames out of the FIFO. Must only be called by one thread at a time.
+
+     @return The number of frames copied.
+     */
+    UInt32              Read(Float32* outFrames, UInt32 inMaxFrames) noexcept;
+
+    /*! The number of frames that can currently be read. */
+    UInt32              GetReadableFrames() const noexcept;
+
+    /*! The total number of frames WriteRT has dropped because the FIFO was full. */
+    UInt64              GetDroppedFrames() const noexcept
+                            { return mDroppedFrames.load(std::memory_order_relaxed); }
+
+private:
+    void                CopyFrames(const Float32* inSource,
+                                   Float32* outDestination,
+                                   UInt64 inRingPosition,
+                                   UInt32 inFrameCount,
+                                   bool inIntoRing) const noexcept;
+
+    const UInt32                mChannels;
+    const UInt32                mCapacityFrames;
+    std::unique_ptr<Float32[]>  mBuffer;
+
+    // The total number of frames written and read. The ring positions are these modulo
+    // mCapacityFrames. Only the producer writes mWriteCount and only the consumer writes
+    // mReadCount.
+    std::atomic<UInt64>         mWriteCount { 0 };
+    std::atomic<UInt64>         mReadCount { 0 };
+    std::atomic<UInt64>         mDroppedFrames { 0 };
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMApp__BGMRecorderTap */
+
@@ -0,0 +1,371 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMRecordingFile.cpp
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMRecordingFile.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+#include "CADebugMacros.h"
+
+// STL Includes
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+// System Includes
+#include <AudioToolbox/AudioFormat.h>
+#include <CoreAudio/AudioHardwareBase.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+#pragma clang assume_nonnull begin
+
+// The alignment of the write buffer. A page, so the kernel can transfer it without copying.
+static const size_t kBufferAlignment = 4096;
+
+// Logs the current errno value and throws it in a CAException.
+static void ThrowErrno(const char* inMessage, const std::string& inPath)
+{
+    const int theError = errno;
+    LogError("%s: %s (%d) %s", inMessage, strerror(theError), theError, inPath.c_str());
+    throw CAException(theError);
+}
+
+#pragma mark Construction/Destruction
+
+BGMRecordingFile::BGMRecordingFile(const std::string& inPath, const BGMRecordingFormat& inFormat)
+:
+    mPath(inPath),
+    mFormat(inFormat)
+{
+    if(mFormat.GetContainer() == BGMRecordingFormat::Container::FLAC)
+    {
+        CreateFLACFile();
+        return;
+    }
+
+    void* theBuffer = nullptr;
+
+    ThrowIf(posix_memalign(&theBuffer, kBufferAlignment, kBufferBytes) != 0 || theBuffer == nullptr,
+            CAException(kAudioHardwareUnspecifiedError),
+            "BGMRecordingFile::BGMRecordingFile: Failed to allocate the write buffer");
+
+    mBuffer = static_cast<UInt8*>(theBuffer);
+
+    // O_EXCL so we never overwrite an earlier recording.
+    mFD = open(inPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+
+    if(mFD == -1)
+    {
+        free(mBuffer);
+        mBuffer = nullptr;
+        ThrowErrno("BGMRecordingFile::BGMRecordingFile: Failed to create file", inPath);
+    }
+
+#ifdef F_NOCACHE
+    // Not a reason to fail, since it only affects performance.
+    if(fcntl(mFD, F_NOCACHE, 1) == -1)
+    {
+        LogWarning("BGMRecordingFile::BGMRecordingFile: F_NOCACHE failed: %s", strerror(errno));
+    }
+#endif
+
+    // Start with a provisional header, which Close replaces, so the file is still valid if it never
+    // gets closed.
+    mFormat.WriteHeader(mBuffer, 0, false);
+    mBufferedBytes = mFormat.GetHeaderSize();
+}
+
+void    BGMRecordingFile::CreateFLACFile()
+{
+    // Create the file ourselves first, with O_EXCL, so we never overwrite an earlier recording.
+    // ExtAudioFile then replaces the empty file.
+    const int theFD = open(mPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+
+    if(theFD == -1)
+    {
+        ThrowErrno("BGMRecordingFile::CreateFLACFile: Failed to create file", mPath);
+    }
+
+    close(theFD);
+
+    AudioStreamBasicDescription theFileFormat = {};
+    theFileFormat.mFormatID = kAudioFormatFLAC;
+    theFileFormat.mSampleRate = mFormat.GetSampleRate();
+    theFileFormat.mChannelsPerFrame = mFormat.GetChannels();
+    // FLAC uses the same flags as Apple Lossless for the bit depth of the source data.
+    theFileFormat.mFormatFlags = (mFormat.GetSampleFormat() == BGMRecordingFormat::SampleFormat::Int16) ?
+                                 kAppleLosslessFormatFlag_16BitSourceData :
+                                 kAppleLosslessFormatFlag_24BitSourceData;
+
+    // The format we give ExtAudioFile the frames in.
+    const UInt32 theBytesPerFrame = mFormat.GetChannels() * static_cast<UInt32>(sizeof(Float32));
+    AudioStreamBasicDescription theClientFormat = {};
+    theClientFormat.mFormatID = kAudioFormatLinearPCM;
+    theClientFormat.mFormatFlags = kAudioFormatFlagsNativeFloatPacked;
+    theClientFormat.mSampleRate = mFormat.GetSampleRate();
+    theClientFormat.mChannelsPerFrame = mFormat.GetChannels();
+    theClientFormat.mBitsPerChannel = 32;
+    theClientFormat.mFramesPerPacket = 1;
+    theClientFormat.mBytesPerFrame = theBytesPerFrame;
+    theClientFormat.mBytesPerPacket = theBytesPerFrame;
+
+    CFURLRef theURL = CFURLCreateFromFileSystemRepresentation(kCFAllocatorDefault,
+                                                              reinterpret_cast<const UInt8*>(mPath.c_str()),
+                                                              static_cast<CFIndex>(mPath.size()),
+                                                              false);
+    OSStatus theError = kAudioHardwareUnspecifiedError;
+
+    if(theURL != nullptr)
+    {
+        // Let AudioToolbox fill in the rest of the file's format, e.g. the frames per packet.
+        UInt32 theFormatSize = sizeof(theFileFormat);
+        theError = AudioFormatGetProperty(kAudioFormatProperty_FormatInfo,
+                                          0,
+                                          nullptr,
+                                          &theFormatSize,
+                                          &theFileFormat);
+
+        if(theError == noErr)
+        {
+            theError = ExtAudioFileCreateWithURL(theURL,
+                                                 kAudioFileFLACType,
+                                                 &theFileFormat,
+                                                 nullptr,
+                                                 kAudioFileFlags_EraseFile,
+                                                 &mExtAudioFile);
+        }
+
+        CFRelease(theURL);
+    }
+
+    if(theError == noErr)
+    {
+        theError = ExtAudioFileSetProperty(mExtAudioFile,
+                                           kExtAudioFileProperty_ClientDataFormat,
+                                           sizeof(theClientFormat),
+                                           &theClientFormat);
+    }
+
+    if(theError != noErr)
+    {
+        LogError("BGMRecordingFile::CreateFLACFile: Failed to create %s (%d)",
+                 mPath.c_str(),
+                 static_cast<int>(theError));
+
+        if(mExtAudioFile != nullptr)
+        {
+            ExtAudioFileDispose(mExtAudioFile);
+            mExtAudioFile = nullptr;
+        }
+
+        // Don't leave the empty file behind.
+        unlink(mPath.c_str());
+        throw CAException(theError);
+    }
+}
+
+BGMRecordingFile::~BGMRecordingFile()
+{
+    try
+    {
+        Close();
+    }
+    catch(const CAException& e)
+    {
+        LogError("BGMRecordingFile::~BGMRecordingFile: Failed to close %s (%d)",
+                 mPath.c_str(),
+                 e.GetError());
+    }
+
+    free(mBuffer);
+}
+
+#pragma mark Accessors
+
+UInt64  BGMRecordingFile::GetFileBytes() const noexcept
+{
+    const UInt64 theDataBytes = mFramesWritten * mFormat.GetBytesPerFrame();
+    return mFormat.GetHeaderSize() + theDataBytes + mFormat.GetPaddingBytes(theDataBytes);
+}
+
+UInt64  BGMRecordingFile::GetRemainingFrameCapacity() const noexcept
+{
+    const UInt64 theMaxFrames = mFormat.GetMaxDataBytes() / mFormat.GetBytesPerFrame();
+    return theMaxFrames - std::min(theMaxFrames, mFramesWritten);
+}
+
+#pragma mark Writing
+
+void    BGMRecordingFile::WriteFrames(const Float32* inFrames, UInt32 inFrameCount)
+{
+    ThrowIf(!IsOpen(),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMRecordingFile::WriteFrames: File closed");
+    ThrowIf(inFrameCount > GetRemainingFrameCapacity(),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMRecordingFile::WriteFrames: File full");
+
+    if(mExtAudioFile != nullptr)
+    {
+        AudioBufferList theBufferList;
+        theBufferList.mNumberBuffers = 1;
+        theBufferList.mBuffers[0].mNumberChannels = mFormat.GetChannels();
+        theBufferList.mBuffers[0].mDataByteSize =
+                inFrameCount * mFormat.GetChannels() * static_cast<UInt32>(sizeof(Float32));
+        // ExtAudioFileWrite doesn't modify the buffer.
+        theBufferList.mBuffers[0].mData = const_cast<Float32*>(inFrames);
+
+        const OSStatus theError = ExtAudioFileWrite(mExtAudioFile, inFrameCount, &theBufferList);
+        ThrowIfError(theError, CAException(theError), "BGMRecordingFile::WriteFrames: ExtAudioFileWrite failed");
+
+        mFramesWritten += inFrameCount;
+        return;
+    }
+
+    const UInt32 theBytesPerFrame = mFormat.GetBytesPerFrame();
+    UInt32 theFramesLeft = inFrameCount;
+
+    while(theFramesLeft > 0)
+    {
+        UInt32 theFramesThatFit = (kBufferBytes - mBufferedBytes) / theBytesPerFrame;
+
+        if(theFramesThatFit == 0)
+        {
+            FlushBuffer();
+            theFramesThatFit = kBufferBytes / theBytesPerFrame;
+
+            // The buffer is much bigger than the largest frame any format can have.
+            ThrowIf(theFramesThatFit == 0,
+                    CAException(kAudioHardwareIllegalOperationError),
+                    "BGMRecordingFile::WriteFrames: Frames too large");
+        }
+
+        const UInt32 theFramesToEncode = std::min(theFramesLeft, theFramesThatFit);
+
+        mFormat.Encode(inFrames, theFramesToEncode, mBuffer + mBufferedBytes);
+
+        mBufferedBytes += theFramesToEncode * theBytesPerFrame;
+        mFramesWritten += theFramesToEncode;
+        inFrames += static_cast<size_t>(theFramesToEncode) * mFormat.GetChannels();
+        theFramesLeft -= theFramesToEncode;
+    }
+}
+
+void    BGMRecordingFile::Close()
+{
+    if(!IsOpen())
+    {
+        return;
+    }
+
+    if(mExtAudioFile != nullptr)
+    {
+        // Disposing of the file finishes encoding it and writes the stream header.
+        const OSStatus theError = ExtAudioFileDispose(mExtAudioFile);
+        mExtAudioFile = nullptr;
+        ThrowIfError(theError, CAException(theError), "BGMRecordingFile::Close: ExtAudioFileDispose failed");
+
+        DebugMsg("BGMRecordingFile::Close: Wrote %llu frames to %s",
+                 static_cast<unsigned long long>(mFramesWritten),
+                 mPath.c_str());
+        return;
+    }
+
+    // Close the file descriptor even if writing fails.
+    const int theFD = mFD;
+
+    try
+    {
+        const UInt64 theDataBytes = mFramesWritten * mFormat.GetBytesPerFrame();
+        const UInt32 thePaddingBytes = mFormat.GetPaddingBytes(theDataBytes);
+
+        // Add the pad byte, if the format needs one, after the last of the audio data.
+        if(mBufferedBytes + thePaddingBytes > kBufferBytes)
+        {
+            FlushBuffer();
+        }
+
+        memset(mBuffer + mBufferedBytes, 0, thePaddingBytes);
+        mBufferedBytes += thePaddingBytes;
+
+        FlushBuffer();
+
+        // Replace the provisional header.
+        UInt8 theHeader[BGMRecordingFormat::kMaxHeaderSize];
+        mFormat.WriteHeader(theHeader, theDataBytes, true);
+        WriteAll(theHeader, mFormat.GetHeaderSize(), 0);
+    }
+    catch(...)
+    {
+        mFD = -1;
+        close(theFD);
+        throw;
+    }
+
+    mFD = -1;
+
+    if(close(theFD) == -1)
+    {
+        ThrowErrno("BGMRecordingFile::Close: close failed", mPath);
+    }
+
+    DebugMsg("BGMRecordingFile::Close: Wrote %llu frames to %s",
+             static_cast<unsigned long long>(mFramesWritten),
+             mPath.c_str());
+}
+
+void    BGMRecordingFile::FlushBuffer()
+{
+    WriteAll(mBuffer, mBufferedBytes, mBufferFileOffset);
+
+    mBufferFileOffset += mBufferedBytes;
+    mBufferedBytes = 0;
+}
+
+void    BGMRecordingFile::WriteAll(const UInt8* inData, size_t inByteCount, off_t inOffset)
+{
+    while(inByteCount > 0)
+    {
+        const ssize_t theBytesWritten = pwrite(mFD, inData, inByteCount, inOffset);
+
+        if(theBytesWritten == -1)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+
+            ThrowErrno("BGMRecordingFile::WriteAll: pwrite failed", mPath);
+        }
+
+        inData += theBytesWritten;
+        inByteCount -= static_cast<size_t>(theBytesWritten);
+        inOffset += theBytesWritten;
+    }
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,128 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMRecordingFile.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  One audio file being written by BGMRecorder.
+//
+//  Frames are encoded straight into a large, page-aligned buffer, which is written to the file
+//  whenever it fills up. The file is opened with F_NOCACHE, so a long recording doesn't push
+//  everything else out of the buffer cache. (macOS doesn't have O_DIRECT. F_NOCACHE is its closest
+//  equivalent and, unlike O_DIRECT, doesn't require the writes to be aligned, so the last partial
+//  buffer can be written as it is.)
+//
+//  FLAC files are written with ExtAudioFile instead, which encodes and buffers the audio itself.
+//  The encoder only finishes the FLAC stream header when the file is closed, so unlike the other
+//  formats, a FLAC file BGMApp didn't close might not be readable by every app.
+//
+//  Not thread-safe. BGMRecorder only uses these from its worker thread.
+//
+
+#ifndef BGMApp__BGMRecordingFile
+#define BGMApp__BGMRecordingFile
+
+// Local Includes
+#include "BGMRecordingFormat.h"
+
+// STL Includes
+#include <string>
+
+// System Includes
+#include <AudioToolbox/ExtendedAudioFile.h>
+#include <MacTypes.h>
+#include <sys/types.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMRecordingFile
+{
+
+public:
+    // The size of the write buffer. Large enough that the file is written in a few big IOs per
+    // second, even for many channels at high sample rates.
+    static const UInt32 kBufferBytes = 1024 * 1024;
+
+    /*!
+     Create the file and reserve space for its header. Fails if the file already exists.
+
+     @throws CAException if the file can't be created. The error code is the errno value.
+     */
+                        BGMRecordingFile(const std::string& inPath, const BGMRecordingFormat& inFormat);
+    /*! Closes the file if Close hasn't been called. Logs rather than throwing any errors. */
+                        ~BGMRecordingFile();
+                        // Disallow copying
+                        BGMRecordingFile(const BGMRecordingFile&) = delete;
+                        BGMRecordingFile& operator=(const BGMRecordingFile&) = delete;
+
+    const std::string&  GetPath() const noexcept { return mPath; }
+    const BGMRecordingFormat& GetFormat() const noexcept { return mFormat; }
+
+    UInt64              GetFramesWritten() const noexcept { return mFramesWritten; }
+    /*!
+     The size the file will be once it's closed, including the header. For FLAC files, the size of
+     the audio before it's compressed, so it's an upper bound.
+     */
+    UInt64              GetFileBytes() const noexcept;
+    /*! The number of frames that can be added before the file reaches its format's size limit. */
+    UInt64              GetRemainingFrameCapacity() const noexcept;
+
+    /*!
+     Encode some interleaved Float32 frames and add them to the file.
+
+     @throws CAException if writing to the file fails, with the errno value as the error code, or if
+                         the frames wouldn't fit in the file. (See GetRemainingFrameCapacity.)
+     */
+    void                WriteFrames(const Float32* inFrames, UInt32 inFrameCount);
+
+    /*!
+     Write any buffered frames, finish the header and close the file. Does nothing if the file has
+     already been closed.
+
+     @throws CAException if writing to the file fails. The file is still closed.
+     */
+    void                Close();
+
+private:
+    void                CreateFLACFile();
+    bool                IsOpen() const noexcept { return mFD != -1 || mExtAudioFile != nullptr; }
+
+    void                FlushBuffer();
+    void                WriteAll(const UInt8* inData, size_t inByteCount, off_t inOffset);
+
+    const std::string   mPath;
+    const BGMRecordingFormat mFormat;
+    int                 mFD = -1;
+    // Only used for FLAC files.
+    ExtAudioFileRef __nullable mExtAudioFile = nullptr;
+
+    UInt8* __nullable   mBuffer = nullptr;
+    // The number of bytes in mBuffer waiting to be written.
+    UInt32              mBufferedBytes = 0;
+    // The file offset mBuffer will be written to.
+    off_t               mBufferFileOffset = 0;
+
+    UInt64              mFramesWritten = 0;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMApp__BGMRecordingFile */
+
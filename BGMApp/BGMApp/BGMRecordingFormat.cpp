@@ -0,0 +1,393 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMRecordingFormat.cpp
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMRecordingFormat.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+
+
+#pragma clang assume_nonnull begin
+
+// Float32 samples are copied into the files without swapping their bytes, which is only correct on
+// little-endian hosts. Every Mac BGMApp supports is little-endian.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "BGMRecordingFormat assumes a little-endian host");
+
+// WAV format tags
+static const UInt16 kWAVFormatPCM        = 0x0001;
+static const UInt16 kWAVFormatIEEEFloat  = 0x0003;
+static const UInt16 kWAVFormatExtensible = 0xFFFE;
+
+// CAF linear PCM format flags
+static const UInt32 kCAFFormatFlagIsFloat        = (1 << 0);
+static const UInt32 kCAFFormatFlagIsLittleEndian = (1 << 1);
+
+// FLAC's stream header stores the number of channels in 3 bits and the number of frames in 36.
+static const UInt32 kFLACMaxChannels = 8;
+static const UInt64 kFLACMaxFrames = (1ull << 36) - 1;
+
+#pragma mark Byte Writing Helpers
+
+namespace
+{
+    // Appends values to a header, little- or big-endian, regardless of the host's byte order.
+    class HeaderWriter
+    {
+
+    public:
+        HeaderWriter(UInt8* outHeader) : mPosition(outHeader) { }
+
+        void    FourCC(const char* inCode)
+        {
+            memcpy(mPosition, inCode, 4);
+            mPosition += 4;
+        }
+
+        void    LE16(UInt16 inValue) { LE(inValue, 2); }
+        void    LE32(UInt32 inValue) { LE(inValue, 4); }
+
+        void    BE16(UInt16 inValue) { BE(inValue, 2); }
+        void    BE32(UInt32 inValue) { BE(inValue, 4); }
+        void    BE64(UInt64 inValue) { BE(inValue, 8); }
+
+        void    BEFloat64(Float64 inValue)
+        {
+            UInt64 theBits;
+            memcpy(&theBits, &inValue, sizeof(theBits));
+            BE64(theBits);
+        }
+
+        void    Bytes(const UInt8* inBytes, UInt32 inCount)
+        {
+            memcpy(mPosition, inBytes, inCount);
+            mPosition += inCount;
+        }
+
+    private:
+        void    LE(UInt64 inValue, UInt32 inSize)
+        {
+            for(UInt32 i = 0; i < inSize; i++)
+            {
+                *mPosition++ = static_cast<UInt8>(inValue >> (8 * i));
+            }
+        }
+
+        void    BE(UInt64 inValue, UInt32 inSize)
+        {
+            for(UInt32 i = inSize; i > 0; i--)
+            {
+                *mPosition++ = static_cast<UInt8>(inValue >> (8 * (i - 1)));
+            }
+        }
+
+        UInt8*  mPosition;
+
+    };
+}
+
+#pragma mark Construction
+
+BGMRecordingFormat::BGMRecordingFormat(Container inContainer,
+                                       SampleFormat inSampleFormat,
+                                       Float64 inSampleRate,
+                                       UInt32 inChannels)
+:
+    mContainer(inContainer),
+    mSampleFormat(inSampleFormat),
+    mSampleRate(inSampleRate),
+    mChannels(inChannels)
+{
+    // WAV headers store the sample rate and channel count in 32 and 16 bits.
+    ThrowIf(!(inSampleRate >= 1.0 && inSampleRate <= 4294967295.0) ||
+                    inChannels == 0 ||
+                    inChannels > 0xFFFF,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMRecordingFormat::BGMRecordingFormat: Invalid format");
+    ThrowIf(inContainer == Container::FLAC &&
+                    (inSampleFormat == SampleFormat::Float32 || inChannels > kFLACMaxChannels),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMRecordingFormat::BGMRecordingFormat: FLAC can't store this format");
+}
+
+#pragma mark Accessors
+
+UInt32  BGMRecordingFormat::GetBytesPerSample() const noexcept
+{
+    switch(mSampleFormat)
+    {
+        case SampleFormat::Int16:
+            return 2;
+        case SampleFormat::Int24:
+            return 3;
+        case SampleFormat::Float32:
+            return 4;
+    }
+
+    return 4;
+}
+
+const char* BGMRecordingFormat::GetFileExtension() const noexcept
+{
+    switch(mContainer)
+    {
+        case Container::WAV:
+            return "wav";
+        case Container::CAF:
+            return "caf";
+        case Container::FLAC:
+            return "flac";
+    }
+
+    return "wav";
+}
+
+bool    BGMRecordingFormat::UsesWAVExtensible() const noexcept
+{
+    // WAVEFORMATEX is only meant for one or two channels with up to 16 bits per sample, except
+    // that floats are allowed to be 32-bit.
+    return (mChannels > 2) || (mSampleFormat == SampleFormat::Int24);
+}
+
+bool    BGMRecordingFormat::UsesWAVFactChunk() const noexcept
+{
+    // A fact chunk is required for every format except plain PCM.
+    return UsesWAVExtensible() || (mSampleFormat == SampleFormat::Float32);
+}
+
+UInt32  BGMRecordingFormat::GetHeaderSize() const noexcept
+{
+    if(mContainer == Container::FLAC)
+    {
+        // AudioToolbox writes the header.
+        return 0;
+    }
+
+    if(mContainer == Container::CAF)
+    {
+        // File header, desc chunk and data chunk header (including the edit count).
+        return 8 + (12 + 32) + (12 + 4);
+    }
+
+    UInt32 theFmtChunkSize = 16;
+
+    if(UsesWAVExtensible())
+    {
+        theFmtChunkSize = 40;
+    }
+    else if(mSampleFormat == SampleFormat::Float32)
+    {
+        theFmtChunkSize = 18;
+    }
+
+    // RIFF header, fmt chunk, fact chunk (if any) and data chunk header.
+    return 12 + (8 + theFmtChunkSize) + (UsesWAVFactChunk() ? 12 : 0) + 8;
+}
+
+UInt64  BGMRecordingFormat::GetMaxDataBytes() const noexcept
+{
+    if(mContainer == Container::CAF)
+    {
+        return static_cast<UInt64>(INT64_MAX) - GetHeaderSize();
+    }
+
+    if(mContainer == Container::FLAC)
+    {
+        return kFLACMaxFrames * GetBytesPerFrame();
+    }
+
+    // The RIFF chunk size, which doesn't include its own header, is a UInt32. Leave room for the
+    // pad byte and only allow whole frames.
+    const UInt64 theMaxBytes = 0xFFFFFFFFull - (GetHeaderSize() - 8) - 1;
+    return theMaxBytes - (theMaxBytes % GetBytesPerFrame());
+}
+
+UInt32  BGMRecordingFormat::GetPaddingBytes(UInt64 inDataBytes) const noexcept
+{
+    // RIFF chunks have to be an even number of bytes long.
+    return (mContainer == Container::WAV) ? static_cast<UInt32>(inDataBytes & 1) : 0;
+}
+
+#pragma mark Headers
+
+void    BGMRecordingFormat::WriteHeader(UInt8* outHeader,
+                                        UInt64 inDataBytes,
+                                        bool inIsComplete) const noexcept
+{
+    if(mContainer == Container::WAV)
+    {
+        WriteWAVHeader(outHeader, inDataBytes, inIsComplete);
+    }
+    else if(mContainer == Container::CAF)
+    {
+        WriteCAFHeader(outHeader, inDataBytes, inIsComplete);
+    }
+}
+
+void    BGMRecordingFormat::WriteWAVHeader(UInt8* outHeader,
+                                           UInt64 inDataBytes,
+                                           bool inIsComplete) const noexcept
+{
+    const UInt64 theDataBytes = std::min(inDataBytes, GetMaxDataBytes());
+    const UInt32 theBytesPerFrame = GetBytesPerFrame();
+    const bool isFloat = (mSampleFormat == SampleFormat::Float32);
+
+    // 0xFFFFFFFF is the conventional "unknown size" for WAV files that are still being written.
+    const UInt32 theRIFFSize = inIsComplete ?
+            static_cast<UInt32>(GetHeaderSize() - 8 + theDataBytes + GetPaddingBytes(theDataBytes)) :
+            0xFFFFFFFF;
+    const UInt32 theDataChunkSize = inIsComplete ? static_cast<UInt32>(theDataBytes) : 0xFFFFFFFF;
+    const UInt32 theFrameCount = inIsComplete ? static_cast<UInt32>(theDataBytes / theBytesPerFrame) : 0xFFFFFFFF;
+
+    HeaderWriter theWriter(outHeader);
+
+    theWriter.FourCC("RIFF");
+    theWriter.LE32(theRIFFSize);
+    theWriter.FourCC("WAVE");
+
+    UInt16 theFormatTag = isFloat ? kWAVFormatIEEEFloat : kWAVFormatPCM;
+
+    theWriter.FourCC("fmt ");
+    theWriter.LE32(UsesWAVExtensible() ? 40 : (isFloat ? 18 : 16));
+    theWriter.LE16(UsesWAVExtensible() ? kWAVFormatExtensible : theFormatTag);
+    theWriter.LE16(static_cast<UInt16>(mChannels));
+    theWriter.LE32(static_cast<UInt32>(mSampleRate));
+    theWriter.LE32(static_cast<UInt32>(mSampleRate) * theBytesPerFrame);
+    theWriter.LE16(static_cast<UInt16>(theBytesPerFrame));
+    theWriter.LE16(static_cast<UInt16>(GetBytesPerSample() * 8));
+
+    if(UsesWAVExtensible())
+    {
+        // The rest of WAVEFORMATEXTENSIBLE: cbSize, wValidBitsPerSample, dwChannelMask and the
+        // SubFormat GUID. We don't know which speakers the channels are for, so the mask is 0.
+        theWriter.LE16(22);
+        theWriter.LE16(static_cast<UInt16>(GetBytesPerSample() * 8));
+        theWriter.LE32(0);
+
+        // KSDATAFORMAT_SUBTYPE_PCM or KSDATAFORMAT_SUBTYPE_IEEE_FLOAT. They only differ in their
+        // first two bytes, which are the WAVEFORMATEX format tag.
+        const UInt8 theGUIDTail[14] = {
+            0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+        };
+
+        theWriter.LE16(theFormatTag);
+        theWriter.Bytes(theGUIDTail, sizeof(theGUIDTail));
+    }
+    else if(isFloat)
+    {
+        // cbSize
+        theWriter.LE16(0);
+    }
+
+    if(UsesWAVFactChunk())
+    {
+        theWriter.FourCC("fact");
+        theWriter.LE32(4);
+        theWriter.LE32(theFrameCount);
+    }
+
+    theWriter.FourCC("data");
+    theWriter.LE32(theDataChunkSize);
+}
+
+void    BGMRecordingFormat::WriteCAFHeader(UInt8* outHeader,
+                                           UInt64 inDataBytes,
+                                           bool inIsComplete) const noexcept
+{
+    const bool isFloat = (mSampleFormat == SampleFormat::Float32);
+
+    HeaderWriter theWriter(outHeader);
+
+    // File header: type, version and flags.
+    theWriter.FourCC("caff");
+    theWriter.BE16(1);
+    theWriter.BE16(0);
+
+    // Audio description chunk.
+    theWriter.FourCC("desc");
+    theWriter.BE64(32);
+    theWriter.BEFloat64(mSampleRate);
+    theWriter.FourCC("lpcm");
+    theWriter.BE32(kCAFFormatFlagIsLittleEndian | (isFloat ? kCAFFormatFlagIsFloat : 0));
+    theWriter.BE32(GetBytesPerFrame());
+    theWriter.BE32(1);
+    theWriter.BE32(mChannels);
+    theWriter.BE32(GetBytesPerSample() * 8);
+
+    // Audio data chunk. The size includes the edit count. A size of -1 means the data runs to the
+    // end of the file, which is allowed for the last chunk.
+    theWriter.FourCC("data");
+    theWriter.BE64(inIsComplete ?
+                   (std::min(inDataBytes, GetMaxDataBytes()) + 4) :
+                   static_cast<UInt64>(-1));
+    theWriter.BE32(0);
+}
+
+#pragma mark Encoding
+
+void    BGMRecordingFormat::Encode(const Float32* inFrames,
+                                   UInt32 inFrameCount,
+                                   UInt8* outData) const noexcept
+{
+    const size_t theSampleCount = static_cast<size_t>(inFrameCount) * mChannels;
+
+    switch(mSampleFormat)
+    {
+        case SampleFormat::Int16:
+            for(size_t i = 0; i < theSampleCount; i++)
+            {
+                const Float32 theSample = std::max(-1.0f, std::min(1.0f, inFrames[i]));
+                const SInt16 theValue = static_cast<SInt16>(lrintf(theSample * 32767.0f));
+
+                outData[(2 * i) + 0] = static_cast<UInt8>(theValue);
+                outData[(2 * i) + 1] = static_cast<UInt8>(theValue >> 8);
+            }
+            break;
+
+        case SampleFormat::Int24:
+            for(size_t i = 0; i < theSampleCount; i++)
+            {
+                const Float32 theSample = std::max(-1.0f, std::min(1.0f, inFrames[i]));
+                const SInt32 theValue = static_cast<SInt32>(lrintf(theSample * 8388607.0f));
+
+                outData[(3 * i) + 0] = static_cast<UInt8>(theValue);
+                outData[(3 * i) + 1] = static_cast<UInt8>(theValue >> 8);
+                outData[(3 * i) + 2] = static_cast<UInt8>(theValue >> 16);
+            }
+            break;
+
+        case SampleFormat::Float32:
+            memcpy(outData, inFrames, theSampleCount * sizeof(Float32));
+            break;
+    }
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,135 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMRecordingFormat.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The file formats BGMRecorder can write. Builds the files' headers and encodes interleaved Float32
+//  frames into the files' sample format.
+//
+//  The headers always have the same size for a given format, so BGMRecordingFile can write a
+//  provisional header when it creates a file and overwrite it with the final one when it closes
+//  the file. The provisional headers mark the length of the audio data as unknown, which most
+//  readers treat as "read until the end of the file", so a recording is still readable if BGMApp
+//  quits without closing it.
+//
+//  FLAC files are compressed, so BGMRecordingFile has AudioToolbox encode them instead. Their header
+//  size is 0, WriteHeader doesn't do anything for them and Encode isn't used. FLAC only stores
+//  integer samples, with up to eight channels.
+//
+
+#ifndef BGMApp__BGMRecordingFormat
+#define BGMApp__BGMRecordingFormat
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMRecordingFormat
+{
+
+public:
+    enum class          Container
+                        {
+                            WAV, CAF, FLAC
+                        };
+
+    enum class          SampleFormat
+                        {
+                            Int16, Int24, Float32
+                        };
+
+    // The largest header any format uses, in bytes.
+    static const UInt32 kMaxHeaderSize = 80;
+
+    /*!
+     @throws CAException if the sample rate is invalid, inChannels is 0 or the container can't
+                         store the format, e.g. Float32 samples in a FLAC file.
+     */
+                        BGMRecordingFormat(Container inContainer,
+                                           SampleFormat inSampleFormat,
+                                           Float64 inSampleRate,
+                                           UInt32 inChannels);
+
+    Container           GetContainer() const noexcept { return mContainer; }
+    SampleFormat        GetSampleFormat() const noexcept { return mSampleFormat; }
+    Float64             GetSampleRate() const noexcept { return mSampleRate; }
+    UInt32              GetChannels() const noexcept { return mChannels; }
+
+    UInt32              GetBytesPerSample() const noexcept;
+    UInt32              GetBytesPerFrame() const noexcept { return GetBytesPerSample() * mChannels; }
+
+    /*! The file name extension for the container, without the dot. */
+    const char*         GetFileExtension() const noexcept;
+
+    /*! The size of the file header, which comes directly before the audio data. */
+    UInt32              GetHeaderSize() const noexcept;
+
+    /*!
+     The most audio data, in bytes, a file in this format can hold. WAV files can't be larger than
+     4 GiB. CAF and FLAC files have no practical limit. For FLAC, this and the other sizes are of the
+     audio before it's compressed.
+     */
+    UInt64              GetMaxDataBytes() const noexcept;
+
+    /*!
+     The number of zero bytes that have to follow inDataBytes bytes of audio data at the end of the
+     file. WAV chunks have to be an even number of bytes long, so this can be 1 for WAV files.
+     */
+    UInt32              GetPaddingBytes(UInt64 inDataBytes) const noexcept;
+
+    /*!
+     Write the file header.
+
+     @param outHeader Must be at least GetHeaderSize() bytes.
+     @param inDataBytes The size of the audio data following the header.
+     @param inIsComplete False to mark the size of the audio data as unknown, e.g. while the file is
+                         still being written. inDataBytes is ignored in that case.
+     */
+    void                WriteHeader(UInt8* outHeader, UInt64 inDataBytes, bool inIsComplete) const noexcept;
+
+    /*!
+     Convert interleaved Float32 frames to the file's sample format. Integer formats are clipped to
+     [-1, 1] and rounded. Both containers store the samples little-endian.
+
+     @param outData Must be at least inFrameCount * GetBytesPerFrame() bytes.
+     */
+    void                Encode(const Float32* inFrames, UInt32 inFrameCount, UInt8* outData) const noexcept;
+
+private:
+    // The WAV variants. Plain PCM for up to two integer channels, IEEE float for up to two float
+    // channels and WAVE_FORMAT_EXTENSIBLE for everything else.
+    bool                UsesWAVExtensible() const noexcept;
+    bool                UsesWAVFactChunk() const noexcept;
+
+    void                WriteWAVHeader(UInt8* outHeader, UInt64 inDataBytes, bool inIsComplete) const noexcept;
+    void                WriteCAFHeader(UInt8* outHeader, UInt64 inDataBytes, bool inIsComplete) const noexcept;
+
+    const Container     mContainer;
+    const SampleFormat  mSampleFormat;
+    const Float64       mSampleRate;
+    const UInt32        mChannels;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMApp__BGMRecordingFormat */
+
@@ -0,0 +1,376 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMSampleRateConverter.cpp
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMSampleRateConverter.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+
+
+#pragma clang assume_nonnull begin
+
+// The Kaiser window's beta. With kTapsAtLowerRate taps, this puts the edges of the filter's
+// transition band about 2 kHz either side of 22.05 kHz when one of the rates is 44.1 kHz, so
+// everything up to 20 kHz is passed and everything that would alias/image into it is attenuated
+// by over 100 dB.
+static const Float64 kKaiserBeta = 12.0;
+
+// The dot products sum this many lanes separately, so the compiler can vectorise them without
+// reordering the additions itself. The filter lengths are rounded up to a multiple of it.
+static const UInt32 kLanes = 8;
+
+// The zeroth-order modified Bessel function of the first kind, for the Kaiser window.
+static Float64 BesselI0(Float64 inX)
+{
+    Float64 theSum = 1.0;
+    Float64 theTerm = 1.0;
+    const Float64 theHalfXSquared = 0.25 * inX * inX;
+
+    for(UInt32 k = 1; k < 100 && theTerm > 1e-12 * theSum; k++)
+    {
+        theTerm *= theHalfXSquared / (static_cast<Float64>(k) * k);
+        theSum += theTerm;
+    }
+
+    return theSum;
+}
+
+static inline Float32 SumLanes(const Float32 inSums[kLanes]) noexcept
+{
+    return ((inSums[0] + inSums[4]) + (inSums[1] + inSums[5])) +
+           ((inSums[2] + inSums[6]) + (inSums[3] + inSums[7]));
+}
+
+static inline Float32 DotProduct(const Float32* inA, const Float32* inB, UInt32 inLength) noexcept
+{
+    Float32 theSums[kLanes] = { };
+
+    for(UInt32 i = 0; i < inLength; i += kLanes)
+    {
+        for(UInt32 lane = 0; lane < kLanes; lane++)
+        {
+            theSums[lane] += inA[i + lane] * inB[i + lane];
+        }
+    }
+
+    return SumLanes(theSums);
+}
+
+// Interpolate the filter coefficients between two phases and apply them to a frame of each
+// channel, without storing the interpolated coefficients.
+static inline void FilterStereo(const Float32* inLeft,
+                                const Float32* inRight,
+                                const Float32* inRow,
+                                const Float32* inDeltas,
+                                Float32 inFraction,
+                                UInt32 inLength,
+                                Float32* outFrame) noexcept
+{
+    Float32 theLeftSums[kLanes] = { };
+    Float32 theRightSums[kLanes] = { };
+
+    for(UInt32 i = 0; i < inLength; i += kLanes)
+    {
+        for(UInt32 lane = 0; lane < kLanes; lane++)
+        {
+            const Float32 theCoefficient = inRow[i + lane] + inFraction * inDeltas[i + lane];
+            theLeftSums[lane] += inLeft[i + lane] * theCoefficient;
+            theRightSums[lane] += inRight[i + lane] * theCoefficient;
+        }
+    }
+
+    outFrame[0] = SumLanes(theLeftSums);
+    outFrame[1] = SumLanes(theRightSums);
+}
+
+BGMSampleRateConverter::BGMSampleRateConverter(UInt32 inChannels)
+:
+    mChannels(inChannels)
+{
+    ThrowIf(inChannels == 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMSampleRateConverter::BGMSampleRateConverter: Invalid argument");
+}
+
+void    BGMSampleRateConverter::SetRates(Float64 inInputSampleRate,
+                                         Float64 inOutputSampleRate,
+                                         UInt32 inMaxInputFrames)
+{
+    ThrowIf(!(inInputSampleRate > 0.0) || !(inOutputSampleRate > 0.0) || inMaxInputFrames == 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMSampleRateConverter::SetRates: Invalid argument");
+
+    mInputSampleRate = inInputSampleRate;
+    mOutputSampleRate = inOutputSampleRate;
+    mStep = inInputSampleRate / inOutputSampleRate;
+
+    if(IsPassthrough())
+    {
+        mTaps = 0;
+        mFilter.clear();
+        mFilterDeltas.clear();
+        mInterpolatedFilter.clear();
+        mHistory.clear();
+        mHistoryFrames = 0;
+        mPosition = 0.0;
+        return;
+    }
+
+    // When converting to a lower rate, the filter has to be longer (in input frames) for the same
+    // transition band (in Hz) because its cutoff is lower relative to the input rate.
+    const Float64 theLowerRate = std::min(inInputSampleRate, inOutputSampleRate);
+    const Float64 theTaps = std::ceil(kTapsAtLowerRate * std::max(1.0, mStep) / kLanes) * kLanes;
+    mTaps = static_cast<UInt32>(theTaps);
+    mCutoff = 0.5 * theLowerRate / inInputSampleRate;
+    mKaiserBeta = kKaiserBeta;
+
+    // Build the table of filter phases.
+    const UInt32 theHalfTaps = mTaps / 2;
+    mFilter.assign(static_cast<size_t>(kPhases + 1) * mTaps, 0.0f);
+
+    for(UInt32 thePhase = 0; thePhase <= kPhases; thePhase++)
+    {
+        Float32* theRow = &mFilter[static_cast<size_t>(thePhase) * mTaps];
+        const Float64 theFraction = static_cast<Float64>(thePhase) / kPhases;
+        Float64 theRowSum = 0.0;
+
+        // Tap j is applied to the input frame (theHalfTaps - 1 - j) frames before the output
+        // frame's position, rounded down.
+        for(UInt32 j = 0; j < mTaps; j++)
+        {
+            const Float64 theResponse =
+                    FilterResponse(theFraction + static_cast<Float64>(theHalfTaps) - 1.0 - j);
+            theRow[j] = static_cast<Float32>(theResponse);
+            theRowSum += theResponse;
+        }
+
+        // Normalise each phase so DC passes through at unity gain.
+        for(UInt32 j = 0; j < mTaps; j++)
+        {
+            theRow[j] = static_cast<Float32>(theRow[j] / theRowSum);
+        }
+    }
+
+    // Store the differences between consecutive phases so interpolating only takes one multiply-add.
+    mFilterDeltas.assign(static_cast<size_t>(kPhases) * mTaps, 0.0f);
+
+    for(size_t i = 0; i < mFilterDeltas.size(); i++)
+    {
+        mFilterDeltas[i] = mFilter[i + mTaps] - mFilter[i];
+    }
+
+    mInterpolatedFilter.assign(mTaps, 0.0f);
+
+    // The history holds the frames the filter still needs, plus one call's worth of input.
+    mHistory.assign(mChannels, std::vector<Float32>(mTaps + inMaxInputFrames + 1, 0.0f));
+
+    Reset();
+}
+
+Float64 BGMSampleRateConverter::FilterResponse(Float64 inOffset) const noexcept
+{
+    const Float64 theHalfWidth = mTaps / 2.0;
+
+    if(std::fabs(inOffset) >= theHalfWidth)
+    {
+        return 0.0;
+    }
+
+    // A sinc with its first zero crossing at 1 / (2 * cutoff), windowed by a Kaiser window.
+    const Float64 theX = 2.0 * mCutoff * inOffset;
+    const Float64 theSinc = (theX == 0.0) ? 1.0 : std::sin(M_PI * theX) / (M_PI * theX);
+    const Float64 theWindowPosition = inOffset / theHalfWidth;
+    const Float64 theWindow =
+            BesselI0(mKaiserBeta * std::sqrt(1.0 - theWindowPosition * theWindowPosition)) /
+                    BesselI0(mKaiserBeta);
+
+    return 2.0 * mCutoff * theSinc * theWindow;
+}
+
+void    BGMSampleRateConverter::Reset() noexcept
+{
+    if(IsPassthrough())
+    {
+        return;
+    }
+
+    // Start with silence before the first input frame so the first output frame can be aligned
+    // with it.
+    const UInt32 theHalfTaps = mTaps / 2;
+
+    for(std::vector<Float32>& theChannel : mHistory)
+    {
+        std::fill(theChannel.begin(), theChannel.end(), 0.0f);
+    }
+
+    mHistoryFrames = theHalfTaps - 1;
+    mPosition = theHalfTaps - 1;
+}
+
+UInt32  BGMSampleRateConverter::GetInputFramesRequired(UInt32 inOutputFrames) const noexcept
+{
+    if(IsPassthrough())
+    {
+        return inOutputFrames;
+    }
+
+    if(inOutputFrames == 0)
+    {
+        return 0;
+    }
+
+    // The last output frame needs the input frames up to (and including) mTaps / 2 frames after
+    // its position.
+    const Float64 theLastPosition = mPosition + (inOutputFrames - 1) * mStep;
+    const UInt32 theFramesNeeded = static_cast<UInt32>(theLastPosition) + mTaps / 2 + 1;
+
+    return (theFramesNeeded > mHistoryFrames) ? (theFramesNeeded - mHistoryFrames) : 0;
+}
+
+UInt32  BGMSampleRateConverter::Process(const Float32* __nullable inInput,
+                                        UInt32 inInputFrames,
+                                        Float32* outOutput,
+                                        UInt32 inOutputFrames) noexcept
+{
+    if(IsPassthrough())
+    {
+        const UInt32 theFrames = std::min(inInputFrames, inOutputFrames);
+
+        if(theFrames > 0 && inInput)
+        {
+            memcpy(outOutput, inInput, sizeof(Float32) * theFrames * mChannels);
+        }
+
+        memset(outOutput + theFrames * mChannels,
+               0,
+               sizeof(Float32) * (inOutputFrames - theFrames) * mChannels);
+        return theFrames;
+    }
+
+    // Deinterleave the input into the history. Drop any frames that don't fit, which shouldn't
+    // happen unless the caller passes more than inMaxInputFrames.
+    const UInt32 theCapacity = static_cast<UInt32>(mHistory[0].size());
+    const UInt32 theFramesToAppend = inInput ? std::min(inInputFrames, theCapacity - mHistoryFrames) : 0;
+
+    for(UInt32 theChannel = 0; theChannel < mChannels; theChannel++)
+    {
+        Float32* theHistory = mHistory[theChannel].data() + mHistoryFrames;
+
+        for(UInt32 i = 0; i < theFramesToAppend; i++)
+        {
+            theHistory[i] = inInput[i * mChannels + theChannel];
+        }
+    }
+
+    mHistoryFrames += theFramesToAppend;
+
+    // Produce as many output frames as the input allows.
+    const UInt32 theHalfTaps = mTaps / 2;
+    const Float64 theStartPosition = mPosition;
+    UInt32 theFramesProduced = 0;
+
+    for(; theFramesProduced < inOutputFrames; theFramesProduced++)
+    {
+        const Float64 thePosition = theStartPosition + theFramesProduced * mStep;
+        const UInt32 theIndex = static_cast<UInt32>(thePosition);
+
+        if(theIndex + theHalfTaps >= mHistoryFrames)
+        {
+            break;
+        }
+
+        // Interpolate between the two nearest phases of the filter.
+        const Float64 thePhasePosition = (thePosition - theIndex) * kPhases;
+        const UInt32 thePhase = static_cast<UInt32>(thePhasePosition);
+        const Float32 theFraction = static_cast<Float32>(thePhasePosition - thePhase);
+        const Float32* theRow = &mFilter[static_cast<size_t>(thePhase) * mTaps];
+        const Float32* theDeltas = &mFilterDeltas[static_cast<size_t>(thePhase) * mTaps];
+
+        // Apply it to the input frames around the output frame's position.
+        const UInt32 theFirstInputFrame = theIndex + 1 - theHalfTaps;
+        Float32* theOutputFrame = outOutput + theFramesProduced * mChannels;
+
+        if(mChannels == 2)
+        {
+            // Stereo is the usual case, so do both channels in one pass.
+            FilterStereo(mHistory[0].data() + theFirstInputFrame,
+                         mHistory[1].data() + theFirstInputFrame,
+                         theRow,
+                         theDeltas,
+                         theFraction,
+                         mTaps,
+                         theOutputFrame);
+        }
+        else
+        {
+            Float32* theInterpolatedFilter = mInterpolatedFilter.data();
+
+            for(UInt32 j = 0; j < mTaps; j++)
+            {
+                theInterpolatedFilter[j] = theRow[j] + theFraction * theDeltas[j];
+            }
+
+            for(UInt32 theChannel = 0; theChannel < mChannels; theChannel++)
+            {
+                theOutputFrame[theChannel] =
+                        DotProduct(mHistory[theChannel].data() + theFirstInputFrame,
+                                   theInterpolatedFilter,
+                                   mTaps);
+            }
+        }
+    }
+
+    memset(outOutput + theFramesProduced * mChannels,
+           0,
+           sizeof(Float32) * (inOutputFrames - theFramesProduced) * mChannels);
+
+    // Discard the input frames the next output frame won't need.
+    mPosition = theStartPosition + theFramesProduced * mStep;
+    const UInt32 theFramesToDiscard = static_cast<UInt32>(mPosition) + 1 - theHalfTaps;
+
+    if(theFramesToDiscard > 0)
+    {
+        for(std::vector<Float32>& theChannel : mHistory)
+        {
+            memmove(theChannel.data(),
+                    theChannel.data() + theFramesToDiscard,
+                    sizeof(Float32) * (mHistoryFrames - theFramesToDiscard));
+        }
+
+        mHistoryFrames -= theFramesToDiscard;
+        mPosition -= theFramesToDiscard;
+    }
+
+    return theFramesProduced;
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,155 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMSampleRateConverter.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Converts a stream of interleaved Float32 frames from one sample rate to another. BGMPlayThrough
+//  uses it when BGMDevice and the output device are running at different rates, so BGMDevice's
+//  rate doesn't have to change (which restarts every client's IO) when the output device does.
+//
+//  This is a polyphase windowed-sinc resampler. The filter is a Kaiser-windowed sinc with its
+//  cutoff just below the lower of the two Nyquist frequencies, stored as a table of kPhases
+//  sub-sample phases. Each output frame linearly interpolates between the two nearest phases and
+//  takes the dot product with the input. The inner loops only work on contiguous, deinterleaved
+//  arrays so the compiler can vectorise them.
+//
+//  Process is real-time safe. SetRates allocates, so it has to be called while the IOProcs that use
+//  the converter are stopped (or can't access it).
+//
+
+#ifndef BGMApp__BGMSampleRateConverter
+#define BGMApp__BGMSampleRateConverter
+
+// STL Includes
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMSampleRateConverter
+{
+
+public:
+    /*! The number of sub-sample phases in the filter table. */
+    static const UInt32 kPhases = 256;
+    /*! The length of the filter, in frames at the lower of the two sample rates. */
+    static const UInt32 kTapsAtLowerRate = 128;
+
+    /*!
+     @param inChannels The number of interleaved channels in each frame.
+     @throws CAException if inChannels is 0.
+     */
+                        BGMSampleRateConverter(UInt32 inChannels = 2);
+                        ~BGMSampleRateConverter() = default;
+                        // Disallow copying
+                        BGMSampleRateConverter(const BGMSampleRateConverter&) = delete;
+                        BGMSampleRateConverter& operator=(const BGMSampleRateConverter&) = delete;
+
+    /*!
+     Build the filter for converting from inInputSampleRate to inOutputSampleRate and reset the
+     converter. If the rates are equal, the converter is left unconfigured and IsPassthrough returns
+     true. Not real-time safe.
+
+     @param inMaxInputFrames The most frames that will be passed to Process at once.
+     @throws CAException if either rate isn't positive or inMaxInputFrames is 0.
+     */
+    void                SetRates(Float64 inInputSampleRate,
+                                 Float64 inOutputSampleRate,
+                                 UInt32 inMaxInputFrames);
+
+    /*! True if the rates are equal, so the input doesn't need to be converted. */
+    bool                IsPassthrough() const noexcept { return mStep == 1.0; }
+
+    UInt32              GetChannels() const noexcept { return mChannels; }
+    Float64             GetInputSampleRate() const noexcept { return mInputSampleRate; }
+    Float64             GetOutputSampleRate() const noexcept { return mOutputSampleRate; }
+    /*! The length of the filter, in input frames. */
+    UInt32              GetTaps() const noexcept { return mTaps; }
+    /*! How many input frames each output frame is delayed by. */
+    UInt32              GetLatencyFrames() const noexcept { return mTaps / 2; }
+
+    /*!
+     Forget the input passed to Process so far, e.g. because the next input won't follow on from
+     it. The next output frame will correspond to the next input frame. Real-time safe.
+     */
+    void                Reset() noexcept;
+
+    /*!
+     @return The number of input frames Process needs to produce inOutputFrames output frames.
+             Real-time safe.
+     */
+    UInt32              GetInputFramesRequired(UInt32 inOutputFrames) const noexcept;
+
+    /*!
+     Convert some frames. Real-time safe. Must only be called by one thread at a time.
+
+     @param inInput Interleaved input frames that follow on from the ones previously passed in.
+                    Null if inInputFrames is 0.
+     @param inInputFrames The number of input frames. Usually GetInputFramesRequired(inOutputFrames).
+                          At most the inMaxInputFrames passed to SetRates.
+     @param outOutput The buffer to write inOutputFrames interleaved output frames to. If there
+                      isn't enough input to produce all of them, the rest are filled with silence.
+     @return The number of output frames produced from the input.
+     */
+    UInt32              Process(const Float32* __nullable inInput,
+                                UInt32 inInputFrames,
+                                Float32* outOutput,
+                                UInt32 inOutputFrames) noexcept;
+
+private:
+    /*!
+     @return The filter's impulse response at inOffset input frames from its centre.
+     */
+    Float64             FilterResponse(Float64 inOffset) const noexcept;
+
+    const UInt32        mChannels;
+
+    Float64             mInputSampleRate = 0.0;
+    Float64             mOutputSampleRate = 0.0;
+    // Input frames per output frame.
+    Float64             mStep = 1.0;
+    UInt32              mTaps = 0;
+    // The filter's cutoff, in cycles per input frame, and its Kaiser window's beta.
+    Float64             mCutoff = 0.0;
+    Float64             mKaiserBeta = 0.0;
+
+    // (kPhases + 1) rows of mTaps coefficients. Row p is for output frames p/kPhases of an input
+    // frame after the input frame they're aligned with. The extra row is for interpolating past the
+    // last phase.
+    std::vector<Float32> mFilter;
+    // mFilter's row p + 1 minus row p, for each of the first kPhases rows.
+    std::vector<Float32> mFilterDeltas;
+    // The coefficients interpolated for the current output frame, if there aren't two channels.
+    std::vector<Float32> mInterpolatedFilter;
+
+    // The input frames that will still be needed, one deinterleaved array per channel. The
+    // converter's position is mPosition frames into these.
+    std::vector<std::vector<Float32>> mHistory;
+    UInt32              mHistoryFrames = 0;
+    Float64             mPosition = 0.0;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMApp__BGMSampleRateConverter */
+
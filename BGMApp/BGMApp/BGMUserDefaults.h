@@ -26,6 +26,7 @@
 //
 
 // Local Includes
+#import "BGMAudioDeviceManager.h"
 #import "BGMStatusBarItem.h"
 
 // System Includes
@@ -53,6 +54,24 @@
 // BGMApp's main menu.)
 @property BGMStatusBarIcon statusBarIcon;
 
+// The settings for recording the system mix. See BGMAudioDeviceManager and BGMRecorder.
+//
+// The path of the directory to save recordings in. If nil, they're saved in ~/Music/Background
+// Music Recordings.
+@property NSString* __nullable recordingDirectory;
+@property BGMRecordingFileType recordingFileType;
+@property BGMRecordingSampleFormat recordingSampleFormat;
+// Start a new file when the current one reaches this size/length. 0 for no limit, except that WAV
+// files can't be larger than 4 GiB. For FLAC files, the size limit applies to the audio before it's
+// compressed.
+@property NSInteger recordingMaxFileMegabytes;
+@property NSInteger recordingMaxFileMinutes;
+
+// The sample rate, in Hz, to keep BGMDevice at regardless of the output device's sample rate, so
+// changing output devices doesn't interrupt other apps' audio. 0 (the default) to make BGMDevice
+// match the output device. See BGMPlayThrough::SetFixedInputSampleRate.
+@property NSInteger fixedSampleRate;
+
 // The auth code we're required to send when connecting to GPMDP. Stored in the keychain. Reading
 // this property is thread-safe, but writing it isn't.
 //
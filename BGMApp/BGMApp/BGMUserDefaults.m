@@ -34,6 +34,12 @@ static NSString* const kDefaultKeyAutoPauseMusicEnabled = @"AutoPauseMusicEnable
 static NSString* const kDefaultKeySelectedMusicPlayerID = @"SelectedMusicPlayerID";
 static NSString* const kDefaultKeyPreferredDeviceUIDs   = @"PreferredDeviceUIDs";
 static NSString* const kDefaultKeyStatusBarIcon         = @"StatusBarIcon";
+static NSString* const kDefaultKeyRecordingDirectory    = @"RecordingDirectory";
+static NSString* const kDefaultKeyRecordingFileType     = @"RecordingFileType";
+static NSString* const kDefaultKeyRecordingSampleFormat = @"RecordingSampleFormat";
+static NSString* const kDefaultKeyRecordingMaxFileMB    = @"RecordingMaxFileMegabytes";
+static NSString* const kDefaultKeyRecordingMaxFileMins  = @"RecordingMaxFileMinutes";
+static NSString* const kDefaultKeyFixedSampleRate       = @"FixedSampleRate";
 
 // Labels for Keychain Data
 static NSString* const kKeychainLabelGPMDPAuthCode =
@@ -57,7 +63,8 @@ static NSString* const kKeychainLabelGPMDPAuthCode =
         // here so we know when it's never been set. (If it hasn't, we try using BGMDevice's
         // kAudioDeviceCustomPropertyMusicPlayerBundleID property to tell which music player should
         // be selected. See BGMMusicPlayers.)
-        NSDictionary* defaultsDict = @{ kDefaultKeyAutoPauseMusicEnabled: @YES };
+        NSDictionary* defaultsDict = @{ kDefaultKeyAutoPauseMusicEnabled: @YES,
+                                        kDefaultKeyRecordingMaxFileMins: @60 };
 
         if (defaults) {
             [defaults registerDefaults:defaultsDict];
@@ -114,6 +121,75 @@ static NSString* const kKeychainLabelGPMDPAuthCode =
     [self setInt:kDefaultKeyStatusBarIcon to:icon];
 }
 
+#pragma mark Recording
+
+- (NSString* __nullable) recordingDirectory {
+    return [self get:kDefaultKeyRecordingDirectory];
+}
+
+- (void) setRecordingDirectory:(NSString* __nullable)recordingDirectory {
+    [self set:kDefaultKeyRecordingDirectory to:recordingDirectory];
+}
+
+- (BGMRecordingFileType) recordingFileType {
+    NSInteger fileType = [self getInt:kDefaultKeyRecordingFileType or:BGMRecordingFileTypeWAV];
+
+    switch (fileType) {
+        case BGMRecordingFileTypeCAF:
+        case BGMRecordingFileTypeFLAC:
+            return (BGMRecordingFileType)fileType;
+        default:
+            return BGMRecordingFileTypeWAV;
+    }
+}
+
+- (void) setRecordingFileType:(BGMRecordingFileType)fileType {
+    [self setInt:kDefaultKeyRecordingFileType to:fileType];
+}
+
+- (BGMRecordingSampleFormat) recordingSampleFormat {
+    NSInteger format = [self getInt:kDefaultKeyRecordingSampleFormat
+                                 or:BGMRecordingSampleFormatInt24];
+
+    // Just in case we get an invalid value somehow.
+    if ((format < BGMRecordingSampleFormatInt16) || (format > BGMRecordingSampleFormatFloat32)) {
+        NSLog(@"BGMUserDefaults::recordingSampleFormat: Unknown format: %ld", (long)format);
+        format = BGMRecordingSampleFormatInt24;
+    }
+
+    return (BGMRecordingSampleFormat)format;
+}
+
+- (void) setRecordingSampleFormat:(BGMRecordingSampleFormat)format {
+    [self setInt:kDefaultKeyRecordingSampleFormat to:format];
+}
+
+- (NSInteger) recordingMaxFileMegabytes {
+    return MAX(0, [self getInt:kDefaultKeyRecordingMaxFileMB or:0]);
+}
+
+- (void) setRecordingMaxFileMegabytes:(NSInteger)megabytes {
+    [self setInt:kDefaultKeyRecordingMaxFileMB to:megabytes];
+}
+
+- (NSInteger) recordingMaxFileMinutes {
+    return MAX(0, [self getInt:kDefaultKeyRecordingMaxFileMins or:60]);
+}
+
+- (void) setRecordingMaxFileMinutes:(NSInteger)minutes {
+    [self setInt:kDefaultKeyRecordingMaxFileMins to:minutes];
+}
+
+#pragma mark Sample Rate
+
+- (NSInteger) fixedSampleRate {
+    return MAX(0, [self getInt:kDefaultKeyFixedSampleRate or:0]);
+}
+
+- (void) setFixedSampleRate:(NSInteger)sampleRate {
+    [self setInt:kDefaultKeyFixedSampleRate to:sampleRate];
+}
+
 #pragma mark Google Play Music Desktop Player
 
 - (NSString* __nullable) googlePlayMusicDesktopPlayerPermanentAuthCode {
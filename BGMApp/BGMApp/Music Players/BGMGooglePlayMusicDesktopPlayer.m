@@ -38,7 +38,8 @@
 @implementation BGMGooglePlayMusicDesktopPlayer {
     BGMUserDefaults* userDefaults;
     BGMGooglePlayMusicDesktopPlayerConnection* connection;
-    BGMAppWatcher* appWatcher;
+    // Only used while GPMDP is the selected music player.
+    BGMAppWatcher* __nullable appWatcher;
 
     // True while the auth code dialog is open. The user types in the four-digit auth code from
     // GPMDP when we connect to it for the first time.
@@ -83,17 +84,8 @@
                [strongSelf showAPIVersionMismatchDialog:reportedAPIVersion];
            }];
 
-        // Set up callbacks that run when GPMDP is opened or closed.
-        appWatcher = [[BGMAppWatcher alloc]
-                initWithBundleID:BGMNN(self.bundleID)
-                     appLaunched:^{
-                         BGMGooglePlayMusicDesktopPlayer* strongSelf = weakSelf;
-                         [strongSelf gpmdpWasLaunched];
-                     }
-                   appTerminated:^{
-                       BGMGooglePlayMusicDesktopPlayer* strongSelf = weakSelf;
-                       [strongSelf gpmdpWasTerminated];
-                   }];
+        // The app watcher is only created while GPMDP is selected. See wasSelected.
+        appWatcher = nil;
     }
     
     return self;
@@ -130,6 +122,21 @@
     // it last time.
     authCancelled = NO;
 
+    // Set up callbacks that run when GPMDP is opened or closed. They only do anything while GPMDP
+    // is selected, so there's no need to watch for it otherwise.
+    BGMGooglePlayMusicDesktopPlayer* __weak weakSelf = self;
+
+    appWatcher = [[BGMAppWatcher alloc]
+            initWithBundleID:BGMNN(self.bundleID)
+                 appLaunched:^{
+                     BGMGooglePlayMusicDesktopPlayer* strongSelf = weakSelf;
+                     [strongSelf gpmdpWasLaunched];
+                 }
+               appTerminated:^{
+                   BGMGooglePlayMusicDesktopPlayer* strongSelf = weakSelf;
+                   [strongSelf gpmdpWasTerminated];
+               }];
+
     if (self.running) {
         // Only retry once so the error message is shown fairly quickly if we fail to connect.
         [connection connectWithRetries:1];
@@ -138,6 +145,7 @@
 
 - (void) wasDeselected {
     [super wasDeselected];
+    appWatcher = nil;
     [connection disconnect];
 }
 
@@ -60,6 +60,10 @@
     return (MusicApplication*)scriptingBridge.application;
 }
 
+- (NSString* __nullable) playerStateNotificationName {
+    return @"com.apple.Music.playerInfo";
+}
+
 - (void) wasSelected {
     [super wasSelected];
     [scriptingBridge ensurePermission];
@@ -114,6 +114,16 @@
 // Returns YES if the music player is playing now but wasn't before, returns NO otherwise.
 - (BOOL) unpause;
 
+@optional
+
+// The name of the distributed notification (see NSDistributedNotificationCenter) the music player
+// posts when it starts, pauses or stops playing, if it has one. The notification's userInfo has to
+// include a "Player State" key with the value "Playing", "Paused" or "Stopped", like iTunes' does.
+//
+// BGMMusicPlayerState uses this to keep track of the music player's state without having to keep
+// sending it Apple events.
+@property (readonly) NSString* __nullable playerStateNotificationName;
+
 @end
 
 
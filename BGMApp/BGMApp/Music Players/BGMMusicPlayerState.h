@@ -0,0 +1,94 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMMusicPlayerState.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Queries and controls a music player without blocking the caller.
+//
+//  The BGMMusicPlayer methods usually send the music player app Apple events and wait for it to
+//  reply, which can take a long time if the app is busy. This class only calls them on its own
+//  serial queue and caches the results, so the last known state of the music player can be read
+//  from any thread without waiting.
+//
+//  The cached state is updated whenever the music player is queried, paused or unpaused through
+//  this class, when the music player posts its playerStateNotificationName notification (if it has
+//  one) and, while polling is started, every few seconds.
+//
+
+// Local Includes
+#import "BGMMusicPlayer.h"
+
+// System Includes
+#import <Foundation/Foundation.h>
+
+
+#pragma clang assume_nonnull begin
+
+typedef NS_ENUM(NSInteger, BGMMusicPlayerPlaybackState) {
+    // The music player hasn't been queried yet.
+    BGMMusicPlayerPlaybackStateUnknown = 0,
+    BGMMusicPlayerPlaybackStateNotRunning,
+    // Running, but neither playing nor paused.
+    BGMMusicPlayerPlaybackStateStopped,
+    BGMMusicPlayerPlaybackStatePlaying,
+    BGMMusicPlayerPlaybackStatePaused
+};
+
+@interface BGMMusicPlayerState : NSObject
+
+// Creates an instance with its own queue.
+- (instancetype) initWithMusicPlayer:(id<BGMMusicPlayer>)musicPlayer;
+
+// queue is the serial queue the music player will be queried and controlled on. The completion
+// handlers are also called on it. If this method is called on queue, the music player is queried
+// synchronously, before it returns, which lets the caller keep the order of its own pause/unpause
+// requests.
+- (instancetype) initWithMusicPlayer:(id<BGMMusicPlayer>)musicPlayer
+                               queue:(dispatch_queue_t __nullable)queue NS_DESIGNATED_INITIALIZER;
+
+- (instancetype) init NS_UNAVAILABLE;
+
+@property (readonly) id<BGMMusicPlayer> musicPlayer;
+
+// The last known state of the music player. Never blocks.
+@property (readonly) BGMMusicPlayerPlaybackState playbackState;
+// When playbackState was last updated, or nil if it hasn't been yet.
+@property (readonly) NSDate* __nullable playbackStateUpdated;
+// YES if playbackState is being kept up to date by the music player's notifications, so it can be
+// trusted without querying the music player again. The music player still has to be queried before
+// pausing/unpausing it, though, in case a notification was missed.
+@property (readonly) BOOL playbackStateFollowsNotifications;
+
+// Query the music player asynchronously and update playbackState.
+- (void) refresh;
+
+// Pause/unpause the music player asynchronously. The completion handler is called with the
+// value the music player's pause/unpause method returned, i.e. whether it was paused/unpaused.
+- (void) pauseWithCompletion:(void (^ __nullable)(BOOL didPause))completion;
+- (void) unpauseWithCompletion:(void (^ __nullable)(BOOL didUnpause))completion;
+
+// Start/stop refreshing playbackState every interval seconds and listening for the music player's
+// notifications. Polling is skipped while the notifications are keeping playbackState up to date.
+- (void) startPollingWithInterval:(NSTimeInterval)interval;
+- (void) stopPolling;
+
+@end
+
+#pragma clang assume_nonnull end
+
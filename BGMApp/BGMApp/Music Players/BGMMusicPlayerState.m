@@ -0,0 +1,325 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMMusicPlayerState.m
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#import "BGMMusicPlayerState.h"
+
+// Local Includes
+#import "BGMAppWatcher.h"
+
+// PublicUtility Includes
+#import "CADebugMacros.h"
+
+
+#pragma clang assume_nonnull begin
+
+// The key and values of the "Player State" entry in the userInfo of the music players'
+// notifications. See playerStateNotificationName in BGMMusicPlayer.h.
+static NSString* const kPlayerStateKey = @"Player State";
+static NSString* const kPlayerStatePlaying = @"Playing";
+static NSString* const kPlayerStatePaused = @"Paused";
+static NSString* const kPlayerStateStopped = @"Stopped";
+
+// How much the polling timer is allowed to be late, as a fraction of its interval. Lets the system
+// coalesce it with other timers.
+static double const kPollingLeewayFraction = 0.25;
+
+@implementation BGMMusicPlayerState {
+    dispatch_queue_t queue;
+
+    // Guarded by @synchronized(self).
+    BGMMusicPlayerPlaybackState _playbackState;
+    NSDate* __nullable _playbackStateUpdated;
+    BOOL listeningForNotifications;
+    BOOL _playbackStateFollowsNotifications;
+
+    // Only accessed on the main thread.
+    dispatch_source_t __nullable pollingTimer;
+    BGMAppWatcher* __nullable appWatcher;
+}
+
+- (instancetype) initWithMusicPlayer:(id<BGMMusicPlayer>)musicPlayer {
+    return [self initWithMusicPlayer:musicPlayer queue:nil];
+}
+
+- (instancetype) initWithMusicPlayer:(id<BGMMusicPlayer>)musicPlayer
+                               queue:(dispatch_queue_t __nullable)inQueue {
+    if ((self = [super init])) {
+        _musicPlayer = musicPlayer;
+        _playbackState = BGMMusicPlayerPlaybackStateUnknown;
+        _playbackStateUpdated = nil;
+        listeningForNotifications = NO;
+        _playbackStateFollowsNotifications = NO;
+
+        if (inQueue) {
+            queue = (dispatch_queue_t)inQueue;
+        } else {
+            queue = dispatch_queue_create("com.bearisdriving.BGM.MusicPlayerState",
+                                          DISPATCH_QUEUE_SERIAL);
+        }
+
+        // Used by dispatchToQueue: to check whether it's already running on the queue. Each
+        // instance uses its own address as the key because they can share queues.
+        dispatch_queue_set_specific(queue,
+                                    (__bridge const void*)self,
+                                    (__bridge void*)self,
+                                    NULL);
+    }
+
+    return self;
+}
+
+- (void) dealloc {
+    // Can't use stopPolling here because it might have to dispatch to the main queue.
+    if (pollingTimer) {
+        dispatch_source_cancel((dispatch_source_t)pollingTimer);
+    }
+
+    [[NSDistributedNotificationCenter defaultCenter] removeObserver:self];
+    dispatch_queue_set_specific(queue, (__bridge const void*)self, NULL, NULL);
+}
+
+#pragma mark Cached State
+
+- (BGMMusicPlayerPlaybackState) playbackState {
+    @synchronized (self) {
+        return _playbackState;
+    }
+}
+
+- (NSDate* __nullable) playbackStateUpdated {
+    @synchronized (self) {
+        return _playbackStateUpdated;
+    }
+}
+
+- (BOOL) playbackStateFollowsNotifications {
+    @synchronized (self) {
+        return _playbackStateFollowsNotifications;
+    }
+}
+
+- (void) setPlaybackState:(BGMMusicPlayerPlaybackState)playbackState
+            fromFullQuery:(BOOL)fromFullQuery {
+    @synchronized (self) {
+        _playbackState = playbackState;
+        _playbackStateUpdated = [NSDate date];
+
+        // Once we've queried the music player while listening for its notifications, the
+        // notifications will tell us about any changes.
+        if (fromFullQuery && listeningForNotifications) {
+            _playbackStateFollowsNotifications = YES;
+        }
+    }
+}
+
+#pragma mark Querying and Controlling the Music Player
+
+- (void) dispatchToQueue:(void (^)(void))block {
+    if (dispatch_get_specific((__bridge const void*)self)) {
+        block();
+    } else {
+        dispatch_async(queue, block);
+    }
+}
+
+// Must be called on the queue.
+- (void) queryMusicPlayer {
+    id<BGMMusicPlayer> musicPlayer = self.musicPlayer;
+    BGMMusicPlayerPlaybackState state;
+
+    // Check running first because querying a closed music player can launch it.
+    if (!musicPlayer.running) {
+        state = BGMMusicPlayerPlaybackStateNotRunning;
+    } else if (musicPlayer.playing) {
+        state = BGMMusicPlayerPlaybackStatePlaying;
+    } else if (musicPlayer.paused) {
+        state = BGMMusicPlayerPlaybackStatePaused;
+    } else {
+        state = BGMMusicPlayerPlaybackStateStopped;
+    }
+
+    [self setPlaybackState:state fromFullQuery:YES];
+}
+
+- (void) refresh {
+    [self dispatchToQueue:^{
+        [self queryMusicPlayer];
+    }];
+}
+
+- (void) pauseWithCompletion:(void (^ __nullable)(BOOL didPause))completion {
+    [self dispatchToQueue:^{
+        BOOL didPause = [self.musicPlayer pause];
+
+        if (didPause) {
+            [self setPlaybackState:BGMMusicPlayerPlaybackStatePaused fromFullQuery:NO];
+        } else if (self.playbackState == BGMMusicPlayerPlaybackStatePlaying) {
+            // We thought it was playing, so we were wrong about something.
+            [self queryMusicPlayer];
+        }
+
+        if (completion) {
+            completion(didPause);
+        }
+    }];
+}
+
+- (void) unpauseWithCompletion:(void (^ __nullable)(BOOL didUnpause))completion {
+    [self dispatchToQueue:^{
+        BOOL didUnpause = [self.musicPlayer unpause];
+
+        if (didUnpause) {
+            [self setPlaybackState:BGMMusicPlayerPlaybackStatePlaying fromFullQuery:NO];
+        } else if (self.playbackState == BGMMusicPlayerPlaybackStatePaused) {
+            [self queryMusicPlayer];
+        }
+
+        if (completion) {
+            completion(didUnpause);
+        }
+    }];
+}
+
+#pragma mark Polling
+
+- (void) startPollingWithInterval:(NSTimeInterval)interval {
+    if (![NSThread isMainThread]) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self startPollingWithInterval:interval];
+        });
+        return;
+    }
+
+    if (pollingTimer) {
+        return;
+    }
+
+    DebugMsg("BGMMusicPlayerState::startPollingWithInterval: Polling %s every %f seconds",
+             self.musicPlayer.name.UTF8String,
+             interval);
+
+    [self startListeningForNotifications];
+
+    // Avoid a retain cycle. The timer is cancelled when this object is destroyed.
+    BGMMusicPlayerState* __weak weakSelf = self;
+
+    pollingTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
+    dispatch_source_set_timer((dispatch_source_t)pollingTimer,
+                              dispatch_time(DISPATCH_TIME_NOW, 0),
+                              (uint64_t)(interval * NSEC_PER_SEC),
+                              (uint64_t)(interval * kPollingLeewayFraction * NSEC_PER_SEC));
+    dispatch_source_set_event_handler((dispatch_source_t)pollingTimer, ^{
+        BGMMusicPlayerState* __nullable strongSelf = weakSelf;
+
+        // Skip the Apple events if the notifications are keeping the state up to date.
+        if (strongSelf && !strongSelf.playbackStateFollowsNotifications) {
+            [strongSelf queryMusicPlayer];
+        }
+    });
+    dispatch_resume((dispatch_source_t)pollingTimer);
+}
+
+- (void) stopPolling {
+    if (![NSThread isMainThread]) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self stopPolling];
+        });
+        return;
+    }
+
+    if (pollingTimer) {
+        dispatch_source_cancel((dispatch_source_t)pollingTimer);
+        pollingTimer = nil;
+    }
+
+    [self stopListeningForNotifications];
+}
+
+#pragma mark Notifications
+
+- (void) startListeningForNotifications {
+    id<BGMMusicPlayer> musicPlayer = self.musicPlayer;
+
+    if ([musicPlayer respondsToSelector:@selector(playerStateNotificationName)] &&
+            musicPlayer.playerStateNotificationName) {
+        [[NSDistributedNotificationCenter defaultCenter]
+                addObserver:self
+                   selector:@selector(playerStateChanged:)
+                       name:musicPlayer.playerStateNotificationName
+                     object:nil];
+
+        @synchronized (self) {
+            listeningForNotifications = YES;
+        }
+    }
+
+    // The notifications don't tell us when the music player is launched or quits.
+    NSString* __nullable bundleID = musicPlayer.bundleID;
+
+    if (bundleID) {
+        BGMMusicPlayerState* __weak weakSelf = self;
+
+        appWatcher = [[BGMAppWatcher alloc] initWithBundleID:(NSString*)bundleID
+                                                 appLaunched:^{
+                                                     [weakSelf refresh];
+                                                 }
+                                               appTerminated:^{
+                                                   [weakSelf setPlaybackState:BGMMusicPlayerPlaybackStateNotRunning
+                                                                fromFullQuery:NO];
+                                               }];
+    }
+}
+
+- (void) stopListeningForNotifications {
+    [[NSDistributedNotificationCenter defaultCenter] removeObserver:self];
+    appWatcher = nil;
+
+    @synchronized (self) {
+        listeningForNotifications = NO;
+        _playbackStateFollowsNotifications = NO;
+    }
+}
+
+- (void) playerStateChanged:(NSNotification*)notification {
+    id __nullable playerState = notification.userInfo[kPlayerStateKey];
+
+    DebugMsg("BGMMusicPlayerState::playerStateChanged: %s Player State: %s",
+             self.musicPlayer.name.UTF8String,
+             [playerState description].UTF8String);
+
+    if ([kPlayerStatePlaying isEqual:playerState]) {
+        [self setPlaybackState:BGMMusicPlayerPlaybackStatePlaying fromFullQuery:NO];
+    } else if ([kPlayerStatePaused isEqual:playerState]) {
+        [self setPlaybackState:BGMMusicPlayerPlaybackStatePaused fromFullQuery:NO];
+    } else if ([kPlayerStateStopped isEqual:playerState]) {
+        [self setPlaybackState:BGMMusicPlayerPlaybackStateStopped fromFullQuery:NO];
+    } else {
+        // We don't know what this means, so ask the music player.
+        [self refresh];
+    }
+}
+
+@end
+
+#pragma clang assume_nonnull end
+
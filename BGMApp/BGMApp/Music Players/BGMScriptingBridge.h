@@ -46,6 +46,9 @@
 
 // If the music player application is running, this property is the Scripting Bridge object representing
 // it. If not, it's set to nil. Used to send Apple events to the music player app.
+//
+// The SBApplication isn't created, and we don't start watching for the app being launched, until
+// the first time this property is read or ensurePermission is called.
 @property (readonly) __kindof SBApplication* __nullable application;
 
 // macOS 10.14 requires the user's permission to send Apple Events. If the music player that owns
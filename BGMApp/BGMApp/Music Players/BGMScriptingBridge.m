@@ -35,7 +35,9 @@
 
 @implementation BGMScriptingBridge {
     id<BGMMusicPlayer> __weak _musicPlayer;
-    BGMAppWatcher* appWatcher;
+    BGMAppWatcher* __nullable appWatcher;
+    // Guarded by @synchronized(self).
+    BOOL initialised;
 }
 
 @synthesize application = _application;
@@ -43,13 +45,30 @@
 - (instancetype) initWithMusicPlayer:(id<BGMMusicPlayer>)musicPlayer {
     if ((self = [super init])) {
         _musicPlayer = musicPlayer;
-        
-        [self initApplication];
+        initialised = NO;
+
+        // BGMApp creates an instance of every music player class at launch, but usually only uses
+        // one of them, so we wait until the first time the SBApplication is needed to create it
+        // and the app watcher.
     }
     
     return self;
 }
 
+- (__kindof SBApplication* __nullable) application {
+    [self initApplicationIfNeeded];
+    return _application;
+}
+
+- (void) initApplicationIfNeeded {
+    @synchronized (self) {
+        if (!initialised) {
+            initialised = YES;
+            [self initApplication];
+        }
+    }
+}
+
 - (void) initApplication {
     NSString* bundleID = _musicPlayer.bundleID;
     BGMAssert(bundleID, "Music players need a bundle ID to use ScriptingBridge");
@@ -95,6 +114,8 @@
 }
 
 - (void) ensurePermission {
+    [self initApplicationIfNeeded];
+
     // Skip this check if running on a version of macOS before 10.14. In that case, we don't require
     // user permission to send Apple Events. Also skip it if compiling on an earlier version.
 #if MAC_OS_X_VERSION_MAX_ALLOWED >= 101400  // MAC_OS_X_VERSION_10_14
@@ -57,6 +57,10 @@
     return (SpotifyApplication* __nullable)scriptingBridge.application;
 }
 
+- (NSString* __nullable) playerStateNotificationName {
+    return @"com.spotify.client.PlaybackStateChanged";
+}
+
 - (void) wasSelected {
     [super wasSelected];
     [scriptingBridge ensurePermission];
@@ -59,6 +59,10 @@
     return (iTunesApplication*)scriptingBridge.application;
 }
 
+- (NSString* __nullable) playerStateNotificationName {
+    return @"com.apple.iTunes.playerInfo";
+}
+
 - (void) wasSelected {
     [super wasSelected];
     [scriptingBridge ensurePermission];
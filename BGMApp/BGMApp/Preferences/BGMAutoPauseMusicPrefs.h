@@ -30,7 +30,7 @@
 
 #pragma clang assume_nonnull begin
 
-@interface BGMAutoPauseMusicPrefs : NSObject
+@interface BGMAutoPauseMusicPrefs : NSObject <NSMenuDelegate>
 
 - (id) initWithPreferencesMenu:(NSMenu*)inPrefsMenu
                   audioDevices:(BGMAudioDeviceManager*)inAudioDevices
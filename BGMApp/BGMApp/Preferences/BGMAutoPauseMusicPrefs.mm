@@ -38,6 +38,7 @@ static NSInteger const kPrefsMenuAutoPauseHeaderTag = 1;
     BGMMusicPlayers* musicPlayers;
     NSMenu* prefsMenu;
     NSArray<NSMenuItem*>* musicPlayerMenuItems;
+    BOOL loadedIcons;
 }
 
 - (id) initWithPreferencesMenu:(NSMenu*)inPrefsMenu
@@ -49,8 +50,13 @@ static NSInteger const kPrefsMenuAutoPauseHeaderTag = 1;
         musicPlayers = inMusicPlayers;
         
         musicPlayerMenuItems = @[];
+        loadedIcons = NO;
         
         [self initPreferencesMenuSection];
+
+        // Load the music players' icons when the menu is first opened, rather than at launch.
+        // Finding them means asking Launch Services where each music player app is installed.
+        prefsMenu.delegate = self;
     }
     
     return self;
@@ -81,6 +87,15 @@ static NSInteger const kPrefsMenuAutoPauseHeaderTag = 1;
             menuItem.state = NSOnState;
         }
         
+        menuItem.target = self;
+        menuItem.indentationLevel = 1;
+    }
+}
+
+- (void) loadIcons {
+    for (NSMenuItem* menuItem in musicPlayerMenuItems) {
+        id<BGMMusicPlayer> musicPlayer = menuItem.representedObject;
+
         // Set the menu item's icon
         NSImage* __nullable icon = musicPlayer.icon;
         if (icon == nil) {
@@ -92,10 +107,9 @@ static NSInteger const kPrefsMenuAutoPauseHeaderTag = 1;
         CGFloat length = [NSFont menuBarFontOfSize:0].pointSize * kMenuItemIconScalingFactor;
         icon.size = NSMakeSize(length, length);
         menuItem.image = icon;
-        
-        menuItem.target = self;
-        menuItem.indentationLevel = 1;
     }
+
+    loadedIcons = YES;
 }
 
 - (void) handleMusicPlayerChange:(NSMenuItem*)sender {
@@ -112,6 +126,16 @@ static NSInteger const kPrefsMenuAutoPauseHeaderTag = 1;
     }
 }
 
+#pragma mark NSMenuDelegate
+
+- (void) menuNeedsUpdate:(NSMenu*)menu {
+    #pragma unused (menu)
+
+    if (!loadedIcons) {
+        [self loadIcons];
+    }
+}
+
 @end
 
 #pragma clang assume_nonnull end
@@ -37,6 +37,7 @@
 
 @property BGMASOutputDevice* selectedOutputDevice;
 @property (readonly) NSArray<BGMASOutputDevice*>* outputDevices;
+@property BOOL recording;
 
 @end
 
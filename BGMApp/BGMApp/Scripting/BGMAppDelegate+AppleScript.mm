@@ -24,6 +24,7 @@
 #import "BGMAppDelegate+AppleScript.h"
 
 // Local Includes
+#import "BGM_Utils.h"
 #import "BGMAudioDevice.h"
 
 // PublicUtility Includes
@@ -43,7 +44,7 @@
                  [key UTF8String]);
     }
 
-    return [@[@"selectedOutputDevice", @"outputDevices"] containsObject:key];
+    return [@[@"selectedOutputDevice", @"outputDevices", @"recording"] containsObject:key];
 }
 
 - (BGMASOutputDevice*) selectedOutputDevice {
@@ -83,6 +84,54 @@
     return outputDevices;
 }
 
+- (BOOL) recording {
+    return [self.audioDevices isRecording];
+}
+
+- (void) setRecording:(BOOL)recording {
+    if (!recording) {
+        [self.audioDevices stopRecording];
+        return;
+    }
+
+    if ([self.audioDevices isRecording]) {
+        return;
+    }
+
+    BGMUserDefaults* defaults = self.userDefaults;
+    NSString* __nullable directoryPath = defaults.recordingDirectory;
+    NSURL* directory =
+            [NSURL fileURLWithPath:(directoryPath ?
+                                    BGMNN(directoryPath) :
+                                    [NSHomeDirectory() stringByAppendingPathComponent:
+                                                           @"Music/Background Music Recordings"])
+                       isDirectory:YES];
+
+    NSError* __nullable error = nil;
+    [[NSFileManager defaultManager] createDirectoryAtURL:directory
+                             withIntermediateDirectories:YES
+                                              attributes:nil
+                                                   error:&error];
+
+    if (!error) {
+        error = [self.audioDevices
+                 startRecordingToDirectory:directory
+                                  fileType:defaults.recordingFileType
+                              sampleFormat:defaults.recordingSampleFormat
+                              maxFileBytes:static_cast<UInt64>(defaults.recordingMaxFileMegabytes) * 1000 * 1000
+                            maxFileSeconds:static_cast<UInt32>(defaults.recordingMaxFileMinutes) * 60];
+    }
+
+    if (error) {
+        NSLog(@"BGMAppDelegate::setRecording: Failed to start recording: %@", error);
+
+        NSScriptCommand* __nullable command = [NSScriptCommand currentCommand];
+        command.scriptErrorNumber = static_cast<int>(error.code);
+        command.scriptErrorString =
+                [NSString stringWithFormat:@"Failed to start recording to %@", directory.path];
+    }
+}
+
 @end
 
 #pragma clang assume_nonnull end
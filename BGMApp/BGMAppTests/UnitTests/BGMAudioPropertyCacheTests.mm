@@ -0,0 +1,224 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMAudioPropertyCacheTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#import "BGMAudioPropertyCache.h"
+
+// Local Includes
+#import "MockAudioDevice.h"
+#import "MockAudioObjects.h"
+
+// BGM Includes
+#import "BGMAudioDevice.h"
+
+// PublicUtility Includes
+#import "CAException.h"
+#import "CAPropertyAddress.h"
+
+// STL Includes
+#import <memory>
+
+// System Includes
+#import <XCTest/XCTest.h>
+
+
+@interface BGMAudioPropertyCacheTests : XCTestCase
+
+@end
+
+@implementation BGMAudioPropertyCacheTests {
+    // Most of the tests use their own cache, rather than the shared one, so they start empty.
+    std::unique_ptr<BGMAudioPropertyCache> cache;
+    std::shared_ptr<MockAudioDevice> mockDevice;
+}
+
+- (void) setUp {
+    [super setUp];
+
+    mockDevice = MockAudioObjects::CreateMockDevice("Mock Device");
+    cache.reset(new BGMAudioPropertyCache);
+}
+
+- (void) tearDown {
+    // Destroy the cache first so it removes its listeners from the mocks.
+    cache.reset();
+    MockAudioObjects::DestroyMocks();
+
+    [super tearDown];
+}
+
+- (UInt32) requestsFor:(AudioObjectPropertySelector)selector {
+    return mockDevice->mPropertyDataRequests[selector];
+}
+
+- (void) testCachesValues {
+    const CAPropertyAddress address(kAudioDevicePropertyBufferFrameSize);
+
+    XCTAssertEqual(512, cache->GetValue<UInt32>(mockDevice->GetObjectID(), address));
+    XCTAssertEqual(512, cache->GetValue<UInt32>(mockDevice->GetObjectID(), address));
+
+    // It should only have asked the HAL once.
+    XCTAssertEqual(1, [self requestsFor:kAudioDevicePropertyBufferFrameSize]);
+
+    BGMAudioPropertyCache::Statistics stats = cache->GetStatistics();
+    XCTAssertEqual(1, stats.mHits);
+    XCTAssertEqual(1, stats.mMisses);
+    XCTAssertEqual(0, stats.mInvalidations);
+}
+
+- (void) testCachesCFValues {
+    const CAPropertyAddress address(kAudioObjectPropertyName);
+
+    for(int i = 0; i < 2; i++)
+    {
+        CFStringRef name =
+                static_cast<CFStringRef>(cache->CopyCFValue(mockDevice->GetObjectID(), address));
+        XCTAssertEqualObjects(@"Mock Device", (__bridge NSString*)name);
+        CFRelease(name);
+    }
+
+    XCTAssertEqual(1, [self requestsFor:kAudioObjectPropertyName]);
+}
+
+- (void) testInvalidatesWhenPropertyChanges {
+    const CAPropertyAddress address(kAudioDevicePropertyBufferFrameSize);
+
+    XCTAssertEqual(512, cache->GetValue<UInt32>(mockDevice->GetObjectID(), address));
+
+    // The cache should be listening for changes to the property.
+    XCTAssertEqual(1, mockDevice->mPropertiesWithListeners.count(kAudioDevicePropertyBufferFrameSize));
+
+    // Change the property. The mock calls the listeners synchronously.
+    BGMAudioDevice(mockDevice->GetObjectID()).SetIOBufferSize(256);
+
+    XCTAssertEqual(256, cache->GetValue<UInt32>(mockDevice->GetObjectID(), address));
+    XCTAssertEqual(2, [self requestsFor:kAudioDevicePropertyBufferFrameSize]);
+    XCTAssertEqual(1, cache->GetStatistics().mInvalidations);
+}
+
+- (void) testOnlyInvalidatesChangedProperty {
+    const CAPropertyAddress bufferSizeAddress(kAudioDevicePropertyBufferFrameSize);
+    const CAPropertyAddress sampleRateAddress(kAudioDevicePropertyNominalSampleRate);
+
+    cache->GetValue<UInt32>(mockDevice->GetObjectID(), bufferSizeAddress);
+    cache->GetValue<Float64>(mockDevice->GetObjectID(), sampleRateAddress);
+
+    BGMAudioDevice(mockDevice->GetObjectID()).SetNominalSampleRate(48000.0);
+
+    XCTAssertEqual(512, cache->GetValue<UInt32>(mockDevice->GetObjectID(), bufferSizeAddress));
+    XCTAssertEqual(48000.0, cache->GetValue<Float64>(mockDevice->GetObjectID(), sampleRateAddress));
+
+    XCTAssertEqual(1, [self requestsFor:kAudioDevicePropertyBufferFrameSize]);
+    XCTAssertEqual(2, [self requestsFor:kAudioDevicePropertyNominalSampleRate]);
+}
+
+- (void) testConstantPropertiesDontAddListeners {
+    CFStringRef uid = static_cast<CFStringRef>(
+            cache->CopyCFValue(mockDevice->GetObjectID(), CAPropertyAddress(kAudioDevicePropertyDeviceUID)));
+    XCTAssertEqualObjects(@"Mock Device", (__bridge NSString*)uid);
+    CFRelease(uid);
+
+    cache->GetValue<UInt32>(mockDevice->GetObjectID(),
+                            CAPropertyAddress(kAudioDevicePropertyTransportType));
+
+    XCTAssert(mockDevice->mPropertiesWithListeners.empty());
+
+    // They should still be cached.
+    cache->GetValue<UInt32>(mockDevice->GetObjectID(),
+                            CAPropertyAddress(kAudioDevicePropertyTransportType));
+    XCTAssertEqual(1, [self requestsFor:kAudioDevicePropertyTransportType]);
+}
+
+- (void) testDeviceHasChanged {
+    const CAPropertyAddress address(kAudioDevicePropertyBufferFrameSize);
+
+    cache->GetValue<UInt32>(mockDevice->GetObjectID(), address);
+
+    // Change the value without notifying the listeners for the property itself.
+    mockDevice->mIOBufferSize = 1024;
+    mockDevice->NotifyPropertyListeners(kAudioDevicePropertyDeviceHasChanged);
+
+    XCTAssertEqual(1024, cache->GetValue<UInt32>(mockDevice->GetObjectID(), address));
+}
+
+- (void) testRemovesValuesOfRemovedDevices {
+    const CAPropertyAddress address(kAudioDevicePropertyBufferFrameSize);
+
+    cache->GetValue<UInt32>(mockDevice->GetObjectID(), address);
+
+    // Remove the device and create a new one with the same ID. (The mocks' IDs are derived from
+    // their UIDs.)
+    MockAudioObjects::DestroyMocks();
+    mockDevice = MockAudioObjects::CreateMockDevice("Mock Device");
+    mockDevice->mIOBufferSize = 64;
+
+    XCTAssertEqual(64, cache->GetValue<UInt32>(mockDevice->GetObjectID(), address));
+}
+
+- (void) testErrorsAreNotCached {
+    // The mock HAL doesn't implement this property, so it returns an error.
+    const CAPropertyAddress address(kAudioDevicePropertyLatency);
+
+    for(int i = 0; i < 2; i++)
+    {
+        try
+        {
+            cache->GetValue<UInt32>(mockDevice->GetObjectID(), address);
+            XCTFail("Expected an exception");
+        }
+        catch(CAException e)
+        {
+            XCTAssertEqual(kAudio_UnimplementedError, e.GetError());
+        }
+        catch(CAException* e)
+        {
+            XCTAssertEqual(kAudio_UnimplementedError, e->GetError());
+            delete e;
+        }
+    }
+
+    XCTAssertEqual(2, [self requestsFor:kAudioDevicePropertyLatency]);
+}
+
+- (void) testCanBeOutputDeviceInBGMApp {
+    // This uses the shared cache.
+    BGMAudioDevice device(mockDevice->GetObjectID());
+
+    XCTAssert(device.CanBeOutputDeviceInBGMApp());
+
+    const UInt32 hiddenRequests = [self requestsFor:kAudioDevicePropertyIsHidden];
+    const UInt32 configRequests = [self requestsFor:kAudioDevicePropertyStreamConfiguration];
+
+    // Checking again shouldn't have to query the HAL.
+    XCTAssert(device.CanBeOutputDeviceInBGMApp());
+    XCTAssertEqual(hiddenRequests, [self requestsFor:kAudioDevicePropertyIsHidden]);
+    XCTAssertEqual(configRequests, [self requestsFor:kAudioDevicePropertyStreamConfiguration]);
+
+    // Hide the device.
+    mockDevice->mIsHidden = true;
+    mockDevice->NotifyPropertyListeners(kAudioDevicePropertyIsHidden);
+
+    XCTAssertFalse(device.CanBeOutputDeviceInBGMApp());
+}
+
+@end
+
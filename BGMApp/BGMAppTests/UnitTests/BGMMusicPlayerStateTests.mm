@@ -0,0 +1,272 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMMusicPlayerStateTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#import "BGMMusicPlayerState.h"
+
+// Local Includes
+#import "BGMMusicPlayer.h"
+
+// System Includes
+#import <XCTest/XCTest.h>
+
+
+// How long the stub music player takes to respond to each query, like a busy music player app
+// replying to an Apple event.
+static NSTimeInterval const kStubResponseDelaySecs = 0.2;
+
+// A music player that's slow to respond and records how long it blocks the main thread for.
+@interface BGMSlowMusicPlayerStub : BGMMusicPlayerBase<BGMMusicPlayer>
+
+@property BOOL stubRunning;
+@property BOOL stubPlaying;
+@property BOOL stubPaused;
+
+// The number of times the music player has been queried or controlled.
+@property (readonly) NSUInteger requestCount;
+// The total time spent responding to requests made on the main thread.
+@property (readonly) NSTimeInterval mainThreadBlockedSecs;
+
+@end
+
+@implementation BGMSlowMusicPlayerStub {
+    NSString* notificationName;
+}
+
+- (instancetype) init {
+    if ((self = [super initWithMusicPlayerID:[NSUUID UUID]
+                                        name:@"Slow Music Player Stub"
+                                    bundleID:nil])) {
+        _stubRunning = YES;
+        _stubPlaying = YES;
+        _stubPaused = NO;
+
+        // Unique to this instance so other tests' notifications can't affect it.
+        notificationName = [NSString stringWithFormat:@"com.bearisdriving.BGM.UnitTests.%@",
+                               self.musicPlayerID.UUIDString];
+    }
+
+    return self;
+}
+
+- (void) respond {
+    NSDate* start = [NSDate date];
+    [NSThread sleepForTimeInterval:kStubResponseDelaySecs];
+
+    @synchronized (self) {
+        _requestCount++;
+
+        if ([NSThread isMainThread]) {
+            _mainThreadBlockedSecs += -[start timeIntervalSinceNow];
+        }
+    }
+}
+
+- (NSString* __nullable) playerStateNotificationName {
+    return notificationName;
+}
+
+- (BOOL) isRunning {
+    [self respond];
+    return self.stubRunning;
+}
+
+- (BOOL) isPlaying {
+    [self respond];
+    return self.stubRunning && self.stubPlaying;
+}
+
+- (BOOL) isPaused {
+    [self respond];
+    return self.stubRunning && self.stubPaused;
+}
+
+- (BOOL) pause {
+    BOOL wasPlaying = self.playing;
+
+    if (wasPlaying) {
+        self.stubPlaying = NO;
+        self.stubPaused = YES;
+    }
+
+    return wasPlaying;
+}
+
+- (BOOL) unpause {
+    BOOL wasPaused = self.paused;
+
+    if (wasPaused) {
+        self.stubPlaying = YES;
+        self.stubPaused = NO;
+    }
+
+    return wasPaused;
+}
+
+@end
+
+// -------------------------------------------------------------------------------------------------
+
+@interface BGMMusicPlayerStateTests : XCTestCase
+@end
+
+@implementation BGMMusicPlayerStateTests {
+    BGMSlowMusicPlayerStub* player;
+    dispatch_queue_t queue;
+    BGMMusicPlayerState* state;
+}
+
+- (void) setUp {
+    [super setUp];
+
+    player = [BGMSlowMusicPlayerStub new];
+    queue = dispatch_queue_create("com.bearisdriving.BGM.UnitTests.MusicPlayerState",
+                                  DISPATCH_QUEUE_SERIAL);
+    state = [[BGMMusicPlayerState alloc] initWithMusicPlayer:player queue:queue];
+}
+
+- (void) tearDown {
+    [state stopPolling];
+    [super tearDown];
+}
+
+// Wait for the blocks already dispatched to the queue to finish.
+- (void) waitForQueue {
+    dispatch_sync(queue, ^{});
+}
+
+- (void) testDoesntBlockMainThread {
+    XCTestExpectation* paused = [self expectationWithDescription:@"Paused"];
+    __block BOOL didPause = NO;
+
+    NSDate* start = [NSDate date];
+
+    [state refresh];
+    [state pauseWithCompletion:^(BOOL result) {
+        didPause = result;
+        [paused fulfill];
+    }];
+    [state unpauseWithCompletion:nil];
+    // Reading the cached state should never wait for the music player.
+    (void)state.playbackState;
+
+    // Those calls would have taken at least 4 * kStubResponseDelaySecs if they'd been synchronous.
+    XCTAssertLessThan(-[start timeIntervalSinceNow], kStubResponseDelaySecs);
+
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+    [self waitForQueue];
+
+    XCTAssertTrue(didPause);
+    XCTAssertEqual(state.playbackState, BGMMusicPlayerPlaybackStatePlaying);
+    XCTAssertGreaterThan(player.requestCount, 0);
+    XCTAssertEqual(player.mainThreadBlockedSecs, 0);
+}
+
+- (void) testCachesState {
+    XCTAssertEqual(state.playbackState, BGMMusicPlayerPlaybackStateUnknown);
+    XCTAssertNil(state.playbackStateUpdated);
+
+    NSDate* beforeRefresh = [NSDate date];
+    [state refresh];
+    [self waitForQueue];
+
+    XCTAssertEqual(state.playbackState, BGMMusicPlayerPlaybackStatePlaying);
+    XCTAssertNotNil(state.playbackStateUpdated);
+    XCTAssertGreaterThanOrEqual([state.playbackStateUpdated timeIntervalSinceDate:beforeRefresh], 0);
+
+    // Reading it again shouldn't query the music player.
+    NSUInteger requestCount = player.requestCount;
+    XCTAssertEqual(state.playbackState, BGMMusicPlayerPlaybackStatePlaying);
+    XCTAssertEqual(player.requestCount, requestCount);
+
+    player.stubRunning = NO;
+    [state refresh];
+    [self waitForQueue];
+
+    XCTAssertEqual(state.playbackState, BGMMusicPlayerPlaybackStateNotRunning);
+}
+
+- (void) testPauseAndUnpause {
+    __block BOOL didPause = NO;
+    __block BOOL didUnpause = NO;
+
+    // Called on the queue, the completion handlers should be called before the methods return.
+    dispatch_sync(queue, ^{
+        [state pauseWithCompletion:^(BOOL result) { didPause = result; }];
+        XCTAssertTrue(didPause);
+        XCTAssertEqual(state.playbackState, BGMMusicPlayerPlaybackStatePaused);
+
+        // Already paused.
+        [state pauseWithCompletion:^(BOOL result) { didPause = result; }];
+        XCTAssertFalse(didPause);
+
+        [state unpauseWithCompletion:^(BOOL result) { didUnpause = result; }];
+        XCTAssertTrue(didUnpause);
+        XCTAssertEqual(state.playbackState, BGMMusicPlayerPlaybackStatePlaying);
+    });
+
+    XCTAssertTrue(player.stubPlaying);
+}
+
+- (void) testFollowsNotifications {
+    // Use an interval long enough that the timer only fires once, when polling starts.
+    [state startPollingWithInterval:1000];
+
+    NSPredicate* followsNotifications =
+        [NSPredicate predicateWithBlock:^BOOL(BGMMusicPlayerState* evaluatedState,
+                                              NSDictionary* bindings) {
+            #pragma unused (bindings)
+            return evaluatedState.playbackStateFollowsNotifications;
+        }];
+    [self expectationForPredicate:followsNotifications evaluatedWithObject:state handler:nil];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+
+    XCTAssertEqual(state.playbackState, BGMMusicPlayerPlaybackStatePlaying);
+    NSUInteger requestCount = player.requestCount;
+
+    // Pretend the user paused the music player.
+    player.stubPlaying = NO;
+    player.stubPaused = YES;
+    [[NSDistributedNotificationCenter defaultCenter]
+            postNotificationName:(NSString*)player.playerStateNotificationName
+                          object:nil
+                        userInfo:@{ @"Player State": @"Paused" }
+              deliverImmediately:YES];
+
+    NSPredicate* isPaused =
+        [NSPredicate predicateWithBlock:^BOOL(BGMMusicPlayerState* evaluatedState,
+                                              NSDictionary* bindings) {
+            #pragma unused (bindings)
+            return evaluatedState.playbackState == BGMMusicPlayerPlaybackStatePaused;
+        }];
+    [self expectationForPredicate:isPaused evaluatedWithObject:state handler:nil];
+    [self waitForExpectationsWithTimeout:10 handler:nil];
+
+    // The state should have been updated without querying the music player.
+    XCTAssertEqual(player.requestCount, requestCount);
+
+    [state stopPolling];
+    XCTAssertFalse(state.playbackStateFollowsNotifications);
+}
+
+@end
+
@@ -0,0 +1,549 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMPlayThroughSimulationTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Runs BGMPlayThrough's IOProcs on simulated devices (see MockIOScheduler) to measure its latency,
+//  the glitches caused by clock drift and jitter, how long the audio drops out when the output
+//  device is changed and how much IO the idle suspension saves against how long it takes to wake
+//  up. The measurements are logged, so they can be compared between changes. Apart
+//  from the tests that have to run the scheduler in the background, the results only depend on
+//  these settings:
+//
+//      BGM_SIMULATION_SECONDS      How long to simulate the devices in the drift and jitter tests
+//                                  for, in virtual seconds. 10 by default.
+//      BGM_SIMULATION_DRIFT_PPM    How much faster the output device's clock runs than the input
+//                                  device's in the drift test. 1000 by default. Can be negative.
+//      BGM_SIMULATION_SEED         The seed for the jitter. 1 by default.
+//
+//  The input devices produce a ramp (see MockAudioDevice::mInputGenerator), so each output sample
+//  tells us when it was captured. Since the samples are Float32s, the sample times are only exact
+//  for about the first six minutes of a simulation.
+//
+
+// Unit Include
+#import "BGMPlayThrough.h"
+
+// Local Includes
+#import "MockAudioDevice.h"
+#import "MockAudioObjects.h"
+#import "MockIOScheduler.h"
+
+// BGM Includes
+#import "BGM_Types.h"
+#import "BGMAudioDevice.h"
+
+// STL Includes
+#import <algorithm>
+#import <cmath>
+#import <cstdlib>
+#import <chrono>
+#import <functional>
+#import <limits>
+#import <memory>
+#import <thread>
+
+// System Includes
+#import <XCTest/XCTest.h>
+
+
+static Float64 GetEnvFloat64(const char* name, Float64 defaultValue)
+{
+    const char* value = getenv(name);
+    return (value != nullptr) ? atof(value) : defaultValue;
+}
+
+// What we measured from a device's recorded output.
+struct PlayThroughStats
+{
+    // The number of frames of silence before the first audible frame.
+    size_t silentFramesBeforeAudio = 0;
+    // The virtual host times of the first and last audible frames, in seconds.
+    Float64 firstAudibleHostTime = 0.0;
+    Float64 lastAudibleHostTime = 0.0;
+    // The number of times the output skipped forward or backward in the input after it started.
+    UInt32 discontinuities = 0;
+    // The number of silent frames after the output started.
+    size_t underrunFrames = 0;
+    // The time between each frame being captured by the input device and played by the output
+    // device, in seconds.
+    Float64 minLatency = std::numeric_limits<Float64>::infinity();
+    Float64 maxLatency = 0.0;
+    Float64 finalLatency = 0.0;
+
+    bool HasAudio() const { return maxLatency > 0.0; }
+};
+
+static PlayThroughStats AnalyzeOutput(const MockAudioDevice& inputDevice,
+                                      const MockAudioDevice& outputDevice)
+{
+    PlayThroughStats stats;
+    const std::vector<Float32>& output = outputDevice.mRecordedOutput;
+    bool started = false;
+
+    for(size_t i = 0; i < output.size(); i++)
+    {
+        if(output[i] == 0.0f)
+        {
+            (started ? stats.underrunFrames : stats.silentFramesBeforeAudio)++;
+            continue;
+        }
+
+        // Each input sample is its sample time plus one. See MockAudioDevice::mInputGenerator.
+        const Float64 capturedAt = inputDevice.GetHostTimeForSampleTime(output[i] - 1.0);
+        const Float64 playedAt =
+                outputDevice.GetHostTimeForSampleTime(outputDevice.mRecordedOutputSampleTime + i);
+        const Float64 latency = playedAt - capturedAt;
+
+        if(!started)
+        {
+            stats.firstAudibleHostTime = playedAt;
+        }
+        else if(output[i] != output[i - 1] + 1.0f)
+        {
+            stats.discontinuities++;
+        }
+
+        started = true;
+        stats.lastAudibleHostTime = playedAt;
+        stats.minLatency = std::min(stats.minLatency, latency);
+        stats.maxLatency = std::max(stats.maxLatency, latency);
+        stats.finalLatency = latency;
+    }
+
+    return stats;
+}
+
+// An input generator that's silent until inAudioStartSampleTime and then produces the usual ramp.
+static std::function<void(Float64, AudioBufferList&)> SilenceThenRamp(Float64 inAudioStartSampleTime)
+{
+    return [inAudioStartSampleTime](Float64 inSampleTime, AudioBufferList& ioInputData) {
+        Float32* samples = static_cast<Float32*>(ioInputData.mBuffers[0].mData);
+        const UInt32 channels = ioInputData.mBuffers[0].mNumberChannels;
+        const UInt32 frames = ioInputData.mBuffers[0].mDataByteSize / (channels * static_cast<UInt32>(sizeof(Float32)));
+
+        for(UInt32 frame = 0; frame < frames; frame++)
+        {
+            const Float64 sampleTime = inSampleTime + frame;
+
+            for(UInt32 channel = 0; channel < channels; channel++)
+            {
+                samples[frame * channels + channel] =
+                        (sampleTime >= inAudioStartSampleTime) ? static_cast<Float32>(sampleTime + 1) : 0.0f;
+            }
+        }
+    };
+}
+
+// Sleep until inCondition returns true or inTimeoutSeconds of real time passes. For the tests that run
+// the scheduler in the background.
+static bool WaitFor(std::function<bool()> inCondition, Float64 inTimeoutSeconds)
+{
+    const auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<Float64>(inTimeoutSeconds));
+
+    while(!inCondition())
+    {
+        if(std::chrono::steady_clock::now() > deadline)
+        {
+            return inCondition();
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return true;
+}
+
+static void LogStats(const char* testName, const PlayThroughStats& stats)
+{
+    NSLog(@"BGMPlayThroughSimulationTests: %s: latency %.3f ms (min %.3f ms, max %.3f ms), "
+          "%u discontinuities, %zu underrun frames, %zu silent frames before audio",
+          testName,
+          stats.finalLatency * 1000.0,
+          stats.minLatency * 1000.0,
+          stats.maxLatency * 1000.0,
+          stats.discontinuities,
+          stats.underrunFrames,
+          stats.silentFramesBeforeAudio);
+}
+
+@interface BGMPlayThroughSimulationTests : XCTestCase
+
+@end
+
+@implementation BGMPlayThroughSimulationTests {
+    BGMAudioDevice inputDevice;
+    BGMAudioDevice outputDevice;
+
+    std::shared_ptr<MockAudioDevice> mockInputDevice;
+    std::shared_ptr<MockAudioDevice> mockOutputDevice;
+
+    std::unique_ptr<MockIOScheduler> scheduler;
+    std::unique_ptr<BGMPlayThrough> playThrough;
+}
+
+- (void) setUp {
+    [super setUp];
+
+    mockInputDevice = MockAudioObjects::CreateMockDevice(kBGMDeviceUID);
+    mockOutputDevice = MockAudioObjects::CreateMockDevice("Mock Output Device");
+
+    inputDevice = BGMAudioDevice(mockInputDevice->GetObjectID());
+    outputDevice = BGMAudioDevice(mockOutputDevice->GetObjectID());
+
+    scheduler.reset(new MockIOScheduler(static_cast<UInt32>(GetEnvFloat64("BGM_SIMULATION_SEED", 1))));
+    playThrough.reset(new BGMPlayThrough(inputDevice, outputDevice));
+}
+
+- (void) tearDown {
+    // BGMPlayThrough's destructor waits for its IOProcs to stop themselves, so the devices have to
+    // keep running until it returns.
+    scheduler->StartRunningInBackground();
+    playThrough.reset();
+    scheduler.reset();
+
+    MockAudioObjects::DestroyMocks();
+    [super tearDown];
+}
+
+- (void) testPlaysInputThroughToOutput {
+    playThrough->Start();
+    scheduler->RunFor(1.0);
+
+    PlayThroughStats stats = AnalyzeOutput(*mockInputDevice, *mockOutputDevice);
+    LogStats("testPlaysInputThroughToOutput", stats);
+
+    XCTAssert(stats.HasAudio());
+    XCTAssertEqual(stats.discontinuities, 0);
+    XCTAssertEqual(stats.underrunFrames, 0);
+
+    // The output IOProc reads the input from the same IO cycle, so the latency should be the input
+    // device's buffer (while it's being captured) plus the output device's (while it's waiting to
+    // be played). Or one more buffer if the output IOProc happens to be called first.
+    const Float64 bufferDuration = mockOutputDevice->mIOBufferSize / mockOutputDevice->mNominalSampleRate;
+    XCTAssertGreaterThanOrEqual(stats.minLatency, 2 * bufferDuration - 1e-9);
+    XCTAssertLessThanOrEqual(stats.maxLatency, 3 * bufferDuration + 1e-9);
+    XCTAssertEqualWithAccuracy(stats.minLatency, stats.maxLatency, 1e-9);
+}
+
+- (void) testClockDrift {
+    const Float64 seconds = GetEnvFloat64("BGM_SIMULATION_SECONDS", 10.0);
+    mockOutputDevice->mClockDriftPPM = GetEnvFloat64("BGM_SIMULATION_DRIFT_PPM", 1000.0);
+
+    playThrough->Start();
+    scheduler->RunFor(seconds);
+
+    PlayThroughStats stats = AnalyzeOutput(*mockInputDevice, *mockOutputDevice);
+    LogStats("testClockDrift", stats);
+
+    XCTAssert(stats.HasAudio());
+    XCTAssertEqual(stats.underrunFrames, 0);
+
+    // BGMPlayThrough doesn't resample, so it has to skip or repeat a buffer each time the clocks
+    // drift apart by a buffer, but it shouldn't glitch more often than that.
+    const Float64 driftedFrames =
+            std::abs(mockOutputDevice->mClockDriftPPM) / 1000000.0 * seconds * mockOutputDevice->mNominalSampleRate;
+    XCTAssertLessThanOrEqual(stats.discontinuities,
+                             std::ceil(driftedFrames / mockOutputDevice->mIOBufferSize) + 1);
+
+    // The latency is limited by the size of the ring buffer.
+    XCTAssertLessThanOrEqual(stats.maxLatency,
+                             20.0 * mockOutputDevice->mIOBufferSize / mockOutputDevice->mNominalSampleRate);
+}
+
+- (void) testJitterAndStartDelay {
+    const Float64 seconds = GetEnvFloat64("BGM_SIMULATION_SECONDS", 10.0);
+    const Float64 bufferDuration = mockOutputDevice->mIOBufferSize / mockOutputDevice->mNominalSampleRate;
+
+    // Less than a buffer, so each input IO cycle still happens before the next output IO cycle.
+    mockInputDevice->mIOJitterSeconds = 0.25 * bufferDuration;
+    mockOutputDevice->mIOJitterSeconds = 0.25 * bufferDuration;
+    mockOutputDevice->mStartDelaySeconds = 0.05;
+
+    playThrough->Start();
+    scheduler->RunFor(seconds);
+
+    PlayThroughStats stats = AnalyzeOutput(*mockInputDevice, *mockOutputDevice);
+    LogStats("testJitterAndStartDelay", stats);
+
+    XCTAssert(stats.HasAudio());
+    XCTAssertEqual(stats.underrunFrames, 0);
+
+    // If the output IOProc is called before the input IOProc in an IO cycle, it has to move its read
+    // head back by a buffer, but that should only happen once.
+    XCTAssertLessThanOrEqual(stats.discontinuities, 1);
+    XCTAssertGreaterThanOrEqual(stats.minLatency, 2 * bufferDuration - mockOutputDevice->mIOJitterSeconds);
+    XCTAssertLessThanOrEqual(stats.maxLatency, 4 * bufferDuration);
+}
+
+- (void) testWaitForOutputDeviceToStart {
+    mockOutputDevice->mStartDelaySeconds = 0.05;
+    scheduler->StartRunningInBackground();
+
+    playThrough->Start();
+    XCTAssertEqual(playThrough->WaitForOutputDeviceToStart(), kAudioHardwareNoError);
+
+    // It should only return after the output IOProc has been called, which is at least a buffer
+    // after the device started.
+    const Float64 startedAt = mockOutputDevice->mIOStartHostTime;
+    const Float64 bufferDuration = mockOutputDevice->mIOBufferSize / mockOutputDevice->mNominalSampleRate;
+    XCTAssertGreaterThanOrEqual(scheduler->GetCurrentTime(), startedAt + bufferDuration);
+
+    NSLog(@"BGMPlayThroughSimulationTests: testWaitForOutputDeviceToStart: returned %.3f ms after "
+          "the output device started",
+          (scheduler->GetCurrentTime() - startedAt) * 1000.0);
+}
+
+- (void) testStopStopsIOProcs {
+    scheduler->StartRunningInBackground();
+
+    playThrough->Start();
+    XCTAssertEqual(playThrough->WaitForOutputDeviceToStart(), kAudioHardwareNoError);
+    XCTAssert(mockInputDevice->IsRunningIO());
+    XCTAssert(mockOutputDevice->IsRunningIO());
+
+    // The IOProcs should stop themselves, and Stop should wait for them to.
+    playThrough->Stop();
+
+    XCTAssertFalse(mockInputDevice->IsRunningIO());
+    XCTAssertFalse(mockOutputDevice->IsRunningIO());
+}
+
+- (void) testChangeOutputDevice {
+    std::shared_ptr<MockAudioDevice> mockNewOutputDevice =
+            MockAudioObjects::CreateMockDevice("Mock New Output Device");
+    BGMAudioDevice newOutputDevice(mockNewOutputDevice->GetObjectID());
+
+    playThrough->Start();
+    scheduler->RunFor(1.0);
+
+    // SetDevices waits for the IOProcs to stop, so the devices have to run in the background
+    // until it returns.
+    scheduler->StartRunningInBackground();
+    playThrough->SetDevices(nullptr, &newOutputDevice);
+    scheduler->StopRunningInBackground();
+
+    scheduler->RunFor(1.0);
+
+    XCTAssertFalse(mockOutputDevice->IsRunningIO());
+    XCTAssert(mockNewOutputDevice->IsRunningIO());
+
+    PlayThroughStats oldStats = AnalyzeOutput(*mockInputDevice, *mockOutputDevice);
+    PlayThroughStats newStats = AnalyzeOutput(*mockInputDevice, *mockNewOutputDevice);
+    LogStats("testChangeOutputDevice (new device)", newStats);
+
+    XCTAssert(newStats.HasAudio());
+    XCTAssertEqual(newStats.discontinuities, 0);
+    XCTAssertEqual(newStats.underrunFrames, 0);
+
+    // The old output device's recording is from before the input device was restarted, so its
+    // latencies can't be compared, but its host times can.
+    const Float64 gap = newStats.firstAudibleHostTime - oldStats.lastAudibleHostTime;
+    NSLog(@"BGMPlayThroughSimulationTests: testChangeOutputDevice: %.3f ms of silence while "
+          "changing devices",
+          gap * 1000.0);
+
+    XCTAssertGreaterThan(gap, 0.0);
+}
+
+- (void) testConvertsSampleRate {
+    mockOutputDevice->mNominalSampleRate = 44100.0;
+    playThrough->SetFixedInputSampleRate(48000.0);
+
+    playThrough->Start();
+    scheduler->RunFor(2.0);
+
+    // BGMDevice should have been left at the fixed rate.
+    XCTAssertEqual(mockInputDevice->mNominalSampleRate, 48000.0);
+
+    // The input is a ramp, so the output should be a ramp that goes up by the ratio of the sample
+    // rates each frame. The first few frames after the output starts are skipped because the
+    // converter's filter starts out filled with silence.
+    const std::vector<Float32>& output = mockOutputDevice->mRecordedOutput;
+    const Float64 step = 48000.0 / 44100.0;
+    const size_t warmUpFrames = 256;
+    size_t firstFrame = 0;
+
+    while(firstFrame < output.size() && output[firstFrame] == 0.0f)
+    {
+        firstFrame++;
+    }
+
+    XCTAssertGreaterThan(output.size(), firstFrame + warmUpFrames + 44100);
+
+    UInt32 discontinuities = 0;
+    size_t underrunFrames = 0;
+    Float64 minLatency = std::numeric_limits<Float64>::infinity();
+    Float64 maxLatency = 0.0;
+
+    for(size_t i = firstFrame + warmUpFrames; i < output.size(); i++)
+    {
+        if(output[i] == 0.0f)
+        {
+            underrunFrames++;
+            continue;
+        }
+
+        if(std::abs(output[i] - output[i - 1] - step) > 0.5)
+        {
+            discontinuities++;
+        }
+
+        // Each input sample is its sample time plus one. See MockAudioDevice::mInputGenerator.
+        const Float64 latency =
+                mockOutputDevice->GetHostTimeForSampleTime(mockOutputDevice->mRecordedOutputSampleTime + i) -
+                mockInputDevice->GetHostTimeForSampleTime(output[i] - 1.0);
+        minLatency = std::min(minLatency, latency);
+        maxLatency = std::max(maxLatency, latency);
+    }
+
+    NSLog(@"BGMPlayThroughSimulationTests: testConvertsSampleRate: discontinuities=%u "
+          "underrunFrames=%zu latency=%.3f-%.3f ms",
+          discontinuities,
+          underrunFrames,
+          minLatency * 1000.0,
+          maxLatency * 1000.0);
+
+    XCTAssertEqual(discontinuities, 0);
+    XCTAssertEqual(underrunFrames, 0);
+
+    // Without any clock drift, the converter should never have to skip or repeat input, so the
+    // latency should be constant.
+    XCTAssertLessThan(maxLatency - minLatency, 0.001);
+    XCTAssertLessThan(maxLatency, 0.1);
+}
+
+- (void) testSuspendsOutputWhileSilent {
+    // Silent input.
+    mockInputDevice->mInputGenerator = [](Float64, AudioBufferList&) { };
+    mockInputDevice->mAudibleState = kBGMDeviceIsSilent;
+
+    playThrough->SetIdleSuspendDelay(0.5);
+    playThrough->Start();
+    scheduler->RunFor(0.25);
+
+    // It shouldn't suspend before the delay.
+    XCTAssertFalse(playThrough->IsOutputSuspendedForIdle());
+    XCTAssert(mockOutputDevice->IsRunningIO());
+
+    scheduler->RunFor(0.5);
+
+    // The output IOProc should have stopped itself, but the input IOProc has to keep running so it
+    // can tell when to resume.
+    XCTAssert(playThrough->IsOutputSuspendedForIdle());
+    XCTAssertFalse(mockOutputDevice->IsRunningIO());
+    XCTAssert(mockInputDevice->IsRunningIO());
+
+    const UInt64 outputCycles = mockOutputDevice->mIOCycleCount;
+    scheduler->RunFor(1.0);
+    XCTAssertEqual(mockOutputDevice->mIOCycleCount, outputCycles);
+
+    // Stopping and restarting playthrough should still work.
+    scheduler->StartRunningInBackground();
+    playThrough->Stop();
+
+    XCTAssertFalse(playThrough->IsOutputSuspendedForIdle());
+    XCTAssertFalse(mockInputDevice->IsRunningIO());
+
+    playThrough->Start();
+    XCTAssertEqual(playThrough->WaitForOutputDeviceToStart(), kAudioHardwareNoError);
+    XCTAssert(mockOutputDevice->IsRunningIO());
+}
+
+- (void) testDoesntSuspendOutputWhileBGMDeviceIsAudible {
+    // The input is silent, but BGMDriver says a client is playing audio, e.g. because it's only
+    // been quiet for a moment.
+    mockInputDevice->mInputGenerator = [](Float64, AudioBufferList&) { };
+    mockInputDevice->mAudibleState = kBGMDeviceIsAudible;
+
+    playThrough->SetIdleSuspendDelay(0.5);
+    playThrough->Start();
+    scheduler->RunFor(2.0);
+
+    XCTAssertFalse(playThrough->IsOutputSuspendedForIdle());
+    XCTAssert(mockOutputDevice->IsRunningIO());
+}
+
+- (void) testResumesOutputAfterIdle {
+    const Float64 suspendDelay = 0.5;
+    const Float64 audioStartSeconds = 1.5;
+    const Float64 bufferDuration = mockOutputDevice->mIOBufferSize / mockOutputDevice->mNominalSampleRate;
+
+    mockInputDevice->mInputGenerator =
+            SilenceThenRamp(audioStartSeconds * mockInputDevice->mNominalSampleRate);
+    mockInputDevice->mAudibleState = kBGMDeviceIsSilent;
+
+    // Resuming happens on BGMPlayThrough's own thread, so this has to run roughly in real time.
+    scheduler->StartRunningInBackground();
+
+    playThrough->SetIdleSuspendDelay(suspendDelay);
+    playThrough->Start();
+    XCTAssertEqual(playThrough->WaitForOutputDeviceToStart(), kAudioHardwareNoError);
+
+    XCTAssert(WaitFor([&] { return playThrough->IsOutputSuspendedForIdle(); }, 10.0));
+    XCTAssert(WaitFor([&] {
+        return scheduler->GetCurrentTime() > mockInputDevice->mIOStartHostTime + audioStartSeconds + 0.5;
+    }, 10.0));
+
+    scheduler->StopRunningInBackground();
+
+    XCTAssertFalse(playThrough->IsOutputSuspendedForIdle());
+    XCTAssert(mockOutputDevice->IsRunningIO());
+
+    // The output device was restarted when the output IOProc resumed, so its recording starts then.
+    PlayThroughStats stats = AnalyzeOutput(*mockInputDevice, *mockOutputDevice);
+    LogStats("testResumesOutputAfterIdle", stats);
+
+    XCTAssert(stats.HasAudio());
+    XCTAssertEqual(stats.underrunFrames, 0);
+
+    // Like when playthrough starts, the output IOProc might have to move its read head back by a
+    // buffer if it's called before the input IOProc.
+    XCTAssertLessThanOrEqual(stats.discontinuities, 1);
+
+    // The time from the first audible frame being captured to the first audible frame being played.
+    // Without the suspension, this would be the usual latency of two or three buffers.
+    const Float64 audioStartHostTime = mockInputDevice->mIOStartHostTime + audioStartSeconds;
+    const Float64 wakeUpLatency = stats.firstAudibleHostTime - audioStartHostTime;
+
+    // The input and output devices have the same buffer size and sample rate, so the output would
+    // have had one IO cycle for each of the input's.
+    const Float64 cyclesSkipped = static_cast<Float64>(mockInputDevice->mIOCycleCount) -
+            static_cast<Float64>(mockOutputDevice->mIOCycleCount);
+    const Float64 fractionSaved = cyclesSkipped / mockInputDevice->mIOCycleCount;
+
+    NSLog(@"BGMPlayThroughSimulationTests: testResumesOutputAfterIdle: skipped %.0f output IO "
+          "cycles (%.1f%%), woke up in %.3f ms (%.1f buffers)",
+          cyclesSkipped,
+          fractionSaved * 100.0,
+          wakeUpLatency * 1000.0,
+          wakeUpLatency / bufferDuration);
+
+    // It should have been suspended for most of the time between the delay and the audio starting.
+    XCTAssertGreaterThan(cyclesSkipped, 0.5 * (audioStartSeconds - suspendDelay) / bufferDuration);
+
+    // The thread scheduling makes the wake up time vary, so this is only a rough bound.
+    XCTAssertGreaterThan(wakeUpLatency, 0.0);
+    XCTAssertLessThan(wakeUpLatency, 0.25);
+}
+
+@end
+
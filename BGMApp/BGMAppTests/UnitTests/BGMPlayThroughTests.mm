@@ -86,12 +86,29 @@
     std::set<AudioObjectPropertySelector> expectedProperties {
             kAudioDevicePropertyDeviceIsRunning,
             kAudioDeviceProcessorOverload,
-            kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp
+            kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp,
+            kAudioDeviceCustomPropertyDeviceAudibleState
     };
 
     XCTAssertEqual(expectedProperties, mockInputDevice->mPropertiesWithListeners);
 }
 
+- (void) testFixedInputSampleRate {
+    outputDevice.SetNominalSampleRate(44100.0);
+
+    BGMPlayThrough playThrough(inputDevice, outputDevice);
+    playThrough.SetFixedInputSampleRate(48000.0);
+    playThrough.Activate();
+
+    // It should set the input device to the fixed sample rate instead of the output device's.
+    XCTAssertEqual(48000.0, inputDevice.GetNominalSampleRate());
+    XCTAssertEqual(44100.0, outputDevice.GetNominalSampleRate());
+
+    // Unfixing it should take effect straight away, since playthrough is active.
+    playThrough.SetFixedInputSampleRate(0.0);
+    XCTAssertEqual(44100.0, inputDevice.GetNominalSampleRate());
+}
+
 - (void) testDeactivate {
     BGMPlayThrough playThrough(inputDevice, outputDevice);
 
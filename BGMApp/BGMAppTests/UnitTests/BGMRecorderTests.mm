@@ -0,0 +1,620 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMRecorderTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Tests for BGMRecorder, BGMRecorderTap, BGMRecordingFormat and BGMRecordingFile. The file format
+//  tests parse the files we write with AudioToolbox's ExtAudioFile as well as checking the headers
+//  byte by byte, so they'll catch files that are technically valid but that Core Audio can't read.
+//
+
+// Unit Includes
+#import "BGMRecorder.h"
+#import "BGMRecorderTap.h"
+#import "BGMRecordingFile.h"
+#import "BGMRecordingFormat.h"
+
+// PublicUtility Includes
+#import "CAException.h"
+
+// STL Includes
+#import <string>
+#import <vector>
+
+// System Includes
+#import <AudioToolbox/AudioToolbox.h>
+#import <XCTest/XCTest.h>
+
+
+@interface BGMRecorderTests : XCTestCase
+
+@end
+
+@implementation BGMRecorderTests {
+    // A new, empty directory for each test's files.
+    NSString* directory;
+}
+
+- (void) setUp {
+    [super setUp];
+
+    directory = [NSTemporaryDirectory() stringByAppendingPathComponent:
+                     [NSString stringWithFormat:@"BGMRecorderTests-%@", NSUUID.UUID.UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory
+                              withIntermediateDirectories:YES
+                                               attributes:nil
+                                                    error:nil];
+}
+
+- (void) tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:nil];
+    [super tearDown];
+}
+
+#pragma mark Helpers
+
+static std::vector<Float32> RampFrames(UInt32 inFrameCount, UInt32 inChannels)
+{
+    std::vector<Float32> theFrames(static_cast<size_t>(inFrameCount) * inChannels);
+
+    for(size_t i = 0; i < theFrames.size(); i++)
+    {
+        // Values that 16-bit samples can represent exactly, so they survive the round trip.
+        theFrames[i] = static_cast<Float32>(static_cast<SInt32>(i % 32768) - 16384) / 32768.0f;
+    }
+
+    return theFrames;
+}
+
+static UInt32 ReadLE32(const UInt8* inBytes)
+{
+    return static_cast<UInt32>(inBytes[0]) |
+           (static_cast<UInt32>(inBytes[1]) << 8) |
+           (static_cast<UInt32>(inBytes[2]) << 16) |
+           (static_cast<UInt32>(inBytes[3]) << 24);
+}
+
+static UInt16 ReadLE16(const UInt8* inBytes)
+{
+    return static_cast<UInt16>(inBytes[0] | (inBytes[1] << 8));
+}
+
+- (void) assertThrowsCAException:(void (^)(void))block {
+    try {
+        block();
+        XCTFail(@"Expected a CAException");
+    } catch (const CAException& e) {
+        // Expected.
+    }
+}
+
+- (NSString*) pathForFile:(NSString*)name {
+    return [directory stringByAppendingPathComponent:name];
+}
+
+// Writes the frames to a file in the given format and returns the file's contents.
+- (NSData*) writeFile:(NSString*)name
+               format:(const BGMRecordingFormat&)format
+               frames:(const std::vector<Float32>&)frames {
+    NSString* path = [self pathForFile:name];
+
+    BGMRecordingFile file(path.fileSystemRepresentation, format);
+    file.WriteFrames(frames.data(), static_cast<UInt32>(frames.size() / format.GetChannels()));
+    file.Close();
+
+    return [NSData dataWithContentsOfFile:path];
+}
+
+// Reads a file with ExtAudioFile, converting it to interleaved Float32.
+- (std::vector<Float32>) readFileWithExtAudioFile:(NSString*)path
+                                    expectedRate:(Float64)expectedRate
+                                expectedChannels:(UInt32)expectedChannels {
+    ExtAudioFileRef file = nullptr;
+    XCTAssertEqual(ExtAudioFileOpenURL((__bridge CFURLRef)[NSURL fileURLWithPath:path], &file), noErr);
+
+    AudioStreamBasicDescription fileFormat;
+    UInt32 size = sizeof(fileFormat);
+    XCTAssertEqual(ExtAudioFileGetProperty(file, kExtAudioFileProperty_FileDataFormat, &size, &fileFormat),
+                   noErr);
+    XCTAssertEqual(fileFormat.mSampleRate, expectedRate);
+    XCTAssertEqual(fileFormat.mChannelsPerFrame, expectedChannels);
+
+    AudioStreamBasicDescription clientFormat = {};
+    clientFormat.mSampleRate = expectedRate;
+    clientFormat.mFormatID = kAudioFormatLinearPCM;
+    clientFormat.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
+    clientFormat.mChannelsPerFrame = expectedChannels;
+    clientFormat.mBitsPerChannel = 32;
+    clientFormat.mBytesPerFrame = 4 * expectedChannels;
+    clientFormat.mFramesPerPacket = 1;
+    clientFormat.mBytesPerPacket = clientFormat.mBytesPerFrame;
+    XCTAssertEqual(ExtAudioFileSetProperty(file,
+                                           kExtAudioFileProperty_ClientDataFormat,
+                                           sizeof(clientFormat),
+                                           &clientFormat),
+                   noErr);
+
+    std::vector<Float32> frames;
+    std::vector<Float32> buffer(4096 * expectedChannels);
+
+    for(;;)
+    {
+        AudioBufferList bufferList;
+        bufferList.mNumberBuffers = 1;
+        bufferList.mBuffers[0].mNumberChannels = expectedChannels;
+        bufferList.mBuffers[0].mDataByteSize = static_cast<UInt32>(buffer.size() * sizeof(Float32));
+        bufferList.mBuffers[0].mData = buffer.data();
+
+        UInt32 frameCount = 4096;
+        XCTAssertEqual(ExtAudioFileRead(file, &frameCount, &bufferList), noErr);
+
+        if(frameCount == 0)
+        {
+            break;
+        }
+
+        frames.insert(frames.end(), buffer.begin(), buffer.begin() + (frameCount * expectedChannels));
+    }
+
+    ExtAudioFileDispose(file);
+
+    return frames;
+}
+
+#pragma mark BGMRecorderTap
+
+- (void) testTap {
+    BGMRecorderTap tap(2, 100);
+
+    // The capacity is rounded up to a power of two.
+    XCTAssertEqual(tap.GetCapacityFrames(), 128);
+
+    std::vector<Float32> frames = RampFrames(200, 2);
+    std::vector<Float32> readFrames(400);
+
+    XCTAssertEqual(tap.WriteRT(frames.data(), 100), 100);
+    XCTAssertEqual(tap.GetReadableFrames(), 100);
+    XCTAssertEqual(tap.Read(readFrames.data(), 60), 60);
+    XCTAssertTrue(std::equal(readFrames.begin(), readFrames.begin() + 120, frames.begin()));
+
+    // This write wraps around the end of the ring and doesn't fit, so the last 12 frames should be
+    // dropped.
+    XCTAssertEqual(tap.WriteRT(frames.data() + 200, 100), 88);
+    XCTAssertEqual(tap.GetDroppedFrames(), 12);
+
+    XCTAssertEqual(tap.Read(readFrames.data(), 200), 128);
+    XCTAssertTrue(std::equal(readFrames.begin(), readFrames.begin() + 80, frames.begin() + 120));
+    XCTAssertTrue(std::equal(readFrames.begin() + 80, readFrames.begin() + 256, frames.begin() + 200));
+
+    XCTAssertEqual(tap.Read(readFrames.data(), 200), 0);
+}
+
+- (void) testTapInvalidArguments {
+    [self assertThrowsCAException:^{ BGMRecorderTap(0, 100); }];
+    [self assertThrowsCAException:^{ BGMRecorderTap(2, 0); }];
+}
+
+#pragma mark BGMRecordingFormat
+
+- (void) testWAVHeaderPCM16 {
+    BGMRecordingFormat format(BGMRecordingFormat::Container::WAV,
+                              BGMRecordingFormat::SampleFormat::Int16,
+                              44100.0,
+                              2);
+    XCTAssertEqual(format.GetHeaderSize(), 44);
+
+    std::vector<Float32> frames = { 0.0f, 1.0f, -1.0f, 0.5f, 2.0f, -2.0f };
+    NSData* data = [self writeFile:@"pcm16.wav" format:format frames:frames];
+    const UInt8* bytes = static_cast<const UInt8*>(data.bytes);
+
+    XCTAssertEqual(data.length, 44 + 12);
+    XCTAssertEqual(memcmp(bytes, "RIFF", 4), 0);
+    XCTAssertEqual(ReadLE32(bytes + 4), data.length - 8);
+    XCTAssertEqual(memcmp(bytes + 8, "WAVEfmt ", 8), 0);
+    XCTAssertEqual(ReadLE32(bytes + 16), 16);           // fmt chunk size
+    XCTAssertEqual(ReadLE16(bytes + 20), 1);            // PCM
+    XCTAssertEqual(ReadLE16(bytes + 22), 2);            // Channels
+    XCTAssertEqual(ReadLE32(bytes + 24), 44100);        // Sample rate
+    XCTAssertEqual(ReadLE32(bytes + 28), 44100 * 4);    // Byte rate
+    XCTAssertEqual(ReadLE16(bytes + 32), 4);            // Block align
+    XCTAssertEqual(ReadLE16(bytes + 34), 16);           // Bits per sample
+    XCTAssertEqual(memcmp(bytes + 36, "data", 4), 0);
+    XCTAssertEqual(ReadLE32(bytes + 40), 12);
+
+    // The samples, which should have been clipped to [-1, 1].
+    const SInt16 expectedSamples[] = { 0, 32767, -32767, 16384, 32767, -32767 };
+
+    for(UInt32 i = 0; i < 6; i++)
+    {
+        XCTAssertEqual(static_cast<SInt16>(ReadLE16(bytes + 44 + (2 * i))), expectedSamples[i]);
+    }
+}
+
+- (void) testWAVHeaderExtensible {
+    // 24-bit and more than two channels both need WAVE_FORMAT_EXTENSIBLE.
+    BGMRecordingFormat format(BGMRecordingFormat::Container::WAV,
+                              BGMRecordingFormat::SampleFormat::Int24,
+                              96000.0,
+                              3);
+    XCTAssertEqual(format.GetHeaderSize(), 80);
+
+    // One frame, so the data is 9 bytes long and needs a pad byte.
+    NSData* data = [self writeFile:@"extensible.wav" format:format frames:{ 0.0f, 0.5f, -0.5f }];
+    const UInt8* bytes = static_cast<const UInt8*>(data.bytes);
+
+    XCTAssertEqual(data.length, 80 + 9 + 1);
+    XCTAssertEqual(ReadLE32(bytes + 4), data.length - 8);
+    XCTAssertEqual(ReadLE32(bytes + 16), 40);           // fmt chunk size
+    XCTAssertEqual(ReadLE16(bytes + 20), 0xFFFE);       // WAVE_FORMAT_EXTENSIBLE
+    XCTAssertEqual(ReadLE16(bytes + 22), 3);
+    XCTAssertEqual(ReadLE16(bytes + 32), 9);
+    XCTAssertEqual(ReadLE16(bytes + 34), 24);
+    XCTAssertEqual(ReadLE16(bytes + 36), 22);           // cbSize
+    XCTAssertEqual(ReadLE16(bytes + 38), 24);           // Valid bits
+    XCTAssertEqual(ReadLE16(bytes + 44), 1);            // KSDATAFORMAT_SUBTYPE_PCM
+    XCTAssertEqual(memcmp(bytes + 60, "fact", 4), 0);
+    XCTAssertEqual(ReadLE32(bytes + 68), 1);            // Frames
+    XCTAssertEqual(memcmp(bytes + 72, "data", 4), 0);
+    XCTAssertEqual(ReadLE32(bytes + 76), 9);
+    XCTAssertEqual(bytes[89], 0);                       // Pad byte
+
+    // 0.5 * (2^23 - 1), rounded.
+    XCTAssertEqual(bytes[83], 0x00);
+    XCTAssertEqual(bytes[84], 0x00);
+    XCTAssertEqual(bytes[85], 0x40);
+}
+
+- (void) testCAFHeader {
+    BGMRecordingFormat format(BGMRecordingFormat::Container::CAF,
+                              BGMRecordingFormat::SampleFormat::Float32,
+                              48000.0,
+                              2);
+    XCTAssertEqual(format.GetHeaderSize(), 68);
+
+    NSData* data = [self writeFile:@"float.caf" format:format frames:{ 0.25f, -0.75f }];
+    const UInt8* bytes = static_cast<const UInt8*>(data.bytes);
+
+    XCTAssertEqual(data.length, 68 + 8);
+    XCTAssertEqual(memcmp(bytes, "caff", 4), 0);
+    XCTAssertEqual(memcmp(bytes + 8, "desc", 4), 0);
+    XCTAssertEqual(memcmp(bytes + 52, "data", 4), 0);
+    XCTAssertEqual(bytes[63], 8 + 4);                   // Data chunk size (low byte)
+
+    Float32 samples[2];
+    memcpy(samples, bytes + 68, sizeof(samples));
+    XCTAssertEqual(samples[0], 0.25f);
+    XCTAssertEqual(samples[1], -0.75f);
+}
+
+- (void) testInvalidFormat {
+    [self assertThrowsCAException:^{
+        BGMRecordingFormat(BGMRecordingFormat::Container::WAV,
+                           BGMRecordingFormat::SampleFormat::Int16,
+                           0.0,
+                           2);
+    }];
+    [self assertThrowsCAException:^{
+        BGMRecordingFormat(BGMRecordingFormat::Container::WAV,
+                           BGMRecordingFormat::SampleFormat::Int16,
+                           44100.0,
+                           0);
+    }];
+    // FLAC only stores integer samples, with up to eight channels.
+    [self assertThrowsCAException:^{
+        BGMRecordingFormat(BGMRecordingFormat::Container::FLAC,
+                           BGMRecordingFormat::SampleFormat::Float32,
+                           44100.0,
+                           2);
+    }];
+    [self assertThrowsCAException:^{
+        BGMRecordingFormat(BGMRecordingFormat::Container::FLAC,
+                           BGMRecordingFormat::SampleFormat::Int16,
+                           44100.0,
+                           9);
+    }];
+}
+
+// Every valid combination of container, sample format and a few channel counts should produce a
+// file ExtAudioFile reads back correctly.
+- (void) testFilesReadableByCoreAudio {
+    const BGMRecordingFormat::Container containers[] = {
+        BGMRecordingFormat::Container::WAV,
+        BGMRecordingFormat::Container::CAF,
+        BGMRecordingFormat::Container::FLAC
+    };
+    const BGMRecordingFormat::SampleFormat sampleFormats[] = {
+        BGMRecordingFormat::SampleFormat::Int16,
+        BGMRecordingFormat::SampleFormat::Int24,
+        BGMRecordingFormat::SampleFormat::Float32
+    };
+
+    UInt32 fileNumber = 0;
+
+    for(auto container : containers)
+    {
+        for(auto sampleFormat : sampleFormats)
+        {
+            for(UInt32 channels : { 1, 2, 8, 16 })
+            {
+                if(container == BGMRecordingFormat::Container::FLAC &&
+                   (sampleFormat == BGMRecordingFormat::SampleFormat::Float32 || channels > 8))
+                {
+                    // Tested in testInvalidFormat.
+                    continue;
+                }
+
+                BGMRecordingFormat format(container, sampleFormat, 48000.0, channels);
+                std::vector<Float32> frames = RampFrames(10000, channels);
+
+                NSString* name = [NSString stringWithFormat:@"%u.%s", fileNumber++, format.GetFileExtension()];
+                [self writeFile:name format:format frames:frames];
+
+                std::vector<Float32> readFrames = [self readFileWithExtAudioFile:[self pathForFile:name]
+                                                                    expectedRate:48000.0
+                                                                expectedChannels:channels];
+
+                XCTAssertEqual(readFrames.size(), frames.size(), @"%@", name);
+
+                for(size_t i = 0; i < std::min(readFrames.size(), frames.size()); i++)
+                {
+                    XCTAssertEqualWithAccuracy(readFrames[i], frames[i], 1.0f / 32767.0f, @"%@", name);
+                }
+            }
+        }
+    }
+}
+
+- (void) testUnclosedFileHasProvisionalHeader {
+    BGMRecordingFormat format(BGMRecordingFormat::Container::CAF,
+                              BGMRecordingFormat::SampleFormat::Int16,
+                              44100.0,
+                              2);
+    NSString* path = [self pathForFile:@"unclosed.caf"];
+
+    // Enough frames to fill the write buffer, so the header gets written.
+    const UInt32 frameCount = (BGMRecordingFile::kBufferBytes / 4) + 1000;
+    std::vector<Float32> frames = RampFrames(frameCount, 2);
+
+    {
+        BGMRecordingFile file(path.fileSystemRepresentation, format);
+        file.WriteFrames(frames.data(), frameCount);
+
+        // The file hasn't been closed, so its data chunk size should be -1, i.e. unknown.
+        NSData* data = [NSData dataWithContentsOfFile:path];
+        XCTAssertGreaterThanOrEqual(data.length, BGMRecordingFile::kBufferBytes);
+
+        for(UInt32 i = 56; i < 64; i++)
+        {
+            XCTAssertEqual(static_cast<const UInt8*>(data.bytes)[i], 0xFF);
+        }
+    }
+
+    // The destructor closes the file, which fills in the size.
+    std::vector<Float32> readFrames = [self readFileWithExtAudioFile:path
+                                                        expectedRate:44100.0
+                                                    expectedChannels:2];
+    XCTAssertEqual(readFrames.size(), frames.size());
+}
+
+- (void) testFileWontOverwrite {
+    BGMRecordingFormat format(BGMRecordingFormat::Container::WAV,
+                              BGMRecordingFormat::SampleFormat::Int16,
+                              44100.0,
+                              2);
+    NSString* path = [self pathForFile:@"existing.wav"];
+    [@"Don't overwrite me" writeToFile:path atomically:NO encoding:NSUTF8StringEncoding error:nil];
+
+    [self assertThrowsCAException:^{
+        BGMRecordingFile(path.fileSystemRepresentation, format);
+    }];
+
+    // The existing file should be untouched.
+    XCTAssertEqualObjects([NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:nil],
+                          @"Don't overwrite me");
+}
+
+// FLAC files are created by ExtAudioFile, which would happily replace an existing file.
+- (void) testFLACFileWontOverwrite {
+    BGMRecordingFormat format(BGMRecordingFormat::Container::FLAC,
+                              BGMRecordingFormat::SampleFormat::Int16,
+                              44100.0,
+                              2);
+    NSString* path = [self pathForFile:@"existing.flac"];
+    [@"Don't overwrite me" writeToFile:path atomically:NO encoding:NSUTF8StringEncoding error:nil];
+
+    [self assertThrowsCAException:^{
+        BGMRecordingFile(path.fileSystemRepresentation, format);
+    }];
+
+    XCTAssertEqualObjects([NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:nil],
+                          @"Don't overwrite me");
+}
+
+#pragma mark BGMRecorder
+
+- (void) testRecorderRotatesByTime {
+    BGMRecorder::Settings settings;
+    settings.mDirectory = directory.fileSystemRepresentation;
+    // Float32, so the frames we read back should be exactly the same.
+    settings.mSampleFormat = BGMRecordingFormat::SampleFormat::Float32;
+    settings.mMaxFileSeconds = 1;
+
+    // Use a low sample rate so the tap can hold a few files' worth of audio.
+    BGMRecorder recorder(settings, 1000.0, 2);
+
+    std::vector<Float32> frames = RampFrames(2500, 2);
+    XCTAssertEqual(recorder.GetTap().WriteRT(frames.data(), 2500), 2500);
+
+    recorder.Start();
+    recorder.Stop();
+
+    XCTAssertFalse(recorder.HasFailed());
+    XCTAssertEqual(recorder.GetFramesRecorded(), 2500);
+
+    // Each file should have exactly one second of audio, except the last.
+    std::vector<std::string> paths = recorder.GetFilePaths();
+    XCTAssertEqual(paths.size(), 3);
+
+    const UInt64 expectedFrames[] = { 1000, 1000, 500 };
+    size_t frameOffset = 0;
+
+    for(size_t i = 0; i < std::min<size_t>(paths.size(), 3); i++)
+    {
+        NSString* path = [NSString stringWithUTF8String:paths[i].c_str()];
+        XCTAssertTrue([path hasSuffix:@".wav"]);
+
+        std::vector<Float32> readFrames = [self readFileWithExtAudioFile:path
+                                                            expectedRate:1000.0
+                                                        expectedChannels:2];
+        XCTAssertEqual(readFrames.size(), expectedFrames[i] * 2);
+
+        // The files should continue from each other without any gaps.
+        XCTAssertTrue(std::equal(readFrames.begin(), readFrames.end(), frames.begin() + frameOffset));
+        frameOffset += readFrames.size();
+    }
+}
+
+- (void) testRecorderRotatesBySize {
+    BGMRecorder::Settings settings;
+    settings.mDirectory = directory.fileSystemRepresentation;
+    settings.mContainer = BGMRecordingFormat::Container::CAF;
+    settings.mSampleFormat = BGMRecordingFormat::SampleFormat::Float32;
+    // Room for the header and 100 frames.
+    settings.mMaxFileBytes = 68 + (100 * 8) + 7;
+
+    BGMRecorder recorder(settings, 1000.0, 2);
+
+    std::vector<Float32> frames = RampFrames(250, 2);
+    recorder.GetTap().WriteRT(frames.data(), 250);
+
+    recorder.Start();
+    recorder.Stop();
+
+    std::vector<std::string> paths = recorder.GetFilePaths();
+    XCTAssertEqual(paths.size(), 3);
+
+    for(const std::string& path : paths)
+    {
+        NSDictionary* attributes =
+                [[NSFileManager defaultManager] attributesOfItemAtPath:[NSString stringWithUTF8String:path.c_str()]
+                                                                 error:nil];
+        XCTAssertLessThanOrEqual(attributes.fileSize, settings.mMaxFileBytes);
+    }
+}
+
+- (void) testRecorderWorkerDrainsTap {
+    BGMRecorder::Settings settings;
+    settings.mDirectory = directory.fileSystemRepresentation;
+
+    BGMRecorder recorder(settings, 48000.0, 2);
+    recorder.Start();
+
+    // Write a bit at a time, like BGMPlayThrough's IOProc, while the worker is running.
+    std::vector<Float32> frames = RampFrames(512, 2);
+
+    for(UInt32 i = 0; i < 100; i++)
+    {
+        XCTAssertEqual(recorder.GetTap().WriteRT(frames.data(), 512), 512);
+        usleep(1000);
+    }
+
+    recorder.Stop();
+
+    XCTAssertFalse(recorder.HasFailed());
+    XCTAssertEqual(recorder.GetFramesRecorded(), 51200);
+    XCTAssertEqual(recorder.GetTap().GetDroppedFrames(), 0);
+    XCTAssertEqual(recorder.GetFilePaths().size(), 1);
+}
+
+- (void) testRecorderFailsIfDirectoryMissing {
+    BGMRecorder::Settings settings;
+    settings.mDirectory = [directory stringByAppendingPathComponent:@"missing"].fileSystemRepresentation;
+
+    BGMRecorder* recorder = new BGMRecorder(settings, 48000.0, 2);
+    [self assertThrowsCAException:^{ recorder->Start(); }];
+    delete recorder;
+}
+
+#pragma mark Performance
+
+// Measures how quickly the worker thread can encode and write a minute of audio, which needs to be
+// much faster than real time for the recorder to keep up. (On a typical Mac, even 16 channels of
+// 96 kHz audio is hundreds of times faster than real time.)
+- (void) measureEncodeThroughput:(Float64)sampleRate
+                        channels:(UInt32)channels
+                    sampleFormat:(BGMRecordingFormat::SampleFormat)sampleFormat {
+    BGMRecordingFormat format(BGMRecordingFormat::Container::WAV, sampleFormat, sampleRate, channels);
+
+    // One IO cycle's worth of audio at a time, like the worker thread usually gets.
+    const UInt32 framesPerWrite = 4096;
+    const UInt32 writes = static_cast<UInt32>(sampleRate * 60 / framesPerWrite);
+    std::vector<Float32> frames = RampFrames(framesPerWrite, channels);
+
+    __block UInt32 fileNumber = 0;
+    NSString* dir = directory;
+
+    [self measureBlock:^{
+        NSString* path =
+                [dir stringByAppendingPathComponent:[NSString stringWithFormat:@"perf%u.wav", fileNumber++]];
+        BGMRecordingFile file(path.fileSystemRepresentation, format);
+
+        for(UInt32 i = 0; i < writes; i++)
+        {
+            file.WriteFrames(frames.data(), framesPerWrite);
+        }
+
+        file.Close();
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+    }];
+}
+
+- (void) testPerformance48k2ch {
+    [self measureEncodeThroughput:48000.0 channels:2 sampleFormat:BGMRecordingFormat::SampleFormat::Int24];
+}
+
+- (void) testPerformance48k8ch {
+    [self measureEncodeThroughput:48000.0 channels:8 sampleFormat:BGMRecordingFormat::SampleFormat::Int24];
+}
+
+- (void) testPerformance48k16ch {
+    [self measureEncodeThroughput:48000.0 channels:16 sampleFormat:BGMRecordingFormat::SampleFormat::Int24];
+}
+
+- (void) testPerformance96k2ch {
+    [self measureEncodeThroughput:96000.0 channels:2 sampleFormat:BGMRecordingFormat::SampleFormat::Int24];
+}
+
+- (void) testPerformance96k8ch {
+    [self measureEncodeThroughput:96000.0 channels:8 sampleFormat:BGMRecordingFormat::SampleFormat::Int24];
+}
+
+- (void) testPerformance96k16ch {
+    [self measureEncodeThroughput:96000.0 channels:16 sampleFormat:BGMRecordingFormat::SampleFormat::Int24];
+}
+
+- (void) testPerformance96k16chFloat {
+    [self measureEncodeThroughput:96000.0 channels:16 sampleFormat:BGMRecordingFormat::SampleFormat::Float32];
+}
+
+- (void) testPerformance96k16chInt16 {
+    [self measureEncodeThroughput:96000.0 channels:16 sampleFormat:BGMRecordingFormat::SampleFormat::Int16];
+}
+
+@end
+
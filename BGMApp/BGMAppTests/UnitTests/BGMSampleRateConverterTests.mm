@@ -0,0 +1,363 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMSampleRateConverterTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The quality tests convert sine tones and measure the output's spectrum at the tone's frequency
+//  (for the passband) and at every frequency the tone could alias or image to (for the stopband).
+//
+
+// Unit Include
+#import "BGMSampleRateConverter.h"
+
+// PublicUtility Includes
+#import "CAException.h"
+
+// STL Includes
+#import <algorithm>
+#import <cmath>
+#import <complex>
+#import <vector>
+
+// System Includes
+#import <XCTest/XCTest.h>
+
+
+// The amplitude of the test tones.
+static const Float64 kToneAmplitude = 0.5;
+// The number of output frames to skip before measuring, so the filter has filled with input.
+static const size_t kSettleFrames = 2048;
+// The number of output frames to measure. Long enough to resolve aliases a few hundred Hz from
+// the tone.
+static const size_t kMeasureFrames = 16384;
+
+@interface BGMSampleRateConverterTests : XCTestCase
+@end
+
+@implementation BGMSampleRateConverterTests
+
+#pragma mark Helpers
+
+// A sine tone, duplicated into both channels of interleaved stereo frames.
+static std::vector<Float32> StereoTone(Float64 inFrequency, Float64 inSampleRate, size_t inFrames)
+{
+    std::vector<Float32> theFrames(inFrames * 2);
+
+    for(size_t i = 0; i < inFrames; i++)
+    {
+        const Float32 theSample =
+                static_cast<Float32>(kToneAmplitude * std::sin(2.0 * M_PI * inFrequency * i / inSampleRate));
+        theFrames[2 * i] = theSample;
+        theFrames[2 * i + 1] = theSample;
+    }
+
+    return theFrames;
+}
+
+// Converts inInput in blocks of inBlockFrames output frames, like the output IOProc does, and returns
+// the output's left channel.
+static std::vector<Float32> Convert(BGMSampleRateConverter& inConverter,
+                                    const std::vector<Float32>& inInput,
+                                    UInt32 inBlockFrames)
+{
+    // Returns early if the converter doesn't produce all the frames it should have.
+    std::vector<Float32> theLeftChannel;
+    std::vector<Float32> theOutput(inBlockFrames * 2);
+    const size_t theInputFrames = inInput.size() / 2;
+    size_t theInputPosition = 0;
+
+    while(true)
+    {
+        const UInt32 theFramesRequired = inConverter.GetInputFramesRequired(inBlockFrames);
+
+        if(theInputPosition + theFramesRequired > theInputFrames)
+        {
+            break;
+        }
+
+        const UInt32 theFramesProduced = inConverter.Process(&inInput[theInputPosition * 2],
+                                                             theFramesRequired,
+                                                             theOutput.data(),
+                                                             inBlockFrames);
+
+        for(UInt32 i = 0; i < theFramesProduced; i++)
+        {
+            theLeftChannel.push_back(theOutput[2 * i]);
+        }
+
+        theInputPosition += theFramesRequired;
+
+        if(theFramesProduced != inBlockFrames)
+        {
+            break;
+        }
+    }
+
+    return theLeftChannel;
+}
+
+// Returns at least kSettleFrames + kMeasureFrames frames, unless the converter is broken.
+static std::vector<Float32> ConvertTone(Float64 inFrequency, Float64 inInputRate, Float64 inOutputRate)
+{
+    BGMSampleRateConverter theConverter;
+    theConverter.SetRates(inInputRate, inOutputRate, 4096);
+
+    // Enough input for the frames we measure, plus some spare.
+    const size_t theOutputFrames = kSettleFrames + kMeasureFrames + 2048;
+    const size_t theInputFrames =
+            static_cast<size_t>(std::ceil(theOutputFrames * inInputRate / inOutputRate));
+
+    return Convert(theConverter, StereoTone(inFrequency, inInputRate, theInputFrames), 512);
+}
+
+// The level, in dB relative to a tone at kToneAmplitude, of inFrequency in the measured part of
+// inSignal. Uses a Blackman-Harris window, so the tone's own leakage is negligible a few bins away.
+static Float64 LevelDB(const std::vector<Float32>& inSignal, Float64 inFrequency, Float64 inSampleRate)
+{
+    std::complex<Float64> theSum = 0;
+    Float64 theWindowSum = 0;
+
+    for(size_t i = 0; i < kMeasureFrames; i++)
+    {
+        const Float64 a = 2.0 * M_PI * i / (kMeasureFrames - 1);
+        const Float64 theWindow =
+                0.35875 - 0.48829 * std::cos(a) + 0.14128 * std::cos(2 * a) - 0.01168 * std::cos(3 * a);
+
+        theSum += theWindow * inSignal[kSettleFrames + i] *
+                std::polar(1.0, -2.0 * M_PI * inFrequency * i / inSampleRate);
+        theWindowSum += theWindow;
+    }
+
+    const Float64 theAmplitude = 2.0 * std::abs(theSum) / theWindowSum;
+    return 20.0 * std::log10(theAmplitude / kToneAmplitude + 1e-20);
+}
+
+- (void) assertThrowsCAException:(void (^)(void))block {
+    try {
+        block();
+        XCTFail(@"Expected a CAException");
+    } catch (const CAException& e) {
+        // Expected.
+    }
+}
+
+// Checks the gain for tones throughout the audible range is flat.
+- (void) assertPassbandRipple:(Float64)inputRate outputRate:(Float64)outputRate {
+    for(Float64 frequency : { 100.0, 1000.0, 5000.0, 10000.0, 15000.0, 19000.0, 20000.0 })
+    {
+        std::vector<Float32> output = ConvertTone(frequency, inputRate, outputRate);
+        XCTAssertGreaterThanOrEqual(output.size(), kSettleFrames + kMeasureFrames);
+
+        if(output.size() < kSettleFrames + kMeasureFrames)
+        {
+            return;
+        }
+
+        const Float64 gain = LevelDB(output, frequency, outputRate);
+
+        XCTAssertLessThan(std::fabs(gain), 0.01,
+                          @"%.0f Hz -> %.0f Hz: %.0f Hz tone's gain was %f dB",
+                          inputRate, outputRate, frequency, gain);
+    }
+}
+
+// Checks that tones anywhere in the input's range don't produce aliases or images in the audible
+// range of the output.
+- (void) assertAliasing:(Float64)inputRate outputRate:(Float64)outputRate {
+    Float64 worstLevel = -1000.0;
+
+    for(Float64 frequency = 100.0; frequency < inputRate / 2 - 50.0; frequency += 1499.0)
+    {
+        std::vector<Float32> output = ConvertTone(frequency, inputRate, outputRate);
+        XCTAssertGreaterThanOrEqual(output.size(), kSettleFrames + kMeasureFrames);
+
+        if(output.size() < kSettleFrames + kMeasureFrames)
+        {
+            return;
+        }
+
+        // The tone also appears at k * inputRate +/- frequency before resampling, which folds into
+        // the output's range. Check all of those frequencies except the tone itself.
+        for(int k = 0; k < 4; k++)
+        {
+            for(int sign : { -1, 1 })
+            {
+                const Float64 image = k * inputRate + sign * frequency;
+
+                if(image <= 0.0 || (k == 0 && frequency <= outputRate / 2))
+                {
+                    continue;
+                }
+
+                Float64 folded = std::fmod(image, outputRate);
+                folded = (folded > outputRate / 2) ? (outputRate - folded) : folded;
+
+                if(folded > 20.0 && folded < 20000.0 && std::fabs(folded - frequency) > 200.0)
+                {
+                    const Float64 level = LevelDB(output, folded, outputRate);
+                    worstLevel = std::max(worstLevel, level);
+
+                    XCTAssertLessThan(level, -100.0,
+                                      @"%.0f Hz -> %.0f Hz: %.0f Hz tone produced %f dB at %.0f Hz",
+                                      inputRate, outputRate, frequency, level, folded);
+                }
+            }
+        }
+    }
+
+    NSLog(@"%.0f Hz -> %.0f Hz: worst alias/image in 20 Hz - 20 kHz: %.1f dB",
+          inputRate, outputRate, worstLevel);
+}
+
+#pragma mark Tests
+
+- (void) testInvalidArguments {
+    [self assertThrowsCAException:^{ BGMSampleRateConverter converter(0); }];
+
+    BGMSampleRateConverter converter;
+    BGMSampleRateConverter* converterPtr = &converter;
+    [self assertThrowsCAException:^{ converterPtr->SetRates(0.0, 48000.0, 512); }];
+    [self assertThrowsCAException:^{ converterPtr->SetRates(44100.0, -1.0, 512); }];
+    [self assertThrowsCAException:^{ converterPtr->SetRates(44100.0, 48000.0, 0); }];
+}
+
+- (void) testPassthrough {
+    BGMSampleRateConverter converter;
+    XCTAssertTrue(converter.IsPassthrough());
+
+    converter.SetRates(44100.0, 48000.0, 512);
+    XCTAssertFalse(converter.IsPassthrough());
+    XCTAssertGreaterThan(converter.GetTaps(), 0u);
+
+    converter.SetRates(48000.0, 48000.0, 512);
+    XCTAssertTrue(converter.IsPassthrough());
+}
+
+- (void) testPassbandRipple {
+    [self assertPassbandRipple:44100.0 outputRate:48000.0];
+    [self assertPassbandRipple:48000.0 outputRate:44100.0];
+    [self assertPassbandRipple:96000.0 outputRate:44100.0];
+}
+
+- (void) testAliasing {
+    [self assertAliasing:44100.0 outputRate:48000.0];
+    [self assertAliasing:48000.0 outputRate:44100.0];
+    [self assertAliasing:96000.0 outputRate:44100.0];
+}
+
+// The output shouldn't depend on how the input is split up, since the HAL doesn't always give the
+// output IOProc the same number of frames.
+- (void) testBlockSizeIndependence {
+    std::vector<Float32> input = StereoTone(1000.0, 44100.0, 44100);
+
+    BGMSampleRateConverter converter;
+    converter.SetRates(44100.0, 48000.0, 4096);
+    std::vector<Float32> expected = Convert(converter, input, 512);
+
+    converter.Reset();
+    std::vector<Float32> actual;
+    std::vector<Float32> block(4096 * 2);
+    size_t inputPosition = 0;
+    const UInt32 blockSizes[] = { 1, 37, 512, 1024, 100, 3000 };
+
+    for(size_t i = 0; actual.size() < expected.size(); i++)
+    {
+        const UInt32 blockFrames = blockSizes[i % (sizeof(blockSizes) / sizeof(blockSizes[0]))];
+        const UInt32 framesRequired = converter.GetInputFramesRequired(blockFrames);
+
+        if(inputPosition + framesRequired > input.size() / 2)
+        {
+            break;
+        }
+
+        converter.Process(&input[inputPosition * 2], framesRequired, block.data(), blockFrames);
+        inputPosition += framesRequired;
+
+        for(UInt32 j = 0; j < blockFrames; j++)
+        {
+            actual.push_back(block[2 * j]);
+        }
+    }
+
+    const size_t framesToCompare = std::min(actual.size(), expected.size());
+    XCTAssertGreaterThan(framesToCompare, 40000u);
+
+    for(size_t i = 0; i < framesToCompare; i++)
+    {
+        XCTAssertEqualWithAccuracy(actual[i], expected[i], 1e-5, @"Frame %zu", i);
+    }
+}
+
+- (void) testFillsWithSilenceWithoutEnoughInput {
+    BGMSampleRateConverter converter;
+    converter.SetRates(48000.0, 44100.0, 512);
+
+    std::vector<Float32> input = StereoTone(1000.0, 48000.0, 100);
+    std::vector<Float32> output(512 * 2, 1.0f);
+
+    const UInt32 framesProduced = converter.Process(input.data(), 100, output.data(), 512);
+
+    XCTAssertLessThan(framesProduced, 512u);
+
+    for(size_t i = framesProduced * 2; i < output.size(); i++)
+    {
+        XCTAssertEqual(output[i], 0.0f);
+    }
+}
+
+#pragma mark Performance
+
+// Converts a minute of stereo audio from 44.1 kHz to 48 kHz in IO-cycle-sized blocks. This has to be
+// many times faster than real time because the output IOProc does it on the real-time IO thread.
+- (void) testPerformance44100To48000 {
+    const Float64 seconds = 60.0;
+    std::vector<Float32> input = StereoTone(1000.0, 44100.0, static_cast<size_t>(44100.0 * seconds));
+    __block std::vector<Float32> output(512 * 2);
+
+    [self measureBlock:^{
+        BGMSampleRateConverter converter;
+        converter.SetRates(44100.0, 48000.0, 1024);
+
+        const size_t inputFrames = input.size() / 2;
+        size_t inputPosition = 0;
+        UInt64 framesProduced = 0;
+        NSDate* start = [NSDate date];
+
+        while(true)
+        {
+            const UInt32 framesRequired = converter.GetInputFramesRequired(512);
+
+            if(inputPosition + framesRequired > inputFrames)
+            {
+                break;
+            }
+
+            framesProduced +=
+                    converter.Process(&input[inputPosition * 2], framesRequired, output.data(), 512);
+            inputPosition += framesRequired;
+        }
+
+        NSLog(@"Converted %.0f seconds of audio at %.1fx real time",
+              framesProduced / 48000.0,
+              (framesProduced / 48000.0) / -[start timeIntervalSinceNow]);
+    }];
+}
+
+@end
+
@@ -26,7 +26,12 @@
 // BGM Includes
 #include "BGM_Types.h"
 
+// PublicUtility Includes
+#include "CADebugMacros.h"
+#include "CAException.h"
+
 // STL Includes
+#include <algorithm>
 #include <functional>
 
 
@@ -35,10 +40,161 @@ MockAudioDevice::MockAudioDevice(const std::string& inUID)
     mUID(inUID),
     mNominalSampleRate(44100.0),
     mIOBufferSize(512),
+    mName(inUID),
     MockAudioObject(static_cast<AudioObjectID>(std::hash<std::string>{}(inUID)))
 {
 }
 
+#pragma mark IOProcs
+
+AudioDeviceIOProcID MockAudioDevice::CreateIOProcID(AudioDeviceIOProc inIOProc, void* inClientData)
+{
+    // The IDs are opaque to the code using them, so they just need to be unique.
+    static std::atomic<uintptr_t> sNextIOProcID { 0x99990000 };
+    AudioDeviceIOProcID theIOProcID = reinterpret_cast<AudioDeviceIOProcID>(sNextIOProcID += 0x10);
+
+    std::lock_guard<std::mutex> lock(mIOProcsMutex);
+    mIOProcs[theIOProcID] = { inIOProc, inClientData, false };
+
+    return theIOProcID;
+}
+
+void MockAudioDevice::DestroyIOProcID(AudioDeviceIOProcID inIOProcID)
+{
+    std::lock_guard<std::mutex> lock(mIOProcsMutex);
+    ThrowIf(mIOProcs.erase(inIOProcID) == 0,
+            CAException(kAudioHardwareBadObjectError),
+            "MockAudioDevice::DestroyIOProcID: Unknown IOProc ID");
+}
+
+void MockAudioDevice::StartIOProc(AudioDeviceIOProcID inIOProcID)
+{
+    std::lock_guard<std::mutex> lock(mIOProcsMutex);
+
+    auto ioProc = mIOProcs.find(inIOProcID);
+    ThrowIf(ioProc == mIOProcs.end(),
+            CAException(kAudioHardwareBadObjectError),
+            "MockAudioDevice::StartIOProc: Unknown IOProc ID");
+
+    bool wasRunning = false;
+
+    for(auto& otherIOProc : mIOProcs)
+    {
+        wasRunning = wasRunning || otherIOProc.second.mStarted;
+    }
+
+    if(!wasRunning)
+    {
+        mIOStartCount++;
+    }
+
+    ioProc->second.mStarted = true;
+}
+
+void MockAudioDevice::StopIOProc(AudioDeviceIOProcID inIOProcID)
+{
+    std::lock_guard<std::mutex> lock(mIOProcsMutex);
+
+    auto ioProc = mIOProcs.find(inIOProcID);
+    ThrowIf(ioProc == mIOProcs.end(),
+            CAException(kAudioHardwareBadObjectError),
+            "MockAudioDevice::StopIOProc: Unknown IOProc ID");
+
+    ioProc->second.mStarted = false;
+}
+
+bool MockAudioDevice::IsRunningIO() const
+{
+    std::lock_guard<std::mutex> lock(mIOProcsMutex);
+
+    for(auto& ioProc : mIOProcs)
+    {
+        if(ioProc.second.mStarted)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+UInt64 MockAudioDevice::GetIOStartCount() const
+{
+    std::lock_guard<std::mutex> lock(mIOProcsMutex);
+    return mIOStartCount;
+}
+
+Float64 MockAudioDevice::GetActualSampleRate() const
+{
+    return mNominalSampleRate * (1.0 + mClockDriftPPM / 1000000.0);
+}
+
+void MockAudioDevice::CallIOProcs(const AudioTimeStamp& inNow,
+                                  const AudioBufferList& inInputData,
+                                  const AudioTimeStamp& inInputTime,
+                                  AudioBufferList& outOutputData,
+                                  const AudioTimeStamp& inOutputTime)
+{
+    // Copy the IOProcs so the lock isn't held while they run. They can stop themselves, which takes
+    // the lock.
+    std::vector<AudioDeviceIOProcID> startedIOProcs;
+
+    {
+        std::lock_guard<std::mutex> lock(mIOProcsMutex);
+
+        for(auto& ioProc : mIOProcs)
+        {
+            if(ioProc.second.mStarted)
+            {
+                startedIOProcs.push_back(ioProc.first);
+            }
+        }
+    }
+
+    // Each IOProc gets its own output buffer and the HAL mixes them.
+    const UInt32 outputSize = outOutputData.mBuffers[0].mDataByteSize;
+    std::vector<Float32> ioProcOutput(outputSize / sizeof(Float32));
+    Float32* mixedOutput = static_cast<Float32*>(outOutputData.mBuffers[0].mData);
+    std::fill(mixedOutput, mixedOutput + ioProcOutput.size(), 0.0f);
+
+    for(AudioDeviceIOProcID ioProcID : startedIOProcs)
+    {
+        AudioDeviceIOProc proc;
+        void* clientData;
+
+        {
+            std::lock_guard<std::mutex> lock(mIOProcsMutex);
+            auto ioProc = mIOProcs.find(ioProcID);
+
+            // It might have been stopped or destroyed by one of the other IOProcs.
+            if(ioProc == mIOProcs.end() || !ioProc->second.mStarted)
+            {
+                continue;
+            }
+
+            proc = ioProc->second.mProc;
+            clientData = ioProc->second.mClientData;
+        }
+
+        std::fill(ioProcOutput.begin(), ioProcOutput.end(), 0.0f);
+
+        AudioBufferList ioProcOutputData = outOutputData;
+        ioProcOutputData.mBuffers[0].mData = ioProcOutput.data();
+
+        proc(GetObjectID(), &inNow, &inInputData, &inInputTime, &ioProcOutputData, &inOutputTime, clientData);
+
+        for(size_t i = 0; i < ioProcOutput.size(); i++)
+        {
+            mixedOutput[i] += ioProcOutput[i];
+        }
+    }
+}
+
+Float64 MockAudioDevice::GetHostTimeForSampleTime(Float64 inSampleTime) const
+{
+    return mIOStartHostTime + inSampleTime / GetActualSampleRate();
+}
+
 CACFString MockAudioDevice::GetPlayerBundleID() const
 {
     if(mUID != kBGMDeviceUID)
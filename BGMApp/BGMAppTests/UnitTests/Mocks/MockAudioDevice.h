@@ -26,8 +26,16 @@
 // Superclass Includes
 #include "MockAudioObject.h"
 
+// BGM Includes
+#include "BGM_Types.h"
+
 // STL Includes
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
 
 
 /*!
@@ -56,6 +64,48 @@ public:
      */
     void SetPlayerBundleID(const CACFString& inPlayerBundleID);
 
+#pragma mark IOProcs
+
+    /*!
+     * Register an IOProc with the device. MockIOScheduler calls the device's IOProcs while they're
+     * started. These are called by the mock CAHALAudioDevice.
+     */
+    AudioDeviceIOProcID CreateIOProcID(AudioDeviceIOProc inIOProc, void* inClientData);
+    /*! @throws CAException If the IOProc ID isn't registered with this device. */
+    void DestroyIOProcID(AudioDeviceIOProcID inIOProcID);
+    /*! @throws CAException If the IOProc ID isn't registered with this device. */
+    void StartIOProc(AudioDeviceIOProcID inIOProcID);
+    /*!
+     * Can be called from inside the IOProc. It won't be called again after it returns, like in the
+     * real HAL.
+     * @throws CAException If the IOProc ID isn't registered with this device.
+     */
+    void StopIOProc(AudioDeviceIOProcID inIOProcID);
+
+    /*! True if any of the device's IOProcs are started. */
+    bool IsRunningIO() const;
+    /*!
+     * Incremented each time the device starts IO, i.e. when one of its IOProcs is started and none
+     * of the others were running. The device's sample times start again from zero each time.
+     */
+    UInt64 GetIOStartCount() const;
+
+    /*!
+     * The device's actual sample rate, which is the nominal rate adjusted by mClockDriftPPM. This is
+     * the rate MockIOScheduler runs the device's clock at.
+     */
+    Float64 GetActualSampleRate() const;
+
+    /*!
+     * Call each of the device's started IOProcs. Only MockIOScheduler should call this.
+     * @param outOutputData The IOProcs' output, mixed together.
+     */
+    void CallIOProcs(const AudioTimeStamp& inNow,
+                     const AudioBufferList& inInputData,
+                     const AudioTimeStamp& inInputTime,
+                     AudioBufferList& outOutputData,
+                     const AudioTimeStamp& inOutputTime);
+
     /*!
      * The device's UID. The UID is a persistent token used to identify a particular audio device
      * across boot sessions.
@@ -64,9 +114,79 @@ public:
     Float64 mNominalSampleRate;
     UInt32 mIOBufferSize;
 
+    /*! The device's name. Defaults to its UID. */
+    std::string mName;
+    UInt32 mTransportType = kAudioDeviceTransportTypeVirtual;
+    bool mIsHidden = false;
+    bool mCanBeDefaultDevice = true;
+    /*!
+     * The device's kAudioDeviceCustomPropertyDeviceAudibleState property. Only meaningful if this
+     * device is a mock of BGMDevice. Changing it doesn't notify the listeners.
+     */
+    std::atomic<BGMDeviceAudibleState> mAudibleState { kBGMDeviceIsAudible };
+
+    /*! Returned by CAHALAudioDevice::IsAlive. Set it to false to simulate the device being removed. */
+    std::atomic<bool> mIsAlive { true };
+
+#pragma mark Simulated Clock
+
+    /*!
+     * How much faster the device's clock runs than its nominal sample rate, in parts per million.
+     * Can be negative.
+     */
+    Float64 mClockDriftPPM = 0.0;
+    /*!
+     * The maximum time, in seconds, MockIOScheduler will delay each of the device's IO cycles by. The
+     * delays are random, but the timestamps passed to the IOProcs aren't affected, like a real IO
+     * thread waking up late.
+     */
+    Float64 mIOJitterSeconds = 0.0;
+    /*! How long, in seconds, the device takes to start its clock after its IOProcs are started. */
+    Float64 mStartDelaySeconds = 0.0;
+
+    /*!
+     * Fills the input buffer for each IO cycle. Gets the sample time of the first frame in the
+     * buffer. By default, each sample is set to its frame's sample time plus one, so the output of
+     * code that copies the input can be traced back to when it was captured. (And so it's never
+     * silent.)
+     */
+    std::function<void(Float64 inSampleTime, AudioBufferList& ioInputData)> mInputGenerator;
+
+#pragma mark Recorded IO
+
+    /*!
+     * The first channel of the output the device's IOProcs have written since it last started IO,
+     * recorded by MockIOScheduler. Only read it while the scheduler isn't running.
+     */
+    std::vector<Float32> mRecordedOutput;
+    /*! The output sample time of mRecordedOutput[0]. */
+    Float64 mRecordedOutputSampleTime = 0.0;
+    /*! The (virtual) host time, in seconds, of the device's sample time zero since it last started IO. */
+    Float64 mIOStartHostTime = 0.0;
+    /*! The number of IO cycles MockIOScheduler has run for the device. */
+    UInt64 mIOCycleCount = 0;
+
+    /*!
+     * @return The (virtual) host time, in seconds, the device's clock reached (or will reach)
+     *         inSampleTime since it last started IO.
+     */
+    Float64 GetHostTimeForSampleTime(Float64 inSampleTime) const;
+
 private:
+    struct IOProc
+    {
+        AudioDeviceIOProc mProc;
+        void* mClientData;
+        bool mStarted;
+    };
+
     CACFString mPlayerBundleID { "" };
 
+    /*! Guards mIOProcs and mIOStartCount. Never held while calling an IOProc. */
+    mutable std::mutex mIOProcsMutex;
+    std::map<AudioDeviceIOProcID, IOProc> mIOProcs;
+    UInt64 mIOStartCount = 0;
+
 };
 
 #endif /* BGMAppUnitTests__MockAudioDevice */
@@ -23,6 +23,9 @@
 // Self Include
 #include "MockAudioObject.h"
 
+// STL Includes
+#include <algorithm>
+
 
 MockAudioObject::MockAudioObject(AudioObjectID inAudioObjectID)
 :
@@ -35,3 +38,58 @@ AudioObjectID MockAudioObject::GetObjectID() const
     return mAudioObjectID;
 }
 
+void MockAudioObject::AddPropertyListener(const AudioObjectPropertyAddress& inAddress,
+                                          AudioObjectPropertyListenerProc inListenerProc,
+                                          void* inClientData)
+{
+    mPropertyListeners.push_back({ inAddress, inListenerProc, inClientData });
+    mPropertiesWithListeners.insert(inAddress.mSelector);
+}
+
+void MockAudioObject::RemovePropertyListener(const AudioObjectPropertyAddress& inAddress,
+                                             AudioObjectPropertyListenerProc inListenerProc,
+                                             void* inClientData)
+{
+    auto listener = std::find_if(mPropertyListeners.begin(),
+                                 mPropertyListeners.end(),
+                                 [&](const PropertyListener& inListener) {
+                                     return inListener.mAddress.mSelector == inAddress.mSelector &&
+                                            inListener.mAddress.mScope == inAddress.mScope &&
+                                            inListener.mAddress.mElement == inAddress.mElement &&
+                                            inListener.mListenerProc == inListenerProc &&
+                                            inListener.mClientData == inClientData;
+                                 });
+
+    if(listener != mPropertyListeners.end())
+    {
+        mPropertyListeners.erase(listener);
+    }
+
+    // Only forget the property if this was its last listener.
+    if(std::none_of(mPropertyListeners.begin(),
+                    mPropertyListeners.end(),
+                    [&](const PropertyListener& inListener) {
+                        return inListener.mAddress.mSelector == inAddress.mSelector;
+                    }))
+    {
+        mPropertiesWithListeners.erase(inAddress.mSelector);
+    }
+}
+
+void MockAudioObject::NotifyPropertyListeners(AudioObjectPropertySelector inSelector)
+{
+    // Copy the listeners first because they can remove themselves.
+    const std::vector<PropertyListener> listeners = mPropertyListeners;
+
+    for(const PropertyListener& listener : listeners)
+    {
+        if(listener.mAddress.mSelector == inSelector ||
+           listener.mAddress.mSelector == kAudioObjectPropertySelectorWildcard)
+        {
+            const AudioObjectPropertyAddress address = {
+                inSelector, listener.mAddress.mScope, listener.mAddress.mElement
+            };
+            listener.mListenerProc(mAudioObjectID, 1, &address, listener.mClientData);
+        }
+    }
+}
@@ -27,7 +27,9 @@
 #include "CACFString.h"
 
 // STL Includes
+#include <map>
 #include <set>
+#include <vector>
 
 // System Includes
 #include <CoreAudio/CoreAudio.h>
@@ -52,8 +54,37 @@ public:
      */
     std::set<AudioObjectPropertySelector> mPropertiesWithListeners;
 
+    /*!
+     * The number of times CAHALAudioObject::GetPropertyData has been called for each property of
+     * this object. Lets tests check how often the code they're testing queries the HAL.
+     */
+    std::map<AudioObjectPropertySelector, UInt32> mPropertyDataRequests;
+
+    /*! Called by the mock CAHALAudioObject::AddPropertyListener. */
+    void AddPropertyListener(const AudioObjectPropertyAddress& inAddress,
+                             AudioObjectPropertyListenerProc inListenerProc,
+                             void* inClientData);
+    /*! Called by the mock CAHALAudioObject::RemovePropertyListener. */
+    void RemovePropertyListener(const AudioObjectPropertyAddress& inAddress,
+                                AudioObjectPropertyListenerProc inListenerProc,
+                                void* inClientData);
+
+    /*!
+     * Call the listeners that have been added for the property, like the HAL does when a property's
+     * value changes. Unlike the HAL, they're called synchronously, on the calling thread.
+     */
+    void NotifyPropertyListeners(AudioObjectPropertySelector inSelector);
+
 private:
+    struct PropertyListener
+    {
+        AudioObjectPropertyAddress mAddress;
+        AudioObjectPropertyListenerProc mListenerProc;
+        void* mClientData;
+    };
+
     AudioObjectID mAudioObjectID;
+    std::vector<PropertyListener> mPropertyListeners;
 
 };
 
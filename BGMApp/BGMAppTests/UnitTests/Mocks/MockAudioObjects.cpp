@@ -27,6 +27,10 @@
 #include "CACFString.h"
 
 
+// static
+const std::shared_ptr<MockAudioObject> MockAudioObjects::sSystemObject =
+        std::make_shared<MockAudioObject>(kAudioObjectSystemObject);
+
 // static
 MockAudioObjects::MockDeviceMap MockAudioObjects::sDevices;
 
@@ -41,6 +45,8 @@ std::shared_ptr<MockAudioDevice> MockAudioObjects::CreateMockDevice(const std::s
     sDevices.insert(MockDeviceMap::value_type(mockDevice->GetObjectID(), mockDevice));
     sDevicesByUID.insert(MockDeviceMapByUID::value_type(inUID, mockDevice));
 
+    sSystemObject->NotifyPropertyListeners(kAudioHardwarePropertyDevices);
+
     return mockDevice;
 }
 
@@ -48,6 +54,20 @@ std::shared_ptr<MockAudioDevice> MockAudioObjects::CreateMockDevice(const std::s
 void MockAudioObjects::DestroyMocks()
 {
     sDevices.clear();
+    sDevicesByUID.clear();
+
+    // Let listeners, e.g. BGMAudioPropertyCache, forget the destroyed devices before the next test
+    // creates new ones, which could have the same IDs. The system object itself isn't destroyed,
+    // since code that listens to it usually keeps listening for as long as the process runs.
+    sSystemObject->NotifyPropertyListeners(kAudioHardwarePropertyDevices);
+    sSystemObject->mPropertyDataRequests.clear();
+}
+
+// static
+bool MockAudioObjects::AudioObjectExists(AudioObjectID inAudioObjectID)
+{
+    return inAudioObjectID == kAudioObjectSystemObject ||
+            GetAudioDeviceOrNull(inAudioObjectID) != nullptr;
 }
 
 // static
@@ -60,7 +80,12 @@ std::shared_ptr<MockAudioObject> MockAudioObjects::GetAudioObject(AudioObjectID
         return device;
     }
 
-    // Devices are the only audio objects we currently mock.
+    if(inAudioObjectID == kAudioObjectSystemObject)
+    {
+        return sSystemObject;
+    }
+
+    // Devices and the system object are the only audio objects we currently mock.
 
     // Tests have to create mocks for all of the audio objects they expect the code they test to
     // access. They should fail if it accesses any others.
@@ -107,6 +132,19 @@ std::shared_ptr<MockAudioDevice> MockAudioObjects::GetAudioDevice(const std::str
     return nullptr;
 }
 
+// static
+std::vector<std::shared_ptr<MockAudioDevice>> MockAudioObjects::GetAudioDevices()
+{
+    std::vector<std::shared_ptr<MockAudioDevice>> devices;
+
+    for(auto& device : sDevices)
+    {
+        devices.push_back(device.second);
+    }
+
+    return devices;
+}
+
 // static
 std::shared_ptr<MockAudioDevice>
 MockAudioObjects::GetAudioDeviceOrNull(AudioObjectID inAudioObjectID)
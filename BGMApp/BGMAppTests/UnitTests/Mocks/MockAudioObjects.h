@@ -31,6 +31,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 // System Includes
 #include <CoreAudio/CoreAudio.h>
@@ -60,10 +61,19 @@ public:
     /*!
      * Remove all mock audio objects from the mock HAL. (Currently, mock devices are the only mock
      * objects that can be created.)
+     *
+     * CreateMockDevice and DestroyMocks notify the system object's kAudioHardwarePropertyDevices
+     * listeners, like the HAL does when devices are added or removed.
      */
     static void DestroyMocks();
 
-    /*! Get a mock audio object by its ID. */
+    /*! @return True if there's a mock audio object with the given ID. */
+    static bool AudioObjectExists(AudioObjectID inAudioObjectID);
+
+    /*!
+     * Get a mock audio object by its ID. The system object (kAudioObjectSystemObject) always
+     * exists.
+     */
     static std::shared_ptr<MockAudioObject> GetAudioObject(AudioObjectID inAudioObjectID);
 
     /*! Get a mock audio device by its ID. */
@@ -72,6 +82,8 @@ public:
     static std::shared_ptr<MockAudioDevice> GetAudioDevice(const std::string& inUID);
     /*! Get a mock audio device by its UID. */
     static std::shared_ptr<MockAudioDevice> GetAudioDevice(CFStringRef inUID);
+    /*! Get all of the mock audio devices. */
+    static std::vector<std::shared_ptr<MockAudioDevice>> GetAudioDevices();
 
 private:
     typedef std::map<AudioObjectID, std::shared_ptr<MockAudioDevice>> MockDeviceMap;
@@ -79,6 +91,8 @@ private:
 
     static std::shared_ptr<MockAudioDevice> GetAudioDeviceOrNull(AudioObjectID inAudioDeviceID);
 
+    /*! The mock of the HAL's system object. */
+    static const std::shared_ptr<MockAudioObject> sSystemObject;
     /*! Maps IDs to mocked audio devices. */
     static MockDeviceMap sDevices;
     /*! Maps UIDs (ID strings) to mocked audio devices. */
@@ -0,0 +1,283 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  MockIOScheduler.cpp
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "MockIOScheduler.h"
+
+// Local Includes
+#include "MockAudioObjects.h"
+
+// STL Includes
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+
+// The mock devices' streams. See the mock kAudioStreamPropertyVirtualFormat.
+static const UInt32 kChannels = 2;
+
+// How often the background thread runs the IO cycles that are due, in real time.
+static const std::chrono::microseconds kBackgroundStep(500);
+
+MockIOScheduler::MockIOScheduler(UInt32 inSeed)
+:
+    mRandom(inSeed)
+{
+}
+
+MockIOScheduler::~MockIOScheduler()
+{
+    StopRunningInBackground();
+}
+
+Float64 MockIOScheduler::GetCurrentTime() const
+{
+    return mCurrentTime;
+}
+
+void MockIOScheduler::RunFor(Float64 inSeconds)
+{
+    std::lock_guard<std::mutex> lock(mRunMutex);
+
+    const Float64 endTime = mCurrentTime + inSeconds;
+
+    while(RunNextCycle(endTime))
+    {
+    }
+
+    mCurrentTime = endTime;
+}
+
+bool MockIOScheduler::RunUntil(std::function<bool()> inCondition, Float64 inTimeoutSeconds)
+{
+    std::lock_guard<std::mutex> lock(mRunMutex);
+
+    const Float64 endTime = mCurrentTime + inTimeoutSeconds;
+
+    while(!inCondition())
+    {
+        if(!RunNextCycle(endTime))
+        {
+            mCurrentTime = endTime;
+            return inCondition();
+        }
+    }
+
+    return true;
+}
+
+void MockIOScheduler::StartRunningInBackground(Float64 inSpeed)
+{
+    if(mRunningInBackground.exchange(true))
+    {
+        return;
+    }
+
+    const Float64 virtualSecondsPerStep =
+            std::chrono::duration<Float64>(kBackgroundStep).count() * inSpeed;
+
+    mBackgroundThread.reset(new std::thread([this, virtualSecondsPerStep] {
+        while(mRunningInBackground)
+        {
+            RunFor(virtualSecondsPerStep);
+            std::this_thread::sleep_for(kBackgroundStep);
+        }
+    }));
+}
+
+void MockIOScheduler::StopRunningInBackground()
+{
+    mRunningInBackground = false;
+
+    if(mBackgroundThread)
+    {
+        mBackgroundThread->join();
+        mBackgroundThread.reset();
+    }
+}
+
+#pragma mark Device Clocks
+
+void MockIOScheduler::UpdateDeviceClocks()
+{
+    const std::vector<std::shared_ptr<MockAudioDevice>> devices = MockAudioObjects::GetAudioDevices();
+
+    // Forget the devices that have been destroyed.
+    for(auto clock = mClocks.begin(); clock != mClocks.end(); )
+    {
+        const bool destroyed = std::find(devices.begin(), devices.end(), clock->second.mDevice) == devices.end();
+        clock = destroyed ? mClocks.erase(clock) : std::next(clock);
+    }
+
+    for(const std::shared_ptr<MockAudioDevice>& device : devices)
+    {
+        DeviceClock& clock = mClocks[device->GetObjectID()];
+        clock.mDevice = device;
+        const UInt64 ioStartCount = device->GetIOStartCount();
+
+        if(clock.mIOStartCount != ioStartCount)
+        {
+            // The device has started IO since we last checked, so restart its clock. (Even if it
+            // was running, since it must have stopped in between.)
+            clock.mIOStartCount = ioStartCount;
+            clock.mRunning = true;
+            clock.mSampleTime = 0.0;
+
+            device->mIOStartHostTime = mCurrentTime + device->mStartDelaySeconds;
+            device->mRecordedOutput.clear();
+            device->mRecordedOutputSampleTime = 0.0;
+
+            ScheduleNextCycle(*device, clock);
+        }
+        else if(clock.mRunning && !device->IsRunningIO())
+        {
+            clock.mRunning = false;
+        }
+    }
+}
+
+void MockIOScheduler::ScheduleNextCycle(const MockAudioDevice& inDevice, DeviceClock& ioClock)
+{
+    // The cycle runs once the clock has captured a full buffer. A real IO thread can wake up late,
+    // but never early.
+    const Float64 cycleTime =
+            inDevice.GetHostTimeForSampleTime(ioClock.mSampleTime + inDevice.mIOBufferSize);
+    std::uniform_real_distribution<Float64> jitter(0.0, inDevice.mIOJitterSeconds);
+
+    ioClock.mNextWakeTime = cycleTime + (inDevice.mIOJitterSeconds > 0.0 ? jitter(mRandom) : 0.0);
+}
+
+#pragma mark IO Cycles
+
+bool MockIOScheduler::RunNextCycle(Float64 inEndTime)
+{
+    UpdateDeviceClocks();
+
+    // Find the device whose next cycle is due first.
+    DeviceClock* nextClock = nullptr;
+
+    for(auto& clock : mClocks)
+    {
+        if(clock.second.mRunning &&
+           clock.second.mNextWakeTime <= inEndTime &&
+           (!nextClock || clock.second.mNextWakeTime < nextClock->mNextWakeTime))
+        {
+            nextClock = &clock.second;
+        }
+    }
+
+    if(!nextClock)
+    {
+        return false;
+    }
+
+    mCurrentTime = std::max(mCurrentTime.load(), nextClock->mNextWakeTime);
+    RunCycle(*nextClock->mDevice, *nextClock);
+
+    return true;
+}
+
+void MockIOScheduler::RunCycle(MockAudioDevice& ioDevice, DeviceClock& ioClock)
+{
+    const UInt32 frames = ioDevice.mIOBufferSize;
+    const Float64 rateScalar = ioDevice.GetActualSampleRate() / ioDevice.mNominalSampleRate;
+
+    // The input buffer holds the frames the clock just captured, so its timestamp is one buffer
+    // behind the current time. The output will be played one buffer after the current time.
+    const Float64 inputSampleTime = ioClock.mSampleTime;
+    const Float64 nowSampleTime = inputSampleTime + frames;
+    const Float64 outputSampleTime = nowSampleTime + frames;
+
+    const AudioTimeStamp now =
+            MakeTimeStamp(nowSampleTime, ioDevice.GetHostTimeForSampleTime(nowSampleTime), rateScalar);
+    const AudioTimeStamp inputTime =
+            MakeTimeStamp(inputSampleTime, ioDevice.GetHostTimeForSampleTime(inputSampleTime), rateScalar);
+    const AudioTimeStamp outputTime =
+            MakeTimeStamp(outputSampleTime, ioDevice.GetHostTimeForSampleTime(outputSampleTime), rateScalar);
+
+    // Generate the input.
+    std::vector<Float32> inputSamples(frames * kChannels);
+
+    AudioBufferList inputData;
+    inputData.mNumberBuffers = 1;
+    inputData.mBuffers[0].mNumberChannels = kChannels;
+    inputData.mBuffers[0].mDataByteSize = static_cast<UInt32>(inputSamples.size() * sizeof(Float32));
+    inputData.mBuffers[0].mData = inputSamples.data();
+
+    if(ioDevice.mInputGenerator)
+    {
+        ioDevice.mInputGenerator(inputSampleTime, inputData);
+    }
+    else
+    {
+        for(UInt32 frame = 0; frame < frames; frame++)
+        {
+            for(UInt32 channel = 0; channel < kChannels; channel++)
+            {
+                inputSamples[frame * kChannels + channel] =
+                        static_cast<Float32>(inputSampleTime + frame + 1);
+            }
+        }
+    }
+
+    // Call the IOProcs.
+    std::vector<Float32> outputSamples(frames * kChannels);
+
+    AudioBufferList outputData;
+    outputData.mNumberBuffers = 1;
+    outputData.mBuffers[0].mNumberChannels = kChannels;
+    outputData.mBuffers[0].mDataByteSize = static_cast<UInt32>(outputSamples.size() * sizeof(Float32));
+    outputData.mBuffers[0].mData = outputSamples.data();
+
+    ioDevice.CallIOProcs(now, inputData, inputTime, outputData, outputTime);
+
+    // Record the first channel of the output.
+    if(ioDevice.mRecordedOutput.empty())
+    {
+        ioDevice.mRecordedOutputSampleTime = outputSampleTime;
+    }
+
+    for(UInt32 frame = 0; frame < frames; frame++)
+    {
+        ioDevice.mRecordedOutput.push_back(outputSamples[frame * kChannels]);
+    }
+
+    ioDevice.mIOCycleCount++;
+
+    ioClock.mSampleTime = nowSampleTime;
+    ScheduleNextCycle(ioDevice, ioClock);
+}
+
+// static
+AudioTimeStamp MockIOScheduler::MakeTimeStamp(Float64 inSampleTime,
+                                              Float64 inHostTime,
+                                              Float64 inRateScalar)
+{
+    AudioTimeStamp timeStamp = {};
+    timeStamp.mSampleTime = inSampleTime;
+    timeStamp.mHostTime = static_cast<UInt64>(std::max(inHostTime, 0.0) * 1000000000.0);
+    timeStamp.mRateScalar = inRateScalar;
+    timeStamp.mFlags =
+            kAudioTimeStampSampleTimeValid | kAudioTimeStampHostTimeValid | kAudioTimeStampRateScalarValid;
+    return timeStamp;
+}
+
@@ -0,0 +1,138 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  MockIOScheduler.h
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+#ifndef BGMAppUnitTests__MockIOScheduler
+#define BGMAppUnitTests__MockIOScheduler
+
+// Local Includes
+#include "MockAudioDevice.h"
+
+// STL Includes
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+
+// System Includes
+#include <CoreAudio/CoreAudio.h>
+
+
+/*!
+ * Runs the IO cycles of the mock HAL's devices from virtual clocks, calling the IOProcs registered
+ * with them. This is the part of the HAL the other mocks leave out, so tests can run code like
+ * BGMPlayThrough's IOProcs.
+ *
+ * Each device's clock runs at MockAudioDevice::GetActualSampleRate from when one of its IOProcs is
+ * started (plus its mStartDelaySeconds) until they're all stopped. An IO cycle happens each time
+ * the clock has captured mIOBufferSize frames. The IOProcs get input data from the device's
+ * mInputGenerator, and an input timestamp one buffer behind the cycle's. Their output timestamp is
+ * one buffer ahead of it. The IO cycles of all the devices are run in the order of their (virtual)
+ * wake-up times, which include the devices' jitter, so the results only depend on the settings and
+ * the seed.
+ *
+ * Timestamps have valid sample times and host times. The host times are in virtual nanoseconds
+ * since the scheduler was created, rather than mach_absolute_time units, since no test code should
+ * depend on them matching the real clock.
+ *
+ * Every device is assumed to have one stereo input stream and one stereo output stream of
+ * interleaved 32-bit floats, which matches the mock kAudioStreamPropertyVirtualFormat.
+ *
+ * The scheduler can also run on a background thread, roughly in step with real time. Use that
+ * when testing code that waits for IOProcs to run, like BGMPlayThrough::Stop. Create the mock
+ * devices before starting it, and stop it before calling MockAudioObjects::DestroyMocks.
+ */
+class MockIOScheduler
+{
+
+public:
+    /*! @param inSeed The seed for the random numbers, currently only used for the jitter. */
+    MockIOScheduler(UInt32 inSeed = 1);
+    ~MockIOScheduler();
+
+    MockIOScheduler(const MockIOScheduler&) = delete;
+    MockIOScheduler& operator=(const MockIOScheduler&) = delete;
+
+    /*! The current virtual time, in seconds since the scheduler was created. */
+    Float64 GetCurrentTime() const;
+
+    /*!
+     * Run every IO cycle due in the next inSeconds of virtual time on the calling thread, then
+     * advance the virtual time to the end of that period.
+     */
+    void RunFor(Float64 inSeconds);
+
+    /*!
+     * Run IO cycles until inCondition returns true or inTimeoutSeconds of virtual time passes.
+     * inCondition is checked after each cycle.
+     * @return True if inCondition returned true.
+     */
+    bool RunUntil(std::function<bool()> inCondition, Float64 inTimeoutSeconds);
+
+    /*!
+     * Start running IO cycles on a background thread.
+     * @param inSpeed How many seconds of virtual time to run per second of real time.
+     */
+    void StartRunningInBackground(Float64 inSpeed = 1.0);
+    /*! Stop the background thread and wait for it to finish. */
+    void StopRunningInBackground();
+
+private:
+    struct DeviceClock
+    {
+        std::shared_ptr<MockAudioDevice> mDevice;
+        bool mRunning = false;
+        UInt64 mIOStartCount = 0;
+        /*! The sample time at the start of the next IO cycle's input buffer. */
+        Float64 mSampleTime = 0.0;
+        /*! The virtual time the next IO cycle will run at, including the jitter. */
+        Float64 mNextWakeTime = 0.0;
+    };
+
+    /*! Start and stop the device clocks to match their IOProcs and devices being created/destroyed. */
+    void UpdateDeviceClocks();
+    void ScheduleNextCycle(const MockAudioDevice& inDevice, DeviceClock& ioClock);
+
+    /*!
+     * Run the next IO cycle due before inEndTime, if there is one.
+     * @return True if a cycle was run.
+     */
+    bool RunNextCycle(Float64 inEndTime);
+    void RunCycle(MockAudioDevice& ioDevice, DeviceClock& ioClock);
+
+    static AudioTimeStamp MakeTimeStamp(Float64 inSampleTime, Float64 inHostTime, Float64 inRateScalar);
+
+    /*! Held while running IO cycles, so RunFor can't be called while running in the background. */
+    std::mutex mRunMutex;
+    std::atomic<Float64> mCurrentTime { 0.0 };
+    std::map<AudioObjectID, DeviceClock> mClocks;
+    std::mt19937 mRandom;
+
+    std::unique_ptr<std::thread> mBackgroundThread;
+    std::atomic<bool> mRunningInBackground { false };
+
+};
+
+#endif /* BGMAppUnitTests__MockIOScheduler */
+
@@ -69,21 +69,39 @@ UInt32	CAHALAudioDevice::GetIOBufferSize() const
 
 void	CAHALAudioDevice::SetIOBufferSize(UInt32 inBufferSize)
 {
-    MockAudioObjects::GetAudioDevice(GetObjectID())->mIOBufferSize = inBufferSize;
+    auto device = MockAudioObjects::GetAudioDevice(GetObjectID());
+    device->mIOBufferSize = inBufferSize;
+    device->NotifyPropertyListeners(kAudioDevicePropertyBufferFrameSize);
 }
 
 bool	CAHALAudioDevice::IsAlive() const
 {
-    return true;
+    return MockAudioObjects::GetAudioDevice(GetObjectID())->mIsAlive;
 }
 
 AudioDeviceIOProcID	CAHALAudioDevice::CreateIOProcID(AudioDeviceIOProc inIOProc, void* inClientData)
 {
-    return reinterpret_cast<AudioDeviceIOProcID>(0x99990000);
+    return MockAudioObjects::GetAudioDevice(GetObjectID())->CreateIOProcID(inIOProc, inClientData);
 }
 
 void	CAHALAudioDevice::DestroyIOProcID(AudioDeviceIOProcID inIOProcID)
 {
+    MockAudioObjects::GetAudioDevice(GetObjectID())->DestroyIOProcID(inIOProcID);
+}
+
+void	CAHALAudioDevice::StartIOProc(AudioDeviceIOProcID inIOProcID)
+{
+    MockAudioObjects::GetAudioDevice(GetObjectID())->StartIOProc(inIOProcID);
+}
+
+void	CAHALAudioDevice::StopIOProc(AudioDeviceIOProcID inIOProcID)
+{
+    MockAudioObjects::GetAudioDevice(GetObjectID())->StopIOProc(inIOProcID);
+}
+
+Float64	CAHALAudioDevice::GetActualSampleRate() const
+{
+    return MockAudioObjects::GetAudioDevice(GetObjectID())->GetActualSampleRate();
 }
 
 Float64	CAHALAudioDevice::GetNominalSampleRate() const
@@ -93,7 +111,9 @@ Float64	CAHALAudioDevice::GetNominalSampleRate() const
 
 void	CAHALAudioDevice::SetNominalSampleRate(Float64 inSampleRate)
 {
-    MockAudioObjects::GetAudioDevice(GetObjectID())->mNominalSampleRate = inSampleRate;
+    auto device = MockAudioObjects::GetAudioDevice(GetObjectID());
+    device->mNominalSampleRate = inSampleRate;
+    device->NotifyPropertyListeners(kAudioDevicePropertyNominalSampleRate);
 }
 
 CFStringRef    CAHALAudioDevice::CopyDeviceUID() const
@@ -269,11 +289,6 @@ UInt32	CAHALAudioDevice::GetClockDomain() const
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-Float64	CAHALAudioDevice::GetActualSampleRate() const
-{
-    Throw(new CAException(kAudio_UnimplementedError));
-}
-
 UInt32	CAHALAudioDevice::GetNumberAvailableNominalSampleRateRanges() const
 {
     Throw(new CAException(kAudio_UnimplementedError));
@@ -319,21 +334,11 @@ void	CAHALAudioDevice::GetIOBufferSizeRange(UInt32& outMinimum, UInt32& outMaxim
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-void	CAHALAudioDevice::StartIOProc(AudioDeviceIOProcID inIOProcID)
-{
-    Throw(new CAException(kAudio_UnimplementedError));
-}
-
 void	CAHALAudioDevice::StartIOProcAtTime(AudioDeviceIOProcID inIOProcID, AudioTimeStamp& ioStartTime, bool inIsInput, bool inIgnoreHardware)
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-void	CAHALAudioDevice::StopIOProc(AudioDeviceIOProcID inIOProcID)
-{
-    Throw(new CAException(kAudio_UnimplementedError));
-}
-
 void	CAHALAudioDevice::GetIOProcStreamUsage(AudioDeviceIOProcID inIOProcID, bool inIsInput, bool* outStreamUsage) const
 {
     Throw(new CAException(kAudio_UnimplementedError));
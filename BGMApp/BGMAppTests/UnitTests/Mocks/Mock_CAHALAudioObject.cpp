@@ -52,14 +52,69 @@ AudioObjectID	CAHALAudioObject::GetObjectID() const
 
 void	CAHALAudioObject::GetPropertyData(const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32& ioDataSize, void* outData) const
 {
+    if(MockAudioObjects::AudioObjectExists(GetObjectID()))
+    {
+        MockAudioObjects::GetAudioObject(GetObjectID())->mPropertyDataRequests[inAddress.mSelector]++;
+    }
+
     switch(inAddress.mSelector)
     {
+        case kAudioDevicePropertyDeviceUID:
+            *reinterpret_cast<CFStringRef*>(outData) =
+                    CACFString(MockAudioObjects::GetAudioDevice(GetObjectID())->mUID.c_str()).CopyCFString();
+            break;
+
+        case kAudioObjectPropertyName:
+            *reinterpret_cast<CFStringRef*>(outData) =
+                    CACFString(MockAudioObjects::GetAudioDevice(GetObjectID())->mName.c_str()).CopyCFString();
+            break;
+
+        case kAudioDevicePropertyTransportType:
+            *reinterpret_cast<UInt32*>(outData) =
+                    MockAudioObjects::GetAudioDevice(GetObjectID())->mTransportType;
+            break;
+
+        case kAudioDevicePropertyIsHidden:
+            *reinterpret_cast<UInt32*>(outData) =
+                    MockAudioObjects::GetAudioDevice(GetObjectID())->mIsHidden ? 1 : 0;
+            break;
+
+        case kAudioDevicePropertyDeviceCanBeDefaultDevice:
+            *reinterpret_cast<UInt32*>(outData) =
+                    MockAudioObjects::GetAudioDevice(GetObjectID())->mCanBeDefaultDevice ? 1 : 0;
+            break;
+
+        case kAudioDevicePropertyStreamConfiguration:
+        {
+            // One stereo stream. See kAudioDevicePropertyStreams.
+            AudioBufferList* outBufferList = reinterpret_cast<AudioBufferList*>(outData);
+            outBufferList->mNumberBuffers = 1;
+            outBufferList->mBuffers[0].mNumberChannels = 2;
+            outBufferList->mBuffers[0].mDataByteSize = 0;
+            outBufferList->mBuffers[0].mData = nullptr;
+            ioDataSize = sizeof(AudioBufferList);
+            break;
+        }
+
+        case kAudioDevicePropertyNominalSampleRate:
+            *reinterpret_cast<Float64*>(outData) =
+                    MockAudioObjects::GetAudioDevice(GetObjectID())->mNominalSampleRate;
+            break;
+
         case kAudioDeviceCustomPropertyMusicPlayerBundleID:
             *reinterpret_cast<CFStringRef*>(outData) =
                     MockAudioObjects::GetAudioDevice(GetObjectID())->
                             GetPlayerBundleID().CopyCFString();
             break;
 
+        case kAudioDeviceCustomPropertyDeviceAudibleState:
+        {
+            SInt32 audibleState = MockAudioObjects::GetAudioDevice(GetObjectID())->mAudibleState;
+            *reinterpret_cast<CFNumberRef*>(outData) =
+                    CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &audibleState);
+            break;
+        }
+
         case kAudioDevicePropertyStreams:
             reinterpret_cast<AudioObjectID*>(outData)[0] = 1;
             if(inAddress.mScope == kAudioObjectPropertyScopeGlobal)
@@ -69,7 +124,8 @@ void	CAHALAudioObject::GetPropertyData(const AudioObjectPropertyAddress& inAddre
             break;
 
         case kAudioDevicePropertyBufferFrameSize:
-            *reinterpret_cast<UInt32*>(outData) = 512;
+            *reinterpret_cast<UInt32*>(outData) =
+                    MockAudioObjects::GetAudioDevice(GetObjectID())->mIOBufferSize;
             break;
 
         case kAudioDevicePropertyDeviceIsAlive:
@@ -117,6 +173,8 @@ UInt32	CAHALAudioObject::GetPropertyDataSize(const AudioObjectPropertyAddress& i
         case kAudioDevicePropertyStreams:
             return (inAddress.mScope == kAudioObjectPropertyScopeGlobal ? 2 : 1) *
                     sizeof(AudioObjectID);
+        case kAudioDevicePropertyStreamConfiguration:
+            return sizeof(AudioBufferList);
         default:
             Throw(new CAException(kAudio_UnimplementedError));
     }
@@ -125,13 +183,18 @@ UInt32	CAHALAudioObject::GetPropertyDataSize(const AudioObjectPropertyAddress& i
 void	CAHALAudioObject::AddPropertyListener(const AudioObjectPropertyAddress& inAddress, AudioObjectPropertyListenerProc inListenerProc, void* inClientData)
 {
     MockAudioObjects::GetAudioObject(GetObjectID())->
-            mPropertiesWithListeners.insert(inAddress.mSelector);
+            AddPropertyListener(inAddress, inListenerProc, inClientData);
 }
 
 void	CAHALAudioObject::RemovePropertyListener(const AudioObjectPropertyAddress& inAddress, AudioObjectPropertyListenerProc inListenerProc, void* inClientData)
 {
     MockAudioObjects::GetAudioObject(GetObjectID())->
-            mPropertiesWithListeners.erase(inAddress.mSelector);
+            RemovePropertyListener(inAddress, inListenerProc, inClientData);
+}
+
+bool	CAHALAudioObject::ObjectExists(AudioObjectID inObjectID)
+{
+    return MockAudioObjects::AudioObjectExists(inObjectID);
 }
 
 #pragma mark Unimplemented Methods
@@ -181,11 +244,6 @@ CFStringRef	CAHALAudioObject::CopyNumberNameForElement(AudioObjectPropertyScope
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-bool	CAHALAudioObject::ObjectExists(AudioObjectID inObjectID)
-{
-    Throw(new CAException(kAudio_UnimplementedError));
-}
-
 UInt32	CAHALAudioObject::GetNumberOwnedObjects(AudioClassID inClass) const
 {
     Throw(new CAException(kAudio_UnimplementedError));
@@ -25,6 +25,8 @@
 #include "BGM_AbstractDevice.h"
 
 // Local Includes
+#include "BGM_ObjectRegistry.h"
+#include "BGM_PropertyTable.h"
 #include "BGM_Utils.h"
 
 // PublicUtility Includes
@@ -44,42 +46,58 @@ BGM_AbstractDevice::~BGM_AbstractDevice()
 {
 }
 
+void    BGM_AbstractDevice::RegisterObjects()
+{
+    BGM_ObjectRegistry::RegisterDevice(*this);
+}
+
 #pragma mark Property Operations
 
+// The properties BGM_AbstractDevice implements for its subclasses, sorted by selector. Streams,
+// ControlList and AvailableNominalSampleRates have a size of 0 here because only the subclass knows
+// how many it has.
+static constexpr BGM_PropertyInfo kAbstractDeviceProperties[] = {
+    { kAudioDevicePropertyRelatedDevices,                 BGM_PropertyScopes::Any, false, sizeof(AudioObjectID), kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyClockDomain,                    BGM_PropertyScopes::Any, false, sizeof(UInt32),        kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioObjectPropertyControlList,                    BGM_PropertyScopes::Any, false, 0,                     kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyDeviceCanBeDefaultDevice,       BGM_PropertyScopes::Any, false, sizeof(UInt32),        kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyDeviceIsRunning,                BGM_PropertyScopes::Any, false, sizeof(UInt32),        kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyIsHidden,                       BGM_PropertyScopes::Any, false, sizeof(UInt32),        kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyDeviceIsAlive,                  BGM_PropertyScopes::Any, false, sizeof(AudioClassID),  kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioObjectPropertyManufacturer,                   BGM_PropertyScopes::Any, false, sizeof(CFStringRef),   kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioObjectPropertyName,                           BGM_PropertyScopes::Any, false, sizeof(CFStringRef),   kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyLatency,                        BGM_PropertyScopes::Any, false, sizeof(UInt32),        kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyModelUID,                       BGM_PropertyScopes::Any, false, sizeof(CFStringRef),   kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyAvailableNominalSampleRates,    BGM_PropertyScopes::Any, false, 0,                     kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyNominalSampleRate,              BGM_PropertyScopes::Any, false, sizeof(Float64),       kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyZeroTimeStampPeriod,            BGM_PropertyScopes::Any, false, sizeof(UInt32),        kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertySafetyOffset,                   BGM_PropertyScopes::Any, false, sizeof(UInt32),        kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyDeviceCanBeDefaultSystemDevice, BGM_PropertyScopes::Any, false, sizeof(UInt32),        kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyStreams,                        BGM_PropertyScopes::Any, false, 0,                     kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyTransportType,                  BGM_PropertyScopes::Any, false, sizeof(UInt32),        kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyDeviceUID,                      BGM_PropertyScopes::Any, false, sizeof(CFStringRef),   kAudioServerPlugInCustomPropertyDataTypeNone }
+};
+
+static_assert(BGM_PropertyTable::IsSorted(kAbstractDeviceProperties),
+              "kAbstractDeviceProperties must be sorted by selector");
+
+static constexpr BGM_PropertyTable sAbstractDeviceProperties(kAbstractDeviceProperties);
+
 bool    BGM_AbstractDevice::HasProperty(AudioObjectID inObjectID,
                                         pid_t inClientPID,
                                         const AudioObjectPropertyAddress& inAddress) const
 {
     bool theAnswer = false;
-    
-    switch(inAddress.mSelector)
+    const BGM_PropertyInfo* theInfo = sAbstractDeviceProperties.Find(inAddress.mSelector);
+
+    if(theInfo != nullptr)
     {
-        case kAudioObjectPropertyName:
-        case kAudioObjectPropertyManufacturer:
-        case kAudioDevicePropertyDeviceUID:
-        case kAudioDevicePropertyModelUID:
-        case kAudioDevicePropertyTransportType:
-        case kAudioDevicePropertyRelatedDevices:
-        case kAudioDevicePropertyClockDomain:
-        case kAudioDevicePropertyDeviceIsAlive:
-        case kAudioDevicePropertyDeviceIsRunning:
-        case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-        case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-        case kAudioDevicePropertyLatency:
-        case kAudioDevicePropertyStreams:
-        case kAudioObjectPropertyControlList:
-        case kAudioDevicePropertySafetyOffset:
-        case kAudioDevicePropertyNominalSampleRate:
-        case kAudioDevicePropertyAvailableNominalSampleRates:
-        case kAudioDevicePropertyIsHidden:
-        case kAudioDevicePropertyZeroTimeStampPeriod:
-            theAnswer = true;
-            break;
-            
-        default:
-            theAnswer = BGM_Object::HasProperty(inObjectID, inClientPID, inAddress);
-            break;
-    };
+        theAnswer = BGM_PropertyTable::HasScope(*theInfo, inAddress.mScope);
+    }
+    else
+    {
+        theAnswer = BGM_Object::HasProperty(inObjectID, inClientPID, inAddress);
+    }
 
     return theAnswer;
 }
@@ -89,35 +107,16 @@ bool    BGM_AbstractDevice::IsPropertySettable(AudioObjectID inObjectID,
                                                const AudioObjectPropertyAddress& inAddress) const
 {
     bool theAnswer = false;
+    const BGM_PropertyInfo* theInfo = sAbstractDeviceProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioObjectPropertyName:
-        case kAudioObjectPropertyManufacturer:
-        case kAudioDevicePropertyDeviceUID:
-        case kAudioDevicePropertyModelUID:
-        case kAudioDevicePropertyTransportType:
-        case kAudioDevicePropertyRelatedDevices:
-        case kAudioDevicePropertyClockDomain:
-        case kAudioDevicePropertyDeviceIsAlive:
-        case kAudioDevicePropertyDeviceIsRunning:
-        case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-        case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-        case kAudioDevicePropertyLatency:
-        case kAudioDevicePropertyStreams:
-        case kAudioObjectPropertyControlList:
-        case kAudioDevicePropertySafetyOffset:
-        case kAudioDevicePropertyNominalSampleRate:
-        case kAudioDevicePropertyAvailableNominalSampleRates:
-        case kAudioDevicePropertyIsHidden:
-        case kAudioDevicePropertyZeroTimeStampPeriod:
-            theAnswer = false;
-            break;
-            
-        default:
-            theAnswer = BGM_Object::IsPropertySettable(inObjectID, inClientPID, inAddress);
-            break;
-    };
+        theAnswer = theInfo->mIsSettable;
+    }
+    else
+    {
+        theAnswer = BGM_Object::IsPropertySettable(inObjectID, inClientPID, inAddress);
+    }
 
     return theAnswer;
 }
@@ -129,93 +128,20 @@ UInt32    BGM_AbstractDevice::GetPropertyDataSize(AudioObjectID inObjectID,
                                                   const void* __nullable inQualifierData) const
 {
     UInt32 theAnswer = 0;
+    const BGM_PropertyInfo* theInfo = sAbstractDeviceProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioObjectPropertyName:
-            theAnswer = sizeof(CFStringRef);
-            break;
-
-        case kAudioObjectPropertyManufacturer:
-            theAnswer = sizeof(CFStringRef);
-            break;
-
-        case kAudioDevicePropertyDeviceUID:
-            theAnswer = sizeof(CFStringRef);
-            break;
-
-        case kAudioDevicePropertyModelUID:
-            theAnswer = sizeof(CFStringRef);
-            break;
-
-        case kAudioDevicePropertyTransportType:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyRelatedDevices:
-            theAnswer = sizeof(AudioObjectID);
-            break;
-
-        case kAudioDevicePropertyClockDomain:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyDeviceIsAlive:
-            theAnswer = sizeof(AudioClassID);
-            break;
-
-        case kAudioDevicePropertyDeviceIsRunning:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyLatency:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyStreams:
-            theAnswer = 0;
-            break;
-
-        case kAudioObjectPropertyControlList:
-            theAnswer = 0;
-            break;
-
-        case kAudioDevicePropertySafetyOffset:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyNominalSampleRate:
-            theAnswer = sizeof(Float64);
-            break;
-
-        case kAudioDevicePropertyAvailableNominalSampleRates:
-            theAnswer = 0;
-            break;
-
-        case kAudioDevicePropertyIsHidden:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyZeroTimeStampPeriod:
-            theAnswer = sizeof(UInt32);
-            break;
-            
-        default:
-            theAnswer = BGM_Object::GetPropertyDataSize(inObjectID,
-                                                        inClientPID,
-                                                        inAddress,
-                                                        inQualifierDataSize,
-                                                        inQualifierData);
-            break;
-    };
+        theAnswer = theInfo->mDataSize;
+    }
+    else
+    {
+        theAnswer = BGM_Object::GetPropertyDataSize(inObjectID,
+                                                    inClientPID,
+                                                    inAddress,
+                                                    inQualifierDataSize,
+                                                    inQualifierData);
+    }
 
     return theAnswer;
 }
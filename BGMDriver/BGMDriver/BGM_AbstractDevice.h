@@ -41,6 +41,15 @@ protected:
                                                    AudioObjectID inOwnerObjectID);
     virtual                     ~BGM_AbstractDevice();
 
+public:
+    /*!
+     Adds the device and the objects it owns to BGM_ObjectRegistry, which publishes them to the HAL.
+     Called once, after constructing the device and before activating it. Subclasses that own
+     objects, like streams, should override this to register them as well. The objects are
+     unregistered automatically when they're destroyed.
+     */
+    virtual void                RegisterObjects();
+
 #pragma mark Property Operations
 
 public:
@@ -24,6 +24,9 @@
 // Self Include
 #include "BGM_AudibleState.h"
 
+// Local Includes
+#include "BGM_DSP.h"
+
 // PublicUtility Includes
 #include "CADebugMacros.h"
 #pragma clang diagnostic push
@@ -41,7 +44,8 @@ static const Float32 kSampleVolumeMarginRaw = 0.0001f;
 BGM_AudibleState::BGM_AudibleState()
 :
     mState(kBGMDeviceIsSilent),
-    mSampleTimes({0, 0, 0, 0})
+    mSampleTimes({0, 0, 0, 0}),
+    mNonMusicLevel({-1, -1, 0})
 {
 }
 
@@ -59,6 +63,10 @@ void    BGM_AudibleState::Reset() noexcept
     mSampleTimes.latestAudibleNonMusic = 0;
     mSampleTimes.latestSilentMusic = 0;
     mSampleTimes.latestAudibleMusic = 0;
+
+    mNonMusicLevel.startSampleTime = -1;
+    mNonMusicLevel.endSampleTime = -1;
+    mNonMusicLevel.peak = 0;
 }
 
 void    BGM_AudibleState::UpdateWithClientIO(bool inClientIsMusicPlayer,
@@ -80,8 +88,7 @@ void    BGM_AudibleState::UpdateWithClientIO(bool inClientIsMusicPlayer,
         }
         else
         {
-            mSampleTimes.latestSilentMusic = std::max(mSampleTimes.latestSilentMusic,
-                                                      endFrameSampleTime);
+            UpdateWithSilentClientIO(true, inIOBufferFrameSize, inOutputSampleTime);
         }
     }
     else if(endFrameSampleTime > mSampleTimes.latestAudibleNonMusic &&  // Don't bother checking the
@@ -94,24 +101,101 @@ void    BGM_AudibleState::UpdateWithClientIO(bool inClientIsMusicPlayer,
     }
 }
 
+void    BGM_AudibleState::UpdateWithSilentClientIO(bool inClientIsMusicPlayer,
+                                                   UInt32 inIOBufferFrameSize,
+                                                   Float64 inOutputSampleTime)
+{
+    // Only the music player's silent samples are tracked separately. For other clients, the latest
+    // silent sample is taken from the mixed audio in UpdateWithMixedIO.
+    if(inClientIsMusicPlayer)
+    {
+        Float64 endFrameSampleTime = inOutputSampleTime + inIOBufferFrameSize - 1;
+        mSampleTimes.latestSilentMusic = std::max(mSampleTimes.latestSilentMusic,
+                                                  endFrameSampleTime);
+    }
+}
+
 bool    BGM_AudibleState::UpdateWithMixedIO(UInt32 inIOBufferFrameSize,
                                             Float64 inOutputSampleTime,
                                             const Float32* inBuffer)
+{
+    if(!BufferIsAudible(inIOBufferFrameSize, inBuffer))
+    {
+        return UpdateWithSilentMixedIO(inIOBufferFrameSize, inOutputSampleTime);
+    }
+
+    // The sample time of the last frame we're looking at.
+    Float64 endFrameSampleTime = inOutputSampleTime + inIOBufferFrameSize - 1;
+
+    return RecalculateState(endFrameSampleTime);
+}
+
+bool    BGM_AudibleState::UpdateWithSilentMixedIO(UInt32 inIOBufferFrameSize,
+                                                  Float64 inOutputSampleTime)
 {
     // Update the sample time of the most recent silent sample we've received. (The music player
     // client is not considered separate for the latest silent sample.)
 
-    bool audible = BufferIsAudible(inIOBufferFrameSize, inBuffer);
-
     // The sample time of the last frame we're looking at.
     Float64 endFrameSampleTime = inOutputSampleTime + inIOBufferFrameSize - 1;
 
-    if(!audible)
+    mSampleTimes.latestSilent = std::max(mSampleTimes.latestSilent, endFrameSampleTime);
+
+    return RecalculateState(endFrameSampleTime);
+}
+
+void    BGM_AudibleState::UpdateNonMusicLevelWithClientIO(UInt32 inIOBufferFrameSize,
+                                                          Float64 inOutputSampleTime,
+                                                          const Float32* inBuffer)
+{
+    Float32 thePeak = 0;
+
+    if(inOutputSampleTime >= mNonMusicLevel.startSampleTime)
     {
-        mSampleTimes.latestSilent = std::max(mSampleTimes.latestSilent, endFrameSampleTime);
+        thePeak = BGM_DSP::Peak(inBuffer, inIOBufferFrameSize * 2);
     }
 
-    return RecalculateState(endFrameSampleTime);
+    UpdateNonMusicLevel(inIOBufferFrameSize, inOutputSampleTime, thePeak);
+}
+
+void    BGM_AudibleState::UpdateNonMusicLevelWithSilentClientIO(UInt32 inIOBufferFrameSize,
+                                                                Float64 inOutputSampleTime)
+{
+    UpdateNonMusicLevel(inIOBufferFrameSize, inOutputSampleTime, 0.0f);
+}
+
+void    BGM_AudibleState::UpdateNonMusicLevel(UInt32 inIOBufferFrameSize,
+                                              Float64 inOutputSampleTime,
+                                              Float32 inPeak)
+{
+    if(inOutputSampleTime < mNonMusicLevel.startSampleTime)
+    {
+        // An old cycle, which shouldn't happen. It can't affect the next cycle anyway.
+        return;
+    }
+
+    if(inOutputSampleTime == mNonMusicLevel.startSampleTime)
+    {
+        // Another client in the same cycle.
+        mNonMusicLevel.peak = std::max(mNonMusicLevel.peak, inPeak);
+    }
+    else
+    {
+        mNonMusicLevel.startSampleTime = inOutputSampleTime;
+        mNonMusicLevel.endSampleTime = inOutputSampleTime + inIOBufferFrameSize;
+        mNonMusicLevel.peak = inPeak;
+    }
+}
+
+Float32 BGM_AudibleState::GetNonMusicPeak(Float64 inOutputSampleTime) const noexcept
+{
+    // If the last cycle the non-music clients played in is the current one, or ended where the
+    // current one starts, it's recent enough to use.
+    bool isRecent = (mNonMusicLevel.startSampleTime >= 0) &&
+            (inOutputSampleTime >= mNonMusicLevel.startSampleTime) &&
+            (inOutputSampleTime <= mNonMusicLevel.endSampleTime);
+
+    return isRecent ? mNonMusicLevel.peak : 0.0f;
 }
 
 bool    BGM_AudibleState::RecalculateState(Float64 inEndFrameSampleTime)
@@ -169,6 +253,14 @@ bool    BGM_AudibleState::RecalculateState(Float64 inEndFrameSampleTime)
     return didChangeState;
 }
 
+// static
+bool    BGM_AudibleState::BufferIsSilent(UInt32 inIOBufferFrameSize, const Float32* inBuffer) noexcept
+{
+    // BGM_DSP::Peak finds the largest magnitude without branching on each sample, which makes this
+    // several times faster than BufferIsAudible in the worst case, when the buffer is silent.
+    return BGM_DSP::Peak(inBuffer, inIOBufferFrameSize * 2) == 0.0f;
+}
+
 // static
 bool    BGM_AudibleState::BufferIsAudible(UInt32 inIOBufferFrameSize, const Float32* inBuffer)
 {
@@ -20,7 +20,8 @@
 //  Copyright © 2016, 2017 Kyle Neideck
 //
 //  Inspects a stream of audio data and reports whether it's silent, silent except for the user's
-//  music player, or audible.
+//  music player, or audible. Also measures the level of the audio from clients other than the
+//  music player, which BGM_Ducker uses to duck the music player.
 //
 //  See kAudioDeviceCustomPropertyDeviceAudibleState and the BGMDeviceAudibleState enum in
 //  BGM_Types.h for more info.
@@ -66,6 +67,15 @@ public:
                                                    UInt32 inIOBufferFrameSize,
                                                    Float64 inOutputSampleTime,
                                                    const Float32* inBuffer);
+    /*!
+     The same as UpdateWithClientIO, for a buffer the caller already knows is silent (see
+     BufferIsSilent), so it doesn't have to be read again.
+
+     Real-time safe. Not thread safe.
+     */
+    void                        UpdateWithSilentClientIO(bool inClientIsMusicPlayer,
+                                                         UInt32 inIOBufferFrameSize,
+                                                         Float64 inOutputSampleTime);
     /*!
      Read a fully mixed audio buffer and update the audible state. All client (unmixed) buffers for
      the same cycle must be read with UpdateWithClientIO before calling this function.
@@ -77,9 +87,58 @@ public:
     bool                        UpdateWithMixedIO(UInt32 inIOBufferFrameSize,
                                                   Float64 inOutputSampleTime,
                                                   const Float32* inBuffer);
+    /*!
+     The same as UpdateWithMixedIO, for a buffer the caller already knows is silent.
+
+     Real-time safe. Not thread safe.
+
+     @return True if the audible state changed.
+     */
+    bool                        UpdateWithSilentMixedIO(UInt32 inIOBufferFrameSize,
+                                                        Float64 inOutputSampleTime);
+
+    /*!
+     Read an audio buffer sent by a client other than the music player and update the peak level
+     returned by GetNonMusicPeak. The buffer should have had the client's relative volume applied,
+     so apps the user has muted don't duck the music.
+
+     Real-time safe. Not thread safe.
+     */
+    void                        UpdateNonMusicLevelWithClientIO(UInt32 inIOBufferFrameSize,
+                                                                Float64 inOutputSampleTime,
+                                                                const Float32* inBuffer);
+    /*!
+     The same as UpdateNonMusicLevelWithClientIO, for a buffer the caller already knows is silent.
+
+     Real-time safe. Not thread safe.
+     */
+    void                        UpdateNonMusicLevelWithSilentClientIO(UInt32 inIOBufferFrameSize,
+                                                                      Float64 inOutputSampleTime);
+    /*!
+     @param inOutputSampleTime The sample time of the IO cycle the music player is in.
+     @return The peak level of the non-music clients' audio in the most recent IO cycle any of them
+             played in, if that was the cycle at inOutputSampleTime or the one just before it.
+             Otherwise 0. (The HAL might process the music player's buffer before or after the
+             other clients' buffers in the same cycle.)
+     */
+    Float32                     GetNonMusicPeak(Float64 inOutputSampleTime) const noexcept;
+
+    /*!
+     @return True if every sample in the buffer is exactly zero (or negative zero), which is what
+             the HAL gives us for clients that aren't playing anything. Much cheaper than checking
+             whether the buffer is audible, so BGM_Device uses it to skip processing silent
+             buffers.
+
+     Real-time safe.
+     */
+    static bool                 BufferIsSilent(UInt32 inIOBufferFrameSize,
+                                               const Float32* inBuffer) noexcept;
 
 private:
     bool                        RecalculateState(Float64 inEndFrameSampleTime);
+    void                        UpdateNonMusicLevel(UInt32 inIOBufferFrameSize,
+                                                    Float64 inOutputSampleTime,
+                                                    Float32 inPeak);
 
     static bool                 BufferIsAudible(UInt32 inIOBufferFrameSize,
                                                 const Float32* inBuffer);
@@ -95,6 +154,15 @@ private:
         Float64                 latestSilentMusic;
     }                           mSampleTimes;
 
+    // The peak level of the non-music clients' audio in the IO cycle from startSampleTime to
+    // endSampleTime (exclusive).
+    struct
+    {
+        Float64                 startSampleTime;
+        Float64                 endSampleTime;
+        Float32                 peak;
+    }                           mNonMusicLevel;
+
 };
 
 #pragma clang assume_nonnull end
@@ -0,0 +1,307 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_CaptureTaps.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_CaptureTaps.h"
+
+// Local Includes
+#include "BGM_DSP.h"
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CACFArray.h"
+#include "CACFDictionary.h"
+#include "CAException.h"
+#include "CADebugMacros.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstring>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+
+
+#pragma clang assume_nonnull begin
+
+// The taps are always stereo, like BGMDevice's streams.
+static const UInt32 kTapChannels = 2;
+
+BGM_CaptureTaps::BGM_CaptureTaps(const char* inSegmentNamePrefix)
+:
+    mSegmentNamePrefix(inSegmentNamePrefix)
+{
+}
+
+#pragma mark Non-RT
+
+bool    BGM_CaptureTaps::SetTappedApps(const std::vector<CACFString>& inBundleIDs,
+                                       Float64 inSampleRate)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    std::vector<CACFString> theBundleIDs;
+
+    for(const CACFString& theBundleID : inBundleIDs)
+    {
+        ThrowIf(!theBundleID.IsValid(),
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_CaptureTaps::SetTappedApps: Invalid bundle ID");
+
+        if(std::find(theBundleIDs.begin(), theBundleIDs.end(), theBundleID) == theBundleIDs.end())
+        {
+            theBundleIDs.push_back(theBundleID);
+        }
+    }
+
+    ThrowIf(theBundleIDs.size() > kMaxTaps,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_CaptureTaps::SetTappedApps: Too many apps");
+
+    bool didChangeTaps = false;
+
+    // Remove the taps for apps that aren't in the new list.
+    for(UInt32 i = 0; i < kMaxTaps; i++)
+    {
+        Tap& theTap = mTaps[i];
+
+        if(theTap.mBundleID.IsValid() &&
+           std::find(theBundleIDs.begin(), theBundleIDs.end(), theTap.mBundleID) == theBundleIDs.end())
+        {
+            std::unique_ptr<BGM_LoopbackSharedMemory> theRemovedSegment;
+
+            {
+                CAMutex::Locker theIOLocker(mMutex);
+                theTap.mActive = false;
+                theTap.mSegment.swap(theRemovedSegment);
+                mActiveTapCount--;
+            }
+
+            // Close the segment now, after releasing mMutex, rather than after creating the new
+            // ones. Otherwise closing it would unlink a new segment that reused its name.
+            theRemovedSegment.reset();
+
+            theTap.mBundleID = CACFString();
+            didChangeTaps = true;
+        }
+    }
+
+    // Create the segments for the new apps before making any of them visible to the IO thread, so
+    // we don't add some of them and then fail.
+    std::unique_ptr<BGM_LoopbackSharedMemory> theNewSegments[kMaxTaps];
+    CACFString theNewBundleIDs[kMaxTaps];
+
+    // Readers map the segments once, so they can't be resized if the sample rate changes. Make them
+    // big enough for the highest standard rate (or the current rate, if that's higher).
+    const UInt32 theCapacityFrames = BGM_LoopbackSharedMemory::GetCapacityFramesForSampleRate(
+            std::max(inSampleRate, kBGMStandardSampleRates[kBGMNumStandardSampleRates - 1]));
+
+    for(const CACFString& theBundleID : theBundleIDs)
+    {
+        bool isAlreadyTapped = false;
+        SInt32 theFreeSlot = -1;
+
+        for(UInt32 i = 0; i < kMaxTaps; i++)
+        {
+            if(mTaps[i].mBundleID.IsValid() && mTaps[i].mBundleID == theBundleID)
+            {
+                isAlreadyTapped = true;
+                break;
+            }
+
+            if(theFreeSlot == -1 && !mTaps[i].mBundleID.IsValid() && !theNewBundleIDs[i].IsValid())
+            {
+                theFreeSlot = static_cast<SInt32>(i);
+            }
+        }
+
+        if(!isAlreadyTapped)
+        {
+            // There's always a free slot because there are at most kMaxTaps apps.
+            ThrowIf(theFreeSlot == -1,
+                    CAException(kAudioHardwareUnspecifiedError),
+                    "BGM_CaptureTaps::SetTappedApps: No free slot");
+            Tap& theTap = mTaps[theFreeSlot];
+
+            // The slot is inactive, so the IO thread won't touch its mix buffer and we can
+            // allocate it without holding mMutex. Zeroing it also makes sure its pages are mapped.
+            if(!theTap.mMixBuffer)
+            {
+                theTap.mMixBuffer.reset(new Float32[kMaxFramesPerCycle * kTapChannels]());
+            }
+
+            theNewSegments[theFreeSlot].reset(new BGM_LoopbackSharedMemory);
+            theNewSegments[theFreeSlot]->Open(GetSegmentName(static_cast<UInt32>(theFreeSlot)).c_str(),
+                                              kTapChannels,
+                                              theCapacityFrames,
+                                              inSampleRate);
+            theNewBundleIDs[theFreeSlot] = theBundleID;
+        }
+    }
+
+    for(UInt32 i = 0; i < kMaxTaps; i++)
+    {
+        if(theNewSegments[i])
+        {
+            mTaps[i].mBundleID = theNewBundleIDs[i];
+
+            CAMutex::Locker theIOLocker(mMutex);
+            mTaps[i].mSegment.swap(theNewSegments[i]);
+            mTaps[i].mMixSampleTime = -1.0;
+            mTaps[i].mActive = true;
+            mActiveTapCount++;
+
+            didChangeTaps = true;
+        }
+    }
+
+    DebugMsg("BGM_CaptureTaps::SetTappedApps: %u apps tapped", mActiveTapCount.load());
+
+    return didChangeTaps;
+}
+
+std::map<CACFString, SInt32>    BGM_CaptureTaps::GetTapsByBundleID() const
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    std::map<CACFString, SInt32> theTaps;
+
+    for(UInt32 i = 0; i < kMaxTaps; i++)
+    {
+        if(mTaps[i].mBundleID.IsValid())
+        {
+            theTaps[mTaps[i].mBundleID] = static_cast<SInt32>(i);
+        }
+    }
+
+    return theTaps;
+}
+
+CFArrayRef  BGM_CaptureTaps::CopyTapsAsCFArray() const
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    CACFArray theTaps(true);
+
+    for(UInt32 i = 0; i < kMaxTaps; i++)
+    {
+        if(mTaps[i].mBundleID.IsValid())
+        {
+            CACFDictionary theTap(true);
+            CACFString theSegmentName(GetSegmentName(i).c_str());
+
+            theTap.AddString(CFSTR(kBGMCaptureTapsKey_BundleID), mTaps[i].mBundleID.GetCFString());
+            theTap.AddString(CFSTR(kBGMCaptureTapsKey_SegmentName), theSegmentName.GetCFString());
+
+            theTaps.AppendDictionary(theTap.GetDict());
+        }
+    }
+
+    return theTaps.CopyCFArray();
+}
+
+void    BGM_CaptureTaps::SetSampleRate(Float64 inSampleRate)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+    CAMutex::Locker theIOLocker(mMutex);
+
+    for(Tap& theTap : mTaps)
+    {
+        if(theTap.mSegment)
+        {
+            theTap.mSegment->SetSampleRate(inSampleRate);
+        }
+    }
+}
+
+std::string BGM_CaptureTaps::GetSegmentName(UInt32 inTapIndex) const
+{
+    return mSegmentNamePrefix + std::to_string(inTapIndex);
+}
+
+#pragma mark RT
+
+void    BGM_CaptureTaps::MixClientIORT(SInt32 inTapIndex,
+                                       UInt32 inFrameCount,
+                                       Float64 inSampleTime,
+                                       const Float32* inBuffer)
+{
+    if(inTapIndex < 0 || inTapIndex >= static_cast<SInt32>(kMaxTaps) ||
+       inFrameCount > kMaxFramesPerCycle)
+    {
+        return;
+    }
+
+    CAMutex::Locker theIOLocker(mMutex);
+
+    Tap& theTap = mTaps[inTapIndex];
+
+    if(!theTap.mActive)
+    {
+        return;
+    }
+
+    const UInt32 theSampleCount = inFrameCount * kTapChannels;
+
+    if(theTap.mMixSampleTime == inSampleTime && theTap.mMixFrameCount == inFrameCount)
+    {
+        // Another of the app's clients has already written to the tap this cycle.
+        BGM_DSP::Accumulate(theTap.mMixBuffer.get(), inBuffer, theSampleCount);
+    }
+    else
+    {
+        memcpy(theTap.mMixBuffer.get(), inBuffer, theSampleCount * sizeof(Float32));
+        theTap.mMixSampleTime = inSampleTime;
+        theTap.mMixFrameCount = inFrameCount;
+    }
+}
+
+void    BGM_CaptureTaps::StoreRT(UInt32 inFrameCount, Float64 inSampleTime)
+{
+    if(!HasActiveTapsRT() || inFrameCount > kMaxFramesPerCycle)
+    {
+        return;
+    }
+
+    CAMutex::Locker theIOLocker(mMutex);
+
+    for(Tap& theTap : mTaps)
+    {
+        if(theTap.mActive)
+        {
+            if(theTap.mMixSampleTime != inSampleTime || theTap.mMixFrameCount != inFrameCount)
+            {
+                // None of the app's clients played anything this cycle.
+                memset(theTap.mMixBuffer.get(), 0, inFrameCount * kTapChannels * sizeof(Float32));
+            }
+
+            theTap.mSegment->Store(theTap.mMixBuffer.get(),
+                                   inFrameCount,
+                                   static_cast<SInt64>(inSampleTime));
+
+            theTap.mMixSampleTime = -1.0;
+        }
+    }
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,170 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_CaptureTaps.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  A fixed pool of per-app capture taps. Each tap mixes the audio of one app's clients, after
+//  their relative volumes and pan positions have been applied, and publishes it in a loopback
+//  shared memory segment (see BGM_LoopbackLayout.h) so other processes can record that app on its
+//  own.
+//
+//  The pool has kMaxTaps slots. A slot's mix buffer is allocated the first time the slot is used
+//  and then kept, and its segment is created when an app is assigned to it, so the IO thread never
+//  allocates. SetTappedApps and the other non-RT methods aren't real-time safe. The methods whose
+//  names end with "RT" are, although they lock the pool's mutex, which is only ever held briefly.
+//
+
+#ifndef BGMDriver__BGM_CaptureTaps
+#define BGMDriver__BGM_CaptureTaps
+
+// Local Includes
+#include "BGM_LoopbackSharedMemory.h"
+
+// PublicUtility Includes
+#include "CACFString.h"
+#include "CAMutex.h"
+
+// STL Includes
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// System Includes
+#include <CoreFoundation/CoreFoundation.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_CaptureTaps
+{
+
+public:
+    // The number of apps that can be tapped at the same time.
+    static const UInt32         kMaxTaps = 8;
+    // The largest IO buffer, in frames, a tap can take. The HAL doesn't normally use buffers this
+    // large. If it does, the taps skip those cycles.
+    static const UInt32         kMaxFramesPerCycle = 8192;
+
+    /*!
+     @param inSegmentNamePrefix The prefix for the taps' segment names. The index of the tap's slot
+                                is appended to it, e.g. "/BGMDevice.tap.0".
+     */
+                                BGM_CaptureTaps(const char* inSegmentNamePrefix);
+                                ~BGM_CaptureTaps() = default;
+                                // Disallow copying
+                                BGM_CaptureTaps(const BGM_CaptureTaps&) = delete;
+                                BGM_CaptureTaps& operator=(const BGM_CaptureTaps&) = delete;
+
+#pragma mark Non-RT
+
+    /*!
+     Replace the set of tapped apps. Apps that were already tapped keep their slots and segments, so
+     readers don't have to reopen them. Apps that are no longer in the list have their segments
+     closed.
+
+     Not real-time safe.
+
+     @param inBundleIDs The bundle IDs of the apps to tap. Duplicates are ignored.
+     @param inSampleRate The device's current sample rate, for the new segments.
+     @return True if the set of tapped apps changed.
+     @throws CAException if there are more than kMaxTaps apps or a segment can't be created. If a
+                         segment can't be created, the apps that were removed from the list will
+                         have been untapped, but none will have been added.
+     */
+    bool                        SetTappedApps(const std::vector<CACFString>& inBundleIDs,
+                                              Float64 inSampleRate);
+
+    /*! The slot index of each tapped app, keyed by bundle ID. */
+    std::map<CACFString, SInt32> GetTapsByBundleID() const;
+
+    /*!
+     @return The taps in the format of kAudioDeviceCustomPropertyCaptureTaps, i.e. an array of
+             dictionaries with the keys kBGMCaptureTapsKey_BundleID and
+             kBGMCaptureTapsKey_SegmentName. The caller owns the array.
+     */
+    CFArrayRef                  CopyTapsAsCFArray() const;
+
+    /*! Update the sample rate readers see in the taps' segments. */
+    void                        SetSampleRate(Float64 inSampleRate);
+
+    std::string                 GetSegmentName(UInt32 inTapIndex) const;
+
+#pragma mark RT
+
+    /*! True if any apps are being tapped. Lock-free, so it can be used to skip the tap code. */
+    bool                        HasActiveTapsRT() const
+                                    { return mActiveTapCount.load(std::memory_order_relaxed) > 0; }
+
+    /*!
+     Mix one client's audio for this IO cycle into a tap. Called once per client per cycle, with the
+     client's buffer after its relative volume and pan have been applied. Does nothing if the tap
+     isn't in use.
+
+     @param inTapIndex The client's tap, from BGM_Clients::GetClientCaptureTapRT.
+     @param inFrameCount The number of frames in inBuffer.
+     @param inSampleTime The cycle's output sample time.
+     @param inBuffer The client's audio, interleaved stereo.
+     */
+    void                        MixClientIORT(SInt32 inTapIndex,
+                                              UInt32 inFrameCount,
+                                              Float64 inSampleTime,
+                                              const Float32* inBuffer);
+
+    /*!
+     Publish this IO cycle's audio to every tap's segment. Taps that had no client audio this cycle
+     get silence, so readers see a continuous stream whether or not the app is playing. Called once
+     per cycle, after every client's MixClientIORT call.
+     */
+    void                        StoreRT(UInt32 inFrameCount, Float64 inSampleTime);
+
+private:
+    struct Tap
+    {
+        // The app the tap is assigned to, or an invalid string if the slot is free. Only used by
+        // non-RT threads, with mStateMutex held.
+        CACFString                  mBundleID;
+        // Null if the slot is free.
+        std::unique_ptr<BGM_LoopbackSharedMemory> mSegment;
+        // The audio mixed into the tap so far this cycle. Null until the slot is first used.
+        std::unique_ptr<Float32[]>  mMixBuffer;
+        // The sample time and size of the audio in mMixBuffer. mMixSampleTime is -1 when the buffer
+        // doesn't hold any audio for the current cycle.
+        Float64                     mMixSampleTime = -1.0;
+        UInt32                      mMixFrameCount = 0;
+        bool                        mActive = false;
+    };
+
+    const std::string           mSegmentNamePrefix;
+
+    // Serialises the non-RT methods and guards the taps' bundle IDs.
+    mutable CAMutex             mStateMutex { "Capture taps state" };
+    // Guards the rest of mTaps. Locked by the IO thread, so nothing that isn't real-time safe
+    // should be done while holding it.
+    CAMutex                     mMutex { "Capture taps IO" };
+    Tap                         mTaps[kMaxTaps];
+    std::atomic<UInt32>         mActiveTapCount { 0 };
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_CaptureTaps */
+
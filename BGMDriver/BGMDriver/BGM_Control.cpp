@@ -24,6 +24,9 @@
 // Self Include
 #include "BGM_Control.h"
 
+// Local Includes
+#include "BGM_PropertyTable.h"
+
 // PublicUtility Includes
 #include "CADebugMacros.h"
 #include "CAException.h"
@@ -47,6 +50,17 @@ BGM_Control::BGM_Control(AudioObjectID inObjectID,
 {
 }
 
+// The properties all controls have, sorted by selector.
+static constexpr BGM_PropertyInfo kControlProperties[] = {
+    { kAudioControlPropertyElement, BGM_PropertyScopes::Any, false, sizeof(AudioObjectPropertyElement), kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioControlPropertyScope,   BGM_PropertyScopes::Any, false, sizeof(AudioObjectPropertyScope),   kAudioServerPlugInCustomPropertyDataTypeNone }
+};
+
+static_assert(BGM_PropertyTable::IsSorted(kControlProperties),
+              "kControlProperties must be sorted by selector");
+
+static constexpr BGM_PropertyTable sControlProperties(kControlProperties);
+
 bool    BGM_Control::HasProperty(AudioObjectID inObjectID,
                                  pid_t inClientPID,
                                  const AudioObjectPropertyAddress& inAddress) const
@@ -54,18 +68,16 @@ bool    BGM_Control::HasProperty(AudioObjectID inObjectID,
     CheckObjectID(inObjectID);
 
     bool theAnswer = false;
+    const BGM_PropertyInfo* theInfo = sControlProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioControlPropertyScope:
-        case kAudioControlPropertyElement:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Object::HasProperty(inObjectID, inClientPID, inAddress);
-            break;
-    };
+        theAnswer = BGM_PropertyTable::HasScope(*theInfo, inAddress.mScope);
+    }
+    else
+    {
+        theAnswer = BGM_Object::HasProperty(inObjectID, inClientPID, inAddress);
+    }
 
     return theAnswer;
 }
@@ -77,18 +89,16 @@ bool    BGM_Control::IsPropertySettable(AudioObjectID inObjectID,
     CheckObjectID(inObjectID);
 
     bool theAnswer = false;
+    const BGM_PropertyInfo* theInfo = sControlProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioControlPropertyScope:
-        case kAudioControlPropertyElement:
-            theAnswer = false;
-            break;
-
-        default:
-            theAnswer = BGM_Object::IsPropertySettable(inObjectID, inClientPID, inAddress);
-            break;
-    };
+        theAnswer = theInfo->mIsSettable;
+    }
+    else
+    {
+        theAnswer = BGM_Object::IsPropertySettable(inObjectID, inClientPID, inAddress);
+    }
 
     return theAnswer;
 }
@@ -102,25 +112,20 @@ UInt32  BGM_Control::GetPropertyDataSize(AudioObjectID inObjectID,
     CheckObjectID(inObjectID);
 
     UInt32 theAnswer = 0;
+    const BGM_PropertyInfo* theInfo = sControlProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioControlPropertyScope:
-            theAnswer = sizeof(AudioObjectPropertyScope);
-            break;
-
-        case kAudioControlPropertyElement:
-            theAnswer = sizeof(AudioObjectPropertyElement);
-            break;
-
-        default:
-            theAnswer = BGM_Object::GetPropertyDataSize(inObjectID,
-                                                        inClientPID,
-                                                        inAddress,
-                                                        inQualifierDataSize,
-                                                        inQualifierData);
-            break;
-    };
+        theAnswer = theInfo->mDataSize;
+    }
+    else
+    {
+        theAnswer = BGM_Object::GetPropertyDataSize(inObjectID,
+                                                    inClientPID,
+                                                    inAddress,
+                                                    inQualifierDataSize,
+                                                    inQualifierData);
+    }
 
     return theAnswer;
 }
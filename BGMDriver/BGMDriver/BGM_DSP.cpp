@@ -0,0 +1,597 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_DSP.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Each function has its scalar implementation at the end, which also handles the samples left
+//  over after the SIMD loop. The SIMD loops mirror the scalar code operation for operation, so the
+//  scalar code is the best place to start reading.
+//
+
+// Self Include
+#include "BGM_DSP.h"
+
+// STL Includes
+#include <cmath>
+
+// System Includes
+#if BGM_DSP_BACKEND == BGM_DSP_BACKEND_ACCELERATE
+#include <Accelerate/Accelerate.h>
+#endif
+
+
+#if BGM_DSP_BACKEND != BGM_DSP_BACKEND_SCALAR && defined(__SSE2__)
+#define BGM_DSP_SSE2 1
+#include <emmintrin.h>
+// 32-bit ARM's NEON flushes subnormals to zero, so it would give different results. Only use it on
+// AArch64.
+#elif BGM_DSP_BACKEND != BGM_DSP_BACKEND_SCALAR && (defined(__aarch64__) || defined(__arm64__))
+#define BGM_DSP_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define BGM_DSP_VDSP (BGM_DSP_BACKEND == BGM_DSP_BACKEND_ACCELERATE)
+
+// Fusing a multiply and an add would round once instead of twice and change the results, so it has
+// to be the same in every implementation. Separate statements are never fused, but the compiler is
+// allowed to fuse the operations in a single expression unless this is off.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#endif
+
+
+#pragma clang assume_nonnull begin
+
+namespace BGM_DSP
+{
+
+#pragma mark SIMD Helpers
+
+#if BGM_DSP_SSE2
+
+// (x < inMin ? inMin : x) then (x > inMax ? inMax : x). max_ps(a, b) is (a > b ? a : b) and
+// min_ps(a, b) is (a < b ? a : b), including when the values are equal.
+static inline __m128 ClipSSE2(__m128 inValues, __m128 inMin, __m128 inMax)
+{
+    return _mm_min_ps(inMax, _mm_max_ps(inMin, inValues));
+}
+
+static inline __m128 AbsSSE2(__m128 inValues)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), inValues);
+}
+
+#elif BGM_DSP_NEON
+
+// vmaxq_f32 and vminq_f32 treat signed zeros differently to the scalar code, so compare and select.
+static inline float32x4_t ClipNEON(float32x4_t inValues, float32x4_t inMin, float32x4_t inMax)
+{
+    const float32x4_t theClippedBelow = vbslq_f32(vcltq_f32(inValues, inMin), inMin, inValues);
+    return vbslq_f32(vcgtq_f32(theClippedBelow, inMax), inMax, theClippedBelow);
+}
+
+#endif
+
+static inline Float32 ClipScalar(Float32 inValue, Float32 inMin, Float32 inMax)
+{
+    const Float32 theClippedBelow = (inValue < inMin) ? inMin : inValue;
+    return (theClippedBelow > inMax) ? inMax : theClippedBelow;
+}
+
+#pragma mark Backend
+
+const char* GetBackendName() noexcept
+{
+#if BGM_DSP_VDSP && BGM_DSP_SSE2
+    return "Accelerate/SSE2";
+#elif BGM_DSP_VDSP && BGM_DSP_NEON
+    return "Accelerate/NEON";
+#elif BGM_DSP_VDSP
+    return "Accelerate/scalar";
+#elif BGM_DSP_SSE2
+    return "SSE2";
+#elif BGM_DSP_NEON
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+#pragma mark Gain
+
+void    Scale(Float32* ioBuffer, UInt32 inSampleCount, Float32 inGain) noexcept
+{
+#if BGM_DSP_VDSP
+    vDSP_vsmul(ioBuffer, 1, &inGain, ioBuffer, 1, inSampleCount);
+#else
+    UInt32 i = 0;
+
+#if BGM_DSP_SSE2
+    const __m128 theGain = _mm_set1_ps(inGain);
+
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        _mm_storeu_ps(ioBuffer + i, _mm_mul_ps(_mm_loadu_ps(ioBuffer + i), theGain));
+    }
+#elif BGM_DSP_NEON
+    const float32x4_t theGain = vdupq_n_f32(inGain);
+
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        vst1q_f32(ioBuffer + i, vmulq_f32(vld1q_f32(ioBuffer + i), theGain));
+    }
+#endif
+
+    for(; i < inSampleCount; i++)
+    {
+        ioBuffer[i] *= inGain;
+    }
+#endif
+}
+
+void    ScaleAndClip(Float32* ioBuffer,
+                     UInt32 inSampleCount,
+                     Float32 inGain,
+                     Float32 inMin,
+                     Float32 inMax) noexcept
+{
+#if BGM_DSP_VDSP
+    vDSP_vsmul(ioBuffer, 1, &inGain, ioBuffer, 1, inSampleCount);
+    vDSP_vclip(ioBuffer, 1, &inMin, &inMax, ioBuffer, 1, inSampleCount);
+#else
+    UInt32 i = 0;
+
+#if BGM_DSP_SSE2
+    const __m128 theGain = _mm_set1_ps(inGain);
+    const __m128 theMin = _mm_set1_ps(inMin);
+    const __m128 theMax = _mm_set1_ps(inMax);
+
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        const __m128 theScaled = _mm_mul_ps(_mm_loadu_ps(ioBuffer + i), theGain);
+        _mm_storeu_ps(ioBuffer + i, ClipSSE2(theScaled, theMin, theMax));
+    }
+#elif BGM_DSP_NEON
+    const float32x4_t theGain = vdupq_n_f32(inGain);
+    const float32x4_t theMin = vdupq_n_f32(inMin);
+    const float32x4_t theMax = vdupq_n_f32(inMax);
+
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        const float32x4_t theScaled = vmulq_f32(vld1q_f32(ioBuffer + i), theGain);
+        vst1q_f32(ioBuffer + i, ClipNEON(theScaled, theMin, theMax));
+    }
+#endif
+
+    for(; i < inSampleCount; i++)
+    {
+        ioBuffer[i] = ClipScalar(ioBuffer[i] * inGain, inMin, inMax);
+    }
+#endif
+}
+
+void    Clip(Float32* ioBuffer, UInt32 inSampleCount, Float32 inMin, Float32 inMax) noexcept
+{
+#if BGM_DSP_VDSP
+    vDSP_vclip(ioBuffer, 1, &inMin, &inMax, ioBuffer, 1, inSampleCount);
+#else
+    UInt32 i = 0;
+
+#if BGM_DSP_SSE2
+    const __m128 theMin = _mm_set1_ps(inMin);
+    const __m128 theMax = _mm_set1_ps(inMax);
+
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        _mm_storeu_ps(ioBuffer + i, ClipSSE2(_mm_loadu_ps(ioBuffer + i), theMin, theMax));
+    }
+#elif BGM_DSP_NEON
+    const float32x4_t theMin = vdupq_n_f32(inMin);
+    const float32x4_t theMax = vdupq_n_f32(inMax);
+
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        vst1q_f32(ioBuffer + i, ClipNEON(vld1q_f32(ioBuffer + i), theMin, theMax));
+    }
+#endif
+
+    for(; i < inSampleCount; i++)
+    {
+        ioBuffer[i] = ClipScalar(ioBuffer[i], inMin, inMax);
+    }
+#endif
+}
+
+void    ScaleWithRamp(Float32* ioBuffer,
+                      UInt32 inFrameCount,
+                      Float32 inStartGain,
+                      Float32 inGainIncrement) noexcept
+{
+    // vDSP_vrampmul2 accumulates the increment, which rounds differently, so this doesn't use it.
+    //
+    // The SIMD loops process two frames at a time and keep the frame numbers as floats, which are
+    // exact up to 2^24 frames.
+    UInt32 i = 0;
+
+#if BGM_DSP_SSE2
+    const __m128 theStartGain = _mm_set1_ps(inStartGain);
+    const __m128 theGainIncrement = _mm_set1_ps(inGainIncrement);
+    const __m128 theTwo = _mm_set1_ps(2.0f);
+    __m128 theFrameNumbers = _mm_setr_ps(0.0f, 0.0f, 1.0f, 1.0f);
+
+    for(; i + 2 <= inFrameCount; i += 2)
+    {
+        const __m128 theGains =
+                _mm_add_ps(theStartGain, _mm_mul_ps(theGainIncrement, theFrameNumbers));
+        _mm_storeu_ps(ioBuffer + (i * 2), _mm_mul_ps(_mm_loadu_ps(ioBuffer + (i * 2)), theGains));
+        theFrameNumbers = _mm_add_ps(theFrameNumbers, theTwo);
+    }
+#elif BGM_DSP_NEON
+    const float32x4_t theStartGain = vdupq_n_f32(inStartGain);
+    const float32x4_t theGainIncrement = vdupq_n_f32(inGainIncrement);
+    const float32x4_t theTwo = vdupq_n_f32(2.0f);
+    const float theFirstFrameNumbers[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+    float32x4_t theFrameNumbers = vld1q_f32(theFirstFrameNumbers);
+
+    for(; i + 2 <= inFrameCount; i += 2)
+    {
+        const float32x4_t theGains =
+                vaddq_f32(theStartGain, vmulq_f32(theGainIncrement, theFrameNumbers));
+        vst1q_f32(ioBuffer + (i * 2), vmulq_f32(vld1q_f32(ioBuffer + (i * 2)), theGains));
+        theFrameNumbers = vaddq_f32(theFrameNumbers, theTwo);
+    }
+#endif
+
+    for(; i < inFrameCount; i++)
+    {
+        const Float32 theGainChange = inGainIncrement * static_cast<Float32>(i);
+        const Float32 theGain = inStartGain + theGainChange;
+        ioBuffer[i * 2] *= theGain;
+        ioBuffer[(i * 2) + 1] *= theGain;
+    }
+}
+
+void    ScaleStereoFrames(const Float32* inBuffer,
+                          const Float32* inGains,
+                          Float32* outBuffer,
+                          UInt32 inFrameCount) noexcept
+{
+#if BGM_DSP_VDSP
+    vDSP_vmul(inBuffer, 2, inGains, 1, outBuffer, 2, inFrameCount);
+    vDSP_vmul(inBuffer + 1, 2, inGains, 1, outBuffer + 1, 2, inFrameCount);
+#else
+    UInt32 i = 0;
+
+#if BGM_DSP_SSE2
+    for(; i + 4 <= inFrameCount; i += 4)
+    {
+        const __m128 theGains = _mm_loadu_ps(inGains + i);
+        // g0 g0 g1 g1 and g2 g2 g3 g3, to line up with the interleaved samples.
+        const __m128 theFirstGains = _mm_unpacklo_ps(theGains, theGains);
+        const __m128 theSecondGains = _mm_unpackhi_ps(theGains, theGains);
+        const __m128 theFirstFrames = _mm_loadu_ps(inBuffer + (i * 2));
+        const __m128 theSecondFrames = _mm_loadu_ps(inBuffer + (i * 2) + 4);
+
+        _mm_storeu_ps(outBuffer + (i * 2), _mm_mul_ps(theFirstFrames, theFirstGains));
+        _mm_storeu_ps(outBuffer + (i * 2) + 4, _mm_mul_ps(theSecondFrames, theSecondGains));
+    }
+#elif BGM_DSP_NEON
+    for(; i + 4 <= inFrameCount; i += 4)
+    {
+        const float32x4_t theGains = vld1q_f32(inGains + i);
+        // Deinterleave into left and right.
+        float32x4x2_t theFrames = vld2q_f32(inBuffer + (i * 2));
+
+        theFrames.val[0] = vmulq_f32(theFrames.val[0], theGains);
+        theFrames.val[1] = vmulq_f32(theFrames.val[1], theGains);
+        vst2q_f32(outBuffer + (i * 2), theFrames);
+    }
+#endif
+
+    for(; i < inFrameCount; i++)
+    {
+        outBuffer[i * 2] = inBuffer[i * 2] * inGains[i];
+        outBuffer[(i * 2) + 1] = inBuffer[(i * 2) + 1] * inGains[i];
+    }
+#endif
+}
+
+#pragma mark Mixing
+
+template <bool kClip>
+static inline void MixStereoImpl(Float32* ioBuffer,
+                                 UInt32 inFrameCount,
+                                 const StereoMatrix& inMatrix,
+                                 Float32 inMin,
+                                 Float32 inMax) noexcept
+{
+    UInt32 i = 0;
+
+    // The SIMD loops process two frames at a time. Each sample is multiplied by its own channel's
+    // coefficient and the other channel's sample by the crossfeed coefficient. Adding them in the
+    // other order than the scalar code gives the same result, since addition is commutative.
+#if BGM_DSP_SSE2
+    const __m128 theDirect = _mm_setr_ps(inMatrix.mLeftToLeft,
+                                         inMatrix.mRightToRight,
+                                         inMatrix.mLeftToLeft,
+                                         inMatrix.mRightToRight);
+    const __m128 theCrossfeed = _mm_setr_ps(inMatrix.mRightToLeft,
+                                            inMatrix.mLeftToRight,
+                                            inMatrix.mRightToLeft,
+                                            inMatrix.mLeftToRight);
+    const __m128 theMin = _mm_set1_ps(inMin);
+    const __m128 theMax = _mm_set1_ps(inMax);
+
+    for(; i + 2 <= inFrameCount; i += 2)
+    {
+        const __m128 theFrames = _mm_loadu_ps(ioBuffer + (i * 2));
+        // R0 L0 R1 L1
+        const __m128 theSwapped = _mm_shuffle_ps(theFrames, theFrames, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 theMixed = _mm_add_ps(_mm_mul_ps(theFrames, theDirect),
+                                     _mm_mul_ps(theSwapped, theCrossfeed));
+
+        if(kClip)
+        {
+            theMixed = ClipSSE2(theMixed, theMin, theMax);
+        }
+
+        _mm_storeu_ps(ioBuffer + (i * 2), theMixed);
+    }
+#elif BGM_DSP_NEON
+    const float theDirectCoefficients[4] = {
+        inMatrix.mLeftToLeft, inMatrix.mRightToRight, inMatrix.mLeftToLeft, inMatrix.mRightToRight
+    };
+    const float theCrossfeedCoefficients[4] = {
+        inMatrix.mRightToLeft, inMatrix.mLeftToRight, inMatrix.mRightToLeft, inMatrix.mLeftToRight
+    };
+    const float32x4_t theDirect = vld1q_f32(theDirectCoefficients);
+    const float32x4_t theCrossfeed = vld1q_f32(theCrossfeedCoefficients);
+    const float32x4_t theMin = vdupq_n_f32(inMin);
+    const float32x4_t theMax = vdupq_n_f32(inMax);
+
+    for(; i + 2 <= inFrameCount; i += 2)
+    {
+        const float32x4_t theFrames = vld1q_f32(ioBuffer + (i * 2));
+        // R0 L0 R1 L1
+        const float32x4_t theSwapped = vrev64q_f32(theFrames);
+        float32x4_t theMixed = vaddq_f32(vmulq_f32(theFrames, theDirect),
+                                         vmulq_f32(theSwapped, theCrossfeed));
+
+        if(kClip)
+        {
+            theMixed = ClipNEON(theMixed, theMin, theMax);
+        }
+
+        vst1q_f32(ioBuffer + (i * 2), theMixed);
+    }
+#endif
+
+    for(; i < inFrameCount; i++)
+    {
+        const Float32 L = ioBuffer[i * 2];
+        const Float32 R = ioBuffer[(i * 2) + 1];
+
+        const Float32 theLeftFromLeft = L * inMatrix.mLeftToLeft;
+        const Float32 theLeftFromRight = R * inMatrix.mRightToLeft;
+        const Float32 theRightFromLeft = L * inMatrix.mLeftToRight;
+        const Float32 theRightFromRight = R * inMatrix.mRightToRight;
+
+        Float32 theNewL = theLeftFromLeft + theLeftFromRight;
+        Float32 theNewR = theRightFromLeft + theRightFromRight;
+
+        if(kClip)
+        {
+            theNewL = ClipScalar(theNewL, inMin, inMax);
+            theNewR = ClipScalar(theNewR, inMin, inMax);
+        }
+
+        ioBuffer[i * 2] = theNewL;
+        ioBuffer[(i * 2) + 1] = theNewR;
+    }
+}
+
+void    MixStereo(Float32* ioBuffer, UInt32 inFrameCount, const StereoMatrix& inMatrix) noexcept
+{
+    MixStereoImpl<false>(ioBuffer, inFrameCount, inMatrix, 0.0f, 0.0f);
+}
+
+void    MixStereoAndClip(Float32* ioBuffer,
+                         UInt32 inFrameCount,
+                         const StereoMatrix& inMatrix,
+                         Float32 inMin,
+                         Float32 inMax) noexcept
+{
+    MixStereoImpl<true>(ioBuffer, inFrameCount, inMatrix, inMin, inMax);
+}
+
+void    Accumulate(Float32* ioSum, const Float32* inBuffer, UInt32 inSampleCount) noexcept
+{
+#if BGM_DSP_VDSP
+    vDSP_vadd(ioSum, 1, inBuffer, 1, ioSum, 1, inSampleCount);
+#else
+    UInt32 i = 0;
+
+#if BGM_DSP_SSE2
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        _mm_storeu_ps(ioSum + i, _mm_add_ps(_mm_loadu_ps(ioSum + i), _mm_loadu_ps(inBuffer + i)));
+    }
+#elif BGM_DSP_NEON
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        vst1q_f32(ioSum + i, vaddq_f32(vld1q_f32(ioSum + i), vld1q_f32(inBuffer + i)));
+    }
+#endif
+
+    for(; i < inSampleCount; i++)
+    {
+        ioSum[i] += inBuffer[i];
+    }
+#endif
+}
+
+#pragma mark Metering
+
+Float32 Peak(const Float32* inBuffer, UInt32 inSampleCount) noexcept
+{
+    Float32 thePeak = 0.0f;
+
+#if BGM_DSP_VDSP
+    if(inSampleCount > 0)
+    {
+        vDSP_maxmgv(inBuffer, 1, &thePeak, inSampleCount);
+    }
+#else
+    // The maximum doesn't depend on the order the samples are compared in, so the SIMD loops can
+    // keep four of them and combine them at the end.
+    UInt32 i = 0;
+
+#if BGM_DSP_SSE2
+    __m128 thePeaks = _mm_setzero_ps();
+
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        thePeaks = _mm_max_ps(AbsSSE2(_mm_loadu_ps(inBuffer + i)), thePeaks);
+    }
+
+    // Move the larger of lanes 2 and 3 and lanes 0 and 1 into lanes 0 and 1, then the larger of
+    // those into lane 0.
+    thePeaks = _mm_max_ps(thePeaks, _mm_movehl_ps(thePeaks, thePeaks));
+    thePeaks = _mm_max_ss(thePeaks, _mm_shuffle_ps(thePeaks, thePeaks, _MM_SHUFFLE(1, 1, 1, 1)));
+    thePeak = _mm_cvtss_f32(thePeaks);
+#elif BGM_DSP_NEON
+    float32x4_t thePeaks = vdupq_n_f32(0.0f);
+
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        thePeaks = vmaxq_f32(vabsq_f32(vld1q_f32(inBuffer + i)), thePeaks);
+    }
+
+    const float32x2_t thePairPeaks = vpmax_f32(vget_low_f32(thePeaks), vget_high_f32(thePeaks));
+    thePeak = vget_lane_f32(vpmax_f32(thePairPeaks, thePairPeaks), 0);
+#endif
+
+    for(; i < inSampleCount; i++)
+    {
+        const Float32 theMagnitude = std::fabs(inBuffer[i]);
+
+        if(theMagnitude > thePeak)
+        {
+            thePeak = theMagnitude;
+        }
+    }
+#endif
+
+    return thePeak;
+}
+
+Float32 RMS(const Float32* inBuffer, UInt32 inSampleCount) noexcept
+{
+    if(inSampleCount == 0)
+    {
+        return 0.0f;
+    }
+
+    // vDSP_rmsqv sums the squares in a different order, so this doesn't use it.
+    UInt32 i = 0;
+    Float32 theSums[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+#if BGM_DSP_SSE2
+    __m128 theSumsVector = _mm_setzero_ps();
+
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        const __m128 theSamples = _mm_loadu_ps(inBuffer + i);
+        theSumsVector = _mm_add_ps(theSumsVector, _mm_mul_ps(theSamples, theSamples));
+    }
+
+    _mm_storeu_ps(theSums, theSumsVector);
+#elif BGM_DSP_NEON
+    float32x4_t theSumsVector = vdupq_n_f32(0.0f);
+
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        const float32x4_t theSamples = vld1q_f32(inBuffer + i);
+        theSumsVector = vaddq_f32(theSumsVector, vmulq_f32(theSamples, theSamples));
+    }
+
+    vst1q_f32(theSums, theSumsVector);
+#else
+    for(; i + 4 <= inSampleCount; i += 4)
+    {
+        for(UInt32 j = 0; j < 4; j++)
+        {
+            const Float32 theSquare = inBuffer[i + j] * inBuffer[i + j];
+            theSums[j] += theSquare;
+        }
+    }
+#endif
+
+    Float32 theSum = (theSums[0] + theSums[1]) + (theSums[2] + theSums[3]);
+
+    for(; i < inSampleCount; i++)
+    {
+        const Float32 theSquare = inBuffer[i] * inBuffer[i];
+        theSum += theSquare;
+    }
+
+    return std::sqrt(theSum / static_cast<Float32>(inSampleCount));
+}
+
+void    StereoFramePeaks(const Float32* inBuffer, Float32* outPeaks, UInt32 inFrameCount) noexcept
+{
+#if BGM_DSP_VDSP
+    vDSP_vmaxmg(inBuffer, 2, inBuffer + 1, 2, outPeaks, 1, inFrameCount);
+#else
+    UInt32 i = 0;
+
+#if BGM_DSP_SSE2
+    for(; i + 4 <= inFrameCount; i += 4)
+    {
+        const __m128 theFirstFrames = _mm_loadu_ps(inBuffer + (i * 2));
+        const __m128 theSecondFrames = _mm_loadu_ps(inBuffer + (i * 2) + 4);
+        // Deinterleave into left and right.
+        const __m128 theLeft =
+                _mm_shuffle_ps(theFirstFrames, theSecondFrames, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 theRight =
+                _mm_shuffle_ps(theFirstFrames, theSecondFrames, _MM_SHUFFLE(3, 1, 3, 1));
+
+        _mm_storeu_ps(outPeaks + i, _mm_max_ps(AbsSSE2(theLeft), AbsSSE2(theRight)));
+    }
+#elif BGM_DSP_NEON
+    for(; i + 4 <= inFrameCount; i += 4)
+    {
+        const float32x4x2_t theFrames = vld2q_f32(inBuffer + (i * 2));
+        vst1q_f32(outPeaks + i, vmaxq_f32(vabsq_f32(theFrames.val[0]), vabsq_f32(theFrames.val[1])));
+    }
+#endif
+
+    for(; i < inFrameCount; i++)
+    {
+        const Float32 theLeft = std::fabs(inBuffer[i * 2]);
+        const Float32 theRight = std::fabs(inBuffer[(i * 2) + 1]);
+        outPeaks[i] = (theLeft > theRight) ? theLeft : theRight;
+    }
+#endif
+}
+
+}
+
+#pragma clang assume_nonnull end
+
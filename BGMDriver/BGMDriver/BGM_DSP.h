@@ -0,0 +1,152 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_DSP.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The vector operations BGMDriver uses to process audio on the IO thread.
+//
+//  Each one has a plain C++ implementation, which is the reference, and SSE2 and NEON
+//  implementations. The SIMD implementations do the same floating-point operations in the same
+//  order as the C++ ones, so they give bit-identical results. Multiplies and adds are never fused,
+//  for the same reason. BGM_DSPTests checks each of them against its own scalar implementation.
+//
+//  Results for inputs that contain NaNs aren't specified.
+//
+//  All of the functions are real-time safe. Buffers don't need to be aligned. Unless a function
+//  says otherwise, its input and output buffers can be the same, but mustn't partially overlap.
+//
+
+#ifndef BGMDriver__BGM_DSP
+#define BGMDriver__BGM_DSP
+
+// System Includes
+#include <MacTypes.h>
+
+
+// BGM_DSP_BACKEND chooses the implementations BGM_DSP uses:
+//
+//     BGM_DSP_BACKEND_SIMD        SSE2 on x86 and NEON on 64-bit ARM. The default. Uses the
+//                                 scalar implementations on other CPUs.
+//     BGM_DSP_BACKEND_SCALAR      The scalar implementations.
+//     BGM_DSP_BACKEND_ACCELERATE  Accelerate's vDSP functions where they give the same results, and
+//                                 the SIMD implementations otherwise. macOS only.
+//
+// Set it like BGM_DOUBLE_PRECISION_GAIN (see BGM_Device.h), e.g.
+//
+//     xcodebuild GCC_PREPROCESSOR_DEFINITIONS='$(inherited) BGM_DSP_BACKEND=BGM_DSP_BACKEND_ACCELERATE' ...
+//
+// The benchmarks in BGM_BenchmarkTests log which backend they were built with.
+#define BGM_DSP_BACKEND_SIMD        1
+#define BGM_DSP_BACKEND_SCALAR      2
+#define BGM_DSP_BACKEND_ACCELERATE  3
+
+#ifndef BGM_DSP_BACKEND
+#define BGM_DSP_BACKEND BGM_DSP_BACKEND_SIMD
+#endif
+
+
+#pragma clang assume_nonnull begin
+
+namespace BGM_DSP
+{
+    // The coefficients of a 2x2 matrix that mixes a stereo frame into a new stereo frame.
+    struct StereoMatrix
+    {
+        Float32     mLeftToLeft;
+        Float32     mRightToLeft;
+        Float32     mLeftToRight;
+        Float32     mRightToRight;
+    };
+
+    // @return The name of the implementations this build uses, e.g. "SSE2".
+    const char*     GetBackendName() noexcept;
+
+#pragma mark Gain
+
+    // ioBuffer[i] *= inGain
+    void            Scale(Float32* ioBuffer, UInt32 inSampleCount, Float32 inGain) noexcept;
+
+    // ioBuffer[i] = clamp(ioBuffer[i] * inGain, inMin, inMax)
+    //
+    // Clamping is done as (x < inMin ? inMin : x), then (x > inMax ? inMax : x). inMin must be less
+    // than or equal to inMax, here and in the other functions that clamp.
+    void            ScaleAndClip(Float32* ioBuffer,
+                                 UInt32 inSampleCount,
+                                 Float32 inGain,
+                                 Float32 inMin,
+                                 Float32 inMax) noexcept;
+
+    // ioBuffer[i] = clamp(ioBuffer[i], inMin, inMax)
+    void            Clip(Float32* ioBuffer, UInt32 inSampleCount, Float32 inMin, Float32 inMax) noexcept;
+
+    // Scale each frame of an interleaved stereo buffer by a gain that changes linearly. Frame i is
+    // scaled by inStartGain + (inGainIncrement * i), so a ramp can be continued in the next buffer
+    // by passing inStartGain + (inGainIncrement * inFrameCount).
+    void            ScaleWithRamp(Float32* ioBuffer,
+                                  UInt32 inFrameCount,
+                                  Float32 inStartGain,
+                                  Float32 inGainIncrement) noexcept;
+
+    // Scale each frame of interleaved stereo audio by its own gain:
+    //
+    //     outBuffer[2i] = inBuffer[2i] * inGains[i]
+    //     outBuffer[2i + 1] = inBuffer[2i + 1] * inGains[i]
+    void            ScaleStereoFrames(const Float32* inBuffer,
+                                      const Float32* inGains,
+                                      Float32* outBuffer,
+                                      UInt32 inFrameCount) noexcept;
+
+#pragma mark Mixing
+
+    // Mix each frame of an interleaved stereo buffer through inMatrix:
+    //
+    //     L' = (L * mLeftToLeft) + (R * mRightToLeft)
+    //     R' = (L * mLeftToRight) + (R * mRightToRight)
+    void            MixStereo(Float32* ioBuffer, UInt32 inFrameCount, const StereoMatrix& inMatrix) noexcept;
+
+    // MixStereo, then clamp each sample to [inMin, inMax].
+    void            MixStereoAndClip(Float32* ioBuffer,
+                                     UInt32 inFrameCount,
+                                     const StereoMatrix& inMatrix,
+                                     Float32 inMin,
+                                     Float32 inMax) noexcept;
+
+    // ioSum[i] += inBuffer[i]
+    void            Accumulate(Float32* ioSum, const Float32* inBuffer, UInt32 inSampleCount) noexcept;
+
+#pragma mark Metering
+
+    // @return The largest absolute value in inBuffer, or 0 if inSampleCount is 0.
+    Float32         Peak(const Float32* inBuffer, UInt32 inSampleCount) noexcept;
+
+    // The root mean square of inBuffer, or 0 if inSampleCount is 0.
+    //
+    // The squares are summed in Float32, in four interleaved partial sums (sample i goes in sum
+    // i % 4), which are added as (s0 + s1) + (s2 + s3). The last inSampleCount % 4 samples are then
+    // added one at a time.
+    Float32         RMS(const Float32* inBuffer, UInt32 inSampleCount) noexcept;
+
+    // The peak of each frame of interleaved stereo audio: outPeaks[i] = max(|L|, |R|).
+    void            StereoFramePeaks(const Float32* inBuffer, Float32* outPeaks, UInt32 inFrameCount) noexcept;
+}
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_DSP */
+
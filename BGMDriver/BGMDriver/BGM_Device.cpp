@@ -31,7 +31,10 @@
 #include "BGM_Device.h"
 
 // Local Includes
+#include "BGM_DSP.h"
+#include "BGM_ObjectRegistry.h"
 #include "BGM_PlugIn.h"
+#include "BGM_PropertyTable.h"
 #include "BGM_XPCHelper.h"
 #include "BGM_Utils.h"
 
@@ -39,12 +42,18 @@
 #include "CADispatchQueue.h"
 #include "CAException.h"
 #include "CACFArray.h"
+#include "CACFDictionary.h"
 #include "CACFString.h"
 #include "CADebugMacros.h"
 #include "CAHostTimeBase.h"
 
 // STL Includes
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <map>
 #include <stdexcept>
+#include <vector>
 
 // System Includes
 #include <CoreAudio/AudioHardwareBase.h>
@@ -82,6 +91,7 @@ void	BGM_Device::StaticInitializer()
                                    kObjectID_Stream_Output,
 								   kObjectID_Volume_Output_Master,
 								   kObjectID_Mute_Output_Master);
+        sInstance->RegisterObjects();
         sInstance->Activate();
 
         // The instance for system (UI) sounds.
@@ -92,19 +102,22 @@ void	BGM_Device::StaticInitializer()
                                            kObjectID_Stream_Input_UI_Sounds,
                                            kObjectID_Stream_Output_UI_Sounds,
                                            kObjectID_Volume_Output_Master_UI_Sounds,
-                                           kAudioObjectUnknown);  // No mute control.
+                                           kAudioObjectUnknown,  // No mute control.
+                                           kBGMLoopbackSegmentName_UISounds,
+                                           kBGMCaptureTapSegmentNamePrefix_UISounds);
 
         // Set up the UI sounds device's volume control.
         BGM_VolumeControl& theUISoundsVolumeControl = sUISoundsInstance->mVolumeControl;
         // Default to full volume.
         theUISoundsVolumeControl.SetVolumeScalar(1.0f);
         // Make the volume curve a bit steeper than the default.
-        theUISoundsVolumeControl.GetVolumeCurve().SetTransferFunction(CAVolumeCurve::kPow4Over1Curve);
+        theUISoundsVolumeControl.SetVolumeCurveTransferFunction(CAVolumeCurve::kPow4Over1Curve);
         // Apply the volume to the device's output stream. The main instance of BGM_Device doesn't
         // apply volume to its audio because BGMApp changes the real output device's volume directly
         // instead.
         theUISoundsVolumeControl.SetWillApplyVolumeToAudio(true);
 
+        sUISoundsInstance->RegisterObjects();
         sUISoundsInstance->Activate();
     }
     catch(...)
@@ -126,7 +139,10 @@ BGM_Device::BGM_Device(AudioObjectID inObjectID,
                        AudioObjectID inInputStreamID,
                        AudioObjectID inOutputStreamID,
 					   AudioObjectID inOutputVolumeControlID,
-					   AudioObjectID inOutputMuteControlID)
+					   AudioObjectID inOutputMuteControlID,
+                       const char* inLoopbackSegmentName,
+                       const char* inCaptureTapSegmentNamePrefix,
+                       const char* __nullable inIOTraceDirectory)
 :
 	BGM_AbstractDevice(inObjectID, kAudioObjectPlugInObject),
 	mStateMutex("Device State"),
@@ -138,7 +154,12 @@ BGM_Device::BGM_Device(AudioObjectID inObjectID,
     mClients(inObjectID, &mTaskQueue),
     mInputStream(inInputStreamID, inObjectID, false, kSampleRateDefault),
     mOutputStream(inOutputStreamID, inObjectID, false, kSampleRateDefault),
+    mLoopbackSegmentName(inLoopbackSegmentName),
+    mCaptureTaps(inCaptureTapSegmentNamePrefix),
     mAudibleState(),
+    mBoostLimiter(kSampleRateDefault),
+    mDucker(kSampleRateDefault),
+    mIOTraceDirectory(inIOTraceDirectory),
     mVolumeControl(inOutputVolumeControlID, GetObjectID()),
     mMuteControl(inOutputMuteControlID, GetObjectID())
 {
@@ -150,6 +171,25 @@ BGM_Device::~BGM_Device()
 {
 }
 
+void    BGM_Device::RegisterObjects()
+{
+    BGM_AbstractDevice::RegisterObjects();
+
+    // The device answers the HAL's calls for its streams and controls.
+    BGM_ObjectRegistry::RegisterObject(mInputStream, *this);
+    BGM_ObjectRegistry::RegisterObject(mOutputStream, *this);
+
+    if(mVolumeControl.GetObjectID() != kAudioObjectUnknown)
+    {
+        BGM_ObjectRegistry::RegisterObject(mVolumeControl, *this);
+    }
+
+    if(mMuteControl.GetObjectID() != kAudioObjectUnknown)
+    {
+        BGM_ObjectRegistry::RegisterObject(mMuteControl, *this);
+    }
+}
+
 void	BGM_Device::Activate()
 {
 	CAMutex::Locker theStateLocker(mStateMutex);
@@ -200,11 +240,14 @@ void    BGM_Device::InitLoopback()
     // Calculate the number of host clock ticks per frame for our loopback clock.
     mLoopbackTime.hostTicksPerFrame = CAHostTimeBase::GetFrequency() / mLoopbackSampleRate;
     
-    //  Allocate (or re-allocate) the loopback buffer.
+    //  Allocate (or re-allocate) the loopback buffer. It holds the same length of audio at any
+    //  sample rate, so it has to be bigger at higher rates.
     //  2 channels * 32-bit float = bytes in each frame
     //  Pass 1 for nChannels because it's going to be storing interleaved audio, which means we
     //  don't need a separate buffer for each channel.
-	mLoopbackRingBuffer.Allocate(1, 2 * sizeof(Float32), kLoopbackRingBufferFrameSize);
+    mLoopbackRingBufferFrameSize =
+            BGM_LoopbackSharedMemory::GetCapacityFramesForSampleRate(mLoopbackSampleRate);
+	mLoopbackRingBuffer.Allocate(1, 2 * sizeof(Float32), mLoopbackRingBufferFrameSize);
 }
 
 #pragma mark Property Operations
@@ -305,10 +348,52 @@ void	BGM_Device::SetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, co
             }
 		}
 	}
+
+    RecordSetPropertyForIOTrace(inObjectID, inClientPID, inAddress, inDataSize, inData);
 }
 
 #pragma mark Device Property Operations
 
+static constexpr UInt32 kAvailableNominalSampleRatesSize = (kBGMNumStandardSampleRates + 1) * sizeof(AudioValueRange);
+static constexpr UInt32 kPreferredChannelLayoutSize =
+        offsetof(AudioChannelLayout, mChannelDescriptions) + (2 * sizeof(AudioChannelDescription));
+
+// The properties BGM_Device implements or overrides, sorted by selector. Anything not in this table
+// is handled by BGM_AbstractDevice. The custom properties are listed in
+// kAudioObjectPropertyCustomPropertyInfoList, so adding one here is enough to publish it.
+static constexpr BGM_PropertyInfo kDeviceProperties[] = {
+    { kAudioDeviceCustomPropertyAppVolumes,                              BGM_PropertyScopes::Any,           true,  sizeof(CFPropertyListRef),        kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+    { kAudioDeviceCustomPropertyEnabledOutputControls,                   BGM_PropertyScopes::Any,           true,  sizeof(CFArrayRef),               kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+    { kAudioDeviceCustomPropertyBoostLimiter,                            BGM_PropertyScopes::Any,           true,  sizeof(CFBooleanRef),             kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+    { kAudioDeviceCustomPropertyCaptureTaps,                             BGM_PropertyScopes::Any,           true,  sizeof(CFArrayRef),               kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+    { kAudioObjectPropertyControlList,                                   BGM_PropertyScopes::Any,           false, BGM_PropertyTable::kVariableSize, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioObjectPropertyCustomPropertyInfoList,                        BGM_PropertyScopes::Any,           false, BGM_PropertyTable::kVariableSize, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDeviceCustomPropertyDeviceAudibleState,                      BGM_PropertyScopes::Any,           false, sizeof(CFNumberRef),              kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+    { kAudioDevicePropertyPreferredChannelsForStereo,                    BGM_PropertyScopes::InputOrOutput, false, 2 * sizeof(UInt32),               kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyDeviceCanBeDefaultDevice,                      BGM_PropertyScopes::InputOrOutput, false, sizeof(UInt32),                   kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyIcon,                                          BGM_PropertyScopes::Any,           false, sizeof(CFURLRef),                 kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDeviceCustomPropertyIOProfile,                               BGM_PropertyScopes::Any,           true,  sizeof(CFDictionaryRef),          kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+    { kAudioDeviceCustomPropertyIOTrace,                                 BGM_PropertyScopes::Any,           true,  sizeof(CFDictionaryRef),          kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+    { kAudioDeviceCustomPropertyLoopbackSharedMemory,                    BGM_PropertyScopes::Any,           true,  sizeof(CFBooleanRef),             kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+    { kAudioDevicePropertyLatency,                                       BGM_PropertyScopes::InputOrOutput, false, sizeof(UInt32),                   kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDeviceCustomPropertyMusicDucking,                            BGM_PropertyScopes::Any,           true,  sizeof(CFDictionaryRef),          kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+    { kAudioDeviceCustomPropertyMusicPlayerBundleID,                     BGM_PropertyScopes::Any,           true,  sizeof(CFStringRef),              kAudioServerPlugInCustomPropertyDataTypeCFString },
+    { kAudioDeviceCustomPropertyMusicPlayerProcessID,                    BGM_PropertyScopes::Any,           true,  sizeof(CFPropertyListRef),        kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+    { kAudioDevicePropertyAvailableNominalSampleRates,                   BGM_PropertyScopes::Any,           false, kAvailableNominalSampleRatesSize, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyNominalSampleRate,                             BGM_PropertyScopes::Any,           true,  sizeof(Float64),                  kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioObjectPropertyOwnedObjects,                                  BGM_PropertyScopes::Any,           false, BGM_PropertyTable::kVariableSize, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp, BGM_PropertyScopes::Any,           false, sizeof(CFBooleanRef),             kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+    { kAudioDevicePropertySafetyOffset,                                  BGM_PropertyScopes::InputOrOutput, false, sizeof(UInt32),                   kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyDeviceCanBeDefaultSystemDevice,                BGM_PropertyScopes::InputOrOutput, false, sizeof(UInt32),                   kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyPreferredChannelLayout,                        BGM_PropertyScopes::InputOrOutput, false, kPreferredChannelLayoutSize,      kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioDevicePropertyStreams,                                       BGM_PropertyScopes::Any,           false, BGM_PropertyTable::kVariableSize, kAudioServerPlugInCustomPropertyDataTypeNone }
+};
+
+static_assert(BGM_PropertyTable::IsSorted(kDeviceProperties),
+              "kDeviceProperties must be sorted by selector");
+
+static constexpr BGM_PropertyTable sDeviceProperties(kDeviceProperties);
+
 bool	BGM_Device::Device_HasProperty(AudioObjectID inObjectID, pid_t inClientPID, const AudioObjectPropertyAddress& inAddress) const
 {
 	//	For each object, this driver implements all the required properties plus a few extras that
@@ -316,33 +401,17 @@ bool	BGM_Device::Device_HasProperty(AudioObjectID inObjectID, pid_t inClientPID,
 	//	Device_GetPropertyData() method.
 	
 	bool theAnswer = false;
-	switch(inAddress.mSelector)
+	const BGM_PropertyInfo* theInfo = sDeviceProperties.Find(inAddress.mSelector);
+
+	if(theInfo != nullptr)
 	{
-        case kAudioDevicePropertyStreams:
-        case kAudioDevicePropertyIcon:
-        case kAudioObjectPropertyCustomPropertyInfoList:
-        case kAudioDeviceCustomPropertyDeviceAudibleState:
-        case kAudioDeviceCustomPropertyMusicPlayerProcessID:
-        case kAudioDeviceCustomPropertyMusicPlayerBundleID:
-        case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp:
-        case kAudioDeviceCustomPropertyAppVolumes:
-        case kAudioDeviceCustomPropertyEnabledOutputControls:
-			theAnswer = true;
-			break;
-			
-		case kAudioDevicePropertyLatency:
-		case kAudioDevicePropertySafetyOffset:
-		case kAudioDevicePropertyPreferredChannelsForStereo:
-		case kAudioDevicePropertyPreferredChannelLayout:
-		case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-		case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-			theAnswer = (inAddress.mScope == kAudioObjectPropertyScopeInput) || (inAddress.mScope == kAudioObjectPropertyScopeOutput);
-			break;
-			
-		default:
-			theAnswer = BGM_AbstractDevice::HasProperty(inObjectID, inClientPID, inAddress);
-			break;
-	};
+		theAnswer = BGM_PropertyTable::HasScope(*theInfo, inAddress.mScope);
+	}
+	else
+	{
+		theAnswer = BGM_AbstractDevice::HasProperty(inObjectID, inClientPID, inAddress);
+	}
+
 	return theAnswer;
 }
 
@@ -353,34 +422,17 @@ bool	BGM_Device::Device_IsPropertySettable(AudioObjectID inObjectID, pid_t inCli
 	//	Device_GetPropertyData() method.
 	
 	bool theAnswer = false;
-	switch(inAddress.mSelector)
-    {
-		case kAudioDevicePropertyStreams:
-		case kAudioDevicePropertyLatency:
-		case kAudioDevicePropertySafetyOffset:
-        case kAudioDevicePropertyPreferredChannelsForStereo:
-        case kAudioDevicePropertyPreferredChannelLayout:
-		case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-		case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-        case kAudioDevicePropertyIcon:
-        case kAudioObjectPropertyCustomPropertyInfoList:
-        case kAudioDeviceCustomPropertyDeviceAudibleState:
-        case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp:
-			theAnswer = false;
-			break;
-            
-        case kAudioDevicePropertyNominalSampleRate:
-        case kAudioDeviceCustomPropertyMusicPlayerProcessID:
-        case kAudioDeviceCustomPropertyMusicPlayerBundleID:
-        case kAudioDeviceCustomPropertyAppVolumes:
-        case kAudioDeviceCustomPropertyEnabledOutputControls:
-			theAnswer = true;
-			break;
-		
-		default:
-			theAnswer = BGM_AbstractDevice::IsPropertySettable(inObjectID, inClientPID, inAddress);
-			break;
-	};
+	const BGM_PropertyInfo* theInfo = sDeviceProperties.Find(inAddress.mSelector);
+
+	if(theInfo != nullptr)
+	{
+		theAnswer = theInfo->mIsSettable;
+	}
+	else
+	{
+		theAnswer = BGM_AbstractDevice::IsPropertySettable(inObjectID, inClientPID, inAddress);
+	}
+
 	return theAnswer;
 }
 
@@ -391,106 +443,80 @@ UInt32	BGM_Device::Device_GetPropertyDataSize(AudioObjectID inObjectID, pid_t in
 	//	Device_GetPropertyData() method.
 	
 	UInt32 theAnswer = 0;
+	const BGM_PropertyInfo* theInfo = sDeviceProperties.Find(inAddress.mSelector);
 
-	switch(inAddress.mSelector)
+	if(theInfo == nullptr)
 	{
-		case kAudioObjectPropertyOwnedObjects:
-            {
-                switch(inAddress.mScope)
-                {
-                    case kAudioObjectPropertyScopeGlobal:
-                        theAnswer = GetNumberOfSubObjects() * sizeof(AudioObjectID);
-                        break;
-                        
-                    case kAudioObjectPropertyScopeInput:
-                        theAnswer = kNumberOfInputSubObjects * sizeof(AudioObjectID);
-                        break;
-                        
-                    case kAudioObjectPropertyScopeOutput:
-                        theAnswer = kNumberOfOutputStreams * sizeof(AudioObjectID);
-                        theAnswer += GetNumberOfOutputControls() * sizeof(AudioObjectID);
-                        break;
-
-					default:
-						break;
-                };
-            }
-			break;
-
-        case kAudioDevicePropertyStreams:
-            {
-                switch(inAddress.mScope)
-                {
-                    case kAudioObjectPropertyScopeGlobal:
-                        theAnswer = kNumberOfStreams * sizeof(AudioObjectID);
-                        break;
-                        
-                    case kAudioObjectPropertyScopeInput:
-                        theAnswer = kNumberOfInputStreams * sizeof(AudioObjectID);
-                        break;
-                        
-                    case kAudioObjectPropertyScopeOutput:
-                        theAnswer = kNumberOfOutputStreams * sizeof(AudioObjectID);
-                        break;
-
-					default:
-						break;
-                };
-            }
-			break;
-
-        case kAudioObjectPropertyControlList:
-            theAnswer = GetNumberOfOutputControls() * sizeof(AudioObjectID);
-            break;
-
-		case kAudioDevicePropertyAvailableNominalSampleRates:
-			theAnswer = 1 * sizeof(AudioValueRange);
-			break;
-
-		case kAudioDevicePropertyPreferredChannelsForStereo:
-			theAnswer = 2 * sizeof(UInt32);
-			break;
+		theAnswer = BGM_AbstractDevice::GetPropertyDataSize(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData);
+	}
+	else if(theInfo->mDataSize != BGM_PropertyTable::kVariableSize)
+	{
+		theAnswer = theInfo->mDataSize;
+	}
+	else
+	{
+		// The properties whose sizes depend on the scope or the device's state.
+		switch(inAddress.mSelector)
+		{
+			case kAudioObjectPropertyOwnedObjects:
+				{
+					switch(inAddress.mScope)
+					{
+						case kAudioObjectPropertyScopeGlobal:
+							theAnswer = GetNumberOfSubObjects() * sizeof(AudioObjectID);
+							break;
+							
+						case kAudioObjectPropertyScopeInput:
+							theAnswer = kNumberOfInputSubObjects * sizeof(AudioObjectID);
+							break;
+							
+						case kAudioObjectPropertyScopeOutput:
+							theAnswer = kNumberOfOutputStreams * sizeof(AudioObjectID);
+							theAnswer += GetNumberOfOutputControls() * sizeof(AudioObjectID);
+							break;
+
+						default:
+							break;
+					};
+				}
+				break;
 
-		case kAudioDevicePropertyPreferredChannelLayout:
-			theAnswer = offsetof(AudioChannelLayout, mChannelDescriptions) + (2 * sizeof(AudioChannelDescription));
-			break;
+			case kAudioDevicePropertyStreams:
+				{
+					switch(inAddress.mScope)
+					{
+						case kAudioObjectPropertyScopeGlobal:
+							theAnswer = kNumberOfStreams * sizeof(AudioObjectID);
+							break;
+							
+						case kAudioObjectPropertyScopeInput:
+							theAnswer = kNumberOfInputStreams * sizeof(AudioObjectID);
+							break;
+							
+						case kAudioObjectPropertyScopeOutput:
+							theAnswer = kNumberOfOutputStreams * sizeof(AudioObjectID);
+							break;
+
+						default:
+							break;
+					};
+				}
+				break;
 
-        case kAudioDevicePropertyIcon:
-            theAnswer = sizeof(CFURLRef);
-            break;
-            
-        case kAudioObjectPropertyCustomPropertyInfoList:
-            theAnswer = sizeof(AudioServerPlugInCustomPropertyInfo) * 6;
-            break;
-            
-        case kAudioDeviceCustomPropertyDeviceAudibleState:
-            theAnswer = sizeof(CFNumberRef);
-            break;
+			case kAudioObjectPropertyControlList:
+				theAnswer = GetNumberOfOutputControls() * sizeof(AudioObjectID);
+				break;
 
-        case kAudioDeviceCustomPropertyMusicPlayerProcessID:
-            theAnswer = sizeof(CFPropertyListRef);
-			break;
-            
-        case kAudioDeviceCustomPropertyMusicPlayerBundleID:
-            theAnswer = sizeof(CFStringRef);
-            break;
-            
-        case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp:
-            theAnswer = sizeof(CFBooleanRef);
-            break;
-            
-        case kAudioDeviceCustomPropertyAppVolumes:
-            theAnswer = sizeof(CFPropertyListRef);
-            break;
+			case kAudioObjectPropertyCustomPropertyInfoList:
+				theAnswer = sDeviceProperties.GetNumberOfCustomProperties() *
+						static_cast<UInt32>(sizeof(AudioServerPlugInCustomPropertyInfo));
+				break;
 
-        case kAudioDeviceCustomPropertyEnabledOutputControls:
-            theAnswer = sizeof(CFArrayRef);
-            break;
-		
-		default:
-			theAnswer = BGM_AbstractDevice::GetPropertyDataSize(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData);
-			break;
-	};
+			default:
+				BGMAssert(false, "BGM_Device::Device_GetPropertyDataSize: No size for property %u", inAddress.mSelector);
+				break;
+		};
+	}
 
 	return theAnswer;
 }
@@ -512,7 +538,7 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
 			//	value that is a key into the localizable strings in this bundle. This allows us to
 			//	return a localized name for the device.
 			ThrowIf(inDataSize < sizeof(AudioObjectID), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioObjectPropertyName for the device");
-            *reinterpret_cast<CFStringRef*>(outData) = mDeviceName;
+            *reinterpret_cast<CFStringRef*>(outData) = static_cast<CFStringRef>(CFRetain(mDeviceName));
 			outDataSize = sizeof(CFStringRef);
 			break;
 			
@@ -638,7 +664,7 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
 			//	audio device across boot sessions. Note that two instances of the same
 			//	device must have different values for this property.
 			ThrowIf(inDataSize < sizeof(AudioObjectID), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDevicePropertyDeviceUID for the device");
-            *reinterpret_cast<CFStringRef*>(outData) = mDeviceUID;
+            *reinterpret_cast<CFStringRef*>(outData) = static_cast<CFStringRef>(CFRetain(mDeviceUID));
 			outDataSize = sizeof(CFStringRef);
 			break;
 
@@ -647,7 +673,7 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
 			//	devices that are the same kind of device. Note that two instances of the
 			//	save device must have the same value for this property.
 			ThrowIf(inDataSize < sizeof(AudioObjectID), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDevicePropertyModelUID for the device");
-            *reinterpret_cast<CFStringRef*>(outData) = mDeviceModelUID;
+            *reinterpret_cast<CFStringRef*>(outData) = static_cast<CFStringRef>(CFRetain(mDeviceModelUID));
 			outDataSize = sizeof(CFStringRef);
 			break;
             
@@ -799,7 +825,8 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
 			//	will have the minimum value equal to the maximum value.
             //
             //  BGMDevice supports any sample rate so it can be set to match the output
-            //  device when in loopback mode.
+            //  device when in loopback mode. The standard rates, 44.1 kHz to 192 kHz, are
+            //  listed first so they show up in Audio MIDI Setup, followed by the full range.
 			
 			//	Calculate the number of items that have been requested. Note that this
 			//	number is allowed to be smaller than the actual size of the list. In such
@@ -807,22 +834,32 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
 			theNumberItemsToFetch = inDataSize / sizeof(AudioValueRange);
 			
 			//	clamp it to the number of items we have
-			if(theNumberItemsToFetch > 1)
+			if(theNumberItemsToFetch > kBGMNumStandardSampleRates + 1)
 			{
-				theNumberItemsToFetch = 1;
+				theNumberItemsToFetch = kBGMNumStandardSampleRates + 1;
 			}
 			
 			//	fill out the return array
-			if(theNumberItemsToFetch > 0)
+			for(theItemIndex = 0; theItemIndex < theNumberItemsToFetch; theItemIndex++)
 			{
-                // 0 would cause divide-by-zero errors in other BGM_Device functions (and
-                // wouldn't make sense anyway).
-                ((AudioValueRange*)outData)[0].mMinimum = 1.0;
-                // Just in case DBL_MAX would cause problems in a client for some reason,
-                // use an arbitrary very large number instead. (It wouldn't make sense to
-                // actually set the sample rate this high, but I don't know what a
-                // reasonable maximum would be.)
-                ((AudioValueRange*)outData)[0].mMaximum = 1000000000.0;
+                if(theItemIndex < kBGMNumStandardSampleRates)
+                {
+                    ((AudioValueRange*)outData)[theItemIndex].mMinimum =
+                            kBGMStandardSampleRates[theItemIndex];
+                    ((AudioValueRange*)outData)[theItemIndex].mMaximum =
+                            kBGMStandardSampleRates[theItemIndex];
+                }
+                else
+                {
+                    // 0 would cause divide-by-zero errors in other BGM_Device functions (and
+                    // wouldn't make sense anyway).
+                    ((AudioValueRange*)outData)[theItemIndex].mMinimum = 1.0;
+                    // Just in case DBL_MAX would cause problems in a client for some reason,
+                    // use an arbitrary very large number instead. (It wouldn't make sense to
+                    // actually set the sample rate this high, but I don't know what a
+                    // reasonable maximum would be.)
+                    ((AudioValueRange*)outData)[theItemIndex].mMaximum = 1000000000.0;
+                }
 			}
 			
 			//	report how much we wrote
@@ -862,8 +899,11 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
 		case kAudioDevicePropertyZeroTimeStampPeriod:
 			//	This property returns how many frames the HAL should expect to see between
 			//	successive sample times in the zero time stamps this device provides.
+            //
+            //  It depends on the sample rate, but the HAL reads it again after the config change
+            //  that sets the sample rate, so we don't need to send a notification.
 			ThrowIf(inDataSize < sizeof(UInt32), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDevicePropertyZeroTimeStampPeriod for the device");
-			*reinterpret_cast<UInt32*>(outData) = kLoopbackRingBufferFrameSize;
+			*reinterpret_cast<UInt32*>(outData) = mLoopbackRingBufferFrameSize;
 			outDataSize = sizeof(UInt32);
             break;
             
@@ -884,51 +924,10 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
             break;
             
         case kAudioObjectPropertyCustomPropertyInfoList:
-            theNumberItemsToFetch = inDataSize / sizeof(AudioServerPlugInCustomPropertyInfo);
-            
-            //	clamp it to the number of items we have
-            if(theNumberItemsToFetch > 6)
-            {
-                theNumberItemsToFetch = 6;
-            }
-            
-            if(theNumberItemsToFetch > 0)
-            {
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[0].mSelector = kAudioDeviceCustomPropertyAppVolumes;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[0].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[0].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
-            }
-            if(theNumberItemsToFetch > 1)
-            {
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[1].mSelector = kAudioDeviceCustomPropertyMusicPlayerProcessID;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[1].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[1].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
-            }
-            if(theNumberItemsToFetch > 2)
-            {
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[2].mSelector = kAudioDeviceCustomPropertyMusicPlayerBundleID;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[2].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFString;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[2].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
-            }
-            if(theNumberItemsToFetch > 3)
-            {
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[3].mSelector = kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[3].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[3].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
-            }
-            if(theNumberItemsToFetch > 4)
-            {
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[4].mSelector = kAudioDeviceCustomPropertyDeviceAudibleState;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[4].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[4].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
-            }
-            if(theNumberItemsToFetch > 5)
-            {
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[5].mSelector = kAudioDeviceCustomPropertyEnabledOutputControls;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[5].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
-                ((AudioServerPlugInCustomPropertyInfo*)outData)[5].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
-            }
-
+            // This property lists the device's custom properties, which come from kDeviceProperties.
+            theNumberItemsToFetch = sDeviceProperties.GetCustomPropertyInfo(
+                    reinterpret_cast<AudioServerPlugInCustomPropertyInfo*>(outData),
+                    static_cast<UInt32>(inDataSize / sizeof(AudioServerPlugInCustomPropertyInfo)));
             outDataSize = theNumberItemsToFetch * sizeof(AudioServerPlugInCustomPropertyInfo);
             break;
             
@@ -994,6 +993,55 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
             }
             break;
 
+        case kAudioDeviceCustomPropertyLoopbackSharedMemory:
+            {
+                ThrowIf(inDataSize < sizeof(CFBooleanRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyLoopbackSharedMemory for the device");
+                CAMutex::Locker theStateLocker(mStateMutex);
+                *reinterpret_cast<CFBooleanRef*>(outData) = (mLoopbackSharedMemory != nullptr) ? kCFBooleanTrue : kCFBooleanFalse;
+                outDataSize = sizeof(CFBooleanRef);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyCaptureTaps:
+            {
+                ThrowIf(inDataSize < sizeof(CFArrayRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyCaptureTaps for the device");
+                *reinterpret_cast<CFArrayRef*>(outData) = mCaptureTaps.CopyTapsAsCFArray();
+                outDataSize = sizeof(CFArrayRef);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyBoostLimiter:
+            {
+                ThrowIf(inDataSize < sizeof(CFBooleanRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyBoostLimiter for the device");
+                *reinterpret_cast<CFBooleanRef*>(outData) = mBoostLimiterEnabled ? kCFBooleanTrue : kCFBooleanFalse;
+                outDataSize = sizeof(CFBooleanRef);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyMusicDucking:
+            {
+                ThrowIf(inDataSize < sizeof(CFDictionaryRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyMusicDucking for the device");
+                *reinterpret_cast<CFDictionaryRef*>(outData) = CopyMusicDuckingSettings();
+                outDataSize = sizeof(CFDictionaryRef);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyIOProfile:
+            {
+                ThrowIf(inDataSize < sizeof(CFDictionaryRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyIOProfile for the device");
+                *reinterpret_cast<CFDictionaryRef*>(outData) = mIOProfiler.CopyProfile();
+                outDataSize = sizeof(CFDictionaryRef);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyIOTrace:
+            {
+                ThrowIf(inDataSize < sizeof(CFDictionaryRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyIOTrace for the device");
+                *reinterpret_cast<CFDictionaryRef*>(outData) = CopyIOTraceSettings();
+                outDataSize = sizeof(CFDictionaryRef);
+            }
+            break;
+
 		default:
 			BGM_AbstractDevice::GetPropertyData(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
 			break;
@@ -1160,100 +1208,295 @@ void	BGM_Device::Device_SetPropertyData(AudioObjectID inObjectID, pid_t inClient
             }
             break;
 
-		default:
-			BGM_AbstractDevice::SetPropertyData(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData);
-			break;
-    };
-}
+        case kAudioDeviceCustomPropertyLoopbackSharedMemory:
+            {
+                ThrowIf(inDataSize < sizeof(CFBooleanRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "BGM_Device::Device_SetPropertyData: wrong size for the data for "
+                        "kAudioDeviceCustomPropertyLoopbackSharedMemory");
 
-#pragma mark IO Operations
+                CFBooleanRef theEnabledRef = *reinterpret_cast<const CFBooleanRef*>(inData);
 
-void	BGM_Device::StartIO(UInt32 inClientID)
-{
-    bool clientIsBGMApp, bgmAppHasClientRegistered;
-    
-    {
-        CAMutex::Locker theStateLocker(mStateMutex);
-        
-        // An overview of the process this function is part of:
-        //   - A client starts IO.
-        //   - The plugin host (the HAL) calls the StartIO function in BGM_PlugInInterface, which calls this function.
-        //   - BGMDriver sends a message to BGMApp telling it to start the (real) audio hardware.
-        //   - BGMApp starts the hardware and, after the hardware is ready, replies to BGMDriver's message.
-        //   - BGMDriver lets the host know that it's ready to do IO by returning from StartIO.
-        
-        // Update our client data.
-        //
-        // We add the work to the task queue, rather than doing it here, because BeginIOOperation and EndIOOperation
-        // also add this task to the queue and the updates should be done in order.
-        bool didStartIO = mTaskQueue.QueueSync_StartClientIO(&mClients, inClientID);
-        
-        // We only tell the hardware to start if this is the first time IO has been started.
-        if(didStartIO)
-        {
-            kern_return_t theError = _HW_StartIO();
-            ThrowIfKernelError(theError,
-                               CAException(theError),
-                               "BGM_Device::StartIO: Failed to start because of an error calling down to the driver.");
-        }
-        
-        clientIsBGMApp = mClients.IsBGMApp(inClientID);
-        bgmAppHasClientRegistered = mClients.BGMAppHasClientRegistered();
-    }
-    
-    // We only return from StartIO after BGMApp is ready to pass the audio through to the output device. That way
-    // the HAL doesn't start sending us data before BGMApp can play it, which would mean we'd have to either drop
-    // frames or increase latency.
-    if(!clientIsBGMApp && bgmAppHasClientRegistered)
-    {
-        UInt64 theXPCError = StartBGMAppPlayThroughSync(GetObjectID() == kObjectID_Device_UI_Sounds);
-        
-        switch(theXPCError)
-        {
-            case kBGMXPC_Success:
-                DebugMsg("BGM_Device::StartIO: Ready for IO.");
-                break;
-        
-            case kBGMXPC_MessageFailure:
-                // This most likely means BGMXPCHelper isn't installed or has crashed. IO will probably still work,
-                // but we may drop frames while the audio hardware starts up.
-                LogError("BGM_Device::StartIO: Couldn't reach BGMApp via XPC. Attempting to start IO anyway.");
-                break;
-                
-            case kBGMXPC_ReturningEarlyError:
-                // This can (and might always) happen when the user changes output device in BGMApp while IO is running.
-                // See BGMAudioDeviceManager::startPlayThroughSync and BGMPlayThrough::WaitForOutputDeviceToStart.
-                LogWarning("BGM_Device::StartIO: BGMApp was busy, so BGMDriver has to return from StartIO early.");
-                break;
-                
-            default:
-                LogError("BGM_Device::StartIO: BGMApp failed to start the output device. theXPCError=%llu", theXPCError);
-                Throw(CAException(kAudioHardwareNotRunningError));
-        }
-    }
-}
+                ThrowIfNULL(theEnabledRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "BGM_Device::Device_SetPropertyData: null reference given for "
+                            "kAudioDeviceCustomPropertyLoopbackSharedMemory");
+                ThrowIf(CFGetTypeID(theEnabledRef) != CFBooleanGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "BGM_Device::Device_SetPropertyData: CFType given for "
+                        "kAudioDeviceCustomPropertyLoopbackSharedMemory was not a CFBoolean");
 
-void	BGM_Device::StopIO(UInt32 inClientID)
-{
-    CAMutex::Locker theStateLocker(mStateMutex);
-    
-    // Update our client data.
-    //
-    // We add the work to the task queue, rather than doing it here, because BeginIOOperation and EndIOOperation also
-    // add this task to the queue and the updates should be done in order.
-    bool didStopIO = mTaskQueue.QueueSync_StopClientIO(&mClients, inClientID);
-	
-	//	we tell the hardware to stop if this is the last stop call
-	if(didStopIO)
+                bool propertyWasChanged = SetLoopbackSharedMemoryEnabled(CFBooleanGetValue(theEnabledRef));
+
+                if(propertyWasChanged)
+                {
+                    // Send notification
+                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
+                        AudioObjectPropertyAddress theChangedProperties[] = { kBGMLoopbackSharedMemoryAddress };
+                        BGM_PlugIn::Host_PropertiesChanged(inObjectID, 1, theChangedProperties);
+                    });
+                }
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyCaptureTaps:
+            {
+                ThrowIf(inDataSize < sizeof(CFArrayRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "BGM_Device::Device_SetPropertyData: wrong size for the data for "
+                        "kAudioDeviceCustomPropertyCaptureTaps");
+
+                CFArrayRef theTapsRef = *reinterpret_cast<const CFArrayRef*>(inData);
+
+                ThrowIfNULL(theTapsRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "BGM_Device::Device_SetPropertyData: null reference given for "
+                            "kAudioDeviceCustomPropertyCaptureTaps");
+                ThrowIf(CFGetTypeID(theTapsRef) != CFArrayGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "BGM_Device::Device_SetPropertyData: CFType given for "
+                        "kAudioDeviceCustomPropertyCaptureTaps was not a CFArray");
+
+                bool propertyWasChanged = SetCaptureTaps(CACFArray(theTapsRef, false));
+
+                if(propertyWasChanged)
+                {
+                    // Send notification
+                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
+                        AudioObjectPropertyAddress theChangedProperties[] = { kBGMCaptureTapsAddress };
+                        BGM_PlugIn::Host_PropertiesChanged(inObjectID, 1, theChangedProperties);
+                    });
+                }
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyBoostLimiter:
+            {
+                ThrowIf(inDataSize < sizeof(CFBooleanRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "BGM_Device::Device_SetPropertyData: wrong size for the data for "
+                        "kAudioDeviceCustomPropertyBoostLimiter");
+
+                CFBooleanRef theEnabledRef = *reinterpret_cast<const CFBooleanRef*>(inData);
+
+                ThrowIfNULL(theEnabledRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "BGM_Device::Device_SetPropertyData: null reference given for "
+                            "kAudioDeviceCustomPropertyBoostLimiter");
+                ThrowIf(CFGetTypeID(theEnabledRef) != CFBooleanGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "BGM_Device::Device_SetPropertyData: CFType given for "
+                        "kAudioDeviceCustomPropertyBoostLimiter was not a CFBoolean");
+
+                // The notification is sent after the change has been made. See SetBoostLimiterEnabled.
+                RequestBoostLimiterEnabled(CFBooleanGetValue(theEnabledRef));
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyMusicDucking:
+            {
+                ThrowIf(inDataSize < sizeof(CFDictionaryRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "BGM_Device::Device_SetPropertyData: wrong size for the data for "
+                        "kAudioDeviceCustomPropertyMusicDucking");
+
+                CFDictionaryRef theSettingsRef = *reinterpret_cast<const CFDictionaryRef*>(inData);
+
+                ThrowIfNULL(theSettingsRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "BGM_Device::Device_SetPropertyData: null reference given for "
+                            "kAudioDeviceCustomPropertyMusicDucking");
+                ThrowIf(CFGetTypeID(theSettingsRef) != CFDictionaryGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "BGM_Device::Device_SetPropertyData: CFType given for "
+                        "kAudioDeviceCustomPropertyMusicDucking was not a CFDictionary");
+
+                bool propertyWasChanged = SetMusicDuckingSettings(CACFDictionary(theSettingsRef, false));
+
+                if(propertyWasChanged)
+                {
+                    // Send notification
+                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
+                        AudioObjectPropertyAddress theChangedProperties[] = { kBGMMusicDuckingAddress };
+                        BGM_PlugIn::Host_PropertiesChanged(inObjectID, 1, theChangedProperties);
+                    });
+                }
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyIOProfile:
+            {
+                ThrowIf(inDataSize < sizeof(CFDictionaryRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "BGM_Device::Device_SetPropertyData: wrong size for the data for "
+                        "kAudioDeviceCustomPropertyIOProfile");
+
+                CFDictionaryRef theDictRef = *reinterpret_cast<const CFDictionaryRef*>(inData);
+
+                ThrowIf(theDictRef == nullptr || CFGetTypeID(theDictRef) != CFDictionaryGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "BGM_Device::Device_SetPropertyData: CFType given for "
+                        "kAudioDeviceCustomPropertyIOProfile was not a CFDictionary");
+
+                // Setting the property clears the histograms. The dictionary's contents are ignored.
+                mIOProfiler.Reset();
+
+                if(BGM_IOProfiler::kEnabled)
+                {
+                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
+                        AudioObjectPropertyAddress theChangedProperties[] = { kBGMIOProfileAddress };
+                        BGM_PlugIn::Host_PropertiesChanged(inObjectID, 1, theChangedProperties);
+                    });
+                }
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyIOTrace:
+            {
+                ThrowIf(inDataSize < sizeof(CFDictionaryRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "BGM_Device::Device_SetPropertyData: wrong size for the data for "
+                        "kAudioDeviceCustomPropertyIOTrace");
+
+                CFDictionaryRef theSettingsRef = *reinterpret_cast<const CFDictionaryRef*>(inData);
+
+                ThrowIfNULL(theSettingsRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "BGM_Device::Device_SetPropertyData: null reference given for "
+                            "kAudioDeviceCustomPropertyIOTrace");
+                ThrowIf(CFGetTypeID(theSettingsRef) != CFDictionaryGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "BGM_Device::Device_SetPropertyData: CFType given for "
+                        "kAudioDeviceCustomPropertyIOTrace was not a CFDictionary");
+
+                bool propertyWasChanged = SetIOTraceSettings(CACFDictionary(theSettingsRef, false));
+
+                if(propertyWasChanged)
+                {
+                    // Send notification
+                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
+                        AudioObjectPropertyAddress theChangedProperties[] = { kBGMIOTraceAddress };
+                        BGM_PlugIn::Host_PropertiesChanged(inObjectID, 1, theChangedProperties);
+                    });
+                }
+            }
+            break;
+
+		default:
+			BGM_AbstractDevice::SetPropertyData(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData);
+			break;
+    };
+}
+
+#pragma mark IO Operations
+
+void	BGM_Device::StartIO(UInt32 inClientID)
+{
+    bool clientIsBGMApp, bgmAppHasClientRegistered;
+    
+    {
+        CAMutex::Locker theStateLocker(mStateMutex);
+
+        // Don't let IO start on a device that's being removed. Deactivate holds mStateMutex, so once
+        // it's returned, IsRunningIO can only go from true to false.
+        ThrowIf(!IsActive(),
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_Device::StartIO: The device has been deactivated");
+        
+        // An overview of the process this function is part of:
+        //   - A client starts IO.
+        //   - The plugin host (the HAL) calls the StartIO function in BGM_PlugInInterface, which calls this function.
+        //   - BGMDriver sends a message to BGMApp telling it to start the (real) audio hardware.
+        //   - BGMApp starts the hardware and, after the hardware is ready, replies to BGMDriver's message.
+        //   - BGMDriver lets the host know that it's ready to do IO by returning from StartIO.
+        
+        // Update our client data.
+        //
+        // We add the work to the task queue, rather than doing it here, because BeginIOOperation and EndIOOperation
+        // also add this task to the queue and the updates should be done in order.
+        bool didStartIO = mTaskQueue.QueueSync_StartClientIO(&mClients, inClientID);
+        
+        // We only tell the hardware to start if this is the first time IO has been started.
+        if(didStartIO)
+        {
+            kern_return_t theError = _HW_StartIO();
+            ThrowIfKernelError(theError,
+                               CAException(theError),
+                               "BGM_Device::StartIO: Failed to start because of an error calling down to the driver.");
+        }
+        
+        RecordForIOTrace([&](BGM_IOTraceRecorder& inTrace) { inTrace.RecordStartIO(inClientID); });
+        
+        clientIsBGMApp = mClients.IsBGMApp(inClientID);
+        bgmAppHasClientRegistered = mClients.BGMAppHasClientRegistered();
+    }
+    
+    // We only return from StartIO after BGMApp is ready to pass the audio through to the output device. That way
+    // the HAL doesn't start sending us data before BGMApp can play it, which would mean we'd have to either drop
+    // frames or increase latency.
+    //
+    // BGMApp only plays BGMDevice and the UI sounds device through to the output device, so there's
+    // nothing to wait for with the dynamic devices.
+    if(!clientIsBGMApp && bgmAppHasClientRegistered && !IsDynamic())
+    {
+        UInt64 theXPCError = StartBGMAppPlayThroughSync(GetObjectID() == kObjectID_Device_UI_Sounds);
+        
+        switch(theXPCError)
+        {
+            case kBGMXPC_Success:
+                DebugMsg("BGM_Device::StartIO: Ready for IO.");
+                break;
+        
+            case kBGMXPC_MessageFailure:
+                // This most likely means BGMXPCHelper isn't installed or has crashed. IO will probably still work,
+                // but we may drop frames while the audio hardware starts up.
+                LogError("BGM_Device::StartIO: Couldn't reach BGMApp via XPC. Attempting to start IO anyway.");
+                break;
+                
+            case kBGMXPC_ReturningEarlyError:
+                // This can (and might always) happen when the user changes output device in BGMApp while IO is running.
+                // See BGMAudioDeviceManager::startPlayThroughSync and BGMPlayThrough::WaitForOutputDeviceToStart.
+                LogWarning("BGM_Device::StartIO: BGMApp was busy, so BGMDriver has to return from StartIO early.");
+                break;
+                
+            default:
+                LogError("BGM_Device::StartIO: BGMApp failed to start the output device. theXPCError=%llu", theXPCError);
+                Throw(CAException(kAudioHardwareNotRunningError));
+        }
+    }
+}
+
+void	BGM_Device::StopIO(UInt32 inClientID)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+    
+    // Update our client data.
+    //
+    // We add the work to the task queue, rather than doing it here, because BeginIOOperation and EndIOOperation also
+    // add this task to the queue and the updates should be done in order.
+    bool didStopIO = mTaskQueue.QueueSync_StopClientIO(&mClients, inClientID);
+	
+	//	we tell the hardware to stop if this is the last stop call
+	if(didStopIO)
 	{
 		_HW_StopIO();
 	}
+
+    RecordForIOTrace([&](BGM_IOTraceRecorder& inTrace) { inTrace.RecordStopIO(inClientID); });
+}
+
+bool    BGM_Device::IsRunningIO() const
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+    return mClients.ClientsRunningIO();
 }
 
 void	BGM_Device::GetZeroTimeStamp(Float64& outSampleTime, UInt64& outHostTime, UInt64& outSeed)
 {
+    BGM_IOProfiler::Scope theProfilerScope(mIOProfiler, BGM_IOProfiler::kGetZeroTimeStamp);
+
 	// accessing the buffers requires holding the IO mutex
-	CAMutex::Locker theIOLocker(mIOMutex);
+	BGM_IOProfiler::Locker theIOLocker(mIOMutex, mIOProfiler);
     
     if(mWrappedAudioEngine != NULL)
     {
@@ -1267,10 +1510,10 @@ void	BGM_Device::GetZeroTimeStamp(Float64& outSampleTime, UInt64& outHostTime, U
     	UInt64 theNextHostTime;
     	
     	//	get the current host time
-        theCurrentHostTime = CAHostTimeBase::GetTheCurrentTime();
+        theCurrentHostTime = BGM_PlugIn::Host_GetCurrentTime();
     	
     	//	calculate the next host time
-    	theHostTicksPerRingBuffer = mLoopbackTime.hostTicksPerFrame * kLoopbackRingBufferFrameSize;
+    	theHostTicksPerRingBuffer = mLoopbackTime.hostTicksPerFrame * mLoopbackRingBufferFrameSize;
     	theHostTickOffset = static_cast<Float64>(mLoopbackTime.numberTimeStamps + 1) * theHostTicksPerRingBuffer;
     	theNextHostTime = mLoopbackTime.anchorHostTime + static_cast<UInt64>(theHostTickOffset);
     	
@@ -1281,7 +1524,7 @@ void	BGM_Device::GetZeroTimeStamp(Float64& outSampleTime, UInt64& outHostTime, U
     	}
     	
     	//	set the return values
-    	outSampleTime = mLoopbackTime.numberTimeStamps * kLoopbackRingBufferFrameSize;
+    	outSampleTime = mLoopbackTime.numberTimeStamps * mLoopbackRingBufferFrameSize;
     	outHostTime = static_cast<UInt64>(mLoopbackTime.anchorHostTime + (static_cast<Float64>(mLoopbackTime.numberTimeStamps) * theHostTicksPerRingBuffer));
         // TODO: I think we should increment outSeed whenever this device switches to/from having a wrapped engine
     	outSeed = 1;
@@ -1321,6 +1564,8 @@ void	BGM_Device::WillDoIOOperation(UInt32 inOperationID, bool& outWillDo, bool&
 void	BGM_Device::BeginIOOperation(UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo& inIOCycleInfo, UInt32 inClientID)
 {
 	#pragma unused(inIOBufferFrameSize, inIOCycleInfo)
+
+    BGM_IOProfiler::Scope theProfilerScope(mIOProfiler, BGM_IOProfiler::kBeginIOOperation);
     
     if(inOperationID == kAudioServerPlugInIOOperationThread)
     {
@@ -1342,18 +1587,40 @@ void	BGM_Device::BeginIOOperation(UInt32 inOperationID, UInt32 inIOBufferFrameSi
 void	BGM_Device::DoIOOperation(AudioObjectID inStreamObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo& inIOCycleInfo, void* ioMainBuffer, void* ioSecondaryBuffer)
 {
     #pragma unused(inStreamObjectID, ioSecondaryBuffer)
+
+    // Time the operation, including waiting for the IO mutex. Compiled out unless BGM_IO_PROFILING
+    // is set.
+    BGM_IOProfiler::Scope theProfilerScope(mIOProfiler,
+                                           BGM_IOProfiler::OperationForIOOperationID(inOperationID));
+
+    // Record the operation, with its audio before we process it, if kAudioDeviceCustomPropertyIOTrace
+    // is enabled.
+    if(mIOTraceEnabled)
+    {
+        BGM_IOProfiler::Locker theIOLocker(mIOMutex, mIOProfiler);
+
+        if(mIOTrace)
+        {
+            mIOTrace->RecordIOOperationRT(inOperationID,
+                                          inClientID,
+                                          inIOBufferFrameSize,
+                                          inIOCycleInfo,
+                                          ioMainBuffer);
+        }
+    }
     
 	switch(inOperationID)
 	{
 		case kAudioServerPlugInIOOperationReadInput:
             {
-                CAMutex::Locker theIOLocker(mIOMutex);
+                BGM_IOProfiler::Locker theIOLocker(mIOMutex, mIOProfiler);
 
                 // Copy the audio data out of our ring buffer.
                 //
                 // Take the IO mutex because, in testing, not taking it seemed to make this function
                 // occasionally miss its deadline and cause an audio glitch. It's hard to be sure
-                // that was actually the cause, but it's probably not worth the risk anyway.
+                // that was actually the cause, but it's probably not worth the risk anyway. (To
+                // check, build with BGM_IO_PROFILING=1. See BGM_IOProfiler.h.)
                 //
                 // If an IO operation misses its deadline, the host will log this message:
                 //     Audio IO Overload inputs: '<private>' outputs: '<private>' cause: 'Unknown'
@@ -1367,15 +1634,82 @@ void	BGM_Device::DoIOOperation(AudioObjectID inStreamObjectID, UInt32 inClientID
         case kAudioServerPlugInIOOperationProcessOutput:
             {
                 bool theClientIsMusicPlayer = mClients.IsMusicPlayerRT(inClientID);
-                
-                CAMutex::Locker theIOLocker(mIOMutex);
-                // Called in this IO operation so we can get the music player client's data separately
-				mAudibleState.UpdateWithClientIO(theClientIsMusicPlayer,
-												 inIOBufferFrameSize,
-												 inIOCycleInfo.mOutputTime.mSampleTime,
-												 reinterpret_cast<const Float32*>(ioMainBuffer));
+
+                // Most of the time, most clients (or all of them) aren't playing anything and their
+                // buffers are all zeros. Checking for that is much cheaper than checking whether
+                // the audio is audible, and lets us skip applying the client's volume and pan,
+                // which wouldn't change a silent buffer anyway.
+                bool theBufferIsSilent =
+                        BGM_AudibleState::BufferIsSilent(inIOBufferFrameSize,
+                                                         reinterpret_cast<const Float32*>(ioMainBuffer));
+
+                {
+                    BGM_IOProfiler::Locker theIOLocker(mIOMutex, mIOProfiler);
+                    // Called in this IO operation so we can get the music player client's data separately
+                    if(theBufferIsSilent)
+                    {
+                        mAudibleState.UpdateWithSilentClientIO(theClientIsMusicPlayer,
+                                                               inIOBufferFrameSize,
+                                                               inIOCycleInfo.mOutputTime.mSampleTime);
+                    }
+                    else
+                    {
+                        mAudibleState.UpdateWithClientIO(theClientIsMusicPlayer,
+                                                         inIOBufferFrameSize,
+                                                         inIOCycleInfo.mOutputTime.mSampleTime,
+                                                         reinterpret_cast<const Float32*>(ioMainBuffer));
+                    }
+                }
+
+                if(!theBufferIsSilent)
+                {
+                    ApplyClientRelativeVolume(inClientID, inIOBufferFrameSize, ioMainBuffer);
+                }
+
+                // Duck the music player if other clients are playing audio. The other clients'
+                // levels are measured after applying their relative volumes so muted apps don't
+                // duck the music.
+                if(mMusicDuckingEnabled)
+                {
+                    BGM_IOProfiler::Locker theIOLocker(mIOMutex, mIOProfiler);
+
+                    if(theClientIsMusicPlayer)
+                    {
+                        mDucker.ProcessRT(mAudibleState.GetNonMusicPeak(inIOCycleInfo.mOutputTime.mSampleTime),
+                                          inIOCycleInfo.mOutputTime.mSampleTime,
+                                          inIOBufferFrameSize,
+                                          reinterpret_cast<Float32*>(ioMainBuffer));
+                    }
+                    else if(theBufferIsSilent)
+                    {
+                        mAudibleState.UpdateNonMusicLevelWithSilentClientIO(
+                                inIOBufferFrameSize,
+                                inIOCycleInfo.mOutputTime.mSampleTime);
+                    }
+                    else
+                    {
+                        mAudibleState.UpdateNonMusicLevelWithClientIO(
+                                inIOBufferFrameSize,
+                                inIOCycleInfo.mOutputTime.mSampleTime,
+                                reinterpret_cast<const Float32*>(ioMainBuffer));
+                    }
+                }
+
+                // Copy the client's audio into its app's capture tap, if it has one. This is after
+                // applying the app's volume so recordings sound the same as what the user hears.
+                if(mCaptureTaps.HasActiveTapsRT())
+                {
+                    SInt32 theCaptureTap = mClients.GetClientCaptureTapRT(inClientID);
+
+                    if(theCaptureTap != -1)
+                    {
+                        mCaptureTaps.MixClientIORT(theCaptureTap,
+                                                   inIOBufferFrameSize,
+                                                   inIOCycleInfo.mOutputTime.mSampleTime,
+                                                   reinterpret_cast<const Float32*>(ioMainBuffer));
+                    }
+                }
             }
-            ApplyClientRelativeVolume(inClientID, inIOBufferFrameSize, ioMainBuffer);
             break;
 
         case kAudioServerPlugInIOOperationProcessMix:
@@ -1386,7 +1720,7 @@ void	BGM_Device::DoIOOperation(AudioObjectID inStreamObjectID, UInt32 inClientID
                             "BGM_Device::DoIOOperation: Buffer for "
                                     "kAudioServerPlugInIOOperationProcessMix must not be null");
 
-                CAMutex::Locker theIOLocker(mIOMutex);
+                BGM_IOProfiler::Locker theIOLocker(mIOMutex, mIOProfiler);
 
                 // We ask to do this IO operation so this device can apply its own volume to the
                 // stream. Currently, only the UI sounds device does.
@@ -1397,13 +1731,21 @@ void	BGM_Device::DoIOOperation(AudioObjectID inStreamObjectID, UInt32 inClientID
 
         case kAudioServerPlugInIOOperationWriteMix:
             {
-                CAMutex::Locker theIOLocker(mIOMutex);
+                BGM_IOProfiler::Locker theIOLocker(mIOMutex, mIOProfiler);
+
+                bool theMixIsSilent =
+                        BGM_AudibleState::BufferIsSilent(inIOBufferFrameSize,
+                                                         reinterpret_cast<const Float32*>(ioMainBuffer));
 
                 bool didChangeState =
-                        mAudibleState.UpdateWithMixedIO(
-                                inIOBufferFrameSize,
-                                inIOCycleInfo.mOutputTime.mSampleTime,
-                                reinterpret_cast<const Float32*>(ioMainBuffer));
+                        theMixIsSilent ?
+                                mAudibleState.UpdateWithSilentMixedIO(
+                                        inIOBufferFrameSize,
+                                        inIOCycleInfo.mOutputTime.mSampleTime) :
+                                mAudibleState.UpdateWithMixedIO(
+                                        inIOBufferFrameSize,
+                                        inIOCycleInfo.mOutputTime.mSampleTime,
+                                        reinterpret_cast<const Float32*>(ioMainBuffer));
 
                 if(didChangeState)
                 {
@@ -1412,10 +1754,29 @@ void	BGM_Device::DoIOOperation(AudioObjectID inStreamObjectID, UInt32 inClientID
 							kAudioDeviceCustomPropertyDeviceAudibleState, GetObjectID());
                 }
 
+                // Limit the mix if the apps' relative volumes weren't clipped in ProcessOutput. This
+                // delays the audio by the limiter's latency, which we report as the output stream's
+                // latency.
+                if(mBoostLimiterEnabled)
+                {
+                    mBoostLimiter.ProcessRT(reinterpret_cast<Float32*>(ioMainBuffer),
+                                            inIOBufferFrameSize);
+
+                    // The limiter's output lags its input, so it can still be releasing audio from
+                    // earlier cycles.
+                    theMixIsSilent =
+                            BGM_AudibleState::BufferIsSilent(inIOBufferFrameSize,
+                                                             reinterpret_cast<const Float32*>(ioMainBuffer));
+                }
+
                 // Copy the audio data into our ring buffer.
                 WriteOutputData(inIOBufferFrameSize,
                                 inIOCycleInfo.mOutputTime.mSampleTime,
-                                ioMainBuffer);
+                                ioMainBuffer,
+                                theMixIsSilent);
+
+                // Publish the audio the clients mixed into their capture taps this cycle.
+                mCaptureTaps.StoreRT(inIOBufferFrameSize, inIOCycleInfo.mOutputTime.mSampleTime);
             }
 			break;
 
@@ -1430,6 +1791,8 @@ void	BGM_Device::EndIOOperation(UInt32 inOperationID, UInt32 inIOBufferFrameSize
 {
     #pragma unused(inIOBufferFrameSize, inIOCycleInfo)
 
+    BGM_IOProfiler::Scope theProfilerScope(mIOProfiler, BGM_IOProfiler::kEndIOOperation);
+
     if(inOperationID == kAudioServerPlugInIOOperationThread)
     {
         // Tell BGM_Clients that this client has stopped IO. Queued async because we have to be real-time safe here.
@@ -1442,6 +1805,15 @@ void	BGM_Device::EndIOOperation(UInt32 inOperationID, UInt32 inIOBufferFrameSize
 
 void	BGM_Device::ReadInputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, void* outBuffer)
 {
+    // If WriteMix only received silence for these frames, it didn't store them in the ring buffer,
+    // so we can skip reading it.
+    if(inSampleTime >= mLoopbackSilence.startSampleTime &&
+       inSampleTime + inIOBufferFrameSize <= mLoopbackSilence.endSampleTime)
+    {
+        memset(outBuffer, 0, inIOBufferFrameSize * sizeof(Float32) * 2);
+        return;
+    }
+
     // Wrap the provided buffer in an AudioBufferList.
     AudioBufferList abl = {
         .mNumberBuffers = 1,
@@ -1479,8 +1851,47 @@ void	BGM_Device::ReadInputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime,
     }
 }
 
-void	BGM_Device::WriteOutputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, const void* inBuffer)
+void	BGM_Device::WriteOutputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, const void* inBuffer, bool inBufferIsSilent)
 {
+    // Mirror the data into shared memory for any processes reading it directly. This never waits
+    // for them. They read it without knowing about mLoopbackSilence, so it gets silent buffers as
+    // well.
+    if(mLoopbackSharedMemory != nullptr)
+    {
+        mLoopbackSharedMemory->Store(reinterpret_cast<const Float32*>(inBuffer),
+                                     inIOBufferFrameSize,
+                                     static_cast<SInt64>(inSampleTime));
+    }
+
+    CARingBuffer::SampleTime theRingStartTime = 0;
+    CARingBuffer::SampleTime theRingEndTime = 0;
+    bool theRingHasTimeBounds =
+            (mLoopbackRingBuffer.GetTimeBounds(theRingStartTime, theRingEndTime) == kCARingBufferError_OK);
+
+    // Record silent buffers as a silence span rather than copying zeros into the ring buffer. This
+    // only works while the sample times are moving forward. If they've gone back, storing the
+    // buffer makes the ring buffer throw out the audio it has for the later sample times.
+    if(inBufferIsSilent &&
+       theRingHasTimeBounds &&
+       inSampleTime >= static_cast<Float64>(theRingEndTime))
+    {
+        if(inSampleTime != mLoopbackSilence.endSampleTime)
+        {
+            // A new silence span.
+            mLoopbackSilence.startSampleTime = inSampleTime;
+        }
+
+        mLoopbackSilence.endSampleTime = inSampleTime + inIOBufferFrameSize;
+        return;
+    }
+
+    if(inSampleTime < mLoopbackSilence.endSampleTime)
+    {
+        // These frames overlap the silence span, so it's out of date.
+        mLoopbackSilence.startSampleTime = -1;
+        mLoopbackSilence.endSampleTime = -1;
+    }
+
     // Wrap the provided buffer in an AudioBufferList.
     AudioBufferList abl = {
         .mNumberBuffers = 1,
@@ -1509,49 +1920,84 @@ void	BGM_Device::WriteOutputData(UInt32 inIOBufferFrameSize, Float64 inSampleTim
 
 void	BGM_Device::ApplyClientRelativeVolume(UInt32 inClientID, UInt32 inIOBufferFrameSize, void* ioBuffer) const
 {
+    // The type the samples are converted to while the pan and volume are applied. See
+    // BGM_DOUBLE_PRECISION_GAIN in BGM_Device.h.
+#if BGM_DOUBLE_PRECISION_GAIN
+    typedef Float64 Sample;
+#else
+    typedef Float32 Sample;
+#endif
+
     Float32* theBuffer = reinterpret_cast<Float32*>(ioBuffer);
-    Float32 theRelativeVolume = mClients.GetClientRelativeVolumeRT(inClientID);
+    const Sample theRelativeVolume = mClients.GetClientRelativeVolumeRT(inClientID);
     
     auto thePanPositionInt = mClients.GetClientPanPositionRT(inClientID);
-    Float32 thePanPosition = static_cast<Float32>(thePanPositionInt) / 100.0f;
+    const Sample thePanPosition = static_cast<Sample>(thePanPositionInt) / 100;
+
+    if(theRelativeVolume == 1 && thePanPosition == 0)
+    {
+        return;
+    }
     
     // TODO When we get around to supporting devices with more than two channels it would be worth looking into
     //      kAudioFormatProperty_PanningMatrix and kAudioFormatProperty_BalanceFade in AudioFormat.h.
-    
-    // TODO precompute matrix coefficients w/ volume and do everything in one pass
-    
-    // Apply balance w/ crossfeed to the frames in the buffer.
+
+    // Apply balance w/ crossfeed and the relative volume in one pass, as a 2x2 matrix. Panning to
+    // the right attenuates the left channel and mixes the part it removes into the right channel,
+    // and vice versa.
+    const Sample thePanRight = thePanPosition > 0 ? thePanPosition : 0;
+    const Sample thePanLeft = thePanPosition < 0 ? -thePanPosition : 0;
+    const Sample theLeftToLeft = (1 - thePanRight) * theRelativeVolume;
+    const Sample theRightToLeft = thePanLeft * theRelativeVolume;
+    const Sample theLeftToRight = thePanRight * theRelativeVolume;
+    const Sample theRightToRight = (1 - thePanLeft) * theRelativeVolume;
+
+    // Don't clip the samples if the boost limiter is enabled. It will bring the mix back under full
+    // scale in WriteMix, which sounds much better than clipping.
+    const bool shouldClip = (theRelativeVolume != 1 && !mBoostLimiterEnabled);
+
     // Expect samples interleaved, starting with left
-    if (thePanPosition > 0.0f) {
-        for (UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2) {
-            auto L = i;
-            auto R = i + 1;
-            
-            theBuffer[R] = theBuffer[R] + theBuffer[L] * thePanPosition;
-            theBuffer[L] = theBuffer[L] * (1 - thePanPosition);
-        }
-    } else if (thePanPosition < 0.0f) {
-        for (UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2) {
-            auto L = i;
-            auto R = i + 1;
-            
-            theBuffer[L] = theBuffer[L] + theBuffer[R] * (-thePanPosition);
-            theBuffer[R] = theBuffer[R] * (1 + thePanPosition);
+#if BGM_DOUBLE_PRECISION_GAIN
+    if(!shouldClip)
+    {
+        for(UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2)
+        {
+            const Sample L = theBuffer[i];
+            const Sample R = theBuffer[i + 1];
+
+            theBuffer[i] = static_cast<Float32>(L * theLeftToLeft + R * theRightToLeft);
+            theBuffer[i + 1] = static_cast<Float32>(L * theLeftToRight + R * theRightToRight);
         }
     }
-
-    if(theRelativeVolume != 1.0f)
+    else
     {
-        for(UInt32 i = 0; i < inIOBufferFrameSize * 2; i++)
+        for(UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2)
         {
-            Float32 theAdjustedSample = theBuffer[i] * theRelativeVolume;
-            
+            const Sample L = theBuffer[i];
+            const Sample R = theBuffer[i + 1];
+            const Sample theAdjustedL = L * theLeftToLeft + R * theRightToLeft;
+            const Sample theAdjustedR = L * theLeftToRight + R * theRightToRight;
+
             // Clamp to [-1, 1].
             // (This way is roughly 6 times faster than using std::min and std::max because the compiler can vectorize the loop.)
-            const Float32 theAdjustedSampleClippedBelow = theAdjustedSample < -1.0f ? -1.0f : theAdjustedSample;
-            theBuffer[i] = theAdjustedSampleClippedBelow > 1.0f ? 1.0f : theAdjustedSampleClippedBelow;
+            const Sample theAdjustedLClippedBelow = theAdjustedL < -1 ? -1 : theAdjustedL;
+            const Sample theAdjustedRClippedBelow = theAdjustedR < -1 ? -1 : theAdjustedR;
+            theBuffer[i] = static_cast<Float32>(theAdjustedLClippedBelow > 1 ? 1 : theAdjustedLClippedBelow);
+            theBuffer[i + 1] = static_cast<Float32>(theAdjustedRClippedBelow > 1 ? 1 : theAdjustedRClippedBelow);
         }
     }
+#else
+    const BGM_DSP::StereoMatrix theMatrix { theLeftToLeft, theRightToLeft, theLeftToRight, theRightToRight };
+
+    if(shouldClip)
+    {
+        BGM_DSP::MixStereoAndClip(theBuffer, inIOBufferFrameSize, theMatrix, -1.0f, 1.0f);
+    }
+    else
+    {
+        BGM_DSP::MixStereo(theBuffer, inIOBufferFrameSize, theMatrix);
+    }
+#endif
 }
 
 #pragma mark Accessors
@@ -1590,6 +2036,27 @@ void    BGM_Device::RequestEnabledControls(bool inVolumeEnabled, bool inMuteEnab
     }
 }
 
+void    BGM_Device::RequestBoostLimiterEnabled(bool inEnabled)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(mBoostLimiterEnabled != inEnabled)
+    {
+        DebugMsg("BGM_Device::RequestBoostLimiterEnabled: %s the boost limiter",
+                 (inEnabled ? "Enabling" : "Disabling"));
+        mPendingBoostLimiterEnabled = inEnabled;
+
+        // Ask the host to stop IO so we can change the output stream's latency. See
+        // RequestDeviceConfigurationChange in AudioServerPlugIn.h.
+        AudioObjectID theDeviceObjectID = GetObjectID();
+        UInt64 action = static_cast<UInt64>(ChangeAction::SetBoostLimiterEnabled);
+
+        CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
+            BGM_PlugIn::Host_RequestDeviceConfigurationChange(theDeviceObjectID, action, nullptr);
+        });
+    }
+}
+
 Float64	BGM_Device::GetSampleRate() const
 {
     // The sample rate is guarded by the state lock. Note that we don't need to take the IO lock.
@@ -1735,6 +2202,44 @@ void    BGM_Device::SetEnabledControls(bool inVolumeEnabled, bool inMuteEnabled)
     }
 }
 
+void    BGM_Device::SetBoostLimiterEnabled(bool inEnabled)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(mBoostLimiterEnabled == inEnabled)
+    {
+        return;
+    }
+
+    DebugMsg("BGM_Device::SetBoostLimiterEnabled: %s the boost limiter",
+             inEnabled ? "Enabling" : "Disabling");
+
+    {
+        CAMutex::Locker theIOLocker(mIOMutex);
+
+        // Don't play whatever was left in the delay line when it was last disabled.
+        mBoostLimiter.Reset();
+        mBoostLimiterEnabled = inEnabled;
+    }
+
+    mOutputStream.SetLatency(inEnabled ? mBoostLimiter.GetLatencyFrames() : 0);
+
+    // Send notifications. The host rereads the stream's properties after a config change anyway,
+    // but BGMApp might be listening for the custom property.
+    AudioObjectID theDeviceObjectID = GetObjectID();
+    AudioObjectID theOutputStreamObjectID = mOutputStream.GetObjectID();
+
+    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
+        AudioObjectPropertyAddress theChangedProperties[] = { kBGMBoostLimiterAddress };
+        BGM_PlugIn::Host_PropertiesChanged(theDeviceObjectID, 1, theChangedProperties);
+
+        AudioObjectPropertyAddress theChangedStreamProperties[] = {
+            { kAudioStreamPropertyLatency, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster }
+        };
+        BGM_PlugIn::Host_PropertiesChanged(theOutputStreamObjectID, 1, theChangedStreamProperties);
+    });
+}
+
 void BGM_Device::SetSampleRate(Float64 inSampleRate, bool force)
 {
     // We try to support any sample rate a real output device might.
@@ -1766,9 +2271,24 @@ void BGM_Device::SetSampleRate(Float64 inSampleRate, bool force)
         mLoopbackSampleRate = inSampleRate;
         InitLoopback();
 
-        // Update the streams.
+        if(mLoopbackSharedMemory != nullptr)
+        {
+            mLoopbackSharedMemory->SetSampleRate(inSampleRate);
+        }
+
+        mCaptureTaps.SetSampleRate(inSampleRate);
+
+        {
+            CAMutex::Locker theIOLocker(mIOMutex);
+            mBoostLimiter.SetSampleRate(inSampleRate);
+            mDucker.SetSampleRate(inSampleRate);
+        }
+
+        // Update the streams. The limiter's look-ahead is a fixed time, so its latency in frames
+        // depends on the sample rate.
         mInputStream.SetSampleRate(inSampleRate);
         mOutputStream.SetSampleRate(inSampleRate);
+        mOutputStream.SetLatency(mBoostLimiterEnabled ? mBoostLimiter.GetLatencyFrames() : 0);
     }
     else
     {
@@ -1781,6 +2301,477 @@ bool    BGM_Device::IsStreamID(AudioObjectID inObjectID) const noexcept
     return (inObjectID == mInputStream.GetObjectID()) || (inObjectID == mOutputStream.GetObjectID());
 }
 
+bool    BGM_Device::SetLoopbackSharedMemoryEnabled(bool inEnabled)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(inEnabled == (mLoopbackSharedMemory != nullptr))
+    {
+        return false;
+    }
+
+    std::unique_ptr<BGM_LoopbackSharedMemory> theSharedMemory;
+
+    if(inEnabled)
+    {
+        // Readers map the segment once, so it can't be resized when the sample rate changes. Make
+        // it big enough for the highest standard rate (or the current rate, if that's higher).
+        const Float64 theCapacitySampleRate =
+                std::max(GetSampleRate(), kBGMStandardSampleRates[kBGMNumStandardSampleRates - 1]);
+
+        // Create the segment before taking the IO mutex because it isn't real-time safe and can
+        // take a while.
+        theSharedMemory.reset(new BGM_LoopbackSharedMemory);
+        theSharedMemory->Open(mLoopbackSegmentName.c_str(),
+                              2,
+                              BGM_LoopbackSharedMemory::GetCapacityFramesForSampleRate(
+                                      theCapacitySampleRate),
+                              GetSampleRate());
+    }
+
+    {
+        CAMutex::Locker theIOLocker(mIOMutex);
+        mLoopbackSharedMemory.swap(theSharedMemory);
+    }
+
+    DebugMsg("BGM_Device::SetLoopbackSharedMemoryEnabled: %s the loopback shared memory",
+             inEnabled ? "Enabled" : "Disabled");
+
+    // If we just disabled it, theSharedMemory now holds the old segment, which gets closed here,
+    // after we've released the IO mutex.
+    return true;
+}
+
+bool    BGM_Device::SetCaptureTaps(const CACFArray& inTaps)
+{
+    std::vector<CACFString> theBundleIDs;
+
+    for(UInt32 i = 0; i < inTaps.GetNumberItems(); i++)
+    {
+        CFDictionaryRef theTapRef = nullptr;
+        ThrowIf(!inTaps.GetDictionary(i, theTapRef) || theTapRef == nullptr,
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_Device::SetCaptureTaps: Tap wasn't a CFDictionary");
+
+        CACFDictionary theTap(theTapRef, false);
+        CACFString theBundleID;
+        theTap.GetCACFString(CFSTR(kBGMCaptureTapsKey_BundleID), theBundleID);
+
+        ThrowIf(!theBundleID.IsValid(),
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_Device::SetCaptureTaps: Tap has no bundle ID");
+
+        theBundleIDs.push_back(theBundleID);
+    }
+
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    // Untap the clients of apps that are being removed first, so they stop using the taps before
+    // their slots can be given to other apps.
+    std::map<CACFString, SInt32> theKeptTaps = mCaptureTaps.GetTapsByBundleID();
+
+    for(auto theTapItr = theKeptTaps.begin(); theTapItr != theKeptTaps.end(); )
+    {
+        bool isKept =
+                std::find(theBundleIDs.begin(), theBundleIDs.end(), theTapItr->first) != theBundleIDs.end();
+        theTapItr = (isKept ? std::next(theTapItr) : theKeptTaps.erase(theTapItr));
+    }
+
+    mClients.SetCaptureTaps(theKeptTaps);
+
+    bool didChangeTaps = false;
+
+    try
+    {
+        didChangeTaps = mCaptureTaps.SetTappedApps(theBundleIDs, GetSampleRate());
+    }
+    catch(...)
+    {
+        // Some taps might have been removed before it failed.
+        mClients.SetCaptureTaps(mCaptureTaps.GetTapsByBundleID());
+        throw;
+    }
+
+    mClients.SetCaptureTaps(mCaptureTaps.GetTapsByBundleID());
+
+    return didChangeTaps;
+}
+
+CFDictionaryRef    BGM_Device::CopyMusicDuckingSettings() const
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    const BGM_Ducker::Settings& theSettings = mDucker.GetSettings();
+    CACFDictionary theDict(true);
+
+    theDict.AddBool(CFSTR(kBGMMusicDuckingKey_Enabled), mMusicDuckingEnabled);
+    theDict.AddFloat32(CFSTR(kBGMMusicDuckingKey_Gain), theSettings.mGain);
+    theDict.AddFloat32(CFSTR(kBGMMusicDuckingKey_Threshold), theSettings.mThreshold);
+    theDict.AddFloat64(CFSTR(kBGMMusicDuckingKey_AttackSeconds), theSettings.mAttackSeconds);
+    theDict.AddFloat64(CFSTR(kBGMMusicDuckingKey_HoldSeconds), theSettings.mHoldSeconds);
+    theDict.AddFloat64(CFSTR(kBGMMusicDuckingKey_ReleaseSeconds), theSettings.mReleaseSeconds);
+
+    return theDict.CopyCFDictionary();
+}
+
+bool    BGM_Device::SetMusicDuckingSettings(const CACFDictionary& inSettings)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    // Start from the current settings so the caller only has to include the ones they're changing.
+    BGM_Ducker::Settings theSettings = mDucker.GetSettings();
+    bool theEnabled = mMusicDuckingEnabled;
+
+    inSettings.GetBool(CFSTR(kBGMMusicDuckingKey_Enabled), theEnabled);
+    inSettings.GetFloat32(CFSTR(kBGMMusicDuckingKey_Gain), theSettings.mGain);
+    inSettings.GetFloat32(CFSTR(kBGMMusicDuckingKey_Threshold), theSettings.mThreshold);
+    inSettings.GetFloat64(CFSTR(kBGMMusicDuckingKey_AttackSeconds), theSettings.mAttackSeconds);
+    inSettings.GetFloat64(CFSTR(kBGMMusicDuckingKey_HoldSeconds), theSettings.mHoldSeconds);
+    inSettings.GetFloat64(CFSTR(kBGMMusicDuckingKey_ReleaseSeconds), theSettings.mReleaseSeconds);
+
+    const BGM_Ducker::Settings& theOldSettings = mDucker.GetSettings();
+    bool didChange = (theEnabled != mMusicDuckingEnabled) ||
+            (theSettings.mGain != theOldSettings.mGain) ||
+            (theSettings.mThreshold != theOldSettings.mThreshold) ||
+            (theSettings.mAttackSeconds != theOldSettings.mAttackSeconds) ||
+            (theSettings.mHoldSeconds != theOldSettings.mHoldSeconds) ||
+            (theSettings.mReleaseSeconds != theOldSettings.mReleaseSeconds);
+
+    if(didChange)
+    {
+        CAMutex::Locker theIOLocker(mIOMutex);
+
+        // Throws without changing anything if the new settings are invalid.
+        mDucker.SetSettings(theSettings);
+
+        if(theEnabled != mMusicDuckingEnabled)
+        {
+            // Start from unity gain when ducking is enabled and don't leave old state around when
+            // it's disabled.
+            mDucker.Reset();
+            mMusicDuckingEnabled = theEnabled;
+        }
+
+        DebugMsg("BGM_Device::SetMusicDuckingSettings: Music ducking %s, gain=%f threshold=%f "
+                 "attack=%f hold=%f release=%f",
+                 theEnabled ? "enabled" : "disabled",
+                 theSettings.mGain,
+                 theSettings.mThreshold,
+                 theSettings.mAttackSeconds,
+                 theSettings.mHoldSeconds,
+                 theSettings.mReleaseSeconds);
+    }
+
+    return didChange;
+}
+
+CFDictionaryRef    BGM_Device::CopyIOTraceSettings() const
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    CACFDictionary theDict(true);
+    UInt64 theUsedBytes = 0;
+    UInt64 theDroppedRecords = 0;
+
+    {
+        CAMutex::Locker theIOLocker(mIOMutex);
+
+        if(mIOTrace)
+        {
+            theUsedBytes = mIOTrace->GetUsedBytes();
+            theDroppedRecords = mIOTrace->GetDroppedRecords();
+        }
+    }
+
+    theDict.AddBool(CFSTR(kBGMIOTraceKey_Enabled), mIOTraceEnabled);
+
+    if(mIOTracePath.IsValid())
+    {
+        theDict.AddString(CFSTR(kBGMIOTraceKey_Path), mIOTracePath.GetCFString());
+    }
+
+    theDict.AddBool(CFSTR(kBGMIOTraceKey_IncludeBuffers), mIOTraceIncludeBuffers);
+    theDict.AddUInt64(CFSTR(kBGMIOTraceKey_CapacityBytes), mIOTraceCapacityBytes);
+    theDict.AddUInt64(CFSTR(kBGMIOTraceKey_UsedBytes), theUsedBytes);
+    theDict.AddUInt64(CFSTR(kBGMIOTraceKey_DroppedRecords), theDroppedRecords);
+
+    return theDict.CopyCFDictionary();
+}
+
+bool    BGM_Device::SetIOTraceSettings(const CACFDictionary& inSettings)
+{
+    bool didChange;
+    // The trace we stopped recording, if any, which we write after releasing the mutexes.
+    std::unique_ptr<BGM_IOTraceRecorder> theFinishedTrace;
+
+    {
+        CAMutex::Locker theStateLocker(mStateMutex);
+
+        // Start from the current settings so the caller only has to include the ones they're
+        // changing. kBGMIOTraceKey_Path is ignored, since the driver chooses where traces are written.
+        bool theEnabled = mIOTraceEnabled;
+        bool theIncludeBuffers = mIOTraceIncludeBuffers;
+        UInt64 theCapacityBytes = mIOTraceCapacityBytes;
+
+        inSettings.GetBool(CFSTR(kBGMIOTraceKey_Enabled), theEnabled);
+        inSettings.GetBool(CFSTR(kBGMIOTraceKey_IncludeBuffers), theIncludeBuffers);
+        inSettings.GetUInt64(CFSTR(kBGMIOTraceKey_CapacityBytes), theCapacityBytes);
+
+        ThrowIf(theCapacityBytes < sizeof(BGMIOTraceFileHeader),
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_Device::SetIOTraceSettings: Capacity too small");
+        ThrowIf(theCapacityBytes > BGM_IOTraceRecorder::kMaxCapacityBytes,
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_Device::SetIOTraceSettings: Capacity too large");
+
+        didChange = (theEnabled != mIOTraceEnabled) ||
+                (theIncludeBuffers != mIOTraceIncludeBuffers) ||
+                (theCapacityBytes != mIOTraceCapacityBytes);
+
+        std::unique_ptr<BGM_IOTraceRecorder> theNewTrace;
+
+        if(theEnabled && !mIOTraceEnabled)
+        {
+            // Allocate the buffer and record the device's current state before taking the IO mutex,
+            // so IO isn't blocked while we do.
+            theNewTrace.reset(new BGM_IOTraceRecorder(static_cast<size_t>(theCapacityBytes),
+                                                      theIncludeBuffers,
+                                                      GetSampleRate()));
+            RecordInitialStateForIOTrace(*theNewTrace);
+        }
+
+        // The buffer settings are for the next trace, so they can be changed while recording.
+        mIOTraceIncludeBuffers = theIncludeBuffers;
+        mIOTraceCapacityBytes = theCapacityBytes;
+
+        if(theNewTrace)
+        {
+            CAMutex::Locker theIOLocker(mIOMutex);
+            mIOTrace.swap(theNewTrace);
+            mIOTraceEnabled = true;
+
+            DebugMsg("BGM_Device::SetIOTraceSettings: Started recording an IO trace");
+        }
+        else if(!theEnabled && mIOTraceEnabled)
+        {
+            CAMutex::Locker theIOLocker(mIOMutex);
+            mIOTraceEnabled = false;
+            mIOTrace.swap(theFinishedTrace);
+        }
+    }
+
+    if(theFinishedTrace)
+    {
+        WriteIOTrace(*theFinishedTrace);
+    }
+
+    return didChange;
+}
+
+void    BGM_Device::WriteIOTrace(const BGM_IOTraceRecorder& inTrace)
+{
+    const std::string theDirectory =
+            (mIOTraceDirectory != nullptr) ? mIOTraceDirectory : BGM_IOTraceRecorder::GetDefaultDirectory();
+
+    // Name the file after the device, e.g. "BGMDevice 2026-10-19 12.00.00.bgmtrace".
+    char theDeviceUID[256];
+    if(!CFStringGetCString(mDeviceUID, theDeviceUID, sizeof(theDeviceUID), kCFStringEncodingUTF8))
+    {
+        strlcpy(theDeviceUID, "BGMDevice", sizeof(theDeviceUID));
+    }
+
+    const std::string thePath = inTrace.WriteToNewFile(theDirectory, theDeviceUID);
+
+    DebugMsg("BGM_Device::WriteIOTrace: Wrote the IO trace to %s (%zu bytes, %llu records dropped)",
+             thePath.c_str(),
+             inTrace.GetUsedBytes(),
+             inTrace.GetDroppedRecords());
+
+    CACFString thePathString(thePath.c_str(), kCFStringEncodingUTF8);
+
+    CAMutex::Locker theStateLocker(mStateMutex);
+    mIOTracePath = thePathString.GetCFString();
+}
+
+// True if the property's data is a CF object, which has to be serialized to be recorded in an IO
+// trace. That's the case for all of the device's custom properties.
+static bool IsCFPropertyListProperty(AudioObjectPropertySelector inSelector)
+{
+    switch(inSelector)
+    {
+        case kAudioDeviceCustomPropertyMusicPlayerProcessID:
+        case kAudioDeviceCustomPropertyMusicPlayerBundleID:
+        case kAudioDeviceCustomPropertyAppVolumes:
+        case kAudioDeviceCustomPropertyEnabledOutputControls:
+        case kAudioDeviceCustomPropertyLoopbackSharedMemory:
+        case kAudioDeviceCustomPropertyCaptureTaps:
+        case kAudioDeviceCustomPropertyBoostLimiter:
+        case kAudioDeviceCustomPropertyMusicDucking:
+        case kAudioDeviceCustomPropertyIOProfile:
+        case kAudioDeviceCustomPropertyIOTrace:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+void    BGM_Device::RecordInitialStateForIOTrace(BGM_IOTraceRecorder& inTrace) const
+{
+    BGMAssert(mStateMutex.IsOwnedByCurrentThread(),
+              "BGM_Device::RecordInitialStateForIOTrace: Called without taking the state mutex");
+
+    // Records a custom property being set to its current value.
+    auto theRecordCurrentValue = [&](AudioObjectPropertySelector inSelector) {
+        const AudioObjectPropertyAddress theAddress = {
+            inSelector,
+            kAudioObjectPropertyScopeGlobal,
+            kAudioObjectPropertyElementMaster
+        };
+
+        CFPropertyListRef theValue = nullptr;
+        UInt32 theValueSize = 0;
+        Device_GetPropertyData(mObjectID,
+                               0,
+                               theAddress,
+                               0,
+                               nullptr,
+                               sizeof(CFPropertyListRef),
+                               theValueSize,
+                               &theValue);
+
+        CFDataRef theData = nullptr;
+
+        try
+        {
+            theData = BGM_IOTraceRecorder::CopySerializedPropertyList(theValue);
+        }
+        catch(...)
+        {
+            CFRelease(theValue);
+            throw;
+        }
+
+        inTrace.RecordSetProperty(mObjectID,
+                                  theAddress,
+                                  0,
+                                  true,
+                                  static_cast<UInt32>(CFDataGetLength(theData)),
+                                  CFDataGetBytePtr(theData));
+
+        CFRelease(theData);
+        CFRelease(theValue);
+    };
+
+    // The sample rate. When it's replayed, setting the property requests a config change, which is
+    // applied by the config change record, as it would be by the HAL.
+    const AudioObjectPropertyAddress theSampleRateAddress = {
+        kAudioDevicePropertyNominalSampleRate,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMaster
+    };
+    const Float64 theSampleRate = GetSampleRate();
+
+    inTrace.RecordSetProperty(mObjectID,
+                              theSampleRateAddress,
+                              0,
+                              false,
+                              sizeof(Float64),
+                              &theSampleRate);
+    inTrace.RecordConfigChange(static_cast<UInt64>(ChangeAction::SetSampleRate));
+
+    // The clients, which have to be added before the music player and app volumes are set so those
+    // apply to them.
+    for(const BGM_Client& theClient : mClients.GetClientsNonRT())
+    {
+        const AudioServerPlugInClientInfo theClientInfo = {
+            theClient.mClientID,
+            theClient.mProcessID,
+            theClient.mIsNativeEndian,
+            theClient.mBundleID.GetCFString()
+        };
+
+        inTrace.RecordAddClient(theClientInfo);
+
+        if(theClient.mDoingIO)
+        {
+            inTrace.RecordStartIO(theClient.mClientID);
+        }
+    }
+
+    // Setting either of the music player properties unsets the other, so only record the one that's
+    // set.
+    CACFString theMusicPlayerBundleID(mClients.CopyMusicPlayerBundleIDProperty());
+
+    theRecordCurrentValue((theMusicPlayerBundleID.GetLength() > 0) ?
+                                  kAudioDeviceCustomPropertyMusicPlayerBundleID :
+                                  kAudioDeviceCustomPropertyMusicPlayerProcessID);
+
+    // The other settable properties that affect the audio.
+    theRecordCurrentValue(kAudioDeviceCustomPropertyAppVolumes);
+    theRecordCurrentValue(kAudioDeviceCustomPropertyMusicDucking);
+    theRecordCurrentValue(kAudioDeviceCustomPropertyCaptureTaps);
+    theRecordCurrentValue(kAudioDeviceCustomPropertyEnabledOutputControls);
+    inTrace.RecordConfigChange(static_cast<UInt64>(ChangeAction::SetEnabledControls));
+    theRecordCurrentValue(kAudioDeviceCustomPropertyBoostLimiter);
+    inTrace.RecordConfigChange(static_cast<UInt64>(ChangeAction::SetBoostLimiterEnabled));
+}
+
+void    BGM_Device::RecordSetPropertyForIOTrace(AudioObjectID inObjectID,
+                                                pid_t inClientPID,
+                                                const AudioObjectPropertyAddress& inAddress,
+                                                UInt32 inDataSize,
+                                                const void* inData)
+{
+    // Setting the diagnostic properties doesn't change the audio, so there's no point replaying it.
+    if(!mIOTraceEnabled ||
+       inAddress.mSelector == kAudioDeviceCustomPropertyIOTrace ||
+       inAddress.mSelector == kAudioDeviceCustomPropertyIOProfile)
+    {
+        return;
+    }
+
+    // The property has already been set, so log any errors instead of throwing.
+    try
+    {
+        CFDataRef theSerializedData = nullptr;
+
+        // Serialize CF values before taking the IO mutex because it allocates. The size was checked
+        // when the property was set.
+        if(inObjectID == mObjectID && IsCFPropertyListProperty(inAddress.mSelector))
+        {
+            theSerializedData = BGM_IOTraceRecorder::CopySerializedPropertyList(
+                    *reinterpret_cast<const CFPropertyListRef*>(inData));
+        }
+
+        RecordForIOTrace([&](BGM_IOTraceRecorder& inTrace) {
+            if(theSerializedData != nullptr)
+            {
+                inTrace.RecordSetProperty(inObjectID,
+                                          inAddress,
+                                          inClientPID,
+                                          true,
+                                          static_cast<UInt32>(CFDataGetLength(theSerializedData)),
+                                          CFDataGetBytePtr(theSerializedData));
+            }
+            else
+            {
+                inTrace.RecordSetProperty(inObjectID, inAddress, inClientPID, false, inDataSize, inData);
+            }
+        });
+
+        if(theSerializedData != nullptr)
+        {
+            CFRelease(theSerializedData);
+        }
+    }
+    catch(...)
+    {
+        LogError("BGM_Device::RecordSetPropertyForIOTrace: Couldn't record setting property %u",
+                 inAddress.mSelector);
+    }
+}
+
 #pragma mark Hardware Accessors
 
 // TODO: Out of laziness, some of these hardware functions do more than their names suggest
@@ -1804,12 +2795,18 @@ kern_return_t	BGM_Device::_HW_StartIO()
     
     // Reset the loopback timing values
     mLoopbackTime.numberTimeStamps = 0;
-    mLoopbackTime.anchorHostTime = CAHostTimeBase::GetTheCurrentTime();
+    mLoopbackTime.anchorHostTime = BGM_PlugIn::Host_GetCurrentTime();
     // ...and the most-recent audible/silent sample times. mAudibleState is usually guarded by the
 	// IO mutex, but we haven't started IO yet (and this function can only be called by one thread
 	// at a time).
 	BGMAssert(mIOMutex.IsFree(), "BGM_Device::_HW_StartIO: IO mutex taken before starting IO");
     mAudibleState.Reset();
+    mLoopbackSilence.startSampleTime = -1;
+    mLoopbackSilence.endSampleTime = -1;
+    // The same goes for the boost limiter, which might still have audio from before IO stopped,
+    // and the ducker.
+    mBoostLimiter.Reset();
+    mDucker.Reset();
     
     return KERN_SUCCESS;
 }
@@ -1859,6 +2856,8 @@ void	BGM_Device::AddClient(const AudioServerPlugInClientInfo* inClientInfo)
     CAMutex::Locker theStateLocker(mStateMutex);
 
     mClients.AddClient(inClientInfo);
+
+    RecordForIOTrace([&](BGM_IOTraceRecorder& inTrace) { inTrace.RecordAddClient(*inClientInfo); });
 }
 
 void	BGM_Device::RemoveClient(const AudioServerPlugInClientInfo* inClientInfo)
@@ -1876,6 +2875,8 @@ void	BGM_Device::RemoveClient(const AudioServerPlugInClientInfo* inClientInfo)
     }
 
     mClients.RemoveClient(inClientInfo->mClientID);
+
+    RecordForIOTrace([&](BGM_IOTraceRecorder& inTrace) { inTrace.RecordRemoveClient(*inClientInfo); });
 }
 
 void	BGM_Device::PerformConfigChange(UInt64 inChangeAction, void* inChangeInfo)
@@ -1896,7 +2897,13 @@ void	BGM_Device::PerformConfigChange(UInt64 inChangeAction, void* inChangeInfo)
             SetEnabledControls(mPendingOutputVolumeControlEnabled,
                                mPendingOutputMuteControlEnabled);
             break;
+
+        case ChangeAction::SetBoostLimiterEnabled:
+            SetBoostLimiterEnabled(mPendingBoostLimiterEnabled);
+            break;
     }
+
+    RecordForIOTrace([&](BGM_IOTraceRecorder& inTrace) { inTrace.RecordConfigChange(inChangeAction); });
 }
 
 void	BGM_Device::AbortConfigChange(UInt64 inChangeAction, void* inChangeInfo)
@@ -37,6 +37,12 @@
 #include "BGM_Clients.h"
 #include "BGM_TaskQueue.h"
 #include "BGM_AudibleState.h"
+#include "BGM_CaptureTaps.h"
+#include "BGM_Ducker.h"
+#include "BGM_IOProfiler.h"
+#include "BGM_IOTraceRecorder.h"
+#include "BGM_Limiter.h"
+#include "BGM_LoopbackSharedMemory.h"
 #include "BGM_Stream.h"
 #include "BGM_VolumeControl.h"
 #include "BGM_MuteControl.h"
@@ -45,12 +51,31 @@
 #include "CAMutex.h"
 #include "CAVolumeCurve.h"
 #include "CARingBuffer.h"
+#include "CACFArray.h"
+#include "CACFString.h"
+
+// STL Includes
+#include <atomic>
+#include <memory>
+#include <string>
 
 // System Includes
 #include <CoreFoundation/CoreFoundation.h>
 #include <pthread.h>
 
 
+// If BGM_DOUBLE_PRECISION_GAIN is set to 1, ApplyClientRelativeVolume applies the clients' relative
+// volumes and pan positions in double precision, e.g. with
+//
+//     xcodebuild GCC_PREPROCESSOR_DEFINITIONS='$(inherited) BGM_DOUBLE_PRECISION_GAIN=1' ...
+//
+// BGMDevice's streams are still Float32, but each sample is only rounded once, after the crossfeed
+// and gain, instead of after each step. The Device.IOCycle benchmarks in BGM_BenchmarkTests show
+// what it costs.
+#ifndef BGM_DOUBLE_PRECISION_GAIN
+#define BGM_DOUBLE_PRECISION_GAIN 0
+#endif
+
 class BGM_Device
 :
 	public BGM_AbstractDevice
@@ -66,6 +91,17 @@ private:
     static void					StaticInitializer();
 
 protected:
+    /*!
+     The strings aren't retained, so they have to outlive the device.
+
+     @param inLoopbackSegmentName The name of the device's loopback shared memory segment. See
+                                  kAudioDeviceCustomPropertyLoopbackSharedMemory.
+     @param inCaptureTapSegmentNamePrefix The prefix for the names of the device's capture taps'
+                                          segments. See kAudioDeviceCustomPropertyCaptureTaps.
+     @param inIOTraceDirectory The directory to write IO traces to, or null for
+                               BGM_IOTraceRecorder::GetDefaultDirectory. See
+                               kAudioDeviceCustomPropertyIOTrace.
+     */
                                 BGM_Device(AudioObjectID inObjectID,
 										   const CFStringRef __nonnull inDeviceName,
                                            const CFStringRef __nonnull inDeviceUID,
@@ -73,9 +109,16 @@ protected:
                                            AudioObjectID inInputStreamID,
                                            AudioObjectID inOutputStreamID,
                                            AudioObjectID inOutputVolumeControlID,
-										   AudioObjectID inOutputMuteControlID);
+										   AudioObjectID inOutputMuteControlID,
+                                           const char* __nonnull inLoopbackSegmentName = kBGMLoopbackSegmentName,
+                                           const char* __nonnull inCaptureTapSegmentNamePrefix = kBGMCaptureTapSegmentNamePrefix,
+                                           const char* __nullable inIOTraceDirectory = nullptr);
     virtual						~BGM_Device();
-    
+
+public:
+    virtual void                RegisterObjects();
+
+protected:
     virtual void				Activate();
     virtual void				Deactivate();
     
@@ -103,8 +146,11 @@ private:
 #pragma mark IO Operations
     
 public:
+    /*! @throws CAException kAudioHardwareIllegalOperationError if the device has been deactivated. */
 	void						StartIO(UInt32 inClientID);
 	void						StopIO(UInt32 inClientID);
+    /*! @return True if any clients have started IO and haven't stopped it yet. */
+    bool                        IsRunningIO() const;
     
 	void						GetZeroTimeStamp(Float64& outSampleTime, UInt64& outHostTime, UInt64& outSeed);
 	
@@ -115,7 +161,7 @@ public:
 
 private:
 	void						ReadInputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, void* __nonnull outBuffer);
-    void						WriteOutputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, const void* __nonnull inBuffer);
+    void						WriteOutputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, const void* __nonnull inBuffer, bool inBufferIsSilent);
     void                        ApplyClientRelativeVolume(UInt32 inClientID, UInt32 inIOBufferFrameSize, void* __nonnull inBuffer) const;
 
 #pragma mark Accessors
@@ -128,6 +174,12 @@ public:
 	 See BGM_Device::PerformConfigChange and RequestDeviceConfigurationChange in AudioServerPlugIn.h.
 	 */
     void                        RequestEnabledControls(bool inVolumeEnabled, bool inMuteEnabled);
+    /*!
+     Enable or disable the limiter for boosted app volumes. See
+     kAudioDeviceCustomPropertyBoostLimiter. Async for the same reason as RequestEnabledControls:
+     changing it changes the output stream's latency, so the host has to stop IO first.
+     */
+    void                        RequestBoostLimiterEnabled(bool inEnabled);
 
     Float64						GetSampleRate() const;
     void                        RequestSampleRate(Float64 inRequestedSampleRate);
@@ -157,6 +209,13 @@ private:
      RequestDeviceConfigurationChange in AudioServerPlugIn.h.
      */
     void                        SetEnabledControls(bool inVolumeEnabled, bool inMuteEnabled);
+    /*!
+     Enable or disable the limiter for boosted app volumes and update the output stream's latency.
+
+     Private because this can only be called after asking the host to stop IO for the device. See
+     BGM_Device::RequestBoostLimiterEnabled and BGM_Device::PerformConfigChange.
+     */
+    void                        SetBoostLimiterEnabled(bool inEnabled);
     /*!
      Set the device's sample rate.
 
@@ -175,6 +234,81 @@ private:
     /*! @return True if inObjectID is the ID of one of this device's streams. */
     inline bool                 IsStreamID(AudioObjectID inObjectID) const noexcept;
 
+    /*!
+     Start or stop mirroring the loopback audio into shared memory. See
+     kAudioDeviceCustomPropertyLoopbackSharedMemory.
+
+     @return True if the value of kAudioDeviceCustomPropertyLoopbackSharedMemory changed.
+     @throws CAException if the shared memory segment can't be created.
+     */
+    bool                        SetLoopbackSharedMemoryEnabled(bool inEnabled);
+
+    /*!
+     Replace the set of apps with capture taps. See kAudioDeviceCustomPropertyCaptureTaps.
+
+     @param inTaps An array of dictionaries with the key kBGMCaptureTapsKey_BundleID.
+     @return True if the value of kAudioDeviceCustomPropertyCaptureTaps changed.
+     @throws CAException if inTaps is invalid, has too many apps or a segment can't be created.
+     */
+    bool                        SetCaptureTaps(const CACFArray& inTaps);
+
+    /*! @return The value of kAudioDeviceCustomPropertyMusicDucking. The caller must release it. */
+    CFDictionaryRef __nonnull   CopyMusicDuckingSettings() const;
+    /*!
+     Update the settings for ducking the music player. See kAudioDeviceCustomPropertyMusicDucking.
+
+     @param inSettings A dictionary with any of the kBGMMusicDuckingKey keys.
+     @return True if the value of kAudioDeviceCustomPropertyMusicDucking changed.
+     @throws CAException if any of the settings are invalid, in which case none are changed.
+     */
+    bool                        SetMusicDuckingSettings(const CACFDictionary& inSettings);
+
+    /*! @return The value of kAudioDeviceCustomPropertyIOTrace. The caller must release it. */
+    CFDictionaryRef __nonnull   CopyIOTraceSettings() const;
+    /*!
+     Start or stop recording an IO trace, or change the settings for the next one. See
+     kAudioDeviceCustomPropertyIOTrace.
+
+     @param inSettings A dictionary with any of the kBGMIOTraceKey keys.
+     @return True if the value of kAudioDeviceCustomPropertyIOTrace changed.
+     @throws CAException if the settings are invalid, in which case none are changed, or if the
+             trace can't be written to a file, in which case recording stops anyway.
+     */
+    bool                        SetIOTraceSettings(const CACFDictionary& inSettings);
+    /*!
+     Write a finished trace to a new file and remember its path for kBGMIOTraceKey_Path. Must be
+     called without holding the state or IO mutexes, since writing the file can take a while.
+     */
+    void                        WriteIOTrace(const BGM_IOTraceRecorder& inTrace);
+    /*!
+     Record the calls that would recreate the device's current state, e.g. adding its current
+     clients, into a new IO trace. Must be called while holding the state mutex.
+     */
+    void                        RecordInitialStateForIOTrace(BGM_IOTraceRecorder& inTrace) const;
+    /*! Record a property being set in the IO trace, if one is being recorded. Never throws. */
+    void                        RecordSetPropertyForIOTrace(AudioObjectID inObjectID,
+                                                            pid_t inClientPID,
+                                                            const AudioObjectPropertyAddress& inAddress,
+                                                            UInt32 inDataSize,
+                                                            const void* __nonnull inData);
+    /*!
+     Call inRecord with the IO trace while holding the IO mutex, if one is being recorded. Not for
+     the IO functions, which have to use BGM_IOProfiler::Locker.
+     */
+    template<typename RecordFunction>
+    void                        RecordForIOTrace(RecordFunction inRecord)
+                                {
+                                    if(mIOTraceEnabled)
+                                    {
+                                        CAMutex::Locker theIOLocker(mIOMutex);
+
+                                        if(mIOTrace)
+                                        {
+                                            inRecord(*mIOTrace);
+                                        }
+                                    }
+                                }
+
 #pragma mark Hardware Accessors
     
 private:
@@ -200,7 +334,13 @@ public:
     /*! Cancel a change requested with BGM_PlugIn::Host_RequestDeviceConfigurationChange. */
 	void						AbortConfigChange(UInt64 inChangeAction, void* __nullable inChangeInfo);
 
+    /*! True if the device was created by BGM_DynamicDevices, rather than being BGMDevice or the UI sounds device. */
+    bool                        IsDynamic() const { return GetObjectID() >= kObjectID_FirstDynamic; }
+
 private:
+    // Creates and destroys the dynamic devices.
+    friend class                BGM_DynamicDevices;
+
     static pthread_once_t		sStaticInitializer;
     static BGM_Device* __nonnull    sInstance;
     static BGM_Device* __nonnull    sUISoundsInstance;
@@ -237,9 +377,30 @@ private:
     
     BGM_Clients                 mClients;
     
-    #define kLoopbackRingBufferFrameSize    16384
+    // The size of the loopback ring buffer at 48 kHz and lower sample rates. At higher rates it's
+    // scaled up to hold the same length of audio. (It's also the zero time stamp period.) See
+    // BGM_LoopbackSharedMemory::GetCapacityFramesForSampleRate.
+    #define kLoopbackRingBufferFrameSize    BGM_LoopbackSharedMemory::kMinCapacityFrames
     Float64                     mLoopbackSampleRate;
+    UInt32                      mLoopbackRingBufferFrameSize = kLoopbackRingBufferFrameSize;
     CARingBuffer                mLoopbackRingBuffer;
+    // The sample times, from start (inclusive) to end (exclusive), of the latest run of silent
+    // mixes. WriteOutputData records them here instead of storing zeros in mLoopbackRingBuffer,
+    // and ReadInputData returns silence for them without reading the ring buffer. When audio is
+    // stored after a silence span, the ring buffer fills the frames it skipped with zeros itself.
+    // Guarded by the IO mutex.
+    struct {
+        Float64                 startSampleTime = -1;
+        Float64                 endSampleTime   = -1;
+    }                           mLoopbackSilence;
+    // A copy of the loopback audio for processes that read it directly, rather than through our
+    // input stream. Null unless kAudioDeviceCustomPropertyLoopbackSharedMemory is true. Guarded by
+    // both the state and IO mutexes when setting and either when reading.
+    std::unique_ptr<BGM_LoopbackSharedMemory> mLoopbackSharedMemory;
+    const std::string           mLoopbackSegmentName;
+    // Per-app copies of the clients' audio. See kAudioDeviceCustomPropertyCaptureTaps. Has its own
+    // locks, but is only changed while holding the state mutex.
+    BGM_CaptureTaps             mCaptureTaps;
 
     // TODO: a comment explaining why we need a clock for loopback-only mode
     struct {
@@ -253,10 +414,42 @@ private:
 
     BGM_AudibleState            mAudibleState;
 
+    // Limits the mixed output when kAudioDeviceCustomPropertyBoostLimiter is true, so app volumes
+    // above 100% don't clip. Guarded by the IO mutex. mBoostLimiterEnabled is only changed while IO
+    // is stopped, but it's read without the IO mutex in ApplyClientRelativeVolume.
+    BGM_Limiter                 mBoostLimiter;
+    std::atomic<bool>           mBoostLimiterEnabled { false };
+    bool                        mPendingBoostLimiterEnabled = false;
+
+    // Ducks the music player while other clients are playing audio, using the levels measured by
+    // mAudibleState. See kAudioDeviceCustomPropertyMusicDucking. Guarded by the IO mutex. Only
+    // changed while also holding the state mutex, so either is enough for reading its settings.
+    BGM_Ducker                  mDucker;
+    std::atomic<bool>           mMusicDuckingEnabled { false };
+
+    // Times the IO operations, if BGMDriver is built with BGM_IO_PROFILING=1. Otherwise it's empty.
+    // See kAudioDeviceCustomPropertyIOProfile.
+    BGM_IOProfiler              mIOProfiler;
+
+    // Records the calls the HAL makes to the device while kAudioDeviceCustomPropertyIOTrace is
+    // enabled. Null otherwise. Guarded by the IO mutex and only changed while also holding the state
+    // mutex. mIOTraceEnabled lets the IO functions skip taking the IO mutex when it's null. The
+    // settings are guarded by the state mutex.
+    std::unique_ptr<BGM_IOTraceRecorder> mIOTrace;
+    std::atomic<bool>           mIOTraceEnabled { false };
+    // Null to use BGM_IOTraceRecorder::GetDefaultDirectory. Clients can't choose where traces are
+    // written.
+    const char* __nullable      mIOTraceDirectory;
+    // The path of the last trace written.
+    CACFString                  mIOTracePath;
+    bool                        mIOTraceIncludeBuffers = false;
+    UInt64                      mIOTraceCapacityBytes = BGM_IOTraceRecorder::kDefaultCapacityBytes;
+
     enum class ChangeAction : UInt64
     {
         SetSampleRate,
-        SetEnabledControls
+        SetEnabledControls,
+        SetBoostLimiterEnabled
     };
 
     BGM_VolumeControl			mVolumeControl;
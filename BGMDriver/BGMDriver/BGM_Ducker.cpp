@@ -0,0 +1,184 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_Ducker.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_Ducker.h"
+
+// Local Includes
+#include "BGM_DSP.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <cmath>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+
+
+#pragma clang assume_nonnull begin
+
+// Moves ioGain one step toward inTarget. Lands exactly on inTarget at the end of the ramp, rather
+// than overshooting it or stopping just short because of rounding errors.
+static inline Float32 StepToward(Float32 inGain, Float32 inTarget, Float32 inStep)
+{
+    if(inGain > inTarget)
+    {
+        const Float32 theGain = inGain - inStep;
+        return (theGain - inTarget < 0.5f * inStep) ? inTarget : theGain;
+    }
+
+    const Float32 theGain = inGain + inStep;
+    return (inTarget - theGain < 0.5f * inStep) ? inTarget : theGain;
+}
+
+BGM_Ducker::BGM_Ducker(Float64 inSampleRate)
+{
+    SetSampleRate(inSampleRate);
+}
+
+void    BGM_Ducker::SetSettings(const Settings& inSettings)
+{
+    ThrowIf(!(inSettings.mGain >= 0.0f && inSettings.mGain <= 1.0f),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_Ducker::SetSettings: Gain out of range");
+    ThrowIf(!(inSettings.mThreshold > 0.0f),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_Ducker::SetSettings: Threshold out of range");
+    ThrowIf(!(inSettings.mAttackSeconds >= 0.0 && inSettings.mAttackSeconds <= kMaxTimeSeconds) ||
+                !(inSettings.mHoldSeconds >= 0.0 && inSettings.mHoldSeconds <= kMaxTimeSeconds) ||
+                !(inSettings.mReleaseSeconds >= 0.0 && inSettings.mReleaseSeconds <= kMaxTimeSeconds),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_Ducker::SetSettings: Time out of range");
+
+    mSettings = inSettings;
+    UpdateFrameCounts();
+}
+
+void    BGM_Ducker::SetSampleRate(Float64 inSampleRate)
+{
+    ThrowIf(!(inSampleRate >= 1.0),
+            CAException(kAudioDeviceUnsupportedFormatError),
+            "BGM_Ducker::SetSampleRate: Invalid sample rate");
+
+    mSampleRate = inSampleRate;
+    UpdateFrameCounts();
+}
+
+void    BGM_Ducker::UpdateFrameCounts()
+{
+    const Float64 theAttackFrames = std::round(mSettings.mAttackSeconds * mSampleRate);
+    const Float64 theReleaseFrames = std::round(mSettings.mReleaseSeconds * mSampleRate);
+    const Float32 theRange = 1.0f - mSettings.mGain;
+
+    // With no attack or release time, the gain jumps straight to the target.
+    mAttackStep = (theAttackFrames >= 1.0) ? static_cast<Float32>(theRange / theAttackFrames) : 1.0f;
+    mReleaseStep = (theReleaseFrames >= 1.0) ? static_cast<Float32>(theRange / theReleaseFrames) : 1.0f;
+    mHoldFrames = static_cast<UInt64>(std::round(mSettings.mHoldSeconds * mSampleRate));
+
+    // If the range is 0, i.e. ducking to a gain of 1, the gain never needs to change.
+    if(theRange <= 0.0f)
+    {
+        mAttackStep = mReleaseStep = 1.0f;
+    }
+}
+
+void    BGM_Ducker::Reset() noexcept
+{
+    mGain = 1.0f;
+    mHoldFramesLeft = 0;
+    mCycleSampleTime = -1.0;
+    mCycleStartGain = 1.0f;
+    mCycleStartHoldFramesLeft = 0;
+}
+
+void    BGM_Ducker::ProcessRT(Float32 inSidechainPeak,
+                              Float64 inOutputSampleTime,
+                              UInt32 inIOBufferFrameSize,
+                              Float32* ioBuffer) noexcept
+{
+    if(inOutputSampleTime == mCycleSampleTime)
+    {
+        // Another of the music player's clients in the same cycle. Start from the same envelope.
+        mGain = mCycleStartGain;
+        mHoldFramesLeft = mCycleStartHoldFramesLeft;
+    }
+    else
+    {
+        mCycleSampleTime = inOutputSampleTime;
+        mCycleStartGain = mGain;
+        mCycleStartHoldFramesLeft = mHoldFramesLeft;
+    }
+
+    const bool isTriggered = (inSidechainPeak >= mSettings.mThreshold);
+    const Float32 theDuckedGain = mSettings.mGain;
+
+    if(isTriggered)
+    {
+        // Hold the gain down until mHoldFrames frames after the other audio stops.
+        mHoldFramesLeft = mHoldFrames;
+    }
+
+    // In the steady states, the gain is the same for every frame, so we can skip the envelope and
+    // apply it to the whole buffer at once.
+    if(isTriggered && mGain == theDuckedGain)
+    {
+        BGM_DSP::Scale(ioBuffer, inIOBufferFrameSize * 2, mGain);
+        return;
+    }
+    else if(!isTriggered && mGain == 1.0f)
+    {
+        mHoldFramesLeft = 0;
+        return;
+    }
+
+    // Update the envelope before applying it to each frame, so the attack, hold and release take
+    // exactly as many frames as they're set to. E.g. with no attack time, the first frame is ducked.
+    for(UInt32 i = 0; i < inIOBufferFrameSize; i++)
+    {
+        if(isTriggered)
+        {
+            // Attack. (Or release, if the ducked gain has been raised since the gain went down.)
+            if(mGain != theDuckedGain)
+            {
+                mGain = StepToward(mGain,
+                                   theDuckedGain,
+                                   (mGain > theDuckedGain) ? mAttackStep : mReleaseStep);
+            }
+        }
+        else if(mHoldFramesLeft > 0)
+        {
+            mHoldFramesLeft--;
+        }
+        else if(mGain != 1.0f)
+        {
+            mGain = StepToward(mGain, 1.0f, mReleaseStep);
+        }
+
+        ioBuffer[i * 2] *= mGain;
+        ioBuffer[(i * 2) + 1] *= mGain;
+    }
+}
+
+#pragma clang assume_nonnull end
+
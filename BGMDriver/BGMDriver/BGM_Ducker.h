@@ -0,0 +1,129 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_Ducker.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Turns the music player's volume down while other apps are playing audio. This is the
+//  driver-side alternative to BGMApp pausing the music player. See
+//  kAudioDeviceCustomPropertyMusicDucking.
+//
+//  The sidechain is the peak level of the other clients' audio, which BGM_AudibleState measures
+//  each IO cycle. When it's over the threshold, the music player's gain ramps down to the ducked
+//  gain over the attack time. When it drops below the threshold, the gain stays down for the hold
+//  time and then ramps back up over the release time. The gain changes sample by sample, so the
+//  music starts ducking in the first IO cycle after the other audio starts (or the same cycle, if
+//  the HAL happens to process the other clients first).
+//
+//  Not thread-safe. BGM_Device only uses it while holding its IO mutex.
+//
+
+#ifndef BGMDriver__BGM_Ducker
+#define BGMDriver__BGM_Ducker
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_Ducker
+{
+
+public:
+    struct Settings
+    {
+        // The gain to duck the music to, from 0 (silent) to 1 (not ducked).
+        Float32                 mGain = 0.25f;
+        // The peak level of the other clients' audio that causes ducking.
+        Float32                 mThreshold = 0.001f;
+        Float64                 mAttackSeconds = 0.02;
+        Float64                 mHoldSeconds = 0.5;
+        Float64                 mReleaseSeconds = 1.0;
+    };
+
+    // The longest attack, hold or release time allowed, in seconds.
+    static const UInt32         kMaxTimeSeconds = 60;
+
+    /*! @throws CAException if the sample rate is invalid. */
+                                BGM_Ducker(Float64 inSampleRate);
+
+    /*! @throws CAException if any of the settings are out of range. */
+    void                        SetSettings(const Settings& inSettings);
+    const Settings&             GetSettings() const noexcept { return mSettings; }
+
+    /*!
+     The attack, hold and release times are converted to frames, so they're updated when the sample
+     rate changes. Doesn't reset the ducker.
+
+     @throws CAException if the sample rate is invalid.
+     */
+    void                        SetSampleRate(Float64 inSampleRate);
+
+    /*! Stop ducking immediately and forget the previous IO. */
+    void                        Reset() noexcept;
+
+    /*! The gain applied to the last frame processed. */
+    Float32                     GetGain() const noexcept { return mGain; }
+
+    /*!
+     Duck a buffer of the music player's audio in place.
+
+     If the music player has more than one client, each of their buffers for an IO cycle gets the
+     same gains. (Clients in the same cycle have the same output sample time.)
+
+     Real-time safe.
+
+     @param inSidechainPeak The peak level of the other clients' audio for this IO cycle. See
+                            BGM_AudibleState::GetNonMusicPeak.
+     @param inOutputSampleTime The sample time of the first frame in the buffer.
+     @param inIOBufferFrameSize The number of frames in the buffer.
+     @param ioBuffer The audio, as two interleaved Float32 channels.
+     */
+    void                        ProcessRT(Float32 inSidechainPeak,
+                                          Float64 inOutputSampleTime,
+                                          UInt32 inIOBufferFrameSize,
+                                          Float32* ioBuffer) noexcept;
+
+private:
+    void                        UpdateFrameCounts();
+
+    Settings                    mSettings;
+    Float64                     mSampleRate = 0.0;
+
+    // How much the gain changes each frame during the attack and release.
+    Float32                     mAttackStep = 0.0f;
+    Float32                     mReleaseStep = 0.0f;
+    UInt64                      mHoldFrames = 0;
+
+    // The current envelope.
+    Float32                     mGain = 1.0f;
+    UInt64                      mHoldFramesLeft = 0;
+
+    // The envelope at the start of the last IO cycle, so the music player's other clients in the
+    // same cycle can be ducked the same way.
+    Float64                     mCycleSampleTime = -1.0;
+    Float32                     mCycleStartGain = 1.0f;
+    UInt64                      mCycleStartHoldFramesLeft = 0;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_Ducker */
+
@@ -0,0 +1,402 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_DynamicDevices.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_DynamicDevices.h"
+
+// Local Includes
+#include "BGM_Device.h"
+#include "BGM_LoopbackLayout.h"
+#include "BGM_ObjectRegistry.h"
+
+// PublicUtility Includes
+#include "CACFArray.h"
+#include "CACFDictionary.h"
+#include "CAException.h"
+#include "CADebugMacros.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+#pragma clang assume_nonnull begin
+
+static_assert(kObjectID_FirstDynamic + (kBGMMaxDynamicDevices * kBGMDynamicDeviceObjectIDs) <=
+                      BGM_ObjectRegistry::kMaxObjects,
+              "The dynamic devices' object IDs don't fit in the object registry");
+
+static std::string FormatSegmentName(const char* inFormat, UInt32 inSlot)
+{
+    char theName[64];
+    snprintf(theName, sizeof(theName), inFormat, inSlot);
+    return theName;
+}
+
+BGM_DynamicDevices::~BGM_DynamicDevices()
+{
+    for(Slot& theSlot : mSlots)
+    {
+        if(theSlot.mDevice != nullptr)
+        {
+            BGM_ObjectRegistry::UnregisterOwner(*theSlot.mDevice);
+
+            if(theSlot.mState == SlotState::Active)
+            {
+                theSlot.mDevice->Deactivate();
+            }
+        }
+    }
+
+    BGM_ObjectRegistry::WaitForCallsToFinish();
+
+    for(Slot& theSlot : mSlots)
+    {
+        delete theSlot.mDevice;
+    }
+}
+
+#pragma mark Devices
+
+bool    BGM_DynamicDevices::SetDevices(CFArrayRef inDevices)
+{
+    CACFArray theDevices(inDevices, false);
+    std::vector<CACFString> theUIDs;
+    std::vector<CACFString> theNames;
+
+    // Check the whole list before changing anything.
+    ThrowIf(theDevices.GetNumberItems() > kBGMMaxDynamicDevices,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_DynamicDevices::SetDevices: Too many devices");
+
+    for(UInt32 i = 0; i < theDevices.GetNumberItems(); i++)
+    {
+        CFDictionaryRef theDeviceRef = nullptr;
+        ThrowIf(!theDevices.GetDictionary(i, theDeviceRef) || theDeviceRef == nullptr,
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_DynamicDevices::SetDevices: Device wasn't a CFDictionary");
+
+        CACFDictionary theDevice(theDeviceRef, false);
+        CACFString theUID;
+        CACFString theName;
+        theDevice.GetCACFString(CFSTR(kBGMDynamicDeviceKey_UID), theUID);
+        theDevice.GetCACFString(CFSTR(kBGMDynamicDeviceKey_Name), theName);
+
+        ThrowIf(!theUID.IsValid() || theUID.GetLength() == 0,
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_DynamicDevices::SetDevices: Device has no UID");
+        ThrowIf(IsBuiltInUID(theUID),
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_DynamicDevices::SetDevices: Device UID belongs to a built-in device");
+        ThrowIf(std::find(theUIDs.begin(), theUIDs.end(), theUID) != theUIDs.end(),
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_DynamicDevices::SetDevices: Duplicate device UID");
+
+        theUIDs.push_back(theUID);
+        theNames.push_back((theName.IsValid() && theName.GetLength() > 0) ? theName : theUID);
+    }
+
+    CAMutex::Locker theLocker(mMutex);
+
+    // Work out which devices are being kept. A device whose name changed is replaced, since a
+    // device's name can't change after it's been created.
+    bool isKept[kBGMMaxDynamicDevices] = {};
+    std::vector<bool> isNew(theUIDs.size(), true);
+    UInt32 theNumberOfNewDevices = 0;
+    UInt32 theNumberOfFreeSlots = 0;
+
+    for(size_t i = 0; i < theUIDs.size(); i++)
+    {
+        for(UInt32 theSlot = 0; theSlot < kBGMMaxDynamicDevices; theSlot++)
+        {
+            if(mSlots[theSlot].mState == SlotState::Active &&
+               mSlots[theSlot].mUID == theUIDs[i] &&
+               mSlots[theSlot].mName == theNames[i])
+            {
+                isKept[theSlot] = true;
+                isNew[i] = false;
+                break;
+            }
+        }
+
+        theNumberOfNewDevices += isNew[i] ? 1 : 0;
+    }
+
+    for(const Slot& theSlot : mSlots)
+    {
+        theNumberOfFreeSlots += (theSlot.mState == SlotState::Free) ? 1 : 0;
+    }
+
+    // Retired devices keep their slots until they've been deleted.
+    ThrowIf(theNumberOfNewDevices > theNumberOfFreeSlots,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_DynamicDevices::SetDevices: Not enough free slots");
+
+    // Create the new devices before retiring the old ones, so if creating one fails, the devices
+    // are left as they were.
+    std::vector<UInt32> theNewSlots;
+
+    try
+    {
+        UInt32 theSlot = 0;
+
+        for(size_t i = 0; i < theUIDs.size(); i++)
+        {
+            if(isNew[i])
+            {
+                while(mSlots[theSlot].mState != SlotState::Free)
+                {
+                    theSlot++;
+                }
+
+                mSlots[theSlot].mUID = theUIDs[i];
+                mSlots[theSlot].mName = theNames[i];
+                CreateDevice(theSlot);
+                theNewSlots.push_back(theSlot);
+
+                DebugMsg("BGM_DynamicDevices::SetDevices: Created device %u",
+                         mSlots[theSlot].mDevice->GetObjectID());
+            }
+        }
+    }
+    catch(...)
+    {
+        LogError("BGM_DynamicDevices::SetDevices: Failed to create a device");
+
+        // The new devices are already in the registry, so the HAL could be using them. Retire them
+        // instead of deleting them here, so DeleteRetiredDevices can wait for any calls using them
+        // to return. (Waiting here would deadlock, since this runs during a call from the HAL.)
+        for(UInt32 theSlot : theNewSlots)
+        {
+            mSlots[theSlot].mDevice->Deactivate();
+            mSlots[theSlot].mState = SlotState::Retired;
+        }
+
+        // Clear the strings from the slot CreateDevice failed for, unless it retired a device there.
+        for(Slot& theSlot : mSlots)
+        {
+            if(theSlot.mState == SlotState::Free)
+            {
+                theSlot = Slot();
+            }
+        }
+
+        throw;
+    }
+
+    // Retire the devices that aren't in the new list.
+    bool didRetireDevices = false;
+
+    for(UInt32 theSlot = 0; theSlot < kBGMMaxDynamicDevices; theSlot++)
+    {
+        if(mSlots[theSlot].mState == SlotState::Active &&
+           !isKept[theSlot] &&
+           std::find(theNewSlots.begin(), theNewSlots.end(), theSlot) == theNewSlots.end())
+        {
+            DebugMsg("BGM_DynamicDevices::SetDevices: Retiring device %u",
+                     mSlots[theSlot].mDevice->GetObjectID());
+
+            // Leave the device in the registry, so the HAL can still stop IO on it. Deactivating it
+            // stops it starting IO again.
+            mSlots[theSlot].mDevice->Deactivate();
+            mSlots[theSlot].mState = SlotState::Retired;
+            didRetireDevices = true;
+        }
+    }
+
+    return !theNewSlots.empty() || didRetireDevices;
+}
+
+void    BGM_DynamicDevices::CreateDevice(UInt32 inSlot)
+{
+    Slot& theSlot = mSlots[inSlot];
+
+    // The device copies the segment names.
+    theSlot.mDevice =
+            new BGM_Device(GetObjectID(inSlot, kBGMDynamicDeviceObjectIDOffset_Device),
+                           theSlot.mName.GetCFString(),
+                           theSlot.mUID.GetCFString(),
+                           CFSTR(kBGMDeviceModelUID),
+                           GetObjectID(inSlot, kBGMDynamicDeviceObjectIDOffset_Stream_Input),
+                           GetObjectID(inSlot, kBGMDynamicDeviceObjectIDOffset_Stream_Output),
+                           GetObjectID(inSlot, kBGMDynamicDeviceObjectIDOffset_Volume),
+                           GetObjectID(inSlot, kBGMDynamicDeviceObjectIDOffset_Mute),
+                           FormatSegmentName(kBGMLoopbackSegmentNameFormat_Dynamic, inSlot).c_str(),
+                           FormatSegmentName(kBGMCaptureTapSegmentNamePrefixFormat_Dynamic, inSlot).c_str());
+
+    try
+    {
+        theSlot.mDevice->RegisterObjects();
+        theSlot.mDevice->Activate();
+        theSlot.mState = SlotState::Active;
+    }
+    catch(...)
+    {
+        // Some of the device's objects could be in the registry already, so leave it for
+        // DeleteRetiredDevices to delete.
+        theSlot.mDevice->Deactivate();
+        theSlot.mState = SlotState::Retired;
+        throw;
+    }
+}
+
+bool    BGM_DynamicDevices::DeleteRetiredDevices()
+{
+    std::vector<BGM_Device*> theRetiredDevices;
+    bool devicesAreStillRunning = false;
+
+    {
+        CAMutex::Locker theLocker(mMutex);
+
+        for(Slot& theSlot : mSlots)
+        {
+            if(theSlot.mState == SlotState::Retired && theSlot.mDevice != nullptr)
+            {
+                // Keep the device until the HAL has stopped IO on it. It's inactive, so IO can't
+                // start on it again after this.
+                if(theSlot.mDevice->IsRunningIO())
+                {
+                    DebugMsg("BGM_DynamicDevices::DeleteRetiredDevices: Device %u is still running IO",
+                             theSlot.mDevice->GetObjectID());
+                    devicesAreStillRunning = true;
+                }
+                else
+                {
+                    BGM_ObjectRegistry::UnregisterOwner(*theSlot.mDevice);
+                    theRetiredDevices.push_back(theSlot.mDevice);
+                    theSlot.mDevice = nullptr;
+                }
+            }
+        }
+    }
+
+    if(!theRetiredDevices.empty())
+    {
+        // The HAL could have looked the devices up just before they were unregistered.
+        BGM_ObjectRegistry::WaitForCallsToFinish();
+    }
+
+    // Destroy the devices without holding the mutex, since destroying a device waits for its task
+    // queue, which could be waiting to call back into the plug-in.
+    for(BGM_Device* theDevice : theRetiredDevices)
+    {
+        DebugMsg("BGM_DynamicDevices::DeleteRetiredDevices: Deleting device %u", theDevice->GetObjectID());
+        delete theDevice;
+    }
+
+    // Free the slots now that their devices are gone, which also releases the devices' strings.
+    CAMutex::Locker theLocker(mMutex);
+
+    for(Slot& theSlot : mSlots)
+    {
+        if(theSlot.mState == SlotState::Retired && theSlot.mDevice == nullptr)
+        {
+            theSlot = Slot();
+        }
+    }
+
+    return devicesAreStillRunning;
+}
+
+CFArrayRef  BGM_DynamicDevices::CopyDevicesAsCFArray() const
+{
+    CAMutex::Locker theLocker(mMutex);
+
+    CACFArray theDevices(true);
+
+    for(UInt32 i = 0; i < kBGMMaxDynamicDevices; i++)
+    {
+        if(mSlots[i].mState == SlotState::Active)
+        {
+            CACFDictionary theDevice(true);
+            CACFString theSegmentName(FormatSegmentName(kBGMLoopbackSegmentNameFormat_Dynamic, i).c_str());
+
+            theDevice.AddString(CFSTR(kBGMDynamicDeviceKey_UID), mSlots[i].mUID.GetCFString());
+            theDevice.AddString(CFSTR(kBGMDynamicDeviceKey_Name), mSlots[i].mName.GetCFString());
+            theDevice.AddString(CFSTR(kBGMDynamicDeviceKey_SegmentName), theSegmentName.GetCFString());
+
+            theDevices.AppendDictionary(theDevice.GetDict());
+        }
+    }
+
+    return theDevices.CopyCFArray();
+}
+
+#pragma mark Accessors
+
+UInt32  BGM_DynamicDevices::GetNumberOfDevices() const
+{
+    CAMutex::Locker theLocker(mMutex);
+
+    UInt32 theNumberOfDevices = 0;
+
+    for(const Slot& theSlot : mSlots)
+    {
+        theNumberOfDevices += (theSlot.mState == SlotState::Active) ? 1 : 0;
+    }
+
+    return theNumberOfDevices;
+}
+
+UInt32  BGM_DynamicDevices::GetDeviceIDs(AudioObjectID* outDeviceIDs, UInt32 inMaxDeviceIDs) const
+{
+    CAMutex::Locker theLocker(mMutex);
+
+    UInt32 theNumberOfDeviceIDs = 0;
+
+    for(UInt32 i = 0; i < kBGMMaxDynamicDevices && theNumberOfDeviceIDs < inMaxDeviceIDs; i++)
+    {
+        if(mSlots[i].mState == SlotState::Active)
+        {
+            outDeviceIDs[theNumberOfDeviceIDs++] = GetObjectID(i, kBGMDynamicDeviceObjectIDOffset_Device);
+        }
+    }
+
+    return theNumberOfDeviceIDs;
+}
+
+AudioObjectID   BGM_DynamicDevices::GetDeviceIDForUID(CFStringRef inUID) const
+{
+    CAMutex::Locker theLocker(mMutex);
+
+    for(UInt32 i = 0; i < kBGMMaxDynamicDevices; i++)
+    {
+        if(mSlots[i].mState == SlotState::Active && CFEqual(inUID, mSlots[i].mUID.GetCFString()))
+        {
+            return GetObjectID(i, kBGMDynamicDeviceObjectIDOffset_Device);
+        }
+    }
+
+    return kAudioObjectUnknown;
+}
+
+bool    BGM_DynamicDevices::IsBuiltInUID(const CACFString& inUID)
+{
+    return CFEqual(inUID.GetCFString(), CFSTR(kBGMDeviceUID)) ||
+            CFEqual(inUID.GetCFString(), CFSTR(kBGMDeviceUID_UISounds)) ||
+            CFEqual(inUID.GetCFString(), CFSTR(kBGMNullDeviceUID));
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,157 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_DynamicDevices.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The extra instances of BGM_Device created at runtime through the plug-in's
+//  kAudioPlugInCustomPropertyDynamicDevices property.
+//
+//  There are kBGMMaxDynamicDevices slots. Each slot has a fixed block of object IDs (see
+//  kObjectID_FirstDynamic) and its own loopback and capture tap segment names, so a device's IDs
+//  and segments only depend on its slot.
+//
+//  Removing a device takes two steps. SetDevices takes it out of the device list and deactivates
+//  it, which stops new clients starting IO on it, but leaves it in the registry, because the HAL
+//  still has to be able to stop IO and remove its clients once it's been told the device list
+//  changed. The plug-in calls DeleteRetiredDevices after sending the notification, which only
+//  destroys a device once no clients are running IO on it and, after taking it out of the registry,
+//  any calls from the HAL that could still be using it have returned. Retired devices keep their
+//  slots until then, so their IDs and segment names can't be reused while they still exist.
+//
+
+#ifndef BGMDriver__BGM_DynamicDevices
+#define BGMDriver__BGM_DynamicDevices
+
+// Local Includes
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CACFString.h"
+#include "CAMutex.h"
+
+// System Includes
+#include <CoreAudio/AudioServerPlugIn.h>
+#include <CoreFoundation/CoreFoundation.h>
+
+
+// Forward Declarations
+class BGM_Device;
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_DynamicDevices
+{
+
+public:
+                                BGM_DynamicDevices() = default;
+                                ~BGM_DynamicDevices();
+                                // Disallow copying
+                                BGM_DynamicDevices(const BGM_DynamicDevices&) = delete;
+                                BGM_DynamicDevices& operator=(const BGM_DynamicDevices&) = delete;
+
+    /*!
+     Replace the set of dynamic devices. Devices whose UIDs and names are in both the old and new
+     lists are kept as they are, so their clients aren't interrupted. The rest are retired and new
+     devices are created and published for the new entries.
+
+     Not real-time safe.
+
+     @param inDevices The devices in the format of kAudioPlugInCustomPropertyDynamicDevices.
+     @return True if any devices were added or removed.
+     @throws CAException kAudioHardwareIllegalOperationError if inDevices is invalid, e.g. it has a
+                         duplicate UID, in which case the devices aren't changed.
+     @throws CAException if creating a device fails, in which case the published devices aren't
+                         changed, but any devices that were created are retired, so
+                         DeleteRetiredDevices still has to be called.
+     */
+    bool                        SetDevices(CFArrayRef inDevices);
+
+    /*!
+     @return The devices in the format of kAudioPlugInCustomPropertyDynamicDevices, i.e. an array of
+             dictionaries with the keys kBGMDynamicDeviceKey_UID, kBGMDynamicDeviceKey_Name and
+             kBGMDynamicDeviceKey_SegmentName. The caller owns the array.
+     */
+    CFArrayRef                  CopyDevicesAsCFArray() const;
+
+    /*!
+     Destroy the devices SetDevices removed that no clients are running IO on. Call after the HAL has
+     been told they're gone. Waits for any calls from the HAL that are using the devices to return.
+
+     Not real-time safe. Mustn't be called during a call from the HAL.
+
+     @return True if any of the devices are still running IO, in which case they're kept until the
+             next call.
+     */
+    bool                        DeleteRetiredDevices();
+
+    /*! @return The number of published devices. */
+    UInt32                      GetNumberOfDevices() const;
+
+    /*!
+     Write the object IDs of the published devices to outDeviceIDs, in slot order.
+
+     @param inMaxDeviceIDs The number of IDs outDeviceIDs has space for.
+     @return The number of IDs written.
+     */
+    UInt32                      GetDeviceIDs(AudioObjectID* outDeviceIDs, UInt32 inMaxDeviceIDs) const;
+
+    /*! @return The object ID of the published device with the UID, or kAudioObjectUnknown. */
+    AudioObjectID               GetDeviceIDForUID(CFStringRef inUID) const;
+
+    /*! @return The object ID the device in the slot has, or would have. */
+    static AudioObjectID        GetObjectID(UInt32 inSlot, UInt32 inOffset)
+                                    { return kObjectID_FirstDynamic + (inSlot * kBGMDynamicDeviceObjectIDs) + inOffset; }
+
+private:
+    enum class SlotState
+    {
+        Free,
+        // The device is published.
+        Active,
+        // The device has been removed from the device list, but not destroyed yet. It's still in
+        // the registry until DeleteRetiredDevices destroys it.
+        Retired
+    };
+
+    struct Slot
+    {
+        SlotState               mState = SlotState::Free;
+        // The devices don't retain their strings, so their slots keep them alive.
+        CACFString              mUID;
+        CACFString              mName;
+        BGM_Device* __nullable  mDevice = nullptr;
+    };
+
+    static bool                 IsBuiltInUID(const CACFString& inUID);
+    /*!
+     Create and publish a device in the slot, which has to be free and have its UID and name set.
+     Leaves the slot active, or retired if the device was created but couldn't be published.
+     */
+    void                        CreateDevice(UInt32 inSlot);
+
+    mutable CAMutex             mMutex { "Dynamic devices" };
+    Slot                        mSlots[kBGMMaxDynamicDevices];
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_DynamicDevices */
+
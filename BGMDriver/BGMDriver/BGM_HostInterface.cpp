@@ -0,0 +1,52 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_HostInterface.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_HostInterface.h"
+
+// PublicUtility Includes
+#include "CAHostTimeBase.h"
+
+
+#pragma clang assume_nonnull begin
+
+UInt64  BGM_HostInterface::GetCurrentHostTime() const
+{
+    return CAHostTimeBase::GetTheCurrentTime();
+}
+
+void    BGM_AudioServerPlugInHost::PropertiesChanged(AudioObjectID inObjectID,
+                                                     UInt32 inNumberAddresses,
+                                                     const AudioObjectPropertyAddress* inAddresses)
+{
+    mHost->PropertiesChanged(mHost, inObjectID, inNumberAddresses, inAddresses);
+}
+
+void    BGM_AudioServerPlugInHost::RequestDeviceConfigurationChange(AudioObjectID inDeviceObjectID,
+                                                                    UInt64 inChangeAction,
+                                                                    void* __nullable inChangeInfo)
+{
+    mHost->RequestDeviceConfigurationChange(mHost, inDeviceObjectID, inChangeAction, inChangeInfo);
+}
+
+#pragma clang assume_nonnull end
+
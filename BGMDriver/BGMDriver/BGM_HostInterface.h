@@ -0,0 +1,93 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_HostInterface.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Everything the driver asks of the process hosting it, i.e. coreaudiod. BGM_PlugIn forwards its
+//  Host_ functions to the BGM_HostInterface it was given, so the driver's objects never call the
+//  AudioServerPlugInHostInterface directly.
+//
+//  In coreaudiod, BGM_PlugInInterface.cpp wraps the AudioServerPlugInHostRef the HAL passes to
+//  Initialize in a BGM_AudioServerPlugInHost. The tests use a mock host instead (see BGM_MockHost
+//  in BGMDriverTests), which records the notifications the driver sends, decides when to apply the
+//  config changes it requests and gives it a virtual clock.
+//
+
+#ifndef BGMDriver__BGM_HostInterface
+#define BGMDriver__BGM_HostInterface
+
+// System Includes
+#include <CoreAudio/AudioServerPlugIn.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_HostInterface
+{
+
+public:
+    virtual                     ~BGM_HostInterface() = default;
+
+    /*! See PropertiesChanged in AudioServerPlugIn.h. */
+    virtual void                PropertiesChanged(AudioObjectID inObjectID,
+                                                  UInt32 inNumberAddresses,
+                                                  const AudioObjectPropertyAddress* inAddresses) = 0;
+
+    /*!
+     See RequestDeviceConfigurationChange in AudioServerPlugIn.h. The host will call the device's
+     PerformConfigChange (or AbortConfigChange) later, from another thread.
+     */
+    virtual void                RequestDeviceConfigurationChange(AudioObjectID inDeviceObjectID,
+                                                                 UInt64 inChangeAction,
+                                                                 void* __nullable inChangeInfo) = 0;
+
+    /*!
+     @return The current host time, in host clock ticks. The devices' clocks are based on this, so
+             it has to be the same clock the host uses for IO timestamps.
+     */
+    virtual UInt64              GetCurrentHostTime() const;
+
+};
+
+/*! The host coreaudiod provides through the AudioServerPlugIn API. */
+class BGM_AudioServerPlugInHost
+:
+    public BGM_HostInterface
+{
+
+public:
+                                BGM_AudioServerPlugInHost(AudioServerPlugInHostRef inHost)
+                                    : mHost(inHost) { }
+
+    void                        PropertiesChanged(AudioObjectID inObjectID,
+                                                  UInt32 inNumberAddresses,
+                                                  const AudioObjectPropertyAddress* inAddresses) override;
+    void                        RequestDeviceConfigurationChange(AudioObjectID inDeviceObjectID,
+                                                                 UInt64 inChangeAction,
+                                                                 void* __nullable inChangeInfo) override;
+
+private:
+    AudioServerPlugInHostRef    mHost;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_HostInterface */
+
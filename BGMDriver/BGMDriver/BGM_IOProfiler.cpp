@@ -0,0 +1,238 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOProfiler.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_IOProfiler.h"
+
+// Local Includes
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CACFArray.h"
+#include "CACFDictionary.h"
+#include "CACFString.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark BGM_IOHistogram
+
+void    BGM_IOHistogram::Record(UInt64 inNanos) noexcept
+{
+    mBuckets[BucketForNanos(inNanos)].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    mTotalNanos.fetch_add(inNanos, std::memory_order_relaxed);
+
+    UInt64 theMax = mMaxNanos.load(std::memory_order_relaxed);
+
+    while(inNanos > theMax &&
+          !mMaxNanos.compare_exchange_weak(theMax, inNanos, std::memory_order_relaxed))
+    {
+        // compare_exchange_weak updated theMax, so just try again.
+    }
+}
+
+void    BGM_IOHistogram::Reset() noexcept
+{
+    for(std::atomic<UInt64>& theBucket : mBuckets)
+    {
+        theBucket.store(0, std::memory_order_relaxed);
+    }
+
+    mCount.store(0, std::memory_order_relaxed);
+    mTotalNanos.store(0, std::memory_order_relaxed);
+    mMaxNanos.store(0, std::memory_order_relaxed);
+}
+
+UInt32  BGM_IOHistogram::BucketForNanos(UInt64 inNanos) noexcept
+{
+    // Durations shorter than kSubBuckets nanoseconds get a bucket each.
+    if(inNanos < kSubBuckets)
+    {
+        return static_cast<UInt32>(inNanos);
+    }
+
+    const UInt32 theExponent = 63 - static_cast<UInt32>(__builtin_clzll(inNanos));
+
+    if(theExponent >= kMaxExponent)
+    {
+        return kNumBuckets - 1;
+    }
+
+    // The kSubBucketBits bits after the highest set bit choose the bucket within the power of two.
+    const UInt32 theSubBucket =
+            static_cast<UInt32>(inNanos >> (theExponent - kSubBucketBits)) & (kSubBuckets - 1);
+
+    return ((theExponent - kSubBucketBits + 1) * kSubBuckets) + theSubBucket;
+}
+
+UInt64  BGM_IOHistogram::LowerBoundForBucket(UInt32 inBucket) noexcept
+{
+    if(inBucket < kSubBuckets)
+    {
+        return inBucket;
+    }
+
+    const UInt32 theExponent = (inBucket / kSubBuckets) + kSubBucketBits - 1;
+    const UInt64 theSubBucket = inBucket % kSubBuckets;
+
+    return (kSubBuckets + theSubBucket) << (theExponent - kSubBucketBits);
+}
+
+UInt64  BGM_IOHistogram::GetQuantileNanos(Float64 inQuantile) const noexcept
+{
+    UInt64 theCount = 0;
+
+    for(const std::atomic<UInt64>& theBucket : mBuckets)
+    {
+        theCount += theBucket.load(std::memory_order_relaxed);
+    }
+
+    if(theCount == 0)
+    {
+        return 0;
+    }
+
+    // The rank of the duration we're looking for, counting from 1.
+    const UInt64 theRank =
+            std::max<UInt64>(1, static_cast<UInt64>(std::ceil(std::min(1.0, std::max(0.0, inQuantile)) * theCount)));
+    UInt64 theCountSoFar = 0;
+
+    for(UInt32 i = 0; i < kNumBuckets - 1; i++)
+    {
+        theCountSoFar += mBuckets[i].load(std::memory_order_relaxed);
+
+        if(theCountSoFar >= theRank)
+        {
+            // The end of the bucket could be longer than the longest duration actually recorded.
+            return std::min(LowerBoundForBucket(i + 1), GetMaxNanos());
+        }
+    }
+
+    return GetMaxNanos();
+}
+
+#pragma mark BGM_IOProfiler
+
+const char* BGM_IOProfiler::GetOperationName(Operation inOperation) noexcept
+{
+    switch(inOperation)
+    {
+        case kReadInput:
+            return "ReadInput";
+        case kProcessOutput:
+            return "ProcessOutput";
+        case kProcessMix:
+            return "ProcessMix";
+        case kWriteMix:
+            return "WriteMix";
+        case kBeginIOOperation:
+            return "BeginIOOperation";
+        case kEndIOOperation:
+            return "EndIOOperation";
+        case kGetZeroTimeStamp:
+            return "GetZeroTimeStamp";
+        case kIOMutexWait:
+            return "IOMutexWait";
+        default:
+            return "Unknown";
+    }
+}
+
+#if BGM_IO_PROFILING
+
+BGM_IOProfiler::BGM_IOProfiler()
+{
+    mach_timebase_info(&mTimebase);
+}
+
+void    BGM_IOProfiler::Reset() noexcept
+{
+    for(BGM_IOHistogram& theHistogram : mHistograms)
+    {
+        theHistogram.Reset();
+    }
+}
+
+void    BGM_IOProfiler::RecordRT(Operation inOperation,
+                                 UInt64 inStartHostTime,
+                                 UInt64 inEndHostTime) noexcept
+{
+    if(inOperation < kNumOperations)
+    {
+        const UInt64 theHostTicks = (inEndHostTime > inStartHostTime) ? (inEndHostTime - inStartHostTime) : 0;
+        mHistograms[inOperation].Record((theHostTicks * mTimebase.numer) / mTimebase.denom);
+    }
+}
+
+#endif /* BGM_IO_PROFILING */
+
+CFDictionaryRef BGM_IOProfiler::CopyProfile() const
+{
+    CACFDictionary theProfile(true);
+    theProfile.AddBool(CFSTR(kBGMIOProfileKey_Enabled), kEnabled);
+
+#if BGM_IO_PROFILING
+    CACFDictionary theOperations(true);
+
+    for(UInt32 i = 0; i < kNumOperations; i++)
+    {
+        const BGM_IOHistogram& theHistogram = mHistograms[i];
+        CACFDictionary theOperation(true);
+        CACFArray theBuckets(true);
+
+        theOperation.AddUInt64(CFSTR(kBGMIOProfileKey_Count), theHistogram.GetCount());
+        theOperation.AddUInt64(CFSTR(kBGMIOProfileKey_TotalNanos), theHistogram.GetTotalNanos());
+        theOperation.AddUInt64(CFSTR(kBGMIOProfileKey_MaxNanos), theHistogram.GetMaxNanos());
+
+        // Only include the buckets with something in them, since almost all of them will be empty.
+        for(UInt32 theBucket = 0; theBucket < BGM_IOHistogram::kNumBuckets; theBucket++)
+        {
+            const UInt64 theCount = theHistogram.GetBucketCount(theBucket);
+
+            if(theCount > 0)
+            {
+                CACFArray theBucketPair(true);
+                theBucketPair.AppendUInt64(BGM_IOHistogram::LowerBoundForBucket(theBucket));
+                theBucketPair.AppendUInt64(theCount);
+                theBuckets.AppendArray(theBucketPair.GetCFArray());
+            }
+        }
+
+        theOperation.AddArray(CFSTR(kBGMIOProfileKey_Buckets), theBuckets.GetCFArray());
+
+        CACFString theName(GetOperationName(static_cast<Operation>(i)));
+        theOperations.AddDictionary(theName.GetCFString(), theOperation.GetCFDictionary());
+    }
+
+    theProfile.AddDictionary(CFSTR(kBGMIOProfileKey_Operations), theOperations.GetCFDictionary());
+#endif
+
+    return theProfile.CopyCFDictionary();
+}
+
+#pragma clang assume_nonnull end
+
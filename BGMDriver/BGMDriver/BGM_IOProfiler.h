@@ -0,0 +1,261 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOProfiler.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Optional instrumentation for finding out whether BGMDriver is the cause of "Audio IO Overload"
+//  messages in the system log. BGM_Device times each of its IO operations, and how long it waits
+//  for its IO mutex, and records the times in a histogram per operation. They can be read with
+//  kAudioDeviceCustomPropertyIOProfile.
+//
+//  Profiling is only compiled in if BGM_IO_PROFILING is set to 1, e.g. with
+//
+//      xcodebuild GCC_PREPROCESSOR_DEFINITIONS='$(inherited) BGM_IO_PROFILING=1' ...
+//
+//  Otherwise BGM_IOProfiler, Scope and Locker are empty and all of their functions are inline and
+//  do nothing, so they're compiled out completely. (BGM_IOProfilerTests checks that.)
+//
+
+#ifndef BGMDriver__BGM_IOProfiler
+#define BGMDriver__BGM_IOProfiler
+
+// PublicUtility Includes
+#include "CAMutex.h"
+
+// STL Includes
+#include <atomic>
+
+// System Includes
+#include <CoreAudio/AudioServerPlugIn.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <mach/mach_time.h>
+
+
+#ifndef BGM_IO_PROFILING
+#define BGM_IO_PROFILING 0
+#endif
+
+#pragma clang assume_nonnull begin
+
+/*!
+ A lock-free histogram of durations in nanoseconds. The buckets are log-linear: each power of two is
+ split into kSubBuckets buckets of equal width, so the error is at most 1/kSubBuckets of the value
+ at any scale.
+
+ Record is real-time safe and can be called from any number of threads at once. Reset can be called
+ at any time, but a duration recorded at the same time might be partly counted.
+ */
+class BGM_IOHistogram
+{
+
+public:
+    static const UInt32         kSubBucketBits = 3;
+    static const UInt32         kSubBuckets = 1 << kSubBucketBits;
+    // Durations of 2^kMaxExponent nanoseconds (about 9 minutes) or more all go in the last bucket.
+    static const UInt32         kMaxExponent = 39;
+    static const UInt32         kNumBuckets = ((kMaxExponent - kSubBucketBits + 1) * kSubBuckets);
+
+                                BGM_IOHistogram() { Reset(); }
+                                // Disallow copying
+                                BGM_IOHistogram(const BGM_IOHistogram&) = delete;
+                                BGM_IOHistogram& operator=(const BGM_IOHistogram&) = delete;
+
+    void                        Record(UInt64 inNanos) noexcept;
+    void                        Reset() noexcept;
+
+    UInt64                      GetCount() const noexcept { return mCount.load(std::memory_order_relaxed); }
+    UInt64                      GetTotalNanos() const noexcept { return mTotalNanos.load(std::memory_order_relaxed); }
+    UInt64                      GetMaxNanos() const noexcept { return mMaxNanos.load(std::memory_order_relaxed); }
+    UInt64                      GetBucketCount(UInt32 inBucket) const noexcept
+                                    { return mBuckets[inBucket].load(std::memory_order_relaxed); }
+
+    /*! @return The index of the bucket a duration is counted in. */
+    static UInt32               BucketForNanos(UInt64 inNanos) noexcept;
+    /*! @return The shortest duration counted in a bucket. */
+    static UInt64               LowerBoundForBucket(UInt32 inBucket) noexcept;
+
+    /*!
+     @return The duration that inQuantile (from 0 to 1) of the recorded durations are shorter than,
+             rounded up to the end of its bucket (or the longest duration recorded, if that's
+             shorter). 0 if nothing has been recorded.
+     */
+    UInt64                      GetQuantileNanos(Float64 inQuantile) const noexcept;
+
+private:
+    std::atomic<UInt64>         mBuckets[kNumBuckets];
+    std::atomic<UInt64>         mCount;
+    std::atomic<UInt64>         mTotalNanos;
+    std::atomic<UInt64>         mMaxNanos;
+
+};
+
+class BGM_IOProfiler
+{
+
+public:
+    // The things BGM_Device times.
+    enum Operation : UInt32
+    {
+        kReadInput,
+        kProcessOutput,
+        kProcessMix,
+        kWriteMix,
+        kBeginIOOperation,
+        kEndIOOperation,
+        kGetZeroTimeStamp,
+        // The time spent waiting to lock the IO mutex during the other operations. Also included in
+        // their times.
+        kIOMutexWait,
+        kNumOperations
+    };
+
+    static const bool           kEnabled = BGM_IO_PROFILING;
+
+    /*! @return The name used for the operation in kAudioDeviceCustomPropertyIOProfile. */
+    static const char*          GetOperationName(Operation inOperation) noexcept;
+
+    /*!
+     @return The Operation for one of the IO operations passed to DoIOOperation, or kNumOperations
+             if it isn't one we time.
+     */
+    static inline Operation     OperationForIOOperationID(UInt32 inIOOperationID) noexcept;
+
+    /*!
+     @return The value of kAudioDeviceCustomPropertyIOProfile. The caller must release it. If
+             profiling isn't compiled in, the dictionary only says that.
+     */
+    CFDictionaryRef             CopyProfile() const;
+
+#if BGM_IO_PROFILING
+                                BGM_IOProfiler();
+
+    /*! Clear the histograms. Real-time safe. */
+    void                        Reset() noexcept;
+
+    const BGM_IOHistogram&      GetHistogram(Operation inOperation) const noexcept
+                                    { return mHistograms[inOperation]; }
+
+    /*! Record one duration. Real-time safe. Ignores kNumOperations. */
+    void                        RecordRT(Operation inOperation,
+                                         UInt64 inStartHostTime,
+                                         UInt64 inEndHostTime) noexcept;
+#else
+    void                        Reset() noexcept { }
+#endif
+
+    /*! Times from construction to destruction, e.g. one case of DoIOOperation. */
+    class Scope
+    {
+
+    public:
+#if BGM_IO_PROFILING
+                                Scope(BGM_IOProfiler& inProfiler, Operation inOperation) noexcept
+                                :
+                                    mProfiler(inProfiler),
+                                    mOperation(inOperation),
+                                    mStartHostTime(mach_absolute_time())
+                                { }
+                                ~Scope() { mProfiler.RecordRT(mOperation, mStartHostTime, mach_absolute_time()); }
+
+    private:
+        BGM_IOProfiler&         mProfiler;
+        const Operation         mOperation;
+        const UInt64            mStartHostTime;
+#else
+                                Scope(BGM_IOProfiler& inProfiler, Operation inOperation) noexcept
+                                    { (void)inProfiler; (void)inOperation; }
+                                ~Scope() = default;
+#endif
+
+    public:
+                                // Disallow copying
+                                Scope(const Scope&) = delete;
+                                Scope& operator=(const Scope&) = delete;
+
+    };
+
+    /*!
+     Used like CAMutex::Locker, but records the time spent waiting for the mutex as kIOMutexWait.
+     Throws if locking the mutex fails, like CAMutex::Locker.
+     */
+    class Locker
+    {
+
+    public:
+#if BGM_IO_PROFILING
+                                Locker(CAMutex& inMutex, BGM_IOProfiler& inProfiler)
+                                :
+                                    mMutex(inMutex)
+                                {
+                                    const UInt64 theStartHostTime = mach_absolute_time();
+                                    mNeedsRelease = mMutex.Lock();
+                                    inProfiler.RecordRT(kIOMutexWait, theStartHostTime, mach_absolute_time());
+                                }
+                                ~Locker() { if(mNeedsRelease) { mMutex.Unlock(); } }
+
+    private:
+        CAMutex&                mMutex;
+        bool                    mNeedsRelease;
+#else
+                                Locker(CAMutex& inMutex, BGM_IOProfiler& inProfiler)
+                                :
+                                    mLocker(inMutex)
+                                { (void)inProfiler; }
+
+    private:
+        CAMutex::Locker         mLocker;
+#endif
+
+    public:
+                                // Disallow copying
+                                Locker(const Locker&) = delete;
+                                Locker& operator=(const Locker&) = delete;
+
+    };
+
+#if BGM_IO_PROFILING
+private:
+    BGM_IOHistogram             mHistograms[kNumOperations];
+    // For converting host times to nanoseconds.
+    mach_timebase_info_data_t   mTimebase;
+#endif
+
+};
+
+inline BGM_IOProfiler::Operation BGM_IOProfiler::OperationForIOOperationID(UInt32 inIOOperationID) noexcept
+{
+    switch(inIOOperationID)
+    {
+        case kAudioServerPlugInIOOperationReadInput:
+            return kReadInput;
+        case kAudioServerPlugInIOOperationProcessOutput:
+            return kProcessOutput;
+        case kAudioServerPlugInIOOperationProcessMix:
+            return kProcessMix;
+        case kAudioServerPlugInIOOperationWriteMix:
+            return kWriteMix;
+        default:
+            return kNumOperations;
+    }
+}
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_IOProfiler */
+
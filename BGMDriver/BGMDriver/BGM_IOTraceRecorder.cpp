@@ -0,0 +1,358 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOTraceRecorder.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_IOTraceRecorder.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+#include "CAException.h"
+
+// STL Includes
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+
+// System Includes
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#pragma clang assume_nonnull begin
+
+static_assert(kBGMIOTraceOperation_ReadInput == kAudioServerPlugInIOOperationReadInput &&
+              kBGMIOTraceOperation_ProcessOutput == kAudioServerPlugInIOOperationProcessOutput &&
+              kBGMIOTraceOperation_ProcessMix == kAudioServerPlugInIOOperationProcessMix &&
+              kBGMIOTraceOperation_WriteMix == kAudioServerPlugInIOOperationWriteMix,
+              "The IO operation IDs in BGM_IOTraceLayout.h don't match AudioServerPlugIn.h");
+
+// Bundle IDs longer than this are truncated. They're limited to 255 chars anyway.
+static const CFIndex kMaxBundleIDBytes = 1024;
+
+// The name of the directory traces are written to, in coreaudiod's temporary directory.
+static const char* const kTraceDirectoryName = "BGMDriver IO Traces";
+static const char* const kTraceFileExtension = ".bgmtrace";
+// How many numbered names to try if a trace has already been written this second.
+static const UInt32 kMaxFileNameAttempts = 1000;
+
+static size_t   AlignRecordSize(size_t inSize)
+{
+    return (inSize + kBGMIOTraceRecordAlignment - 1) & ~static_cast<size_t>(kBGMIOTraceRecordAlignment - 1);
+}
+
+BGM_IOTraceRecorder::BGM_IOTraceRecorder(size_t inCapacityBytes,
+                                         bool inIncludeBuffers,
+                                         Float64 inSampleRate)
+:
+    mBuffer(),
+    mIncludeBuffers(inIncludeBuffers),
+    mStartHostTime(mach_absolute_time())
+{
+    ThrowIf(inCapacityBytes < sizeof(BGMIOTraceFileHeader),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_IOTraceRecorder::BGM_IOTraceRecorder: Capacity too small");
+
+    mach_timebase_info(&mTimebase);
+
+    // Allocate (and zero) the whole buffer now so recording never has to.
+    mBuffer.resize(inCapacityBytes);
+
+    BGMIOTraceFileHeader* theHeader = reinterpret_cast<BGMIOTraceFileHeader*>(mBuffer.data());
+    theHeader->mMagic = kBGMIOTraceMagic;
+    theHeader->mVersion = kBGMIOTraceVersion;
+    theHeader->mHeaderSize = sizeof(BGMIOTraceFileHeader);
+    theHeader->mFlags = inIncludeBuffers ? kBGMIOTraceFlag_IncludesBuffers : 0;
+    theHeader->mSampleRate = inSampleRate;
+    theHeader->mChannelsPerFrame = kChannelsPerFrame;
+
+    mUsedBytes = sizeof(BGMIOTraceFileHeader);
+}
+
+UInt8* __nullable   BGM_IOTraceRecorder::AppendRecord(UInt32 inType, size_t inPayloadSize) noexcept
+{
+    const size_t theRecordSize = AlignRecordSize(sizeof(BGMIOTraceRecordHeader) + inPayloadSize);
+
+    if(inPayloadSize > UINT32_MAX || theRecordSize > mBuffer.size() - mUsedBytes)
+    {
+        mDroppedRecords++;
+        return nullptr;
+    }
+
+    const UInt64 theHostTicks = mach_absolute_time() - mStartHostTime;
+
+    BGMIOTraceRecordHeader* theHeader = reinterpret_cast<BGMIOTraceRecordHeader*>(&mBuffer[mUsedBytes]);
+    theHeader->mType = inType;
+    theHeader->mPayloadSize = static_cast<UInt32>(inPayloadSize);
+    theHeader->mNanos = (theHostTicks * mTimebase.numer) / mTimebase.denom;
+
+    UInt8* thePayload = reinterpret_cast<UInt8*>(theHeader + 1);
+    mUsedBytes += theRecordSize;
+
+    return thePayload;
+}
+
+void    BGM_IOTraceRecorder::RecordClient(UInt32 inType, const AudioServerPlugInClientInfo& inClientInfo)
+{
+    // Convert the bundle ID into a buffer on the stack since we're holding the IO mutex.
+    UInt8 theBundleID[kMaxBundleIDBytes];
+    CFIndex theBundleIDLength = 0;
+
+    if(inClientInfo.mBundleID != nullptr)
+    {
+        CFStringGetBytes(inClientInfo.mBundleID,
+                         CFRangeMake(0, CFStringGetLength(inClientInfo.mBundleID)),
+                         kCFStringEncodingUTF8,
+                         '?',
+                         false,
+                         theBundleID,
+                         kMaxBundleIDBytes,
+                         &theBundleIDLength);
+    }
+
+    UInt8* thePayload = AppendRecord(inType, sizeof(BGMIOTraceClientPayload) + theBundleIDLength);
+
+    if(thePayload != nullptr)
+    {
+        BGMIOTraceClientPayload* theClient = reinterpret_cast<BGMIOTraceClientPayload*>(thePayload);
+        theClient->mClientID = inClientInfo.mClientID;
+        theClient->mProcessID = inClientInfo.mProcessID;
+        theClient->mIsNativeEndian = inClientInfo.mIsNativeEndian;
+        theClient->mBundleIDLength = static_cast<UInt32>(theBundleIDLength);
+        memcpy(theClient + 1, theBundleID, theBundleIDLength);
+    }
+}
+
+void    BGM_IOTraceRecorder::RecordAddClient(const AudioServerPlugInClientInfo& inClientInfo)
+{
+    RecordClient(kBGMIOTraceRecord_AddClient, inClientInfo);
+}
+
+void    BGM_IOTraceRecorder::RecordRemoveClient(const AudioServerPlugInClientInfo& inClientInfo)
+{
+    RecordClient(kBGMIOTraceRecord_RemoveClient, inClientInfo);
+}
+
+void    BGM_IOTraceRecorder::RecordStartIO(UInt32 inClientID)
+{
+    UInt8* thePayload = AppendRecord(kBGMIOTraceRecord_StartIO, sizeof(BGMIOTraceClientIOPayload));
+
+    if(thePayload != nullptr)
+    {
+        reinterpret_cast<BGMIOTraceClientIOPayload*>(thePayload)->mClientID = inClientID;
+    }
+}
+
+void    BGM_IOTraceRecorder::RecordStopIO(UInt32 inClientID)
+{
+    UInt8* thePayload = AppendRecord(kBGMIOTraceRecord_StopIO, sizeof(BGMIOTraceClientIOPayload));
+
+    if(thePayload != nullptr)
+    {
+        reinterpret_cast<BGMIOTraceClientIOPayload*>(thePayload)->mClientID = inClientID;
+    }
+}
+
+void    BGM_IOTraceRecorder::RecordIOOperationRT(UInt32 inOperationID,
+                                                 UInt32 inClientID,
+                                                 UInt32 inIOBufferFrameSize,
+                                                 const AudioServerPlugInIOCycleInfo& inIOCycleInfo,
+                                                 const void* __nullable ioMainBuffer) noexcept
+{
+    // ReadInput's buffer is only written to by the driver, so there's nothing to record.
+    const bool theOperationHasAudio = (inOperationID != kAudioServerPlugInIOOperationReadInput);
+    const size_t theBufferSize =
+            (mIncludeBuffers && theOperationHasAudio && ioMainBuffer != nullptr) ?
+                    (static_cast<size_t>(inIOBufferFrameSize) * kChannelsPerFrame * sizeof(Float32)) : 0;
+
+    UInt8* thePayload = AppendRecord(kBGMIOTraceRecord_IOOperation,
+                                     sizeof(BGMIOTraceIOOperationPayload) + theBufferSize);
+
+    if(thePayload != nullptr)
+    {
+        BGMIOTraceIOOperationPayload* theOperation =
+                reinterpret_cast<BGMIOTraceIOOperationPayload*>(thePayload);
+        theOperation->mOperationID = inOperationID;
+        theOperation->mClientID = inClientID;
+        theOperation->mIOBufferFrameSize = inIOBufferFrameSize;
+        theOperation->mBufferSize = static_cast<UInt32>(theBufferSize);
+        theOperation->mInputSampleTime = inIOCycleInfo.mInputTime.mSampleTime;
+        theOperation->mOutputSampleTime = inIOCycleInfo.mOutputTime.mSampleTime;
+
+        if(theBufferSize > 0)
+        {
+            memcpy(theOperation + 1, ioMainBuffer, theBufferSize);
+        }
+    }
+}
+
+void    BGM_IOTraceRecorder::RecordSetProperty(AudioObjectID inObjectID,
+                                               const AudioObjectPropertyAddress& inAddress,
+                                               pid_t inClientProcessID,
+                                               bool inIsPropertyList,
+                                               UInt32 inDataSize,
+                                               const void* __nullable inData)
+{
+    const UInt32 theDataSize = (inData != nullptr) ? inDataSize : 0;
+    UInt8* thePayload = AppendRecord(kBGMIOTraceRecord_SetProperty,
+                                     sizeof(BGMIOTraceSetPropertyPayload) + theDataSize);
+
+    if(thePayload != nullptr)
+    {
+        BGMIOTraceSetPropertyPayload* theProperty =
+                reinterpret_cast<BGMIOTraceSetPropertyPayload*>(thePayload);
+        theProperty->mObjectID = inObjectID;
+        theProperty->mSelector = inAddress.mSelector;
+        theProperty->mScope = inAddress.mScope;
+        theProperty->mElement = inAddress.mElement;
+        theProperty->mClientProcessID = inClientProcessID;
+        theProperty->mIsPropertyList = inIsPropertyList;
+        theProperty->mDataSize = theDataSize;
+
+        if(theDataSize > 0)
+        {
+            memcpy(theProperty + 1, inData, theDataSize);
+        }
+    }
+}
+
+void    BGM_IOTraceRecorder::RecordConfigChange(UInt64 inChangeAction)
+{
+    UInt8* thePayload = AppendRecord(kBGMIOTraceRecord_ConfigChange, sizeof(BGMIOTraceConfigChangePayload));
+
+    if(thePayload != nullptr)
+    {
+        reinterpret_cast<BGMIOTraceConfigChangePayload*>(thePayload)->mChangeAction = inChangeAction;
+    }
+}
+
+std::string BGM_IOTraceRecorder::WriteToNewFile(const std::string& inDirectory,
+                                                 const char* inFileNamePrefix) const
+{
+    char theTimestamp[32];
+    const time_t theTime = time(nullptr);
+    struct tm theLocalTime;
+    localtime_r(&theTime, &theLocalTime);
+    strftime(theTimestamp, sizeof(theTimestamp), "%Y-%m-%d %H.%M.%S", &theLocalTime);
+
+    const std::string theBasePath = inDirectory + "/" + inFileNamePrefix + " " + theTimestamp;
+    std::string thePath = theBasePath + kTraceFileExtension;
+    int theFD = -1;
+
+    // O_EXCL and O_NOFOLLOW so we only ever write to a file we just created.
+    for(UInt32 theNumber = 2; theNumber <= kMaxFileNameAttempts; theNumber++)
+    {
+        theFD = open(thePath.c_str(),
+                     O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+                     S_IRUSR | S_IWUSR);
+
+        if(theFD != -1 || errno != EEXIST)
+        {
+            break;
+        }
+
+        thePath = theBasePath + " " + std::to_string(theNumber) + kTraceFileExtension;
+    }
+
+    ThrowIf(theFD == -1,
+            CAException(kAudioHardwareUnspecifiedError),
+            "BGM_IOTraceRecorder::WriteToNewFile: Couldn't create the file");
+
+    size_t theBytesWritten = 0;
+    bool didWrite = true;
+
+    while(didWrite && theBytesWritten < mUsedBytes)
+    {
+        const ssize_t theResult = write(theFD, mBuffer.data() + theBytesWritten, mUsedBytes - theBytesWritten);
+
+        if(theResult > 0)
+        {
+            theBytesWritten += static_cast<size_t>(theResult);
+        }
+        else
+        {
+            didWrite = (theResult == -1 && errno == EINTR);
+        }
+    }
+
+    const bool didClose = (close(theFD) == 0);
+
+    if(!didWrite || !didClose)
+    {
+        // Don't leave a partial trace behind.
+        unlink(thePath.c_str());
+    }
+
+    ThrowIf(!didWrite || !didClose,
+            CAException(kAudioHardwareUnspecifiedError),
+            "BGM_IOTraceRecorder::WriteToNewFile: Couldn't write the file");
+
+    return thePath;
+}
+
+std::string BGM_IOTraceRecorder::GetDefaultDirectory()
+{
+    // The temporary directory is per-user, so only coreaudiod's user can read the traces.
+    char theTempDirectory[PATH_MAX];
+    const size_t theLength = confstr(_CS_DARWIN_USER_TEMP_DIR, theTempDirectory, sizeof(theTempDirectory));
+
+    ThrowIf(theLength == 0 || theLength > sizeof(theTempDirectory),
+            CAException(kAudioHardwareUnspecifiedError),
+            "BGM_IOTraceRecorder::GetDefaultDirectory: No temporary directory");
+
+    const std::string theDirectory = std::string(theTempDirectory) + "/" + kTraceDirectoryName;
+
+    ThrowIf(mkdir(theDirectory.c_str(), S_IRWXU) != 0 && errno != EEXIST,
+            CAException(kAudioHardwareUnspecifiedError),
+            "BGM_IOTraceRecorder::GetDefaultDirectory: Couldn't create the directory");
+
+    // If it already existed, check it's a real directory that only we can use.
+    struct stat theInfo;
+
+    ThrowIf(lstat(theDirectory.c_str(), &theInfo) != 0 ||
+                    !S_ISDIR(theInfo.st_mode) ||
+                    theInfo.st_uid != geteuid() ||
+                    (theInfo.st_mode & (S_IRWXG | S_IRWXO)) != 0,
+            CAException(kAudioHardwareUnspecifiedError),
+            "BGM_IOTraceRecorder::GetDefaultDirectory: Unsafe directory");
+
+    return theDirectory;
+}
+
+CFDataRef   BGM_IOTraceRecorder::CopySerializedPropertyList(CFPropertyListRef inPropertyList)
+{
+    CFDataRef theData = CFPropertyListCreateData(kCFAllocatorDefault,
+                                                 inPropertyList,
+                                                 kCFPropertyListBinaryFormat_v1_0,
+                                                 0,
+                                                 nullptr);
+
+    ThrowIfNULL(theData,
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_IOTraceRecorder::CopySerializedPropertyList: Not a property list");
+
+    return theData;
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,162 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOTraceRecorder.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Records the calls the HAL makes to BGM_Device into a trace while
+//  kAudioDeviceCustomPropertyIOTrace is enabled. See BGM_IOTraceLayout.h for the format and
+//  SharedSource/IOTrace for replaying traces.
+//
+//  The trace is recorded into a buffer that's allocated up front, so IO operations can be recorded
+//  on the IO thread. Records that don't fit are dropped and counted.
+//
+//  Traces are only written to new files the driver names itself, in a directory only coreaudiod's
+//  user can read, since they can include the audio that was played.
+//
+//  Not thread safe. BGM_Device only uses it while holding its IO mutex.
+//
+
+#ifndef BGMDriver__BGM_IOTraceRecorder
+#define BGMDriver__BGM_IOTraceRecorder
+
+// Local Includes
+#include "BGM_IOTraceLayout.h"
+
+// STL Includes
+#include <string>
+#include <vector>
+
+// System Includes
+#include <CoreAudio/AudioServerPlugIn.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <mach/mach_time.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_IOTraceRecorder
+{
+
+public:
+    // The number of channels in BGMDevice's streams.
+    static const UInt32         kChannelsPerFrame = 2;
+    // The default and largest sizes of the buffer a trace is recorded into. The whole buffer is
+    // allocated in coreaudiod when recording starts, so the limit has to be small enough that any
+    // client can ask for it. With the audio, 16 MB is about 40 seconds of stereo at 48 kHz.
+    static const size_t         kDefaultCapacityBytes = 16 * 1024 * 1024;
+    static const size_t         kMaxCapacityBytes = 64 * 1024 * 1024;
+
+    /*!
+     @param inCapacityBytes The size of the buffer to record into, including the file header.
+     @param inIncludeBuffers True to record the audio passed to each IO operation.
+     @param inSampleRate The device's sample rate.
+     @throws CAException if inCapacityBytes is too small for the file header.
+     */
+                                BGM_IOTraceRecorder(size_t inCapacityBytes,
+                                                    bool inIncludeBuffers,
+                                                    Float64 inSampleRate);
+                                // Disallow copying
+                                BGM_IOTraceRecorder(const BGM_IOTraceRecorder&) = delete;
+                                BGM_IOTraceRecorder& operator=(const BGM_IOTraceRecorder&) = delete;
+
+    void                        RecordAddClient(const AudioServerPlugInClientInfo& inClientInfo);
+    void                        RecordRemoveClient(const AudioServerPlugInClientInfo& inClientInfo);
+    void                        RecordStartIO(UInt32 inClientID);
+    void                        RecordStopIO(UInt32 inClientID);
+
+    /*!
+     Record an IO operation and, if the recorder was created with inIncludeBuffers true and the
+     operation passes audio to the driver, the audio in ioMainBuffer. Real-time safe.
+     */
+    void                        RecordIOOperationRT(UInt32 inOperationID,
+                                                    UInt32 inClientID,
+                                                    UInt32 inIOBufferFrameSize,
+                                                    const AudioServerPlugInIOCycleInfo& inIOCycleInfo,
+                                                    const void* __nullable ioMainBuffer) noexcept;
+
+    /*!
+     @param inData The data passed to SetPropertyData or, if inIsPropertyList is true, the property's
+                   value serialized with CopySerializedPropertyList.
+     */
+    void                        RecordSetProperty(AudioObjectID inObjectID,
+                                                  const AudioObjectPropertyAddress& inAddress,
+                                                  pid_t inClientProcessID,
+                                                  bool inIsPropertyList,
+                                                  UInt32 inDataSize,
+                                                  const void* __nullable inData);
+    void                        RecordConfigChange(UInt64 inChangeAction);
+
+    size_t                      GetUsedBytes() const { return mUsedBytes; }
+    UInt64                      GetDroppedRecords() const { return mDroppedRecords; }
+
+    /*!
+     Write the trace so far to a new file in inDirectory, named with inFileNamePrefix and the
+     current time. Never replaces an existing file or follows a symlink. Only the owner can read the
+     file.
+
+     @return The path of the file.
+     @throws CAException if the file can't be written, in which case it's removed.
+     */
+    std::string                 WriteToNewFile(const std::string& inDirectory,
+                                               const char* inFileNamePrefix) const;
+
+    /*!
+     @return The directory BGMDriver writes traces to, "BGMDriver IO Traces" in the temporary
+             directory of the user it's running as, i.e. coreaudiod's user. Created if it doesn't
+             exist.
+     @throws CAException if the directory can't be created or isn't owned by the current user.
+     */
+    static std::string          GetDefaultDirectory();
+
+    /*! @return A copy of the trace so far. For tests. */
+    std::vector<UInt8>          CopyTrace() const
+                                    { return std::vector<UInt8>(mBuffer.begin(), mBuffer.begin() + mUsedBytes); }
+
+    /*!
+     @return inPropertyList serialized as a binary property list, for RecordSetProperty. The caller
+             must release it.
+     @throws CAException if it can't be serialized.
+     */
+    static CFDataRef            CopySerializedPropertyList(CFPropertyListRef inPropertyList);
+
+private:
+    /*!
+     Append a record's header and reserve space for its payload, or count it as dropped if there
+     isn't room for it. Real-time safe.
+
+     @return A pointer to the space for the payload, which is zero-filled, or null if the record
+             was dropped.
+     */
+    UInt8* __nullable           AppendRecord(UInt32 inType, size_t inPayloadSize) noexcept;
+    void                        RecordClient(UInt32 inType, const AudioServerPlugInClientInfo& inClientInfo);
+
+    std::vector<UInt8>          mBuffer;
+    size_t                      mUsedBytes = 0;
+    UInt64                      mDroppedRecords = 0;
+    const bool                  mIncludeBuffers;
+    const UInt64                mStartHostTime;
+    // For converting host times to nanoseconds.
+    mach_timebase_info_data_t   mTimebase;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_IOTraceRecorder */
+
@@ -0,0 +1,233 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_Limiter.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_Limiter.h"
+
+// Local Includes
+#include "BGM_DSP.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+
+
+#pragma clang assume_nonnull begin
+
+// How far ahead the limiter looks for peaks. Long enough to turn the gain down smoothly over a few
+// cycles of all but the lowest frequencies, but short enough that the delay shouldn't be noticeable.
+static const Float64 kLookAheadSeconds = 0.002;
+// The time constant for the gain to recover after a peak.
+static const Float64 kReleaseSeconds = 0.05;
+
+BGM_Limiter::BGM_Limiter(Float64 inSampleRate, Float32 inCeiling)
+:
+    mCeiling(inCeiling),
+    mDelayLine((kMaxLookAheadFrames + kBlockFrames) * kChannels),
+    mBlockPeaks(kBlockFrames),
+    mBlockGains(kBlockFrames),
+    mMinQueueGains(kMaxLookAheadFrames + 1),
+    mMinQueueFrames(kMaxLookAheadFrames + 1),
+    mAverageHistory(kMaxLookAheadFrames + 1)
+{
+    ThrowIf(!(inCeiling > 0.0f),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_Limiter::BGM_Limiter: Invalid ceiling");
+
+    SetSampleRate(inSampleRate);
+}
+
+void    BGM_Limiter::SetSampleRate(Float64 inSampleRate)
+{
+    ThrowIf(!(inSampleRate >= 1.0),
+            CAException(kAudioDeviceUnsupportedFormatError),
+            "BGM_Limiter::SetSampleRate: Invalid sample rate");
+
+    mSampleRate = inSampleRate;
+    mLookAheadFrames =
+            static_cast<UInt32>(std::min<Float64>(kMaxLookAheadFrames,
+                                                  std::round(inSampleRate * kLookAheadSeconds)));
+    mWindowFrames = mLookAheadFrames + 1;
+    mReleaseCoefficient = static_cast<Float32>(std::exp(-1.0 / (kReleaseSeconds * inSampleRate)));
+
+    Reset();
+}
+
+void    BGM_Limiter::Reset() noexcept
+{
+    std::fill(mDelayLine.begin(), mDelayLine.end(), 0.0f);
+
+    mMinQueueHead = 0;
+    mMinQueueSize = 0;
+
+    std::fill(mAverageHistory.begin(), mAverageHistory.begin() + mWindowFrames, 1.0f);
+    mAverageIndex = 0;
+    mAverageSum = mWindowFrames;
+
+    mGain = 1.0f;
+    mFrameNumber = 0;
+}
+
+void    BGM_Limiter::ProcessRT(Float32* ioBuffer, UInt32 inFrameCount) noexcept
+{
+    while(inFrameCount > 0)
+    {
+        const UInt32 theBlockFrames = std::min(inFrameCount, kBlockFrames);
+
+        ProcessBlockRT(ioBuffer, theBlockFrames);
+
+        ioBuffer += theBlockFrames * kChannels;
+        inFrameCount -= theBlockFrames;
+    }
+}
+
+void    BGM_Limiter::ProcessBlockRT(Float32* ioBuffer, UInt32 inFrameCount) noexcept
+{
+    Float32* theDelayLine = mDelayLine.data();
+    Float32* theNewFrames = theDelayLine + mLookAheadFrames * kChannels;
+
+    // Add the new frames to the end of the delay line, after the frames from previous blocks that
+    // are still being delayed.
+    memcpy(theNewFrames, ioBuffer, inFrameCount * kChannels * sizeof(Float32));
+
+    // Find the peak of each new frame, i.e. max(|L|, |R|).
+    Float32* thePeaks = mBlockPeaks.data();
+    BGM_DSP::StereoFramePeaks(theNewFrames, thePeaks, inFrameCount);
+
+    // Work out the gain each frame needs to stay under the ceiling: ceiling / max(peak, ceiling).
+    // That's 1 for frames that are already under it. The compiler vectorises this loop.
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        thePeaks[i] = mCeiling / ((thePeaks[i] > mCeiling) ? thePeaks[i] : mCeiling);
+    }
+
+    FollowEnvelopeRT(inFrameCount);
+
+    // Apply the gains to the oldest frames in the delay line and write them to the buffer.
+    BGM_DSP::ScaleStereoFrames(theDelayLine, mBlockGains.data(), ioBuffer, inFrameCount);
+
+    // The envelope guarantees the output is under the ceiling, except for rounding errors, which
+    // this removes. It's cheap enough that it isn't worth trying to avoid.
+    const Float32 theFloor = -mCeiling;
+    BGM_DSP::Clip(ioBuffer, inFrameCount * kChannels, theFloor, mCeiling);
+
+    // Move the frames that are still being delayed to the start of the delay line.
+    memmove(theDelayLine,
+            theDelayLine + inFrameCount * kChannels,
+            mLookAheadFrames * kChannels * sizeof(Float32));
+}
+
+void    BGM_Limiter::FollowEnvelopeRT(UInt32 inFrameCount) noexcept
+{
+    // For each frame, this takes the minimum of the gains needed by the frames in the window, which
+    // is the new frame and the mLookAheadFrames before it, and then the moving average of those
+    // minimums over the same number of frames. The result is the gain for the frame leaving the
+    // delay line, which is mLookAheadFrames older than the new frame.
+    //
+    // The frame leaving the delay line is in the windows of all of the minimums being averaged, so
+    // every term in the average is at most the gain it needs, and so is the average. The averaging
+    // makes the gain ramp down linearly over the look-ahead instead of jumping down, and then the
+    // release makes it recover exponentially.
+    //
+    // This has to be done frame by frame, so it's kept as simple as possible.
+    const Float32* theNeededGains = mBlockPeaks.data();
+    Float32* theGains = mBlockGains.data();
+    const UInt32 theWindowFrames = mWindowFrames;
+
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        const Float32 theNeededGain = theNeededGains[i];
+
+        // Remove the gains that have left the window from the front of the queue.
+        if(mMinQueueSize > 0 && mMinQueueFrames[mMinQueueHead] + theWindowFrames <= mFrameNumber)
+        {
+            mMinQueueHead = (mMinQueueHead + 1 == theWindowFrames) ? 0 : mMinQueueHead + 1;
+            mMinQueueSize--;
+        }
+
+        // Remove the gains that can't be the minimum anymore from the back of the queue, then add
+        // the new frame's.
+        while(mMinQueueSize > 0)
+        {
+            UInt32 theBack = mMinQueueHead + mMinQueueSize - 1;
+            theBack = (theBack >= theWindowFrames) ? theBack - theWindowFrames : theBack;
+
+            if(mMinQueueGains[theBack] < theNeededGain)
+            {
+                break;
+            }
+
+            mMinQueueSize--;
+        }
+
+        UInt32 theNewBack = mMinQueueHead + mMinQueueSize;
+        theNewBack = (theNewBack >= theWindowFrames) ? theNewBack - theWindowFrames : theNewBack;
+        mMinQueueGains[theNewBack] = theNeededGain;
+        mMinQueueFrames[theNewBack] = mFrameNumber;
+        mMinQueueSize++;
+
+        const Float32 theWindowMin = mMinQueueGains[mMinQueueHead];
+
+        // Update the moving average.
+        mAverageSum += theWindowMin - mAverageHistory[mAverageIndex];
+        mAverageHistory[mAverageIndex] = theWindowMin;
+
+        if(++mAverageIndex == theWindowFrames)
+        {
+            mAverageIndex = 0;
+
+            // Recalculate the sum once per window so rounding errors can't build up.
+            mAverageSum = 0.0;
+
+            for(UInt32 j = 0; j < theWindowFrames; j++)
+            {
+                mAverageSum += mAverageHistory[j];
+            }
+        }
+
+        const Float32 theAverage = static_cast<Float32>(mAverageSum / theWindowFrames);
+
+        // Turn the gain down immediately, since the averaging has already smoothed it, but release
+        // it slowly.
+        if(theAverage < mGain)
+        {
+            mGain = theAverage;
+        }
+        else
+        {
+            mGain = theAverage + (mGain - theAverage) * mReleaseCoefficient;
+        }
+
+        theGains[i] = mGain;
+        mFrameNumber++;
+    }
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,141 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_Limiter.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  A look-ahead brickwall limiter for stereo, interleaved audio. BGM_Device runs the mixed output
+//  through it, when kAudioDeviceCustomPropertyBoostLimiter is enabled, so boosting apps' volumes
+//  above 100% doesn't make them clip.
+//
+//  The audio is delayed by a couple of milliseconds (see GetLatencyFrames) so the limiter can see
+//  peaks coming and turn the gain down smoothly before they arrive, rather than clipping them. The
+//  gain for each frame is the moving average of the minimum gain any frame in the look-ahead
+//  window needs, which guarantees the output never goes over the ceiling. After a peak, the gain
+//  holds for the length of the window and then recovers exponentially.
+//
+//  The per-frame peak detection and applying the gain are done with BGM_DSP. Only the envelope
+//  follower itself, which is recursive, runs sample by sample.
+//
+//  ProcessRT is real-time safe. The other methods aren't, and the caller has to make sure they
+//  aren't called during ProcessRT.
+//
+
+#ifndef BGMDriver__BGM_Limiter
+#define BGMDriver__BGM_Limiter
+
+// STL Includes
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_Limiter
+{
+
+public:
+    // The limiter only handles stereo audio, like the rest of BGMDriver.
+    static const UInt32         kChannels = 2;
+    // The longest look-ahead the limiter supports, in frames. At very high sample rates, the
+    // look-ahead is shortened to this.
+    static const UInt32         kMaxLookAheadFrames = 1024;
+    // ProcessRT processes the audio in blocks of this many frames, so it can use fixed-size
+    // scratch buffers.
+    static const UInt32         kBlockFrames = 256;
+
+    /*!
+     @param inSampleRate The sample rate of the audio, which sets the look-ahead and release times.
+     @param inCeiling The highest absolute sample value the limiter will output. Must be positive.
+     @throws CAException if the sample rate or ceiling is invalid.
+     */
+                                BGM_Limiter(Float64 inSampleRate, Float32 inCeiling = 1.0f);
+                                ~BGM_Limiter() = default;
+                                // Disallow copying
+                                BGM_Limiter(const BGM_Limiter&) = delete;
+                                BGM_Limiter& operator=(const BGM_Limiter&) = delete;
+
+    /*!
+     Change the sample rate. Also resets the limiter, since the audio it's holding would be at the
+     old sample rate.
+
+     @throws CAException if the sample rate is invalid.
+     */
+    void                        SetSampleRate(Float64 inSampleRate);
+    Float64                     GetSampleRate() const noexcept { return mSampleRate; }
+    Float32                     GetCeiling() const noexcept { return mCeiling; }
+
+    /*! The number of frames the limiter delays the audio by, which is the length of the look-ahead. */
+    UInt32                      GetLatencyFrames() const noexcept { return mLookAheadFrames; }
+
+    /*! Discard the delayed audio and reset the gain to unity, e.g. before IO starts. */
+    void                        Reset() noexcept;
+
+    /*!
+     Limit a buffer of audio in place. The output is delayed by GetLatencyFrames frames.
+
+     @param ioBuffer The audio, as kChannels interleaved Float32 channels.
+     @param inFrameCount The number of frames in ioBuffer. Can be any size.
+     */
+    void                        ProcessRT(Float32* ioBuffer, UInt32 inFrameCount) noexcept;
+
+private:
+    void                        ProcessBlockRT(Float32* ioBuffer, UInt32 inFrameCount) noexcept;
+    /*! Compute the gain for each frame from the gains the frames need. See BGM_Limiter.cpp. */
+    void                        FollowEnvelopeRT(UInt32 inFrameCount) noexcept;
+
+    const Float32               mCeiling;
+    Float64                     mSampleRate = 0.0;
+    UInt32                      mLookAheadFrames = 0;
+    // The length of the window the minimum is taken over, which is also the length of the moving
+    // average. Always mLookAheadFrames + 1.
+    UInt32                      mWindowFrames = 1;
+    Float32                     mReleaseCoefficient = 0.0f;
+
+    // The delayed audio, followed by room for the block being processed.
+    std::vector<Float32>        mDelayLine;
+    // Scratch buffers for the block being processed. Hold the gain each frame needs, then the gain
+    // to apply to each frame.
+    std::vector<Float32>        mBlockPeaks;
+    std::vector<Float32>        mBlockGains;
+
+    // The sliding window minimum, kept as a queue of (gain, frame number) pairs with increasing
+    // gains. The front of the queue is the minimum. Stored in a ring of mWindowFrames slots.
+    std::vector<Float32>        mMinQueueGains;
+    std::vector<UInt64>         mMinQueueFrames;
+    UInt32                      mMinQueueHead = 0;
+    UInt32                      mMinQueueSize = 0;
+
+    // The last mWindowFrames window minimums and their sum, for the moving average.
+    std::vector<Float32>        mAverageHistory;
+    UInt32                      mAverageIndex = 0;
+    Float64                     mAverageSum = 0.0;
+
+    // The gain applied to the previous frame.
+    Float32                     mGain = 1.0f;
+    // The number of frames processed since the last reset.
+    UInt64                      mFrameNumber = 0;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_Limiter */
+
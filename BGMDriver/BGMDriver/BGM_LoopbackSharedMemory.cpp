@@ -0,0 +1,311 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_LoopbackSharedMemory.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_LoopbackSharedMemory.h"
+
+// Local Includes
+#include "BGM_Utils.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+#include "CADebugMacros.h"
+
+// STL Includes
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#pragma clang assume_nonnull begin
+
+// The header fields readers poll are only ever written by this class, so the writer can read them
+// back without synchronisation. Stores use the GCC/Clang atomic builtins rather than std::atomic
+// because the header has to have the same layout as the plain C struct readers use.
+#define BGMStoreRelease(field, value)   __atomic_store_n(&(field), (value), __ATOMIC_RELEASE)
+#define BGMStoreRelaxed(field, value)   __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+// If the user has created the kBGMLoopbackReadersGroupName group, let its members read the segment.
+// Leaves it readable only by coreaudiod's user if the group doesn't exist or anything fails.
+static void ShareWithReadersGroup(int inFD, const char* inName)
+{
+    // getgrnam isn't thread safe.
+    struct group theGroup;
+    struct group* __nullable theResult = nullptr;
+    char theBuffer[4096];
+
+    if(getgrnam_r(kBGMLoopbackReadersGroupName, &theGroup, theBuffer, sizeof(theBuffer), &theResult) != 0 ||
+       theResult == nullptr)
+    {
+        return;
+    }
+
+    // Change the group first, so the segment is never readable by the group it was created with.
+    // (fchown fails unless _coreaudiod is a member of the readers group.)
+    if(fchown(inFD, static_cast<uid_t>(-1), theGroup.gr_gid) != 0 ||
+       fchmod(inFD, S_IRUSR | S_IWUSR | S_IRGRP) != 0)
+    {
+        LogWarning("BGM_LoopbackSharedMemory::Open: Couldn't share %s with the %s group. errno=%d",
+                   inName,
+                   kBGMLoopbackReadersGroupName,
+                   errno);
+    }
+}
+
+BGM_LoopbackSharedMemory::~BGM_LoopbackSharedMemory()
+{
+    Close();
+}
+
+UInt32  BGM_LoopbackSharedMemory::GetCapacityFramesForSampleRate(Float64 inSampleRate) noexcept
+{
+    // The upper limit is just so an absurd sample rate can't overflow the capacity. (BGMDevice
+    // accepts rates up to 1 GHz.)
+    const UInt32 kMaxCapacityFrames = 1 << 22;
+
+    UInt32 theCapacity = kMinCapacityFrames;
+
+    // Compare theCapacity / inSampleRate with kMinCapacityFrames / 48000 without dividing, so the
+    // rounding can't push 48 kHz itself over.
+    while((theCapacity < kMaxCapacityFrames) &&
+          (theCapacity * 48000.0 < kMinCapacityFrames * inSampleRate))
+    {
+        theCapacity *= 2;
+    }
+
+    return theCapacity;
+}
+
+void    BGM_LoopbackSharedMemory::Open(const char* inName,
+                                       UInt32 inChannelsPerFrame,
+                                       UInt32 inCapacityFrames,
+                                       Float64 inSampleRate)
+{
+    ThrowIf(inChannelsPerFrame == 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_LoopbackSharedMemory::Open: inChannelsPerFrame must not be 0");
+    ThrowIf(inCapacityFrames == 0 || (inCapacityFrames & (inCapacityFrames - 1)) != 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_LoopbackSharedMemory::Open: inCapacityFrames must be a power of two");
+
+    Close();
+
+    // Remove any segment left behind by a previous instance of the driver, e.g. if coreaudiod
+    // crashed. We create a new one rather than reuse it in case its layout is different.
+    shm_unlink(inName);
+
+    // The segment has the same audio as BGMDevice's input stream, which apps can only read after
+    // the user has given them microphone access. Shared memory would bypass that check, so only the
+    // driver can read the segment unless the user has opted in by creating the readers group.
+    int theFD = shm_open(inName, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+
+    if(theFD < 0)
+    {
+        LogError("BGM_LoopbackSharedMemory::Open: shm_open failed for %s. errno=%d",
+                 inName,
+                 errno);
+        Throw(CAException(kAudioHardwareUnspecifiedError));
+    }
+
+    ShareWithReadersGroup(theFD, inName);
+
+    const UInt32 theBytesPerFrame = inChannelsPerFrame * sizeof(Float32);
+    const size_t theSize = kBGMLoopbackSegmentDataOffset +
+            (static_cast<size_t>(inCapacityFrames) * theBytesPerFrame);
+
+    void* theMapping = MAP_FAILED;
+
+    if(ftruncate(theFD, static_cast<off_t>(theSize)) == 0)
+    {
+        theMapping = mmap(nullptr, theSize, PROT_READ | PROT_WRITE, MAP_SHARED, theFD, 0);
+    }
+
+    int theErrno = errno;
+    close(theFD);
+
+    if(theMapping == MAP_FAILED)
+    {
+        LogError("BGM_LoopbackSharedMemory::Open: Failed to map %s. errno=%d",
+                 inName,
+                 theErrno);
+        shm_unlink(inName);
+        Throw(CAException(kAudioHardwareUnspecifiedError));
+    }
+
+    // Touch every page now so the IO thread doesn't page fault the first time it writes to them.
+    memset(theMapping, 0, theSize);
+
+    mName = inName;
+    mMappedSize = theSize;
+    mHeader = reinterpret_cast<BGMLoopbackSegmentHeader*>(theMapping);
+    mData = reinterpret_cast<Float32*>(reinterpret_cast<char*>(theMapping) +
+                                       kBGMLoopbackSegmentDataOffset);
+
+    mHeader->mHeaderSize = sizeof(BGMLoopbackSegmentHeader);
+    mHeader->mDataOffset = kBGMLoopbackSegmentDataOffset;
+    mHeader->mChannelsPerFrame = inChannelsPerFrame;
+    mHeader->mBytesPerFrame = theBytesPerFrame;
+    mHeader->mCapacityFrames = inCapacityFrames;
+    mHeader->mSampleRate = inSampleRate;
+    mHeader->mVersion = kBGMLoopbackSegmentVersion;
+
+    // Readers check the magic number last, so it has to be written after everything else.
+    BGMStoreRelease(mHeader->mMagic, kBGMLoopbackSegmentMagic);
+
+    DebugMsg("BGM_LoopbackSharedMemory::Open: Opened %s (%zu bytes)", inName, theSize);
+}
+
+void    BGM_LoopbackSharedMemory::Close() noexcept
+{
+    if(mHeader != nullptr)
+    {
+        // Clear the magic number so readers that still have the segment mapped know it's dead.
+        BGMStoreRelease(mHeader->mMagic, 0u);
+
+        munmap(mHeader, mMappedSize);
+        shm_unlink(mName.c_str());
+
+        mHeader = nullptr;
+        mData = nullptr;
+        mMappedSize = 0;
+    }
+}
+
+void    BGM_LoopbackSharedMemory::SetSampleRate(Float64 inSampleRate) noexcept
+{
+    if(mHeader != nullptr)
+    {
+        // A sequence lock, so readers never see a partially written Float64.
+        UInt64 theSequence = mHeader->mFormatSequence;
+        BGMStoreRelaxed(mHeader->mFormatSequence, theSequence + 1);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        mHeader->mSampleRate = inSampleRate;
+        BGMStoreRelease(mHeader->mFormatSequence, theSequence + 2);
+    }
+}
+
+void    BGM_LoopbackSharedMemory::Store(const Float32* inBuffer,
+                                        UInt32 inFrameCount,
+                                        SInt64 inSampleTime) noexcept
+{
+    if(mHeader == nullptr || inFrameCount == 0)
+    {
+        return;
+    }
+
+    const UInt32 theCapacity = mHeader->mCapacityFrames;
+
+    // Only the most recent frames would survive anyway.
+    if(inFrameCount > theCapacity)
+    {
+        inBuffer += static_cast<size_t>(inFrameCount - theCapacity) * mHeader->mChannelsPerFrame;
+        inSampleTime += inFrameCount - theCapacity;
+        inFrameCount = theCapacity;
+    }
+
+    const SInt64 thePreviousEnd = mHeader->mWriteEndSampleTime;
+    const SInt64 theNewEnd = inSampleTime + inFrameCount;
+
+    // Reset if this is the first write, if time went backwards (normally because IO restarted) or
+    // if there's a gap at least as large as the ring.
+    const bool theIsReset = (mHeader->mWriteCount == 0) ||
+                            (inSampleTime < thePreviousEnd) ||
+                            (inSampleTime - thePreviousEnd >= theCapacity);
+
+    UInt64 theResetCount = mHeader->mResetCount;
+
+    if(theIsReset)
+    {
+        // mResetCount is odd while the sample times are inconsistent. Readers that see an odd value,
+        // or see it change while they read, throw their data away.
+        BGMStoreRelaxed(mHeader->mResetCount, theResetCount + 1);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        BGMStoreRelaxed(mHeader->mValidStartSampleTime, inSampleTime);
+        BGMStoreRelaxed(mHeader->mWriteInProgressEndSampleTime, theNewEnd);
+        BGMStoreRelaxed(mHeader->mWriteEndSampleTime, inSampleTime);
+    }
+    else
+    {
+        // Tell readers these frames are about to be overwritten before actually overwriting them.
+        BGMStoreRelaxed(mHeader->mWriteInProgressEndSampleTime, theNewEnd);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        // Fill any gap with silence, like CARingBuffer does.
+        if(inSampleTime > thePreviousEnd)
+        {
+            CopyIntoRing(nullptr,
+                         static_cast<UInt32>(inSampleTime - thePreviousEnd),
+                         thePreviousEnd);
+        }
+    }
+
+    CopyIntoRing(inBuffer, inFrameCount, inSampleTime);
+
+    BGMStoreRelaxed(mHeader->mWriteCount, mHeader->mWriteCount + 1);
+    BGMStoreRelease(mHeader->mWriteEndSampleTime, theNewEnd);
+
+    if(theIsReset)
+    {
+        BGMStoreRelease(mHeader->mResetCount, theResetCount + 2);
+    }
+}
+
+void    BGM_LoopbackSharedMemory::CopyIntoRing(const Float32* __nullable inBuffer,
+                                               UInt32 inFrameCount,
+                                               SInt64 inSampleTime) noexcept
+{
+    const UInt32 theCapacity = mHeader->mCapacityFrames;
+    const UInt32 theBytesPerFrame = mHeader->mBytesPerFrame;
+    const UInt32 theChannels = mHeader->mChannelsPerFrame;
+
+    // The frames might wrap around to the start of the ring, so copy them in up to two parts.
+    UInt32 theOffsetFrames = static_cast<UInt32>(inSampleTime & (theCapacity - 1));
+    UInt32 theFirstPartFrames = std::min(inFrameCount, theCapacity - theOffsetFrames);
+    UInt32 theSecondPartFrames = inFrameCount - theFirstPartFrames;
+
+    Float32* theFirstPart = mData + (static_cast<size_t>(theOffsetFrames) * theChannels);
+
+    if(inBuffer == nullptr)
+    {
+        memset(theFirstPart, 0, theFirstPartFrames * theBytesPerFrame);
+        memset(mData, 0, theSecondPartFrames * theBytesPerFrame);
+    }
+    else
+    {
+        memcpy(theFirstPart, inBuffer, theFirstPartFrames * theBytesPerFrame);
+        memcpy(mData,
+               inBuffer + (static_cast<size_t>(theFirstPartFrames) * theChannels),
+               theSecondPartFrames * theBytesPerFrame);
+    }
+}
+
+#pragma clang assume_nonnull end
+
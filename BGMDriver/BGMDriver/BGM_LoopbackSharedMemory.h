@@ -0,0 +1,123 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_LoopbackSharedMemory.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The writer side of a loopback shared memory segment. BGM_Device mirrors the audio it stores in
+//  its loopback ring buffer into one of these so local processes can read the device's output
+//  without becoming HAL clients. See BGM_LoopbackLayout.h for the segment layout and the protocol
+//  readers use, and SharedSource/LoopbackReader for the reader library.
+//
+//  Open and Close aren't real-time safe. Store is real-time safe and never waits for readers.
+//  Not thread safe.
+//
+
+#ifndef BGMDriver__BGM_LoopbackSharedMemory
+#define BGMDriver__BGM_LoopbackSharedMemory
+
+// Local Includes
+#include "BGM_LoopbackLayout.h"
+
+// STL Includes
+#include <string>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_LoopbackSharedMemory
+{
+
+public:
+                                BGM_LoopbackSharedMemory() = default;
+                                ~BGM_LoopbackSharedMemory();
+                                // Disallow copying
+                                BGM_LoopbackSharedMemory(const BGM_LoopbackSharedMemory&) = delete;
+                                BGM_LoopbackSharedMemory& operator=(const BGM_LoopbackSharedMemory&) = delete;
+
+    // The smallest ring capacity GetCapacityFramesForSampleRate returns, which is its capacity at
+    // 48 kHz and lower rates.
+    static const UInt32         kMinCapacityFrames = 16384;
+
+    /*!
+     @return The capacity, in frames, of a ring that holds at least as much audio at inSampleRate as
+             kMinCapacityFrames frames at 48 kHz (about a third of a second). Always a power of two,
+             so 16384 up to 48 kHz, 32768 for 88.2 and 96 kHz and 65536 for 176.4 and 192 kHz.
+     */
+    static UInt32               GetCapacityFramesForSampleRate(Float64 inSampleRate) noexcept;
+
+    /*!
+     Create (or recreate) the named segment, map it and initialise its header. Any existing segment
+     with the same name is unlinked first, so readers that still have the old one mapped will stop
+     seeing new audio and should reopen it.
+
+     Not real-time safe.
+
+     @param inName The POSIX shared memory name, e.g. kBGMLoopbackSegmentName.
+     @param inChannelsPerFrame The number of interleaved Float32 channels in each frame.
+     @param inCapacityFrames The size of the ring. Must be a power of two.
+     @param inSampleRate The sample rate of the audio, for readers.
+     @throws CAException if the segment can't be created or mapped.
+     */
+    void                        Open(const char* inName,
+                                     UInt32 inChannelsPerFrame,
+                                     UInt32 inCapacityFrames,
+                                     Float64 inSampleRate);
+    /*! Unmap and unlink the segment, if it's open. Not real-time safe. */
+    void                        Close() noexcept;
+
+    bool                        IsOpen() const noexcept { return mHeader != nullptr; }
+
+    /*!
+     Update the sample rate readers see. Doesn't clear the ring, but the device will normally have
+     restarted IO, so the next call to Store will reset the sample times anyway.
+     */
+    void                        SetSampleRate(Float64 inSampleRate) noexcept;
+
+    /*!
+     Copy some frames of audio into the segment and publish them to readers.
+
+     Real-time safe. Never blocks, even if readers are reading the frames being overwritten.
+
+     @param inBuffer The audio, interleaved, with the number of channels passed to Open.
+     @param inFrameCount The number of frames in inBuffer. Should be less than the capacity.
+     @param inSampleTime The sample time of the first frame in inBuffer.
+     */
+    void                        Store(const Float32* inBuffer,
+                                      UInt32 inFrameCount,
+                                      SInt64 inSampleTime) noexcept;
+
+private:
+    void                        CopyIntoRing(const Float32* __nullable inBuffer,
+                                             UInt32 inFrameCount,
+                                             SInt64 inSampleTime) noexcept;
+
+    std::string                 mName;
+    size_t                      mMappedSize = 0;
+    BGMLoopbackSegmentHeader* __nullable mHeader = nullptr;
+    Float32* __nullable         mData = nullptr;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_LoopbackSharedMemory */
+
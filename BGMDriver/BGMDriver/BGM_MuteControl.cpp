@@ -25,6 +25,7 @@
 
 // Local Includes
 #include "BGM_PlugIn.h"
+#include "BGM_PropertyTable.h"
 
 // PublicUtility Includes
 #include "CADebugMacros.h"
@@ -54,6 +55,16 @@ BGM_MuteControl::BGM_MuteControl(AudioObjectID inObjectID,
 
 #pragma mark Property Operations
 
+// The properties BGM_MuteControl implements.
+static constexpr BGM_PropertyInfo kMuteControlProperties[] = {
+    { kAudioBooleanControlPropertyValue, BGM_PropertyScopes::Any, true, sizeof(UInt32), kAudioServerPlugInCustomPropertyDataTypeNone }
+};
+
+static_assert(BGM_PropertyTable::IsSorted(kMuteControlProperties),
+              "kMuteControlProperties must be sorted by selector");
+
+static constexpr BGM_PropertyTable sMuteControlProperties(kMuteControlProperties);
+
 bool    BGM_MuteControl::HasProperty(AudioObjectID inObjectID,
                                      pid_t inClientPID,
                                      const AudioObjectPropertyAddress& inAddress) const
@@ -61,17 +72,16 @@ bool    BGM_MuteControl::HasProperty(AudioObjectID inObjectID,
     CheckObjectID(inObjectID);
 
     bool theAnswer = false;
+    const BGM_PropertyInfo* theInfo = sMuteControlProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioBooleanControlPropertyValue:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Control::HasProperty(inObjectID, inClientPID, inAddress);
-            break;
-    };
+        theAnswer = BGM_PropertyTable::HasScope(*theInfo, inAddress.mScope);
+    }
+    else
+    {
+        theAnswer = BGM_Control::HasProperty(inObjectID, inClientPID, inAddress);
+    }
 
     return theAnswer;
 }
@@ -83,17 +93,16 @@ bool    BGM_MuteControl::IsPropertySettable(AudioObjectID inObjectID,
     CheckObjectID(inObjectID);
 
     bool theAnswer = false;
+    const BGM_PropertyInfo* theInfo = sMuteControlProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioBooleanControlPropertyValue:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Control::IsPropertySettable(inObjectID, inClientPID, inAddress);
-            break;
-    };
+        theAnswer = theInfo->mIsSettable;
+    }
+    else
+    {
+        theAnswer = BGM_Control::IsPropertySettable(inObjectID, inClientPID, inAddress);
+    }
 
     return theAnswer;
 }
@@ -107,21 +116,20 @@ UInt32  BGM_MuteControl::GetPropertyDataSize(AudioObjectID inObjectID,
     CheckObjectID(inObjectID);
 
     UInt32 theAnswer = 0;
+    const BGM_PropertyInfo* theInfo = sMuteControlProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioBooleanControlPropertyValue:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        default:
-            theAnswer = BGM_Control::GetPropertyDataSize(inObjectID,
-                                                         inClientPID,
-                                                         inAddress,
-                                                         inQualifierDataSize,
-                                                         inQualifierData);
-            break;
-    };
+        theAnswer = theInfo->mDataSize;
+    }
+    else
+    {
+        theAnswer = BGM_Control::GetPropertyDataSize(inObjectID,
+                                                     inClientPID,
+                                                     inAddress,
+                                                     inQualifierDataSize,
+                                                     inQualifierData);
+    }
 
     return theAnswer;
 }
@@ -24,6 +24,7 @@
 #include "BGM_NullDevice.h"
 
 // Local Includes
+#include "BGM_ObjectRegistry.h"
 #include "BGM_PlugIn.h"
 
 // PublicUtility Includes
@@ -55,6 +56,7 @@ void    BGM_NullDevice::StaticInitializer()
     try
     {
         sInstance = new BGM_NullDevice;
+        sInstance->RegisterObjects();
         // Note that we leave the device inactive initially. BGMApp will activate it when needed.
     }
     catch(...)
@@ -78,6 +80,12 @@ BGM_NullDevice::~BGM_NullDevice()
 {
 }
 
+void    BGM_NullDevice::RegisterObjects()
+{
+    BGM_AbstractDevice::RegisterObjects();
+    BGM_ObjectRegistry::RegisterObject(mStream, *this);
+}
+
 void    BGM_NullDevice::Activate()
 {
     CAMutex::Locker theStateLocker(mStateMutex);
@@ -404,7 +412,7 @@ void    BGM_NullDevice::StartIO(UInt32 inClientID)
     {
         // Reset the clock.
         mNumberTimeStamps = 0;
-        mAnchorHostTime = CAHostTimeBase::GetTheCurrentTime();
+        mAnchorHostTime = BGM_PlugIn::Host_GetCurrentTime();
 
         // Send notifications.
         DebugMsg("BGM_NullDevice::StartIO: Sending kAudioDevicePropertyDeviceIsRunning");
@@ -454,7 +462,7 @@ void    BGM_NullDevice::GetZeroTimeStamp(Float64& outSampleTime,
     // clockless devices don't need to, but if the device doesn't have
     // kAudioDevicePropertyZeroTimeStampPeriod the HAL seems to reject it. So we give it a simple
     // clock similar to the loopback clock in BGM_Device.
-    UInt64 theCurrentHostTime = CAHostTimeBase::GetTheCurrentTime();
+    UInt64 theCurrentHostTime = BGM_PlugIn::Host_GetCurrentTime();
 
     // Calculate the next host time.
     Float64 theHostTicksPerPeriod = mHostTicksPerFrame * static_cast<Float64>(kZeroTimeStampPeriod);
@@ -73,6 +73,7 @@ protected:
     virtual                     ~BGM_NullDevice();
 
 public:
+    virtual void                RegisterObjects();
     virtual void                Activate();
     virtual void                Deactivate();
 
@@ -30,6 +30,9 @@
 //	Self Include
 #include "BGM_Object.h"
 
+//	Local Includes
+#include "BGM_ObjectRegistry.h"
+
 //	PublicUtility Includes
 #include "CADebugMacros.h"
 #include "CAException.h"
@@ -64,6 +67,8 @@ void	BGM_Object::Deactivate()
 
 BGM_Object::~BGM_Object()
 {
+	//	make sure the HAL can't find the object once it's gone
+	BGM_ObjectRegistry::Unregister(*this);
 }
 
 #pragma mark Property Operations
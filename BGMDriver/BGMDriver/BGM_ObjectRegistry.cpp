@@ -0,0 +1,211 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_ObjectRegistry.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_ObjectRegistry.h"
+
+// Local Includes
+#include "BGM_AbstractDevice.h"
+#include "BGM_Object.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+#include "CADebugMacros.h"
+#include "CAMutex.h"
+
+// System Includes
+#include <unistd.h>
+
+
+#pragma clang assume_nonnull begin
+
+constexpr AudioObjectID      BGM_ObjectRegistry::kMaxObjects;
+
+// Static storage, so the entries are zeroed before any code runs and there's nothing to initialise.
+BGM_ObjectRegistry::Entry   BGM_ObjectRegistry::sEntries[BGM_ObjectRegistry::kMaxObjects];
+std::atomic<UInt32>         BGM_ObjectRegistry::sCallEpoch;
+std::atomic<UInt32>         BGM_ObjectRegistry::sCallsInProgress[2];
+
+#pragma mark Registration
+
+void    BGM_ObjectRegistry::RegisterObject(BGM_Object& inObject, BGM_Object& inOwner)
+{
+    Register(inObject, inOwner, nullptr);
+}
+
+void    BGM_ObjectRegistry::RegisterDevice(BGM_AbstractDevice& inDevice)
+{
+    Register(inDevice, inDevice, &inDevice);
+}
+
+void    BGM_ObjectRegistry::Register(BGM_Object& inObject,
+                                     BGM_Object& inOwner,
+                                     BGM_AbstractDevice* __nullable inDevice)
+{
+    const AudioObjectID theObjectID = inObject.GetObjectID();
+
+    ThrowIf(theObjectID == kAudioObjectUnknown || theObjectID >= kMaxObjects,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_ObjectRegistry::Register: Object ID out of range");
+
+    Entry& theEntry = sEntries[theObjectID];
+
+    // Claim the entry first, so two objects with the same ID can't both register.
+    BGM_Object* theExpected = nullptr;
+
+    if(!theEntry.mObject.compare_exchange_strong(theExpected, &inObject) && theExpected != &inObject)
+    {
+        LogError("BGM_ObjectRegistry::Register: Object ID %u is already registered", theObjectID);
+        Throw(CAException(kAudioHardwareIllegalOperationError));
+    }
+
+    // Lookups only read these, so they can't see a partially registered object.
+    theEntry.mDevice.store(inDevice, std::memory_order_release);
+    theEntry.mOwner.store(&inOwner, std::memory_order_release);
+}
+
+void    BGM_ObjectRegistry::Unregister(const BGM_Object& inObject) noexcept
+{
+    const AudioObjectID theObjectID = inObject.GetObjectID();
+
+    if(theObjectID < kMaxObjects)
+    {
+        Entry& theEntry = sEntries[theObjectID];
+
+        // Only remove the entry if it's for this object. Another object with the same ID could have
+        // registered, e.g. in the tests, which create their own devices.
+        if(theEntry.mObject.load(std::memory_order_acquire) == &inObject)
+        {
+            theEntry.mOwner.store(nullptr, std::memory_order_release);
+            theEntry.mDevice.store(nullptr, std::memory_order_release);
+            theEntry.mObject.store(nullptr, std::memory_order_release);
+        }
+    }
+}
+
+void    BGM_ObjectRegistry::UnregisterOwner(const BGM_Object& inOwner) noexcept
+{
+    for(Entry& theEntry : sEntries)
+    {
+        if(theEntry.mOwner.load(std::memory_order_acquire) == &inOwner)
+        {
+            theEntry.mOwner.store(nullptr, std::memory_order_release);
+            theEntry.mDevice.store(nullptr, std::memory_order_release);
+            theEntry.mObject.store(nullptr, std::memory_order_release);
+        }
+    }
+}
+
+#pragma mark Lookup
+
+BGM_Object&    BGM_ObjectRegistry::GetOwnerObject(AudioObjectID inObjectID)
+{
+    BGM_Object* theOwner = nullptr;
+
+    if(inObjectID < kMaxObjects)
+    {
+        theOwner = sEntries[inObjectID].mOwner.load(std::memory_order_acquire);
+    }
+
+    if(theOwner == nullptr)
+    {
+        DebugMsg("BGM_ObjectRegistry::GetOwnerObject: unknown object %u", inObjectID);
+        Throw(CAException(kAudioHardwareBadObjectError));
+    }
+
+    return *theOwner;
+}
+
+BGM_AbstractDevice&    BGM_ObjectRegistry::GetDevice(AudioObjectID inObjectID)
+{
+    BGM_AbstractDevice* theDevice = nullptr;
+
+    if(inObjectID < kMaxObjects)
+    {
+        theDevice = sEntries[inObjectID].mDevice.load(std::memory_order_acquire);
+    }
+
+    if(theDevice == nullptr)
+    {
+        DebugMsg("BGM_ObjectRegistry::GetDevice: unknown device %u", inObjectID);
+        Throw(CAException(kAudioHardwareBadDeviceError));
+    }
+
+    return *theDevice;
+}
+
+BGM_Object* __nullable    BGM_ObjectRegistry::FindObject(AudioObjectID inObjectID) noexcept
+{
+    return (inObjectID < kMaxObjects) ?
+            sEntries[inObjectID].mObject.load(std::memory_order_acquire) :
+            nullptr;
+}
+
+#pragma mark Call Tracking
+
+BGM_ObjectRegistry::CallScope::CallScope() noexcept
+{
+    while(true)
+    {
+        const UInt32 theEpoch = sCallEpoch.load();
+        mCounter = theEpoch & 1;
+        sCallsInProgress[mCounter].fetch_add(1);
+
+        // Pairs with the fence in WaitForCallsToFinish. Either it sees this call in its counter or
+        // this call's lookups see the objects it was waiting for as unregistered.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        // If WaitForCallsToFinish switched counters in the meantime, it might not have seen this
+        // call, so count it in the new counter instead.
+        if(sCallEpoch.load() == theEpoch)
+        {
+            break;
+        }
+
+        sCallsInProgress[mCounter].fetch_sub(1);
+    }
+}
+
+BGM_ObjectRegistry::CallScope::~CallScope()
+{
+    sCallsInProgress[mCounter].fetch_sub(1, std::memory_order_release);
+}
+
+void    BGM_ObjectRegistry::WaitForCallsToFinish()
+{
+    // Only one caller at a time can switch counters, or a second caller could switch back to the
+    // counter the first is waiting on.
+    static CAMutex sMutex("BGM_ObjectRegistry::WaitForCallsToFinish");
+    CAMutex::Locker theLocker(sMutex);
+
+    const UInt32 theCounter = sCallEpoch.fetch_add(1) & 1;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // The HAL's calls are short, except for StartIO, which waits for BGMApp, so polling is fine.
+    while(sCallsInProgress[theCounter].load(std::memory_order_acquire) != 0)
+    {
+        usleep(1000);
+    }
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,163 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_ObjectRegistry.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The driver's object map. Maps the AudioObjectIDs the HAL passes to BGM_PlugInInterface to the
+//  objects that handle them, so finding an object is one bounds-checked array access instead of a
+//  switch over every ID the driver knows about.
+//
+//  Objects are added when they're published, i.e. after they're constructed and before they're
+//  activated, and removed when they're destroyed. (The null device is published while inactive,
+//  because the HAL can still ask it about its properties then.) Nothing has to know the IDs of the
+//  other objects ahead of time, so devices can be created while the driver is running.
+//
+//  Each ID maps to two objects:
+//
+//   - The object itself.
+//   - Its owner, which is where BGM_PlugInInterface sends the HAL's calls for the ID. For the
+//     plug-in and devices, it's the object itself. For streams and controls, it's their device,
+//     which answers for them so it can react to changes to them, e.g. stream format changes.
+//
+//  Lookups are lock-free, so they can be done from any thread, including IO threads. Since the
+//  registry doesn't own the objects, BGM_PlugInInterface wraps each call from the HAL in a
+//  CallScope, and whatever destroys an object that was registered while the driver is running has
+//  to unregister it and then call WaitForCallsToFinish first. Otherwise a call that looked the
+//  object up just before it was unregistered could still be using it.
+//
+
+#ifndef BGMDriver__BGM_ObjectRegistry
+#define BGMDriver__BGM_ObjectRegistry
+
+// STL Includes
+#include <atomic>
+
+// System Includes
+#include <CoreAudio/AudioServerPlugIn.h>
+
+
+// Forward Declarations
+class BGM_Object;
+class BGM_AbstractDevice;
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_ObjectRegistry
+{
+
+public:
+    // Object IDs have to be less than this.
+    static constexpr AudioObjectID  kMaxObjects = 256;
+
+#pragma mark Registration
+
+    /*!
+     Adds inObject to the registry under its object ID.
+
+     @param inOwner The object BGM_PlugInInterface should send the HAL's calls for inObject to.
+     @throws CAException kAudioHardwareIllegalOperationError if the ID is out of range or another
+                         object is already registered with it.
+     */
+    static void                     RegisterObject(BGM_Object& inObject, BGM_Object& inOwner);
+    /*! Adds inDevice to the registry under its object ID, as its own owner. */
+    static void                     RegisterDevice(BGM_AbstractDevice& inDevice);
+    /*! Removes inObject from the registry. Does nothing if it isn't registered. */
+    static void                     Unregister(const BGM_Object& inObject) noexcept;
+    /*!
+     Removes inOwner and every object it owns from the registry, so the HAL can't reach them while
+     they're being torn down. Used when a device is removed while the driver is running.
+     */
+    static void                     UnregisterOwner(const BGM_Object& inOwner) noexcept;
+
+#pragma mark Lookup
+
+    /*!
+     @return The object that handles the HAL's calls for inObjectID.
+     @throws CAException kAudioHardwareBadObjectError if no object has that ID.
+     */
+    static BGM_Object&              GetOwnerObject(AudioObjectID inObjectID);
+    /*!
+     @return The device with the ID inObjectID.
+     @throws CAException kAudioHardwareBadDeviceError if no device has that ID.
+     */
+    static BGM_AbstractDevice&      GetDevice(AudioObjectID inObjectID);
+    /*! @return The object with the ID inObjectID, or null if there isn't one. */
+    static BGM_Object* __nullable   FindObject(AudioObjectID inObjectID) noexcept;
+
+#pragma mark Call Tracking
+
+    /*!
+     Marks a call from the HAL as in progress while it exists. Create one before looking objects up
+     and keep it until the call is finished with them. Real-time safe.
+     */
+    class CallScope
+    {
+
+    public:
+                                    CallScope() noexcept;
+                                    ~CallScope();
+                                    // Disallow copying
+                                    CallScope(const CallScope&) = delete;
+                                    CallScope& operator=(const CallScope&) = delete;
+
+    private:
+        // The index of the counter in sCallsInProgress this call was counted in.
+        UInt32                      mCounter;
+
+    };
+
+    /*!
+     Wait until every CallScope that existed when this was called has been destroyed. After that,
+     objects unregistered before the call can't be in use by the HAL and can be destroyed.
+
+     Not real-time safe. Mustn't be called from inside a CallScope, or it would wait for itself.
+     */
+    static void                     WaitForCallsToFinish();
+
+private:
+                                    BGM_ObjectRegistry() = delete;
+
+    struct Entry
+    {
+        std::atomic<BGM_Object*>         mObject;
+        std::atomic<BGM_Object*>         mOwner;
+        // The same object as mObject if it's a device. Null otherwise.
+        std::atomic<BGM_AbstractDevice*> mDevice;
+    };
+
+    static void                     Register(BGM_Object& inObject,
+                                             BGM_Object& inOwner,
+                                             BGM_AbstractDevice* __nullable inDevice);
+
+    static Entry                    sEntries[kMaxObjects];
+
+    // Calls are counted in one of two counters, chosen by the lowest bit of sCallEpoch.
+    // WaitForCallsToFinish increments sCallEpoch, so new calls are counted in the other counter,
+    // then waits for the old counter to reach zero. That way it can't be kept waiting by calls that
+    // started after it did.
+    static std::atomic<UInt32>      sCallEpoch;
+    static std::atomic<UInt32>      sCallsInProgress[2];
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_ObjectRegistry */
+
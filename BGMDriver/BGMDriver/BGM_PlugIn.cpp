@@ -30,19 +30,24 @@
 //  Local Includes
 #include "BGM_Device.h"
 #include "BGM_NullDevice.h"
+#include "BGM_ObjectRegistry.h"
 
 //  PublicUtility Includes
 #include "CAException.h"
 #include "CADebugMacros.h"
+#include "CAHostTimeBase.h"
 #include "CAPropertyAddress.h"
 #include "CADispatchQueue.h"
 
+//  STL Includes
+#include <algorithm>
+
 
 #pragma mark Construction/Destruction
 
 pthread_once_t				BGM_PlugIn::sStaticInitializer = PTHREAD_ONCE_INIT;
 BGM_PlugIn*					BGM_PlugIn::sInstance = NULL;
-AudioServerPlugInHostRef	BGM_PlugIn::sHost = NULL;
+std::atomic<BGM_HostInterface*> BGM_PlugIn::sHost(NULL);
 
 BGM_PlugIn& BGM_PlugIn::GetInstance()
 {
@@ -55,6 +60,7 @@ void	BGM_PlugIn::StaticInitializer()
     try
     {
         sInstance = new BGM_PlugIn;
+        BGM_ObjectRegistry::RegisterObject(*sInstance, *sInstance);
         sInstance->Activate();
     }
     catch(...)
@@ -84,6 +90,14 @@ void	BGM_PlugIn::Deactivate()
 	//_RemoveAllDevices();
 }
 
+#pragma mark Host Access
+
+UInt64	BGM_PlugIn::Host_GetCurrentTime()
+{
+    BGM_HostInterface* theHost = sHost;
+    return (theHost != NULL) ? theHost->GetCurrentHostTime() : CAHostTimeBase::GetTheCurrentTime();
+}
+
 #pragma mark Property Operations
 
 bool	BGM_PlugIn::HasProperty(AudioObjectID inObjectID, pid_t inClientPID, const AudioObjectPropertyAddress& inAddress) const
@@ -97,6 +111,7 @@ bool	BGM_PlugIn::HasProperty(AudioObjectID inObjectID, pid_t inClientPID, const
         case kAudioPlugInPropertyResourceBundle:
         case kAudioObjectPropertyCustomPropertyInfoList:
         case kAudioPlugInCustomPropertyNullDeviceActive:
+        case kAudioPlugInCustomPropertyDynamicDevices:
 			theAnswer = true;
 			break;
 		
@@ -120,6 +135,7 @@ bool	BGM_PlugIn::IsPropertySettable(AudioObjectID inObjectID, pid_t inClientPID,
 			break;
 
         case kAudioPlugInCustomPropertyNullDeviceActive:
+        case kAudioPlugInCustomPropertyDynamicDevices:
             theAnswer = true;
             break;
 		
@@ -141,8 +157,8 @@ UInt32	BGM_PlugIn::GetPropertyDataSize(AudioObjectID inObjectID, pid_t inClientP
 		case kAudioObjectPropertyOwnedObjects:
 		case kAudioPlugInPropertyDeviceList:
             // The plug-in owns the main BGM_Device, the instance of BGM_Device that handles UI
-            // sounds and, if it's enabled, the null device.
-            theAnswer = (BGM_NullDevice::GetInstance().IsActive() ? 3 : 2) * sizeof(AudioObjectID);
+            // sounds, the null device, if it's enabled, and the dynamic devices.
+            theAnswer = static_cast<UInt32>(GetDeviceList().size() * sizeof(AudioObjectID));
 			break;
 			
 		case kAudioPlugInPropertyTranslateUIDToDevice:
@@ -154,12 +170,16 @@ UInt32	BGM_PlugIn::GetPropertyDataSize(AudioObjectID inObjectID, pid_t inClientP
 			break;
 
         case kAudioObjectPropertyCustomPropertyInfoList:
-            theAnswer = sizeof(AudioServerPlugInCustomPropertyInfo);
+            theAnswer = 2 * sizeof(AudioServerPlugInCustomPropertyInfo);
             break;
 
         case kAudioPlugInCustomPropertyNullDeviceActive:
             theAnswer = sizeof(CFBooleanRef);
             break;
+
+        case kAudioPlugInCustomPropertyDynamicDevices:
+            theAnswer = sizeof(CFArrayRef);
+            break;
 		
 		default:
 			theAnswer = BGM_Object::GetPropertyDataSize(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData);
@@ -182,44 +202,18 @@ void	BGM_PlugIn::GetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, co
             // Fall through because this plug-in object only owns the devices.
 		case kAudioPlugInPropertyDeviceList:
             {
-    			AudioObjectID* theReturnedDeviceList = reinterpret_cast<AudioObjectID*>(outData);
-                if(inDataSize >= 3 * sizeof(AudioObjectID))
-                {
-                    if(BGM_NullDevice::GetInstance().IsActive())
-                    {
-                        theReturnedDeviceList[0] = kObjectID_Device;
-                        theReturnedDeviceList[1] = kObjectID_Device_UI_Sounds;
-                        theReturnedDeviceList[2] = kObjectID_Device_Null;
-                        
-                        //	say how much we returned
-                        outDataSize = 3 * sizeof(AudioObjectID);
-                    }
-                    else
-                    {
-                        theReturnedDeviceList[0] = kObjectID_Device;
-                        theReturnedDeviceList[1] = kObjectID_Device_UI_Sounds;
-
-                        //	say how much we returned
-                        outDataSize = 2 * sizeof(AudioObjectID);
-                    }
-                }
-                else if(inDataSize >= 2 * sizeof(AudioObjectID))
-                {
-                    theReturnedDeviceList[0] = kObjectID_Device;
-                    theReturnedDeviceList[1] = kObjectID_Device_UI_Sounds;
-
-                    //	say how much we returned
-                    outDataSize = 2 * sizeof(AudioObjectID);
-                }
-                else if(inDataSize >= sizeof(AudioObjectID))
-                {
-                    theReturnedDeviceList[0] = kObjectID_Device;
-                    outDataSize = sizeof(AudioObjectID);
-                }
-                else
-                {
-                    outDataSize = 0;
-                }
+                // Return as many of the devices as there's space for.
+                std::vector<AudioObjectID> theDeviceList = GetDeviceList();
+                UInt32 theNumberOfDevices =
+                        std::min(static_cast<UInt32>(theDeviceList.size()),
+                                 inDataSize / static_cast<UInt32>(sizeof(AudioObjectID)));
+
+                std::copy(theDeviceList.begin(),
+                          theDeviceList.begin() + theNumberOfDevices,
+                          reinterpret_cast<AudioObjectID*>(outData));
+
+                //	say how much we returned
+                outDataSize = theNumberOfDevices * sizeof(AudioObjectID);
             }
 			break;
 			
@@ -233,6 +227,7 @@ void	BGM_PlugIn::GetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, co
 
                 CFStringRef theUID = *reinterpret_cast<const CFStringRef*>(inQualifierData);
                 AudioObjectID* outID = reinterpret_cast<AudioObjectID*>(outData);
+                AudioObjectID theDynamicDeviceID = mDynamicDevices.GetDeviceIDForUID(theUID);
 
                 if(CFEqual(theUID, BGM_Device::GetInstance().CopyDeviceUID()))
                 {
@@ -253,6 +248,12 @@ void	BGM_PlugIn::GetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, co
                              "kAudioPlugInPropertyTranslateUIDToDevice");
                     *outID = kObjectID_Device_Null;
                 }
+                else if(theDynamicDeviceID != kAudioObjectUnknown)
+                {
+                    DebugMsg("BGM_PlugIn::GetPropertyData: Returning dynamic device %u for "
+                             "kAudioPlugInPropertyTranslateUIDToDevice", theDynamicDeviceID);
+                    *outID = theDynamicDeviceID;
+                }
                 else
                 {
                     LogWarning("BGM_PlugIn::GetPropertyData: Returning kAudioObjectUnknown for "
@@ -274,22 +275,33 @@ void	BGM_PlugIn::GetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, co
 			break;
 
         case kAudioObjectPropertyCustomPropertyInfoList:
-            if(inDataSize >= sizeof(AudioServerPlugInCustomPropertyInfo))
             {
+                static const AudioObjectPropertySelector kCustomProperties[] = {
+                    kAudioPlugInCustomPropertyNullDeviceActive,
+                    kAudioPlugInCustomPropertyDynamicDevices
+                };
+
                 AudioServerPlugInCustomPropertyInfo* outCustomProperties =
                     reinterpret_cast<AudioServerPlugInCustomPropertyInfo*>(outData);
+                UInt32 theNumberOfItems = 0;
 
-                outCustomProperties[0].mSelector = kAudioPlugInCustomPropertyNullDeviceActive;
-                outCustomProperties[0].mPropertyDataType =
-                    kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
-                outCustomProperties[0].mQualifierDataType =
-                    kAudioServerPlugInCustomPropertyDataTypeNone;
+                // Return as many of them as there's space for.
+                for(AudioObjectPropertySelector theSelector : kCustomProperties)
+                {
+                    if(inDataSize < (theNumberOfItems + 1) * sizeof(AudioServerPlugInCustomPropertyInfo))
+                    {
+                        break;
+                    }
 
-                outDataSize = sizeof(AudioServerPlugInCustomPropertyInfo);
-            }
-            else
-            {
-                outDataSize = 0;
+                    outCustomProperties[theNumberOfItems].mSelector = theSelector;
+                    outCustomProperties[theNumberOfItems].mPropertyDataType =
+                        kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                    outCustomProperties[theNumberOfItems].mQualifierDataType =
+                        kAudioServerPlugInCustomPropertyDataTypeNone;
+                    theNumberOfItems++;
+                }
+
+                outDataSize = theNumberOfItems * sizeof(AudioServerPlugInCustomPropertyInfo);
             }
             break;
 
@@ -303,6 +315,15 @@ void	BGM_PlugIn::GetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, co
             outDataSize = sizeof(CFBooleanRef);
             break;
 
+        case kAudioPlugInCustomPropertyDynamicDevices:
+            ThrowIf(inDataSize < sizeof(CFArrayRef),
+                    CAException(kAudioHardwareBadPropertySizeError),
+                    "BGM_PlugIn::GetPropertyData: not enough space for the return value of "
+                    "kAudioPlugInCustomPropertyDynamicDevices");
+            *reinterpret_cast<CFArrayRef*>(outData) = mDynamicDevices.CopyDevicesAsCFArray();
+            outDataSize = sizeof(CFArrayRef);
+            break;
+
 		default:
 			BGM_Object::GetPropertyData(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
 			break;
@@ -361,10 +382,99 @@ void	BGM_PlugIn::SetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, co
                 }
             }
             break;
-            
+
+        case kAudioPlugInCustomPropertyDynamicDevices:
+            {
+                ThrowIf(inDataSize < sizeof(CFArrayRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "BGM_PlugIn::SetPropertyData: wrong size for the data for "
+                        "kAudioPlugInCustomPropertyDynamicDevices");
+
+                CFArrayRef theDevicesRef = *reinterpret_cast<const CFArrayRef*>(inData);
+
+                ThrowIfNULL(theDevicesRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "BGM_PlugIn::SetPropertyData: null reference given for "
+                            "kAudioPlugInCustomPropertyDynamicDevices");
+                ThrowIf(CFGetTypeID(theDevicesRef) != CFArrayGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "BGM_PlugIn::SetPropertyData: CFType given for "
+                        "kAudioPlugInCustomPropertyDynamicDevices was not a CFArray");
+
+                bool theDevicesChanged = false;
+
+                try
+                {
+                    theDevicesChanged = mDynamicDevices.SetDevices(theDevicesRef);
+                }
+                catch(...)
+                {
+                    // If creating one of the new devices failed, the ones created before it have
+                    // been retired and still have to be deleted.
+                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+                        DeleteRetiredDynamicDevices();
+                    });
+
+                    throw;
+                }
+
+                if(theDevicesChanged)
+                {
+                    // Send notifications. The devices that were removed are only destroyed after
+                    // that, since the HAL could still be using them until it's been told they're
+                    // gone, and then only once it's stopped IO on them.
+                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+                        AudioObjectPropertyAddress theChangedProperties[] = {
+                            CAPropertyAddress(kAudioObjectPropertyOwnedObjects),
+                            CAPropertyAddress(kAudioPlugInPropertyDeviceList),
+                            CAPropertyAddress(kAudioPlugInCustomPropertyDynamicDevices)
+                        };
+
+                        Host_PropertiesChanged(GetObjectID(), 3, theChangedProperties);
+
+                        DeleteRetiredDynamicDevices();
+                    });
+                }
+            }
+            break;
+
 		default:
 			BGM_Object::SetPropertyData(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData);
 			break;
 	};
 }
 
+#pragma mark Implementation
+
+std::vector<AudioObjectID>  BGM_PlugIn::GetDeviceList() const
+{
+    std::vector<AudioObjectID> theDeviceList = { kObjectID_Device, kObjectID_Device_UI_Sounds };
+
+    if(BGM_NullDevice::GetInstance().IsActive())
+    {
+        theDeviceList.push_back(kObjectID_Device_Null);
+    }
+
+    UInt32 theNumberOfBuiltInDevices = static_cast<UInt32>(theDeviceList.size());
+    theDeviceList.resize(theNumberOfBuiltInDevices + kBGMMaxDynamicDevices);
+    UInt32 theNumberOfDynamicDevices =
+            mDynamicDevices.GetDeviceIDs(theDeviceList.data() + theNumberOfBuiltInDevices,
+                                         kBGMMaxDynamicDevices);
+    theDeviceList.resize(theNumberOfBuiltInDevices + theNumberOfDynamicDevices);
+
+    return theDeviceList;
+}
+
+void    BGM_PlugIn::DeleteRetiredDynamicDevices()
+{
+    if(mDynamicDevices.DeleteRetiredDevices())
+    {
+        // The HAL is still running IO on some of the devices. Check again once it's had time to stop.
+        const UInt64 kRetryDelayNanos = 500 * NSEC_PER_MSEC;
+
+        CADispatchQueue::GetGlobalSerialQueue().Dispatch(kRetryDelayNanos, ^{
+            DeleteRetiredDynamicDevices();
+        });
+    }
+}
+
@@ -31,11 +31,17 @@
 #include "BGM_Object.h"
 
 // Local Includes
+#include "BGM_DynamicDevices.h"
+#include "BGM_HostInterface.h"
 #include "BGM_Types.h"
 
 // PublicUtility Includes
 #include "CAMutex.h"
 
+// STL Includes
+#include <atomic>
+#include <vector>
+
 
 class BGM_PlugIn
 :
@@ -58,10 +64,17 @@ private:
 #pragma mark Host Access
     
 public:
-	static void						SetHost(AudioServerPlugInHostRef inHost)	{ sHost = inHost; }
+    /*!
+     Set the host the driver's objects send notifications and requests to. The caller keeps ownership
+     of it and has to keep it alive until it's replaced. Can be null, which is the default. Without a
+     host, notifications and requests are dropped and host times come from the system clock.
+     */
+	static void						SetHost(BGM_HostInterface* inHost)	{ sHost = inHost; }
 	
-	static void						Host_PropertiesChanged(AudioObjectID inObjectID, UInt32 inNumberAddresses, const AudioObjectPropertyAddress inAddresses[])	{ if(sHost != NULL) { sHost->PropertiesChanged(sHost, inObjectID, inNumberAddresses, inAddresses); } }
-	static void						Host_RequestDeviceConfigurationChange(AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void* inChangeInfo)			{ if(sHost != NULL) { sHost->RequestDeviceConfigurationChange(sHost, inDeviceObjectID, inChangeAction, inChangeInfo); } }
+	static void						Host_PropertiesChanged(AudioObjectID inObjectID, UInt32 inNumberAddresses, const AudioObjectPropertyAddress inAddresses[])	{ BGM_HostInterface* theHost = sHost; if(theHost != NULL) { theHost->PropertiesChanged(inObjectID, inNumberAddresses, inAddresses); } }
+	static void						Host_RequestDeviceConfigurationChange(AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void* inChangeInfo)			{ BGM_HostInterface* theHost = sHost; if(theHost != NULL) { theHost->RequestDeviceConfigurationChange(inDeviceObjectID, inChangeAction, inChangeInfo); } }
+    /*! The current host time in host clock ticks. Real-time safe. */
+    static UInt64                   Host_GetCurrentTime();
 
 #pragma mark Property Operations
     
@@ -78,11 +91,24 @@ public:
     const CFStringRef               GetBundleID() const { return CFSTR(kBGMDriverBundleID); }
     
 private:
+    /*!
+     @return The object IDs of the devices the plug-in publishes: BGMDevice, the UI sounds device,
+             the null device if it's active and then the dynamic devices.
+     */
+    std::vector<AudioObjectID>      GetDeviceList() const;
+    /*!
+     Destroy the dynamic devices that have been removed. Runs on the global serial queue. If the HAL
+     hasn't stopped IO on some of them yet, this is dispatched again after a delay.
+     */
+    void                            DeleteRetiredDynamicDevices();
+
     CAMutex							mMutex;
+    // The devices created with kAudioPlugInCustomPropertyDynamicDevices.
+    BGM_DynamicDevices              mDynamicDevices;
     
     static pthread_once_t			sStaticInitializer;
     static BGM_PlugIn*				sInstance;
-	static AudioServerPlugInHostRef	sHost;
+    static std::atomic<BGM_HostInterface*> sHost;
 
 };
 
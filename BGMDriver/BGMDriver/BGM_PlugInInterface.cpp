@@ -34,9 +34,11 @@
 //  Local Includes
 #include "BGM_Types.h"
 #include "BGM_Object.h"
+#include "BGM_HostInterface.h"
 #include "BGM_PlugIn.h"
 #include "BGM_Device.h"
 #include "BGM_NullDevice.h"
+#include "BGM_ObjectRegistry.h"
 
 
 #pragma mark COM Prototypes
@@ -97,53 +99,24 @@ static AudioServerPlugInDriverInterface	gAudioServerPlugInDriverInterface =
 static AudioServerPlugInDriverInterface*	gAudioServerPlugInDriverInterfacePtr	= &gAudioServerPlugInDriverInterface;
 static AudioServerPlugInDriverRef			gAudioServerPlugInDriverRef				= &gAudioServerPlugInDriverInterfacePtr;
 static UInt32								gAudioServerPlugInDriverRefCount		= 1;
+// Wraps the AudioServerPlugInHostRef the HAL passes to BGM_Initialize. Never freed because the
+// driver's objects can use it until the process exits.
+static BGM_AudioServerPlugInHost*           gHost                                   = NULL;
 
+// Returns the object that handles the HAL's calls for inObjectID. For streams and controls, that's
+// their device.
 // TODO: This name is a bit misleading because the devices are actually owned by the plug-in.
-static BGM_Object& BGM_LookUpOwnerObject(AudioObjectID inObjectID)
+//
+// Callers have to have a BGM_ObjectRegistry::CallScope until they're done with the object, so it
+// can't be destroyed while they're using it.
+static inline BGM_Object& BGM_LookUpOwnerObject(AudioObjectID inObjectID)
 {
-    switch(inObjectID)
-    {
-        case kObjectID_PlugIn:
-            return BGM_PlugIn::GetInstance();
-            
-        case kObjectID_Device:
-        case kObjectID_Stream_Input:
-        case kObjectID_Stream_Output:
-        case kObjectID_Volume_Output_Master:
-        case kObjectID_Mute_Output_Master:
-            return BGM_Device::GetInstance();
-
-        case kObjectID_Device_UI_Sounds:
-        case kObjectID_Stream_Input_UI_Sounds:
-        case kObjectID_Stream_Output_UI_Sounds:
-        case kObjectID_Volume_Output_Master_UI_Sounds:
-            return BGM_Device::GetUISoundsInstance();
-
-        case kObjectID_Device_Null:
-        case kObjectID_Stream_Null:
-            return BGM_NullDevice::GetInstance();
-    }
-    
-    DebugMsg("BGM_LookUpOwnerObject: unknown object");
-    Throw(CAException(kAudioHardwareBadObjectError));
+    return BGM_ObjectRegistry::GetOwnerObject(inObjectID);
 }
 
-static BGM_AbstractDevice& BGM_LookUpDevice(AudioObjectID inObjectID)
+static inline BGM_AbstractDevice& BGM_LookUpDevice(AudioObjectID inObjectID)
 {
-    switch(inObjectID)
-    {
-        case kObjectID_Device:
-            return BGM_Device::GetInstance();
-
-        case kObjectID_Device_UI_Sounds:
-            return BGM_Device::GetUISoundsInstance();
-
-        case kObjectID_Device_Null:
-            return BGM_NullDevice::GetInstance();
-    }
-
-    DebugMsg("BGM_LookUpDevice: unknown device");
-    Throw(CAException(kAudioHardwareBadDeviceError));
+    return BGM_ObjectRegistry::GetDevice(inObjectID);
 }
 
 #pragma mark Factory
@@ -282,7 +255,12 @@ static OSStatus	BGM_Initialize(AudioServerPlugInDriverRef inDriver, AudioServerP
                 "BGM_Initialize: bad driver reference");
 		
 		// Store the AudioServerPlugInHostRef.
-		BGM_PlugIn::GetInstance().SetHost(inHost);
+        if(gHost == NULL)
+        {
+            gHost = new BGM_AudioServerPlugInHost(inHost);
+        }
+
+		BGM_PlugIn::GetInstance().SetHost(gHost);
         
         // Init/activate the devices.
         BGM_Device::GetInstance();
@@ -330,15 +308,14 @@ static OSStatus	BGM_AddDeviceClient(AudioServerPlugInDriverRef inDriver, AudioOb
 	
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		// Check the arguments.
 		ThrowIf(inDriver != gAudioServerPlugInDriverRef,
                 CAException(kAudioHardwareBadObjectError),
                 "BGM_AddDeviceClient: bad driver reference");
-		ThrowIf(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device_UI_Sounds && inDeviceObjectID != kObjectID_Device_Null,
-                CAException(kAudioHardwareBadObjectError),
-                "BGM_AddDeviceClient: unknown device");
 		
 		// Inform the device.
         BGM_LookUpDevice(inDeviceObjectID).AddClient(inClientInfo);
@@ -366,15 +343,14 @@ static OSStatus	BGM_RemoveDeviceClient(AudioServerPlugInDriverRef inDriver, Audi
 	
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		// Check the arguments.
 		ThrowIf(inDriver != gAudioServerPlugInDriverRef,
                 CAException(kAudioHardwareBadObjectError),
                 "BGM_RemoveDeviceClient: bad driver reference");
-		ThrowIf(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device_UI_Sounds && inDeviceObjectID != kObjectID_Device_Null,
-                CAException(kAudioHardwareBadObjectError),
-                "BGM_RemoveDeviceClient: unknown device");
 		
         // Inform the device.
         BGM_LookUpDevice(inDeviceObjectID).RemoveClient(inClientInfo);
@@ -409,15 +385,14 @@ static OSStatus	BGM_PerformDeviceConfigurationChange(AudioServerPlugInDriverRef
 
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
 		ThrowIf(inDriver != gAudioServerPlugInDriverRef,
                 CAException(kAudioHardwareBadObjectError),
                 "BGM_PerformDeviceConfigurationChange: bad driver reference");
-		ThrowIf(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device_UI_Sounds && inDeviceObjectID != kObjectID_Device_Null,
-                CAException(kAudioHardwareBadDeviceError),
-                "BGM_PerformDeviceConfigurationChange: unknown device");
 		
 		//	tell the device to do the work
 		BGM_LookUpDevice(inDeviceObjectID).PerformConfigChange(inChangeAction, inChangeInfo);
@@ -441,15 +416,14 @@ static OSStatus	BGM_AbortDeviceConfigurationChange(AudioServerPlugInDriverRef in
 
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
 		ThrowIf(inDriver != gAudioServerPlugInDriverRef,
                 CAException(kAudioHardwareBadObjectError),
                 "BGM_PerformDeviceConfigurationChange: bad driver reference");
-		ThrowIf(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device_UI_Sounds && inDeviceObjectID != kObjectID_Device_Null,
-                CAException(kAudioHardwareBadDeviceError),
-                "BGM_PerformDeviceConfigurationChange: unknown device");
 		
 		//	tell the device to do the work
 		BGM_LookUpDevice(inDeviceObjectID).AbortConfigChange(inChangeAction, inChangeInfo);
@@ -474,6 +448,8 @@ static Boolean	BGM_HasProperty(AudioServerPlugInDriverRef inDriver, AudioObjectI
 	
 	Boolean theAnswer = false;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
@@ -504,6 +480,8 @@ static OSStatus	BGM_IsPropertySettable(AudioServerPlugInDriverRef inDriver, Audi
 	
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
@@ -542,6 +520,8 @@ static OSStatus	BGM_GetPropertyDataSize(AudioServerPlugInDriverRef inDriver, Aud
 	
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
@@ -580,6 +560,8 @@ static OSStatus	BGM_GetPropertyData(AudioServerPlugInDriverRef inDriver, AudioOb
 	
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
@@ -619,6 +601,8 @@ static OSStatus	BGM_SetPropertyData(AudioServerPlugInDriverRef inDriver, AudioOb
 
 	OSStatus theAnswer = 0;
 
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
@@ -672,15 +656,14 @@ static OSStatus	BGM_StartIO(AudioServerPlugInDriverRef inDriver,
 	
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
 		ThrowIf(inDriver != gAudioServerPlugInDriverRef,
                 CAException(kAudioHardwareBadObjectError),
                 "BGM_StartIO: bad driver reference");
-		ThrowIf(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device_UI_Sounds && inDeviceObjectID != kObjectID_Device_Null,
-                CAException(kAudioHardwareBadDeviceError),
-                "BGM_StartIO: unknown device");
 		
 		//	tell the device to do the work
         BGM_LookUpDevice(inDeviceObjectID).StartIO(inClientID);
@@ -706,15 +689,14 @@ static OSStatus	BGM_StopIO(AudioServerPlugInDriverRef inDriver,
 	
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
 		ThrowIf(inDriver != gAudioServerPlugInDriverRef,
                 CAException(kAudioHardwareBadObjectError),
                 "BGM_StopIO: bad driver reference");
-		ThrowIf(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device_UI_Sounds && inDeviceObjectID != kObjectID_Device_Null,
-                CAException(kAudioHardwareBadDeviceError),
-                "BGM_StopIO: unknown device");
 		
 		//	tell the device to do the work
 		BGM_LookUpDevice(inDeviceObjectID).StopIO(inClientID);
@@ -747,6 +729,8 @@ static OSStatus	BGM_GetZeroTimeStamp(AudioServerPlugInDriverRef inDriver,
 
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
@@ -762,9 +746,6 @@ static OSStatus	BGM_GetZeroTimeStamp(AudioServerPlugInDriverRef inDriver,
 		ThrowIfNULL(outSeed,
                     CAException(kAudioHardwareIllegalOperationError),
                     "BGM_GetZeroTimeStamp: no place to put the seed");
-		ThrowIf(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device_UI_Sounds && inDeviceObjectID != kObjectID_Device_Null,
-                CAException(kAudioHardwareBadDeviceError),
-                "BGM_GetZeroTimeStamp: unknown device");
 		
 		//	tell the device to do the work
 		BGM_LookUpDevice(inDeviceObjectID).GetZeroTimeStamp(*outSampleTime, *outHostTime, *outSeed);
@@ -793,6 +774,8 @@ static OSStatus	BGM_WillDoIOOperation(AudioServerPlugInDriverRef inDriver,
 
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
@@ -805,9 +788,6 @@ static OSStatus	BGM_WillDoIOOperation(AudioServerPlugInDriverRef inDriver,
 		ThrowIfNULL(outWillDoInPlace,
                     CAException(kAudioHardwareIllegalOperationError),
                     "BGM_WillDoIOOperation: no place to put the in-place return value");
-		ThrowIf(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device_UI_Sounds && inDeviceObjectID != kObjectID_Device_Null,
-                CAException(kAudioHardwareBadDeviceError),
-                "BGM_WillDoIOOperation: unknown device");
 		
 		//	tell the device to do the work
 		bool willDo = false;
@@ -841,6 +821,8 @@ static OSStatus	BGM_BeginIOOperation(AudioServerPlugInDriverRef inDriver,
 	
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
@@ -850,9 +832,6 @@ static OSStatus	BGM_BeginIOOperation(AudioServerPlugInDriverRef inDriver,
 		ThrowIfNULL(inIOCycleInfo,
                     CAException(kAudioHardwareIllegalOperationError),
                     "BGM_BeginIOOperation: no cycle info");
-		ThrowIf(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device_UI_Sounds && inDeviceObjectID != kObjectID_Device_Null,
-                CAException(kAudioHardwareBadDeviceError),
-                "BGM_BeginIOOperation: unknown device");
 		
 		//	tell the device to do the work
 		BGM_LookUpDevice(inDeviceObjectID).BeginIOOperation(inOperationID,
@@ -889,6 +868,8 @@ static OSStatus	BGM_DoIOOperation(AudioServerPlugInDriverRef inDriver,
 	
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
@@ -898,9 +879,6 @@ static OSStatus	BGM_DoIOOperation(AudioServerPlugInDriverRef inDriver,
 		ThrowIfNULL(inIOCycleInfo,
                     CAException(kAudioHardwareIllegalOperationError),
                     "BGM_EndIOOperation: no cycle info");
-		ThrowIf(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device_UI_Sounds && inDeviceObjectID != kObjectID_Device_Null,
-                CAException(kAudioHardwareBadDeviceError),
-                "BGM_EndIOOperation: unknown device");
 		
 		//	tell the device to do the work
 		BGM_LookUpDevice(inDeviceObjectID).DoIOOperation(inStreamObjectID,
@@ -937,6 +915,8 @@ static OSStatus	BGM_EndIOOperation(AudioServerPlugInDriverRef inDriver,
 	
 	OSStatus theAnswer = 0;
 	
+	BGM_ObjectRegistry::CallScope theCallScope;
+
 	try
 	{
 		//	check the arguments
@@ -946,9 +926,6 @@ static OSStatus	BGM_EndIOOperation(AudioServerPlugInDriverRef inDriver,
 		ThrowIfNULL(inIOCycleInfo,
                     CAException(kAudioHardwareIllegalOperationError),
                     "BGM_EndIOOperation: no cycle info");
-		ThrowIf(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device_UI_Sounds && inDeviceObjectID != kObjectID_Device_Null,
-                CAException(kAudioHardwareBadDeviceError),
-                "BGM_EndIOOperation: unknown device");
 		
 		//	tell the device to do the work
 		BGM_LookUpDevice(inDeviceObjectID).EndIOOperation(inOperationID,
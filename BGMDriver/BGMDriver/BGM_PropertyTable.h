@@ -0,0 +1,159 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PropertyTable.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  A constant table describing the HAL properties a class of BGM_Object implements, so its
+//  HasProperty, IsPropertySettable and GetPropertyDataSize can answer with one lookup instead of
+//  each switching over the same list of selectors.
+//
+//  Each class's table only lists the properties the class implements or overrides itself. Anything
+//  else is passed on to the superclass, the same as the switches' default cases did. The tables
+//  have to be sorted by selector, which is checked at compile time, so Find can binary search them.
+//
+//  GetPropertyData and SetPropertyData still switch over the selectors, since the code for each
+//  property is different, but they only need to handle the properties in the class's table.
+//
+
+#ifndef BGMDriver__BGM_PropertyTable
+#define BGMDriver__BGM_PropertyTable
+
+// STL Includes
+#include <algorithm>
+#include <cstddef>
+
+// System Includes
+#include <CoreAudio/AudioServerPlugIn.h>
+
+
+#pragma clang assume_nonnull begin
+
+enum class BGM_PropertyScopes : UInt8
+{
+    // The property exists in every scope.
+    Any,
+    // The property only exists in the input and output scopes.
+    InputOrOutput
+};
+
+struct BGM_PropertyInfo
+{
+    AudioObjectPropertySelector             mSelector;
+    BGM_PropertyScopes                      mScopes;
+    bool                                    mIsSettable;
+    // The size of the property's data, or BGM_PropertyTable::kVariableSize if it depends on the
+    // object's state or the scope, in which case the class's GetPropertyDataSize has to work it out.
+    UInt32                                  mDataSize;
+    // The type of the property's data, for kAudioObjectPropertyCustomPropertyInfoList, if it's a
+    // custom property. kAudioServerPlugInCustomPropertyDataTypeNone otherwise.
+    AudioServerPlugInCustomPropertyDataType mCustomDataType;
+};
+
+class BGM_PropertyTable
+{
+
+public:
+    static constexpr UInt32     kVariableSize = 0xFFFFFFFF;
+
+    template <size_t N>
+    constexpr                   BGM_PropertyTable(const BGM_PropertyInfo (&inProperties)[N])
+                                :
+                                    mProperties(inProperties),
+                                    mCount(N)
+                                { }
+
+    /*! @return True if inProperties is sorted by selector, with no duplicates. */
+    template <size_t N>
+    static constexpr bool       IsSorted(const BGM_PropertyInfo (&inProperties)[N], size_t inIndex = 1)
+    {
+        // Written recursively because a C++11 constexpr function can only have a return statement.
+        return (inIndex >= N) ||
+                ((inProperties[inIndex - 1].mSelector < inProperties[inIndex].mSelector) &&
+                 IsSorted(inProperties, inIndex + 1));
+    }
+
+    /*! @return The table's entry for inSelector, or null if the class doesn't implement it. */
+    const BGM_PropertyInfo* __nullable Find(AudioObjectPropertySelector inSelector) const noexcept
+    {
+        const BGM_PropertyInfo* theEnd = mProperties + mCount;
+        const BGM_PropertyInfo* theInfo =
+            std::lower_bound(mProperties,
+                             theEnd,
+                             inSelector,
+                             [](const BGM_PropertyInfo& inInfo, AudioObjectPropertySelector inValue) {
+                                 return inInfo.mSelector < inValue;
+                             });
+
+        return (theInfo != theEnd && theInfo->mSelector == inSelector) ? theInfo : nullptr;
+    }
+
+    /*! @return True if the property exists in the scope. */
+    static bool                 HasScope(const BGM_PropertyInfo& inInfo,
+                                         AudioObjectPropertyScope inScope) noexcept
+    {
+        return (inInfo.mScopes == BGM_PropertyScopes::Any) ||
+                (inScope == kAudioObjectPropertyScopeInput) ||
+                (inScope == kAudioObjectPropertyScopeOutput);
+    }
+
+    /*! @return The number of custom properties in the table. */
+    UInt32                      GetNumberOfCustomProperties() const noexcept
+    {
+        return static_cast<UInt32>(
+                std::count_if(mProperties, mProperties + mCount, [](const BGM_PropertyInfo& inInfo) {
+                    return inInfo.mCustomDataType != kAudioServerPlugInCustomPropertyDataTypeNone;
+                }));
+    }
+
+    /*!
+     Fills outInfo with the table's custom properties, for kAudioObjectPropertyCustomPropertyInfoList.
+     None of them take qualifiers.
+
+     @param inMaxItems The number of items outInfo has space for.
+     @return The number of items written to outInfo.
+     */
+    UInt32                      GetCustomPropertyInfo(AudioServerPlugInCustomPropertyInfo* outInfo,
+                                                      UInt32 inMaxItems) const noexcept
+    {
+        UInt32 theNumberOfItems = 0;
+
+        for(size_t i = 0; i < mCount && theNumberOfItems < inMaxItems; i++)
+        {
+            if(mProperties[i].mCustomDataType != kAudioServerPlugInCustomPropertyDataTypeNone)
+            {
+                outInfo[theNumberOfItems].mSelector = mProperties[i].mSelector;
+                outInfo[theNumberOfItems].mPropertyDataType = mProperties[i].mCustomDataType;
+                outInfo[theNumberOfItems].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+                theNumberOfItems++;
+            }
+        }
+
+        return theNumberOfItems;
+    }
+
+private:
+    const BGM_PropertyInfo*     mProperties;
+    size_t                      mCount;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_PropertyTable */
+
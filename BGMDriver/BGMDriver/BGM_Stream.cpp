@@ -28,6 +28,7 @@
 #include "BGM_Utils.h"
 #include "BGM_Device.h"
 #include "BGM_PlugIn.h"
+#include "BGM_PropertyTable.h"
 
 // PublicUtility Includes
 #include "CADebugMacros.h"
@@ -35,6 +36,9 @@
 #include "CAPropertyAddress.h"
 #include "CADispatchQueue.h"
 
+// STL Includes
+#include <algorithm>
+
 
 #pragma clang assume_nonnull begin
 
@@ -49,6 +53,7 @@ BGM_Stream::BGM_Stream(AudioObjectID inObjectID,
     mIsInput(inIsInput),
     mIsStreamActive(false),
     mSampleRate(inSampleRate),
+    mLatencyFrames(0),
     mStartingChannel(inStartingChannel)
 {
 }
@@ -57,6 +62,27 @@ BGM_Stream::~BGM_Stream()
 {
 }
 
+static constexpr UInt32 kAvailableFormatsSize =
+        (kBGMNumStandardSampleRates + 1) * sizeof(AudioStreamRangedDescription);
+
+// The properties BGM_Stream implements, sorted by selector.
+static constexpr BGM_PropertyInfo kStreamProperties[] = {
+    { kAudioStreamPropertyLatency,                  BGM_PropertyScopes::Any, false, sizeof(UInt32),                      kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioStreamPropertyPhysicalFormat,           BGM_PropertyScopes::Any, true,  sizeof(AudioStreamBasicDescription), kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioStreamPropertyAvailablePhysicalFormats, BGM_PropertyScopes::Any, false, kAvailableFormatsSize,               kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioStreamPropertyIsActive,                 BGM_PropertyScopes::Any, true,  sizeof(UInt32),                      kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioStreamPropertyStartingChannel,          BGM_PropertyScopes::Any, false, sizeof(UInt32),                      kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioStreamPropertyDirection,                BGM_PropertyScopes::Any, false, sizeof(UInt32),                      kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioStreamPropertyAvailableVirtualFormats,  BGM_PropertyScopes::Any, false, kAvailableFormatsSize,               kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioStreamPropertyVirtualFormat,            BGM_PropertyScopes::Any, true,  sizeof(AudioStreamBasicDescription), kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioStreamPropertyTerminalType,             BGM_PropertyScopes::Any, false, sizeof(UInt32),                      kAudioServerPlugInCustomPropertyDataTypeNone }
+};
+
+static_assert(BGM_PropertyTable::IsSorted(kStreamProperties),
+              "kStreamProperties must be sorted by selector");
+
+static constexpr BGM_PropertyTable sStreamProperties(kStreamProperties);
+
 bool    BGM_Stream::HasProperty(AudioObjectID inObjectID,
                                 pid_t inClientPID,
                                 const AudioObjectPropertyAddress& inAddress) const
@@ -66,25 +92,16 @@ bool    BGM_Stream::HasProperty(AudioObjectID inObjectID,
     //    GetPropertyData() method.
 
     bool theAnswer = false;
+    const BGM_PropertyInfo* theInfo = sStreamProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioStreamPropertyIsActive:
-        case kAudioStreamPropertyDirection:
-        case kAudioStreamPropertyTerminalType:
-        case kAudioStreamPropertyStartingChannel:
-        case kAudioStreamPropertyLatency:
-        case kAudioStreamPropertyVirtualFormat:
-        case kAudioStreamPropertyPhysicalFormat:
-        case kAudioStreamPropertyAvailableVirtualFormats:
-        case kAudioStreamPropertyAvailablePhysicalFormats:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Object::HasProperty(inObjectID, inClientPID, inAddress);
-            break;
-    };
+        theAnswer = BGM_PropertyTable::HasScope(*theInfo, inAddress.mScope);
+    }
+    else
+    {
+        theAnswer = BGM_Object::HasProperty(inObjectID, inClientPID, inAddress);
+    }
 
     return theAnswer;
 }
@@ -98,28 +115,16 @@ bool    BGM_Stream::IsPropertySettable(AudioObjectID inObjectID,
     // GetPropertyData() method.
 
     bool theAnswer = false;
+    const BGM_PropertyInfo* theInfo = sStreamProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioStreamPropertyDirection:
-        case kAudioStreamPropertyTerminalType:
-        case kAudioStreamPropertyStartingChannel:
-        case kAudioStreamPropertyLatency:
-        case kAudioStreamPropertyAvailableVirtualFormats:
-        case kAudioStreamPropertyAvailablePhysicalFormats:
-            theAnswer = false;
-            break;
-
-        case kAudioStreamPropertyIsActive:
-        case kAudioStreamPropertyVirtualFormat:
-        case kAudioStreamPropertyPhysicalFormat:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Object::IsPropertySettable(inObjectID, inClientPID, inAddress);
-            break;
-    };
+        theAnswer = theInfo->mIsSettable;
+    }
+    else
+    {
+        theAnswer = BGM_Object::IsPropertySettable(inObjectID, inClientPID, inAddress);
+    }
 
     return theAnswer;
 }
@@ -135,47 +140,20 @@ UInt32    BGM_Stream::GetPropertyDataSize(AudioObjectID inObjectID,
     // GetPropertyData() method.
 
     UInt32 theAnswer = 0;
+    const BGM_PropertyInfo* theInfo = sStreamProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioStreamPropertyIsActive:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioStreamPropertyDirection:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioStreamPropertyTerminalType:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioStreamPropertyStartingChannel:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioStreamPropertyLatency:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioStreamPropertyVirtualFormat:
-        case kAudioStreamPropertyPhysicalFormat:
-            theAnswer = sizeof(AudioStreamBasicDescription);
-            break;
-            
-        case kAudioStreamPropertyAvailableVirtualFormats:
-        case kAudioStreamPropertyAvailablePhysicalFormats:
-            theAnswer = 1 * sizeof(AudioStreamRangedDescription);
-            break;
-            
-        default:
-            theAnswer = BGM_Object::GetPropertyDataSize(inObjectID,
-                                                        inClientPID,
-                                                        inAddress,
-                                                        inQualifierDataSize,
-                                                        inQualifierData);
-            break;
-    };
+        theAnswer = theInfo->mDataSize;
+    }
+    else
+    {
+        theAnswer = BGM_Object::GetPropertyDataSize(inObjectID,
+                                                    inClientPID,
+                                                    inAddress,
+                                                    inQualifierDataSize,
+                                                    inQualifierData);
+    }
 
     return theAnswer;
 }
@@ -288,12 +266,15 @@ void    BGM_Stream::GetPropertyData(AudioObjectID inObjectID,
 
         case kAudioStreamPropertyLatency:
             // This property returns any additonal presentation latency the stream has.
-            ThrowIf(inDataSize < sizeof(UInt32),
-                    CAException(kAudioHardwareBadPropertySizeError),
-                    "BGM_Stream::GetPropertyData: not enough space for the return "
-                    "value of kAudioStreamPropertyLatency for the stream");
-            *reinterpret_cast<UInt32*>(outData) = 0;
-            outDataSize = sizeof(UInt32);
+            {
+                ThrowIf(inDataSize < sizeof(UInt32),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "BGM_Stream::GetPropertyData: not enough space for the return "
+                        "value of kAudioStreamPropertyLatency for the stream");
+                CAMutex::Locker theStateLocker(mStateMutex);
+                *reinterpret_cast<UInt32*>(outData) = mLatencyFrames;
+                outDataSize = sizeof(UInt32);
+            }
             break;
 
         case kAudioStreamPropertyVirtualFormat:
@@ -329,31 +310,39 @@ void    BGM_Stream::GetPropertyData(AudioObjectID inObjectID,
         case kAudioStreamPropertyAvailableVirtualFormats:
         case kAudioStreamPropertyAvailablePhysicalFormats:
             // This returns an array of AudioStreamRangedDescriptions that describe what
-            // formats are supported.
-            if((inDataSize / sizeof(AudioStreamRangedDescription)) >= 1)
+            // formats are supported. They're all the same except for the sample rates, which match
+            // kAudioDevicePropertyAvailableNominalSampleRates: the standard rates, then any rate.
             {
+                UInt32 theNumberItemsToFetch = std::min(
+                        static_cast<UInt32>(inDataSize / sizeof(AudioStreamRangedDescription)),
+                        static_cast<UInt32>(kBGMNumStandardSampleRates + 1));
+
                 AudioStreamRangedDescription* outASRD =
                     reinterpret_cast<AudioStreamRangedDescription*>(outData);
 
-                outASRD[0].mFormat.mSampleRate = mSampleRate;
-                outASRD[0].mFormat.mFormatID = kAudioFormatLinearPCM;
-                outASRD[0].mFormat.mFormatFlags =
-                    kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-                outASRD[0].mFormat.mBytesPerPacket = 8;
-                outASRD[0].mFormat.mFramesPerPacket = 1;
-                outASRD[0].mFormat.mBytesPerFrame = 8;
-                outASRD[0].mFormat.mChannelsPerFrame = 2;
-                outASRD[0].mFormat.mBitsPerChannel = 32;
-                // These match kAudioDevicePropertyAvailableNominalSampleRates.
-                outASRD[0].mSampleRateRange.mMinimum = 1.0;
-                outASRD[0].mSampleRateRange.mMaximum = 1000000000.0;
+                for(UInt32 i = 0; i < theNumberItemsToFetch; i++)
+                {
+                    const bool isStandardRate = (i < kBGMNumStandardSampleRates);
+
+                    outASRD[i].mFormat.mSampleRate =
+                        isStandardRate ? kBGMStandardSampleRates[i] : mSampleRate;
+                    outASRD[i].mFormat.mFormatID = kAudioFormatLinearPCM;
+                    outASRD[i].mFormat.mFormatFlags =
+                        kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
+                    outASRD[i].mFormat.mBytesPerPacket = 8;
+                    outASRD[i].mFormat.mFramesPerPacket = 1;
+                    outASRD[i].mFormat.mBytesPerFrame = 8;
+                    outASRD[i].mFormat.mChannelsPerFrame = 2;
+                    outASRD[i].mFormat.mBitsPerChannel = 32;
+                    outASRD[i].mFormat.mReserved = 0;
+                    outASRD[i].mSampleRateRange.mMinimum =
+                        isStandardRate ? kBGMStandardSampleRates[i] : 1.0;
+                    outASRD[i].mSampleRateRange.mMaximum =
+                        isStandardRate ? kBGMStandardSampleRates[i] : 1000000000.0;
+                }
 
                 // Report how much we wrote.
-                outDataSize = sizeof(AudioStreamRangedDescription);
-            }
-            else
-            {
-                outDataSize = 0;
+                outDataSize = theNumberItemsToFetch * sizeof(AudioStreamRangedDescription);
             }
             break;
 
@@ -484,5 +473,11 @@ void    BGM_Stream::SetSampleRate(Float64 inSampleRate)
     mSampleRate = inSampleRate;
 }
 
+void    BGM_Stream::SetLatency(UInt32 inLatencyFrames)
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+    mLatencyFrames = inLatencyFrames;
+}
+
 #pragma clang assume_nonnull end
 
@@ -88,12 +88,16 @@ public:
 #pragma mark Accessors
 
     void                        SetSampleRate(Float64 inSampleRate);
+    /*! Set the stream's additional presentation latency, in frames. See kAudioStreamPropertyLatency. */
+    void                        SetLatency(UInt32 inLatencyFrames);
 
 private:
     CAMutex                     mStateMutex;
 
     bool                        mIsInput;
     Float64                     mSampleRate;
+    /*! Any latency the device adds to the stream, in frames. See kAudioStreamPropertyLatency. */
+    UInt32                      mLatencyFrames;
     /*! True if the stream is enabled and doing IO. See kAudioStreamPropertyIsActive. */
     bool                        mIsStreamActive;
     /*! 
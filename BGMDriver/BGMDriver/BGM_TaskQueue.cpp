@@ -34,11 +34,15 @@
 // PublicUtility Includes
 #include "CAException.h"
 #include "CADebugMacros.h"
+#include "CAPThread.h"
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wsign-conversion"
 #include "CAAtomic.h"
 #pragma clang diagnostic pop
 
+// STL Includes
+#include <vector>
+
 // System Includes
 #include <mach/mach_init.h>
 #include <mach/mach_time.h>
@@ -47,40 +51,364 @@
 
 #pragma clang assume_nonnull begin
 
-#pragma mark Construction/destruction
+#pragma mark Shared worker threads
 
-BGM_TaskQueue::BGM_TaskQueue()
+static semaphore_t CreateSemaphore(const char* inCallerName)
+{
+    semaphore_t theSemaphore;
+    kern_return_t theError = semaphore_create(mach_task_self(), &theSemaphore, SYNC_POLICY_FIFO, 0);
+    
+    BGM_Utils::ThrowIfMachError(inCallerName, "semaphore_create", theError);
+    
+    ThrowIf(theSemaphore == SEMAPHORE_NULL,
+            CAException(kAudioHardwareUnspecifiedError),
+            "BGM_TaskQueue: Could not create semaphore");
+    
+    return theSemaphore;
+}
+
+//==================================================================================================
+//	BGM_TaskQueue::Worker
+//
+//  A worker thread that processes the tasks of every BGM_TaskQueue. There are two, one real-time and
+//  one not, which are created the first time they're needed and never destroyed.
+//
+//  Each queue keeps its own lock-free stacks of tasks, so queueing a task doesn't involve the other
+//  queues. When the worker is signalled, it goes through the queues in rounds. In each round, it
+//  moves any new tasks from each queue's stack to the end of that queue's pending list and then
+//  processes the first pending task of each queue. That keeps each queue's tasks in order and stops
+//  a queue with a lot of tasks from delaying the other queues' tasks by more than one task each.
+//
+//  The list of queues is only used by the worker thread. Queues are added and removed by sending the
+//  worker tasks, so the worker doesn't need a lock.
+//==================================================================================================
+
+class BGM_TaskQueue::Worker
+{
+
+public:
+                                        Worker(bool inIsRealTime);
+                                        // Disallow copying
+                                        Worker(const Worker&) = delete;
+                                        Worker& operator=(const Worker&) = delete;
+    
+    /*!
+     Start processing inQueue's tasks. Real-time safe.
+     
+     @param inAttachTask A kBGMTaskAttachQueue task. Has to stay valid until the worker has
+                         processed it, which it always does before processing any of inQueue's tasks.
+     */
+    void                                Attach(BGM_TaskQueue* inQueue, BGM_Task* inAttachTask);
+    
+    /*! Wake the worker thread after adding tasks to one of the queues. Real-time safe. */
+    void                                Signal();
+    
+    /*!
+     Signalled when the worker finishes a sync kBGMTaskDetachQueue task. The worker owns it, rather than the queue, since
+     the queue can be destroyed as soon as the task is marked complete. Workers are never destroyed.
+     */
+    semaphore_t                         GetDetachCompletedSemaphore() const { return mDetachCompletedSemaphore; }
+    
+    bool                                IsCurrentThread() const { return mThread.IsCurrentThread(); }
+    bool                                IsTimeConstraintThread() const { return mThread.IsTimeConstraintThread(); }
+    bool                                IsTimeShareThread() const { return mThread.IsTimeShareThread(); }
+    
+private:
+    struct AttachedQueue
+    {
+        BGM_TaskQueue*                  mQueue;
+        // The tasks that have been taken from the queue's stack but not processed yet, in order.
+        BGM_Task* __nullable            mPendingTasks;
+        BGM_Task* __nullable            mLastPendingTask;
+    };
+    
+    static void* __nullable             ThreadProc(void* inRefCon);
+    void                                Run();
+    
+    void                                AttachNewQueues();
+    TAtomicStack<BGM_Task>&             GetTasks(BGM_TaskQueue* inQueue) const;
+    void                                FetchTasks(AttachedQueue& ioQueue) const;
+    // If inTask is sync, inQueue can be destroyed as soon as this marks it complete.
+    void                                ProcessTask(BGM_TaskQueue* inQueue, BGM_Task* inTask);
+    
+    const bool                          mIsRealTime;
+    
+    // Signalled to tell the worker thread there are tasks for it to process.
+    semaphore_t                         mWorkQueuedSemaphore;
+    semaphore_t                         mDetachCompletedSemaphore;
+    // The kBGMTaskAttachQueue tasks for queues that haven't been attached yet.
+    TAtomicStack<BGM_Task>              mAttachTasks;
+    // Only used on the worker thread.
+    std::vector<AttachedQueue>          mQueues;
+    
+    CAPThread                           mThread;
+    
+};
+
+BGM_TaskQueue::Worker::Worker(bool inIsRealTime)
 :
-    // The inline documentation for thread_time_constraint_policy.period says "A value of 0 indicates that there is no
-    // inherent periodicity in the computation". So I figure setting the period to 0 means the scheduler will take as long
-    // as it wants to wake our real-time thread, which is fine for us, but once it has only other real-time threads can
-    // preempt us. (And that's only if they won't make our computation take longer than kRealTimeThreadMaximumComputationNs).
-    mRealTimeThread(&BGM_TaskQueue::RealTimeThreadProc,
-                    this,
-                    /* inPeriod = */ 0,
-                    NanosToAbsoluteTime(kRealTimeThreadNominalComputationNs),
-                    NanosToAbsoluteTime(kRealTimeThreadMaximumComputationNs),
-                    /* inIsPreemptible = */ true),
-    mNonRealTimeThread(&BGM_TaskQueue::NonRealTimeThreadProc, this)
+    mIsRealTime(inIsRealTime),
+    mWorkQueuedSemaphore(CreateSemaphore("BGM_TaskQueue::Worker::Worker")),
+    mDetachCompletedSemaphore(CreateSemaphore("BGM_TaskQueue::Worker::Worker")),
+    mThread(&Worker::ThreadProc,
+            this,
+            CAPThread::kDefaultThreadPriority,
+            /* inFixedPriority = */ false,
+            /* inAutoDelete = */ false,
+            (inIsRealTime ? "BGM_TaskQueue real-time worker" : "BGM_TaskQueue worker"))
 {
-    // Init the semaphores
-    auto createSemaphore = [] () {
-        semaphore_t theSemaphore;
-        kern_return_t theError = semaphore_create(mach_task_self(), &theSemaphore, SYNC_POLICY_FIFO, 0);
+    if(inIsRealTime)
+    {
+        // The inline documentation for thread_time_constraint_policy.period says "A value of 0 indicates that there is no
+        // inherent periodicity in the computation". So I figure setting the period to 0 means the scheduler will take as
+        // long as it wants to wake our real-time thread, which is fine for us, but once it has only other real-time threads
+        // can preempt us. (And that's only if they won't make our computation take longer than
+        // kRealTimeThreadMaximumComputationNs).
+        mThread.SetTimeConstraints(/* inPeriod = */ 0,
+                                   NanosToAbsoluteTime(kRealTimeThreadNominalComputationNs),
+                                   NanosToAbsoluteTime(kRealTimeThreadMaximumComputationNs),
+                                   /* inIsPreemptible = */ true);
+    }
+    
+    // Reserve space for more queues than there should ever be, so the real-time worker doesn't have
+    // to allocate when queues are attached. (BGMDevice, the UI sounds device and the dynamic devices.)
+    mQueues.reserve(2 + kBGMMaxDynamicDevices + 8);
+    
+    mThread.Start();
+}
+
+void    BGM_TaskQueue::Worker::Attach(BGM_TaskQueue* inQueue, BGM_Task* inAttachTask)
+{
+    *inAttachTask = BGM_Task(kBGMTaskAttachQueue, /* inIsSync = */ false, reinterpret_cast<UInt64>(inQueue));
+    mAttachTasks.push_atomic(inAttachTask);
+    Signal();
+}
+
+void    BGM_TaskQueue::Worker::Signal()
+{
+    // Note that semaphore_signal has an implicit barrier.
+    kern_return_t theError = semaphore_signal(mWorkQueuedSemaphore);
+    BGM_Utils::ThrowIfMachError("BGM_TaskQueue::Worker::Signal", "semaphore_signal", theError);
+}
+
+//static
+void* __nullable    BGM_TaskQueue::Worker::ThreadProc(void* inRefCon)
+{
+    Worker* theWorker = static_cast<Worker*>(inRefCon);
+    
+    DebugMsg("BGM_TaskQueue::Worker::ThreadProc: The %s worker thread has started",
+             (theWorker->mIsRealTime ? "realtime" : "non-realtime"));
+    
+    theWorker->Run();
+    
+    return NULL;
+}
+
+void    BGM_TaskQueue::Worker::Run()
+{
+    while(true)
+    {
+        // Wait until a thread signals that it's added tasks to a queue.
+        //
+        // Note that we don't have to hold any lock before waiting. If the semaphore is signalled before we begin waiting we'll
+        // still get the signal after we do.
+        kern_return_t theError = semaphore_wait(mWorkQueuedSemaphore);
+        BGM_Utils::ThrowIfMachError("BGM_TaskQueue::Worker::Run", "semaphore_wait", theError);
         
-        BGM_Utils::ThrowIfMachError("BGM_TaskQueue::BGM_TaskQueue", "semaphore_create", theError);
+        // Process one task from each queue that has any, until they're all empty. Tasks queued while we're doing this are
+        // picked up in the next round, so they wait for at most one task from each of the other queues.
+        bool theQueuesHaveTasks = true;
         
-        ThrowIf(theSemaphore == SEMAPHORE_NULL,
-                CAException(kAudioHardwareUnspecifiedError),
-                "BGM_TaskQueue::BGM_TaskQueue: Could not create semaphore");
+        while(theQueuesHaveTasks)
+        {
+            theQueuesHaveTasks = false;
+            AttachNewQueues();
+            
+            for(size_t i = 0; i < mQueues.size(); )
+            {
+                AttachedQueue& theQueue = mQueues[i];
+                FetchTasks(theQueue);
+                
+                BGM_Task* theTask = theQueue.mPendingTasks;
+                
+                if(theTask == NULL)
+                {
+                    i++;
+                    continue;
+                }
+                
+                theQueue.mPendingTasks = theTask->mNext;
+                
+                if(theQueue.mPendingTasks == NULL)
+                {
+                    theQueue.mLastPendingTask = NULL;
+                }
+                
+                if(theTask->GetTaskID() == kBGMTaskDetachQueue)
+                {
+                    // Put back any tasks that were queued after this one, so the queue's destructor can free them. (There
+                    // shouldn't be any.)
+                    for(BGM_Task* theLeftoverTask = theQueue.mPendingTasks; theLeftoverTask != NULL; )
+                    {
+                        BGM_Task* theNextTask = theLeftoverTask->mNext;
+                        GetTasks(theQueue.mQueue).push_atomic(theLeftoverTask);
+                        theLeftoverTask = theNextTask;
+                    }
+                    
+                    BGM_TaskQueue* theDetachedQueue = theQueue.mQueue;
+                    mQueues.erase(mQueues.begin() + static_cast<std::ptrdiff_t>(i));
+                    
+                    // This lets the queue's destructor continue, so the queue can't be used after this.
+                    ProcessTask(theDetachedQueue, theTask);
+                    continue;
+                }
+                
+                ProcessTask(theQueue.mQueue, theTask);
+                
+                theQueuesHaveTasks = theQueuesHaveTasks || (theQueue.mPendingTasks != NULL);
+                i++;
+            }
+        }
+    }
+}
+
+void    BGM_TaskQueue::Worker::AttachNewQueues()
+{
+    // Attach the queues in the order they were created, which is the order they'll take their turns in.
+    BGM_Task* theTask = mAttachTasks.pop_all_reversed();
+    
+    while(theTask != NULL)
+    {
+        BGM_Task* theNextTask = theTask->mNext;
         
-        return theSemaphore;
-    };
+        BGMAssert(theTask->GetTaskID() == kBGMTaskAttachQueue,
+                  "BGM_TaskQueue::Worker::AttachNewQueues: Unexpected task ID %d",
+                  theTask->GetTaskID());
+        
+        mQueues.push_back({ reinterpret_cast<BGM_TaskQueue*>(theTask->GetArg1()), NULL, NULL });
+        
+        theTask = theNextTask;
+    }
+}
+
+TAtomicStack<BGM_TaskQueue::BGM_Task>&    BGM_TaskQueue::Worker::GetTasks(BGM_TaskQueue* inQueue) const
+{
+    return mIsRealTime ? inQueue->mRealTimeThreadTasks : inQueue->mNonRealTimeThreadTasks;
+}
+
+void    BGM_TaskQueue::Worker::FetchTasks(AttachedQueue& ioQueue) const
+{
+    // The tasks need to be processed in the order they were added to the queue. Since pop_all_reversed is atomic, other
+    // threads can't add new tasks while we're reading, which would mix up the order.
+    BGM_Task* theNewTasks = GetTasks(ioQueue.mQueue).pop_all_reversed();
     
-    mRealTimeThreadWorkQueuedSemaphore = createSemaphore();
-    mNonRealTimeThreadWorkQueuedSemaphore = createSemaphore();
-    mRealTimeThreadSyncTaskCompletedSemaphore = createSemaphore();
-    mNonRealTimeThreadSyncTaskCompletedSemaphore = createSemaphore();
+    if(theNewTasks == NULL)
+    {
+        return;
+    }
+    
+    if(ioQueue.mLastPendingTask == NULL)
+    {
+        ioQueue.mPendingTasks = theNewTasks;
+    }
+    else
+    {
+        ioQueue.mLastPendingTask->mNext = theNewTasks;
+    }
+    
+    BGM_Task* theLastTask = theNewTasks;
+    
+    while(theLastTask->mNext != NULL)
+    {
+        theLastTask = theLastTask->mNext;
+    }
+    
+    ioQueue.mLastPendingTask = theLastTask;
+}
+
+void    BGM_TaskQueue::Worker::ProcessTask(BGM_TaskQueue* inQueue, BGM_Task* inTask)
+{
+    BGMAssert(!inTask->IsComplete(),
+              "BGM_TaskQueue::Worker::ProcessTask: Cannot process already completed task (ID %d)",
+              inTask->GetTaskID());
+    
+    BGMAssert(inTask != inTask->mNext,
+              "BGM_TaskQueue::Worker::ProcessTask: BGM_Task %p (ID %d) was added to %s multiple times. arg1=%llu arg2=%llu",
+              inTask,
+              inTask->GetTaskID(),
+              (mIsRealTime ? "mRealTimeThreadTasks" : "mNonRealTimeThreadTasks"),
+              inTask->GetArg1(),
+              inTask->GetArg2());
+    
+    // Process the task
+    if(inTask->GetTaskID() == kBGMTaskDetachQueue)
+    {
+        DebugMsg("BGM_TaskQueue::Worker::ProcessTask: Detached queue %p from the %s worker thread",
+                 inQueue,
+                 (mIsRealTime ? "realtime" : "non-realtime"));
+    }
+    else if(mIsRealTime)
+    {
+        inQueue->ProcessRealTimeThreadTask(inTask);
+    }
+    else
+    {
+        inQueue->ProcessNonRealTimeThreadTask(inTask);
+    }
+    
+    // If the task was queued synchronously, let the thread that queued it know we're finished
+    if(inTask->IsSync())
+    {
+        // For a kBGMTaskDetachQueue task, inQueue can be destroyed as soon as we mark the task completed, since QueueSync
+        // also polls the task, so we signal the worker's semaphore instead of the queue's. For other tasks, the queue can't be
+        // destroyed until we've processed its detach task, which we can only do after this.
+        const bool isDetachTask = (inTask->GetTaskID() == kBGMTaskDetachQueue);
+        semaphore_t theSyncTaskCompletedSemaphore = (isDetachTask ?
+                                                     mDetachCompletedSemaphore :
+                                                     (mIsRealTime ?
+                                                      inQueue->mRealTimeThreadSyncTaskCompletedSemaphore :
+                                                      inQueue->mNonRealTimeThreadSyncTaskCompletedSemaphore));
+        
+        // Marking the task as completed allows QueueSync to return, which means it's possible for inTask to point to
+        // invalid memory after this point.
+        CAMemoryBarrier();
+        inTask->MarkCompleted();
+        
+        // Signal any threads waiting for their task to be processed.
+        //
+        // We use semaphore_signal_all instead of semaphore_signal to avoid a race condition in QueueSync. It's possible
+        // for threads calling QueueSync to wait on the semaphore in an order different to the order of the tasks they just
+        // added to the queue. So after each task is completed we have every waiting thread check if it was theirs.
+        //
+        // Note that semaphore_signal_all has an implicit barrier.
+        kern_return_t theError = semaphore_signal_all(theSyncTaskCompletedSemaphore);
+        BGM_Utils::LogIfMachError("BGM_TaskQueue::Worker::ProcessTask", "semaphore_signal_all", theError);
+    }
+    else if(!mIsRealTime)
+    {
+        // After completing an async task, move it to the free list so the memory can be reused
+        inQueue->mNonRealTimeThreadTasksFreeList.push_atomic(inTask);
+    }
+}
+
+//static
+BGM_TaskQueue::Worker&    BGM_TaskQueue::GetWorker(bool inRealTime)
+{
+    // Created the first time they're used and never destroyed, like the driver's other singletons. (Queues can be destroyed
+    // during static destruction, e.g. the tests' queues, and they still need the workers then.)
+    static Worker* sRealTimeWorker = new Worker(/* inIsRealTime = */ true);
+    static Worker* sNonRealTimeWorker = new Worker(/* inIsRealTime = */ false);
+    
+    return inRealTime ? *sRealTimeWorker : *sNonRealTimeWorker;
+}
+
+#pragma mark Construction/destruction
+
+BGM_TaskQueue::BGM_TaskQueue()
+{
+    // Init the semaphores
+    mRealTimeThreadSyncTaskCompletedSemaphore = CreateSemaphore("BGM_TaskQueue::BGM_TaskQueue");
+    mNonRealTimeThreadSyncTaskCompletedSemaphore = CreateSemaphore("BGM_TaskQueue::BGM_TaskQueue");
     
     // Pre-allocate enough tasks in mNonRealTimeThreadTasksFreeList that the real-time threads should never have to
     // allocate memory when adding a task to the non-realtime queue.
@@ -90,17 +418,17 @@ BGM_TaskQueue::BGM_TaskQueue()
         mNonRealTimeThreadTasksFreeList.push_NA(theTask);
     }
     
-    // Start the worker threads
-    mRealTimeThread.Start();
-    mNonRealTimeThread.Start();
+    // Start using the worker threads
+    GetWorker(true).Attach(this, &mRealTimeThreadAttachTask);
+    GetWorker(false).Attach(this, &mNonRealTimeThreadAttachTask);
 }
 
 BGM_TaskQueue::~BGM_TaskQueue()
 {
-    // Join the worker threads
+    // Wait for the worker threads to finish this queue's tasks and stop using it
     BGMLogAndSwallowExceptionsMsg("BGM_TaskQueue::~BGM_TaskQueue", "QueueSync", ([&] {
-        QueueSync(kBGMTaskStopWorkerThread, /* inRunOnRealtimeThread = */ true);
-        QueueSync(kBGMTaskStopWorkerThread, /* inRunOnRealtimeThread = */ false);
+        QueueSync(kBGMTaskDetachQueue, /* inRunOnRealtimeThread = */ true);
+        QueueSync(kBGMTaskDetachQueue, /* inRunOnRealtimeThread = */ false);
     }));
 
     // Destroy the semaphores
@@ -110,8 +438,6 @@ BGM_TaskQueue::~BGM_TaskQueue()
         BGM_Utils::LogIfMachError("BGM_TaskQueue::~BGM_TaskQueue", "semaphore_destroy", theError);
     };
     
-    destroySemaphore(mRealTimeThreadWorkQueuedSemaphore);
-    destroySemaphore(mNonRealTimeThreadWorkQueuedSemaphore);
     destroySemaphore(mRealTimeThreadSyncTaskCompletedSemaphore);
     destroySemaphore(mNonRealTimeThreadSyncTaskCompletedSemaphore);
     
@@ -207,19 +533,22 @@ UInt64    BGM_TaskQueue::QueueSync(BGM_TaskID inTaskID, bool inRunOnRealtimeThre
     TAtomicStack<BGM_Task>& theTasks = (inRunOnRealtimeThread ? mRealTimeThreadTasks : mNonRealTimeThreadTasks);
     theTasks.push_atomic(&theTask);
     
-    // Wake the worker thread so it'll process the task. (Note that semaphore_signal has an implicit barrier.)
-    kern_return_t theError = semaphore_signal(inRunOnRealtimeThread ? mRealTimeThreadWorkQueuedSemaphore : mNonRealTimeThreadWorkQueuedSemaphore);
-    BGM_Utils::ThrowIfMachError("BGM_TaskQueue::QueueSync", "semaphore_signal", theError);
+    // Wake the worker thread so it'll process the task.
+    GetWorker(inRunOnRealtimeThread).Signal();
     
     // Wait until the task has been processed.
     //
-    // The worker thread signals all threads waiting on this semaphore when it finishes a task. The comments in WorkerThreadProc
-    // explain why we have to check the condition in a loop here.
+    // The worker thread signals all threads waiting on this semaphore when it finishes a task. The comments in
+    // Worker::ProcessTask explain why we have to check the condition in a loop here. Detach tasks are signalled on the
+    // worker's semaphore instead, since this queue can be destroyed as soon as its detach task is complete.
+    semaphore_t theTaskCompletedSemaphore =
+        (inTaskID == kBGMTaskDetachQueue) ?
+            GetWorker(inRunOnRealtimeThread).GetDetachCompletedSemaphore() :
+            (inRunOnRealtimeThread ? mRealTimeThreadSyncTaskCompletedSemaphore : mNonRealTimeThreadSyncTaskCompletedSemaphore);
     bool didLogTimeoutMessage = false;
+    kern_return_t theError;
     while(!theTask.IsComplete())
     {
-        semaphore_t theTaskCompletedSemaphore =
-            inRunOnRealtimeThread ? mRealTimeThreadSyncTaskCompletedSemaphore : mNonRealTimeThreadSyncTaskCompletedSemaphore;
         // TODO: Because the worker threads use semaphore_signal_all instead of semaphore_signal, a thread can miss the signal if
         //       it isn't waiting at the right time. Using a timeout for now as a temporary fix so threads don't get stuck here.
         theError = semaphore_timedwait(theTaskCompletedSemaphore,
@@ -269,137 +598,33 @@ void   BGM_TaskQueue::QueueOnNonRealtimeThread(BGM_Task inTask)
     
     mNonRealTimeThreadTasks.push_atomic(freeTask);
     
-    // Signal the worker thread to process the task. (Note that semaphore_signal has an implicit barrier.)
-    kern_return_t theError = semaphore_signal(mNonRealTimeThreadWorkQueuedSemaphore);
-    BGM_Utils::ThrowIfMachError("BGM_TaskQueue::QueueOnNonRealtimeThread", "semaphore_signal", theError);
+    // Signal the worker thread to process the task.
+    GetWorker(false).Signal();
 }
 
-#pragma mark Worker threads
+#pragma mark Task processing
 
 void    BGM_TaskQueue::AssertCurrentThreadIsRTWorkerThread(const char* inCallerMethodName)
 {
 #if DEBUG  // This Assert macro always checks the condition, even in release builds if the compiler doesn't optimise it away
-    if(!mRealTimeThread.IsCurrentThread())
+    if(!GetWorker(true).IsCurrentThread())
     {
         DebugMsg("%s should only be called on the realtime worker thread.", inCallerMethodName);
         __ASSERT_STOP;  // TODO: Figure out a better way to assert with a formatted message
     }
     
-    Assert(mRealTimeThread.IsTimeConstraintThread(), "mRealTimeThread should be in a time-constraint priority band.");
+    Assert(GetWorker(true).IsTimeConstraintThread(), "The realtime worker thread should be in a time-constraint priority band.");
 #else
     #pragma unused (inCallerMethodName)
 #endif
 }
 
-//static
-void* __nullable    BGM_TaskQueue::RealTimeThreadProc(void* inRefCon)
-{
-    DebugMsg("BGM_TaskQueue::RealTimeThreadProc: The realtime worker thread has started");
-    
-    BGM_TaskQueue* refCon = static_cast<BGM_TaskQueue*>(inRefCon);
-    refCon->WorkerThreadProc(refCon->mRealTimeThreadWorkQueuedSemaphore,
-                             refCon->mRealTimeThreadSyncTaskCompletedSemaphore,
-                             &refCon->mRealTimeThreadTasks,
-                             NULL,
-                             [&] (BGM_Task* inTask) { return refCon->ProcessRealTimeThreadTask(inTask); });
-    
-    return NULL;
-}
-
-//static
-void* __nullable    BGM_TaskQueue::NonRealTimeThreadProc(void* inRefCon)
-{
-    DebugMsg("BGM_TaskQueue::NonRealTimeThreadProc: The non-realtime worker thread has started");
-    
-    BGM_TaskQueue* refCon = static_cast<BGM_TaskQueue*>(inRefCon);
-    refCon->WorkerThreadProc(refCon->mNonRealTimeThreadWorkQueuedSemaphore,
-                             refCon->mNonRealTimeThreadSyncTaskCompletedSemaphore,
-                             &refCon->mNonRealTimeThreadTasks,
-                             &refCon->mNonRealTimeThreadTasksFreeList,
-                             [&] (BGM_Task* inTask) { return refCon->ProcessNonRealTimeThreadTask(inTask); });
-    
-    return NULL;
-}
-
-void    BGM_TaskQueue::WorkerThreadProc(semaphore_t inWorkQueuedSemaphore, semaphore_t inSyncTaskCompletedSemaphore, TAtomicStack<BGM_Task>* inTasks, TAtomicStack2<BGM_Task>* __nullable inFreeList, std::function<bool(BGM_Task*)> inProcessTask)
-{
-    bool theThreadShouldStop = false;
-    
-    while(!theThreadShouldStop)
-    {
-        // Wait until a thread signals that it's added tasks to the queue.
-        //
-        // Note that we don't have to hold any lock before waiting. If the semaphore is signalled before we begin waiting we'll
-        // still get the signal after we do.
-        kern_return_t theError = semaphore_wait(inWorkQueuedSemaphore);
-        BGM_Utils::ThrowIfMachError("BGM_TaskQueue::WorkerThreadProc", "semaphore_wait", theError);
-        
-        // Fetch the tasks from the queue.
-        //
-        // The tasks need to be processed in the order they were added to the queue. Since pop_all_reversed is atomic, other threads
-        // can't add new tasks while we're reading, which would mix up the order.
-        BGM_Task* theTask = inTasks->pop_all_reversed();
-        
-        while(theTask != NULL &&
-              !theThreadShouldStop)  // Stop processing tasks if we're shutting down
-        {
-            BGM_Task* theNextTask = theTask->mNext;
-            
-            BGMAssert(!theTask->IsComplete(),
-                      "BGM_TaskQueue::WorkerThreadProc: Cannot process already completed task (ID %d)",
-                      theTask->GetTaskID());
-            
-            BGMAssert(theTask != theNextTask,
-                      "BGM_TaskQueue::WorkerThreadProc: BGM_Task %p (ID %d) was added to %s multiple times. arg1=%llu arg2=%llu",
-                      theTask,
-                      theTask->GetTaskID(),
-                      (inTasks == &mRealTimeThreadTasks ? "mRealTimeThreadTasks" : "mNonRealTimeThreadTasks"),
-                      theTask->GetArg1(),
-                      theTask->GetArg2());
-            
-            // Process the task
-            theThreadShouldStop = inProcessTask(theTask);
-            
-            // If the task was queued synchronously, let the thread that queued it know we're finished
-            if(theTask->IsSync())
-            {
-                // Marking the task as completed allows QueueSync to return, which means it's possible for theTask to point to
-                // invalid memory after this point.
-                CAMemoryBarrier();
-                theTask->MarkCompleted();
-                
-                // Signal any threads waiting for their task to be processed.
-                //
-                // We use semaphore_signal_all instead of semaphore_signal to avoid a race condition in QueueSync. It's possible
-                // for threads calling QueueSync to wait on the semaphore in an order different to the order of the tasks they just
-                // added to the queue. So after each task is completed we have every waiting thread check if it was theirs.
-                //
-                // Note that semaphore_signal_all has an implicit barrier.
-                theError = semaphore_signal_all(inSyncTaskCompletedSemaphore);
-                BGM_Utils::ThrowIfMachError("BGM_TaskQueue::WorkerThreadProc", "semaphore_signal_all", theError);
-            }
-            else if(inFreeList != NULL)
-            {
-                // After completing an async task, move it to the free list so the memory can be reused
-                inFreeList->push_atomic(theTask);
-            }
-            
-            theTask = theNextTask;
-        }
-    }
-}
-
-bool    BGM_TaskQueue::ProcessRealTimeThreadTask(BGM_Task* inTask)
+void    BGM_TaskQueue::ProcessRealTimeThreadTask(BGM_Task* inTask)
 {
     AssertCurrentThreadIsRTWorkerThread("BGM_TaskQueue::ProcessRealTimeThreadTask");
     
     switch(inTask->GetTaskID())
     {
-        case kBGMTaskStopWorkerThread:
-            DebugMsg("BGM_TaskQueue::ProcessRealTimeThreadTask: Stopping");
-            // Return that the thread should stop itself
-            return true;
-            
         case kBGMTaskSwapClientShadowMaps:
             {
                 DebugMsg("BGM_TaskQueue::ProcessRealTimeThreadTask: Swapping the shadow maps in BGM_ClientMap");
@@ -412,24 +637,17 @@ bool    BGM_TaskQueue::ProcessRealTimeThreadTask(BGM_Task* inTask)
             Assert(false, "BGM_TaskQueue::ProcessRealTimeThreadTask: Unexpected task ID");
             break;
     }
-    
-    return false;
 }
 
-bool    BGM_TaskQueue::ProcessNonRealTimeThreadTask(BGM_Task* inTask)
+void    BGM_TaskQueue::ProcessNonRealTimeThreadTask(BGM_Task* inTask)
 {
 #if DEBUG  // This Assert macro always checks the condition, if for some reason the compiler doesn't optimise it away, even in release builds
-    Assert(mNonRealTimeThread.IsCurrentThread(), "ProcessNonRealTimeThreadTask should only be called on the non-realtime worker thread.");
-    Assert(mNonRealTimeThread.IsTimeShareThread(), "mNonRealTimeThread should not be in a time-constraint priority band.");
+    Assert(GetWorker(false).IsCurrentThread(), "ProcessNonRealTimeThreadTask should only be called on the non-realtime worker thread.");
+    Assert(GetWorker(false).IsTimeShareThread(), "The non-realtime worker thread should not be in a time-constraint priority band.");
 #endif
     
     switch(inTask->GetTaskID())
     {
-        case kBGMTaskStopWorkerThread:
-            DebugMsg("BGM_TaskQueue::ProcessNonRealTimeThreadTask: Stopping");
-            // Return that the thread should stop itself
-            return true;
-            
         case kBGMTaskStartClientIO:
             DebugMsg("BGM_TaskQueue::ProcessNonRealTimeThreadTask: Processing kBGMTaskStartClientIO");
             try
@@ -480,8 +698,6 @@ bool    BGM_TaskQueue::ProcessNonRealTimeThreadTask(BGM_Task* inTask)
             Assert(false, "BGM_TaskQueue::ProcessNonRealTimeThreadTask: Unexpected task ID");
             break;
     }
-    
-    return false;
 }
 
 #pragma clang assume_nonnull end
@@ -24,15 +24,11 @@
 #define __BGMDriver__BGM_TaskQueue__
 
 // PublicUtility Includes
-#include "CAPThread.h"
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wsign-conversion"
 #include "CAAtomicStack.h"
 #pragma clang diagnostic pop
 
-// STL Includes
-#include <functional>
-
 // System Includes
 #include <mach/semaphore.h>
 #include <CoreAudio/AudioHardware.h>
@@ -48,10 +44,15 @@ class BGM_ClientMap;
 //==================================================================================================
 //	BGM_TaskQueue
 //
-//  This class has two worker threads, one with real-time priority and one with default priority,
-//  that tasks can be dispatched to. The two main use cases are dispatching work from a real-time
-//  thread to be done async, and dispatching work from a non-real-time thread that needs to run on
-//  a real-time thread to avoid priority inversions.
+//  Tasks can be dispatched to two worker threads, one with real-time priority and one with default
+//  priority. The two main use cases are dispatching work from a real-time thread to be done async,
+//  and dispatching work from a non-real-time thread that needs to run on a real-time thread to avoid
+//  priority inversions.
+//
+//  The two worker threads are shared by every BGM_TaskQueue in the process, so adding devices
+//  doesn't add threads to coreaudiod. Each instance is a logical queue on them. A queue's tasks are
+//  processed in the order they were queued, and the workers take turns between the queues with
+//  tasks, one task at a time, so a busy queue can't hold up the others' tasks for long.
 //==================================================================================================
 
 class BGM_TaskQueue
@@ -60,7 +61,10 @@ class BGM_TaskQueue
 private:
     enum BGM_TaskID {
         kBGMTaskUninitialized,
-        kBGMTaskStopWorkerThread,
+        // Sent to each worker thread when a queue is created/destroyed to add/remove the queue. The
+        // queue is only removed after its other tasks have been processed.
+        kBGMTaskAttachQueue,
+        kBGMTaskDetachQueue,
         
         // Realtime thread only
         kBGMTaskSwapClientShadowMaps,
@@ -139,20 +143,15 @@ public:
     void                                AssertCurrentThreadIsRTWorkerThread(const char* inCallerMethodName);
     
 private:
-    static void* __nullable             RealTimeThreadProc(void* inRefCon);
-    static void* __nullable             NonRealTimeThreadProc(void* inRefCon);
+    // One of the two worker threads shared by all of the queues. Defined in BGM_TaskQueue.cpp.
+    class Worker;
     
-    void                                WorkerThreadProc(semaphore_t inWorkQueuedSemaphore, semaphore_t inSyncTaskCompletedSemaphore, TAtomicStack<BGM_Task>* inTasks, TAtomicStack2<BGM_Task>* __nullable inFreeList, std::function<bool(BGM_Task*)> inProcessTask);
+    static Worker&                      GetWorker(bool inRealTime);
     
-    // These return true when the thread should be stopped
-    bool                                ProcessRealTimeThreadTask(BGM_Task* inTask);
-    bool                                ProcessNonRealTimeThreadTask(BGM_Task* inTask);
+    void                                ProcessRealTimeThreadTask(BGM_Task* inTask);
+    void                                ProcessNonRealTimeThreadTask(BGM_Task* inTask);
     
 private:
-    // The worker threads that perform the queued tasks
-    CAPThread                           mRealTimeThread;
-    CAPThread                           mNonRealTimeThread;
-    
     // The approximate amount of time we'll need whenever our real-time thread is scheduled. This is currently just
     // set to the minimum (see sched_prim.c) because our real-time tasks do very little work.
     //
@@ -166,9 +165,6 @@ private:
     
     // We use Mach semaphores for communication with the worker threads because signalling them is real-time safe.
     
-    // Signalled to tell the worker threads when there are tasks for them process.
-    semaphore_t                         mRealTimeThreadWorkQueuedSemaphore;
-    semaphore_t                         mNonRealTimeThreadWorkQueuedSemaphore;
     // Signalled when a worker thread completes a task, if the thread that queued that task is blocking on it.
     semaphore_t                         mRealTimeThreadSyncTaskCompletedSemaphore;
     semaphore_t                         mNonRealTimeThreadSyncTaskCompletedSemaphore;
@@ -194,6 +190,10 @@ private:
     // We can use TAtomicStack2 instead of TAtomicStack because we never call pop_all on the free list.
     TAtomicStack2<BGM_Task>             mNonRealTimeThreadTasksFreeList;
     
+    // The kBGMTaskAttachQueue tasks the constructor sends the worker threads.
+    BGM_Task                            mRealTimeThreadAttachTask;
+    BGM_Task                            mNonRealTimeThreadAttachTask;
+    
 };
 
 #pragma clang assume_nonnull end
@@ -25,7 +25,9 @@
 #include "BGM_VolumeControl.h"
 
 // Local Includes
+#include "BGM_DSP.h"
 #include "BGM_PlugIn.h"
+#include "BGM_PropertyTable.h"
 
 // PublicUtility Includes
 #include "CAException.h"
@@ -38,7 +40,6 @@
 
 // System Includes
 #include <CoreAudio/AudioHardwareBase.h>
-#include <Accelerate/Accelerate.h>
 
 
 #pragma clang assume_nonnull begin
@@ -63,14 +64,28 @@ BGM_VolumeControl::BGM_VolumeControl(AudioObjectID inObjectID,
     mMaxVolumeRaw(kDefaultMaxRawVolume),
     mMinVolumeDb(kDefaultMinDbVolume),
     mMaxVolumeDb(kDefaultMaxDbVolume),
+    // Setup the volume curve with the one range
+    mVolumeCurve(mMinVolumeRaw, mMaxVolumeRaw, mMinVolumeDb, mMaxVolumeDb),
     mWillApplyVolumeToAudio(false)
 {
-    // Setup the volume curve with the one range
-    mVolumeCurve.AddRange(mMinVolumeRaw, mMaxVolumeRaw, mMinVolumeDb, mMaxVolumeDb);
 }
 
 #pragma mark Property Operations
 
+// The properties BGM_VolumeControl implements, sorted by selector.
+static constexpr BGM_PropertyInfo kVolumeControlProperties[] = {
+    { kAudioLevelControlPropertyDecibelRange,            BGM_PropertyScopes::Any, false, sizeof(AudioValueRange), kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioLevelControlPropertyConvertDecibelsToScalar, BGM_PropertyScopes::Any, false, sizeof(Float32),         kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioLevelControlPropertyDecibelValue,            BGM_PropertyScopes::Any, true,  sizeof(Float32),         kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioLevelControlPropertyConvertScalarToDecibels, BGM_PropertyScopes::Any, false, sizeof(Float32),         kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kAudioLevelControlPropertyScalarValue,             BGM_PropertyScopes::Any, true,  sizeof(Float32),         kAudioServerPlugInCustomPropertyDataTypeNone }
+};
+
+static_assert(BGM_PropertyTable::IsSorted(kVolumeControlProperties),
+              "kVolumeControlProperties must be sorted by selector");
+
+static constexpr BGM_PropertyTable sVolumeControlProperties(kVolumeControlProperties);
+
 bool    BGM_VolumeControl::HasProperty(AudioObjectID inObjectID,
                                        pid_t inClientPID,
                                        const AudioObjectPropertyAddress& inAddress) const
@@ -78,21 +93,16 @@ bool    BGM_VolumeControl::HasProperty(AudioObjectID inObjectID,
     CheckObjectID(inObjectID);
 
     bool theAnswer = false;
+    const BGM_PropertyInfo* theInfo = sVolumeControlProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioLevelControlPropertyScalarValue:
-        case kAudioLevelControlPropertyDecibelValue:
-        case kAudioLevelControlPropertyDecibelRange:
-        case kAudioLevelControlPropertyConvertScalarToDecibels:
-        case kAudioLevelControlPropertyConvertDecibelsToScalar:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Control::HasProperty(inObjectID, inClientPID, inAddress);
-            break;
-    };
+        theAnswer = BGM_PropertyTable::HasScope(*theInfo, inAddress.mScope);
+    }
+    else
+    {
+        theAnswer = BGM_Control::HasProperty(inObjectID, inClientPID, inAddress);
+    }
 
     return theAnswer;
 }
@@ -104,24 +114,16 @@ bool    BGM_VolumeControl::IsPropertySettable(AudioObjectID inObjectID,
     CheckObjectID(inObjectID);
 
     bool theAnswer = false;
+    const BGM_PropertyInfo* theInfo = sVolumeControlProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioLevelControlPropertyDecibelRange:
-        case kAudioLevelControlPropertyConvertScalarToDecibels:
-        case kAudioLevelControlPropertyConvertDecibelsToScalar:
-            theAnswer = false;
-            break;
-
-        case kAudioLevelControlPropertyScalarValue:
-        case kAudioLevelControlPropertyDecibelValue:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Control::IsPropertySettable(inObjectID, inClientPID, inAddress);
-            break;
-    };
+        theAnswer = theInfo->mIsSettable;
+    }
+    else
+    {
+        theAnswer = BGM_Control::IsPropertySettable(inObjectID, inClientPID, inAddress);
+    }
 
     return theAnswer;
 }
@@ -135,37 +137,20 @@ UInt32  BGM_VolumeControl::GetPropertyDataSize(AudioObjectID inObjectID,
     CheckObjectID(inObjectID);
 
     UInt32 theAnswer = 0;
+    const BGM_PropertyInfo* theInfo = sVolumeControlProperties.Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
+    if(theInfo != nullptr)
     {
-        case kAudioLevelControlPropertyScalarValue:
-            theAnswer = sizeof(Float32);
-            break;
-
-        case kAudioLevelControlPropertyDecibelValue:
-            theAnswer = sizeof(Float32);
-            break;
-
-        case kAudioLevelControlPropertyDecibelRange:
-            theAnswer = sizeof(AudioValueRange);
-            break;
-
-        case kAudioLevelControlPropertyConvertScalarToDecibels:
-            theAnswer = sizeof(Float32);
-            break;
-
-        case kAudioLevelControlPropertyConvertDecibelsToScalar:
-            theAnswer = sizeof(Float32);
-            break;
-
-        default:
-            theAnswer = BGM_Control::GetPropertyDataSize(inObjectID,
-                                                         inClientPID,
-                                                         inAddress,
-                                                         inQualifierDataSize,
-                                                         inQualifierData);
-            break;
-    };
+        theAnswer = theInfo->mDataSize;
+    }
+    else
+    {
+        theAnswer = BGM_Control::GetPropertyDataSize(inObjectID,
+                                                     inClientPID,
+                                                     inAddress,
+                                                     inQualifierDataSize,
+                                                     inQualifierData);
+    }
 
     return theAnswer;
 }
@@ -357,6 +342,14 @@ void    BGM_VolumeControl::SetVolumeDb(Float32 inNewVolumeDb)
     SetVolumeRaw(theNewVolumeRaw);
 }
 
+void    BGM_VolumeControl::SetVolumeCurveTransferFunction(UInt32 inTransferFunction)
+{
+    CAMutex::Locker theLocker(mMutex);
+
+    mVolumeCurve.SetTransferFunction(inTransferFunction);
+    UpdateAmplitudeGain();
+}
+
 void    BGM_VolumeControl::SetWillApplyVolumeToAudio(bool inWillApplyVolumeToAudio)
 {
     mWillApplyVolumeToAudio = inWillApplyVolumeToAudio;
@@ -379,14 +372,14 @@ void    BGM_VolumeControl::ApplyVolumeToAudioRT(Float32* ioBuffer, UInt32 inBuff
     if((mAmplitudeGain < 0.99f) || (mAmplitudeGain > 1.01f))
     {
         // Apply the amount of gain/loss for the current volume to the audio signal by multiplying
-        // each sample. This call to vDSP_vsmul is equivalent to
+        // each sample. BGM_DSP::Scale is equivalent to
         //
         // for(UInt32 i = 0; i < inBufferFrameSize * 2; i++)
         // {
         //     ioBuffer[i] *= mAmplitudeGain;
         // }
         //
-        // but a bit faster on processors with newer SIMD instructions. However, it shouldn't take
+        // but multiplies several samples at a time with SIMD instructions. However, it shouldn't take
         // more than a few microseconds either way. (Unless some of the samples were subnormal
         // numbers for some reason.)
         //
@@ -394,7 +387,7 @@ void    BGM_VolumeControl::ApplyVolumeToAudioRT(Float32* ioBuffer, UInt32 inBuff
         // output buffers, but then we'd have to copy the data into the output buffer when the
         // volume is at 1.0. With our current use of this class, most people will leave the volume
         // at 1.0, so it wouldn't be worth it.
-        vDSP_vsmul(ioBuffer, 1, &mAmplitudeGain, ioBuffer, 1, inBufferFrameSize * 2);
+        BGM_DSP::Scale(ioBuffer, inBufferFrameSize * 2, mAmplitudeGain);
     }
 }
 
@@ -412,40 +405,7 @@ void    BGM_VolumeControl::SetVolumeRaw(SInt32 inNewVolumeRaw)
     {
         mVolumeRaw = inNewVolumeRaw;
 
-        // CAVolumeCurve deals with volumes in three different scales: scalar, dB and raw. Raw
-        // volumes are the number of steps along the dB curve, so dB and raw volumes are linearly
-        // related.
-        //
-        // macOS uses the scalar volume to set the position of its volume sliders for the
-        // device. We have to set the scalar volume to the position of our volume slider for a
-        // device (more specifically, a linear mapping of it onto [0,1]) or macOS's volume sliders
-        // or it will work differently to our own.
-        //
-        // When we set a new slider position as the device's scalar volume, we convert it to raw
-        // with CAVolumeCurve::ConvertScalarToRaw, which will "undo the curve". However, we haven't
-        // applied the curve at that point.
-        //
-        // So, to actually apply the curve, we use CAVolumeCurve::ConvertRawToScalar to get the
-        // linear slider position back, map it onto the range of raw volumes and use
-        // CAVolumeCurve::ConvertRawToScalar again to apply the curve.
-        //
-        // It might be that we should be using CAVolumeCurve with transfer functions x^n where
-        // 0 < n < 1, but a lot more of the transfer functions it supports have n >= 1, including
-        // the default one. So I'm a bit confused.
-        //
-        // TODO: I think this means the dB volume we report will be wrong. It also makes the code
-        //       pretty confusing.
-        Float32 theSliderPosition = mVolumeCurve.ConvertRawToScalar(mVolumeRaw);
-
-        // TODO: This assumes the control should never boost the signal. (So, technically, it never
-        //       actually applies gain, only loss.)
-        SInt32 theRawRange = mMaxVolumeRaw - mMinVolumeRaw;
-        SInt32 theSliderPositionInRawSteps = static_cast<SInt32>(theSliderPosition * theRawRange);
-        theSliderPositionInRawSteps += mMinVolumeRaw;
-
-        mAmplitudeGain = mVolumeCurve.ConvertRawToScalar(theSliderPositionInRawSteps);
-
-        BGMAssert((mAmplitudeGain >= 0.0f) && (mAmplitudeGain <= 1.0f), "Gain not in [0,1]");
+        UpdateAmplitudeGain();
 
         // Send notifications.
         CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
@@ -458,5 +418,43 @@ void    BGM_VolumeControl::SetVolumeRaw(SInt32 inNewVolumeRaw)
     }
 }
 
+void    BGM_VolumeControl::UpdateAmplitudeGain()
+{
+    // CAVolumeCurve deals with volumes in three different scales: scalar, dB and raw. Raw
+    // volumes are the number of steps along the dB curve, so dB and raw volumes are linearly
+    // related.
+    //
+    // macOS uses the scalar volume to set the position of its volume sliders for the
+    // device. We have to set the scalar volume to the position of our volume slider for a
+    // device (more specifically, a linear mapping of it onto [0,1]) or macOS's volume sliders
+    // or it will work differently to our own.
+    //
+    // When we set a new slider position as the device's scalar volume, we convert it to raw
+    // with CAVolumeCurve::ConvertScalarToRaw, which will "undo the curve". However, we haven't
+    // applied the curve at that point.
+    //
+    // So, to actually apply the curve, we use CAVolumeCurve::ConvertRawToScalar to get the
+    // linear slider position back, map it onto the range of raw volumes and use
+    // CAVolumeCurve::ConvertRawToScalar again to apply the curve.
+    //
+    // It might be that we should be using CAVolumeCurve with transfer functions x^n where
+    // 0 < n < 1, but a lot more of the transfer functions it supports have n >= 1, including
+    // the default one. So I'm a bit confused.
+    //
+    // TODO: I think this means the dB volume we report will be wrong. It also makes the code
+    //       pretty confusing.
+    Float32 theSliderPosition = mVolumeCurve.ConvertRawToScalar(mVolumeRaw);
+
+    // TODO: This assumes the control should never boost the signal. (So, technically, it never
+    //       actually applies gain, only loss.)
+    SInt32 theRawRange = mMaxVolumeRaw - mMinVolumeRaw;
+    SInt32 theSliderPositionInRawSteps = static_cast<SInt32>(theSliderPosition * theRawRange);
+    theSliderPositionInRawSteps += mMinVolumeRaw;
+
+    mAmplitudeGain = mVolumeCurve.ConvertRawToScalar(theSliderPositionInRawSteps);
+
+    BGMAssert((mAmplitudeGain >= 0.0f) && (mAmplitudeGain <= 1.0f), "Gain not in [0,1]");
+}
+
 #pragma clang assume_nonnull end
 
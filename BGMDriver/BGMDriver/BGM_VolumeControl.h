@@ -26,6 +26,9 @@
 // Superclass Includes
 #include "BGM_Control.h"
 
+// Local Includes
+#include "BGM_VolumeCurveTable.h"
+
 // PublicUtility Includes
 #include "CAVolumeCurve.h"
 #include "CAMutex.h"
@@ -83,7 +86,14 @@ public:
      @return The curve used by this control to convert volume values from scalar into signal gain
              and/or decibels. A continuous 2D function.
      */
-    CAVolumeCurve&      GetVolumeCurve() { return mVolumeCurve; }
+    const CAVolumeCurve& GetVolumeCurve() const { return mVolumeCurve.GetCurve(); }
+    /*!
+     Change the transfer function of the control's volume curve.
+
+     @param inTransferFunction One of CAVolumeCurve's transfer function constants, e.g.
+                               CAVolumeCurve::kPow4Over1Curve.
+     */
+    void                SetVolumeCurveTransferFunction(UInt32 inTransferFunction);
 
     /*!
      Set the volume of this control to a given position along its volume curve. (See
@@ -140,6 +150,9 @@ protected:
     void                SetVolumeRaw(SInt32 inNewVolumeRaw);
 
 private:
+    /*! Update mAmplitudeGain for the current volume. The caller must hold mMutex. */
+    void                UpdateAmplitudeGain();
+
     const SInt32        kDefaultMinRawVolume = 0;
     const SInt32        kDefaultMaxRawVolume = 96;
     const Float32       kDefaultMinDbVolume  = -96.0f;
@@ -153,7 +166,8 @@ private:
     Float32             mMinVolumeDb;
     Float32             mMaxVolumeDb;
 
-    CAVolumeCurve       mVolumeCurve;
+    // The control's CAVolumeCurve, with its conversions precomputed.
+    BGM_VolumeCurveTable mVolumeCurve;
     // The gain (or loss) to apply to an audio signal to increase/decrease its volume by the current
     // volume of this control.
     Float32             mAmplitudeGain;
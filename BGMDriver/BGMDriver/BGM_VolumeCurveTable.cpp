@@ -0,0 +1,254 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_VolumeCurveTable.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_VolumeCurveTable.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+
+// STL Includes
+#include <cstring>
+#include <limits>
+
+
+#pragma clang assume_nonnull begin
+
+constexpr SInt32    BGM_VolumeCurveTable::kMaxRawSteps;
+
+// Floats map to these keys in the same order as they compare, so the threshold search can bisect
+// the floats between two values. (NaNs aside, which it never sees.)
+static UInt32   FloatToOrderedKey(Float32 inValue)
+{
+    UInt32 theBits;
+    memcpy(&theBits, &inValue, sizeof(theBits));
+    return (theBits & 0x80000000) ? ~theBits : (theBits | 0x80000000);
+}
+
+static Float32  OrderedKeyToFloat(UInt32 inKey)
+{
+    UInt32 theBits = (inKey & 0x80000000) ? (inKey & 0x7FFFFFFF) : ~inKey;
+    Float32 theValue;
+    memcpy(&theValue, &theBits, sizeof(theValue));
+    return theValue;
+}
+
+#pragma mark Construction
+
+BGM_VolumeCurveTable::BGM_VolumeCurveTable(SInt32 inMinRaw,
+                                           SInt32 inMaxRaw,
+                                           Float32 inMinDB,
+                                           Float32 inMaxDB,
+                                           UInt32 inTransferFunction)
+{
+    mCurve.AddRange(inMinRaw, inMaxRaw, inMinDB, inMaxDB);
+    mCurve.SetTransferFunction(inTransferFunction);
+    Build();
+}
+
+BGM_VolumeCurveTable::BGM_VolumeCurveTable(const CAVolumeCurve& inCurve)
+:
+    mCurve(inCurve)
+{
+    Build();
+}
+
+void    BGM_VolumeCurveTable::SetTransferFunction(UInt32 inTransferFunction)
+{
+    mCurve.SetTransferFunction(inTransferFunction);
+    Build();
+}
+
+#pragma mark Conversions
+
+Float32 BGM_VolumeCurveTable::ConvertRawToScalar(SInt32 inRaw) const
+{
+    if(!mIsTabulated)
+    {
+        return mCurve.ConvertRawToScalar(inRaw);
+    }
+
+    return mRawToScalar[static_cast<size_t>(ClampRaw(inRaw) - mMinRaw)];
+}
+
+Float32 BGM_VolumeCurveTable::ConvertRawToDB(SInt32 inRaw) const
+{
+    if(!mIsTabulated)
+    {
+        return mCurve.ConvertRawToDB(inRaw);
+    }
+
+    return mRawToDB[static_cast<size_t>(ClampRaw(inRaw) - mMinRaw)];
+}
+
+SInt32  BGM_VolumeCurveTable::ConvertScalarToRaw(Float32 inScalar) const
+{
+    if(!mIsTabulated)
+    {
+        return mCurve.ConvertScalarToRaw(inScalar);
+    }
+
+    // Clamp the value the same way CAVolumeCurve does, which also turns NaN into 0.
+    inScalar = std::min(1.0f, std::max(0.0f, inScalar));
+
+    return LookUpRaw(mScalarThresholds, inScalar);
+}
+
+SInt32  BGM_VolumeCurveTable::ConvertDBToRaw(Float32 inDB) const
+{
+    if(!mIsTabulated)
+    {
+        return mCurve.ConvertDBToRaw(inDB);
+    }
+
+    // CAVolumeCurve doesn't handle NaN, but clamping it like this gives the minimum volume.
+    inDB = std::min(mMaxDB, std::max(mMinDB, inDB));
+
+    return LookUpRaw(mDBThresholds, inDB);
+}
+
+Float32 BGM_VolumeCurveTable::ConvertScalarToDB(Float32 inScalar) const
+{
+    return ConvertRawToDB(ConvertScalarToRaw(inScalar));
+}
+
+Float32 BGM_VolumeCurveTable::ConvertDBToScalar(Float32 inDB) const
+{
+    return ConvertRawToScalar(ConvertDBToRaw(inDB));
+}
+
+#pragma mark Implementation
+
+void    BGM_VolumeCurveTable::Build()
+{
+    mIsTabulated = false;
+    mRawToScalar.clear();
+    mRawToDB.clear();
+    mScalarThresholds.clear();
+    mDBThresholds.clear();
+
+    mMinRaw = mCurve.GetMinimumRaw();
+    mMaxRaw = mCurve.GetMaximumRaw();
+    mMinDB = mCurve.GetMinimumDB();
+    mMaxDB = mCurve.GetMaximumDB();
+
+    // A curve with no ranges has a raw range of zero. CAVolumeCurve can't convert with those anyway.
+    const SInt64 theRawRange = static_cast<SInt64>(mMaxRaw) - static_cast<SInt64>(mMinRaw);
+
+    if(theRawRange <= 0 || theRawRange > kMaxRawSteps || !(mMinDB <= mMaxDB))
+    {
+        DebugMsg("BGM_VolumeCurveTable::Build: Not tabulating a curve with raw range [%d, %d] and dB "
+                 "range [%f, %f]",
+                 mMinRaw,
+                 mMaxRaw,
+                 mMinDB,
+                 mMaxDB);
+        return;
+    }
+
+    for(SInt32 theRaw = mMinRaw; theRaw <= mMaxRaw; theRaw++)
+    {
+        mRawToScalar.push_back(mCurve.ConvertRawToScalar(theRaw));
+        mRawToDB.push_back(mCurve.ConvertRawToDB(theRaw));
+    }
+
+    bool theThresholdsFound =
+            FindThresholds(0.0f,
+                           1.0f,
+                           [&](Float32 inScalar) { return mCurve.ConvertScalarToRaw(inScalar); },
+                           mScalarThresholds) &&
+            FindThresholds(mMinDB,
+                           mMaxDB,
+                           [&](Float32 inDB) { return mCurve.ConvertDBToRaw(inDB); },
+                           mDBThresholds);
+
+    if(!theThresholdsFound)
+    {
+        LogWarning("BGM_VolumeCurveTable::Build: Couldn't tabulate the curve");
+        mRawToScalar.clear();
+        mRawToDB.clear();
+        mScalarThresholds.clear();
+        mDBThresholds.clear();
+        return;
+    }
+
+    mIsTabulated = true;
+}
+
+template <typename Convert>
+bool    BGM_VolumeCurveTable::FindThresholds(Float32 inMin,
+                                             Float32 inMax,
+                                             Convert inConvert,
+                                             std::vector<Float32>& outThresholds) const
+{
+    if(inConvert(inMin) < mMinRaw || inConvert(inMax) != mMaxRaw)
+    {
+        return false;
+    }
+
+    const UInt32 theMaxKey = FloatToOrderedKey(inMax);
+    Float32 thePreviousThreshold = inMin;
+
+    for(SInt32 theRaw = mMinRaw + 1; theRaw <= mMaxRaw; theRaw++)
+    {
+        // The thresholds can't decrease, so each search starts from the last one. If it already
+        // converts to this step, the step before was skipped and they share a threshold.
+        if(inConvert(thePreviousThreshold) < theRaw)
+        {
+            // Bisect the floats between the last threshold, which converts to a smaller raw value,
+            // and inMax, which converts to mMaxRaw.
+            UInt32 theLowKey = FloatToOrderedKey(thePreviousThreshold);
+            UInt32 theHighKey = theMaxKey;
+
+            while(theHighKey - theLowKey > 1)
+            {
+                UInt32 theMiddleKey = theLowKey + ((theHighKey - theLowKey) / 2);
+
+                if(inConvert(OrderedKeyToFloat(theMiddleKey)) >= theRaw)
+                {
+                    theHighKey = theMiddleKey;
+                }
+                else
+                {
+                    theLowKey = theMiddleKey;
+                }
+            }
+
+            thePreviousThreshold = OrderedKeyToFloat(theHighKey);
+        }
+
+        outThresholds.push_back(thePreviousThreshold);
+    }
+
+    return true;
+}
+
+SInt32  BGM_VolumeCurveTable::LookUpRaw(const std::vector<Float32>& inThresholds,
+                                        Float32 inValue) const
+{
+    // Count the thresholds at or below the value.
+    auto theStep = std::upper_bound(inThresholds.begin(), inThresholds.end(), inValue);
+    return mMinRaw + static_cast<SInt32>(theStep - inThresholds.begin());
+}
+
+#pragma clang assume_nonnull end
+
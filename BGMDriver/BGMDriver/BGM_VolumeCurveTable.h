@@ -0,0 +1,144 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_VolumeCurveTable.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  A CAVolumeCurve with its conversions precomputed.
+//
+//  CAVolumeCurve walks its std::map of ranges and calls powf for every conversion. The raw volumes
+//  of a curve are a small, fixed set of integers, though, so this class works out the scalar and dB
+//  values of every raw step once, when the curve is set, using CAVolumeCurve itself. Converting from
+//  raw is then an array index, and converting to raw is a binary search of the thresholds between
+//  the steps, which are also found using CAVolumeCurve. So the results are always exactly the same
+//  as CAVolumeCurve's, for any curve, including the standard transfer functions and custom ranges.
+//
+//  Curves with more than kMaxRawSteps raw steps, or no ranges, aren't tabulated. The conversions
+//  just call CAVolumeCurve for them.
+//
+//  Not thread-safe. The const methods don't allocate or lock, but they aren't called on real-time
+//  threads currently.
+//
+
+#ifndef BGMDriver__BGM_VolumeCurveTable
+#define BGMDriver__BGM_VolumeCurveTable
+
+// PublicUtility Includes
+#include "CAVolumeCurve.h"
+
+// STL Includes
+#include <algorithm>
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_VolumeCurveTable
+{
+
+public:
+    /*! The largest raw range that will be tabulated. */
+    static constexpr SInt32     kMaxRawSteps = 4096;
+
+    /*! Tabulate a curve with a single range, which is how the driver's curves are all set up. */
+                                BGM_VolumeCurveTable(SInt32 inMinRaw,
+                                                     SInt32 inMaxRaw,
+                                                     Float32 inMinDB,
+                                                     Float32 inMaxDB,
+                                                     UInt32 inTransferFunction =
+                                                             CAVolumeCurve::kPow2Over1Curve);
+    /*! Tabulate a custom curve, which can have any number of ranges. */
+    explicit                    BGM_VolumeCurveTable(const CAVolumeCurve& inCurve);
+
+    /*! @return The curve the conversions are equivalent to. */
+    const CAVolumeCurve&        GetCurve() const { return mCurve; }
+
+    /*!
+     Change the curve's transfer function and rebuild the tables. Allocates.
+
+     @param inTransferFunction One of CAVolumeCurve's transfer function constants, e.g.
+                               CAVolumeCurve::kPow4Over1Curve.
+     */
+    void                        SetTransferFunction(UInt32 inTransferFunction);
+
+    /*! @return True if the conversions use the tables, rather than calling CAVolumeCurve. */
+    bool                        IsTabulated() const { return mIsTabulated; }
+
+    SInt32                      GetMinimumRaw() const { return mMinRaw; }
+    SInt32                      GetMaximumRaw() const { return mMaxRaw; }
+    Float32                     GetMinimumDB() const { return mMinDB; }
+    Float32                     GetMaximumDB() const { return mMaxDB; }
+
+#pragma mark Conversions
+
+    // These return the same values as the CAVolumeCurve methods with the same names.
+
+    Float32                     ConvertRawToScalar(SInt32 inRaw) const;
+    Float32                     ConvertRawToDB(SInt32 inRaw) const;
+    SInt32                      ConvertScalarToRaw(Float32 inScalar) const;
+    SInt32                      ConvertDBToRaw(Float32 inDB) const;
+    Float32                     ConvertScalarToDB(Float32 inScalar) const;
+    Float32                     ConvertDBToScalar(Float32 inDB) const;
+
+#pragma mark Implementation
+
+private:
+    void                        Build();
+
+    /*!
+     Fill outThresholds with the smallest input value that inConvert converts to each raw step after
+     the first one. inConvert must not decrease as its input increases.
+
+     @return False if inConvert doesn't map [inMin, inMax] onto the curve's raw range.
+     */
+    template <typename Convert>
+    bool                        FindThresholds(Float32 inMin,
+                                               Float32 inMax,
+                                               Convert inConvert,
+                                               std::vector<Float32>& outThresholds) const;
+
+    SInt32                      ClampRaw(SInt32 inRaw) const
+                                    { return std::min(std::max(mMinRaw, inRaw), mMaxRaw); }
+    /*! @return The raw step of inValue, which must have been clamped, given inThresholds. */
+    SInt32                      LookUpRaw(const std::vector<Float32>& inThresholds,
+                                          Float32 inValue) const;
+
+    CAVolumeCurve               mCurve;
+    bool                        mIsTabulated = false;
+
+    SInt32                      mMinRaw = 0;
+    SInt32                      mMaxRaw = 0;
+    Float32                     mMinDB = 0.0f;
+    Float32                     mMaxDB = 0.0f;
+
+    // Indexed by the number of raw steps from mMinRaw.
+    std::vector<Float32>        mRawToScalar;
+    std::vector<Float32>        mRawToDB;
+    // Element i is the smallest scalar/dB value that converts to a raw volume of mMinRaw + i + 1.
+    std::vector<Float32>        mScalarThresholds;
+    std::vector<Float32>        mDBThresholds;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_VolumeCurveTable */
+
@@ -75,6 +75,10 @@ public:
     // The client's pan position, in the range [-100, 100] where -100 is left and 100 is right
     SInt32                        mPanPosition = 0;
     
+    // The index of the capture tap (see BGM_CaptureTaps) the client's audio is copied into, or -1 if
+    // the client's app isn't being tapped
+    SInt32                        mCaptureTap = -1;
+    
 };
 
 #pragma clang assume_nonnull end
@@ -31,6 +31,9 @@
 #include "CACFDictionary.h"
 #include "CAException.h"
 
+// STL Includes
+#include <algorithm>
+
 
 #pragma clang assume_nonnull begin
 
@@ -105,25 +108,49 @@ BGM_Client    BGM_ClientMap::RemoveClient(UInt32 inClientID)
     BGM_Client theClient = theClientItr->second;
     
     // Remove the client from the shadow maps
-    mClientMapShadow.erase(theClientItr);
-    mClientMapByPIDShadow.erase(theClient.mProcessID);
-    if(theClient.mBundleID.IsValid())
-    {
-        mClientMapByBundleID.erase(theClient.mBundleID);
-    }
+    RemoveClientFromShadowMaps(inClientID);
     
     // Swap the maps with their shadow maps
     SwapInShadowMaps();
     
-    // Erase the client again so the maps and their shadow maps are kept identical
-    mClientMapShadow.erase(inClientID);
-    mClientMapByPIDShadow.erase(theClient.mProcessID);
-    if(theClient.mBundleID.IsValid())
+    // Remove the client again so the maps and their shadow maps are kept identical
+    RemoveClientFromShadowMaps(inClientID);
+    
+    return theClient;
+}
+
+void    BGM_ClientMap::RemoveClientFromShadowMaps(UInt32 inClientID)
+{
+    auto theClientItr = mClientMapShadow.find(inClientID);
+    Assert(theClientItr != mClientMapShadow.end(),
+           "BGM_ClientMap::RemoveClientFromShadowMaps: Client not in the shadow maps");
+    
+    BGM_Client* theClientInMap = &theClientItr->second;
+    
+    // Remove only this client's pointers from the PID and bundle ID maps. Other clients can have the
+    // same PID or bundle ID and they still need to be found by it.
+    auto theRemoveFromList = [&] (BGM_ClientPtrList& ioClients) {
+        ioClients.erase(std::remove(ioClients.begin(), ioClients.end(), theClientInMap), ioClients.end());
+        return ioClients.empty();
+    };
+    
+    auto thePIDItr = mClientMapByPIDShadow.find(theClientInMap->mProcessID);
+    if(thePIDItr != mClientMapByPIDShadow.end() && theRemoveFromList(thePIDItr->second))
     {
-        mClientMapByBundleID.erase(theClient.mBundleID);
+        mClientMapByPIDShadow.erase(thePIDItr);
     }
     
-    return theClient;
+    if(theClientInMap->mBundleID.IsValid())
+    {
+        auto theBundleIDItr = mClientMapByBundleIDShadow.find(theClientInMap->mBundleID);
+        if(theBundleIDItr != mClientMapByBundleIDShadow.end() && theRemoveFromList(theBundleIDItr->second))
+        {
+            mClientMapByBundleIDShadow.erase(theBundleIDItr);
+        }
+    }
+    
+    // Remove the client itself last, since the pointer maps point into this map
+    mClientMapShadow.erase(theClientItr);
 }
 
 bool    BGM_ClientMap::GetClientRT(UInt32 inClientID, BGM_Client* outClient) const
@@ -171,6 +198,20 @@ std::vector<BGM_Client> BGM_ClientMap::GetClientsByPID(pid_t inPID) const
     return theClients;
 }
 
+std::vector<BGM_Client> BGM_ClientMap::GetClientsNonRT() const
+{
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    
+    std::vector<BGM_Client> theClients;
+    
+    for(auto& theMapItr : mClientMapShadow)
+    {
+        theClients.push_back(theMapItr.second);
+    }
+    
+    return theClients;
+}
+
 #pragma mark Music Player
 
 void    BGM_ClientMap::UpdateMusicPlayerFlags(pid_t inMusicPlayerPID)
@@ -208,9 +249,29 @@ void    BGM_ClientMap::UpdateMusicPlayerFlagsInShadowMaps(std::function<bool(BGM
     }
 }
 
+#pragma mark Capture Taps
+
+void    BGM_ClientMap::UpdateCaptureTaps(std::function<SInt32(const BGM_Client&)> inCaptureTapForClient)
+{
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    
+    UpdateCaptureTapsInShadowMaps(inCaptureTapForClient);
+    SwapInShadowMaps();
+    UpdateCaptureTapsInShadowMaps(inCaptureTapForClient);
+}
+
+void    BGM_ClientMap::UpdateCaptureTapsInShadowMaps(std::function<SInt32(const BGM_Client&)> inCaptureTapForClient)
+{
+    for(auto& theItr : mClientMapShadow)
+    {
+        BGM_Client& theClient = theItr.second;
+        theClient.mCaptureTap = inCaptureTapForClient(theClient);
+    }
+}
+
 #pragma mark App Volumes
 
-CACFArray   BGM_ClientMap::CopyClientRelativeVolumesAsAppVolumes(CAVolumeCurve inVolumeCurve) const
+CACFArray   BGM_ClientMap::CopyClientRelativeVolumesAsAppVolumes(const BGM_VolumeCurveTable& inVolumeCurve) const
 {
     // Since this is a read-only, non-real-time operation, we can read from the shadow maps to avoid
     // locking the main maps.
@@ -231,7 +292,7 @@ CACFArray   BGM_ClientMap::CopyClientRelativeVolumesAsAppVolumes(CAVolumeCurve i
     return theAppVolumes;
 }
 
-void    BGM_ClientMap::CopyClientIntoAppVolumesArray(BGM_Client inClient, CAVolumeCurve inVolumeCurve, CACFArray& ioAppVolumes) const
+void    BGM_ClientMap::CopyClientIntoAppVolumesArray(BGM_Client inClient, const BGM_VolumeCurveTable& inVolumeCurve, CACFArray& ioAppVolumes) const
 {
     // Only include clients set to a non-default volume or pan
     if(inClient.mRelativeVolume != 1.0 || inClient.mPanPosition != 0)
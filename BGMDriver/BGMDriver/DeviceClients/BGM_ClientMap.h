@@ -26,12 +26,12 @@
 // Local Includes
 #include "BGM_Client.h"
 #include "BGM_TaskQueue.h"
+#include "BGM_VolumeCurveTable.h"
 
 // PublicUtility Includes
 #include "CAMutex.h"
 #include "CACFString.h"
 #include "CACFArray.h"
-#include "CAVolumeCurve.h"
 
 // STL Includes
 #include <map>
@@ -88,6 +88,10 @@ public:
     // Returns the removed client
     BGM_Client                                          RemoveClient(UInt32 inClientID);
     
+private:
+    void                                                RemoveClientFromShadowMaps(UInt32 inClientID);
+    
+public:
     // These methods are functionally identical except that GetClientRT must only be called from real-time threads and GetClientNonRT
     // must only be called from non-real-time threads. Both return true if a client was found.
     bool                                                GetClientRT(UInt32 inClientID, BGM_Client* outClient) const;
@@ -100,6 +104,8 @@ private:
     
 public:
     std::vector<BGM_Client>                             GetClientsByPID(pid_t inPID) const;
+    // Returns copies of all of the current clients. Must only be called from non-real-time threads.
+    std::vector<BGM_Client>                             GetClientsNonRT() const;
     
     // Set the isMusicPlayer flag for each client. (True if the client has the given bundle ID/PID, false otherwise.)
     void                                                UpdateMusicPlayerFlags(pid_t inMusicPlayerPID);
@@ -108,14 +114,21 @@ public:
 private:
     void                                                UpdateMusicPlayerFlagsInShadowMaps(std::function<bool(BGM_Client)> inIsMusicPlayerTest);
     
+public:
+    // Set the capture tap index of each client to the value returned by inCaptureTapForClient.
+    void                                                UpdateCaptureTaps(std::function<SInt32(const BGM_Client&)> inCaptureTapForClient);
+    
+private:
+    void                                                UpdateCaptureTapsInShadowMaps(std::function<SInt32(const BGM_Client&)> inCaptureTapForClient);
+    
 public:
     // Copies the current and past clients into an array in the format expected for
     // kAudioDeviceCustomPropertyAppVolumes. (Except that CACFArray and CACFDictionary are used instead
     // of unwrapped CFArray and CFDictionary refs.)
-    CACFArray                                           CopyClientRelativeVolumesAsAppVolumes(CAVolumeCurve inVolumeCurve) const;
+    CACFArray                                           CopyClientRelativeVolumesAsAppVolumes(const BGM_VolumeCurveTable& inVolumeCurve) const;
     
 private:
-    void                                                CopyClientIntoAppVolumesArray(BGM_Client inClient, CAVolumeCurve inVolumeCurve, CACFArray& ioAppVolumes) const;
+    void                                                CopyClientIntoAppVolumesArray(BGM_Client inClient, const BGM_VolumeCurveTable& inVolumeCurve, CACFArray& ioAppVolumes) const;
     
 public:
     // Using the template function hits LLVM Bug 23987
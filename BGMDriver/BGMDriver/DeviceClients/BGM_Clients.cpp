@@ -39,12 +39,12 @@
 BGM_Clients::BGM_Clients(AudioObjectID inOwnerDeviceID, BGM_TaskQueue* inTaskQueue)
 :
     mOwnerDeviceID(inOwnerDeviceID),
-    mClientMap(inTaskQueue)
+    mClientMap(inTaskQueue),
+    mRelativeVolumeCurve(kAppRelativeVolumeMinRawValue,
+                         kAppRelativeVolumeMaxRawValue,
+                         kAppRelativeVolumeMinDbValue,
+                         kAppRelativeVolumeMaxDbValue)
 {
-    mRelativeVolumeCurve.AddRange(kAppRelativeVolumeMinRawValue,
-                                  kAppRelativeVolumeMaxRawValue,
-                                  kAppRelativeVolumeMinDbValue,
-                                  kAppRelativeVolumeMaxDbValue);
 }
 
 #pragma mark Add/Remove Clients
@@ -68,6 +68,13 @@ void    BGM_Clients::AddClient(BGM_Client inClient)
         DebugMsg("BGM_Clients::AddClient: Adding music player client. mClientID = %u", inClient.mClientID);
     }
     
+    // Check whether the client's app is being tapped
+    if(inClient.mBundleID.IsValid())
+    {
+        auto theTapItr = mCaptureTapsByBundleID.find(inClient.mBundleID);
+        inClient.mCaptureTap = (theTapItr != mCaptureTapsByBundleID.end() ? theTapItr->second : -1);
+    }
+    
     mClientMap.AddClient(inClient);
     
     // If we're adding BGMApp, update our local copy of its client ID
@@ -399,3 +406,33 @@ bool    BGM_Clients::SetClientsRelativeVolumes(const CACFArray inAppVolumes)
     return didChangeAppVolumes;
 }
 
+#pragma mark Capture Taps
+
+void    BGM_Clients::SetCaptureTaps(const std::map<CACFString, SInt32>& inTapsByBundleID)
+{
+    CAMutex::Locker theLocker(mMutex);
+    
+    mCaptureTapsByBundleID = inTapsByBundleID;
+    
+    mClientMap.UpdateCaptureTaps([&] (const BGM_Client& inClient) {
+        if(inClient.mBundleID.IsValid())
+        {
+            auto theTapItr = inTapsByBundleID.find(inClient.mBundleID);
+            
+            if(theTapItr != inTapsByBundleID.end())
+            {
+                return theTapItr->second;
+            }
+        }
+        
+        return static_cast<SInt32>(-1);
+    });
+}
+
+SInt32  BGM_Clients::GetClientCaptureTapRT(UInt32 inClientID) const
+{
+    BGM_Client theClient;
+    bool didGetClient = mClientMap.GetClientRT(inClientID, &theClient);
+    return (didGetClient ? theClient.mCaptureTap : -1);
+}
+
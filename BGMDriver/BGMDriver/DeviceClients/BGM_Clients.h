@@ -26,12 +26,15 @@
 // Local Includes
 #include "BGM_Client.h"
 #include "BGM_ClientMap.h"
+#include "BGM_VolumeCurveTable.h"
 
 // PublicUtility Includes
-#include "CAVolumeCurve.h"
 #include "CAMutex.h"
 #include "CACFArray.h"
 
+// STL Includes
+#include <map>
+
 // System Includes
 #include <CoreAudio/AudioServerPlugIn.h>
 
@@ -97,6 +100,9 @@ public:
     Float32                             GetClientRelativeVolumeRT(UInt32 inClientID) const;
     SInt32                              GetClientPanPositionRT(UInt32 inClientID) const;
     
+    // Returns copies of all of the current clients. Must only be called from non-real-time threads.
+    std::vector<BGM_Client>             GetClientsNonRT() const { return mClientMap.GetClientsNonRT(); };
+    
     // Copies the current and past clients into an array in the format expected for
     // kAudioDeviceCustomPropertyAppVolumes. (Except that CACFArray and CACFDictionary are used instead
     // of unwrapped CFArray and CFDictionary refs.)
@@ -110,6 +116,13 @@ public:
     // Returns true if any clients' relative volumes were changed.
     bool                                SetClientsRelativeVolumes(const CACFArray inAppVolumes);
     
+    // Set the capture tap of each current and future client whose bundle ID is in inTapsByBundleID.
+    // Clients of other apps are untapped. See BGM_CaptureTaps.
+    void                                SetCaptureTaps(const std::map<CACFString, SInt32>& inTapsByBundleID);
+    
+    // Returns the index of the client's capture tap, or -1 if it doesn't have one.
+    SInt32                              GetClientCaptureTapRT(UInt32 inClientID) const;
+    
 private:
     AudioObjectID                       mOwnerDeviceID;
     BGM_ClientMap                       mClientMap;
@@ -140,8 +153,12 @@ private:
     // property's value if the HAL asks for it, and to recognise the music player if it's added a client.
     CACFString                          mMusicPlayerBundleIDProperty { "" };
     
+    // The index of the capture tap for each tapped app, so clients the app adds later get the tap
+    // as well.
+    std::map<CACFString, SInt32>        mCaptureTapsByBundleID;
+    
     // The volume curve we apply to raw client volumes before they're used
-    CAVolumeCurve                       mRelativeVolumeCurve;
+    BGM_VolumeCurveTable                mRelativeVolumeCurve;
     
 };
 
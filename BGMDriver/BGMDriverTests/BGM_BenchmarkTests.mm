@@ -0,0 +1,1013 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_BenchmarkTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Microbenchmarks for the code BGMDriver runs on the IO thread, the data structures it uses, its task
+//  queues and its HAL property queries (both called directly and through the plug-in's interface),
+//  over a range of buffer sizes and client counts. Each benchmark is identified by a string like
+//  "Device.IOCycle/clients=4,frames=512" and measured in nanoseconds per operation (the median of
+//  several samples).
+//
+//  They run with the other tests, but only for a short time each. These environment variables
+//  control them:
+//
+//      BGM_BENCHMARK_SAMPLE_SECONDS  How long to run each sample for. 0.02 by default. Use something
+//                                    like 0.2 for more stable results.
+//      BGM_BENCHMARK_OUTPUT          A path to write the results to, as JSON.
+//      BGM_BENCHMARK_BASELINE        The path of a results file written with BGM_BENCHMARK_OUTPUT.
+//                                    Benchmarks that have become slower than they were in it fail.
+//      BGM_BENCHMARK_TOLERANCE       How much slower, as a fraction, a benchmark can be than the
+//                                    baseline without failing. 0.25 by default.
+//
+//  For example, to compare a change against master:
+//
+//      git checkout master
+//      BGM_BENCHMARK_SAMPLE_SECONDS=0.2 BGM_BENCHMARK_OUTPUT=/tmp/base.json xcodebuild test ...
+//      git checkout my-branch
+//      BGM_BENCHMARK_SAMPLE_SECONDS=0.2 BGM_BENCHMARK_BASELINE=/tmp/base.json xcodebuild test ...
+//
+//  (xcodebuild passes environment variables prefixed with TEST_RUNNER_ through to the tests, e.g.
+//  TEST_RUNNER_BGM_BENCHMARK_OUTPUT.)
+//
+
+// Local Includes
+#include "BGM_AudibleState.h"
+#include "BGM_Client.h"
+#include "BGM_ClientMap.h"
+#include "BGM_Clients.h"
+#include "BGM_Device.h"
+#include "BGM_DSP.h"
+#include "BGM_MockHost.h"
+#include "BGM_PlugIn.h"
+#include "BGM_PropertyFuzzer.h"
+#include "BGM_TaskQueue.h"
+#include "BGM_TestUtils.h"
+#include "BGM_Types.h"
+#include "BGM_VolumeControl.h"
+#include "BGM_VolumeCurveTable.h"
+
+// PublicUtility Includes
+#include "CACFArray.h"
+#include "CACFDictionary.h"
+#include "CADispatchQueue.h"
+#include "CARingBuffer.h"
+#include "CAVolumeCurve.h"
+
+// STL Includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+static const std::vector<UInt32> kBufferFrameSizes = { 64, 256, 512, 1024, 4096 };
+static const std::vector<UInt32> kClientCounts = { 1, 4, 16 };
+static const std::vector<UInt32> kClientMapSizes = { 1, 16, 64, 256 };
+static const int kSamples = 5;
+
+#pragma mark Benchmark Harness
+
+struct BGM_BenchmarkResult
+{
+    std::string                 mID;
+    Float64                     mNanosPerOp;
+    // Zero if the operation doesn't process audio.
+    UInt32                      mFramesPerOp;
+    UInt64                      mIterationsPerSample;
+};
+
+// The results from all the benchmarks run so far, written to BGM_BENCHMARK_OUTPUT at the end.
+static std::vector<BGM_BenchmarkResult> sResults;
+
+static Float64 GetEnvFloat64(const char* inName, Float64 inDefault)
+{
+    const char* theValue = getenv(inName);
+    return (theValue != nullptr) ? atof(theValue) : inDefault;
+}
+
+// Runs inOperation repeatedly and returns the median of kSamples measurements of its average
+// time, in nanoseconds. Each sample runs it enough times to take BGM_BENCHMARK_SAMPLE_SECONDS.
+static Float64 MeasureNanosPerOp(const std::function<void()>& inOperation, UInt64& outIterationsPerSample)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    const Float64 theSampleNanos = GetEnvFloat64("BGM_BENCHMARK_SAMPLE_SECONDS", 0.02) * 1e9;
+
+    auto timeIterations = [&](UInt64 inIterations) {
+        const Clock::time_point theStart = Clock::now();
+
+        for(UInt64 i = 0; i < inIterations; i++)
+        {
+            inOperation();
+        }
+
+        return static_cast<Float64>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - theStart).count());
+    };
+
+    // Find out how many iterations fill a sample. This also warms up the caches.
+    UInt64 theIterations = 1;
+    Float64 theNanos = timeIterations(theIterations);
+
+    while(theNanos < theSampleNanos && theIterations < (1ull << 40))
+    {
+        theIterations *= 2;
+        theNanos = timeIterations(theIterations);
+    }
+
+    std::vector<Float64> theSamples;
+
+    for(int i = 0; i < kSamples; i++)
+    {
+        theSamples.push_back(timeIterations(theIterations) / static_cast<Float64>(theIterations));
+    }
+
+    std::sort(theSamples.begin(), theSamples.end());
+    outIterationsPerSample = theIterations;
+
+    return theSamples[kSamples / 2];
+}
+
+// Reads the baseline results from BGM_BENCHMARK_BASELINE, if it's set. Maps benchmark IDs to their
+// nanoseconds per operation.
+static const std::map<std::string, Float64>& GetBaseline()
+{
+    static std::map<std::string, Float64> sBaseline;
+    static bool sLoaded = false;
+
+    if(!sLoaded)
+    {
+        sLoaded = true;
+        const char* thePath = getenv("BGM_BENCHMARK_BASELINE");
+
+        if(thePath != nullptr)
+        {
+            NSData* theData = [NSData dataWithContentsOfFile:@(thePath)];
+            NSDictionary* theJSON =
+                    theData ? [NSJSONSerialization JSONObjectWithData:theData options:0 error:nil] : nil;
+            NSDictionary* theResults =
+                    [theJSON isKindOfClass:[NSDictionary class]] ? theJSON[@"results"] : nil;
+
+            if([theResults isKindOfClass:[NSDictionary class]])
+            {
+                [theResults enumerateKeysAndObjectsUsingBlock:^(NSString* inID, NSDictionary* inResult, BOOL* outStop) {
+                    #pragma unused (outStop)
+                    NSNumber* theNanos =
+                            [inResult isKindOfClass:[NSDictionary class]] ? inResult[@"nsPerOp"] : nil;
+
+                    if([theNanos isKindOfClass:[NSNumber class]])
+                    {
+                        sBaseline[inID.UTF8String] = theNanos.doubleValue;
+                    }
+                }];
+            }
+            else
+            {
+                NSLog(@"BGM_BenchmarkTests: Couldn't read the baseline from %s", thePath);
+            }
+        }
+    }
+
+    return sBaseline;
+}
+
+#pragma mark Fixtures
+
+// Subclass BGM_Device so the tests can create their own instances.
+class BGM_BenchmarkTestDevice
+:
+    public BGM_Device
+{
+
+public:
+    BGM_BenchmarkTestDevice()
+    :
+        BGM_Device(kObjectID_Device,
+                   CFSTR(kDeviceName),
+                   CFSTR(kBGMDeviceUID),
+                   CFSTR(kBGMDeviceModelUID),
+                   kObjectID_Stream_Input,
+                   kObjectID_Stream_Output,
+                   kObjectID_Volume_Output_Master,
+                   kObjectID_Mute_Output_Master)
+    {
+        Activate();
+    }
+
+};
+
+// The driver's factory function, from BGM_PlugInInterface.cpp. It returns the interface the HAL uses
+// to call the driver.
+extern "C" void* BGM_Create(CFAllocatorRef inAllocator, CFUUIDRef inRequestedTypeUUID);
+
+static AudioServerPlugInClientInfo ClientInfo(UInt32 inIndex)
+{
+    // The bundle IDs are never released, but there are only a few hundred of them.
+    return {
+        /* mClientID = */ inIndex + 1,
+        /* mProcessID = */ static_cast<pid_t>(10000 + inIndex),
+        /* mIsNativeEndian = */ true,
+        /* mBundleID = */ CFStringCreateWithFormat(kCFAllocatorDefault,
+                                                   nullptr,
+                                                   CFSTR("com.example.benchmark.%u"),
+                                                   inIndex)
+    };
+}
+
+// Add inClientCount clients to inDevice, with client IDs from 1, and give them a relative volume and
+// pan position so ApplyClientRelativeVolume has something to do.
+static void AddClients(BGM_Device& inDevice, UInt32 inClientCount)
+{
+    CACFArray theAppVolumes(true);
+
+    for(UInt32 i = 0; i < inClientCount; i++)
+    {
+        AudioServerPlugInClientInfo theClientInfo = ClientInfo(i);
+        inDevice.AddClient(&theClientInfo);
+
+        CACFDictionary theAppVolume(true);
+        theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_ProcessID), theClientInfo.mProcessID);
+        theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_RelativeVolume), 25);
+        theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_PanPosition), -50);
+        theAppVolumes.AppendDictionary(theAppVolume.GetCFDictionary());
+    }
+
+    CFArrayRef theAppVolumesRef = theAppVolumes.GetCFArray();
+    inDevice.SetPropertyData(kObjectID_Device,
+                             0,
+                             kBGMAppVolumesAddress,
+                             0,
+                             nullptr,
+                             sizeof(CFArrayRef),
+                             &theAppVolumesRef);
+}
+
+// Change inDevice's sample rate. The device has to ask the host to let it make the change, so this
+// uses a BGM_MockHost to perform it.
+static void SetSampleRate(BGM_Device& inDevice, Float64 inSampleRate)
+{
+    if(inDevice.GetSampleRate() == inSampleRate)
+    {
+        return;
+    }
+
+    BGM_MockHost theHost;
+    BGM_PlugIn::SetHost(&theHost);
+
+    inDevice.SetPropertyData(kObjectID_Device,
+                             0,
+                             { kAudioDevicePropertyNominalSampleRate,
+                               kAudioObjectPropertyScopeGlobal,
+                               kAudioObjectPropertyElementMaster },
+                             0,
+                             nullptr,
+                             sizeof(Float64),
+                             &inSampleRate);
+    theHost.WaitForConfigChangeRequests();
+    theHost.PerformConfigChanges(inDevice);
+
+    // Let the driver finish sending any notifications it queued before removing the host.
+    CADispatchQueue::GetGlobalSerialQueue().Dispatch(true, ^{});
+    BGM_PlugIn::SetHost(nullptr);
+}
+
+// A buffer of interleaved stereo audio that's loud enough to be audible.
+static std::vector<Float32> TestAudio(UInt32 inFrames)
+{
+    std::vector<Float32> theAudio(inFrames * 2);
+
+    for(size_t i = 0; i < theAudio.size(); i++)
+    {
+        theAudio[i] = 0.25f * static_cast<Float32>((i % 64) / 32.0 - 1.0);
+    }
+
+    return theAudio;
+}
+
+static std::string FramesID(const char* inName, UInt32 inFrames)
+{
+    return std::string(inName) + "/frames=" + std::to_string(inFrames);
+}
+
+@interface BGM_BenchmarkTests : XCTestCase
+
+@end
+
+@implementation BGM_BenchmarkTests
+
++ (void) tearDown {
+    const char* thePath = getenv("BGM_BENCHMARK_OUTPUT");
+
+    if(thePath != nullptr)
+    {
+        NSMutableDictionary* theResults = [NSMutableDictionary dictionary];
+
+        for(const BGM_BenchmarkResult& theResult : sResults)
+        {
+            theResults[@(theResult.mID.c_str())] = @{
+                @"nsPerOp": @(theResult.mNanosPerOp),
+                @"framesPerOp": @(theResult.mFramesPerOp),
+                @"nsPerFrame": @(theResult.mFramesPerOp > 0 ? theResult.mNanosPerOp / theResult.mFramesPerOp : 0.0),
+                @"iterationsPerSample": @(theResult.mIterationsPerSample)
+            };
+        }
+
+        NSDictionary* theJSON = @{
+            @"format": @"BGMDriverBenchmarks",
+            @"version": @1,
+            @"sampleSeconds": @(GetEnvFloat64("BGM_BENCHMARK_SAMPLE_SECONDS", 0.02)),
+            @"results": theResults
+        };
+
+        NSData* theData = [NSJSONSerialization dataWithJSONObject:theJSON
+                                                          options:NSJSONWritingPrettyPrinted
+                                                            error:nil];
+
+        if(![theData writeToFile:@(thePath) atomically:YES])
+        {
+            NSLog(@"BGM_BenchmarkTests: Couldn't write the results to %s", thePath);
+        }
+    }
+
+    [super tearDown];
+}
+
+// Measures inOperation, records the result and fails if it's slower than the baseline allows.
+- (void) benchmark:(const std::string&)inID
+       framesPerOp:(UInt32)inFramesPerOp
+         operation:(const std::function<void()>&)inOperation {
+    UInt64 theIterations = 0;
+    const Float64 theNanos = MeasureNanosPerOp(inOperation, theIterations);
+
+    sResults.push_back({ inID, theNanos, inFramesPerOp, theIterations });
+
+    const std::map<std::string, Float64>& theBaseline = GetBaseline();
+    auto theBaselineResult = theBaseline.find(inID);
+
+    if(theBaselineResult == theBaseline.end())
+    {
+        NSLog(@"%s: %.1f ns", inID.c_str(), theNanos);
+    }
+    else
+    {
+        const Float64 theChange = (theNanos / theBaselineResult->second) - 1.0;
+        NSLog(@"%s: %.1f ns (%+.1f%% vs. baseline)", inID.c_str(), theNanos, theChange * 100.0);
+
+        const Float64 theTolerance = GetEnvFloat64("BGM_BENCHMARK_TOLERANCE", 0.25);
+        XCTAssertLessThanOrEqual(theChange,
+                                 theTolerance,
+                                 "%s regressed: %.1f ns, baseline %.1f ns",
+                                 inID.c_str(),
+                                 theNanos,
+                                 theBaselineResult->second);
+    }
+}
+
+#pragma mark Audio Kernels
+
+- (void) testVolumeControlApplyVolume {
+    BGM_VolumeControl theVolumeControl(kObjectID_Volume_Output_Master, kObjectID_Device);
+    theVolumeControl.SetWillApplyVolumeToAudio(true);
+    theVolumeControl.SetVolumeScalar(0.5f);
+
+    for(UInt32 theFrames : kBufferFrameSizes)
+    {
+        const std::vector<Float32> theSource = TestAudio(theFrames);
+        std::vector<Float32> theBuffer(theSource.size());
+
+        // Copy the input in each time, as if it was a new buffer from the HAL, so the samples don't
+        // decay into subnormals.
+        [self benchmark:FramesID("VolumeControl.ApplyVolumeToAudioRT", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  std::copy(theSource.begin(), theSource.end(), theBuffer.begin());
+                  theVolumeControl.ApplyVolumeToAudioRT(theBuffer.data(), theFrames);
+              }];
+    }
+}
+
+- (void) testAudibleStateSilentBuffer {
+    // A silent buffer is the worst case for BGM_AudibleState::BufferIsAudible, since it has to
+    // check every sample.
+    BGM_AudibleState theAudibleState;
+
+    for(UInt32 theFrames : kBufferFrameSizes)
+    {
+        const std::vector<Float32> theBuffer(theFrames * 2, 0.0f);
+        Float64 theSampleTime = 0.0;
+
+        [self benchmark:FramesID("AudibleState.UpdateWithClientIO.Silent", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  theAudibleState.UpdateWithClientIO(false, theFrames, theSampleTime, theBuffer.data());
+                  theSampleTime += theFrames;
+              }];
+
+        // The check BGM_Device uses to skip processing silent buffers.
+        [self benchmark:FramesID("AudibleState.BufferIsSilent", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  // Make sure the compiler can't optimise the call away.
+                  volatile bool theIsSilent =
+                          BGM_AudibleState::BufferIsSilent(theFrames, theBuffer.data());
+                  #pragma unused (theIsSilent)
+              }];
+    }
+}
+
+- (void) testDSPKernels {
+    // The IDs don't include the backend, so builds with different BGM_DSP_BACKEND values can be
+    // compared using BGM_BENCHMARK_BASELINE.
+    NSLog(@"BGM_BenchmarkTests: BGM_DSP backend: %s", BGM_DSP::GetBackendName());
+
+    const BGM_DSP::StereoMatrix theMatrix { 0.75f, 0.25f, 0.0f, 1.0f };
+
+    for(UInt32 theFrames : kBufferFrameSizes)
+    {
+        const UInt32 theSampleCount = theFrames * 2;
+        const std::vector<Float32> theSource = TestAudio(theFrames);
+        const std::vector<Float32> theGains(theFrames, 0.5f);
+        std::vector<Float32> theBuffer(theSource.size());
+        std::vector<Float32> thePeaks(theFrames);
+
+        // The functions that work in place copy the input in each time, as in
+        // testVolumeControlApplyVolume.
+        [self benchmark:FramesID("DSP.Scale", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  std::copy(theSource.begin(), theSource.end(), theBuffer.begin());
+                  BGM_DSP::Scale(theBuffer.data(), theSampleCount, 0.5f);
+              }];
+
+        [self benchmark:FramesID("DSP.ScaleAndClip", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  std::copy(theSource.begin(), theSource.end(), theBuffer.begin());
+                  BGM_DSP::ScaleAndClip(theBuffer.data(), theSampleCount, 1.5f, -1.0f, 1.0f);
+              }];
+
+        [self benchmark:FramesID("DSP.ScaleWithRamp", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  std::copy(theSource.begin(), theSource.end(), theBuffer.begin());
+                  BGM_DSP::ScaleWithRamp(theBuffer.data(), theFrames, 1.0f, -0.5f / theFrames);
+              }];
+
+        [self benchmark:FramesID("DSP.ScaleStereoFrames", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  BGM_DSP::ScaleStereoFrames(theSource.data(), theGains.data(), theBuffer.data(), theFrames);
+              }];
+
+        [self benchmark:FramesID("DSP.MixStereo", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  std::copy(theSource.begin(), theSource.end(), theBuffer.begin());
+                  BGM_DSP::MixStereo(theBuffer.data(), theFrames, theMatrix);
+              }];
+
+        [self benchmark:FramesID("DSP.MixStereoAndClip", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  std::copy(theSource.begin(), theSource.end(), theBuffer.begin());
+                  BGM_DSP::MixStereoAndClip(theBuffer.data(), theFrames, theMatrix, -1.0f, 1.0f);
+              }];
+
+        [self benchmark:FramesID("DSP.Accumulate", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  std::copy(theSource.begin(), theSource.end(), theBuffer.begin());
+                  BGM_DSP::Accumulate(theBuffer.data(), theSource.data(), theSampleCount);
+              }];
+
+        [self benchmark:FramesID("DSP.Peak", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  volatile Float32 thePeak = BGM_DSP::Peak(theSource.data(), theSampleCount);
+                  #pragma unused (thePeak)
+              }];
+
+        [self benchmark:FramesID("DSP.RMS", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  volatile Float32 theRMS = BGM_DSP::RMS(theSource.data(), theSampleCount);
+                  #pragma unused (theRMS)
+              }];
+
+        [self benchmark:FramesID("DSP.StereoFramePeaks", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  BGM_DSP::StereoFramePeaks(theSource.data(), thePeaks.data(), theFrames);
+              }];
+    }
+}
+
+- (void) testRingBuffer {
+    for(UInt32 theFrames : kBufferFrameSizes)
+    {
+        // The same configuration as BGM_Device's loopback ring buffer.
+        CARingBuffer theRingBuffer;
+        theRingBuffer.Allocate(1, 2 * sizeof(Float32), kLoopbackRingBufferFrameSize);
+
+        std::vector<Float32> theAudio = TestAudio(theFrames);
+        AudioBufferList theBufferList = {
+            .mNumberBuffers = 1,
+            .mBuffers[0] = {
+                .mNumberChannels = 2,
+                .mDataByteSize = static_cast<UInt32>(theAudio.size() * sizeof(Float32)),
+                .mData = theAudio.data()
+            }
+        };
+
+        CARingBuffer::SampleTime theSampleTime = 0;
+
+        [self benchmark:FramesID("CARingBuffer.Store", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  theRingBuffer.Store(&theBufferList, theFrames, theSampleTime);
+                  theSampleTime += theFrames;
+              }];
+
+        // Fetch the most recently stored buffer over and over.
+        const CARingBuffer::SampleTime theFetchTime = theSampleTime - theFrames;
+
+        [self benchmark:FramesID("CARingBuffer.Fetch", theFrames)
+            framesPerOp:theFrames
+              operation:[&] {
+                  theRingBuffer.Fetch(&theBufferList, theFrames, theFetchTime);
+              }];
+    }
+}
+
+- (void) testDeviceIOCycle {
+    // A whole IO cycle for each number of clients: each client's ProcessOutput, which applies its
+    // relative volume and pan position (ApplyClientRelativeVolume) and updates the audible state,
+    // then WriteMix and ReadInput.
+    [self benchmarkDeviceIOCycle:"Device.IOCycle" silent:NO];
+}
+
+- (void) testDeviceIOCycleSilent {
+    // The same, but with every client sending silence, which is what the device spends most of its
+    // time doing. This is the driver's share of coreaudiod's CPU use while nothing is playing.
+    [self benchmarkDeviceIOCycle:"Device.IOCycle.Silent" silent:YES];
+}
+
+- (void) testDeviceIOCycleSampleRates {
+    // A whole IO cycle, with four clients, at each of the standard sample rates. The IO buffer is
+    // 512 frames, which the HAL uses at any rate, and then 10 ms, so the number of frames grows with
+    // the rate. The per-frame cost shouldn't depend on the rate.
+    for(Float64 theSampleRate : kBGMStandardSampleRates)
+    {
+        const UInt32 kClients = 4;
+        BGM_BenchmarkTestDevice theDevice;
+        SetSampleRate(theDevice, theSampleRate);
+        AddClients(theDevice, kClients);
+
+        theDevice.StartIO(1);
+
+        for(UInt32 theFrames : { 512u, static_cast<UInt32>(theSampleRate / 100) })
+        {
+            [self benchmarkIOCycleOf:theDevice
+                             clients:kClients
+                              frames:theFrames
+                              silent:NO
+                                  id:"Device.IOCycle.SampleRate/rate=" +
+                                         std::to_string(static_cast<UInt32>(theSampleRate)) +
+                                         ",frames=" + std::to_string(theFrames)];
+        }
+
+        theDevice.StopIO(1);
+    }
+}
+
+- (void) benchmarkDeviceIOCycle:(const char*)inName silent:(BOOL)inSilent {
+    for(UInt32 theClientCount : kClientCounts)
+    {
+        BGM_BenchmarkTestDevice theDevice;
+        AddClients(theDevice, theClientCount);
+
+        theDevice.StartIO(1);
+
+        for(UInt32 theFrames : kBufferFrameSizes)
+        {
+            [self benchmarkIOCycleOf:theDevice
+                             clients:theClientCount
+                              frames:theFrames
+                              silent:inSilent
+                                  id:std::string(inName) + "/clients=" +
+                                         std::to_string(theClientCount) +
+                                         ",frames=" + std::to_string(theFrames)];
+        }
+
+        theDevice.StopIO(1);
+    }
+}
+
+// Measures IO cycles of inDevice, which has inClientCount clients (added with AddClients) and has
+// started IO.
+- (void) benchmarkIOCycleOf:(BGM_BenchmarkTestDevice&)inDevice
+                    clients:(UInt32)inClientCount
+                     frames:(UInt32)inFrames
+                     silent:(BOOL)inSilent
+                         id:(const std::string&)inID {
+    const std::vector<Float32> theSource =
+            inSilent ? std::vector<Float32>(inFrames * 2, 0.0f) : TestAudio(inFrames);
+    std::vector<Float32> theBuffer(theSource.size());
+    AudioServerPlugInIOCycleInfo theCycleInfo {};
+
+    [self benchmark:inID
+        framesPerOp:inFrames
+          operation:[&] {
+              theCycleInfo.mOutputTime.mSampleTime += inFrames;
+              theCycleInfo.mInputTime.mSampleTime += inFrames;
+
+              for(UInt32 theClientID = 1; theClientID <= inClientCount; theClientID++)
+              {
+                  std::copy(theSource.begin(), theSource.end(), theBuffer.begin());
+                  inDevice.DoIOOperation(kObjectID_Stream_Output,
+                                         theClientID,
+                                         kAudioServerPlugInIOOperationProcessOutput,
+                                         inFrames,
+                                         theCycleInfo,
+                                         theBuffer.data(),
+                                         nullptr);
+              }
+
+              inDevice.DoIOOperation(kObjectID_Stream_Output,
+                                     1,
+                                     kAudioServerPlugInIOOperationWriteMix,
+                                     inFrames,
+                                     theCycleInfo,
+                                     theBuffer.data(),
+                                     nullptr);
+              inDevice.DoIOOperation(kObjectID_Stream_Input,
+                                     1,
+                                     kAudioServerPlugInIOOperationReadInput,
+                                     inFrames,
+                                     theCycleInfo,
+                                     theBuffer.data(),
+                                     nullptr);
+          }];
+}
+
+#pragma mark Property Queries
+
+- (void) testPropertyQueries {
+    BGM_BenchmarkTestDevice theDevice;
+
+    const std::vector<std::pair<const char*, AudioObjectID>> theObjects = {
+        { "device", kObjectID_Device },
+        { "stream", kObjectID_Stream_Output },
+        { "volume", kObjectID_Volume_Output_Master }
+    };
+
+    std::vector<AudioObjectPropertySelector> theSelectors = BGM_PropertyFuzzer::GetStandardProperties();
+    const std::vector<AudioObjectPropertySelector> theCustomSelectors =
+            BGM_PropertyFuzzer::GetCustomProperties();
+    theSelectors.insert(theSelectors.end(), theCustomSelectors.begin(), theCustomSelectors.end());
+
+    for(const auto& theObject : theObjects)
+    {
+        const AudioObjectID theObjectID = theObject.second;
+
+        // The HAL asks about properties objects don't have as well as ones they do, so HasProperty
+        // is measured with all of the selectors. The other two are only measured with the object's
+        // own properties, since they throw for the rest.
+        std::vector<AudioObjectPropertyAddress> theAllAddresses;
+        std::vector<AudioObjectPropertyAddress> theObjectsAddresses;
+
+        for(AudioObjectPropertySelector theSelector : theSelectors)
+        {
+            const AudioObjectPropertyAddress theAddress = {
+                theSelector,
+                kAudioObjectPropertyScopeOutput,
+                kAudioObjectPropertyElementMaster
+            };
+
+            theAllAddresses.push_back(theAddress);
+
+            if(theDevice.HasProperty(theObjectID, 0, theAddress))
+            {
+                theObjectsAddresses.push_back(theAddress);
+            }
+        }
+
+        const std::string theSuffix = std::string("/object=") + theObject.first;
+        size_t theIndex = 0;
+        bool theAnswer = false;
+        UInt32 theSize = 0;
+
+        // Each operation is one query, cycling through the addresses.
+        [self benchmark:"Property.HasProperty" + theSuffix
+            framesPerOp:0
+              operation:[&] {
+                  theAnswer ^= theDevice.HasProperty(theObjectID, 0, theAllAddresses[theIndex]);
+                  theIndex = (theIndex + 1) % theAllAddresses.size();
+              }];
+
+        theIndex = 0;
+
+        [self benchmark:"Property.IsPropertySettable" + theSuffix
+            framesPerOp:0
+              operation:[&] {
+                  theAnswer ^= theDevice.IsPropertySettable(theObjectID, 0, theObjectsAddresses[theIndex]);
+                  theIndex = (theIndex + 1) % theObjectsAddresses.size();
+              }];
+
+        theIndex = 0;
+
+        [self benchmark:"Property.GetPropertyDataSize" + theSuffix
+            framesPerOp:0
+              operation:[&] {
+                  theSize += theDevice.GetPropertyDataSize(theObjectID,
+                                                           0,
+                                                           theObjectsAddresses[theIndex],
+                                                           0,
+                                                           nullptr);
+                  theIndex = (theIndex + 1) % theObjectsAddresses.size();
+              }];
+
+        // Use the results so the calls can't be optimised away.
+        XCTAssertGreaterThan(theSize + (theAnswer ? 1 : 0), 0u);
+    }
+}
+
+- (void) testPlugInGetPropertyData {
+    BGM_BenchmarkTestDevice theDevice;
+    theDevice.RegisterObjects();
+
+    AudioServerPlugInDriverRef theDriver = static_cast<AudioServerPlugInDriverRef>(
+            BGM_Create(kCFAllocatorDefault, kAudioServerPlugInTypeUUID));
+    XCTAssert(theDriver != nullptr);
+
+    if(theDriver == nullptr)
+    {
+        return;
+    }
+
+    const struct {
+        const char*                 mName;
+        AudioObjectID               mObjectID;
+        AudioObjectPropertySelector mSelector;
+    } theQueries[] = {
+        { "plugin", kAudioObjectPlugInObject, kAudioObjectPropertyClass },
+        { "device", kObjectID_Device, kAudioDevicePropertyNominalSampleRate },
+        { "stream", kObjectID_Stream_Output, kAudioStreamPropertyVirtualFormat },
+        { "volume", kObjectID_Volume_Output_Master, kAudioLevelControlPropertyScalarValue }
+    };
+
+    for(const auto& theQuery : theQueries)
+    {
+        const AudioObjectPropertyAddress theAddress = {
+            theQuery.mSelector,
+            kAudioObjectPropertyScopeGlobal,
+            kAudioObjectPropertyElementMaster
+        };
+
+        // Big enough for any of the properties.
+        UInt8 theData[sizeof(AudioStreamBasicDescription)];
+        UInt32 theDataSize = 0;
+        OSStatus theErrors = 0;
+
+        // The whole call the HAL makes, including looking up the object, checking it has the
+        // property and catching exceptions.
+        [self benchmark:std::string("PlugIn.GetPropertyData/object=") + theQuery.mName
+            framesPerOp:0
+              operation:[&] {
+                  theErrors |= (*theDriver)->GetPropertyData(theDriver,
+                                                             theQuery.mObjectID,
+                                                             0,
+                                                             &theAddress,
+                                                             0,
+                                                             nullptr,
+                                                             sizeof(theData),
+                                                             &theDataSize,
+                                                             theData);
+              }];
+
+        XCTAssertEqual(theErrors, 0, "%s", theQuery.mName);
+        XCTAssertGreaterThan(theDataSize, 0u, "%s", theQuery.mName);
+    }
+}
+
+#pragma mark Data Structures
+
+- (void) testClientMapLookups {
+    BGM_TaskQueue theTaskQueue;
+
+    for(UInt32 theClientCount : kClientMapSizes)
+    {
+        BGM_ClientMap theClientMap(&theTaskQueue);
+
+        for(UInt32 i = 0; i < theClientCount; i++)
+        {
+            AudioServerPlugInClientInfo theClientInfo = ClientInfo(i);
+            theClientMap.AddClient(BGM_Client(&theClientInfo));
+        }
+
+        UInt32 theNextClientID = 1;
+        BGM_Client theClient;
+
+        [self benchmark:"ClientMap.GetClientRT/clients=" + std::to_string(theClientCount)
+            framesPerOp:0
+              operation:[&] {
+                  theClientMap.GetClientRT(theNextClientID, &theClient);
+                  theNextClientID = (theNextClientID % theClientCount) + 1;
+              }];
+    }
+}
+
+- (void) testClientMapSwaps {
+    BGM_TaskQueue theTaskQueue;
+
+    for(UInt32 theClientCount : kClientMapSizes)
+    {
+        BGM_ClientMap theClientMap(&theTaskQueue);
+
+        for(UInt32 i = 0; i < theClientCount; i++)
+        {
+            AudioServerPlugInClientInfo theClientInfo = ClientInfo(i);
+            theClientMap.AddClient(BGM_Client(&theClientInfo));
+        }
+
+        // Adding and removing a client each swap the maps, which means a round trip to the task
+        // queue's real-time thread.
+        AudioServerPlugInClientInfo theExtraClientInfo = ClientInfo(theClientCount);
+        const BGM_Client theExtraClient(&theExtraClientInfo);
+
+        [self benchmark:"ClientMap.AddAndRemoveClient/clients=" + std::to_string(theClientCount)
+            framesPerOp:0
+              operation:[&] {
+                  theClientMap.AddClient(theExtraClient);
+                  theClientMap.RemoveClient(theExtraClient.mClientID);
+              }];
+    }
+}
+
+- (void) testTaskQueue {
+    BGM_TaskQueue theTaskQueue;
+    BGM_ClientMap theClientMap(&theTaskQueue);
+
+    // A task on the real-time worker thread.
+    [self benchmark:"TaskQueue.QueueSync_SwapClientShadowMaps"
+        framesPerOp:0
+          operation:[&] {
+              theTaskQueue.QueueSync_SwapClientShadowMaps(&theClientMap);
+          }];
+
+    // A task on the non-real-time worker thread.
+    BGM_Clients theClients(kObjectID_Device, &theTaskQueue);
+    AudioServerPlugInClientInfo theClientInfo = ClientInfo(0);
+    theClients.AddClient(BGM_Client(&theClientInfo));
+
+    bool theStart = true;
+
+    [self benchmark:"TaskQueue.QueueSync_StartStopClientIO"
+        framesPerOp:0
+          operation:[&] {
+              if(theStart)
+              {
+                  theTaskQueue.QueueSync_StartClientIO(&theClients, theClientInfo.mClientID);
+              }
+              else
+              {
+                  theTaskQueue.QueueSync_StopClientIO(&theClients, theClientInfo.mClientID);
+              }
+
+              theStart = !theStart;
+          }];
+}
+
+- (void) testTaskQueueLatencyWithBusyQueues {
+    // Each device has its own task queue, but they all share the same two worker threads. Measure
+    // how long a sync task on one queue takes while the other queues are being kept busy by other
+    // threads, i.e. how fairly the workers share their time between the queues.
+    for(UInt32 theNumberOfQueues : { 1, 2, 4, 8, 16 })
+    {
+        std::vector<std::unique_ptr<BGM_TaskQueue>> theTaskQueues;
+        std::vector<std::unique_ptr<BGM_ClientMap>> theClientMaps;
+
+        for(UInt32 i = 0; i < theNumberOfQueues; i++)
+        {
+            theTaskQueues.emplace_back(new BGM_TaskQueue);
+            theClientMaps.emplace_back(new BGM_ClientMap(theTaskQueues.back().get()));
+        }
+
+        std::atomic<bool> theShouldStop(false);
+        std::vector<std::thread> theLoadThreads;
+
+        for(UInt32 i = 1; i < theNumberOfQueues; i++)
+        {
+            theLoadThreads.emplace_back([&, i] {
+                while(!theShouldStop)
+                {
+                    theTaskQueues[i]->QueueSync_SwapClientShadowMaps(theClientMaps[i].get());
+                }
+            });
+        }
+
+        [self benchmark:"TaskQueue.SyncLatency/queues=" + std::to_string(theNumberOfQueues)
+            framesPerOp:0
+              operation:[&] {
+                  theTaskQueues[0]->QueueSync_SwapClientShadowMaps(theClientMaps[0].get());
+              }];
+
+        theShouldStop = true;
+
+        for(std::thread& theThread : theLoadThreads)
+        {
+            theThread.join();
+        }
+    }
+}
+
+- (void) testVolumeCurveConversions {
+    // The conversions BGM_VolumeControl and BGM_Clients do, with CAVolumeCurve and with the tables
+    // that replaced it. Each operation converts the next of a set of values spread over the range.
+    CAVolumeCurve theCurve;
+    theCurve.AddRange(0, 96, -96.0f, 0.0f);
+    const BGM_VolumeCurveTable theTable(theCurve);
+
+    std::vector<Float32> theScalars;
+    std::vector<Float32> theDBs;
+
+    for(int i = 0; i < 1024; i++)
+    {
+        theScalars.push_back(i / 1023.0f);
+        theDBs.push_back(-96.0f + (96.0f * i / 1023.0f));
+    }
+
+    [self benchmarkVolumeCurve:"CAVolumeCurve"
+                   scalarToRaw:[&](Float32 inScalar) { return theCurve.ConvertScalarToRaw(inScalar); }
+                   rawToScalar:[&](SInt32 inRaw) { return theCurve.ConvertRawToScalar(inRaw); }
+                    dbToScalar:[&](Float32 inDB) { return theCurve.ConvertDBToScalar(inDB); }
+                       scalars:theScalars
+                           dbs:theDBs];
+
+    [self benchmarkVolumeCurve:"table"
+                   scalarToRaw:[&](Float32 inScalar) { return theTable.ConvertScalarToRaw(inScalar); }
+                   rawToScalar:[&](SInt32 inRaw) { return theTable.ConvertRawToScalar(inRaw); }
+                    dbToScalar:[&](Float32 inDB) { return theTable.ConvertDBToScalar(inDB); }
+                       scalars:theScalars
+                           dbs:theDBs];
+}
+
+- (void) benchmarkVolumeCurve:(const std::string&)inImplementation
+                  scalarToRaw:(const std::function<SInt32(Float32)>&)inScalarToRaw
+                  rawToScalar:(const std::function<Float32(SInt32)>&)inRawToScalar
+                   dbToScalar:(const std::function<Float32(Float32)>&)inDBToScalar
+                      scalars:(const std::vector<Float32>&)inScalars
+                          dbs:(const std::vector<Float32>&)inDBs {
+    size_t theNext = 0;
+
+    [self benchmark:"VolumeCurve.ScalarToRaw/impl=" + inImplementation
+        framesPerOp:0
+          operation:[&] {
+              // Make sure the compiler can't optimise the call away.
+              volatile SInt32 theRaw = inScalarToRaw(inScalars[theNext]);
+              #pragma unused (theRaw)
+              theNext = (theNext + 1) % inScalars.size();
+          }];
+
+    [self benchmark:"VolumeCurve.RawToScalar/impl=" + inImplementation
+        framesPerOp:0
+          operation:[&] {
+              volatile Float32 theScalar = inRawToScalar(static_cast<SInt32>(theNext % 97));
+              #pragma unused (theScalar)
+              theNext = (theNext + 1) % inScalars.size();
+          }];
+
+    [self benchmark:"VolumeCurve.DBToScalar/impl=" + inImplementation
+        framesPerOp:0
+          operation:[&] {
+              volatile Float32 theScalar = inDBToScalar(inDBs[theNext]);
+              #pragma unused (theScalar)
+              theNext = (theNext + 1) % inDBs.size();
+          }];
+}
+
+@end
+
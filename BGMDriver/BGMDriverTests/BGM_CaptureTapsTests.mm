@@ -0,0 +1,259 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_CaptureTapsTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#include "BGM_CaptureTaps.h"
+
+// Local Includes
+#include "BGM_TestUtils.h"
+#include "BGM_Types.h"
+#include "BGMLoopbackReader.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <string>
+#include <vector>
+
+// System Includes
+#include <unistd.h>
+
+
+static const UInt32 kTestCycleFrames = 512;
+
+@interface BGM_CaptureTapsTests : XCTestCase {
+    // Use names specific to this process so the tests never touch the real driver's segments.
+    std::string segmentNamePrefix;
+    BGM_CaptureTaps* taps;
+}
+
+@end
+
+@implementation BGM_CaptureTapsTests
+
+- (void) setUp {
+    [super setUp];
+
+    segmentNamePrefix = "/BGMTest." + std::to_string(getpid()) + ".tap.";
+    taps = new BGM_CaptureTaps(segmentNamePrefix.c_str());
+}
+
+- (void) tearDown {
+    delete taps;
+    [super tearDown];
+}
+
+static std::vector<CACFString> BundleIDs(std::vector<const char*> inBundleIDs)
+{
+    std::vector<CACFString> theBundleIDs;
+
+    for(const char* theBundleID : inBundleIDs)
+    {
+        theBundleIDs.push_back(CACFString(theBundleID));
+    }
+
+    return theBundleIDs;
+}
+
+static std::vector<Float32> ConstantFrames(Float32 inValue, UInt32 inFrameCount)
+{
+    return std::vector<Float32>(inFrameCount * 2, inValue);
+}
+
+- (void) testNoTapsByDefault {
+    XCTAssertFalse(taps->HasActiveTapsRT());
+    XCTAssertTrue(taps->GetTapsByBundleID().empty());
+
+    NSArray* theTaps = (NSArray*)CFBridgingRelease(taps->CopyTapsAsCFArray());
+    XCTAssertEqualObjects(theTaps, @[]);
+}
+
+- (void) testSetTappedApps {
+    XCTAssertTrue(taps->SetTappedApps(BundleIDs({ "com.example.a", "com.example.b" }), 44100.0));
+    XCTAssertTrue(taps->HasActiveTapsRT());
+
+    std::map<CACFString, SInt32> theTapsByBundleID = taps->GetTapsByBundleID();
+    XCTAssertEqual(theTapsByBundleID.size(), 2);
+    XCTAssertEqual(theTapsByBundleID[CACFString("com.example.a")], 0);
+    XCTAssertEqual(theTapsByBundleID[CACFString("com.example.b")], 1);
+
+    NSArray* theTaps = (NSArray*)CFBridgingRelease(taps->CopyTapsAsCFArray());
+    XCTAssertEqual(theTaps.count, 2);
+    XCTAssertEqualObjects(theTaps[0][@kBGMCaptureTapsKey_BundleID], @"com.example.a");
+    XCTAssertEqualObjects(theTaps[0][@kBGMCaptureTapsKey_SegmentName],
+                          [NSString stringWithUTF8String:(segmentNamePrefix + "0").c_str()]);
+
+    // Setting the same apps again (in any order, with duplicates) shouldn't change anything.
+    XCTAssertFalse(taps->SetTappedApps(BundleIDs({ "com.example.b", "com.example.a", "com.example.b" }),
+                                       44100.0));
+
+    // Replacing an app should keep the other app's tap and give the new app the free slot.
+    XCTAssertTrue(taps->SetTappedApps(BundleIDs({ "com.example.c", "com.example.b" }), 44100.0));
+    theTapsByBundleID = taps->GetTapsByBundleID();
+    XCTAssertEqual(theTapsByBundleID.size(), 2);
+    XCTAssertEqual(theTapsByBundleID[CACFString("com.example.c")], 0);
+    XCTAssertEqual(theTapsByBundleID[CACFString("com.example.b")], 1);
+
+    XCTAssertTrue(taps->SetTappedApps({}, 44100.0));
+    XCTAssertFalse(taps->HasActiveTapsRT());
+}
+
+- (void) testTooManyApps {
+    std::vector<CACFString> theBundleIDs;
+
+    for(UInt32 i = 0; i <= BGM_CaptureTaps::kMaxTaps; i++)
+    {
+        theBundleIDs.push_back(CACFString(("com.example." + std::to_string(i)).c_str()));
+    }
+
+    BGMShouldThrow<CAException>(self, [&](){
+        taps->SetTappedApps(theBundleIDs, 44100.0);
+    });
+
+    XCTAssertFalse(taps->HasActiveTapsRT());
+}
+
+- (void) testMixAndStore {
+    taps->SetTappedApps(BundleIDs({ "com.example.a" }), 48000.0);
+
+    BGMLoopbackReader* theReader = BGMLoopbackReaderOpen((segmentNamePrefix + "0").c_str());
+    XCTAssert(theReader != nullptr);
+    XCTAssertEqual(BGMLoopbackReaderGetSampleRate(theReader), 48000.0);
+
+    // Two of the app's clients play in the first cycle. Their audio should be mixed.
+    std::vector<Float32> theClientOne = ConstantFrames(0.25f, kTestCycleFrames);
+    std::vector<Float32> theClientTwo = ConstantFrames(0.5f, kTestCycleFrames);
+    taps->MixClientIORT(0, kTestCycleFrames, 1000.0, theClientOne.data());
+    taps->MixClientIORT(0, kTestCycleFrames, 1000.0, theClientTwo.data());
+    taps->StoreRT(kTestCycleFrames, 1000.0);
+
+    // Neither plays in the second cycle, so the tap should get silence.
+    taps->StoreRT(kTestCycleFrames, 1000.0 + kTestCycleFrames);
+
+    std::vector<Float32> theBuffer(kTestCycleFrames * 4);
+    UInt32 theFrameCount = 0;
+    SInt64 theSampleTime = 0;
+    BGMLoopbackReaderRead(theReader, theBuffer.data(), kTestCycleFrames * 2, &theFrameCount, &theSampleTime);
+
+    XCTAssertEqual(theFrameCount, kTestCycleFrames * 2);
+    XCTAssertEqual(theSampleTime, 1000);
+
+    for(UInt32 i = 0; i < kTestCycleFrames * 2; i++)
+    {
+        XCTAssertEqual(theBuffer[i], 0.75f);
+        XCTAssertEqual(theBuffer[(kTestCycleFrames * 2) + i], 0.0f);
+    }
+
+    BGMLoopbackReaderClose(theReader);
+}
+
+- (void) testIgnoresInvalidTaps {
+    taps->SetTappedApps(BundleIDs({ "com.example.a" }), 48000.0);
+
+    std::vector<Float32> theFrames = ConstantFrames(1.0f, kTestCycleFrames);
+
+    // None of these should do anything.
+    taps->MixClientIORT(-1, kTestCycleFrames, 0.0, theFrames.data());
+    taps->MixClientIORT(1, kTestCycleFrames, 0.0, theFrames.data());
+    taps->MixClientIORT(BGM_CaptureTaps::kMaxTaps, kTestCycleFrames, 0.0, theFrames.data());
+
+    std::vector<Float32> theLargeBuffer((BGM_CaptureTaps::kMaxFramesPerCycle + 1) * 2);
+    taps->MixClientIORT(0, BGM_CaptureTaps::kMaxFramesPerCycle + 1, 0.0, theLargeBuffer.data());
+    taps->StoreRT(BGM_CaptureTaps::kMaxFramesPerCycle + 1, 0.0);
+}
+
+- (void) testRemovingTapClosesSegment {
+    taps->SetTappedApps(BundleIDs({ "com.example.a" }), 48000.0);
+
+    BGMLoopbackReader* theReader = BGMLoopbackReaderOpen((segmentNamePrefix + "0").c_str());
+    XCTAssert(theReader != nullptr);
+
+    taps->SetTappedApps({}, 48000.0);
+
+    std::vector<Float32> theBuffer(kTestCycleFrames * 2);
+    UInt32 theFrameCount = 0;
+    SInt64 theSampleTime = 0;
+    XCTAssertEqual(BGMLoopbackReaderRead(theReader, theBuffer.data(), kTestCycleFrames, &theFrameCount, &theSampleTime),
+                   kBGMLoopbackReader_SegmentClosed);
+
+    BGMLoopbackReaderClose(theReader);
+}
+
+#pragma mark Performance
+
+// Measures the cost the taps add to each IO cycle. Each tapped app has two clients playing, which
+// is the worst case because their audio has to be mixed.
+- (void) measureCyclesWithTaps:(UInt32)tapCount {
+    std::vector<CACFString> theBundleIDs;
+
+    for(UInt32 i = 0; i < tapCount; i++)
+    {
+        theBundleIDs.push_back(CACFString(("com.example." + std::to_string(i)).c_str()));
+    }
+
+    taps->SetTappedApps(theBundleIDs, 44100.0);
+
+    std::vector<Float32> theFrames = ConstantFrames(0.1f, kTestCycleFrames);
+    BGM_CaptureTaps* theTaps = taps;
+
+    [self measureBlock:^{
+        for(UInt32 theCycle = 0; theCycle < 10000; theCycle++)
+        {
+            Float64 theSampleTime = static_cast<Float64>(theCycle) * kTestCycleFrames;
+
+            if(theTaps->HasActiveTapsRT())
+            {
+                for(SInt32 theTap = 0; theTap < static_cast<SInt32>(tapCount); theTap++)
+                {
+                    theTaps->MixClientIORT(theTap, kTestCycleFrames, theSampleTime, theFrames.data());
+                    theTaps->MixClientIORT(theTap, kTestCycleFrames, theSampleTime, theFrames.data());
+                }
+            }
+
+            theTaps->StoreRT(kTestCycleFrames, theSampleTime);
+        }
+    }];
+}
+
+- (void) testPerformanceNoTaps {
+    [self measureCyclesWithTaps:0];
+}
+
+- (void) testPerformanceOneTap {
+    [self measureCyclesWithTaps:1];
+}
+
+- (void) testPerformanceTwoTaps {
+    [self measureCyclesWithTaps:2];
+}
+
+- (void) testPerformanceFourTaps {
+    [self measureCyclesWithTaps:4];
+}
+
+- (void) testPerformanceEightTaps {
+    [self measureCyclesWithTaps:BGM_CaptureTaps::kMaxTaps];
+}
+
+@end
+
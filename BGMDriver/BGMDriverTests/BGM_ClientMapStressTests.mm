@@ -0,0 +1,635 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_ClientMapStressTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Multithreaded stress tests for BGM_ClientMap's shadow map protocol. Several "mutator" threads
+//  add and remove clients and change their settings, which makes BGM_TaskQueue's real-time thread
+//  swap the maps, while "IO" threads look clients up with GetClientRT the way IO threads do.
+//
+//  Each mutator thread has its own PID, bundle ID and range of client IDs and keeps a model of
+//  what its clients should be, which it checks the map against after every operation. The IO
+//  threads check that every client they find is one that could exist and time each lookup.
+//
+//  In testDeterministicSchedule the mutator threads take turns in an order generated from the seed,
+//  so a failure can be reproduced by running it with the same seed. (The IO threads still run
+//  freely.) In testRandomSchedule they run freely.
+//
+//  These are mostly useful with Thread Sanitizer enabled, e.g.
+//
+//      xcodebuild -project BGMDriver.xcodeproj -scheme "Background Music Device" \
+//          -enableThreadSanitizer YES test
+//
+//  Environment variables (prefix them with TEST_RUNNER_ when using xcodebuild):
+//
+//      BGM_STRESS_SEED                 The seed. Defaults to 1 for testDeterministicSchedule and a
+//                                      random seed, which is logged, for testRandomSchedule.
+//      BGM_STRESS_MUTATOR_THREADS      8 by default.
+//      BGM_STRESS_IO_THREADS           2 by default.
+//      BGM_STRESS_OPERATIONS           The number of operations each mutator thread does. 500 by
+//                                      default.
+//      BGM_STRESS_MAX_P99_MICROSECONDS If set, the tests fail if the 99th percentile GetClientRT
+//                                      latency is higher than this.
+//
+
+// Local Includes
+#include "BGM_Client.h"
+#include "BGM_ClientMap.h"
+#include "BGM_TaskQueue.h"
+#include "BGM_TestUtils.h"
+
+// PublicUtility Includes
+#include "CACFString.h"
+
+// STL Includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+static const UInt32 kClientIDsPerThread = 8;
+static const pid_t kFirstPID = 10000;
+
+// The settings the mutator threads use, so the IO threads can check the clients they find.
+static const Float32 kRelativeVolumes[] = { 0.0f, 0.5f, 1.0f, 2.0f, 4.0f };
+static const SInt32 kPanPositions[] = { -100, -50, 0, 50, 100 };
+
+static UInt32 GetEnvUInt32(const char* inName, UInt32 inDefault)
+{
+    const char* theValue = getenv(inName);
+    return (theValue != nullptr) ? static_cast<UInt32>(strtoul(theValue, nullptr, 10)) : inDefault;
+}
+
+static Float64 GetEnvFloat64(const char* inName, Float64 inDefault)
+{
+    const char* theValue = getenv(inName);
+    return (theValue != nullptr) ? atof(theValue) : inDefault;
+}
+
+#pragma mark Test State
+
+// The state shared by all of the threads in a test run.
+struct BGM_StressRun
+{
+    BGM_StressRun() : mClientMap(&mTaskQueue) { }
+
+    void AddFailure(const std::string& inFailure)
+    {
+        std::lock_guard<std::mutex> theLock(mFailuresMutex);
+
+        // Only keep the first few. Once something goes wrong, most of the operations after it will
+        // probably fail too.
+        if(mFailures.size() < 20)
+        {
+            mFailures.push_back(inFailure);
+        }
+    }
+
+    BGM_TaskQueue                       mTaskQueue;
+    BGM_ClientMap                       mClientMap;
+
+    // For the deterministic schedule. The index of the mutator thread whose turn it is for each
+    // operation, and the number of operations done so far.
+    std::vector<UInt32>                 mSchedule;
+    std::atomic<size_t>                 mScheduleIndex { 0 };
+
+    std::atomic<bool>                   mMutatorsDone { false };
+
+    std::mutex                          mFailuresMutex;
+    std::vector<std::string>            mFailures;
+};
+
+#pragma mark Mutator Threads
+
+// Adds, removes and changes its own clients and checks them against its model after each change.
+class BGM_StressMutator
+{
+
+public:
+    BGM_StressMutator(BGM_StressRun& inRun, UInt32 inIndex, UInt32 inSeed)
+    :
+        mRun(inRun),
+        mIndex(inIndex),
+        mPID(kFirstPID + static_cast<pid_t>(inIndex)),
+        mBundleID(CFStringCreateWithFormat(nullptr, nullptr, CFSTR("com.example.stress.%u"), inIndex),
+                  true),
+        mRandom(inSeed)
+    {
+    }
+
+    void    Step()
+    {
+        switch(mRandom() % 7)
+        {
+            case 0: Add(); break;
+            case 1: Remove(); break;
+            case 2: SetVolumeOrPan(/* inByBundleID = */ false); break;
+            case 3: SetVolumeOrPan(/* inByBundleID = */ true); break;
+            case 4: ToggleIO(); break;
+            case 5:
+                // These change every thread's clients, but not the fields the threads check.
+                mRun.mClientMap.UpdateMusicPlayerFlags(mPID);
+                mRun.mClientMap.UpdateCaptureTaps([&](const BGM_Client& inClient) {
+                    return (inClient.mProcessID == mPID) ? 0 : -1;
+                });
+                break;
+            default:
+                // Add more often than the other operations so the map isn't usually empty.
+                Add();
+                break;
+        }
+
+        Check();
+    }
+
+private:
+    struct ModelClient
+    {
+        bool        mHasBundleID;
+        Float32     mRelativeVolume;
+        SInt32      mPanPosition;
+        bool        mDoingIO;
+    };
+
+    UInt32  FirstClientID() const { return mIndex * kClientIDsPerThread + 1; }
+
+    void    Add()
+    {
+        std::vector<UInt32> theFreeIDs;
+
+        for(UInt32 theID = FirstClientID(); theID < FirstClientID() + kClientIDsPerThread; theID++)
+        {
+            if(mModel.count(theID) == 0)
+            {
+                theFreeIDs.push_back(theID);
+            }
+        }
+
+        if(theFreeIDs.empty())
+        {
+            return;
+        }
+
+        const UInt32 theClientID = theFreeIDs[mRandom() % theFreeIDs.size()];
+        const bool theHasBundleID = (mRandom() % 4 != 0);
+
+        const AudioServerPlugInClientInfo theInfo = {
+            theClientID,
+            mPID,
+            true,
+            theHasBundleID ? mBundleID.GetCFString() : nullptr
+        };
+
+        mRun.mClientMap.AddClient(BGM_Client(&theInfo));
+
+        // BGM_ClientMap gives clients the settings of the last client added with the same bundle ID.
+        ModelClient theClient = { theHasBundleID, 1.0f, 0, false };
+
+        if(theHasBundleID)
+        {
+            if(mHasPastClient)
+            {
+                theClient.mRelativeVolume = mPastClient.mRelativeVolume;
+                theClient.mPanPosition = mPastClient.mPanPosition;
+            }
+
+            mPastClient = theClient;
+            mHasPastClient = true;
+        }
+
+        mModel[theClientID] = theClient;
+    }
+
+    void    Remove()
+    {
+        if(mModel.empty())
+        {
+            return;
+        }
+
+        auto theItr = std::next(mModel.begin(), static_cast<long>(mRandom() % mModel.size()));
+        const BGM_Client theRemovedClient = mRun.mClientMap.RemoveClient(theItr->first);
+
+        if(theRemovedClient.mClientID != theItr->first)
+        {
+            Fail("RemoveClient returned client " + std::to_string(theRemovedClient.mClientID) +
+                 " instead of " + std::to_string(theItr->first));
+        }
+
+        mModel.erase(theItr);
+    }
+
+    void    SetVolumeOrPan(bool inByBundleID)
+    {
+        const bool theSetVolume = (mRandom() % 2 == 0);
+        const Float32 theVolume = kRelativeVolumes[mRandom() % (sizeof(kRelativeVolumes) / sizeof(Float32))];
+        const SInt32 thePan = kPanPositions[mRandom() % (sizeof(kPanPositions) / sizeof(SInt32))];
+
+        bool theDidChange;
+
+        if(inByBundleID)
+        {
+            theDidChange = theSetVolume ? mRun.mClientMap.SetClientsRelativeVolume(mBundleID, theVolume) :
+                                          mRun.mClientMap.SetClientsPanPosition(mBundleID, thePan);
+        }
+        else
+        {
+            theDidChange = theSetVolume ? mRun.mClientMap.SetClientsRelativeVolume(mPID, theVolume) :
+                                          mRun.mClientMap.SetClientsPanPosition(mPID, thePan);
+        }
+
+        bool theShouldChange = false;
+
+        for(auto& theEntry : mModel)
+        {
+            ModelClient& theClient = theEntry.second;
+
+            if(!inByBundleID || theClient.mHasBundleID)
+            {
+                theShouldChange = true;
+
+                if(theSetVolume)
+                {
+                    theClient.mRelativeVolume = theVolume;
+                }
+                else
+                {
+                    theClient.mPanPosition = thePan;
+                }
+            }
+        }
+
+        if(theDidChange != theShouldChange)
+        {
+            Fail(std::string("SetClients") + (theSetVolume ? "RelativeVolume" : "PanPosition") +
+                 (inByBundleID ? " by bundle ID" : " by PID") + " returned " +
+                 (theDidChange ? "true" : "false"));
+        }
+    }
+
+    void    ToggleIO()
+    {
+        if(mModel.empty())
+        {
+            return;
+        }
+
+        auto theItr = std::next(mModel.begin(), static_cast<long>(mRandom() % mModel.size()));
+        ModelClient& theClient = theItr->second;
+
+        if(theClient.mDoingIO)
+        {
+            mRun.mClientMap.StopIONonRT(theItr->first);
+        }
+        else
+        {
+            mRun.mClientMap.StartIONonRT(theItr->first);
+        }
+
+        theClient.mDoingIO = !theClient.mDoingIO;
+    }
+
+    void    Check()
+    {
+        for(UInt32 theID = FirstClientID(); theID < FirstClientID() + kClientIDsPerThread; theID++)
+        {
+            auto theModelItr = mModel.find(theID);
+
+            // The main maps and the shadow maps should both match the model. It's safe to call
+            // GetClientRT here because this thread doesn't hold the shadow maps mutex.
+            BGM_Client theClientRT, theClientNonRT;
+            const bool theFoundRT = mRun.mClientMap.GetClientRT(theID, &theClientRT);
+            const bool theFoundNonRT = mRun.mClientMap.GetClientNonRT(theID, &theClientNonRT);
+
+            if(theFoundRT != (theModelItr != mModel.end()) || theFoundNonRT != theFoundRT)
+            {
+                Fail("Client " + std::to_string(theID) + " found by GetClientRT: " +
+                     std::to_string(theFoundRT) + ", by GetClientNonRT: " + std::to_string(theFoundNonRT) +
+                     ", expected: " + std::to_string(theModelItr != mModel.end()));
+                continue;
+            }
+
+            if(theFoundRT)
+            {
+                CheckClient(theClientRT, theModelItr->second, "GetClientRT");
+                CheckClient(theClientNonRT, theModelItr->second, "GetClientNonRT");
+            }
+        }
+
+        // Removing a client shouldn't affect the other clients with the same PID.
+        const size_t theClientsByPID = mRun.mClientMap.GetClientsByPID(mPID).size();
+
+        if(theClientsByPID != mModel.size())
+        {
+            Fail("GetClientsByPID returned " + std::to_string(theClientsByPID) + " clients, expected " +
+                 std::to_string(mModel.size()));
+        }
+    }
+
+    void    CheckClient(const BGM_Client& inClient, const ModelClient& inModel, const char* inSource)
+    {
+        if(inClient.mProcessID != mPID ||
+           inClient.mBundleID.IsValid() != inModel.mHasBundleID ||
+           inClient.mRelativeVolume != inModel.mRelativeVolume ||
+           inClient.mPanPosition != inModel.mPanPosition ||
+           inClient.mDoingIO != inModel.mDoingIO)
+        {
+            Fail(std::string(inSource) + " returned client " + std::to_string(inClient.mClientID) +
+                 " with volume " + std::to_string(inClient.mRelativeVolume) +
+                 ", pan " + std::to_string(inClient.mPanPosition) +
+                 ", doing IO " + std::to_string(inClient.mDoingIO) +
+                 ". Expected volume " + std::to_string(inModel.mRelativeVolume) +
+                 ", pan " + std::to_string(inModel.mPanPosition) +
+                 ", doing IO " + std::to_string(inModel.mDoingIO));
+        }
+    }
+
+    void    Fail(const std::string& inFailure)
+    {
+        mRun.AddFailure("Mutator " + std::to_string(mIndex) + ": " + inFailure);
+    }
+
+    BGM_StressRun&                      mRun;
+    const UInt32                        mIndex;
+    const pid_t                         mPID;
+    const CACFString                    mBundleID;
+    std::mt19937                        mRandom;
+
+    std::map<UInt32, ModelClient>       mModel;
+    ModelClient                         mPastClient {};
+    bool                                mHasPastClient = false;
+
+};
+
+#pragma mark IO Threads
+
+// Looks clients up like an IO thread would and records how long each lookup took.
+static void BGM_StressIOThread(BGM_StressRun& inRun,
+                               UInt32 inMutatorCount,
+                               UInt32 inSeed,
+                               std::vector<UInt64>& outLatenciesNanos)
+{
+    std::mt19937 theRandom(inSeed);
+    const UInt32 theClientIDCount = inMutatorCount * kClientIDsPerThread;
+    BGM_Client theClient;
+
+    while(!inRun.mMutatorsDone.load(std::memory_order_acquire))
+    {
+        const UInt32 theClientID = theRandom() % theClientIDCount + 1;
+
+        const auto theStartTime = std::chrono::steady_clock::now();
+        const bool theFound = inRun.mClientMap.GetClientRT(theClientID, &theClient);
+        const auto theEndTime = std::chrono::steady_clock::now();
+
+        // Don't let the samples use an unbounded amount of memory if the test is run for a long time.
+        if(outLatenciesNanos.size() < 10000000)
+        {
+            outLatenciesNanos.push_back(static_cast<UInt64>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(theEndTime - theStartTime).count()));
+        }
+
+        if(theFound)
+        {
+            const pid_t theExpectedPID = kFirstPID + static_cast<pid_t>((theClientID - 1) / kClientIDsPerThread);
+            const Float32* theVolumesEnd = kRelativeVolumes + sizeof(kRelativeVolumes) / sizeof(Float32);
+            const SInt32* thePansEnd = kPanPositions + sizeof(kPanPositions) / sizeof(SInt32);
+
+            if(theClient.mClientID != theClientID ||
+               theClient.mProcessID != theExpectedPID ||
+               std::find(kRelativeVolumes, theVolumesEnd, theClient.mRelativeVolume) == theVolumesEnd ||
+               std::find(kPanPositions, thePansEnd, theClient.mPanPosition) == thePansEnd)
+            {
+                inRun.AddFailure("IO thread: GetClientRT(" + std::to_string(theClientID) +
+                                 ") returned client " + std::to_string(theClient.mClientID) +
+                                 " with PID " + std::to_string(theClient.mProcessID) +
+                                 ", volume " + std::to_string(theClient.mRelativeVolume) +
+                                 ", pan " + std::to_string(theClient.mPanPosition));
+            }
+        }
+    }
+}
+
+#pragma mark Tests
+
+@interface BGM_ClientMapStressTests : XCTestCase
+
+@end
+
+@implementation BGM_ClientMapStressTests
+
+- (void) runWithSeed:(UInt32)seed deterministic:(bool)deterministic {
+    const UInt32 theMutatorCount = std::max(GetEnvUInt32("BGM_STRESS_MUTATOR_THREADS", 8), 1u);
+    const UInt32 theIOThreadCount = GetEnvUInt32("BGM_STRESS_IO_THREADS", 2);
+    const UInt32 theOperations = GetEnvUInt32("BGM_STRESS_OPERATIONS", 500);
+
+    NSLog(@"BGM_ClientMapStressTests: seed %u, %u mutator threads, %u IO threads, %u operations each",
+          seed,
+          theMutatorCount,
+          theIOThreadCount,
+          theOperations);
+
+    BGM_StressRun theRun;
+    std::mt19937 theSeeds(seed);
+
+    std::vector<std::unique_ptr<BGM_StressMutator>> theMutators;
+
+    for(UInt32 i = 0; i < theMutatorCount; i++)
+    {
+        theMutators.emplace_back(new BGM_StressMutator(theRun, i, theSeeds()));
+    }
+
+    if(deterministic)
+    {
+        for(UInt32 i = 0; i < theMutatorCount; i++)
+        {
+            theRun.mSchedule.insert(theRun.mSchedule.end(), theOperations, i);
+        }
+
+        std::shuffle(theRun.mSchedule.begin(), theRun.mSchedule.end(), std::mt19937(theSeeds()));
+    }
+
+    // Start the IO threads.
+    std::vector<std::vector<UInt64>> theLatencies(theIOThreadCount);
+    std::vector<std::thread> theIOThreads;
+
+    for(UInt32 i = 0; i < theIOThreadCount; i++)
+    {
+        const UInt32 theIOSeed = theSeeds();
+        theIOThreads.emplace_back([&, i, theIOSeed] {
+            BGM_StressIOThread(theRun, theMutatorCount, theIOSeed, theLatencies[i]);
+        });
+    }
+
+    // Start the mutator threads.
+    std::vector<std::thread> theMutatorThreads;
+
+    for(UInt32 i = 0; i < theMutatorCount; i++)
+    {
+        theMutatorThreads.emplace_back([&, i] {
+            BGM_StressMutator& theMutator = *theMutators[i];
+
+            try
+            {
+                if(deterministic)
+                {
+                    // Wait for this thread's turn for each of its operations. The acquire/release
+                    // pair means each operation happens after the ones before it in the schedule.
+                    for(size_t theOpIndex = 0; theOpIndex < theRun.mSchedule.size(); theOpIndex++)
+                    {
+                        if(theRun.mSchedule[theOpIndex] != i)
+                        {
+                            continue;
+                        }
+
+                        while(theRun.mScheduleIndex.load(std::memory_order_acquire) < theOpIndex)
+                        {
+                            std::this_thread::yield();
+                        }
+
+                        // Another thread failed and skipped the rest of the schedule.
+                        if(theRun.mScheduleIndex.load(std::memory_order_acquire) > theOpIndex)
+                        {
+                            break;
+                        }
+
+                        theMutator.Step();
+                        theRun.mScheduleIndex.store(theOpIndex + 1, std::memory_order_release);
+                    }
+                }
+                else
+                {
+                    for(UInt32 theOp = 0; theOp < theOperations; theOp++)
+                    {
+                        theMutator.Step();
+                    }
+                }
+            }
+            catch(...)
+            {
+                theRun.AddFailure("Mutator " + std::to_string(i) + ": Unexpected exception");
+
+                // Let the other threads finish.
+                if(deterministic)
+                {
+                    theRun.mScheduleIndex.store(theRun.mSchedule.size(), std::memory_order_release);
+                }
+            }
+        });
+    }
+
+    for(std::thread& theThread : theMutatorThreads)
+    {
+        theThread.join();
+    }
+
+    theRun.mMutatorsDone.store(true, std::memory_order_release);
+
+    for(std::thread& theThread : theIOThreads)
+    {
+        theThread.join();
+    }
+
+    for(const std::string& theFailure : theRun.mFailures)
+    {
+        XCTFail("%s", theFailure.c_str());
+    }
+
+    // Report the lookup latencies.
+    std::vector<UInt64> theAllLatencies;
+
+    for(const std::vector<UInt64>& theThreadLatencies : theLatencies)
+    {
+        theAllLatencies.insert(theAllLatencies.end(), theThreadLatencies.begin(), theThreadLatencies.end());
+    }
+
+    if(theAllLatencies.empty())
+    {
+        return;
+    }
+
+    std::sort(theAllLatencies.begin(), theAllLatencies.end());
+
+    auto thePercentileMicros = [&](Float64 inPercentile) {
+        const size_t theIndex = static_cast<size_t>(inPercentile / 100.0 * (theAllLatencies.size() - 1));
+        return theAllLatencies[theIndex] / 1000.0;
+    };
+
+    NSLog(@"BGM_ClientMapStressTests: %zu GetClientRT calls. Latency (us): p50 %.2f, p90 %.2f, "
+          "p99 %.2f, p99.9 %.2f, max %.2f",
+          theAllLatencies.size(),
+          thePercentileMicros(50),
+          thePercentileMicros(90),
+          thePercentileMicros(99),
+          thePercentileMicros(99.9),
+          thePercentileMicros(100));
+
+    const Float64 theMaxP99Micros = GetEnvFloat64("BGM_STRESS_MAX_P99_MICROSECONDS", 0.0);
+
+    if(theMaxP99Micros > 0.0)
+    {
+        XCTAssertLessThanOrEqual(thePercentileMicros(99), theMaxP99Micros);
+    }
+}
+
+- (void) testDeterministicSchedule {
+    [self runWithSeed:GetEnvUInt32("BGM_STRESS_SEED", 1) deterministic:true];
+}
+
+- (void) testRandomSchedule {
+    [self runWithSeed:GetEnvUInt32("BGM_STRESS_SEED", std::random_device()()) deterministic:false];
+}
+
+- (void) testRemovingClientKeepsOthersWithSamePIDAndBundleID {
+    BGM_TaskQueue theTaskQueue;
+    BGM_ClientMap theClientMap(&theTaskQueue);
+
+    const AudioServerPlugInClientInfo theInfo1 = { 1, kFirstPID, true, CFSTR("com.example.stress.shared") };
+    const AudioServerPlugInClientInfo theInfo2 = { 2, kFirstPID, true, CFSTR("com.example.stress.shared") };
+
+    theClientMap.AddClient(BGM_Client(&theInfo1));
+    theClientMap.AddClient(BGM_Client(&theInfo2));
+    theClientMap.RemoveClient(1);
+
+    XCTAssertEqual(theClientMap.GetClientsByPID(kFirstPID).size(), 1UL);
+
+    // The remaining client should still be found by its PID and bundle ID.
+    XCTAssert(theClientMap.SetClientsRelativeVolume(kFirstPID, 0.5f));
+    XCTAssert(theClientMap.SetClientsPanPosition(CACFString(CFSTR("com.example.stress.shared"), false), 50));
+
+    BGM_Client theClient;
+    XCTAssert(theClientMap.GetClientRT(2, &theClient));
+    XCTAssertEqual(theClient.mRelativeVolume, 0.5f);
+    XCTAssertEqual(theClient.mPanPosition, 50);
+
+    theClientMap.RemoveClient(2);
+
+    XCTAssertEqual(theClientMap.GetClientsByPID(kFirstPID).size(), 0UL);
+    XCTAssertFalse(theClientMap.SetClientsRelativeVolume(kFirstPID, 1.0f));
+}
+
+@end
+
@@ -116,6 +116,32 @@ static const AudioServerPlugInClientInfo client2Info = {
     XCTAssertEqual(clients->GetMusicPlayerProcessIDProperty(), client1Info.mProcessID);
 }
 
+- (void)testCaptureTaps {
+    // No clients are tapped by default
+    clients->AddClient(&client1Info);
+    XCTAssertEqual(clients->GetClientCaptureTapRT(client1Info.mClientID), -1);
+    
+    // Tap client 1's app and the app client 2 will belong to
+    std::map<CACFString, SInt32> taps;
+    taps[CACFString(client1Info.mBundleID, false)] = 3;
+    taps[CACFString(client2Info.mBundleID, false)] = 5;
+    clients->SetCaptureTaps(taps);
+    XCTAssertEqual(clients->GetClientCaptureTapRT(client1Info.mClientID), 3);
+    
+    // Clients added later should get their apps' taps
+    clients->AddClient(&client2Info);
+    XCTAssertEqual(clients->GetClientCaptureTapRT(client2Info.mClientID), 5);
+    
+    // Untap client 1's app
+    taps.erase(CACFString(client1Info.mBundleID, false));
+    clients->SetCaptureTaps(taps);
+    XCTAssertEqual(clients->GetClientCaptureTapRT(client1Info.mClientID), -1);
+    XCTAssertEqual(clients->GetClientCaptureTapRT(client2Info.mClientID), 5);
+    
+    // Unknown clients don't have taps
+    XCTAssertEqual(clients->GetClientCaptureTapRT(12345), -1);
+}
+
 - (void)testSetMusicPlayerInvalidPID {
     BGMShouldThrow<BGM_InvalidClientPIDException>(self, [=](){
         clients->SetMusicPlayer(-1);
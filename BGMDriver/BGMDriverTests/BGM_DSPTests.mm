@@ -0,0 +1,403 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_DSPTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Checks that each of the BGM_DSP functions gives bit-identical results to a simple scalar
+//  version, for whichever backend the tests were built with. (See BGM_DSP_BACKEND.) The buffers are
+//  offset from each other by a few samples and have lengths that aren't multiples of the vector
+//  width, so the unaligned loads and the loops that handle the leftover samples are covered too.
+//
+
+// Unit Include
+#include "BGM_DSP.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+
+// The reference implementations mustn't have their multiplies and adds fused either.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#endif
+
+// The lengths to test, in samples or frames. Every length up to a few vectors, then some longer
+// ones, including the buffer sizes the HAL usually uses.
+static std::vector<UInt32> TestLengths()
+{
+    std::vector<UInt32> theLengths;
+
+    for(UInt32 i = 0; i <= 33; i++)
+    {
+        theLengths.push_back(i);
+    }
+
+    theLengths.insert(theLengths.end(), { 63, 64, 65, 511, 512, 4095, 4096 });
+    return theLengths;
+}
+
+// Unaligned offsets into the test buffers.
+static const UInt32 kOffsets[] = { 0, 1, 2, 3 };
+
+// Random samples, mostly in [-2, 2] so the clipping does something, with some zeros of both signs,
+// subnormals and values that are exactly at the clipping bounds.
+static std::vector<Float32> TestSamples(UInt32 inCount, UInt32 inSeed)
+{
+    std::mt19937 theGenerator(inSeed);
+    std::uniform_real_distribution<Float32> theDistribution(-2.0f, 2.0f);
+    std::vector<Float32> theSamples(inCount);
+
+    for(UInt32 i = 0; i < inCount; i++)
+    {
+        switch(theGenerator() % 16)
+        {
+            case 0: theSamples[i] = 0.0f; break;
+            case 1: theSamples[i] = -0.0f; break;
+            case 2: theSamples[i] = 1.0e-40f; break;
+            case 3: theSamples[i] = -1.0f; break;
+            case 4: theSamples[i] = 1.0f; break;
+            default: theSamples[i] = theDistribution(theGenerator); break;
+        }
+    }
+
+    return theSamples;
+}
+
+static bool IsIdentical(const Float32* inA, const Float32* inB, UInt32 inCount)
+{
+    // memcmp's arguments mustn't be null, even if the count is 0, and empty vectors' can be.
+    return (inCount == 0) || (memcmp(inA, inB, inCount * sizeof(Float32)) == 0);
+}
+
+static bool IsIdentical(Float32 inA, Float32 inB)
+{
+    return IsIdentical(&inA, &inB, 1);
+}
+
+#pragma mark Reference Implementations
+
+static Float32 ClipReference(Float32 inValue, Float32 inMin, Float32 inMax)
+{
+    Float32 theValue = inValue;
+
+    if(theValue < inMin)
+    {
+        theValue = inMin;
+    }
+
+    if(theValue > inMax)
+    {
+        theValue = inMax;
+    }
+
+    return theValue;
+}
+
+static void MixStereoReference(Float32* ioBuffer,
+                               UInt32 inFrameCount,
+                               const BGM_DSP::StereoMatrix& inMatrix,
+                               bool inClip)
+{
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        const Float32 L = ioBuffer[i * 2];
+        const Float32 R = ioBuffer[(i * 2) + 1];
+        const Float32 theLL = L * inMatrix.mLeftToLeft;
+        const Float32 theRL = R * inMatrix.mRightToLeft;
+        const Float32 theLR = L * inMatrix.mLeftToRight;
+        const Float32 theRR = R * inMatrix.mRightToRight;
+
+        ioBuffer[i * 2] = theLL + theRL;
+        ioBuffer[(i * 2) + 1] = theLR + theRR;
+
+        if(inClip)
+        {
+            ioBuffer[i * 2] = ClipReference(ioBuffer[i * 2], -1.0f, 1.0f);
+            ioBuffer[(i * 2) + 1] = ClipReference(ioBuffer[(i * 2) + 1], -1.0f, 1.0f);
+        }
+    }
+}
+
+static Float32 RMSReference(const Float32* inBuffer, UInt32 inSampleCount)
+{
+    if(inSampleCount == 0)
+    {
+        return 0.0f;
+    }
+
+    // See the description of the summation order in BGM_DSP.h.
+    const UInt32 theVectorSamples = inSampleCount - (inSampleCount % 4);
+    Float32 theSums[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for(UInt32 i = 0; i < theVectorSamples; i++)
+    {
+        const Float32 theSquare = inBuffer[i] * inBuffer[i];
+        theSums[i % 4] += theSquare;
+    }
+
+    const Float32 theFirstPair = theSums[0] + theSums[1];
+    const Float32 theSecondPair = theSums[2] + theSums[3];
+    Float32 theSum = theFirstPair + theSecondPair;
+
+    for(UInt32 i = theVectorSamples; i < inSampleCount; i++)
+    {
+        const Float32 theSquare = inBuffer[i] * inBuffer[i];
+        theSum += theSquare;
+    }
+
+    const Float32 theMeanSquare = theSum / static_cast<Float32>(inSampleCount);
+    return std::sqrt(theMeanSquare);
+}
+
+@interface BGM_DSPTests : XCTestCase
+
+@end
+
+@implementation BGM_DSPTests
+
+- (void) setUp {
+    [super setUp];
+    NSLog(@"BGM_DSPTests: Testing the %s backend", BGM_DSP::GetBackendName());
+}
+
+// Calls inTest with each length and offset and a buffer of that length at that offset from an
+// allocation. The buffer is filled with TestSamples.
+- (void) forEachBuffer:(UInt32)inSamplesPerItem
+                  test:(void (^)(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected))inTest {
+    UInt32 theSeed = 1;
+
+    for(UInt32 theLength : TestLengths())
+    {
+        for(UInt32 theOffset : kOffsets)
+        {
+            const UInt32 theSampleCount = theLength * inSamplesPerItem;
+            std::vector<Float32> theAllocation = TestSamples(theSampleCount + theOffset, theSeed++);
+            Float32* theBuffer = theAllocation.data() + theOffset;
+            std::vector<Float32> theExpected(theBuffer, theBuffer + theSampleCount);
+
+            inTest(theLength, theBuffer, theExpected);
+
+            XCTAssert(IsIdentical(theBuffer, theExpected.data(), theSampleCount),
+                      @"length=%u offset=%u",
+                      theLength,
+                      theOffset);
+        }
+    }
+}
+
+- (void) testScale {
+    for(Float32 theGain : { 0.0f, 0.5f, 1.0f, 1.37f, 4.0f, -1.0f })
+    {
+        [self forEachBuffer:1 test:^(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected) {
+            for(Float32& theSample : ioExpected)
+            {
+                theSample = theSample * theGain;
+            }
+
+            BGM_DSP::Scale(ioBuffer, inLength, theGain);
+        }];
+    }
+}
+
+- (void) testScaleAndClip {
+    for(Float32 theGain : { 0.0f, 0.5f, 1.0f, 1.37f, 4.0f, -1.0f })
+    {
+        [self forEachBuffer:1 test:^(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected) {
+            for(Float32& theSample : ioExpected)
+            {
+                const Float32 theScaled = theSample * theGain;
+                theSample = ClipReference(theScaled, -1.0f, 1.0f);
+            }
+
+            BGM_DSP::ScaleAndClip(ioBuffer, inLength, theGain, -1.0f, 1.0f);
+        }];
+    }
+}
+
+- (void) testClip {
+    // Including bounds that are equal and bounds that are zeros, which have signs.
+    const std::pair<Float32, Float32> kBounds[] = {
+        { -1.0f, 1.0f }, { -0.5f, 0.25f }, { 0.5f, 0.5f }, { -0.0f, 0.0f }, { 0.0f, 0.0f }
+    };
+
+    for(const auto& theBounds : kBounds)
+    {
+        [self forEachBuffer:1 test:^(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected) {
+            for(Float32& theSample : ioExpected)
+            {
+                theSample = ClipReference(theSample, theBounds.first, theBounds.second);
+            }
+
+            BGM_DSP::Clip(ioBuffer, inLength, theBounds.first, theBounds.second);
+        }];
+    }
+}
+
+- (void) testScaleWithRamp {
+    const std::pair<Float32, Float32> kRamps[] = {
+        { 1.0f, -1.0f / 512.0f }, { 0.0f, 1.0f / 3.0f }, { 0.3f, 0.0007f }, { 0.5f, 0.0f }
+    };
+
+    for(const auto& theRamp : kRamps)
+    {
+        [self forEachBuffer:2 test:^(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected) {
+            for(UInt32 i = 0; i < inLength; i++)
+            {
+                const Float32 theGainChange = theRamp.second * static_cast<Float32>(i);
+                const Float32 theGain = theRamp.first + theGainChange;
+                ioExpected[i * 2] = ioExpected[i * 2] * theGain;
+                ioExpected[(i * 2) + 1] = ioExpected[(i * 2) + 1] * theGain;
+            }
+
+            BGM_DSP::ScaleWithRamp(ioBuffer, inLength, theRamp.first, theRamp.second);
+        }];
+    }
+}
+
+- (void) testScaleStereoFrames {
+    [self forEachBuffer:2 test:^(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected) {
+        const std::vector<Float32> theGains = TestSamples(inLength, inLength + 1000);
+        const std::vector<Float32> theInput = ioExpected;
+
+        for(UInt32 i = 0; i < inLength; i++)
+        {
+            ioExpected[i * 2] = theInput[i * 2] * theGains[i];
+            ioExpected[(i * 2) + 1] = theInput[(i * 2) + 1] * theGains[i];
+        }
+
+        // Out of place, like BGM_Limiter uses it.
+        BGM_DSP::ScaleStereoFrames(theInput.data(), theGains.data(), ioBuffer, inLength);
+    }];
+
+    // And in place.
+    [self forEachBuffer:2 test:^(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected) {
+        const std::vector<Float32> theGains = TestSamples(inLength, inLength + 2000);
+
+        for(UInt32 i = 0; i < inLength; i++)
+        {
+            ioExpected[i * 2] = ioExpected[i * 2] * theGains[i];
+            ioExpected[(i * 2) + 1] = ioExpected[(i * 2) + 1] * theGains[i];
+        }
+
+        BGM_DSP::ScaleStereoFrames(ioBuffer, theGains.data(), ioBuffer, inLength);
+    }];
+}
+
+- (void) testMixStereo {
+    // The matrices ApplyClientRelativeVolume uses for a few volumes and pan positions.
+    const BGM_DSP::StereoMatrix kMatrices[] = {
+        { 1.0f, 0.0f, 0.0f, 1.0f },
+        { 0.5f, 0.0f, 0.0f, 0.5f },
+        { 0.35f * 1.7f, 0.0f, 0.65f * 1.7f, 1.7f },
+        { 1.3f, 0.2f * 1.3f, 0.0f, 0.8f * 1.3f },
+        { 0.0f, 0.0f, 4.0f, 4.0f }
+    };
+
+    for(const BGM_DSP::StereoMatrix& theMatrix : kMatrices)
+    {
+        for(bool theClip : { false, true })
+        {
+            [self forEachBuffer:2 test:^(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected) {
+                MixStereoReference(ioExpected.data(), inLength, theMatrix, theClip);
+
+                if(theClip)
+                {
+                    BGM_DSP::MixStereoAndClip(ioBuffer, inLength, theMatrix, -1.0f, 1.0f);
+                }
+                else
+                {
+                    BGM_DSP::MixStereo(ioBuffer, inLength, theMatrix);
+                }
+            }];
+        }
+    }
+}
+
+- (void) testAccumulate {
+    [self forEachBuffer:1 test:^(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected) {
+        const std::vector<Float32> theOther = TestSamples(inLength, inLength + 3000);
+
+        for(UInt32 i = 0; i < inLength; i++)
+        {
+            ioExpected[i] = ioExpected[i] + theOther[i];
+        }
+
+        BGM_DSP::Accumulate(ioBuffer, theOther.data(), inLength);
+    }];
+}
+
+- (void) testPeak {
+    [self forEachBuffer:1 test:^(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected) {
+        #pragma unused (ioExpected)
+        Float32 theExpectedPeak = 0.0f;
+
+        for(UInt32 i = 0; i < inLength; i++)
+        {
+            theExpectedPeak = std::max(theExpectedPeak, std::fabs(ioBuffer[i]));
+        }
+
+        XCTAssert(IsIdentical(BGM_DSP::Peak(ioBuffer, inLength), theExpectedPeak), @"length=%u", inLength);
+    }];
+
+    // A silent buffer, which is how BGM_AudibleState::BufferIsSilent uses it, and one where the
+    // peak is in the leftover samples.
+    std::vector<Float32> theBuffer(7, -0.0f);
+    XCTAssert(IsIdentical(BGM_DSP::Peak(theBuffer.data(), 7), 0.0f));
+
+    theBuffer[6] = -0.75f;
+    XCTAssert(IsIdentical(BGM_DSP::Peak(theBuffer.data(), 7), 0.75f));
+}
+
+- (void) testRMS {
+    [self forEachBuffer:1 test:^(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected) {
+        #pragma unused (ioExpected)
+        XCTAssert(IsIdentical(BGM_DSP::RMS(ioBuffer, inLength), RMSReference(ioBuffer, inLength)),
+                  @"length=%u",
+                  inLength);
+    }];
+
+    // A full-scale square wave.
+    const std::vector<Float32> theSquareWave = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+    XCTAssertEqual(BGM_DSP::RMS(theSquareWave.data(), 6), 1.0f);
+}
+
+- (void) testStereoFramePeaks {
+    [self forEachBuffer:2 test:^(UInt32 inLength, Float32* ioBuffer, std::vector<Float32>& ioExpected) {
+        #pragma unused (ioExpected)
+        std::vector<Float32> thePeaks(inLength);
+        std::vector<Float32> theExpectedPeaks(inLength);
+
+        for(UInt32 i = 0; i < inLength; i++)
+        {
+            theExpectedPeaks[i] = std::max(std::fabs(ioBuffer[i * 2]), std::fabs(ioBuffer[(i * 2) + 1]));
+        }
+
+        BGM_DSP::StereoFramePeaks(ioBuffer, thePeaks.data(), inLength);
+
+        XCTAssert(IsIdentical(thePeaks.data(), theExpectedPeaks.data(), inLength), @"length=%u", inLength);
+    }];
+}
+
+@end
+
@@ -33,7 +33,10 @@
 #include "CAException.h"
 
 // STL Includes
+#include <algorithm>
+#include <iterator>
 #include <stdexcept>
+#include <vector>
 
 
 // Subclass BGM_Device to add some test-only functions.
@@ -133,6 +136,76 @@ TestBGM_Device::TestBGM_Device()
     }
 }
 
+- (void) testDoIOOperation_writeMix_readInput_silence {
+    const int kFrameSize = 512;
+
+    Float32 audioBuffer[kFrameSize * 2];
+    Float32 silentBuffer[kFrameSize * 2] = {};
+    Float32 outputBuffer[kFrameSize * 2];
+
+    for(int i = 0; i < kFrameSize * 2; i++)
+    {
+        audioBuffer[i] = static_cast<Float32>(i + 1);
+    }
+
+    AudioServerPlugInIOCycleInfo cycleInfo {};
+
+    auto writeMix = [&](Float64 sampleTime, const Float32* buffer) {
+        Float32 bufferCopy[kFrameSize * 2];
+        memcpy(bufferCopy, buffer, sizeof(bufferCopy));
+        cycleInfo.mOutputTime.mSampleTime = sampleTime;
+        testDevice->DoIOOperation(kObjectID_Stream_Output,
+                                  0,
+                                  kAudioServerPlugInIOOperationWriteMix,
+                                  kFrameSize,
+                                  cycleInfo,
+                                  bufferCopy,
+                                  nullptr);
+    };
+
+    auto readInput = [&](Float64 sampleTime) {
+        // Fill the buffer with garbage so we can tell it was written to.
+        std::fill(std::begin(outputBuffer), std::end(outputBuffer), -1.0f);
+        cycleInfo.mInputTime.mSampleTime = sampleTime;
+        testDevice->DoIOOperation(kObjectID_Stream_Input,
+                                  0,
+                                  kAudioServerPlugInIOOperationReadInput,
+                                  kFrameSize,
+                                  cycleInfo,
+                                  outputBuffer,
+                                  nullptr);
+    };
+
+    // Audio, then a few cycles of silence, then audio again. The device records the silent cycles
+    // as a silence span instead of storing them in its ring buffer.
+    writeMix(0, audioBuffer);
+    writeMix(kFrameSize, silentBuffer);
+    writeMix(kFrameSize * 2, silentBuffer);
+    writeMix(kFrameSize * 3, audioBuffer);
+
+    readInput(0);
+    XCTAssertEqual(0, memcmp(outputBuffer, audioBuffer, sizeof(outputBuffer)));
+
+    readInput(kFrameSize);
+    XCTAssertEqual(0, memcmp(outputBuffer, silentBuffer, sizeof(outputBuffer)));
+
+    // A read that starts in the silence span and ends in the audio after it.
+    readInput(kFrameSize * 2.5);
+    for(int i = 0; i < kFrameSize; i++)
+    {
+        XCTAssertEqual(0.0f, outputBuffer[i]);
+        XCTAssertEqual(audioBuffer[i], outputBuffer[kFrameSize + i]);
+    }
+
+    readInput(kFrameSize * 3);
+    XCTAssertEqual(0, memcmp(outputBuffer, audioBuffer, sizeof(outputBuffer)));
+
+    // If the sample times go back, the old silence span shouldn't hide the new audio.
+    writeMix(kFrameSize, audioBuffer);
+    readInput(kFrameSize);
+    XCTAssertEqual(0, memcmp(outputBuffer, audioBuffer, sizeof(outputBuffer)));
+}
+
 - (void) testCustomPropertyMusicPlayerBundleID {
     // Convenience wrappers
     auto getBundleID = [&](UInt32 inDataSize = sizeof(CFStringRef)){
@@ -219,6 +292,101 @@ TestBGM_Device::TestBGM_Device()
     });
 }
 
+- (void) testCustomPropertyLoopbackSharedMemory {
+    // Disabled by default.
+    CFBooleanRef theEnabled = nullptr;
+    UInt32 theOutDataSize = 0;
+    testDevice->GetPropertyData(kObjectID_Device, 0, kBGMLoopbackSharedMemoryAddress, 0, nullptr,
+                                sizeof(CFBooleanRef), theOutDataSize, &theEnabled);
+    XCTAssertEqual(theOutDataSize, sizeof(CFBooleanRef));
+    XCTAssertEqual(theEnabled, kCFBooleanFalse);
+    XCTAssertTrue(testDevice->IsPropertySettable(kObjectID_Device, 0, kBGMLoopbackSharedMemoryAddress));
+
+    // Invalid data should be rejected. (This doesn't enable the property because that would
+    // replace the real driver's segment if it's installed.)
+    BGMShouldThrow<CAException>(self, [&](){
+        CFNumberRef theNumber = (__bridge CFNumberRef)@1;
+        testDevice->SetPropertyData(kObjectID_Device, 0, kBGMLoopbackSharedMemoryAddress, 0, nullptr,
+                                    sizeof(CFNumberRef), &theNumber);
+    });
+    BGMShouldThrow<CAException>(self, [&](){
+        CFBooleanRef theNullRef = nullptr;
+        testDevice->SetPropertyData(kObjectID_Device, 0, kBGMLoopbackSharedMemoryAddress, 0, nullptr,
+                                    sizeof(CFBooleanRef), &theNullRef);
+    });
+}
+
+- (void) testCustomPropertyCaptureTaps {
+    // No apps are tapped by default.
+    CFArrayRef theTaps = nullptr;
+    UInt32 theOutDataSize = 0;
+    testDevice->GetPropertyData(kObjectID_Device, 0, kBGMCaptureTapsAddress, 0, nullptr,
+                                sizeof(CFArrayRef), theOutDataSize, &theTaps);
+    XCTAssertEqual(theOutDataSize, sizeof(CFArrayRef));
+    XCTAssertEqualObjects((NSArray*)CFBridgingRelease(theTaps), @[]);
+    XCTAssertTrue(testDevice->IsPropertySettable(kObjectID_Device, 0, kBGMCaptureTapsAddress));
+
+    // Invalid data should be rejected. (This doesn't tap any apps because that would replace the
+    // real driver's segments if it's installed.)
+    BGMShouldThrow<CAException>(self, [&](){
+        CFBooleanRef theBoolean = kCFBooleanTrue;
+        testDevice->SetPropertyData(kObjectID_Device, 0, kBGMCaptureTapsAddress, 0, nullptr,
+                                    sizeof(CFBooleanRef), &theBoolean);
+    });
+    BGMShouldThrow<CAException>(self, [&](){
+        CFArrayRef theArray = (__bridge CFArrayRef)@[ @"com.example.not.a.dictionary" ];
+        testDevice->SetPropertyData(kObjectID_Device, 0, kBGMCaptureTapsAddress, 0, nullptr,
+                                    sizeof(CFArrayRef), &theArray);
+    });
+    BGMShouldThrow<CAException>(self, [&](){
+        CFArrayRef theArray = (__bridge CFArrayRef)@[ @{ @kBGMCaptureTapsKey_SegmentName: @"/x" } ];
+        testDevice->SetPropertyData(kObjectID_Device, 0, kBGMCaptureTapsAddress, 0, nullptr,
+                                    sizeof(CFArrayRef), &theArray);
+    });
+}
+
+- (void) testCustomPropertyInfoList {
+    // The HAL only asks for as many entries as GetPropertyDataSize says there are, so the size has
+    // to include every custom property, including the ones added most recently.
+    const AudioObjectPropertyAddress theAddress = {
+        kAudioObjectPropertyCustomPropertyInfoList,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMaster
+    };
+
+    const UInt32 theSize = testDevice->GetPropertyDataSize(kObjectID_Device, 0, theAddress, 0, nullptr);
+    XCTAssertEqual(theSize % sizeof(AudioServerPlugInCustomPropertyInfo), 0);
+
+    const UInt32 theCount = theSize / sizeof(AudioServerPlugInCustomPropertyInfo);
+    std::vector<AudioServerPlugInCustomPropertyInfo> theInfo(theCount + 1);
+    UInt32 theOutDataSize = 0;
+    testDevice->GetPropertyData(kObjectID_Device, 0, theAddress, 0, nullptr,
+                                static_cast<UInt32>(theInfo.size() * sizeof(AudioServerPlugInCustomPropertyInfo)),
+                                theOutDataSize,
+                                theInfo.data());
+    XCTAssertEqual(theOutDataSize, theSize);
+
+    const AudioObjectPropertySelector kExpectedSelectors[] = {
+        kAudioDeviceCustomPropertyAppVolumes,
+        kAudioDeviceCustomPropertyEnabledOutputControls,
+        kAudioDeviceCustomPropertyCaptureTaps,
+        kAudioDeviceCustomPropertyLoopbackSharedMemory,
+        kAudioDeviceCustomPropertyMusicPlayerBundleID,
+        kAudioDeviceCustomPropertyMusicPlayerProcessID,
+        kAudioDeviceCustomPropertyDeviceAudibleState,
+        kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp
+    };
+
+    for(AudioObjectPropertySelector theSelector : kExpectedSelectors)
+    {
+        auto theEnd = theInfo.begin() + theCount;
+        XCTAssert(std::find_if(theInfo.begin(), theEnd, [&](const AudioServerPlugInCustomPropertyInfo& inInfo) {
+                      return inInfo.mSelector == theSelector;
+                  }) != theEnd,
+                  @"Missing custom property %u", theSelector);
+    }
+}
+
 // TODO: Performance tests?
 - (void) testPerformanceExample {
     // This is an example of a performance test case.
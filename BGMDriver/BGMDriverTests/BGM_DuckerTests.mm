@@ -0,0 +1,417 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_DuckerTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Renders duck curves offline by feeding client buffers through BGM_AudibleState and BGM_Ducker
+//  the same way BGM_Device::DoIOOperation does.
+//
+//  To render the curve for audio recorded from real apps, set BGM_DUCKER_TEST_MUSIC to a file of
+//  raw, interleaved, stereo Float32 samples from the music player and BGM_DUCKER_TEST_OTHER to one
+//  from another app, both at 48 kHz, and run testRenderRecordings. The music player's gain at the
+//  end of each 512-frame IO cycle is written to BGM_DUCKER_TEST_OUTPUT (or
+//  /tmp/BGM_DuckerTests-gain.raw) as raw Float32s.
+//
+
+// Unit Include
+#include "BGM_Ducker.h"
+
+// Local Includes
+#include "BGM_AudibleState.h"
+#include "BGM_TestUtils.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+// A low sample rate makes the frame counts easy to work out.
+static const Float64 kTestSampleRate = 1000.0;
+static const UInt32 kTestCycleFrames = 16;
+
+// An offline version of the ducking part of BGM_Device's IO.
+class BGM_DuckerTestHarness
+{
+
+public:
+    BGM_DuckerTestHarness(const BGM_Ducker::Settings& inSettings,
+                          Float64 inSampleRate = kTestSampleRate)
+    :
+        mDucker(inSampleRate)
+    {
+        mDucker.SetSettings(inSettings);
+    }
+
+    // Runs one IO cycle, modifying the music player's buffers in place. The other clients'
+    // buffers are only measured. The music player's clients do their IO before or after the
+    // other clients, depending on inMusicFirst.
+    void RunCycle(std::vector<std::vector<Float32>*> ioMusicBuffers,
+                  const std::vector<const std::vector<Float32>*>& inOtherBuffers,
+                  UInt32 inFrameCount,
+                  bool inMusicFirst)
+    {
+        auto theProcessOthers = [&]() {
+            for(const std::vector<Float32>* theBuffer : inOtherBuffers)
+            {
+                mAudibleState.UpdateNonMusicLevelWithClientIO(inFrameCount,
+                                                              mSampleTime,
+                                                              theBuffer->data());
+            }
+        };
+
+        if(!inMusicFirst)
+        {
+            theProcessOthers();
+        }
+
+        for(std::vector<Float32>* theBuffer : ioMusicBuffers)
+        {
+            mDucker.ProcessRT(mAudibleState.GetNonMusicPeak(mSampleTime),
+                              mSampleTime,
+                              inFrameCount,
+                              theBuffer->data());
+        }
+
+        if(inMusicFirst)
+        {
+            theProcessOthers();
+        }
+
+        mSampleTime += inFrameCount;
+    }
+
+    // Returns the gain applied to each frame of the music. The other client's audio should be
+    // interleaved stereo. Frames past the end of it are treated as if the client had stopped IO.
+    std::vector<Float32> RenderDuckCurve(const std::vector<Float32>& inOther,
+                                         UInt32 inFrameCount,
+                                         bool inMusicFirst,
+                                         UInt32 inCycleFrames = kTestCycleFrames)
+    {
+        std::vector<Float32> theCurve;
+
+        for(UInt32 i = 0; i < inFrameCount; i += inCycleFrames)
+        {
+            const UInt32 theCycleFrames = std::min(inCycleFrames, inFrameCount - i);
+            std::vector<Float32> theMusic(theCycleFrames * 2, 1.0f);
+            std::vector<const std::vector<Float32>*> theOthers;
+            std::vector<Float32> theOther;
+
+            if((i + theCycleFrames) * 2 <= inOther.size())
+            {
+                theOther.assign(inOther.begin() + (i * 2), inOther.begin() + ((i + theCycleFrames) * 2));
+                theOthers.push_back(&theOther);
+            }
+
+            RunCycle({ &theMusic }, theOthers, theCycleFrames, inMusicFirst);
+
+            for(UInt32 j = 0; j < theCycleFrames; j++)
+            {
+                theCurve.push_back(theMusic[j * 2]);
+            }
+        }
+
+        return theCurve;
+    }
+
+    BGM_AudibleState            mAudibleState;
+    BGM_Ducker                  mDucker;
+    Float64                     mSampleTime = 0.0;
+
+};
+
+// Silence, then inAudibleFrames frames at a level that triggers ducking, then silence until
+// inFrameCount. Always a whole number of test cycles.
+static std::vector<Float32> Burst(UInt32 inStartFrame, UInt32 inAudibleFrames, UInt32 inFrameCount)
+{
+    std::vector<Float32> theFrames(inFrameCount * 2, 0.0f);
+    std::fill(theFrames.begin() + (inStartFrame * 2),
+              theFrames.begin() + ((inStartFrame + inAudibleFrames) * 2),
+              0.5f);
+    return theFrames;
+}
+
+static std::vector<Float32> ReadRawFloat32File(const char* inPath)
+{
+    std::vector<Float32> theSamples;
+    FILE* theFile = fopen(inPath, "rb");
+
+    if(theFile)
+    {
+        Float32 theBuffer[4096];
+        size_t theCount;
+
+        while((theCount = fread(theBuffer, sizeof(Float32), 4096, theFile)) > 0)
+        {
+            theSamples.insert(theSamples.end(), theBuffer, theBuffer + theCount);
+        }
+
+        fclose(theFile);
+    }
+
+    return theSamples;
+}
+
+static BGM_Ducker::Settings TestSettings()
+{
+    BGM_Ducker::Settings theSettings;
+    theSettings.mGain = 0.5f;
+    theSettings.mThreshold = 0.01f;
+    theSettings.mAttackSeconds = 0.01;   // 10 frames
+    theSettings.mHoldSeconds = 0.02;     // 20 frames
+    theSettings.mReleaseSeconds = 0.04;  // 40 frames
+    return theSettings;
+}
+
+@interface BGM_DuckerTests : XCTestCase
+
+@end
+
+@implementation BGM_DuckerTests
+
+// Checks the curve for a burst of audio starting at frame onset and stopping at offset, as
+// seen by the ducker.
+- (void) checkCurve:(const std::vector<Float32>&)curve onset:(UInt32)onset offset:(UInt32)offset {
+    for(UInt32 i = 0; i < onset; i++)
+    {
+        XCTAssertEqual(curve[i], 1.0f, @"frame %u", i);
+    }
+
+    // Attack over 10 frames.
+    for(UInt32 i = 0; i < 10; i++)
+    {
+        XCTAssertEqualWithAccuracy(curve[onset + i], 1.0f - (0.05f * (i + 1)), 0.0001f, @"frame %u", onset + i);
+    }
+
+    XCTAssertEqual(curve[onset + 9], 0.5f);
+
+    // Held down until 20 frames after the audio stops.
+    for(UInt32 i = onset + 10; i < offset + 20; i++)
+    {
+        XCTAssertEqual(curve[i], 0.5f, @"frame %u", i);
+    }
+
+    // Release over 40 frames.
+    for(UInt32 i = 0; i < 40; i++)
+    {
+        XCTAssertEqualWithAccuracy(curve[offset + 20 + i], 0.5f + (0.0125f * (i + 1)), 0.0001f, @"frame %u", offset + 20 + i);
+    }
+
+    for(UInt32 i = offset + 60; i < curve.size(); i++)
+    {
+        XCTAssertEqual(curve[i], 1.0f, @"frame %u", i);
+    }
+}
+
+- (void) testEnvelopeWhenOtherClientsAreProcessedFirst {
+    // The other client plays from frame 32 to 80. The music is ducked from the same frame.
+    BGM_DuckerTestHarness theHarness(TestSettings());
+    std::vector<Float32> theCurve = theHarness.RenderDuckCurve(Burst(32, 48, 256), 256, false);
+
+    [self checkCurve:theCurve onset:32 offset:80];
+}
+
+- (void) testEnvelopeWhenMusicIsProcessedFirst {
+    // The music player only finds out about the other client's audio in the next cycle.
+    BGM_DuckerTestHarness theHarness(TestSettings());
+    std::vector<Float32> theCurve = theHarness.RenderDuckCurve(Burst(32, 48, 256), 256, true);
+
+    [self checkCurve:theCurve onset:32 + kTestCycleFrames offset:80 + kTestCycleFrames];
+}
+
+- (void) testOtherClientStopsIO {
+    // When the other client stops doing IO altogether, instead of sending silence, its last cycle
+    // still counts for one more cycle.
+    for(bool theMusicFirst : { false, true })
+    {
+        BGM_DuckerTestHarness theHarness(TestSettings());
+        std::vector<Float32> theOther(80 * 2, 0.5f);
+        std::fill(theOther.begin(), theOther.begin() + (32 * 2), 0.0f);
+
+        std::vector<Float32> theCurve = theHarness.RenderDuckCurve(theOther, 256, theMusicFirst);
+
+        [self checkCurve:theCurve
+                   onset:32 + (theMusicFirst ? kTestCycleFrames : 0)
+                  offset:80 + kTestCycleFrames];
+    }
+}
+
+- (void) testQuietAudioDoesntDuck {
+    BGM_DuckerTestHarness theHarness(TestSettings());
+    std::vector<Float32> theOther(256 * 2, 0.009f);
+
+    for(Float32 theGain : theHarness.RenderDuckCurve(theOther, 256, false))
+    {
+        XCTAssertEqual(theGain, 1.0f);
+    }
+}
+
+- (void) testSameGainsForAllMusicPlayerClients {
+    BGM_DuckerTestHarness theHarness(TestSettings());
+    std::vector<Float32> theOther(kTestCycleFrames * 2, 0.5f);
+
+    // Three cycles, so the second and third buffers start part way through the attack.
+    for(UInt32 theCycle = 0; theCycle < 3; theCycle++)
+    {
+        std::vector<Float32> theMusic1(kTestCycleFrames * 2, 1.0f);
+        std::vector<Float32> theMusic2(kTestCycleFrames * 2, 0.5f);
+
+        theHarness.RunCycle({ &theMusic1, &theMusic2 }, { &theOther }, kTestCycleFrames, false);
+
+        for(UInt32 i = 0; i < kTestCycleFrames * 2; i++)
+        {
+            XCTAssertEqual(theMusic1[i] * 0.5f, theMusic2[i]);
+        }
+    }
+}
+
+- (void) testNoAttackOrRelease {
+    BGM_Ducker::Settings theSettings = TestSettings();
+    theSettings.mAttackSeconds = 0.0;
+    theSettings.mHoldSeconds = 0.0;
+    theSettings.mReleaseSeconds = 0.0;
+
+    BGM_DuckerTestHarness theHarness(theSettings);
+    std::vector<Float32> theCurve = theHarness.RenderDuckCurve(Burst(32, 48, 128), 128, false);
+
+    for(UInt32 i = 0; i < theCurve.size(); i++)
+    {
+        XCTAssertEqual(theCurve[i], (i >= 32 && i < 80) ? 0.5f : 1.0f, @"frame %u", i);
+    }
+}
+
+- (void) testSampleRateChangesFrameCounts {
+    BGM_DuckerTestHarness theHarness(TestSettings(), 500.0);
+    theHarness.mDucker.SetSampleRate(kTestSampleRate);
+
+    std::vector<Float32> theCurve = theHarness.RenderDuckCurve(Burst(32, 48, 256), 256, false);
+
+    [self checkCurve:theCurve onset:32 offset:80];
+}
+
+- (void) testReset {
+    BGM_DuckerTestHarness theHarness(TestSettings());
+    theHarness.RenderDuckCurve(std::vector<Float32>(64 * 2, 0.5f), 64, false);
+    XCTAssertEqual(theHarness.mDucker.GetGain(), 0.5f);
+
+    theHarness.mDucker.Reset();
+    theHarness.mAudibleState.Reset();
+    XCTAssertEqual(theHarness.mDucker.GetGain(), 1.0f);
+
+    // The hold shouldn't carry over.
+    for(Float32 theGain : theHarness.RenderDuckCurve({}, 64, false))
+    {
+        XCTAssertEqual(theGain, 1.0f);
+    }
+}
+
+- (void) testInvalidSettings {
+    BGMShouldThrow<CAException>(self, [](){ BGM_Ducker theDucker(0.0); });
+
+    std::vector<BGM_Ducker::Settings> theInvalidSettings(7, TestSettings());
+    theInvalidSettings[0].mGain = -0.1f;
+    theInvalidSettings[1].mGain = 1.1f;
+    theInvalidSettings[2].mGain = NAN;
+    theInvalidSettings[3].mThreshold = 0.0f;
+    theInvalidSettings[4].mAttackSeconds = -1.0;
+    theInvalidSettings[5].mHoldSeconds = BGM_Ducker::kMaxTimeSeconds + 1;
+    theInvalidSettings[6].mReleaseSeconds = NAN;
+
+    for(const BGM_Ducker::Settings& theSettings : theInvalidSettings)
+    {
+        BGM_Ducker theDucker(kTestSampleRate);
+        BGMShouldThrow<CAException>(self, [&](){ theDucker.SetSettings(theSettings); });
+
+        // None of the settings should have changed.
+        XCTAssertEqual(theDucker.GetSettings().mGain, BGM_Ducker::Settings().mGain);
+        XCTAssertEqual(theDucker.GetSettings().mThreshold, BGM_Ducker::Settings().mThreshold);
+        XCTAssertEqual(theDucker.GetSettings().mHoldSeconds, BGM_Ducker::Settings().mHoldSeconds);
+    }
+}
+
+- (void) testRenderRecordings {
+    const char* theMusicPath = getenv("BGM_DUCKER_TEST_MUSIC");
+    const char* theOtherPath = getenv("BGM_DUCKER_TEST_OTHER");
+
+    if(!theMusicPath || !theOtherPath)
+    {
+        return;
+    }
+
+    std::vector<Float32> theMusic = ReadRawFloat32File(theMusicPath);
+    std::vector<Float32> theOther = ReadRawFloat32File(theOtherPath);
+    XCTAssertGreaterThan(theMusic.size(), 0);
+
+    BGM_DuckerTestHarness theHarness(BGM_Ducker::Settings(), 48000.0);
+    std::vector<Float32> theGains;
+
+    for(size_t i = 0; i + (512 * 2) <= theMusic.size(); i += 512 * 2)
+    {
+        std::vector<Float32> theMusicCycle(theMusic.begin() + i, theMusic.begin() + i + (512 * 2));
+        std::vector<Float32> theOtherCycle(512 * 2, 0.0f);
+
+        if(i + (512 * 2) <= theOther.size())
+        {
+            std::copy(theOther.begin() + i, theOther.begin() + i + (512 * 2), theOtherCycle.begin());
+        }
+
+        theHarness.RunCycle({ &theMusicCycle }, { &theOtherCycle }, 512, false);
+        XCTAssertLessThanOrEqual(theHarness.mDucker.GetGain(), 1.0f);
+        theGains.push_back(theHarness.mDucker.GetGain());
+    }
+
+    const char* theOutputPath = getenv("BGM_DUCKER_TEST_OUTPUT");
+    FILE* theOutput = fopen(theOutputPath ? theOutputPath : "/tmp/BGM_DuckerTests-gain.raw", "wb");
+
+    if(theOutput)
+    {
+        fwrite(theGains.data(), sizeof(Float32), theGains.size(), theOutput);
+        fclose(theOutput);
+    }
+}
+
+#pragma mark Performance
+
+- (void) testPerformance {
+    BGM_Ducker* theDucker = new BGM_Ducker(48000.0);
+    std::vector<Float32> theBuffer(512 * 2, 0.5f);
+    Float32* theBufferData = theBuffer.data();
+
+    // Alternate between ducking and not, so the gain is always ramping.
+    BGM_Ducker::Settings theSettings;
+    theSettings.mHoldSeconds = 0.0;
+    theDucker->SetSettings(theSettings);
+
+    [self measureBlock:^{
+        for(UInt32 theCycle = 0; theCycle < 10000; theCycle++)
+        {
+            theDucker->ProcessRT(((theCycle / 10) % 2) ? 1.0f : 0.0f, theCycle * 512.0, 512, theBufferData);
+        }
+    }];
+
+    delete theDucker;
+}
+
+@end
+
@@ -0,0 +1,476 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_DynamicDevicesTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#include "BGM_DynamicDevices.h"
+
+// Local Includes
+#include "BGM_AbstractDevice.h"
+#include "BGM_MockHost.h"
+#include "BGM_Object.h"
+#include "BGM_ObjectRegistry.h"
+#include "BGM_PlugIn.h"
+#include "BGM_TestUtils.h"
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CACFArray.h"
+#include "CACFDictionary.h"
+#include "CACFString.h"
+#include "CADispatchQueue.h"
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+static const UInt32 kTestFrameSize = 512;
+static const UInt32 kTestClientID = 11;
+static const pid_t kTestClientPID = 4321;
+
+// An object the tests can register under one of a dynamic device's IDs, so creating the device
+// fails.
+class BGM_DynamicDevicesTestObject
+:
+    public BGM_Object
+{
+
+public:
+    BGM_DynamicDevicesTestObject(AudioObjectID inObjectID)
+    :
+        BGM_Object(inObjectID, kAudioObjectClassID, kAudioObjectClassID, kAudioObjectPlugInObject)
+    {
+    }
+
+    ~BGM_DynamicDevicesTestObject() = default;
+
+};
+
+// Makes a value for kAudioPlugInCustomPropertyDynamicDevices with a device for each UID. The
+// caller owns the array.
+static CFArrayRef CreateDeviceList(const std::vector<std::string>& inUIDs,
+                                   const char* __nullable inName = nullptr)
+{
+    CACFArray theDevices(true);
+
+    for(const std::string& theUID : inUIDs)
+    {
+        CACFDictionary theDevice(true);
+        CACFString theUIDRef(theUID.c_str());
+        theDevice.AddString(CFSTR(kBGMDynamicDeviceKey_UID), theUIDRef.GetCFString());
+
+        if(inName != nullptr)
+        {
+            CACFString theNameRef(inName);
+            theDevice.AddString(CFSTR(kBGMDynamicDeviceKey_Name), theNameRef.GetCFString());
+        }
+
+        theDevices.AppendDictionary(theDevice.GetDict());
+    }
+
+    return theDevices.CopyCFArray();
+}
+
+static std::vector<std::string> MakeUIDs(UInt32 inNumberOfDevices)
+{
+    std::vector<std::string> theUIDs;
+
+    for(UInt32 i = 0; i < inNumberOfDevices; i++)
+    {
+        theUIDs.push_back("com.example.dynamic." + std::to_string(i));
+    }
+
+    return theUIDs;
+}
+
+// Sets the devices and returns whether that changed them.
+static bool SetDevices(BGM_DynamicDevices& inDevices,
+                       const std::vector<std::string>& inUIDs,
+                       const char* __nullable inName = nullptr)
+{
+    CFArrayRef theList = CreateDeviceList(inUIDs, inName);
+    bool theChanged = false;
+
+    try
+    {
+        theChanged = inDevices.SetDevices(theList);
+    }
+    catch(...)
+    {
+        CFRelease(theList);
+        throw;
+    }
+
+    CFRelease(theList);
+    return theChanged;
+}
+
+static Float64 GetNominalSampleRate(BGM_AbstractDevice& inDevice)
+{
+    Float64 theSampleRate = 0.0;
+    UInt32 theSize = 0;
+    inDevice.GetPropertyData(inDevice.GetObjectID(),
+                             0,
+                             { kAudioDevicePropertyNominalSampleRate,
+                               kAudioObjectPropertyScopeGlobal,
+                               kAudioObjectPropertyElementMaster },
+                             0,
+                             nullptr,
+                             sizeof(Float64),
+                             theSize,
+                             &theSampleRate);
+    return theSampleRate;
+}
+
+@interface BGM_DynamicDevicesTests : XCTestCase {
+    std::unique_ptr<BGM_MockHost> host;
+}
+
+@end
+
+@implementation BGM_DynamicDevicesTests
+
+- (void) setUp {
+    [super setUp];
+
+    host.reset(new BGM_MockHost);
+    BGM_PlugIn::SetHost(host.get());
+}
+
+- (void) tearDown {
+    // Let the driver finish sending any notifications it queued before removing the host.
+    CADispatchQueue::GetGlobalSerialQueue().Dispatch(true, ^{});
+    BGM_PlugIn::SetHost(nullptr);
+    host.reset();
+
+    [super tearDown];
+}
+
+- (void) testScaling {
+    for(UInt32 theNumberOfDevices : { 1, 2, 4, 8, 16, 32 })
+    {
+        BGM_DynamicDevices theDevices;
+        XCTAssert(SetDevices(theDevices, MakeUIDs(theNumberOfDevices)));
+        XCTAssertEqual(theDevices.GetNumberOfDevices(), theNumberOfDevices);
+
+        std::vector<AudioObjectID> theDeviceIDs(kBGMMaxDynamicDevices);
+        theDeviceIDs.resize(theDevices.GetDeviceIDs(theDeviceIDs.data(), kBGMMaxDynamicDevices));
+        XCTAssertEqual(theDeviceIDs.size(), theNumberOfDevices);
+
+        // Every device and its streams and controls should be published with their own IDs.
+        for(UInt32 i = 0; i < theDeviceIDs.size(); i++)
+        {
+            AudioObjectID theDeviceID = theDeviceIDs[i];
+            XCTAssertEqual(theDeviceID, BGM_DynamicDevices::GetObjectID(i, kBGMDynamicDeviceObjectIDOffset_Device));
+            XCTAssertEqual(BGM_ObjectRegistry::GetDevice(theDeviceID).GetObjectID(), theDeviceID);
+
+            CACFString theUID(("com.example.dynamic." + std::to_string(i)).c_str());
+            XCTAssertEqual(theDevices.GetDeviceIDForUID(theUID.GetCFString()), theDeviceID);
+
+            for(UInt32 theOffset = 1; theOffset < kBGMDynamicDeviceObjectIDs; theOffset++)
+            {
+                XCTAssert(&BGM_ObjectRegistry::GetOwnerObject(theDeviceID + theOffset) ==
+                          &BGM_ObjectRegistry::GetDevice(theDeviceID));
+            }
+        }
+
+        // Start IO on all of the devices, then check each one loops back its own audio.
+        for(AudioObjectID theDeviceID : theDeviceIDs)
+        {
+            BGM_AbstractDevice& theDevice = BGM_ObjectRegistry::GetDevice(theDeviceID);
+            host->AddClient(theDevice, kTestClientID, kTestClientPID, CFSTR("com.example.player"));
+            theDevice.StartIO(kTestClientID);
+        }
+
+        for(UInt32 i = 0; i < theDeviceIDs.size(); i++)
+        {
+            BGM_AbstractDevice& theDevice = BGM_ObjectRegistry::GetDevice(theDeviceIDs[i]);
+            const Float64 theSampleRate = GetNominalSampleRate(theDevice);
+
+            // Start a couple of buffers in so the first cycles' input times aren't negative.
+            host->AdvanceTimeByFrames(kTestFrameSize * 2, theSampleRate);
+
+            std::vector<Float32> theOutput(kTestFrameSize * 2);
+            std::vector<Float32> theInput(kTestFrameSize * 2);
+            // A different level for each device, so they'd be told apart if their audio got mixed.
+            const Float32 theLevel = 0.01f * (i + 1);
+
+            for(int theCycle = 0; theCycle < 4; theCycle++)
+            {
+                std::fill(theOutput.begin(), theOutput.end(), theLevel);
+
+                host->RunIOCycle(theDevice,
+                                 theDeviceIDs[i] + kBGMDynamicDeviceObjectIDOffset_Stream_Input,
+                                 theDeviceIDs[i] + kBGMDynamicDeviceObjectIDOffset_Stream_Output,
+                                 kTestClientID,
+                                 kTestFrameSize,
+                                 theSampleRate,
+                                 theOutput.data(),
+                                 theInput.data());
+
+                // The input is a buffer behind and the output a buffer ahead, so the audio comes
+                // back from the third cycle on.
+                if(theCycle >= 2)
+                {
+                    XCTAssertEqualWithAccuracy(theInput[0], theLevel, 1e-6,
+                                               "%u devices, device %u, cycle %d",
+                                               theNumberOfDevices, i, theCycle);
+                }
+            }
+        }
+
+        for(AudioObjectID theDeviceID : theDeviceIDs)
+        {
+            BGM_AbstractDevice& theDevice = BGM_ObjectRegistry::GetDevice(theDeviceID);
+            theDevice.StopIO(kTestClientID);
+            host->RemoveClient(theDevice, kTestClientID, kTestClientPID, CFSTR("com.example.player"));
+        }
+
+        // Removing the devices should take them out of the device list straight away, but only
+        // unregister and destroy them when asked.
+        XCTAssert(SetDevices(theDevices, {}));
+        XCTAssertEqual(theDevices.GetNumberOfDevices(), 0);
+
+        for(AudioObjectID theDeviceID : theDeviceIDs)
+        {
+            XCTAssertFalse(BGM_ObjectRegistry::GetDevice(theDeviceID).IsActive());
+        }
+
+        XCTAssertFalse(theDevices.DeleteRetiredDevices());
+
+        for(AudioObjectID theDeviceID : theDeviceIDs)
+        {
+            for(UInt32 theOffset = 0; theOffset < kBGMDynamicDeviceObjectIDs; theOffset++)
+            {
+                XCTAssert(BGM_ObjectRegistry::FindObject(theDeviceID + theOffset) == nullptr);
+            }
+        }
+    }
+}
+
+- (void) testKeepsExistingDevices {
+    BGM_DynamicDevices theDevices;
+    XCTAssert(SetDevices(theDevices, { "meetings", "media" }));
+
+    CACFString theMeetingsUID("meetings");
+    CACFString theMediaUID("media");
+    const AudioObjectID theMeetingsID = theDevices.GetDeviceIDForUID(theMeetingsUID.GetCFString());
+    const AudioObjectID theMediaID = theDevices.GetDeviceIDForUID(theMediaUID.GetCFString());
+    BGM_AbstractDevice* theMediaDevice = &BGM_ObjectRegistry::GetDevice(theMediaID);
+
+    // Setting the same list again shouldn't change anything.
+    XCTAssertFalse(SetDevices(theDevices, { "meetings", "media" }));
+
+    // Removing one device shouldn't affect the other.
+    XCTAssert(SetDevices(theDevices, { "media" }));
+    XCTAssertEqual(theDevices.GetDeviceIDForUID(theMeetingsUID.GetCFString()), kAudioObjectUnknown);
+    XCTAssertEqual(theDevices.GetDeviceIDForUID(theMediaUID.GetCFString()), theMediaID);
+    XCTAssert(&BGM_ObjectRegistry::GetDevice(theMediaID) == theMediaDevice);
+    XCTAssertFalse(BGM_ObjectRegistry::GetDevice(theMeetingsID).IsActive());
+
+    // The removed device's slot can't be reused until the device has been destroyed.
+    XCTAssert(SetDevices(theDevices, { "media", "meetings" }));
+    XCTAssertNotEqual(theDevices.GetDeviceIDForUID(theMeetingsUID.GetCFString()), theMeetingsID);
+
+    XCTAssertFalse(theDevices.DeleteRetiredDevices());
+    XCTAssert(BGM_ObjectRegistry::FindObject(theMeetingsID) == nullptr);
+
+    // Renaming a device replaces it.
+    XCTAssert(SetDevices(theDevices, { "media", "meetings" }, "Renamed"));
+    XCTAssertEqual(theDevices.GetNumberOfDevices(), 2);
+    XCTAssertNotEqual(theDevices.GetDeviceIDForUID(theMediaUID.GetCFString()), theMediaID);
+}
+
+- (void) testKeepsRetiredDevicesUntilIOStops {
+    BGM_DynamicDevices theDevices;
+    XCTAssert(SetDevices(theDevices, { "media" }));
+
+    CACFString theMediaUID("media");
+    const AudioObjectID theMediaID = theDevices.GetDeviceIDForUID(theMediaUID.GetCFString());
+    BGM_AbstractDevice& theDevice = BGM_ObjectRegistry::GetDevice(theMediaID);
+    host->AddClient(theDevice, kTestClientID, kTestClientPID, CFSTR("com.example.player"));
+    theDevice.StartIO(kTestClientID);
+
+    XCTAssert(SetDevices(theDevices, {}));
+    XCTAssertEqual(theDevices.GetNumberOfDevices(), 0);
+
+    // The HAL hasn't stopped IO yet, so the device should still be there for it to stop.
+    XCTAssert(theDevices.DeleteRetiredDevices());
+    XCTAssert(&BGM_ObjectRegistry::GetDevice(theMediaID) == &theDevice);
+
+    // IO can't be started again once the device has been removed.
+    BGMShouldThrow<CAException>(self, [&] { theDevice.StartIO(kTestClientID + 1); });
+
+    theDevice.StopIO(kTestClientID);
+    host->RemoveClient(theDevice, kTestClientID, kTestClientPID, CFSTR("com.example.player"));
+
+    XCTAssertFalse(theDevices.DeleteRetiredDevices());
+    XCTAssert(BGM_ObjectRegistry::FindObject(theMediaID) == nullptr);
+
+    // The slot should be free again.
+    XCTAssert(SetDevices(theDevices, MakeUIDs(kBGMMaxDynamicDevices)));
+}
+
+- (void) testRetiresDevicesWhenCreatingOneFails {
+    BGM_DynamicDevices theDevices;
+
+    // Take the input stream ID of the device in the third slot, so that device fails to register
+    // after its own ID has been registered.
+    const UInt32 kFailingSlot = 2;
+    const AudioObjectID kBlockedID =
+            BGM_DynamicDevices::GetObjectID(kFailingSlot, kBGMDynamicDeviceObjectIDOffset_Stream_Input);
+    BGM_DynamicDevicesTestObject theBlockingObject(kBlockedID);
+    BGM_ObjectRegistry::RegisterObject(theBlockingObject, theBlockingObject);
+
+    BGMShouldThrow<CAException>(self, [&] { SetDevices(theDevices, MakeUIDs(kFailingSlot + 1)); });
+    XCTAssertEqual(theDevices.GetNumberOfDevices(), 0);
+
+    // The devices that were created should have been retired rather than deleted, since the HAL
+    // could have looked them up already.
+    const AudioObjectID theFirstDeviceID =
+            BGM_DynamicDevices::GetObjectID(0, kBGMDynamicDeviceObjectIDOffset_Device);
+    XCTAssertFalse(BGM_ObjectRegistry::GetDevice(theFirstDeviceID).IsActive());
+
+    std::atomic<bool> callStarted(false);
+    std::atomic<bool> finishCall(false);
+    std::atomic<bool> deviceWasUsable(false);
+    std::atomic<bool> devicesDeleted(false);
+
+    // Simulate a call from the HAL that's using the first device.
+    std::thread theCallThread([&] {
+        BGM_ObjectRegistry::CallScope theCallScope;
+        BGM_AbstractDevice& theDevice = BGM_ObjectRegistry::GetDevice(theFirstDeviceID);
+        callStarted = true;
+
+        while(!finishCall)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        deviceWasUsable = !devicesDeleted && theDevice.GetObjectID() == theFirstDeviceID;
+    });
+
+    while(!callStarted)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::thread theDeletingThread([&] {
+        theDevices.DeleteRetiredDevices();
+        devicesDeleted = true;
+    });
+
+    // Nothing should be deleted until the call has returned.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    XCTAssertFalse(devicesDeleted);
+
+    finishCall = true;
+    theCallThread.join();
+    theDeletingThread.join();
+    XCTAssert(deviceWasUsable);
+    XCTAssert(devicesDeleted);
+
+    // All of the devices should be gone, including the one that was only partly registered, but
+    // not the object that was in its way.
+    for(UInt32 theSlot = 0; theSlot <= kFailingSlot; theSlot++)
+    {
+        XCTAssert(BGM_ObjectRegistry::FindObject(
+                BGM_DynamicDevices::GetObjectID(theSlot, kBGMDynamicDeviceObjectIDOffset_Device)) == nullptr);
+    }
+
+    XCTAssert(BGM_ObjectRegistry::FindObject(kBlockedID) == &theBlockingObject);
+
+    // Their slots should be free again.
+    BGM_ObjectRegistry::Unregister(theBlockingObject);
+    XCTAssert(SetDevices(theDevices, MakeUIDs(kBGMMaxDynamicDevices)));
+}
+
+- (void) testInvalidDeviceLists {
+    BGM_DynamicDevices theDevices;
+    XCTAssert(SetDevices(theDevices, { "media" }));
+
+    // Duplicate UIDs.
+    BGMShouldThrow<CAException>(self, [&] { SetDevices(theDevices, { "a", "a" }); });
+    // The UIDs of the built-in devices.
+    BGMShouldThrow<CAException>(self, [&] { SetDevices(theDevices, { kBGMDeviceUID }); });
+    BGMShouldThrow<CAException>(self, [&] { SetDevices(theDevices, { kBGMDeviceUID_UISounds }); });
+    BGMShouldThrow<CAException>(self, [&] { SetDevices(theDevices, { kBGMNullDeviceUID }); });
+    // An empty UID.
+    BGMShouldThrow<CAException>(self, [&] { SetDevices(theDevices, { "" }); });
+    // Too many devices.
+    BGMShouldThrow<CAException>(self, [&] {
+        SetDevices(theDevices, MakeUIDs(kBGMMaxDynamicDevices + 1));
+    });
+
+    // An entry that isn't a dictionary.
+    CACFArray theList(true);
+    theList.AppendString(CFSTR("media"));
+    BGMShouldThrow<CAException>(self, [&] { theDevices.SetDevices(theList.GetCFArray()); });
+
+    // None of them should have changed the devices.
+    XCTAssertEqual(theDevices.GetNumberOfDevices(), 1);
+    CACFString theMediaUID("media");
+    XCTAssertNotEqual(theDevices.GetDeviceIDForUID(theMediaUID.GetCFString()), kAudioObjectUnknown);
+
+    // A list that would only fit once the retired devices are destroyed.
+    XCTAssert(SetDevices(theDevices, MakeUIDs(kBGMMaxDynamicDevices - 1)));
+    BGMShouldThrow<CAException>(self, [&] { SetDevices(theDevices, { "media" }); });
+    XCTAssertFalse(theDevices.DeleteRetiredDevices());
+    XCTAssert(SetDevices(theDevices, { "media" }));
+}
+
+- (void) testCopyDevicesAsCFArray {
+    BGM_DynamicDevices theDevices;
+    XCTAssert(SetDevices(theDevices, { "meetings" }, "Meetings"));
+
+    CACFArray theList(theDevices.CopyDevicesAsCFArray(), true);
+    XCTAssertEqual(theList.GetNumberItems(), 1);
+
+    CFDictionaryRef theDeviceRef = nullptr;
+    XCTAssert(theList.GetDictionary(0, theDeviceRef));
+    CACFDictionary theDevice(theDeviceRef, false);
+
+    CACFString theUID, theName, theSegmentName;
+    theDevice.GetCACFString(CFSTR(kBGMDynamicDeviceKey_UID), theUID);
+    theDevice.GetCACFString(CFSTR(kBGMDynamicDeviceKey_Name), theName);
+    theDevice.GetCACFString(CFSTR(kBGMDynamicDeviceKey_SegmentName), theSegmentName);
+
+    XCTAssert(theUID == CACFString("meetings"));
+    XCTAssert(theName == CACFString("Meetings"));
+    XCTAssert(theSegmentName == CACFString("/BGMDevice.0.loopback"));
+
+    // The name defaults to the UID.
+    XCTAssert(SetDevices(theDevices, { "meetings" }));
+    CACFArray theNewList(theDevices.CopyDevicesAsCFArray(), true);
+    XCTAssert(theNewList.GetDictionary(0, theDeviceRef));
+    CACFDictionary(theDeviceRef, false).GetCACFString(CFSTR(kBGMDynamicDeviceKey_Name), theName);
+    XCTAssert(theName == CACFString("meetings"));
+}
+
+@end
+
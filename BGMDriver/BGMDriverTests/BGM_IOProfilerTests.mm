@@ -0,0 +1,297 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOProfilerTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#include "BGM_IOProfiler.h"
+
+// Local Includes
+#include "BGM_TestUtils.h"
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CACFDictionary.h"
+
+// STL Includes
+#include <algorithm>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+#if !BGM_IO_PROFILING
+// When profiling isn't compiled in, BGM_Device shouldn't be any bigger or do any more work than it
+// would without the profiler.
+static_assert(std::is_empty<BGM_IOProfiler>::value, "BGM_IOProfiler should be empty");
+static_assert(std::is_empty<BGM_IOProfiler::Scope>::value, "BGM_IOProfiler::Scope should be empty");
+static_assert(std::is_trivially_destructible<BGM_IOProfiler::Scope>::value,
+              "BGM_IOProfiler::Scope shouldn't have a destructor");
+static_assert(sizeof(BGM_IOProfiler::Locker) == sizeof(CAMutex::Locker),
+              "BGM_IOProfiler::Locker should just be a CAMutex::Locker");
+#endif
+
+// The number of times the benchmarks lock the mutex per run.
+static const UInt32 kBenchmarkIterations = 100000;
+
+@interface BGM_IOProfilerTests : XCTestCase
+
+@end
+
+@implementation BGM_IOProfilerTests
+
+- (void) testBuckets {
+    // Durations under kSubBuckets nanoseconds are exact.
+    for(UInt64 theNanos = 0; theNanos < BGM_IOHistogram::kSubBuckets; theNanos++)
+    {
+        XCTAssertEqual(BGM_IOHistogram::BucketForNanos(theNanos), theNanos);
+    }
+
+    // The buckets are in order, each duration is in the bucket whose range it's in, and the
+    // bucket's lower bound is within 1/kSubBuckets of it.
+    UInt32 thePreviousBucket = 0;
+
+    for(UInt64 theNanos = 1; theNanos < (1ULL << 42); theNanos += 1 + (theNanos / 97))
+    {
+        const UInt32 theBucket = BGM_IOHistogram::BucketForNanos(theNanos);
+
+        XCTAssertGreaterThanOrEqual(theBucket, thePreviousBucket);
+        XCTAssertLessThan(theBucket, BGM_IOHistogram::kNumBuckets);
+        thePreviousBucket = theBucket;
+
+        if(theBucket < BGM_IOHistogram::kNumBuckets - 1)
+        {
+            const UInt64 theLowerBound = BGM_IOHistogram::LowerBoundForBucket(theBucket);
+
+            XCTAssertLessThanOrEqual(theLowerBound, theNanos);
+            XCTAssertLessThan(theNanos, BGM_IOHistogram::LowerBoundForBucket(theBucket + 1));
+            XCTAssertLessThanOrEqual(theNanos - theLowerBound, theNanos / BGM_IOHistogram::kSubBuckets);
+        }
+    }
+
+    for(UInt32 theBucket = 0; theBucket < BGM_IOHistogram::kNumBuckets; theBucket++)
+    {
+        XCTAssertEqual(BGM_IOHistogram::BucketForNanos(BGM_IOHistogram::LowerBoundForBucket(theBucket)),
+                       theBucket);
+    }
+
+    // Very long durations go in the last bucket.
+    XCTAssertEqual(BGM_IOHistogram::BucketForNanos(UINT64_MAX), BGM_IOHistogram::kNumBuckets - 1);
+}
+
+- (void) testRecordAndReset {
+    BGM_IOHistogram theHistogram;
+
+    XCTAssertEqual(theHistogram.GetCount(), 0);
+    XCTAssertEqual(theHistogram.GetQuantileNanos(0.5), 0);
+
+    // 1 µs, 2 µs, ..., 100 µs.
+    for(UInt64 i = 1; i <= 100; i++)
+    {
+        theHistogram.Record(i * 1000);
+    }
+
+    XCTAssertEqual(theHistogram.GetCount(), 100);
+    XCTAssertEqual(theHistogram.GetTotalNanos(), 5050000);
+    XCTAssertEqual(theHistogram.GetMaxNanos(), 100000);
+
+    // The quantiles are rounded up to the end of their buckets, which are 1/8 of a power of two wide.
+    XCTAssertGreaterThanOrEqual(theHistogram.GetQuantileNanos(0.5), 50000);
+    XCTAssertLessThanOrEqual(theHistogram.GetQuantileNanos(0.5), 50000 + (50000 / 8));
+    XCTAssertGreaterThanOrEqual(theHistogram.GetQuantileNanos(0.99), 99000);
+    XCTAssertEqual(theHistogram.GetQuantileNanos(1.0), 100000);
+
+    theHistogram.Reset();
+
+    XCTAssertEqual(theHistogram.GetCount(), 0);
+    XCTAssertEqual(theHistogram.GetTotalNanos(), 0);
+    XCTAssertEqual(theHistogram.GetMaxNanos(), 0);
+    XCTAssertEqual(theHistogram.GetQuantileNanos(0.5), 0);
+}
+
+- (void) testConcurrentRecording {
+    BGM_IOHistogram theHistogram;
+    std::vector<std::thread> theThreads;
+
+    for(int i = 0; i < 4; i++)
+    {
+        theThreads.emplace_back([&theHistogram]() {
+            for(UInt64 j = 0; j < 100000; j++)
+            {
+                theHistogram.Record(j % 5000);
+            }
+        });
+    }
+
+    for(std::thread& theThread : theThreads)
+    {
+        theThread.join();
+    }
+
+    UInt64 theBucketTotal = 0;
+
+    for(UInt32 i = 0; i < BGM_IOHistogram::kNumBuckets; i++)
+    {
+        theBucketTotal += theHistogram.GetBucketCount(i);
+    }
+
+    XCTAssertEqual(theBucketTotal, 400000);
+    XCTAssertEqual(theHistogram.GetCount(), 400000);
+    XCTAssertEqual(theHistogram.GetMaxNanos(), 4999);
+}
+
+- (void) testOperationForIOOperationID {
+    XCTAssertEqual(BGM_IOProfiler::OperationForIOOperationID(kAudioServerPlugInIOOperationReadInput),
+                   BGM_IOProfiler::kReadInput);
+    XCTAssertEqual(BGM_IOProfiler::OperationForIOOperationID(kAudioServerPlugInIOOperationProcessOutput),
+                   BGM_IOProfiler::kProcessOutput);
+    XCTAssertEqual(BGM_IOProfiler::OperationForIOOperationID(kAudioServerPlugInIOOperationProcessMix),
+                   BGM_IOProfiler::kProcessMix);
+    XCTAssertEqual(BGM_IOProfiler::OperationForIOOperationID(kAudioServerPlugInIOOperationWriteMix),
+                   BGM_IOProfiler::kWriteMix);
+    XCTAssertEqual(BGM_IOProfiler::OperationForIOOperationID(kAudioServerPlugInIOOperationThread),
+                   BGM_IOProfiler::kNumOperations);
+}
+
+- (void) testProfile {
+    BGM_IOProfiler theProfiler;
+    CAMutex theMutex("BGM_IOProfilerTests");
+
+    {
+        BGM_IOProfiler::Scope theScope(theProfiler, BGM_IOProfiler::kProcessOutput);
+        BGM_IOProfiler::Locker theLocker(theMutex, theProfiler);
+    }
+
+    // Operations we don't time should be ignored.
+    {
+        BGM_IOProfiler::Scope theScope(theProfiler, BGM_IOProfiler::kNumOperations);
+    }
+
+    CACFDictionary theProfile(theProfiler.CopyProfile(), true);
+    bool isEnabled = !BGM_IOProfiler::kEnabled;
+
+    XCTAssert(theProfile.GetBool(CFSTR(kBGMIOProfileKey_Enabled), isEnabled));
+    XCTAssertEqual(isEnabled, BGM_IOProfiler::kEnabled);
+
+#if BGM_IO_PROFILING
+    XCTAssertEqual(theProfiler.GetHistogram(BGM_IOProfiler::kProcessOutput).GetCount(), 1);
+    XCTAssertEqual(theProfiler.GetHistogram(BGM_IOProfiler::kIOMutexWait).GetCount(), 1);
+    XCTAssertEqual(theProfiler.GetHistogram(BGM_IOProfiler::kWriteMix).GetCount(), 0);
+
+    CFDictionaryRef theOperationsRef = nullptr;
+    XCTAssert(theProfile.GetDictionary(CFSTR(kBGMIOProfileKey_Operations), theOperationsRef));
+    CACFDictionary theOperations(theOperationsRef, false);
+    XCTAssertEqual(theOperations.Size(), BGM_IOProfiler::kNumOperations);
+
+    CFDictionaryRef theProcessOutputRef = nullptr;
+    XCTAssert(theOperations.GetDictionary(CFSTR("ProcessOutput"), theProcessOutputRef));
+    CACFDictionary theProcessOutput(theProcessOutputRef, false);
+
+    UInt64 theCount = 0;
+    XCTAssert(theProcessOutput.GetUInt64(CFSTR(kBGMIOProfileKey_Count), theCount));
+    XCTAssertEqual(theCount, 1);
+
+    theProfiler.Reset();
+    XCTAssertEqual(theProfiler.GetHistogram(BGM_IOProfiler::kProcessOutput).GetCount(), 0);
+#else
+    XCTAssertFalse(theProfile.HasKey(CFSTR(kBGMIOProfileKey_Operations)));
+#endif
+}
+
+#pragma mark Performance
+
+// The time it takes to lock and unlock a mutex kBenchmarkIterations times, timing each one with the
+// profiler if inProfiled is true, or just with CAMutex::Locker otherwise.
+static UInt64 LockingNanos(BGM_IOProfiler& inProfiler, CAMutex& inMutex, bool inProfiled)
+{
+    const UInt64 theStartTime = mach_absolute_time();
+
+    for(UInt32 i = 0; i < kBenchmarkIterations; i++)
+    {
+        if(inProfiled)
+        {
+            BGM_IOProfiler::Scope theScope(inProfiler, BGM_IOProfiler::kProcessOutput);
+            BGM_IOProfiler::Locker theLocker(inMutex, inProfiler);
+        }
+        else
+        {
+            CAMutex::Locker theLocker(inMutex);
+        }
+    }
+
+    mach_timebase_info_data_t theTimebase;
+    mach_timebase_info(&theTimebase);
+
+    return (mach_absolute_time() - theStartTime) * theTimebase.numer / theTimebase.denom;
+}
+
+- (void) testDisabledProfilerHasNoOverhead {
+    if(BGM_IOProfiler::kEnabled)
+    {
+        return;
+    }
+
+    BGM_IOProfiler theProfiler;
+    CAMutex theMutex("BGM_IOProfilerTests");
+
+    // Take the fastest of several runs of each, to filter out noise from the rest of the system.
+    UInt64 theFastestProfiled = UINT64_MAX;
+    UInt64 theFastestUnprofiled = UINT64_MAX;
+
+    for(int i = 0; i < 20; i++)
+    {
+        theFastestProfiled = std::min(theFastestProfiled, LockingNanos(theProfiler, theMutex, true));
+        theFastestUnprofiled = std::min(theFastestUnprofiled, LockingNanos(theProfiler, theMutex, false));
+    }
+
+    NSLog(@"Locking with the disabled profiler: %.1f ns. Without: %.1f ns.",
+          static_cast<double>(theFastestProfiled) / kBenchmarkIterations,
+          static_cast<double>(theFastestUnprofiled) / kBenchmarkIterations);
+
+    // They should compile to the same code, so allow for a little noise but not much more.
+    XCTAssertLessThan(theFastestProfiled, theFastestUnprofiled * 1.2);
+}
+
+- (void) testPerformanceProfiledLocking {
+    BGM_IOProfiler* theProfiler = new BGM_IOProfiler;
+    CAMutex* theMutex = new CAMutex("BGM_IOProfilerTests");
+
+    [self measureBlock:^{
+        LockingNanos(*theProfiler, *theMutex, true);
+    }];
+
+    delete theMutex;
+    delete theProfiler;
+}
+
+- (void) testPerformanceUnprofiledLocking {
+    BGM_IOProfiler* theProfiler = new BGM_IOProfiler;
+    CAMutex* theMutex = new CAMutex("BGM_IOProfilerTests");
+
+    [self measureBlock:^{
+        LockingNanos(*theProfiler, *theMutex, false);
+    }];
+
+    delete theMutex;
+    delete theProfiler;
+}
+
+@end
+
@@ -0,0 +1,816 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOTraceTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Tests BGM_IOTraceRecorder together with BGMIOTraceReader, and replays traces through BGM_Device.
+//
+//  To replay a trace recorded with kAudioDeviceCustomPropertyIOTrace, run testReplayTraceFile with
+//  these environment variables set:
+//
+//      BGM_IO_TRACE_PATH       The trace file.
+//      BGM_IO_TRACE_REAL_TIME  1 to replay the trace at the speed it was recorded, rather than as
+//                              fast as possible.
+//
+//  It logs a hash of the device's output, which should be the same every time the trace is replayed
+//  unless the driver's audio processing changes, and how long each IO operation took.
+//
+
+// Unit Include
+#include "BGM_IOTraceRecorder.h"
+
+// Local Includes
+#include "BGM_Device.h"
+#include "BGM_TestUtils.h"
+#include "BGM_Types.h"
+#include "BGMIOTraceReader.h"
+
+// PublicUtility Includes
+#include "CACFArray.h"
+#include "CACFDictionary.h"
+#include "CACFString.h"
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+// System Includes
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// Subclass BGM_Device so the tests can create their own instances.
+class BGM_IOTraceTestDevice
+:
+    public BGM_Device
+{
+
+public:
+    BGM_IOTraceTestDevice()
+    :
+        BGM_Device(kObjectID_Device,
+                   CFSTR(kDeviceName),
+                   CFSTR(kBGMDeviceUID),
+                   CFSTR(kBGMDeviceModelUID),
+                   kObjectID_Stream_Input,
+                   kObjectID_Stream_Output,
+                   kObjectID_Volume_Output_Master,
+                   kObjectID_Mute_Output_Master)
+    {
+        Activate();
+    }
+
+};
+
+// Replays a trace through a BGM_Device, making the calls in the trace in the same order.
+class BGM_IOTraceReplayer
+{
+
+public:
+    struct OperationStats
+    {
+        UInt64                  mCount = 0;
+        UInt64                  mTotalNanos = 0;
+        UInt64                  mMaxNanos = 0;
+    };
+
+    struct Result
+    {
+        // The hash of the audio returned by each IO operation, in order.
+        UInt64                  mOutputHash = kBGMIOTraceHashInitialValue;
+        UInt64                  mRecordCount = 0;
+        // The calls that threw. The HAL would have got an error from them too, so this isn't
+        // necessarily a problem.
+        UInt64                  mFailedCallCount = 0;
+        BGMIOTraceReaderStatus  mStatus = kBGMIOTraceReader_OK;
+        std::map<UInt32, OperationStats> mOperations;
+    };
+
+    /*!
+     @param inRealTime True to wait until each record's time before replaying it. False to replay as
+                       fast as possible.
+     */
+    static Result               Replay(BGMIOTraceReader* inReader, BGM_Device& inDevice, bool inRealTime);
+
+private:
+    static void                 ReplayRecord(const BGMIOTraceRecordHeader& inHeader,
+                                             const void* inPayload,
+                                             UInt32 inChannelsPerFrame,
+                                             BGM_Device& inDevice,
+                                             Result& ioResult);
+    static void                 ReplayIOOperation(const BGMIOTraceIOOperationPayload& inOperation,
+                                                  UInt32 inChannelsPerFrame,
+                                                  BGM_Device& inDevice,
+                                                  Result& ioResult);
+
+};
+
+BGM_IOTraceReplayer::Result BGM_IOTraceReplayer::Replay(BGMIOTraceReader* inReader,
+                                                        BGM_Device& inDevice,
+                                                        bool inRealTime)
+{
+    Result theResult;
+    const UInt32 theChannelsPerFrame = BGMIOTraceReaderGetFileHeader(inReader)->mChannelsPerFrame;
+    const auto theStartTime = std::chrono::steady_clock::now();
+
+    BGMIOTraceReaderRewind(inReader);
+
+    const BGMIOTraceRecordHeader* theHeader;
+    const void* thePayload;
+
+    while((theResult.mStatus = BGMIOTraceReaderNext(inReader, &theHeader, &thePayload)) ==
+                  kBGMIOTraceReader_OK)
+    {
+        if(inRealTime)
+        {
+            std::this_thread::sleep_until(theStartTime + std::chrono::nanoseconds(theHeader->mNanos));
+        }
+
+        try
+        {
+            ReplayRecord(*theHeader, thePayload, theChannelsPerFrame, inDevice, theResult);
+        }
+        catch(...)
+        {
+            theResult.mFailedCallCount++;
+        }
+
+        theResult.mRecordCount++;
+    }
+
+    return theResult;
+}
+
+void    BGM_IOTraceReplayer::ReplayRecord(const BGMIOTraceRecordHeader& inHeader,
+                                          const void* inPayload,
+                                          UInt32 inChannelsPerFrame,
+                                          BGM_Device& inDevice,
+                                          Result& ioResult)
+{
+    switch(inHeader.mType)
+    {
+        case kBGMIOTraceRecord_AddClient:
+        case kBGMIOTraceRecord_RemoveClient:
+            {
+                const BGMIOTraceClientPayload* theClient =
+                        reinterpret_cast<const BGMIOTraceClientPayload*>(inPayload);
+                CACFString theBundleID(CFStringCreateWithBytes(kCFAllocatorDefault,
+                                                               reinterpret_cast<const UInt8*>(theClient + 1),
+                                                               theClient->mBundleIDLength,
+                                                               kCFStringEncodingUTF8,
+                                                               false));
+                AudioServerPlugInClientInfo theClientInfo = {
+                    theClient->mClientID,
+                    theClient->mProcessID,
+                    static_cast<Boolean>(theClient->mIsNativeEndian),
+                    theBundleID.GetCFString()
+                };
+
+                if(inHeader.mType == kBGMIOTraceRecord_AddClient)
+                {
+                    inDevice.AddClient(&theClientInfo);
+                }
+                else
+                {
+                    inDevice.RemoveClient(&theClientInfo);
+                }
+            }
+            break;
+
+        case kBGMIOTraceRecord_StartIO:
+            inDevice.StartIO(reinterpret_cast<const BGMIOTraceClientIOPayload*>(inPayload)->mClientID);
+            break;
+
+        case kBGMIOTraceRecord_StopIO:
+            inDevice.StopIO(reinterpret_cast<const BGMIOTraceClientIOPayload*>(inPayload)->mClientID);
+            break;
+
+        case kBGMIOTraceRecord_IOOperation:
+            ReplayIOOperation(*reinterpret_cast<const BGMIOTraceIOOperationPayload*>(inPayload),
+                              inChannelsPerFrame,
+                              inDevice,
+                              ioResult);
+            break;
+
+        case kBGMIOTraceRecord_SetProperty:
+            {
+                const BGMIOTraceSetPropertyPayload* theProperty =
+                        reinterpret_cast<const BGMIOTraceSetPropertyPayload*>(inPayload);
+                const AudioObjectPropertyAddress theAddress = {
+                    theProperty->mSelector,
+                    theProperty->mScope,
+                    theProperty->mElement
+                };
+
+                if(theProperty->mIsPropertyList)
+                {
+                    CFDataRef theData = CFDataCreate(kCFAllocatorDefault,
+                                                     reinterpret_cast<const UInt8*>(theProperty + 1),
+                                                     theProperty->mDataSize);
+                    CFPropertyListRef theValue = CFPropertyListCreateWithData(kCFAllocatorDefault,
+                                                                              theData,
+                                                                              kCFPropertyListImmutable,
+                                                                              nullptr,
+                                                                              nullptr);
+                    CFRelease(theData);
+
+                    ThrowIfNULL(theValue,
+                                CAException(kAudioHardwareIllegalOperationError),
+                                "BGM_IOTraceReplayer::ReplayRecord: Invalid property list");
+
+                    try
+                    {
+                        inDevice.SetPropertyData(theProperty->mObjectID,
+                                                 theProperty->mClientProcessID,
+                                                 theAddress,
+                                                 0,
+                                                 nullptr,
+                                                 sizeof(CFPropertyListRef),
+                                                 &theValue);
+                    }
+                    catch(...)
+                    {
+                        CFRelease(theValue);
+                        throw;
+                    }
+
+                    CFRelease(theValue);
+                }
+                else
+                {
+                    inDevice.SetPropertyData(theProperty->mObjectID,
+                                             theProperty->mClientProcessID,
+                                             theAddress,
+                                             0,
+                                             nullptr,
+                                             theProperty->mDataSize,
+                                             theProperty + 1);
+                }
+            }
+            break;
+
+        case kBGMIOTraceRecord_ConfigChange:
+            // The HAL would stop IO before this and start it again after, but BGM_Device doesn't
+            // depend on that.
+            inDevice.PerformConfigChange(
+                    reinterpret_cast<const BGMIOTraceConfigChangePayload*>(inPayload)->mChangeAction,
+                    nullptr);
+            break;
+
+        default:
+            // Skip records from newer versions of the driver.
+            break;
+    }
+}
+
+void    BGM_IOTraceReplayer::ReplayIOOperation(const BGMIOTraceIOOperationPayload& inOperation,
+                                               UInt32 inChannelsPerFrame,
+                                               BGM_Device& inDevice,
+                                               Result& ioResult)
+{
+    // Use the recorded audio if the trace has it and silence otherwise.
+    std::vector<Float32> theBuffer(static_cast<size_t>(inOperation.mIOBufferFrameSize) * inChannelsPerFrame, 0.0f);
+    memcpy(theBuffer.data(),
+           &inOperation + 1,
+           std::min<size_t>(inOperation.mBufferSize, theBuffer.size() * sizeof(Float32)));
+
+    AudioServerPlugInIOCycleInfo theCycleInfo {};
+    theCycleInfo.mInputTime.mSampleTime = inOperation.mInputSampleTime;
+    theCycleInfo.mOutputTime.mSampleTime = inOperation.mOutputSampleTime;
+
+    const AudioObjectID theStreamID = (inOperation.mOperationID == kAudioServerPlugInIOOperationReadInput) ?
+            kObjectID_Stream_Input : kObjectID_Stream_Output;
+
+    const auto theStartTime = std::chrono::steady_clock::now();
+
+    inDevice.DoIOOperation(theStreamID,
+                           inOperation.mClientID,
+                           inOperation.mOperationID,
+                           inOperation.mIOBufferFrameSize,
+                           theCycleInfo,
+                           theBuffer.data(),
+                           nullptr);
+
+    const UInt64 theNanos = static_cast<UInt64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - theStartTime).count());
+
+    OperationStats& theStats = ioResult.mOperations[inOperation.mOperationID];
+    theStats.mCount++;
+    theStats.mTotalNanos += theNanos;
+    theStats.mMaxNanos = std::max(theStats.mMaxNanos, theNanos);
+
+    ioResult.mOutputHash = BGMIOTraceHash(ioResult.mOutputHash,
+                                          theBuffer.data(),
+                                          theBuffer.size() * sizeof(Float32));
+}
+
+#pragma mark Helpers
+
+static const UInt32 kTestFrameSize = 512;
+static const UInt32 kTestClientID = 7;
+static const pid_t kTestClientPID = 1234;
+#define kTestClientBundleID "com.example.player"
+
+static void SetIOTraceSettings(BGM_Device& inDevice, const CACFDictionary& inSettings)
+{
+    CFDictionaryRef theSettingsRef = inSettings.GetCFDictionary();
+    inDevice.SetPropertyData(kObjectID_Device,
+                             0,
+                             kBGMIOTraceAddress,
+                             0,
+                             nullptr,
+                             sizeof(CFDictionaryRef),
+                             &theSettingsRef);
+}
+
+static CACFDictionary CopyIOTraceSettings(BGM_Device& inDevice)
+{
+    CFDictionaryRef theSettingsRef = nullptr;
+    UInt32 theSize = 0;
+    inDevice.GetPropertyData(kObjectID_Device,
+                             0,
+                             kBGMIOTraceAddress,
+                             0,
+                             nullptr,
+                             sizeof(CFDictionaryRef),
+                             theSize,
+                             &theSettingsRef);
+    return CACFDictionary(theSettingsRef, true);
+}
+
+static void SetAppVolume(BGM_Device& inDevice, SInt32 inRelativeVolume, SInt32 inPanPosition)
+{
+    CACFDictionary theAppVolume(true);
+    theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_ProcessID), kTestClientPID);
+    theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_RelativeVolume), inRelativeVolume);
+    theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_PanPosition), inPanPosition);
+
+    CACFArray theAppVolumes(true);
+    theAppVolumes.AppendDictionary(theAppVolume.GetCFDictionary());
+
+    CFArrayRef theAppVolumesRef = theAppVolumes.GetCFArray();
+    inDevice.SetPropertyData(kObjectID_Device,
+                             0,
+                             kBGMAppVolumesAddress,
+                             0,
+                             nullptr,
+                             sizeof(CFArrayRef),
+                             &theAppVolumesRef);
+}
+
+// Run one IO cycle like the HAL would for a single client: the client's audio, the mix and then
+// reading the loopback audio back. Returns the hash of the audio the device returned, chained onto
+// inHash.
+static UInt64 RunIOCycle(BGM_Device& inDevice, UInt64 inCycle, UInt64 inHash)
+{
+    std::vector<Float32> theBuffer(kTestFrameSize * 2);
+    AudioServerPlugInIOCycleInfo theCycleInfo {};
+    theCycleInfo.mOutputTime.mSampleTime = static_cast<Float64>(inCycle * kTestFrameSize);
+    theCycleInfo.mInputTime.mSampleTime = theCycleInfo.mOutputTime.mSampleTime;
+
+    for(UInt32 i = 0; i < kTestFrameSize; i++)
+    {
+        const Float64 theTime = static_cast<Float64>((inCycle * kTestFrameSize) + i) / 44100.0;
+        theBuffer[i * 2] = static_cast<Float32>(0.5 * sin(2.0 * M_PI * 440.0 * theTime));
+        theBuffer[(i * 2) + 1] = static_cast<Float32>(0.25 * sin(2.0 * M_PI * 660.0 * theTime));
+    }
+
+    for(UInt32 theOperationID : { kAudioServerPlugInIOOperationProcessOutput,
+                                  kAudioServerPlugInIOOperationWriteMix,
+                                  kAudioServerPlugInIOOperationReadInput })
+    {
+        if(theOperationID == kAudioServerPlugInIOOperationReadInput)
+        {
+            std::fill(theBuffer.begin(), theBuffer.end(), 0.0f);
+        }
+
+        inDevice.DoIOOperation(theOperationID == kAudioServerPlugInIOOperationReadInput ?
+                                       kObjectID_Stream_Input : kObjectID_Stream_Output,
+                               kTestClientID,
+                               theOperationID,
+                               kTestFrameSize,
+                               theCycleInfo,
+                               theBuffer.data(),
+                               nullptr);
+
+        inHash = BGMIOTraceHash(inHash, theBuffer.data(), theBuffer.size() * sizeof(Float32));
+    }
+
+    return inHash;
+}
+
+@interface BGM_IOTraceTests : XCTestCase {
+    // The traces the test wrote, which are removed after it.
+    std::vector<std::string> tracePaths;
+}
+
+@end
+
+@implementation BGM_IOTraceTests
+
+- (void) tearDown {
+    for(const std::string& thePath : tracePaths)
+    {
+        unlink(thePath.c_str());
+    }
+
+    [super tearDown];
+}
+
+- (void) testRecordAndRead {
+    AudioServerPlugInClientInfo theClientInfo = {
+        kTestClientID,
+        kTestClientPID,
+        true,
+        CFSTR(kTestClientBundleID)
+    };
+
+    AudioServerPlugInIOCycleInfo theCycleInfo {};
+    theCycleInfo.mInputTime.mSampleTime = 100.0;
+    theCycleInfo.mOutputTime.mSampleTime = 612.0;
+
+    Float32 theAudio[16 * BGM_IOTraceRecorder::kChannelsPerFrame];
+
+    for(UInt32 i = 0; i < 16 * BGM_IOTraceRecorder::kChannelsPerFrame; i++)
+    {
+        theAudio[i] = static_cast<Float32>(i) / 32.0f;
+    }
+
+    const Float64 theSampleRate = 48000.0;
+
+    BGM_IOTraceRecorder theRecorder(1024 * 1024, true, 44100.0);
+    theRecorder.RecordAddClient(theClientInfo);
+    theRecorder.RecordStartIO(kTestClientID);
+    theRecorder.RecordIOOperationRT(kAudioServerPlugInIOOperationProcessOutput,
+                                    kTestClientID,
+                                    16,
+                                    theCycleInfo,
+                                    theAudio);
+    theRecorder.RecordIOOperationRT(kAudioServerPlugInIOOperationReadInput,
+                                    kTestClientID,
+                                    16,
+                                    theCycleInfo,
+                                    theAudio);
+    theRecorder.RecordSetProperty(kObjectID_Device,
+                                  { kAudioDevicePropertyNominalSampleRate,
+                                    kAudioObjectPropertyScopeGlobal,
+                                    kAudioObjectPropertyElementMaster },
+                                  kTestClientPID,
+                                  false,
+                                  sizeof(Float64),
+                                  &theSampleRate);
+    theRecorder.RecordConfigChange(3);
+    theRecorder.RecordStopIO(kTestClientID);
+    theRecorder.RecordRemoveClient(theClientInfo);
+
+    XCTAssertEqual(theRecorder.GetDroppedRecords(), 0);
+
+    std::vector<UInt8> theTrace = theRecorder.CopyTrace();
+    XCTAssertEqual(theTrace.size(), theRecorder.GetUsedBytes());
+    XCTAssertEqual(theTrace.size() % kBGMIOTraceRecordAlignment, 0);
+
+    BGMIOTraceReader* theReader = BGMIOTraceReaderOpenData(theTrace.data(), theTrace.size());
+    XCTAssert(theReader != nullptr);
+
+    const BGMIOTraceFileHeader* theFileHeader = BGMIOTraceReaderGetFileHeader(theReader);
+    XCTAssertEqual(theFileHeader->mSampleRate, 44100.0);
+    XCTAssertEqual(theFileHeader->mChannelsPerFrame, BGM_IOTraceRecorder::kChannelsPerFrame);
+    XCTAssertEqual(theFileHeader->mFlags, kBGMIOTraceFlag_IncludesBuffers);
+
+    const BGMIOTraceRecordHeader* theHeader;
+    const void* thePayload;
+    std::vector<UInt32> theTypes;
+    UInt64 theLastNanos = 0;
+
+    while(BGMIOTraceReaderNext(theReader, &theHeader, &thePayload) == kBGMIOTraceReader_OK)
+    {
+        theTypes.push_back(theHeader->mType);
+
+        // The times should never go backwards.
+        XCTAssertGreaterThanOrEqual(theHeader->mNanos, theLastNanos);
+        theLastNanos = theHeader->mNanos;
+
+        if(theHeader->mType == kBGMIOTraceRecord_AddClient)
+        {
+            const BGMIOTraceClientPayload* theClient =
+                    reinterpret_cast<const BGMIOTraceClientPayload*>(thePayload);
+            XCTAssertEqual(theClient->mClientID, kTestClientID);
+            XCTAssertEqual(theClient->mProcessID, kTestClientPID);
+            XCTAssertEqual(std::string(reinterpret_cast<const char*>(theClient + 1),
+                                       theClient->mBundleIDLength),
+                           std::string(kTestClientBundleID));
+        }
+        else if(theHeader->mType == kBGMIOTraceRecord_IOOperation)
+        {
+            const BGMIOTraceIOOperationPayload* theOperation =
+                    reinterpret_cast<const BGMIOTraceIOOperationPayload*>(thePayload);
+            XCTAssertEqual(theOperation->mIOBufferFrameSize, 16);
+            XCTAssertEqual(theOperation->mInputSampleTime, 100.0);
+            XCTAssertEqual(theOperation->mOutputSampleTime, 612.0);
+
+            if(theOperation->mOperationID == kAudioServerPlugInIOOperationProcessOutput)
+            {
+                XCTAssertEqual(theOperation->mBufferSize, sizeof(theAudio));
+                XCTAssertEqual(memcmp(theOperation + 1, theAudio, sizeof(theAudio)), 0);
+            }
+            else
+            {
+                // ReadInput doesn't pass any audio to the driver.
+                XCTAssertEqual(theOperation->mBufferSize, 0);
+            }
+        }
+        else if(theHeader->mType == kBGMIOTraceRecord_SetProperty)
+        {
+            const BGMIOTraceSetPropertyPayload* theProperty =
+                    reinterpret_cast<const BGMIOTraceSetPropertyPayload*>(thePayload);
+            XCTAssertEqual(theProperty->mSelector, kAudioDevicePropertyNominalSampleRate);
+            XCTAssertEqual(theProperty->mDataSize, sizeof(Float64));
+            XCTAssertEqual(*reinterpret_cast<const Float64*>(theProperty + 1), 48000.0);
+        }
+        else if(theHeader->mType == kBGMIOTraceRecord_ConfigChange)
+        {
+            XCTAssertEqual(reinterpret_cast<const BGMIOTraceConfigChangePayload*>(thePayload)->mChangeAction, 3);
+        }
+    }
+
+    const std::vector<UInt32> theExpectedTypes = {
+        kBGMIOTraceRecord_AddClient,
+        kBGMIOTraceRecord_StartIO,
+        kBGMIOTraceRecord_IOOperation,
+        kBGMIOTraceRecord_IOOperation,
+        kBGMIOTraceRecord_SetProperty,
+        kBGMIOTraceRecord_ConfigChange,
+        kBGMIOTraceRecord_StopIO,
+        kBGMIOTraceRecord_RemoveClient
+    };
+    XCTAssert(theTypes == theExpectedTypes);
+
+    BGMIOTraceReaderClose(theReader);
+
+    // A trace cut off part way through a record is reported as truncated.
+    theReader = BGMIOTraceReaderOpenData(theTrace.data(), theTrace.size() - 12);
+    XCTAssert(theReader != nullptr);
+
+    BGMIOTraceReaderStatus theStatus;
+
+    while((theStatus = BGMIOTraceReaderNext(theReader, &theHeader, &thePayload)) == kBGMIOTraceReader_OK)
+    {
+    }
+
+    XCTAssertEqual(theStatus, kBGMIOTraceReader_Truncated);
+    BGMIOTraceReaderClose(theReader);
+
+    // Data that isn't a trace is rejected.
+    UInt8 theNotATrace[64] = { 0 };
+    XCTAssert(BGMIOTraceReaderOpenData(theNotATrace, sizeof(theNotATrace)) == nullptr);
+}
+
+- (void) testDropsRecordsWhenFull {
+    AudioServerPlugInIOCycleInfo theCycleInfo {};
+    std::vector<Float32> theAudio(kTestFrameSize * BGM_IOTraceRecorder::kChannelsPerFrame);
+
+    // Room for the header and one IO operation with its audio.
+    const size_t theCapacity = sizeof(BGMIOTraceFileHeader) + sizeof(BGMIOTraceRecordHeader) +
+            sizeof(BGMIOTraceIOOperationPayload) + (theAudio.size() * sizeof(Float32));
+    BGM_IOTraceRecorder theRecorder(theCapacity, true, 44100.0);
+
+    for(int i = 0; i < 3; i++)
+    {
+        theRecorder.RecordIOOperationRT(kAudioServerPlugInIOOperationProcessOutput,
+                                        kTestClientID,
+                                        kTestFrameSize,
+                                        theCycleInfo,
+                                        theAudio.data());
+    }
+
+    XCTAssertEqual(theRecorder.GetUsedBytes(), theCapacity);
+    XCTAssertEqual(theRecorder.GetDroppedRecords(), 2);
+
+    // A recorder too small for the file header can't be created.
+    BGMShouldThrow<CAException>(self, [&]() {
+        BGM_IOTraceRecorder theTooSmallRecorder(sizeof(BGMIOTraceFileHeader) - 1, false, 44100.0);
+    });
+}
+
+- (void) testWritesNewPrivateFiles {
+    BGM_IOTraceRecorder theRecorder(64 * 1024, false, 44100.0);
+    theRecorder.RecordStartIO(kTestClientID);
+    const std::vector<UInt8> theTrace = theRecorder.CopyTrace();
+
+    const std::string theDirectory = BGM_IOTraceRecorder::GetDefaultDirectory();
+
+    // Only the owner can use the directory or read the traces.
+    struct stat theInfo;
+    XCTAssertEqual(lstat(theDirectory.c_str(), &theInfo), 0);
+    XCTAssert(S_ISDIR(theInfo.st_mode));
+    XCTAssertEqual(theInfo.st_mode & (S_IRWXG | S_IRWXO), 0);
+
+    // Writing twice in the same second gives two files, rather than replacing the first.
+    const std::string theFirstPath = theRecorder.WriteToNewFile(theDirectory, "BGM_IOTraceTests");
+    tracePaths.push_back(theFirstPath);
+    const std::string theSecondPath = theRecorder.WriteToNewFile(theDirectory, "BGM_IOTraceTests");
+    tracePaths.push_back(theSecondPath);
+
+    XCTAssert(theFirstPath != theSecondPath);
+
+    for(const std::string& thePath : tracePaths)
+    {
+        XCTAssertEqual(thePath.compare(0, theDirectory.size(), theDirectory), 0);
+        XCTAssertEqual(lstat(thePath.c_str(), &theInfo), 0);
+        XCTAssert(S_ISREG(theInfo.st_mode));
+        XCTAssertEqual(theInfo.st_mode & (S_IRWXG | S_IRWXO), 0);
+        XCTAssertEqual(static_cast<size_t>(theInfo.st_size), theTrace.size());
+    }
+}
+
+- (void) testDeviceRecordsAndReplays {
+    // Record a client playing audio through a device and then replay the trace through a new
+    // device. The new device's output should be exactly the same.
+    UInt64 theRecordedHash = kBGMIOTraceHashInitialValue;
+    const UInt64 kCycles = 64;
+
+    {
+        BGM_IOTraceTestDevice theDevice;
+
+        // The trace's buffer is allocated in coreaudiod, so its size is limited.
+        CACFDictionary theTooLargeSettings(true);
+        theTooLargeSettings.AddBool(CFSTR(kBGMIOTraceKey_Enabled), true);
+        theTooLargeSettings.AddUInt64(CFSTR(kBGMIOTraceKey_CapacityBytes),
+                                      BGM_IOTraceRecorder::kMaxCapacityBytes + 1);
+        BGMShouldThrow<CAException>(self, [&]() { SetIOTraceSettings(theDevice, theTooLargeSettings); });
+
+        AudioServerPlugInClientInfo theClientInfo = {
+            kTestClientID,
+            kTestClientPID,
+            true,
+            CFSTR(kTestClientBundleID)
+        };
+
+        // Add the client before recording starts so it has to be recorded with the device's
+        // initial state.
+        theDevice.AddClient(&theClientInfo);
+
+        // Clients can't choose where the trace is written, so the path should be ignored.
+        const std::string theIgnoredPath = std::string(NSTemporaryDirectory().UTF8String) +
+                "BGM_IOTraceTests." + std::to_string(getpid()) + ".bgmtrace";
+        tracePaths.push_back(theIgnoredPath);
+        CACFString theIgnoredPathString(theIgnoredPath.c_str(), kCFStringEncodingUTF8);
+
+        CACFDictionary theStartSettings(true);
+        theStartSettings.AddBool(CFSTR(kBGMIOTraceKey_Enabled), true);
+        theStartSettings.AddString(CFSTR(kBGMIOTraceKey_Path), theIgnoredPathString.GetCFString());
+        theStartSettings.AddBool(CFSTR(kBGMIOTraceKey_IncludeBuffers), true);
+        SetIOTraceSettings(theDevice, theStartSettings);
+
+        XCTAssert(CopyIOTraceSettings(theDevice).GetCFDictionary() != nullptr);
+
+        theDevice.StartIO(kTestClientID);
+
+        for(UInt64 theCycle = 0; theCycle < kCycles; theCycle++)
+        {
+            // Change the client's volume and pan part way through.
+            if(theCycle == kCycles / 2)
+            {
+                SetAppVolume(theDevice, 25, -50);
+            }
+
+            theRecordedHash = RunIOCycle(theDevice, theCycle, theRecordedHash);
+        }
+
+        theDevice.StopIO(kTestClientID);
+
+        CACFDictionary theSettings = CopyIOTraceSettings(theDevice);
+        bool theEnabled = false;
+        UInt64 theUsedBytes = 0;
+        UInt64 theDroppedRecords = 1;
+        XCTAssert(theSettings.GetBool(CFSTR(kBGMIOTraceKey_Enabled), theEnabled) && theEnabled);
+        XCTAssert(theSettings.GetUInt64(CFSTR(kBGMIOTraceKey_UsedBytes), theUsedBytes));
+        XCTAssert(theSettings.GetUInt64(CFSTR(kBGMIOTraceKey_DroppedRecords), theDroppedRecords));
+        XCTAssertGreaterThan(theUsedBytes, kCycles * kTestFrameSize * 2 * sizeof(Float32));
+        XCTAssertEqual(theDroppedRecords, 0);
+
+        // Stop recording, which writes the file.
+        CACFDictionary theStopSettings(true);
+        theStopSettings.AddBool(CFSTR(kBGMIOTraceKey_Enabled), false);
+        SetIOTraceSettings(theDevice, theStopSettings);
+
+        // The property gives the path the driver chose.
+        CACFDictionary theStoppedSettings = CopyIOTraceSettings(theDevice);
+        CFStringRef theWrittenPathRef = nullptr;
+        XCTAssert(theStoppedSettings.GetString(CFSTR(kBGMIOTraceKey_Path), theWrittenPathRef));
+        XCTAssert(theWrittenPathRef != nullptr);
+
+        if(theWrittenPathRef != nullptr)
+        {
+            char theWrittenPath[PATH_MAX];
+            XCTAssert(CFStringGetFileSystemRepresentation(theWrittenPathRef, theWrittenPath, sizeof(theWrittenPath)));
+            tracePaths.push_back(theWrittenPath);
+        }
+
+        XCTAssertNotEqual(access(theIgnoredPath.c_str(), F_OK), 0);
+    }
+
+    XCTAssertEqual(tracePaths.size(), 2);
+    BGMIOTraceReader* theReader = (tracePaths.size() == 2) ? BGMIOTraceReaderOpen(tracePaths[1].c_str()) : nullptr;
+    XCTAssert(theReader != nullptr);
+
+    if(theReader != nullptr)
+    {
+        BGM_IOTraceTestDevice theReplayDevice;
+        BGM_IOTraceReplayer::Result theResult =
+                BGM_IOTraceReplayer::Replay(theReader, theReplayDevice, false);
+
+        XCTAssertEqual(theResult.mStatus, kBGMIOTraceReader_End);
+        XCTAssertEqual(theResult.mFailedCallCount, 0);
+        XCTAssertEqual(theResult.mOperations[kAudioServerPlugInIOOperationProcessOutput].mCount, kCycles);
+        XCTAssertEqual(theResult.mOutputHash, theRecordedHash);
+
+        // Replaying again on another new device gives the same output, so the hash can be used to
+        // check for changes in the driver's processing.
+        BGM_IOTraceTestDevice theSecondReplayDevice;
+        XCTAssertEqual(BGM_IOTraceReplayer::Replay(theReader, theSecondReplayDevice, false).mOutputHash,
+                       theRecordedHash);
+
+        BGMIOTraceReaderClose(theReader);
+    }
+}
+
+- (void) testReplayTraceFile {
+    const char* thePath = getenv("BGM_IO_TRACE_PATH");
+
+    if(thePath == nullptr)
+    {
+        // Nothing to replay. See the comment at the top of this file.
+        return;
+    }
+
+    const char* theRealTimeValue = getenv("BGM_IO_TRACE_REAL_TIME");
+    const bool theRealTime = (theRealTimeValue != nullptr && atoi(theRealTimeValue) != 0);
+
+    BGMIOTraceReader* theReader = BGMIOTraceReaderOpen(thePath);
+    XCTAssert(theReader != nullptr, "Couldn't read %s", thePath);
+
+    if(theReader == nullptr)
+    {
+        return;
+    }
+
+    BGM_IOTraceTestDevice theDevice;
+    const auto theStartTime = std::chrono::steady_clock::now();
+    BGM_IOTraceReplayer::Result theResult = BGM_IOTraceReplayer::Replay(theReader, theDevice, theRealTime);
+    const auto theReplayMillis = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - theStartTime).count();
+
+    NSLog(@"Replayed %llu records from %s in %lld ms (%s). %llu calls failed. Output hash: %016llx",
+          theResult.mRecordCount,
+          thePath,
+          static_cast<long long>(theReplayMillis),
+          theRealTime ? "real time" : "full speed",
+          theResult.mFailedCallCount,
+          theResult.mOutputHash);
+
+    for(const auto& theOperation : theResult.mOperations)
+    {
+        const UInt32 theID = theOperation.first;
+        const BGM_IOTraceReplayer::OperationStats& theStats = theOperation.second;
+
+        NSLog(@"'%c%c%c%c': %llu operations, mean %.1f us, max %.1f us",
+              static_cast<char>(theID >> 24),
+              static_cast<char>(theID >> 16),
+              static_cast<char>(theID >> 8),
+              static_cast<char>(theID),
+              theStats.mCount,
+              theStats.mCount > 0 ? (static_cast<Float64>(theStats.mTotalNanos) / theStats.mCount / 1000.0) : 0.0,
+              static_cast<Float64>(theStats.mMaxNanos) / 1000.0);
+    }
+
+    XCTAssertEqual(theResult.mStatus, kBGMIOTraceReader_End);
+
+    BGMIOTraceReaderClose(theReader);
+}
+
+@end
+
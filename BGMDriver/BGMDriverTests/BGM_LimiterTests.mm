@@ -0,0 +1,297 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_LimiterTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#include "BGM_Limiter.h"
+
+// Local Includes
+#include "BGM_TestUtils.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+static const UInt32 kTestCycleFrames = 512;
+
+@interface BGM_LimiterTests : XCTestCase
+
+@end
+
+@implementation BGM_LimiterTests
+
+// Returns a stereo sine wave with the same signal in both channels.
+static std::vector<Float32> Sine(Float64 inFrequency, Float64 inAmplitude, Float64 inSampleRate, UInt32 inFrameCount)
+{
+    std::vector<Float32> theFrames(inFrameCount * 2);
+
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        theFrames[i * 2] = theFrames[(i * 2) + 1] =
+                static_cast<Float32>(inAmplitude * sin(2.0 * M_PI * inFrequency * i / inSampleRate));
+    }
+
+    return theFrames;
+}
+
+// Runs the frames through the limiter in IO-cycle-sized buffers.
+static void Process(BGM_Limiter& inLimiter, std::vector<Float32>& ioFrames, UInt32 inCycleFrames = kTestCycleFrames)
+{
+    const UInt32 theFrameCount = static_cast<UInt32>(ioFrames.size() / 2);
+
+    for(UInt32 i = 0; i < theFrameCount; i += inCycleFrames)
+    {
+        inLimiter.ProcessRT(ioFrames.data() + (i * 2), std::min(inCycleFrames, theFrameCount - i));
+    }
+}
+
+static Float32 Peak(const std::vector<Float32>& inFrames)
+{
+    Float32 thePeak = 0.0f;
+
+    for(Float32 theSample : inFrames)
+    {
+        thePeak = std::max(thePeak, std::fabs(theSample));
+    }
+
+    return thePeak;
+}
+
+// The total harmonic distortion of the left channel of the last inFrameCount frames, as a ratio of
+// the fundamental. inFrameCount should be a whole number of periods of the fundamental.
+static Float64 THD(const std::vector<Float32>& inFrames,
+                   Float64 inFundamental,
+                   Float64 inSampleRate,
+                   UInt32 inFrameCount)
+{
+    const size_t theStart = (inFrames.size() / 2) - inFrameCount;
+
+    // The magnitude of one frequency, using a Hann window.
+    auto theMagnitude = [&](Float64 inFrequency) {
+        Float64 theReal = 0.0;
+        Float64 theImaginary = 0.0;
+
+        for(UInt32 i = 0; i < inFrameCount; i++)
+        {
+            const Float64 theWindow = 0.5 - (0.5 * cos(2.0 * M_PI * i / inFrameCount));
+            const Float64 theSample = theWindow * inFrames[(theStart + i) * 2];
+            const Float64 thePhase = 2.0 * M_PI * inFrequency * i / inSampleRate;
+
+            theReal += theSample * cos(thePhase);
+            theImaginary += theSample * sin(thePhase);
+        }
+
+        return sqrt((theReal * theReal) + (theImaginary * theImaginary));
+    };
+
+    Float64 theHarmonicPower = 0.0;
+
+    for(UInt32 theHarmonic = 2; theHarmonic <= 10 && theHarmonic * inFundamental < inSampleRate / 2; theHarmonic++)
+    {
+        const Float64 theHarmonicMagnitude = theMagnitude(theHarmonic * inFundamental);
+        theHarmonicPower += theHarmonicMagnitude * theHarmonicMagnitude;
+    }
+
+    return sqrt(theHarmonicPower) / theMagnitude(inFundamental);
+}
+
+- (void) testLatency {
+    XCTAssertEqual(BGM_Limiter(44100.0).GetLatencyFrames(), 88);
+    XCTAssertEqual(BGM_Limiter(48000.0).GetLatencyFrames(), 96);
+    XCTAssertEqual(BGM_Limiter(192000.0).GetLatencyFrames(), 384);
+    XCTAssertEqual(BGM_Limiter(100.0).GetLatencyFrames(), 0);
+    XCTAssertEqual(BGM_Limiter(10000000.0).GetLatencyFrames(), BGM_Limiter::kMaxLookAheadFrames);
+
+    BGM_Limiter theLimiter(44100.0);
+    theLimiter.SetSampleRate(96000.0);
+    XCTAssertEqual(theLimiter.GetLatencyFrames(), 192);
+}
+
+- (void) testInvalidArguments {
+    BGMShouldThrow<CAException>(self, [](){ BGM_Limiter theLimiter(0.0); });
+    BGMShouldThrow<CAException>(self, [](){ BGM_Limiter theLimiter(44100.0, 0.0f); });
+    BGMShouldThrow<CAException>(self, [](){ BGM_Limiter theLimiter(44100.0, -1.0f); });
+    BGMShouldThrow<CAException>(self, [](){ BGM_Limiter theLimiter(44100.0, NAN); });
+}
+
+- (void) testQuietAudioIsOnlyDelayed {
+    BGM_Limiter theLimiter(48000.0);
+    const UInt32 theLatency = theLimiter.GetLatencyFrames();
+
+    std::vector<Float32> theInput = Sine(440.0, 0.99, 48000.0, 48000);
+    std::vector<Float32> theOutput = theInput;
+
+    // Use a buffer size that isn't a multiple of the limiter's block size.
+    Process(theLimiter, theOutput, 333);
+
+    for(UInt32 i = 0; i < theLatency * 2; i++)
+    {
+        XCTAssertEqual(theOutput[i], 0.0f);
+    }
+
+    for(UInt32 i = theLatency * 2; i < theOutput.size(); i++)
+    {
+        XCTAssertEqual(theOutput[i], theInput[i - (theLatency * 2)]);
+    }
+}
+
+- (void) testPeaksNeverExceedCeiling {
+    for(Float32 theCeiling : { 1.0f, 0.5f })
+    {
+        BGM_Limiter theLimiter(44100.0, theCeiling);
+
+        // Loud noise with occasional much louder spikes, processed in buffers of random sizes.
+        std::mt19937 theGenerator(1);
+        std::uniform_real_distribution<Float32> theNoise(-4.0f, 4.0f);
+        std::uniform_int_distribution<UInt32> theBufferSize(1, 4096);
+
+        std::vector<Float32> theFrames(44100 * 2 * 5);
+
+        for(size_t i = 0; i < theFrames.size(); i++)
+        {
+            theFrames[i] = theNoise(theGenerator) * ((i % 10007 == 0) ? 10.0f : 1.0f);
+        }
+
+        for(UInt32 i = 0; i < theFrames.size() / 2; )
+        {
+            const UInt32 theFrameCount = std::min(theBufferSize(theGenerator),
+                                                  static_cast<UInt32>(theFrames.size() / 2) - i);
+            theLimiter.ProcessRT(theFrames.data() + (i * 2), theFrameCount);
+            i += theFrameCount;
+        }
+
+        XCTAssertLessThanOrEqual(Peak(theFrames), theCeiling);
+    }
+}
+
+- (void) testImpulse {
+    BGM_Limiter theLimiter(48000.0);
+    const UInt32 theLatency = theLimiter.GetLatencyFrames();
+
+    std::vector<Float32> theFrames(48000 * 2, 0.1f);
+    theFrames[1000 * 2] = 3.0f;
+    Process(theLimiter, theFrames);
+
+    // The impulse should come out at full scale (not clipped or turned down too far), delayed by the
+    // latency, and the gain should be turned down smoothly before it rather than all at once.
+    XCTAssertEqualWithAccuracy(theFrames[(1000 + theLatency) * 2], 1.0f, 0.0001f);
+    XCTAssertLessThanOrEqual(Peak(theFrames), 1.0f);
+
+    for(UInt32 i = theLatency + 1; i < 1000 + theLatency; i++)
+    {
+        XCTAssertLessThanOrEqual(theFrames[i * 2], theFrames[(i - 1) * 2]);
+        XCTAssertLessThan(theFrames[(i - 1) * 2] - theFrames[i * 2], 0.01f);
+    }
+
+    // The gain should recover afterwards.
+    XCTAssertEqualWithAccuracy(theFrames.back(), 0.1f, 0.001f);
+}
+
+- (void) testBoostedSineHasLowDistortion {
+    const Float64 theSampleRate = 48000.0;
+
+    // Boost the sine by 12 dB, like an app at 400% volume.
+    for(Float64 theFrequency : { 100.0, 1000.0, 4000.0 })
+    {
+        std::vector<Float32> theLimited = Sine(theFrequency, 4.0, theSampleRate, 96000);
+        std::vector<Float32> theClipped = theLimited;
+
+        BGM_Limiter theLimiter(theSampleRate);
+        Process(theLimiter, theLimited);
+
+        for(Float32& theSample : theClipped)
+        {
+            theSample = std::min(1.0f, std::max(-1.0f, theSample));
+        }
+
+        // Measure the last half second, after the limiter has settled. It has to be a whole number
+        // of periods.
+        const UInt32 theFrameCount = 24000;
+
+        const Float64 theLimitedTHD = THD(theLimited, theFrequency, theSampleRate, theFrameCount);
+        const Float64 theClippedTHD = THD(theClipped, theFrequency, theSampleRate, theFrameCount);
+
+        XCTAssertLessThanOrEqual(Peak(theLimited), 1.0f);
+        XCTAssertGreaterThan(Peak(theLimited), 0.99f);
+
+        // Low frequencies are distorted a little because their periods are longer than the
+        // look-ahead, but it's still far better than clipping.
+        XCTAssertLessThan(theLimitedTHD, (theFrequency < 1000.0) ? 0.01 : 0.001);
+        XCTAssertGreaterThan(theClippedTHD, 0.1);
+    }
+}
+
+- (void) testReset {
+    BGM_Limiter theLimiter(48000.0);
+
+    std::vector<Float32> theFrames = Sine(1000.0, 4.0, 48000.0, kTestCycleFrames);
+    Process(theLimiter, theFrames);
+
+    theLimiter.Reset();
+
+    // The audio from before the reset should be gone and the gain should be back to unity.
+    std::vector<Float32> theQuietFrames(kTestCycleFrames * 2, 0.5f);
+    Process(theLimiter, theQuietFrames);
+
+    for(UInt32 i = 0; i < theLimiter.GetLatencyFrames() * 2; i++)
+    {
+        XCTAssertEqual(theQuietFrames[i], 0.0f);
+    }
+
+    XCTAssertEqual(theQuietFrames.back(), 0.5f);
+}
+
+#pragma mark Performance
+
+// Measures the cost of limiting one IO buffer.
+- (void) measureCyclesWithAmplitude:(Float64)amplitude {
+    BGM_Limiter* theLimiter = new BGM_Limiter(48000.0);
+    std::vector<Float32> theFrames = Sine(1000.0, amplitude, 48000.0, kTestCycleFrames);
+    std::vector<Float32> theBuffer(theFrames.size());
+    Float32* theBufferData = theBuffer.data();
+
+    [self measureBlock:^{
+        for(UInt32 theCycle = 0; theCycle < 10000; theCycle++)
+        {
+            std::copy(theFrames.begin(), theFrames.end(), theBufferData);
+            theLimiter->ProcessRT(theBufferData, kTestCycleFrames);
+        }
+    }];
+
+    delete theLimiter;
+}
+
+- (void) testPerformanceUnderCeiling {
+    [self measureCyclesWithAmplitude:0.5];
+}
+
+- (void) testPerformanceOverCeiling {
+    [self measureCyclesWithAmplitude:4.0];
+}
+
+@end
+
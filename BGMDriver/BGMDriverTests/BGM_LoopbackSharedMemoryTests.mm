@@ -0,0 +1,324 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_LoopbackSharedMemoryTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Tests BGM_LoopbackSharedMemory (the writer) together with BGMLoopbackReader.
+//
+
+// Unit Include
+#include "BGM_LoopbackSharedMemory.h"
+
+// Local Includes
+#include "BGM_TestUtils.h"
+#include "BGMLoopbackReader.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// System Includes
+#include <fcntl.h>
+#include <grp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+static const UInt32 kTestChannels = 2;
+static const UInt32 kTestCapacityFrames = 1024;
+static const UInt32 kTestCycleFrames = 256;
+
+@interface BGM_LoopbackSharedMemoryTests : XCTestCase {
+    // Use a name specific to this process so the tests never touch the real driver's segments.
+    std::string segmentName;
+    BGM_LoopbackSharedMemory* writer;
+    BGMLoopbackReader* reader;
+}
+
+@end
+
+@implementation BGM_LoopbackSharedMemoryTests
+
+- (void) setUp {
+    [super setUp];
+
+    segmentName = "/BGMTest." + std::to_string(getpid());
+    writer = new BGM_LoopbackSharedMemory();
+    writer->Open(segmentName.c_str(), kTestChannels, kTestCapacityFrames, 48000.0);
+
+    reader = BGMLoopbackReaderOpen(segmentName.c_str());
+    XCTAssert(reader != nullptr);
+}
+
+- (void) tearDown {
+    BGMLoopbackReaderClose(reader);
+    delete writer;
+    [super tearDown];
+}
+
+// Fill a buffer with frames whose samples are their sample times, so the tests can check which
+// frames they read.
+static std::vector<Float32> MakeFrames(SInt64 inSampleTime, UInt32 inFrameCount)
+{
+    std::vector<Float32> theFrames(inFrameCount * kTestChannels);
+
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        theFrames[i * kTestChannels] = static_cast<Float32>(inSampleTime + i);
+        theFrames[(i * kTestChannels) + 1] = -static_cast<Float32>(inSampleTime + i);
+    }
+
+    return theFrames;
+}
+
+- (void) store:(SInt64)sampleTime frames:(UInt32)frameCount {
+    std::vector<Float32> theFrames = MakeFrames(sampleTime, frameCount);
+    writer->Store(theFrames.data(), frameCount, sampleTime);
+}
+
+- (void) testFormat {
+    XCTAssertEqual(BGMLoopbackReaderGetChannelsPerFrame(reader), kTestChannels);
+    XCTAssertEqual(BGMLoopbackReaderGetCapacityFrames(reader), kTestCapacityFrames);
+    XCTAssertEqual(BGMLoopbackReaderGetSampleRate(reader), 48000.0);
+
+    writer->SetSampleRate(96000.0);
+    XCTAssertEqual(BGMLoopbackReaderGetSampleRate(reader), 96000.0);
+}
+
+- (void) testOpenRejectsBadArguments {
+    BGM_LoopbackSharedMemory theWriter;
+
+    BGMShouldThrow<CAException>(self, [&](){
+        theWriter.Open("/BGMTest.bad", kTestChannels, 1000, 48000.0);  // Not a power of two.
+    });
+    BGMShouldThrow<CAException>(self, [&](){
+        theWriter.Open("/BGMTest.bad", 0, kTestCapacityFrames, 48000.0);
+    });
+
+    XCTAssertFalse(theWriter.IsOpen());
+}
+
+- (void) testOnlyOwnerCanRead {
+    // Other users' processes mustn't be able to read the audio unless the readers group exists.
+    if(getgrnam(kBGMLoopbackReadersGroupName) != nullptr)
+    {
+        NSLog(@"Skipping testOnlyOwnerCanRead because the %s group exists", kBGMLoopbackReadersGroupName);
+        return;
+    }
+
+    int theFD = shm_open(segmentName.c_str(), O_RDONLY, 0);
+    XCTAssert(theFD >= 0);
+
+    struct stat theStat;
+    XCTAssertEqual(fstat(theFD, &theStat), 0);
+    XCTAssertEqual(theStat.st_mode & (S_IRWXG | S_IRWXO), 0);
+
+    close(theFD);
+}
+
+- (void) testStoreAndRead {
+    [self store:100 frames:kTestCycleFrames];
+
+    std::vector<Float32> theBuffer(kTestCapacityFrames * kTestChannels);
+    UInt32 theFrameCount = 0;
+    SInt64 theSampleTime = 0;
+
+    // The first read after the writer starts reports a reset, because the sample times started.
+    XCTAssertEqual(BGMLoopbackReaderRead(reader, theBuffer.data(), kTestCapacityFrames, &theFrameCount, &theSampleTime),
+                   kBGMLoopbackReader_Reset);
+    XCTAssertEqual(theFrameCount, kTestCycleFrames);
+    XCTAssertEqual(theSampleTime, 100);
+    std::vector<Float32> theExpected = MakeFrames(100, kTestCycleFrames);
+    XCTAssert(std::equal(theExpected.begin(), theExpected.end(), theBuffer.begin()));
+
+    XCTAssertEqual(BGMLoopbackReaderRead(reader, theBuffer.data(), kTestCapacityFrames, &theFrameCount, &theSampleTime),
+                   kBGMLoopbackReader_NoData);
+
+    // Contiguous frames wrapping around the end of the ring.
+    for(SInt64 theTime = 100 + kTestCycleFrames; theTime < 1500; theTime += kTestCycleFrames)
+    {
+        [self store:theTime frames:kTestCycleFrames];
+
+        XCTAssertEqual(BGMLoopbackReaderRead(reader, theBuffer.data(), kTestCapacityFrames, &theFrameCount, &theSampleTime),
+                       kBGMLoopbackReader_OK);
+        XCTAssertEqual(theFrameCount, kTestCycleFrames);
+        XCTAssertEqual(theSampleTime, theTime);
+
+        theExpected = MakeFrames(theTime, kTestCycleFrames);
+        XCTAssert(std::equal(theExpected.begin(), theExpected.end(), theBuffer.begin()));
+    }
+}
+
+- (void) testZeroCopyPeekAndCommit {
+    [self store:0 frames:kTestCycleFrames];
+    BGMLoopbackReaderSeekToLatest(reader, kTestCycleFrames);
+
+    BGMLoopbackRegion theRegions[2];
+    UInt32 theFrameCount = 0;
+    SInt64 theSampleTime = -1;
+
+    XCTAssertEqual(BGMLoopbackReaderPeek(reader, kTestCapacityFrames, theRegions, &theFrameCount, &theSampleTime),
+                   kBGMLoopbackReader_OK);
+    XCTAssertEqual(theFrameCount, kTestCycleFrames);
+    XCTAssertEqual(theSampleTime, 0);
+    XCTAssertEqual(theRegions[0].mFrameCount, kTestCycleFrames);
+    XCTAssertEqual(theRegions[1].mFrameCount, 0u);
+    XCTAssertEqual(theRegions[0].mData[2 * 10], 10.0f);
+
+    XCTAssertEqual(BGMLoopbackReaderCommit(reader), kBGMLoopbackReader_OK);
+    XCTAssertEqual(BGMLoopbackReaderGetPosition(reader), static_cast<SInt64>(kTestCycleFrames));
+
+    // Peek again, but this time let the writer lap the reader before it commits.
+    [self store:kTestCycleFrames frames:kTestCycleFrames];
+    XCTAssertEqual(BGMLoopbackReaderPeek(reader, kTestCapacityFrames, theRegions, &theFrameCount, &theSampleTime),
+                   kBGMLoopbackReader_OK);
+
+    for(SInt64 theTime = 2 * kTestCycleFrames; theTime < 2 * kTestCapacityFrames; theTime += kTestCycleFrames)
+    {
+        [self store:theTime frames:kTestCycleFrames];
+    }
+
+    XCTAssertEqual(BGMLoopbackReaderCommit(reader), kBGMLoopbackReader_Overrun);
+}
+
+- (void) testOverrun {
+    [self store:0 frames:kTestCycleFrames];
+    BGMLoopbackReaderSeekToLatest(reader, kTestCycleFrames);
+
+    // Write more than the ring can hold without reading anything.
+    for(SInt64 theTime = kTestCycleFrames; theTime < 3 * kTestCapacityFrames; theTime += kTestCycleFrames)
+    {
+        [self store:theTime frames:kTestCycleFrames];
+    }
+
+    std::vector<Float32> theBuffer(kTestCapacityFrames * kTestChannels);
+    UInt32 theFrameCount = 0;
+    SInt64 theSampleTime = 0;
+
+    // The reader should skip ahead to the oldest frame still in the ring.
+    XCTAssertEqual(BGMLoopbackReaderRead(reader, theBuffer.data(), kTestCapacityFrames, &theFrameCount, &theSampleTime),
+                   kBGMLoopbackReader_Overrun);
+    XCTAssertEqual(theFrameCount, kTestCapacityFrames);
+    XCTAssertEqual(theSampleTime, static_cast<SInt64>(2 * kTestCapacityFrames));
+    XCTAssertEqual(theBuffer[0], static_cast<Float32>(2 * kTestCapacityFrames));
+}
+
+- (void) testResetAndGap {
+    std::vector<Float32> theBuffer(kTestCapacityFrames * kTestChannels);
+    UInt32 theFrameCount = 0;
+    SInt64 theSampleTime = 0;
+
+    [self store:5000 frames:kTestCycleFrames];
+    BGMLoopbackReaderRead(reader, theBuffer.data(), kTestCapacityFrames, &theFrameCount, &theSampleTime);
+
+    // Sample times going backwards (e.g. IO restarting) should reset the reader.
+    [self store:0 frames:kTestCycleFrames];
+    XCTAssertEqual(BGMLoopbackReaderRead(reader, theBuffer.data(), kTestCapacityFrames, &theFrameCount, &theSampleTime),
+                   kBGMLoopbackReader_Reset);
+    XCTAssertEqual(theSampleTime, 0);
+    XCTAssertEqual(theFrameCount, kTestCycleFrames);
+
+    // A small gap should be filled with silence.
+    const SInt64 kGapFrames = 10;
+    [self store:kTestCycleFrames + kGapFrames frames:kTestCycleFrames];
+    XCTAssertEqual(BGMLoopbackReaderRead(reader, theBuffer.data(), kTestCapacityFrames, &theFrameCount, &theSampleTime),
+                   kBGMLoopbackReader_OK);
+    XCTAssertEqual(theSampleTime, static_cast<SInt64>(kTestCycleFrames));
+    XCTAssertEqual(theFrameCount, kTestCycleFrames + kGapFrames);
+
+    for(SInt64 i = 0; i < kGapFrames * kTestChannels; i++)
+    {
+        XCTAssertEqual(theBuffer[i], 0.0f);
+    }
+
+    XCTAssertEqual(theBuffer[kGapFrames * kTestChannels], static_cast<Float32>(kTestCycleFrames + kGapFrames));
+}
+
+- (void) testClosedSegment {
+    writer->Close();
+
+    BGMLoopbackRegion theRegions[2];
+    UInt32 theFrameCount = 0;
+
+    XCTAssertEqual(BGMLoopbackReaderPeek(reader, kTestCapacityFrames, theRegions, &theFrameCount, nullptr),
+                   kBGMLoopbackReader_SegmentClosed);
+    XCTAssert(BGMLoopbackReaderOpen(segmentName.c_str()) == nullptr);
+}
+
+// The writer should never wait for the reader, and the reader should never return torn frames,
+// however the two threads interleave.
+- (void) testConcurrentReaderNeverSeesTornFrames {
+    std::atomic<bool> theWriterFinished(false);
+
+    std::thread theWriterThread([&] {
+        for(SInt64 theTime = 0; theTime < 4000 * kTestCycleFrames; theTime += kTestCycleFrames)
+        {
+            std::vector<Float32> theFrames = MakeFrames(theTime, kTestCycleFrames);
+            writer->Store(theFrames.data(), kTestCycleFrames, theTime);
+        }
+
+        theWriterFinished = true;
+    });
+
+    std::vector<Float32> theBuffer(kTestCapacityFrames * kTestChannels);
+    UInt64 theBadFrames = 0;
+
+    while(!theWriterFinished)
+    {
+        UInt32 theFrameCount = 0;
+        SInt64 theSampleTime = 0;
+
+        // Read an awkward number of frames so the reads don't line up with the writes.
+        BGMLoopbackReaderRead(reader, theBuffer.data(), 300, &theFrameCount, &theSampleTime);
+
+        for(UInt32 i = 0; i < theFrameCount; i++)
+        {
+            if(theBuffer[i * kTestChannels] != static_cast<Float32>(theSampleTime + i) ||
+               theBuffer[(i * kTestChannels) + 1] != -static_cast<Float32>(theSampleTime + i))
+            {
+                theBadFrames++;
+            }
+        }
+    }
+
+    theWriterThread.join();
+
+    XCTAssertEqual(theBadFrames, 0u);
+}
+
+- (void) testPerformanceStore {
+    std::vector<Float32> theFrames = MakeFrames(0, kTestCycleFrames);
+
+    [self measureBlock:^{
+        for(SInt64 theTime = 0; theTime < 100000 * kTestCycleFrames; theTime += kTestCycleFrames)
+        {
+            writer->Store(theFrames.data(), kTestCycleFrames, theTime);
+        }
+    }];
+}
+
+@end
+
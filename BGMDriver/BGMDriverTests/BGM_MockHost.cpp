@@ -0,0 +1,296 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_MockHost.cpp
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_MockHost.h"
+
+// PublicUtility Includes
+#include "CAHostTimeBase.h"
+
+// STL Includes
+#include <chrono>
+#include <cmath>
+
+
+#pragma clang assume_nonnull begin
+
+// The virtual clock's starting time. Not zero so tests don't accidentally depend on that.
+static const UInt64 kInitialHostTime = 1000000000;
+
+BGM_MockHost::BGM_MockHost()
+:
+    mHostTime(kInitialHostTime)
+{
+}
+
+#pragma mark BGM_HostInterface
+
+void    BGM_MockHost::PropertiesChanged(AudioObjectID inObjectID,
+                                        UInt32 inNumberAddresses,
+                                        const AudioObjectPropertyAddress* inAddresses)
+{
+    {
+        std::lock_guard<std::mutex> theLock(mMutex);
+
+        for(UInt32 i = 0; i < inNumberAddresses; i++)
+        {
+            mNotifications.push_back({ inObjectID, inAddresses[i].mSelector });
+        }
+    }
+
+    mChanged.notify_all();
+}
+
+void    BGM_MockHost::RequestDeviceConfigurationChange(AudioObjectID inDeviceObjectID,
+                                                       UInt64 inChangeAction,
+                                                       void* __nullable inChangeInfo)
+{
+    #pragma unused (inChangeInfo)
+
+    {
+        std::lock_guard<std::mutex> theLock(mMutex);
+        mConfigChangeRequests.push_back({ inDeviceObjectID, inChangeAction });
+        mConfigChangeRequestCount++;
+    }
+
+    mChanged.notify_all();
+}
+
+UInt64  BGM_MockHost::GetCurrentHostTime() const
+{
+    std::lock_guard<std::mutex> theLock(mMutex);
+    return mHostTime;
+}
+
+#pragma mark Virtual Clock
+
+void    BGM_MockHost::AdvanceTime(UInt64 inHostTicks)
+{
+    std::lock_guard<std::mutex> theLock(mMutex);
+    mHostTime += inHostTicks;
+}
+
+void    BGM_MockHost::AdvanceTimeByFrames(UInt32 inFrames, Float64 inSampleRate)
+{
+    AdvanceTime(static_cast<UInt64>(llround(inFrames * HostTicksPerFrame(inSampleRate))));
+}
+
+Float64 BGM_MockHost::HostTicksPerFrame(Float64 inSampleRate)
+{
+    // The devices use the real host clock's frequency to convert between frames and host time.
+    return CAHostTimeBase::GetFrequency() / inSampleRate;
+}
+
+#pragma mark Notifications
+
+UInt32  BGM_MockHost::CountNotifications(AudioObjectID inObjectID,
+                                         AudioObjectPropertySelector inSelector) const
+{
+    UInt32 theCount = 0;
+
+    for(const Notification& theNotification : mNotifications)
+    {
+        if(theNotification.mObjectID == inObjectID && theNotification.mSelector == inSelector)
+        {
+            theCount++;
+        }
+    }
+
+    return theCount;
+}
+
+UInt32  BGM_MockHost::GetPropertiesChangedCount(AudioObjectID inObjectID,
+                                                AudioObjectPropertySelector inSelector) const
+{
+    std::lock_guard<std::mutex> theLock(mMutex);
+    return CountNotifications(inObjectID, inSelector);
+}
+
+bool    BGM_MockHost::WaitForPropertiesChanged(AudioObjectID inObjectID,
+                                               AudioObjectPropertySelector inSelector,
+                                               UInt32 inCount,
+                                               UInt32 inTimeoutMS) const
+{
+    std::unique_lock<std::mutex> theLock(mMutex);
+
+    return mChanged.wait_for(theLock, std::chrono::milliseconds(inTimeoutMS), [&] {
+        return CountNotifications(inObjectID, inSelector) >= inCount;
+    });
+}
+
+void    BGM_MockHost::ClearNotifications()
+{
+    std::lock_guard<std::mutex> theLock(mMutex);
+    mNotifications.clear();
+}
+
+#pragma mark Config Changes
+
+bool    BGM_MockHost::WaitForConfigChangeRequests(UInt32 inCount, UInt32 inTimeoutMS) const
+{
+    std::unique_lock<std::mutex> theLock(mMutex);
+
+    return mChanged.wait_for(theLock, std::chrono::milliseconds(inTimeoutMS), [&] {
+        return mConfigChangeRequestCount >= inCount;
+    });
+}
+
+std::vector<BGM_MockHost::ConfigChangeRequest> BGM_MockHost::GetPendingConfigChanges() const
+{
+    std::lock_guard<std::mutex> theLock(mMutex);
+    return mConfigChangeRequests;
+}
+
+UInt32  BGM_MockHost::PerformConfigChanges(BGM_AbstractDevice& inDevice)
+{
+    std::vector<ConfigChangeRequest> theRequests;
+
+    // Take the device's requests out of the queue, but don't hold the mutex while performing them,
+    // since the device might send notifications or request more changes.
+    {
+        std::lock_guard<std::mutex> theLock(mMutex);
+
+        for(auto theIterator = mConfigChangeRequests.begin(); theIterator != mConfigChangeRequests.end();)
+        {
+            if(theIterator->mDeviceObjectID == inDevice.GetObjectID())
+            {
+                theRequests.push_back(*theIterator);
+                theIterator = mConfigChangeRequests.erase(theIterator);
+            }
+            else
+            {
+                theIterator++;
+            }
+        }
+    }
+
+    for(const ConfigChangeRequest& theRequest : theRequests)
+    {
+        inDevice.PerformConfigChange(theRequest.mChangeAction, nullptr);
+    }
+
+    return static_cast<UInt32>(theRequests.size());
+}
+
+#pragma mark Clients and IO
+
+void    BGM_MockHost::AddClient(BGM_AbstractDevice& inDevice,
+                                UInt32 inClientID,
+                                pid_t inProcessID,
+                                CFStringRef __nullable inBundleID)
+{
+    AudioServerPlugInClientInfo theClientInfo = { inClientID, inProcessID, true, inBundleID };
+    inDevice.AddClient(&theClientInfo);
+}
+
+void    BGM_MockHost::RemoveClient(BGM_AbstractDevice& inDevice,
+                                   UInt32 inClientID,
+                                   pid_t inProcessID,
+                                   CFStringRef __nullable inBundleID)
+{
+    AudioServerPlugInClientInfo theClientInfo = { inClientID, inProcessID, true, inBundleID };
+    inDevice.RemoveClient(&theClientInfo);
+}
+
+void    BGM_MockHost::RunIOCycle(BGM_AbstractDevice& inDevice,
+                                 AudioObjectID inInputStreamID,
+                                 AudioObjectID inOutputStreamID,
+                                 UInt32 inClientID,
+                                 UInt32 inIOBufferFrameSize,
+                                 Float64 inSampleRate,
+                                 Float32* ioOutputBuffer,
+                                 Float32* __nullable outInputBuffer)
+{
+    // Work out the current sample time from the device's most recent zero timestamp, like the HAL.
+    Float64 theZeroSampleTime;
+    UInt64 theZeroHostTime;
+    UInt64 theSeed;
+    inDevice.GetZeroTimeStamp(theZeroSampleTime, theZeroHostTime, theSeed);
+
+    const UInt64 theHostTime = GetCurrentHostTime();
+    const Float64 theHostTicksSinceZero =
+            static_cast<Float64>(theHostTime) - static_cast<Float64>(theZeroHostTime);
+    const Float64 theSampleTime =
+            theZeroSampleTime + round(theHostTicksSinceZero / HostTicksPerFrame(inSampleRate));
+
+    AudioServerPlugInIOCycleInfo theCycleInfo {};
+    theCycleInfo.mIOCycleCounter = ++mIOCycleCount;
+    theCycleInfo.mNominalIOBufferFrameSize = inIOBufferFrameSize;
+
+    theCycleInfo.mCurrentTime.mSampleTime = theSampleTime;
+    theCycleInfo.mCurrentTime.mHostTime = theHostTime;
+    theCycleInfo.mCurrentTime.mRateScalar = 1.0;
+    theCycleInfo.mCurrentTime.mFlags = kAudioTimeStampSampleHostTimeValid | kAudioTimeStampRateScalarValid;
+
+    // The HAL reads input from a buffer behind the current time and writes output a buffer ahead
+    // of it. (It also adds the devices' safety offsets, which are zero for BGMDevice.)
+    theCycleInfo.mInputTime = theCycleInfo.mCurrentTime;
+    theCycleInfo.mInputTime.mSampleTime -= inIOBufferFrameSize;
+    theCycleInfo.mOutputTime = theCycleInfo.mCurrentTime;
+    theCycleInfo.mOutputTime.mSampleTime += inIOBufferFrameSize;
+
+    mLastIOCycleInfo = theCycleInfo;
+
+    std::vector<Float32> theInputScratchBuffer;
+
+    if(outInputBuffer == nullptr)
+    {
+        theInputScratchBuffer.resize(inIOBufferFrameSize * 2);
+        outInputBuffer = theInputScratchBuffer.data();
+    }
+
+    // The operations the HAL would call for a client with input and output, in order.
+    const UInt32 theOperations[] = {
+        kAudioServerPlugInIOOperationReadInput,
+        kAudioServerPlugInIOOperationProcessOutput,
+        kAudioServerPlugInIOOperationProcessMix,
+        kAudioServerPlugInIOOperationWriteMix
+    };
+
+    for(UInt32 theOperationID : theOperations)
+    {
+        bool theWillDo = false;
+        bool theWillDoInPlace = true;
+        inDevice.WillDoIOOperation(theOperationID, theWillDo, theWillDoInPlace);
+
+        if(theWillDo)
+        {
+            const bool theIsInput = (theOperationID == kAudioServerPlugInIOOperationReadInput);
+            Float32* theBuffer = theIsInput ? outInputBuffer : ioOutputBuffer;
+
+            inDevice.BeginIOOperation(theOperationID, inIOBufferFrameSize, theCycleInfo, inClientID);
+            inDevice.DoIOOperation(theIsInput ? inInputStreamID : inOutputStreamID,
+                                   inClientID,
+                                   theOperationID,
+                                   inIOBufferFrameSize,
+                                   theCycleInfo,
+                                   theBuffer,
+                                   nullptr);
+            inDevice.EndIOOperation(theOperationID, inIOBufferFrameSize, theCycleInfo, inClientID);
+        }
+    }
+
+    AdvanceTimeByFrames(inIOBufferFrameSize, inSampleRate);
+}
+
+#pragma clang assume_nonnull end
+
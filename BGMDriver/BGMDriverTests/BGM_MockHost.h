@@ -0,0 +1,187 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_MockHost.h
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  A stand-in for coreaudiod for tests. It records the property notifications the driver sends,
+//  queues the config changes it requests until the test applies them, and runs clients' IO cycles
+//  the way the HAL does, against a virtual clock that only moves when the test (or an IO cycle)
+//  advances it.
+//
+//  Install it with BGM_PlugIn::SetHost before creating the devices under test, since they read the
+//  host's clock when IO starts.
+//
+//  Thread safe, since the driver sends notifications from its own threads.
+//
+
+#ifndef BGMDriverTests__BGM_MockHost
+#define BGMDriverTests__BGM_MockHost
+
+// Superclass Includes
+#include "BGM_HostInterface.h"
+
+// Local Includes
+#include "BGM_AbstractDevice.h"
+
+// STL Includes
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// System Includes
+#include <CoreAudio/AudioServerPlugIn.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_MockHost
+:
+    public BGM_HostInterface
+{
+
+public:
+    struct ConfigChangeRequest
+    {
+        AudioObjectID               mDeviceObjectID;
+        UInt64                      mChangeAction;
+    };
+
+                                    BGM_MockHost();
+
+#pragma mark BGM_HostInterface
+
+    void                            PropertiesChanged(AudioObjectID inObjectID,
+                                                      UInt32 inNumberAddresses,
+                                                      const AudioObjectPropertyAddress* inAddresses) override;
+    void                            RequestDeviceConfigurationChange(AudioObjectID inDeviceObjectID,
+                                                                     UInt64 inChangeAction,
+                                                                     void* __nullable inChangeInfo) override;
+    UInt64                          GetCurrentHostTime() const override;
+
+#pragma mark Virtual Clock
+
+    /*! Move the virtual clock forward. It starts at an arbitrary non-zero time. */
+    void                            AdvanceTime(UInt64 inHostTicks);
+    void                            AdvanceTimeByFrames(UInt32 inFrames, Float64 inSampleRate);
+    static Float64                  HostTicksPerFrame(Float64 inSampleRate);
+
+#pragma mark Notifications
+
+    /*! @return The number of notifications so far for inSelector on inObjectID. */
+    UInt32                          GetPropertiesChangedCount(AudioObjectID inObjectID,
+                                                              AudioObjectPropertySelector inSelector) const;
+
+    /*!
+     Wait until the driver has sent at least inCount notifications for inSelector on inObjectID. The
+     driver sends most of its notifications asynchronously.
+
+     @return False if it timed out.
+     */
+    bool                            WaitForPropertiesChanged(AudioObjectID inObjectID,
+                                                             AudioObjectPropertySelector inSelector,
+                                                             UInt32 inCount = 1,
+                                                             UInt32 inTimeoutMS = 5000) const;
+
+    /*! Forget the notifications received so far, so long-running tests don't keep them all. */
+    void                            ClearNotifications();
+
+#pragma mark Config Changes
+
+    /*!
+     Wait until the driver has requested at least inCount config changes in total, which it also
+     does asynchronously.
+
+     @return False if it timed out.
+     */
+    bool                            WaitForConfigChangeRequests(UInt32 inCount = 1,
+                                                                UInt32 inTimeoutMS = 5000) const;
+    std::vector<ConfigChangeRequest> GetPendingConfigChanges() const;
+
+    /*!
+     Apply the config changes inDevice has requested, in order, like the HAL does after stopping IO.
+     The requests are removed whether they succeed or not.
+
+     @return The number of changes performed.
+     */
+    UInt32                          PerformConfigChanges(BGM_AbstractDevice& inDevice);
+
+#pragma mark Clients and IO
+
+    void                            AddClient(BGM_AbstractDevice& inDevice,
+                                              UInt32 inClientID,
+                                              pid_t inProcessID,
+                                              CFStringRef __nullable inBundleID);
+    void                            RemoveClient(BGM_AbstractDevice& inDevice,
+                                                 UInt32 inClientID,
+                                                 pid_t inProcessID,
+                                                 CFStringRef __nullable inBundleID);
+
+    /*!
+     Run one of a client's IO cycles like the HAL would: get the device's zero timestamp, work out
+     the cycle's input and output times from it, then call each IO operation the device says it
+     will do, in the order the HAL does. Advances the virtual clock by one buffer afterwards.
+
+     The client's output is passed to ProcessOutput and, as the mix of all clients, to WriteMix, so
+     this only models one client playing audio at a time.
+
+     @param inInputStreamID The device's input stream.
+     @param inOutputStreamID The device's output stream.
+     @param inSampleRate The device's sample rate, for converting between frames and host time.
+     @param ioOutputBuffer The client's audio, inIOBufferFrameSize interleaved stereo frames.
+     @param outInputBuffer Filled by ReadInput, if the device does it. Can be null.
+     */
+    void                            RunIOCycle(BGM_AbstractDevice& inDevice,
+                                               AudioObjectID inInputStreamID,
+                                               AudioObjectID inOutputStreamID,
+                                               UInt32 inClientID,
+                                               UInt32 inIOBufferFrameSize,
+                                               Float64 inSampleRate,
+                                               Float32* ioOutputBuffer,
+                                               Float32* __nullable outInputBuffer);
+
+    /*! The cycle info passed to the IO operations in the last call to RunIOCycle. */
+    const AudioServerPlugInIOCycleInfo& GetLastIOCycleInfo() const { return mLastIOCycleInfo; }
+
+private:
+    struct Notification
+    {
+        AudioObjectID               mObjectID;
+        AudioObjectPropertySelector mSelector;
+    };
+
+    UInt32                          CountNotifications(AudioObjectID inObjectID,
+                                                       AudioObjectPropertySelector inSelector) const;
+
+    mutable std::mutex              mMutex;
+    mutable std::condition_variable mChanged;
+
+    UInt64                          mHostTime;
+    std::vector<Notification>       mNotifications;
+    std::vector<ConfigChangeRequest> mConfigChangeRequests;
+    UInt32                          mConfigChangeRequestCount = 0;
+
+    UInt64                          mIOCycleCount = 0;
+    AudioServerPlugInIOCycleInfo    mLastIOCycleInfo {};
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriverTests__BGM_MockHost */
+
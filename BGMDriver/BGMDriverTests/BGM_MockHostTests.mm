@@ -0,0 +1,378 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_MockHostTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Tests BGM_Device's interactions with its host, using BGM_MockHost in place of coreaudiod.
+//
+
+// Unit Include
+#include "BGM_MockHost.h"
+
+// Local Includes
+#include "BGM_Device.h"
+#include "BGM_PlugIn.h"
+#include "BGM_TestUtils.h"
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CADispatchQueue.h"
+
+// STL Includes
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+
+static const UInt32 kTestFrameSize = 512;
+static const UInt32 kTestClientID = 11;
+static const pid_t kTestClientPID = 4321;
+
+// Subclass BGM_Device so the tests can create their own instances.
+class BGM_MockHostTestDevice
+:
+    public BGM_Device
+{
+
+public:
+    BGM_MockHostTestDevice()
+    :
+        BGM_Device(kObjectID_Device,
+                   CFSTR(kDeviceName),
+                   CFSTR(kBGMDeviceUID),
+                   CFSTR(kBGMDeviceModelUID),
+                   kObjectID_Stream_Input,
+                   kObjectID_Stream_Output,
+                   kObjectID_Volume_Output_Master,
+                   kObjectID_Mute_Output_Master)
+    {
+        Activate();
+    }
+
+};
+
+static Float64 GetNominalSampleRate(BGM_Device& inDevice)
+{
+    const AudioObjectPropertyAddress theAddress = {
+        kAudioDevicePropertyNominalSampleRate,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMaster
+    };
+    Float64 theSampleRate = 0.0;
+    UInt32 theSize = 0;
+    inDevice.GetPropertyData(kObjectID_Device,
+                             0,
+                             theAddress,
+                             0,
+                             nullptr,
+                             sizeof(Float64),
+                             theSize,
+                             &theSampleRate);
+    return theSampleRate;
+}
+
+static bool HasNonZeroSample(const std::vector<Float32>& inBuffer)
+{
+    return std::any_of(inBuffer.begin(), inBuffer.end(), [](Float32 inSample) {
+        return inSample != 0.0f;
+    });
+}
+
+@interface BGM_MockHostTests : XCTestCase {
+    std::unique_ptr<BGM_MockHost> host;
+    std::unique_ptr<BGM_MockHostTestDevice> device;
+}
+
+@end
+
+@implementation BGM_MockHostTests
+
+- (void) setUp {
+    [super setUp];
+
+    host.reset(new BGM_MockHost);
+    BGM_PlugIn::SetHost(host.get());
+
+    device.reset(new BGM_MockHostTestDevice);
+}
+
+- (void) tearDown {
+    device.reset();
+
+    // Let the driver finish sending any notifications it queued before removing the host.
+    CADispatchQueue::GetGlobalSerialQueue().Dispatch(true, ^{});
+    BGM_PlugIn::SetHost(nullptr);
+    host.reset();
+
+    [super tearDown];
+}
+
+- (void) testZeroTimeStampsFollowVirtualClock {
+    const Float64 theSampleRate = GetNominalSampleRate(*device);
+
+    host->AddClient(*device, kTestClientID, kTestClientPID, CFSTR("com.example.player"));
+    device->StartIO(kTestClientID);
+
+    Float64 theSampleTime;
+    UInt64 theHostTime;
+    UInt64 theSeed;
+
+    // The device's clock is anchored to the host time when IO starts.
+    const UInt64 theStartHostTime = host->GetCurrentHostTime();
+    device->GetZeroTimeStamp(theSampleTime, theHostTime, theSeed);
+    XCTAssertEqual(theSampleTime, 0.0);
+    XCTAssertEqual(theHostTime, theStartHostTime);
+
+    // The clock doesn't move on its own, so the device shouldn't give the next timestamp until the
+    // host time reaches it.
+    host->AdvanceTimeByFrames(kLoopbackRingBufferFrameSize - 1, theSampleRate);
+    device->GetZeroTimeStamp(theSampleTime, theHostTime, theSeed);
+    XCTAssertEqual(theSampleTime, 0.0);
+
+    host->AdvanceTimeByFrames(1, theSampleRate);
+    host->AdvanceTime(1);  // In case the conversions to host ticks rounded down.
+    device->GetZeroTimeStamp(theSampleTime, theHostTime, theSeed);
+    XCTAssertEqual(theSampleTime, static_cast<Float64>(kLoopbackRingBufferFrameSize));
+    XCTAssertEqualWithAccuracy(static_cast<Float64>(theHostTime - theStartHostTime),
+                               kLoopbackRingBufferFrameSize * BGM_MockHost::HostTicksPerFrame(theSampleRate),
+                               1.0);
+
+    device->StopIO(kTestClientID);
+}
+
+- (void) testIOCyclesLoopBackOutput {
+    const Float64 theSampleRate = GetNominalSampleRate(*device);
+
+    host->AddClient(*device, kTestClientID, kTestClientPID, CFSTR("com.example.player"));
+    device->StartIO(kTestClientID);
+
+    // Start a couple of buffers in so the first cycles' input times aren't negative.
+    host->AdvanceTimeByFrames(kTestFrameSize * 2, theSampleRate);
+
+    std::vector<Float32> theOutput(kTestFrameSize * 2);
+    std::vector<Float32> theInput(kTestFrameSize * 2);
+    const int kCycles = 8;
+
+    for(int theCycle = 0; theCycle < kCycles; theCycle++)
+    {
+        std::fill(theOutput.begin(), theOutput.end(), 0.25f);
+
+        host->RunIOCycle(*device,
+                         kObjectID_Stream_Input,
+                         kObjectID_Stream_Output,
+                         kTestClientID,
+                         kTestFrameSize,
+                         theSampleRate,
+                         theOutput.data(),
+                         theInput.data());
+
+        const AudioServerPlugInIOCycleInfo& theCycleInfo = host->GetLastIOCycleInfo();
+        XCTAssertEqual(theCycleInfo.mCurrentTime.mSampleTime,
+                       static_cast<Float64>((theCycle + 2) * kTestFrameSize));
+
+        // The input is read a buffer behind the current time and the output is written a buffer
+        // ahead of it, so the device should only give the audio back from the third cycle on.
+        if(theCycle < 2)
+        {
+            XCTAssertFalse(HasNonZeroSample(theInput), "cycle %d", theCycle);
+        }
+        else
+        {
+            XCTAssert(HasNonZeroSample(theInput), "cycle %d", theCycle);
+        }
+    }
+
+    device->StopIO(kTestClientID);
+    host->RemoveClient(*device, kTestClientID, kTestClientPID, CFSTR("com.example.player"));
+}
+
+- (void) testHighSampleRates {
+    // The standard rates should be listed individually, followed by the range of all rates.
+    AudioValueRange theRanges[kBGMNumStandardSampleRates + 1] = {};
+    UInt32 theSize = 0;
+    device->GetPropertyData(kObjectID_Device,
+                            0,
+                            { kAudioDevicePropertyAvailableNominalSampleRates,
+                              kAudioObjectPropertyScopeGlobal,
+                              kAudioObjectPropertyElementMaster },
+                            0,
+                            nullptr,
+                            sizeof(theRanges),
+                            theSize,
+                            theRanges);
+    XCTAssertEqual(theSize, sizeof(theRanges));
+
+    for(UInt32 i = 0; i < kBGMNumStandardSampleRates; i++)
+    {
+        XCTAssertEqual(theRanges[i].mMinimum, kBGMStandardSampleRates[i]);
+        XCTAssertEqual(theRanges[i].mMaximum, kBGMStandardSampleRates[i]);
+    }
+
+    XCTAssertEqual(theRanges[kBGMNumStandardSampleRates].mMinimum, 1.0);
+
+    host->AddClient(*device, kTestClientID, kTestClientPID, CFSTR("com.example.player"));
+    UInt32 theConfigChanges = 0;
+
+    for(Float64 theSampleRate : kBGMStandardSampleRates)
+    {
+        if(theSampleRate != GetNominalSampleRate(*device))
+        {
+            device->SetPropertyData(kObjectID_Device,
+                                    0,
+                                    { kAudioDevicePropertyNominalSampleRate,
+                                      kAudioObjectPropertyScopeGlobal,
+                                      kAudioObjectPropertyElementMaster },
+                                    0,
+                                    nullptr,
+                                    sizeof(Float64),
+                                    &theSampleRate);
+            XCTAssert(host->WaitForConfigChangeRequests(++theConfigChanges));
+            XCTAssertEqual(host->PerformConfigChanges(*device), 1);
+        }
+
+        XCTAssertEqual(GetNominalSampleRate(*device), theSampleRate);
+
+        // The loopback ring buffer, and so the zero time stamp period, should hold about the same
+        // length of audio at every rate.
+        UInt32 thePeriod = 0;
+        device->GetPropertyData(kObjectID_Device,
+                                0,
+                                { kAudioDevicePropertyZeroTimeStampPeriod,
+                                  kAudioObjectPropertyScopeGlobal,
+                                  kAudioObjectPropertyElementMaster },
+                                0,
+                                nullptr,
+                                sizeof(UInt32),
+                                theSize,
+                                &thePeriod);
+        XCTAssertEqual(thePeriod,
+                       BGM_LoopbackSharedMemory::GetCapacityFramesForSampleRate(theSampleRate));
+        XCTAssertGreaterThanOrEqual(thePeriod / theSampleRate, 0.34);
+
+        // Loop back 10 ms buffers until the ring buffer has wrapped around a couple of times.
+        const UInt32 theFrames = static_cast<UInt32>(theSampleRate / 100);
+        std::vector<Float32> theOutput(theFrames * 2);
+        std::vector<Float32> theInput(theFrames * 2);
+
+        device->StartIO(kTestClientID);
+        host->AdvanceTimeByFrames(theFrames * 2, theSampleRate);
+
+        for(UInt32 theCycle = 0; theCycle < (2 * thePeriod / theFrames) + 2; theCycle++)
+        {
+            std::fill(theOutput.begin(), theOutput.end(), 0.25f);
+
+            host->RunIOCycle(*device,
+                             kObjectID_Stream_Input,
+                             kObjectID_Stream_Output,
+                             kTestClientID,
+                             theFrames,
+                             theSampleRate,
+                             theOutput.data(),
+                             theInput.data());
+
+            if(theCycle >= 2)
+            {
+                XCTAssert(HasNonZeroSample(theInput), "%f Hz, cycle %u", theSampleRate, theCycle);
+            }
+        }
+
+        device->StopIO(kTestClientID);
+    }
+
+    host->RemoveClient(*device, kTestClientID, kTestClientPID, CFSTR("com.example.player"));
+}
+
+- (void) testPropertyChangesNotifyHost {
+    CFStringRef theBundleID = CFSTR("com.example.player");
+    device->SetPropertyData(kObjectID_Device,
+                            0,
+                            kBGMMusicPlayerBundleIDAddress,
+                            0,
+                            nullptr,
+                            sizeof(CFStringRef),
+                            &theBundleID);
+
+    XCTAssert(host->WaitForPropertiesChanged(kObjectID_Device, kAudioDeviceCustomPropertyMusicPlayerBundleID));
+    XCTAssert(host->WaitForPropertiesChanged(kObjectID_Device, kAudioDeviceCustomPropertyMusicPlayerProcessID));
+
+    // Setting it to the same value again doesn't send another notification.
+    device->SetPropertyData(kObjectID_Device,
+                            0,
+                            kBGMMusicPlayerBundleIDAddress,
+                            0,
+                            nullptr,
+                            sizeof(CFStringRef),
+                            &theBundleID);
+    CADispatchQueue::GetGlobalSerialQueue().Dispatch(true, ^{});
+    XCTAssertEqual(host->GetPropertiesChangedCount(kObjectID_Device,
+                                                   kAudioDeviceCustomPropertyMusicPlayerBundleID),
+                   1);
+}
+
+- (void) testConfigChangesWaitForHost {
+    // Enabling the boost limiter changes the output stream's latency, so the device has to ask the
+    // host to let it make the change.
+    CFBooleanRef theEnabled = kCFBooleanTrue;
+    device->SetPropertyData(kObjectID_Device,
+                            0,
+                            kBGMBoostLimiterAddress,
+                            0,
+                            nullptr,
+                            sizeof(CFBooleanRef),
+                            &theEnabled);
+
+    XCTAssert(host->WaitForConfigChangeRequests());
+
+    std::vector<BGM_MockHost::ConfigChangeRequest> theRequests = host->GetPendingConfigChanges();
+    XCTAssertEqual(theRequests.size(), 1);
+    XCTAssertEqual(theRequests[0].mDeviceObjectID, kObjectID_Device);
+
+    // The change shouldn't have been made yet.
+    CFBooleanRef theValue = nullptr;
+    UInt32 theSize = 0;
+    device->GetPropertyData(kObjectID_Device,
+                            0,
+                            kBGMBoostLimiterAddress,
+                            0,
+                            nullptr,
+                            sizeof(CFBooleanRef),
+                            theSize,
+                            &theValue);
+    XCTAssertEqual(theValue, kCFBooleanFalse);
+
+    XCTAssertEqual(host->PerformConfigChanges(*device), 1);
+    XCTAssert(host->GetPendingConfigChanges().empty());
+
+    device->GetPropertyData(kObjectID_Device,
+                            0,
+                            kBGMBoostLimiterAddress,
+                            0,
+                            nullptr,
+                            sizeof(CFBooleanRef),
+                            theSize,
+                            &theValue);
+    XCTAssertEqual(theValue, kCFBooleanTrue);
+
+    // The host should be told the stream's latency changed.
+    XCTAssert(host->WaitForPropertiesChanged(kObjectID_Device, kAudioDeviceCustomPropertyBoostLimiter));
+    XCTAssert(host->WaitForPropertiesChanged(kObjectID_Stream_Output, kAudioStreamPropertyLatency));
+}
+
+@end
+
@@ -0,0 +1,218 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_ObjectRegistryTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#include "BGM_ObjectRegistry.h"
+
+// Local Includes
+#include "BGM_Device.h"
+#include "BGM_TestUtils.h"
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+
+// Subclass BGM_Device so the tests can create their own instances. Unlike the real devices, they
+// aren't registered until the test calls RegisterObjects.
+class BGM_ObjectRegistryTestDevice
+:
+    public BGM_Device
+{
+
+public:
+    BGM_ObjectRegistryTestDevice()
+    :
+        BGM_Device(kObjectID_Device,
+                   CFSTR(kDeviceName),
+                   CFSTR(kBGMDeviceUID),
+                   CFSTR(kBGMDeviceModelUID),
+                   kObjectID_Stream_Input,
+                   kObjectID_Stream_Output,
+                   kObjectID_Volume_Output_Master,
+                   kObjectID_Mute_Output_Master)
+    {
+        Activate();
+    }
+
+};
+
+// BGMDevice's object IDs.
+static const AudioObjectID kDeviceObjectIDs[] = {
+    kObjectID_Device,
+    kObjectID_Stream_Input,
+    kObjectID_Stream_Output,
+    kObjectID_Volume_Output_Master,
+    kObjectID_Mute_Output_Master
+};
+
+// Returns the error f throws, or 0 if it doesn't throw.
+static OSStatus ErrorThrownBy(const std::function<void()>& f)
+{
+    try
+    {
+        f();
+    }
+    catch(const CAException& e)
+    {
+        return e.GetError();
+    }
+
+    return 0;
+}
+
+@interface BGM_ObjectRegistryTests : XCTestCase
+
+@end
+
+@implementation BGM_ObjectRegistryTests
+
+- (void) testLookUpRegisteredObjects {
+    BGM_ObjectRegistryTestDevice theDevice;
+    XCTAssert(BGM_ObjectRegistry::FindObject(kObjectID_Device) == nullptr);
+
+    theDevice.RegisterObjects();
+
+    // The device handles its own calls and the calls for the objects it owns.
+    for(AudioObjectID theObjectID : kDeviceObjectIDs)
+    {
+        BGM_Object* theObject = BGM_ObjectRegistry::FindObject(theObjectID);
+        XCTAssert(theObject != nullptr);
+        XCTAssertEqual(theObject ? theObject->GetObjectID() : 0, theObjectID);
+
+        XCTAssert(&BGM_ObjectRegistry::GetOwnerObject(theObjectID) == &theDevice);
+    }
+
+    XCTAssert(&BGM_ObjectRegistry::GetDevice(kObjectID_Device) == &theDevice);
+
+    // Streams and controls aren't devices.
+    XCTAssertEqual(ErrorThrownBy([] { BGM_ObjectRegistry::GetDevice(kObjectID_Stream_Output); }),
+                   kAudioHardwareBadDeviceError);
+    XCTAssertEqual(ErrorThrownBy([] { BGM_ObjectRegistry::GetDevice(kObjectID_Volume_Output_Master); }),
+                   kAudioHardwareBadDeviceError);
+}
+
+- (void) testUnregisterOnDestruction {
+    BGM_ObjectRegistryTestDevice* theDevice = new BGM_ObjectRegistryTestDevice;
+    theDevice->RegisterObjects();
+    delete theDevice;
+
+    for(AudioObjectID theObjectID : kDeviceObjectIDs)
+    {
+        XCTAssert(BGM_ObjectRegistry::FindObject(theObjectID) == nullptr);
+        XCTAssertEqual(ErrorThrownBy([&] { BGM_ObjectRegistry::GetOwnerObject(theObjectID); }),
+                       kAudioHardwareBadObjectError);
+    }
+
+    XCTAssertEqual(ErrorThrownBy([] { BGM_ObjectRegistry::GetDevice(kObjectID_Device); }),
+                   kAudioHardwareBadDeviceError);
+}
+
+- (void) testDuplicateObjectID {
+    BGM_ObjectRegistryTestDevice theDevice;
+    theDevice.RegisterObjects();
+
+    BGM_ObjectRegistryTestDevice* theOtherDevice = new BGM_ObjectRegistryTestDevice;
+    XCTAssertEqual(ErrorThrownBy([&] { theOtherDevice->RegisterObjects(); }),
+                   kAudioHardwareIllegalOperationError);
+    XCTAssert(&BGM_ObjectRegistry::GetDevice(kObjectID_Device) == &theDevice);
+
+    // Destroying the other device shouldn't unregister the first one.
+    delete theOtherDevice;
+    XCTAssert(&BGM_ObjectRegistry::GetDevice(kObjectID_Device) == &theDevice);
+    XCTAssert(&BGM_ObjectRegistry::GetOwnerObject(kObjectID_Stream_Output) == &theDevice);
+}
+
+- (void) testUnknownObjectIDs {
+    const AudioObjectID kUnknownObjectIDs[] = {
+        kAudioObjectUnknown,
+        kObjectID_Mute_Output_Master + 100,
+        BGM_ObjectRegistry::kMaxObjects,
+        0xFFFFFFFF
+    };
+
+    for(AudioObjectID theObjectID : kUnknownObjectIDs)
+    {
+        XCTAssert(BGM_ObjectRegistry::FindObject(theObjectID) == nullptr);
+        XCTAssertEqual(ErrorThrownBy([&] { BGM_ObjectRegistry::GetOwnerObject(theObjectID); }),
+                       kAudioHardwareBadObjectError);
+        XCTAssertEqual(ErrorThrownBy([&] { BGM_ObjectRegistry::GetDevice(theObjectID); }),
+                       kAudioHardwareBadDeviceError);
+    }
+}
+
+- (void) testWaitForCallsToFinish {
+    // With no calls in progress, it shouldn't wait.
+    BGM_ObjectRegistry::WaitForCallsToFinish();
+
+    std::atomic<bool> callStarted(false);
+    std::atomic<bool> callFinished(false);
+    std::atomic<bool> finishCall(false);
+    std::atomic<bool> returnedEarly(false);
+
+    // Simulate a call from the HAL that's still in progress.
+    std::thread theCallThread([&] {
+        BGM_ObjectRegistry::CallScope theCallScope;
+        callStarted = true;
+
+        while(!finishCall)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        callFinished = true;
+    });
+
+    while(!callStarted)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::thread theWaitingThread([&] {
+        BGM_ObjectRegistry::WaitForCallsToFinish();
+        returnedEarly = !callFinished;
+    });
+
+    // Give it time to return early if it was going to.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    finishCall = true;
+
+    theWaitingThread.join();
+    theCallThread.join();
+    XCTAssertFalse(returnedEarly);
+
+    // Calls that started and finished before it shouldn't make it wait.
+    {
+        BGM_ObjectRegistry::CallScope theCallScope;
+    }
+
+    BGM_ObjectRegistry::WaitForCallsToFinish();
+}
+
+@end
+
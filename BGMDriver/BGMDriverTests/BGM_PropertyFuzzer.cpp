@@ -0,0 +1,1291 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PropertyFuzzer.cpp
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_PropertyFuzzer.h"
+
+// Local Includes
+#include "BGM_PlugIn.h"
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CACFArray.h"
+#include "CACFDictionary.h"
+#include "CACFNumber.h"
+#include "CACFString.h"
+#include "CADebugMacros.h"
+#include "CADispatchQueue.h"
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// System Includes
+#include <dirent.h>
+#include <unistd.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Input Format
+
+enum
+{
+    kOp_HasProperty,
+    kOp_IsPropertySettable,
+    kOp_GetPropertyDataSize,
+    kOp_GetPropertyData,
+    kOp_SetPropertyData,
+    kOp_Count
+};
+
+enum
+{
+    kCFTag_Null,
+    kCFTag_String,
+    kCFTag_SInt32,
+    kCFTag_SInt64,
+    kCFTag_Float32,
+    kCFTag_Float64,
+    kCFTag_Boolean,
+    kCFTag_Data,
+    kCFTag_Array,
+    kCFTag_Dictionary,
+    kCFTag_Count
+};
+
+// The flags byte before the CF value for the custom properties.
+enum
+{
+    // The size to pass follows, rather than it being sizeof(CFTypeRef).
+    kSetFlag_CustomSize = 1 << 0
+};
+
+// Each of these is encoded as an index into its table, or one past the end followed by the value.
+static const AudioObjectID kObjectIDs[] = {
+    kObjectID_Device,
+    kObjectID_Stream_Input,
+    kObjectID_Stream_Output,
+    kObjectID_Volume_Output_Master,
+    kObjectID_Mute_Output_Master,
+    kObjectID_PlugIn  // Not owned by the device.
+};
+
+static const AudioObjectPropertySelector kCustomSelectors[] = {
+    kAudioDeviceCustomPropertyMusicPlayerProcessID,
+    kAudioDeviceCustomPropertyMusicPlayerBundleID,
+    kAudioDeviceCustomPropertyDeviceAudibleState,
+    kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp,
+    kAudioDeviceCustomPropertyAppVolumes,
+    kAudioDeviceCustomPropertyEnabledOutputControls,
+    kAudioDeviceCustomPropertyLoopbackSharedMemory,
+    kAudioDeviceCustomPropertyCaptureTaps,
+    kAudioDeviceCustomPropertyBoostLimiter,
+    kAudioDeviceCustomPropertyMusicDucking,
+    kAudioDeviceCustomPropertyIOProfile,
+    kAudioDeviceCustomPropertyIOTrace
+};
+
+// The standard properties BGM_Device, BGM_Stream and the controls handle.
+static const AudioObjectPropertySelector kStandardSelectors[] = {
+    kAudioObjectPropertyBaseClass,
+    kAudioObjectPropertyClass,
+    kAudioObjectPropertyOwner,
+    kAudioObjectPropertyName,
+    kAudioObjectPropertyManufacturer,
+    kAudioObjectPropertyOwnedObjects,
+    kAudioObjectPropertyControlList,
+    kAudioObjectPropertyCustomPropertyInfoList,
+    kAudioDevicePropertyDeviceUID,
+    kAudioDevicePropertyModelUID,
+    kAudioDevicePropertyTransportType,
+    kAudioDevicePropertyRelatedDevices,
+    kAudioDevicePropertyClockDomain,
+    kAudioDevicePropertyDeviceIsAlive,
+    kAudioDevicePropertyDeviceIsRunning,
+    kAudioDevicePropertyDeviceCanBeDefaultDevice,
+    kAudioDevicePropertyDeviceCanBeDefaultSystemDevice,
+    kAudioDevicePropertyLatency,
+    kAudioDevicePropertyStreams,
+    kAudioDevicePropertySafetyOffset,
+    kAudioDevicePropertyNominalSampleRate,
+    kAudioDevicePropertyAvailableNominalSampleRates,
+    kAudioDevicePropertyIsHidden,
+    kAudioDevicePropertyZeroTimeStampPeriod,
+    kAudioDevicePropertyIcon,
+    kAudioDevicePropertyPreferredChannelsForStereo,
+    kAudioDevicePropertyPreferredChannelLayout,
+    kAudioStreamPropertyIsActive,
+    kAudioStreamPropertyDirection,
+    kAudioStreamPropertyTerminalType,
+    kAudioStreamPropertyStartingChannel,
+    kAudioStreamPropertyLatency,
+    kAudioStreamPropertyVirtualFormat,
+    kAudioStreamPropertyAvailableVirtualFormats,
+    kAudioStreamPropertyPhysicalFormat,
+    kAudioStreamPropertyAvailablePhysicalFormats,
+    kAudioControlPropertyScope,
+    kAudioControlPropertyElement,
+    kAudioLevelControlPropertyScalarValue,
+    kAudioLevelControlPropertyDecibelValue,
+    kAudioLevelControlPropertyDecibelRange,
+    kAudioLevelControlPropertyConvertScalarToDecibels,
+    kAudioLevelControlPropertyConvertDecibelsToScalar,
+    kAudioBooleanControlPropertyValue
+};
+
+static const AudioObjectPropertyScope kScopes[] = {
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyScopeInput,
+    kAudioObjectPropertyScopeOutput
+};
+
+static const AudioObjectPropertyElement kElements[] = {
+    kAudioObjectPropertyElementMaster,
+    1,
+    2
+};
+
+// The keys used in the custom properties' dictionaries. Keys not in this list are encoded as strings.
+static const char* const kDictionaryKeys[] = {
+    kBGMAppVolumesKey_RelativeVolume,
+    kBGMAppVolumesKey_PanPosition,
+    kBGMAppVolumesKey_ProcessID,
+    kBGMAppVolumesKey_BundleID,
+    kBGMCaptureTapsKey_SegmentName,
+    kBGMMusicDuckingKey_Enabled,
+    kBGMMusicDuckingKey_Gain,
+    kBGMMusicDuckingKey_Threshold,
+    kBGMMusicDuckingKey_AttackSeconds,
+    kBGMMusicDuckingKey_HoldSeconds,
+    kBGMMusicDuckingKey_ReleaseSeconds,
+    kBGMIOProfileKey_Operations,
+    kBGMIOProfileKey_Count,
+    kBGMIOProfileKey_TotalNanos,
+    kBGMIOProfileKey_MaxNanos,
+    kBGMIOProfileKey_Buckets,
+    kBGMIOTraceKey_Path,
+    kBGMIOTraceKey_IncludeBuffers,
+    kBGMIOTraceKey_CapacityBytes,
+    kBGMIOTraceKey_UsedBytes,
+    kBGMIOTraceKey_DroppedRecords
+};
+
+template<typename T, size_t N>
+static constexpr size_t ArrayLength(const T (&)[N]) { return N; }
+
+static const size_t kNumCustomSelectors = ArrayLength(kCustomSelectors);
+static const size_t kNumSelectors = kNumCustomSelectors + ArrayLength(kStandardSelectors);
+
+// Limits that keep each input quick to run.
+static const UInt32 kMaxCallsPerInput = 64;
+static const UInt32 kMaxDataSize = 4096;
+static const UInt32 kMaxCFDepth = 4;
+static const UInt32 kMaxCFContainerItems = 16;
+static const UInt32 kMaxCFObjectsPerValue = 256;
+
+// The clients the fuzzer adds to the device, so the app volumes and music player properties can
+// refer to them.
+static const UInt32 kClientID_Player = 11;
+static const pid_t kClientPID_Player = 4321;
+#define kClientBundleID_Player "com.example.player"
+static const UInt32 kClientID_VoIP = 12;
+static const pid_t kClientPID_VoIP = 4322;
+#define kClientBundleID_VoIP "com.example.voip"
+
+static AudioObjectPropertySelector GetSelector(size_t inIndex)
+{
+    return (inIndex < kNumCustomSelectors) ?
+            kCustomSelectors[inIndex] :
+            kStandardSelectors[inIndex - kNumCustomSelectors];
+}
+
+static bool IsCustomProperty(AudioObjectPropertySelector inSelector)
+{
+    return std::find(std::begin(kCustomSelectors), std::end(kCustomSelectors), inSelector) !=
+            std::end(kCustomSelectors);
+}
+
+// The properties whose values the HAL releases after getting them. (The device's name, UID, etc.
+// aren't returned retained.)
+static bool ReturnsRetainedCFObject(AudioObjectPropertySelector inSelector)
+{
+    return IsCustomProperty(inSelector) || inSelector == kAudioDevicePropertyIcon;
+}
+
+static std::string SelectorToString(AudioObjectPropertySelector inSelector)
+{
+    char theString[5];
+
+    for(int i = 0; i < 4; i++)
+    {
+        const char theChar = static_cast<char>((inSelector >> (24 - 8 * i)) & 0xFF);
+        theString[i] = isalnum(theChar) ? theChar : '_';
+    }
+
+    theString[4] = '\0';
+    return theString;
+}
+
+#pragma mark Reader
+
+// Reads the input. Reading past the end gives zeros.
+class BGM_PropertyFuzzer::Reader
+{
+
+public:
+    Reader(const UInt8* inData, size_t inSize) : mData(inData), mSize(inSize) { }
+
+    bool    IsAtEnd() const { return mOffset >= mSize; }
+
+    UInt8   ReadUInt8()
+    {
+        return (mOffset < mSize) ? mData[mOffset++] : 0;
+    }
+
+    UInt16  ReadUInt16()
+    {
+        const UInt16 theLow = ReadUInt8();
+        return static_cast<UInt16>(theLow | (ReadUInt8() << 8));
+    }
+
+    UInt32  ReadUInt32()
+    {
+        const UInt32 theLow = ReadUInt16();
+        return theLow | (static_cast<UInt32>(ReadUInt16()) << 16);
+    }
+
+    void    ReadBytes(void* outBytes, size_t inSize)
+    {
+        const size_t theAvailable = std::min(inSize, mSize - std::min(mOffset, mSize));
+        memcpy(outBytes, mData + mOffset, theAvailable);
+        memset(static_cast<UInt8*>(outBytes) + theAvailable, 0, inSize - theAvailable);
+        mOffset += theAvailable;
+    }
+
+private:
+    const UInt8*    mData;
+    size_t          mSize;
+    size_t          mOffset = 0;
+
+};
+
+#pragma mark Device
+
+namespace
+{
+
+// Subclass BGM_Device so the fuzzer can create its own instance.
+class BGM_PropertyFuzzerDevice
+:
+    public BGM_Device
+{
+
+public:
+    // Writes IO traces to inTraceDirectory, which has to outlive the device.
+    explicit BGM_PropertyFuzzerDevice(const char* inTraceDirectory)
+    :
+        BGM_Device(kObjectID_Device,
+                   CFSTR(kDeviceName),
+                   CFSTR(kBGMDeviceUID),
+                   CFSTR(kBGMDeviceModelUID),
+                   kObjectID_Stream_Input,
+                   kObjectID_Stream_Output,
+                   kObjectID_Volume_Output_Master,
+                   kObjectID_Mute_Output_Master,
+                   kBGMLoopbackSegmentName,
+                   kBGMCaptureTapSegmentNamePrefix,
+                   inTraceDirectory)
+    {
+        Activate();
+    }
+
+};
+
+}
+
+#pragma mark Construction/Destruction
+
+BGM_PropertyFuzzer::BGM_PropertyFuzzer()
+{
+    const char* theTempDir = getenv("TMPDIR");
+    std::string theTemplate = std::string((theTempDir != nullptr) ? theTempDir : "/tmp") +
+            "/BGMPropertyFuzzer.XXXXXX";
+    ThrowIfNULL(mkdtemp(&theTemplate[0]),
+                CAException(kAudioHardwareUnspecifiedError),
+                "BGM_PropertyFuzzer::BGM_PropertyFuzzer: Couldn't create the trace directory");
+    mTraceDirectory = theTemplate;
+
+    BGM_PlugIn::SetHost(&mHost);
+    mDevice.reset(new BGM_PropertyFuzzerDevice(mTraceDirectory.c_str()));
+
+    mHost.AddClient(*mDevice, kClientID_Player, kClientPID_Player, CFSTR(kClientBundleID_Player));
+    mHost.AddClient(*mDevice, kClientID_VoIP, kClientPID_VoIP, CFSTR(kClientBundleID_VoIP));
+
+    SaveProperties();
+}
+
+BGM_PropertyFuzzer::~BGM_PropertyFuzzer()
+{
+    mDevice.reset();
+
+    for(const SavedProperty& theProperty : mSavedProperties)
+    {
+        if(theProperty.mIsCFType)
+        {
+            CFTypeRef theValue = nullptr;
+            memcpy(&theValue, theProperty.mData.data(), sizeof(CFTypeRef));
+
+            if(theValue != nullptr)
+            {
+                CFRelease(theValue);
+            }
+        }
+    }
+
+    // Let the device finish sending its notifications before removing the host.
+    CADispatchQueue::GetGlobalSerialQueue().Dispatch(true, ^{});
+    BGM_PlugIn::SetHost(nullptr);
+
+    RemoveTraces();
+    rmdir(mTraceDirectory.c_str());
+}
+
+BGM_Device& BGM_PropertyFuzzer::GetDevice()
+{
+    return *mDevice;
+}
+
+#pragma mark Running Inputs
+
+void    BGM_PropertyFuzzer::RunInput(const UInt8* inData, size_t inSize)
+{
+    Reader theReader(inData, inSize);
+    mDidSetProperty = false;
+
+    for(UInt32 i = 0; i < kMaxCallsPerInput && !theReader.IsAtEnd(); i++)
+    {
+        RunCall(theReader);
+    }
+
+    // Apply the config changes the input requested, e.g. to the enabled controls or sample rate, so
+    // that code gets fuzzed as well.
+    mHost.PerformConfigChanges(*mDevice);
+
+    if(mDidSetProperty)
+    {
+        RestoreProperties();
+    }
+
+    mHost.ClearNotifications();
+}
+
+void    BGM_PropertyFuzzer::RunCall(Reader& inReader)
+{
+    const UInt8 theOp = inReader.ReadUInt8() % kOp_Count;
+
+    UInt8 theIndex = inReader.ReadUInt8() % (ArrayLength(kObjectIDs) + 1);
+    const AudioObjectID theObjectID =
+            (theIndex < ArrayLength(kObjectIDs)) ? kObjectIDs[theIndex] : inReader.ReadUInt32();
+
+    AudioObjectPropertyAddress theAddress;
+
+    theIndex = inReader.ReadUInt8() % (kNumSelectors + 1);
+    theAddress.mSelector = (theIndex < kNumSelectors) ? GetSelector(theIndex) : inReader.ReadUInt32();
+
+    theIndex = inReader.ReadUInt8() % (ArrayLength(kScopes) + 1);
+    theAddress.mScope = (theIndex < ArrayLength(kScopes)) ? kScopes[theIndex] : inReader.ReadUInt32();
+
+    theIndex = inReader.ReadUInt8() % (ArrayLength(kElements) + 1);
+    theAddress.mElement =
+            (theIndex < ArrayLength(kElements)) ? kElements[theIndex] : inReader.ReadUInt32();
+
+    // Allocate the buffers with exactly the sizes given, so ASan can catch the device going past them.
+    const UInt32 theQualifierSize = inReader.ReadUInt8();
+    std::unique_ptr<UInt8[]> theQualifier;
+
+    if(theQualifierSize > 0)
+    {
+        theQualifier.reset(new UInt8[theQualifierSize]);
+        inReader.ReadBytes(theQualifier.get(), theQualifierSize);
+    }
+
+    UInt32 theDataSize = 0;
+    std::unique_ptr<UInt8[]> theData;
+    CFTypeRef theValue = nullptr;
+
+    if(theOp == kOp_GetPropertyData)
+    {
+        theDataSize = inReader.ReadUInt16() % (kMaxDataSize + 1);
+        theData.reset(new UInt8[theDataSize]);
+    }
+    else if(theOp == kOp_SetPropertyData && IsCustomProperty(theAddress.mSelector))
+    {
+        const UInt8 theFlags = inReader.ReadUInt8();
+        theDataSize = (theFlags & kSetFlag_CustomSize) ?
+                (inReader.ReadUInt16() % (kMaxDataSize + 1)) :
+                static_cast<UInt32>(sizeof(CFTypeRef));
+
+        mCFObjectCount = 0;
+        theValue = DecodeCFValue(inReader, 0);
+
+        theData.reset(new UInt8[theDataSize]());
+
+        if(theDataSize >= sizeof(CFTypeRef))
+        {
+            memcpy(theData.get(), &theValue, sizeof(CFTypeRef));
+        }
+    }
+    else if(theOp == kOp_SetPropertyData)
+    {
+        theDataSize = inReader.ReadUInt16() % (kMaxDataSize + 1);
+        theData.reset(new UInt8[theDataSize]);
+        inReader.ReadBytes(theData.get(), theDataSize);
+    }
+
+    // BGM_PlugInInterface catches everything the device throws and returns an error code to the HAL.
+    try
+    {
+        switch(theOp)
+        {
+            case kOp_HasProperty:
+                mDevice->HasProperty(theObjectID, kClientPID_Player, theAddress);
+                break;
+
+            case kOp_IsPropertySettable:
+                mDevice->IsPropertySettable(theObjectID, kClientPID_Player, theAddress);
+                break;
+
+            case kOp_GetPropertyDataSize:
+                mDevice->GetPropertyDataSize(theObjectID,
+                                             kClientPID_Player,
+                                             theAddress,
+                                             theQualifierSize,
+                                             theQualifier.get());
+                break;
+
+            case kOp_GetPropertyData:
+                {
+                    UInt32 theDataSizeOut = 0;
+                    mDevice->GetPropertyData(theObjectID,
+                                             kClientPID_Player,
+                                             theAddress,
+                                             theQualifierSize,
+                                             theQualifier.get(),
+                                             theDataSize,
+                                             theDataSizeOut,
+                                             theData.get());
+
+                    if(theDataSizeOut > theDataSize)
+                    {
+                        fprintf(stderr,
+                                "BGM_PropertyFuzzer: GetPropertyData for '%s' on object %u returned %u "
+                                "bytes, but was only given %u\n",
+                                SelectorToString(theAddress.mSelector).c_str(),
+                                theObjectID,
+                                theDataSizeOut,
+                                theDataSize);
+                        abort();
+                    }
+
+                    if(ReturnsRetainedCFObject(theAddress.mSelector) &&
+                       theDataSizeOut >= sizeof(CFTypeRef))
+                    {
+                        CFTypeRef theReturnedValue = nullptr;
+                        memcpy(&theReturnedValue, theData.get(), sizeof(CFTypeRef));
+
+                        if(theReturnedValue != nullptr)
+                        {
+                            CFRelease(theReturnedValue);
+                        }
+                    }
+                }
+                break;
+
+            case kOp_SetPropertyData:
+                mDidSetProperty = true;
+                mDevice->SetPropertyData(theObjectID,
+                                         kClientPID_Player,
+                                         theAddress,
+                                         theQualifierSize,
+                                         theQualifier.get(),
+                                         theDataSize,
+                                         theData.get());
+                break;
+        };
+    }
+    catch(...)
+    {
+    }
+
+    if(theValue != nullptr)
+    {
+        CFRelease(theValue);
+    }
+}
+
+#pragma mark Decoding CF Values
+
+CFTypeRef __nullable    BGM_PropertyFuzzer::DecodeCFValue(Reader& inReader, UInt32 inDepth)
+{
+    const UInt8 theTag = inReader.ReadUInt8() % kCFTag_Count;
+
+    if(theTag == kCFTag_Null || ++mCFObjectCount > kMaxCFObjectsPerValue)
+    {
+        return nullptr;
+    }
+
+    switch(theTag)
+    {
+        case kCFTag_String:
+            return DecodeCFString(inReader);
+
+        case kCFTag_SInt32:
+            {
+                const SInt32 theNumber = static_cast<SInt32>(inReader.ReadUInt32());
+                return CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &theNumber);
+            }
+
+        case kCFTag_SInt64:
+            {
+                SInt64 theNumber;
+                inReader.ReadBytes(&theNumber, sizeof(theNumber));
+                return CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt64Type, &theNumber);
+            }
+
+        case kCFTag_Float32:
+            {
+                Float32 theNumber;
+                inReader.ReadBytes(&theNumber, sizeof(theNumber));
+                return CFNumberCreate(kCFAllocatorDefault, kCFNumberFloat32Type, &theNumber);
+            }
+
+        case kCFTag_Float64:
+            {
+                Float64 theNumber;
+                inReader.ReadBytes(&theNumber, sizeof(theNumber));
+                return CFNumberCreate(kCFAllocatorDefault, kCFNumberFloat64Type, &theNumber);
+            }
+
+        case kCFTag_Boolean:
+            return (inReader.ReadUInt8() & 1) ? kCFBooleanTrue : kCFBooleanFalse;
+
+        case kCFTag_Data:
+            {
+                UInt8 theBytes[UINT8_MAX];
+                const UInt8 theLength = inReader.ReadUInt8();
+                inReader.ReadBytes(theBytes, theLength);
+                return CFDataCreate(kCFAllocatorDefault, theBytes, theLength);
+            }
+
+        case kCFTag_Array:
+            {
+                const UInt32 theCount = inReader.ReadUInt8() % (kMaxCFContainerItems + 1);
+
+                if(inDepth >= kMaxCFDepth)
+                {
+                    return nullptr;
+                }
+
+                CACFArray theArray(false);
+
+                for(UInt32 i = 0; i < theCount; i++)
+                {
+                    CFTypeRef theItem = DecodeCFValue(inReader, inDepth + 1);
+
+                    // CFArrays can't hold null, so the item is just left out.
+                    if(theItem != nullptr)
+                    {
+                        theArray.AppendCFType(theItem);
+                        CFRelease(theItem);
+                    }
+                }
+
+                return theArray.GetCFArray();
+            }
+
+        case kCFTag_Dictionary:
+            {
+                const UInt32 theCount = inReader.ReadUInt8() % (kMaxCFContainerItems + 1);
+
+                if(inDepth >= kMaxCFDepth)
+                {
+                    return nullptr;
+                }
+
+                CACFDictionary theDictionary(false);
+
+                for(UInt32 i = 0; i < theCount; i++)
+                {
+                    // Property lists only have string keys.
+                    const UInt8 theKeyIndex = inReader.ReadUInt8() % (ArrayLength(kDictionaryKeys) + 1);
+                    CFStringRef theKey = (theKeyIndex < ArrayLength(kDictionaryKeys)) ?
+                            CFStringCreateWithCString(kCFAllocatorDefault,
+                                                      kDictionaryKeys[theKeyIndex],
+                                                      kCFStringEncodingUTF8) :
+                            DecodeCFString(inReader);
+
+                    CFTypeRef theValue = DecodeCFValue(inReader, inDepth + 1);
+
+                    if(theKey != nullptr && theValue != nullptr)
+                    {
+                        theDictionary.AddCFType(theKey, theValue);
+                    }
+
+                    if(theKey != nullptr)
+                    {
+                        CFRelease(theKey);
+                    }
+
+                    if(theValue != nullptr)
+                    {
+                        CFRelease(theValue);
+                    }
+                }
+
+                return theDictionary.GetCFDictionary();
+            }
+    };
+
+    return nullptr;
+}
+
+CFStringRef __nullable  BGM_PropertyFuzzer::DecodeCFString(Reader& inReader)
+{
+    char theBytes[UINT8_MAX];
+    const UInt8 theLength = inReader.ReadUInt8();
+    inReader.ReadBytes(theBytes, theLength);
+
+    std::string theString(theBytes, theLength);
+
+    CFStringRef theCFString = CFStringCreateWithBytes(kCFAllocatorDefault,
+                                                      reinterpret_cast<const UInt8*>(theString.data()),
+                                                      static_cast<CFIndex>(theString.size()),
+                                                      kCFStringEncodingUTF8,
+                                                      false);
+
+    if(theCFString == nullptr)
+    {
+        // Not valid UTF-8. Every byte sequence is valid Latin-1.
+        theCFString = CFStringCreateWithBytes(kCFAllocatorDefault,
+                                              reinterpret_cast<const UInt8*>(theString.data()),
+                                              static_cast<CFIndex>(theString.size()),
+                                              kCFStringEncodingISOLatin1,
+                                              false);
+    }
+
+    return theCFString;
+}
+
+#pragma mark Restoring the Device State
+
+void    BGM_PropertyFuzzer::SaveProperties()
+{
+    for(AudioObjectPropertySelector theSelector : kCustomSelectors)
+    {
+        SaveProperty(kObjectID_Device,
+                     { theSelector, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMaster });
+    }
+
+    SaveProperty(kObjectID_Device,
+                 { kAudioDevicePropertyNominalSampleRate,
+                   kAudioObjectPropertyScopeGlobal,
+                   kAudioObjectPropertyElementMaster });
+    SaveProperty(kObjectID_Volume_Output_Master,
+                 { kAudioLevelControlPropertyScalarValue,
+                   kAudioObjectPropertyScopeGlobal,
+                   kAudioObjectPropertyElementMaster });
+    SaveProperty(kObjectID_Mute_Output_Master,
+                 { kAudioBooleanControlPropertyValue,
+                   kAudioObjectPropertyScopeGlobal,
+                   kAudioObjectPropertyElementMaster });
+}
+
+void    BGM_PropertyFuzzer::SaveProperty(AudioObjectID inObjectID,
+                                         const AudioObjectPropertyAddress& inAddress)
+{
+    try
+    {
+        if(!mDevice->HasProperty(inObjectID, 0, inAddress) ||
+           !mDevice->IsPropertySettable(inObjectID, 0, inAddress))
+        {
+            return;
+        }
+
+        SavedProperty theProperty { inObjectID, inAddress, {}, IsCustomProperty(inAddress.mSelector) };
+        UInt32 theSize = mDevice->GetPropertyDataSize(inObjectID, 0, inAddress, 0, nullptr);
+        theProperty.mData.resize(theSize);
+
+        mDevice->GetPropertyData(inObjectID,
+                                 0,
+                                 inAddress,
+                                 0,
+                                 nullptr,
+                                 theSize,
+                                 theSize,
+                                 theProperty.mData.data());
+        theProperty.mData.resize(theSize);
+
+        mSavedProperties.push_back(theProperty);
+    }
+    catch(...)
+    {
+        DebugMsg("BGM_PropertyFuzzer::SaveProperty: Couldn't save '%s'",
+                 SelectorToString(inAddress.mSelector).c_str());
+    }
+}
+
+void    BGM_PropertyFuzzer::RestoreProperties()
+{
+    // Restore the device's properties first, since they can disable the controls.
+    for(bool theRestoringDevice : { true, false })
+    {
+        for(const SavedProperty& theProperty : mSavedProperties)
+        {
+            if((theProperty.mObjectID == kObjectID_Device) == theRestoringDevice)
+            {
+                try
+                {
+                    mDevice->SetPropertyData(theProperty.mObjectID,
+                                             0,
+                                             theProperty.mAddress,
+                                             0,
+                                             nullptr,
+                                             static_cast<UInt32>(theProperty.mData.size()),
+                                             theProperty.mData.data());
+                }
+                catch(...)
+                {
+                    // Some of the initial values can't be set, e.g. there's no music player process.
+                }
+            }
+        }
+
+        mHost.PerformConfigChanges(*mDevice);
+    }
+
+    RemoveTraces();
+}
+
+void    BGM_PropertyFuzzer::RemoveTraces()
+{
+    DIR* theDirectory = opendir(mTraceDirectory.c_str());
+
+    if(theDirectory != nullptr)
+    {
+        while(struct dirent* theEntry = readdir(theDirectory))
+        {
+            if(strcmp(theEntry->d_name, ".") != 0 && strcmp(theEntry->d_name, "..") != 0)
+            {
+                unlink((mTraceDirectory + "/" + theEntry->d_name).c_str());
+            }
+        }
+
+        closedir(theDirectory);
+    }
+}
+
+#pragma mark Custom Properties and Seeds
+
+std::vector<AudioObjectPropertySelector> BGM_PropertyFuzzer::GetCustomProperties()
+{
+    return std::vector<AudioObjectPropertySelector>(std::begin(kCustomSelectors),
+                                                    std::end(kCustomSelectors));
+}
+
+std::vector<AudioObjectPropertySelector> BGM_PropertyFuzzer::GetStandardProperties()
+{
+    return std::vector<AudioObjectPropertySelector>(std::begin(kStandardSelectors),
+                                                    std::end(kStandardSelectors));
+}
+
+static CFDictionaryRef CreateDictionary(std::initializer_list<std::pair<const char*, CFTypeRef>> inEntries)
+{
+    CACFDictionary theDictionary(false);
+
+    for(const auto& theEntry : inEntries)
+    {
+        theDictionary.AddCFTypeWithCStringKey(theEntry.first, theEntry.second);
+    }
+
+    return theDictionary.GetCFDictionary();
+}
+
+static CFArrayRef CreateArray(std::initializer_list<CFTypeRef> inItems)
+{
+    CACFArray theArray(false);
+
+    for(CFTypeRef theItem : inItems)
+    {
+        theArray.AppendCFType(theItem);
+    }
+
+    return theArray.GetCFArray();
+}
+
+std::vector<BGM_PropertyFuzzer::Seed> BGM_PropertyFuzzer::GetSeeds()
+{
+    std::vector<Seed> theSeeds;
+
+    CACFString thePlayerBundleID(kClientBundleID_Player);
+    CACFString theVoIPBundleID(kClientBundleID_VoIP);
+
+    // A plausible value for each of the custom properties, including the read-only ones.
+    std::vector<std::pair<AudioObjectPropertySelector, CFTypeRef>> theValues;
+
+    theValues.push_back({ kAudioDeviceCustomPropertyMusicPlayerProcessID,
+                          CACFNumber(static_cast<SInt32>(kClientPID_Player)).CopyCFNumber() });
+    theValues.push_back({ kAudioDeviceCustomPropertyMusicPlayerBundleID,
+                          thePlayerBundleID.CopyCFString() });
+    theValues.push_back({ kAudioDeviceCustomPropertyDeviceAudibleState,
+                          CACFNumber(static_cast<SInt32>(kBGMDeviceIsAudible)).CopyCFNumber() });
+    theValues.push_back({ kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp,
+                          CFRetain(kCFBooleanTrue) });
+
+    CACFNumber theRelativeVolume(static_cast<SInt32>(75));
+    CACFNumber thePanPosition(static_cast<SInt32>(-20));
+    CACFNumber thePlayerPID(static_cast<SInt32>(kClientPID_Player));
+    CACFNumber theVoIPVolume(static_cast<SInt32>(25));
+    CACFDictionary thePlayerVolume(CreateDictionary({
+        { kBGMAppVolumesKey_RelativeVolume, theRelativeVolume.GetCFNumber() },
+        { kBGMAppVolumesKey_PanPosition, thePanPosition.GetCFNumber() },
+        { kBGMAppVolumesKey_ProcessID, thePlayerPID.GetCFNumber() },
+        { kBGMAppVolumesKey_BundleID, thePlayerBundleID.GetCFString() }
+    }), true);
+    CACFDictionary theVoIPVolumeDict(CreateDictionary({
+        { kBGMAppVolumesKey_RelativeVolume, theVoIPVolume.GetCFNumber() },
+        { kBGMAppVolumesKey_BundleID, theVoIPBundleID.GetCFString() }
+    }), true);
+    theValues.push_back({ kAudioDeviceCustomPropertyAppVolumes,
+                          CreateArray({ thePlayerVolume.GetCFDictionary(),
+                                        theVoIPVolumeDict.GetCFDictionary() }) });
+
+    theValues.push_back({ kAudioDeviceCustomPropertyEnabledOutputControls,
+                          CreateArray({ kCFBooleanFalse, kCFBooleanTrue }) });
+    theValues.push_back({ kAudioDeviceCustomPropertyLoopbackSharedMemory, CFRetain(kCFBooleanTrue) });
+
+    CACFDictionary theTap(CreateDictionary({
+        { kBGMCaptureTapsKey_BundleID, thePlayerBundleID.GetCFString() }
+    }), true);
+    theValues.push_back({ kAudioDeviceCustomPropertyCaptureTaps,
+                          CreateArray({ theTap.GetCFDictionary() }) });
+
+    theValues.push_back({ kAudioDeviceCustomPropertyBoostLimiter, CFRetain(kCFBooleanTrue) });
+
+    CACFNumber theGain(0.25);
+    CACFNumber theThreshold(-40.0);
+    CACFNumber theAttack(0.01);
+    CACFNumber theHold(0.5);
+    CACFNumber theRelease(0.3);
+    theValues.push_back({ kAudioDeviceCustomPropertyMusicDucking, CreateDictionary({
+        { kBGMMusicDuckingKey_Enabled, kCFBooleanTrue },
+        { kBGMMusicDuckingKey_Gain, theGain.GetCFNumber() },
+        { kBGMMusicDuckingKey_Threshold, theThreshold.GetCFNumber() },
+        { kBGMMusicDuckingKey_AttackSeconds, theAttack.GetCFNumber() },
+        { kBGMMusicDuckingKey_HoldSeconds, theHold.GetCFNumber() },
+        { kBGMMusicDuckingKey_ReleaseSeconds, theRelease.GetCFNumber() }
+    }) });
+
+    theValues.push_back({ kAudioDeviceCustomPropertyIOProfile, CreateDictionary({}) });
+
+    CACFString theTracePath("fuzz.bgmtrace");
+    CACFNumber theTraceCapacity(static_cast<SInt64>(64 * 1024));
+    theValues.push_back({ kAudioDeviceCustomPropertyIOTrace, CreateDictionary({
+        { kBGMIOTraceKey_Enabled, kCFBooleanTrue },
+        { kBGMIOTraceKey_Path, theTracePath.GetCFString() },
+        { kBGMIOTraceKey_IncludeBuffers, kCFBooleanTrue },
+        { kBGMIOTraceKey_CapacityBytes, theTraceCapacity.GetCFNumber() }
+    }) });
+
+    for(const auto& theValue : theValues)
+    {
+        const AudioObjectPropertyAddress theAddress = {
+            theValue.first,
+            kAudioObjectPropertyScopeGlobal,
+            kAudioObjectPropertyElementMaster
+        };
+
+        // Query the property, set it, then read it back, like BGMApp would.
+        Encoder theEncoder;
+        theEncoder.HasProperty(kObjectID_Device, theAddress)
+                  .IsPropertySettable(kObjectID_Device, theAddress)
+                  .GetPropertyDataSize(kObjectID_Device, theAddress)
+                  .GetPropertyData(kObjectID_Device, theAddress, sizeof(CFTypeRef))
+                  .SetPropertyData(kObjectID_Device, theAddress, theValue.second)
+                  .GetPropertyData(kObjectID_Device, theAddress, sizeof(CFTypeRef));
+
+        // Stop recording the trace, so the seed covers writing it.
+        if(theValue.first == kAudioDeviceCustomPropertyIOTrace)
+        {
+            CFDictionaryRef theStop = CreateDictionary({ { kBGMIOTraceKey_Enabled, kCFBooleanFalse } });
+            theEncoder.SetPropertyData(kObjectID_Device, theAddress, theStop);
+            CFRelease(theStop);
+        }
+
+        theSeeds.push_back({ "custom-" + SelectorToString(theValue.first), theEncoder.GetData() });
+        CFRelease(theValue.second);
+    }
+
+    // Some of the standard properties, to give the fuzzer examples of the raw data they take.
+    const Float64 theSampleRate = 48000.0;
+    const Float32 theVolume = 0.5f;
+    const UInt32 theMute = 1;
+    const AudioStreamBasicDescription theFormat = {
+        96000.0, kAudioFormatLinearPCM,
+        kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked,
+        8, 1, 8, 2, 32, 0
+    };
+
+    Encoder theStandardEncoder;
+    theStandardEncoder
+        .SetPropertyData(kObjectID_Device,
+                         { kAudioDevicePropertyNominalSampleRate,
+                           kAudioObjectPropertyScopeGlobal,
+                           kAudioObjectPropertyElementMaster },
+                         sizeof(theSampleRate),
+                         &theSampleRate)
+        .GetPropertyData(kObjectID_Device,
+                         { kAudioDevicePropertyAvailableNominalSampleRates,
+                           kAudioObjectPropertyScopeGlobal,
+                           kAudioObjectPropertyElementMaster },
+                         256)
+        .SetPropertyData(kObjectID_Stream_Output,
+                         { kAudioStreamPropertyVirtualFormat,
+                           kAudioObjectPropertyScopeGlobal,
+                           kAudioObjectPropertyElementMaster },
+                         sizeof(theFormat),
+                         &theFormat)
+        .GetPropertyData(kObjectID_Stream_Input,
+                         { kAudioStreamPropertyAvailablePhysicalFormats,
+                           kAudioObjectPropertyScopeGlobal,
+                           kAudioObjectPropertyElementMaster },
+                         1024)
+        .SetPropertyData(kObjectID_Volume_Output_Master,
+                         { kAudioLevelControlPropertyScalarValue,
+                           kAudioObjectPropertyScopeGlobal,
+                           kAudioObjectPropertyElementMaster },
+                         sizeof(theVolume),
+                         &theVolume)
+        .GetPropertyData(kObjectID_Volume_Output_Master,
+                         { kAudioLevelControlPropertyDecibelValue,
+                           kAudioObjectPropertyScopeGlobal,
+                           kAudioObjectPropertyElementMaster },
+                         sizeof(Float32))
+        .SetPropertyData(kObjectID_Mute_Output_Master,
+                         { kAudioBooleanControlPropertyValue,
+                           kAudioObjectPropertyScopeGlobal,
+                           kAudioObjectPropertyElementMaster },
+                         sizeof(theMute),
+                         &theMute)
+        .GetPropertyData(kObjectID_Device,
+                         { kAudioObjectPropertyCustomPropertyInfoList,
+                           kAudioObjectPropertyScopeGlobal,
+                           kAudioObjectPropertyElementMaster },
+                         1024)
+        .GetPropertyData(kObjectID_Device,
+                         { kAudioObjectPropertyOwnedObjects,
+                           kAudioObjectPropertyScopeGlobal,
+                           kAudioObjectPropertyElementMaster },
+                         256);
+
+    theSeeds.push_back({ "standard-properties", theStandardEncoder.GetData() });
+
+    return theSeeds;
+}
+
+void    BGM_PropertyFuzzer::WriteSeeds(const char* inDirectory)
+{
+    for(const Seed& theSeed : GetSeeds())
+    {
+        const std::string thePath = std::string(inDirectory) + "/" + theSeed.mName;
+        FILE* theFile = fopen(thePath.c_str(), "wb");
+
+        ThrowIfNULL(theFile,
+                    CAException(kAudioHardwareUnspecifiedError),
+                    "BGM_PropertyFuzzer::WriteSeeds: Couldn't open the file");
+
+        fwrite(theSeed.mData.data(), 1, theSeed.mData.size(), theFile);
+        fclose(theFile);
+    }
+}
+
+#pragma mark Encoder
+
+BGM_PropertyFuzzer::Encoder&    BGM_PropertyFuzzer::Encoder::HasProperty(AudioObjectID inObjectID,
+                                                                         const AudioObjectPropertyAddress& inAddress)
+{
+    AppendCall(kOp_HasProperty, inObjectID, inAddress);
+    return *this;
+}
+
+BGM_PropertyFuzzer::Encoder&    BGM_PropertyFuzzer::Encoder::IsPropertySettable(AudioObjectID inObjectID,
+                                                                                const AudioObjectPropertyAddress& inAddress)
+{
+    AppendCall(kOp_IsPropertySettable, inObjectID, inAddress);
+    return *this;
+}
+
+BGM_PropertyFuzzer::Encoder&    BGM_PropertyFuzzer::Encoder::GetPropertyDataSize(AudioObjectID inObjectID,
+                                                                                 const AudioObjectPropertyAddress& inAddress)
+{
+    AppendCall(kOp_GetPropertyDataSize, inObjectID, inAddress);
+    return *this;
+}
+
+BGM_PropertyFuzzer::Encoder&    BGM_PropertyFuzzer::Encoder::GetPropertyData(AudioObjectID inObjectID,
+                                                                             const AudioObjectPropertyAddress& inAddress,
+                                                                             UInt32 inDataSize)
+{
+    ThrowIf(inDataSize > kMaxDataSize,
+            CAException(kAudioHardwareBadPropertySizeError),
+            "BGM_PropertyFuzzer::Encoder::GetPropertyData: Size too large");
+
+    AppendCall(kOp_GetPropertyData, inObjectID, inAddress);
+    AppendUInt16(static_cast<UInt16>(inDataSize));
+    return *this;
+}
+
+BGM_PropertyFuzzer::Encoder&    BGM_PropertyFuzzer::Encoder::SetPropertyData(AudioObjectID inObjectID,
+                                                                             const AudioObjectPropertyAddress& inAddress,
+                                                                             UInt32 inDataSize,
+                                                                             const void* inData)
+{
+    ThrowIf(IsCustomProperty(inAddress.mSelector),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_PropertyFuzzer::Encoder::SetPropertyData: The custom properties take CF values");
+    ThrowIf(inDataSize > kMaxDataSize,
+            CAException(kAudioHardwareBadPropertySizeError),
+            "BGM_PropertyFuzzer::Encoder::SetPropertyData: Size too large");
+
+    AppendCall(kOp_SetPropertyData, inObjectID, inAddress);
+    AppendUInt16(static_cast<UInt16>(inDataSize));
+    AppendBytes(inData, inDataSize);
+    return *this;
+}
+
+BGM_PropertyFuzzer::Encoder&    BGM_PropertyFuzzer::Encoder::SetPropertyData(AudioObjectID inObjectID,
+                                                                             const AudioObjectPropertyAddress& inAddress,
+                                                                             CFTypeRef __nullable inValue)
+{
+    ThrowIf(!IsCustomProperty(inAddress.mSelector),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_PropertyFuzzer::Encoder::SetPropertyData: Only the custom properties take CF values");
+
+    AppendCall(kOp_SetPropertyData, inObjectID, inAddress);
+    mData.push_back(0);  // No flags.
+    AppendCFValue(inValue);
+    return *this;
+}
+
+void    BGM_PropertyFuzzer::Encoder::AppendCall(UInt8 inOp,
+                                                AudioObjectID inObjectID,
+                                                const AudioObjectPropertyAddress& inAddress)
+{
+    mData.push_back(inOp);
+
+    // Each of these is an index into its table or, if it isn't in the table, one past the end
+    // followed by the value.
+    auto theObjectItr = std::find(std::begin(kObjectIDs), std::end(kObjectIDs), inObjectID);
+    mData.push_back(static_cast<UInt8>(theObjectItr - std::begin(kObjectIDs)));
+
+    if(theObjectItr == std::end(kObjectIDs))
+    {
+        AppendUInt32(inObjectID);
+    }
+
+    size_t theSelectorIndex = 0;
+
+    while(theSelectorIndex < kNumSelectors && GetSelector(theSelectorIndex) != inAddress.mSelector)
+    {
+        theSelectorIndex++;
+    }
+
+    mData.push_back(static_cast<UInt8>(theSelectorIndex));
+
+    if(theSelectorIndex == kNumSelectors)
+    {
+        AppendUInt32(inAddress.mSelector);
+    }
+
+    auto theScopeItr = std::find(std::begin(kScopes), std::end(kScopes), inAddress.mScope);
+    mData.push_back(static_cast<UInt8>(theScopeItr - std::begin(kScopes)));
+
+    if(theScopeItr == std::end(kScopes))
+    {
+        AppendUInt32(inAddress.mScope);
+    }
+
+    auto theElementItr = std::find(std::begin(kElements), std::end(kElements), inAddress.mElement);
+    mData.push_back(static_cast<UInt8>(theElementItr - std::begin(kElements)));
+
+    if(theElementItr == std::end(kElements))
+    {
+        AppendUInt32(inAddress.mElement);
+    }
+
+    // No qualifier.
+    mData.push_back(0);
+}
+
+void    BGM_PropertyFuzzer::Encoder::AppendUInt16(UInt16 inValue)
+{
+    mData.push_back(static_cast<UInt8>(inValue & 0xFF));
+    mData.push_back(static_cast<UInt8>(inValue >> 8));
+}
+
+void    BGM_PropertyFuzzer::Encoder::AppendUInt32(UInt32 inValue)
+{
+    AppendUInt16(static_cast<UInt16>(inValue & 0xFFFF));
+    AppendUInt16(static_cast<UInt16>(inValue >> 16));
+}
+
+void    BGM_PropertyFuzzer::Encoder::AppendBytes(const void* inBytes, size_t inSize)
+{
+    const UInt8* theBytes = static_cast<const UInt8*>(inBytes);
+    mData.insert(mData.end(), theBytes, theBytes + inSize);
+}
+
+void    BGM_PropertyFuzzer::Encoder::AppendCFString(CFStringRef inString)
+{
+    char theBytes[UINT8_MAX + 1];
+    CFIndex theLength = 0;
+
+    // Strings longer than the format allows are truncated.
+    CFStringGetBytes(inString,
+                     CFRangeMake(0, CFStringGetLength(inString)),
+                     kCFStringEncodingUTF8,
+                     '?',
+                     false,
+                     reinterpret_cast<UInt8*>(theBytes),
+                     UINT8_MAX,
+                     &theLength);
+
+    mData.push_back(static_cast<UInt8>(theLength));
+    AppendBytes(theBytes, static_cast<size_t>(theLength));
+}
+
+void    BGM_PropertyFuzzer::Encoder::AppendCFValue(CFTypeRef __nullable inValue)
+{
+    if(inValue == nullptr)
+    {
+        mData.push_back(kCFTag_Null);
+        return;
+    }
+
+    const CFTypeID theTypeID = CFGetTypeID(inValue);
+
+    if(theTypeID == CFStringGetTypeID())
+    {
+        mData.push_back(kCFTag_String);
+        AppendCFString(static_cast<CFStringRef>(inValue));
+    }
+    else if(theTypeID == CFNumberGetTypeID())
+    {
+        CFNumberRef theNumber = static_cast<CFNumberRef>(inValue);
+
+        if(CFNumberIsFloatType(theNumber))
+        {
+            Float64 theValue = 0.0;
+            CFNumberGetValue(theNumber, kCFNumberFloat64Type, &theValue);
+            mData.push_back(kCFTag_Float64);
+            AppendBytes(&theValue, sizeof(theValue));
+        }
+        else
+        {
+            SInt64 theValue = 0;
+            CFNumberGetValue(theNumber, kCFNumberSInt64Type, &theValue);
+            mData.push_back(kCFTag_SInt64);
+            AppendBytes(&theValue, sizeof(theValue));
+        }
+    }
+    else if(theTypeID == CFBooleanGetTypeID())
+    {
+        mData.push_back(kCFTag_Boolean);
+        mData.push_back(CFBooleanGetValue(static_cast<CFBooleanRef>(inValue)) ? 1 : 0);
+    }
+    else if(theTypeID == CFDataGetTypeID())
+    {
+        CFDataRef theData = static_cast<CFDataRef>(inValue);
+        const CFIndex theLength = std::min<CFIndex>(CFDataGetLength(theData), UINT8_MAX);
+        mData.push_back(kCFTag_Data);
+        mData.push_back(static_cast<UInt8>(theLength));
+        AppendBytes(CFDataGetBytePtr(theData), static_cast<size_t>(theLength));
+    }
+    else if(theTypeID == CFArrayGetTypeID())
+    {
+        CFArrayRef theArray = static_cast<CFArrayRef>(inValue);
+        const CFIndex theCount = std::min<CFIndex>(CFArrayGetCount(theArray), kMaxCFContainerItems);
+        mData.push_back(kCFTag_Array);
+        mData.push_back(static_cast<UInt8>(theCount));
+
+        for(CFIndex i = 0; i < theCount; i++)
+        {
+            AppendCFValue(CFArrayGetValueAtIndex(theArray, i));
+        }
+    }
+    else if(theTypeID == CFDictionaryGetTypeID())
+    {
+        CFDictionaryRef theDictionary = static_cast<CFDictionaryRef>(inValue);
+        const CFIndex theCount = CFDictionaryGetCount(theDictionary);
+
+        std::vector<const void*> theKeys(static_cast<size_t>(theCount));
+        std::vector<const void*> theValues(static_cast<size_t>(theCount));
+        CFDictionaryGetKeysAndValues(theDictionary, theKeys.data(), theValues.data());
+
+        const CFIndex theEncodedCount = std::min<CFIndex>(theCount, kMaxCFContainerItems);
+        mData.push_back(kCFTag_Dictionary);
+        mData.push_back(static_cast<UInt8>(theEncodedCount));
+
+        for(CFIndex i = 0; i < theEncodedCount; i++)
+        {
+            CFStringRef theKey = static_cast<CFStringRef>(theKeys[static_cast<size_t>(i)]);
+            size_t theKeyIndex = 0;
+
+            while(theKeyIndex < ArrayLength(kDictionaryKeys) &&
+                  !(CACFString(kDictionaryKeys[theKeyIndex]) == CACFString(theKey, false)))
+            {
+                theKeyIndex++;
+            }
+
+            mData.push_back(static_cast<UInt8>(theKeyIndex));
+
+            if(theKeyIndex == ArrayLength(kDictionaryKeys))
+            {
+                AppendCFString(theKey);
+            }
+
+            AppendCFValue(theValues[static_cast<size_t>(i)]);
+        }
+    }
+    else
+    {
+        // Not a property list type, so the HAL wouldn't pass it to the driver.
+        mData.push_back(kCFTag_Null);
+    }
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,196 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PropertyFuzzer.h
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Turns arbitrary bytes into a sequence of property calls on BGM_Device and its streams and
+//  controls, the way the HAL would make them for clients of coreaudiod. That's the part of the
+//  driver that parses data from other processes: the sizes, qualifiers and (for the custom
+//  properties) CF objects they pass in. The calls go through BGM_Device, so they reach
+//  BGM_Stream, BGM_VolumeControl, BGM_MuteControl and BGM_Clients::SetClientsRelativeVolumes too.
+//
+//  It's used by the libFuzzer harness in Fuzz/ (see the README there) and by
+//  BGM_PropertyFuzzerTests, which runs the seed inputs as part of the normal tests.
+//
+//  The input is a list of calls, each encoded as
+//
+//      op, object, selector, scope, element  (one byte each, see the tables in the .cpp)
+//      qualifier size (one byte) and the qualifier
+//      for GetPropertyData, the size of the buffer to pass (two bytes, little-endian)
+//      for SetPropertyData, the data:
+//          for the custom properties, a flags byte and a CF value (see DecodeCFValue)
+//          for the others, its size (two bytes) and the raw bytes
+//
+//  Reading past the end of the input gives zeros, so every input decodes to something. The buffers
+//  passed to the device are exactly the sizes given, so AddressSanitizer catches any reads or writes
+//  past them.
+//
+//  Only CF objects are passed for the custom properties, since the HAL only passes property list
+//  objects for them. The fuzzer's device writes IO traces to a temporary directory, which is emptied
+//  after each input.
+//
+//  After each input, the properties it could have changed are put back how they were and any config
+//  changes the device requested are performed, so most inputs behave the same regardless of the
+//  ones run before them.
+//
+
+#ifndef BGMDriverTests__BGM_PropertyFuzzer
+#define BGMDriverTests__BGM_PropertyFuzzer
+
+// Local Includes
+#include "BGM_Device.h"
+#include "BGM_MockHost.h"
+
+// STL Includes
+#include <memory>
+#include <string>
+#include <vector>
+
+// System Includes
+#include <CoreAudio/AudioServerPlugIn.h>
+#include <CoreFoundation/CoreFoundation.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_PropertyFuzzer
+{
+
+public:
+    struct Seed
+    {
+        std::string                     mName;
+        std::vector<UInt8>              mData;
+    };
+
+    /*!
+     Builds inputs in the format RunInput decodes. Used for the seed corpus and by the tests.
+     Selectors, objects, scopes and elements that don't have a short encoding are written out in
+     full, so any call can be encoded.
+     */
+    class Encoder
+    {
+
+    public:
+        Encoder&                        HasProperty(AudioObjectID inObjectID,
+                                                    const AudioObjectPropertyAddress& inAddress);
+        Encoder&                        IsPropertySettable(AudioObjectID inObjectID,
+                                                           const AudioObjectPropertyAddress& inAddress);
+        Encoder&                        GetPropertyDataSize(AudioObjectID inObjectID,
+                                                            const AudioObjectPropertyAddress& inAddress);
+        Encoder&                        GetPropertyData(AudioObjectID inObjectID,
+                                                        const AudioObjectPropertyAddress& inAddress,
+                                                        UInt32 inDataSize);
+
+        /*! For properties other than the custom properties. */
+        Encoder&                        SetPropertyData(AudioObjectID inObjectID,
+                                                        const AudioObjectPropertyAddress& inAddress,
+                                                        UInt32 inDataSize,
+                                                        const void* inData);
+
+        /*!
+         For the custom properties.
+
+         @param inValue Can be null. Numbers, strings, booleans, data, arrays and dictionaries are
+                        supported.
+         */
+        Encoder&                        SetPropertyData(AudioObjectID inObjectID,
+                                                        const AudioObjectPropertyAddress& inAddress,
+                                                        CFTypeRef __nullable inValue);
+
+        const std::vector<UInt8>&       GetData() const { return mData; }
+
+    private:
+        void                            AppendCall(UInt8 inOp,
+                                                   AudioObjectID inObjectID,
+                                                   const AudioObjectPropertyAddress& inAddress);
+        void                            AppendUInt16(UInt16 inValue);
+        void                            AppendUInt32(UInt32 inValue);
+        void                            AppendBytes(const void* inBytes, size_t inSize);
+        void                            AppendCFString(CFStringRef inString);
+        void                            AppendCFValue(CFTypeRef __nullable inValue);
+
+        std::vector<UInt8>              mData;
+
+    };
+
+                                        BGM_PropertyFuzzer();
+                                        ~BGM_PropertyFuzzer();
+
+                                        BGM_PropertyFuzzer(const BGM_PropertyFuzzer&) = delete;
+    BGM_PropertyFuzzer&                 operator=(const BGM_PropertyFuzzer&) = delete;
+
+    /*!
+     Decode inData and make the calls on the device. Exceptions from the device are caught and
+     ignored, like BGM_PlugInInterface does. Aborts if the device reports writing more data than it
+     was given space for.
+     */
+    void                                RunInput(const UInt8* inData, size_t inSize);
+
+    BGM_Device&                         GetDevice();
+
+    /*! The custom properties the fuzzer knows about, i.e. the ones in BGM_Types.h. */
+    static std::vector<AudioObjectPropertySelector> GetCustomProperties();
+
+    /*! The standard properties the fuzzer tries, for the device and the objects it owns. */
+    static std::vector<AudioObjectPropertySelector> GetStandardProperties();
+
+    /*! At least one seed for each custom property, plus some for the standard properties. */
+    static std::vector<Seed>            GetSeeds();
+
+    /*! Writes each seed to a file named after it in inDirectory. */
+    static void                         WriteSeeds(const char* inDirectory);
+
+private:
+    struct SavedProperty
+    {
+        AudioObjectID                   mObjectID;
+        AudioObjectPropertyAddress      mAddress;
+        std::vector<UInt8>              mData;
+        bool                            mIsCFType;
+    };
+
+    class Reader;
+
+    void                                RunCall(Reader& inReader);
+    CFTypeRef __nullable                DecodeCFValue(Reader& inReader, UInt32 inDepth);
+    CFStringRef __nullable              DecodeCFString(Reader& inReader);
+
+    void                                SaveProperties();
+    void                                RestoreProperties();
+    void                                SaveProperty(AudioObjectID inObjectID,
+                                                     const AudioObjectPropertyAddress& inAddress);
+    void                                RemoveTraces();
+
+    BGM_MockHost                        mHost;
+    std::unique_ptr<BGM_Device>         mDevice;
+
+    /*! The temporary directory IO traces are written to. */
+    std::string                         mTraceDirectory;
+
+    std::vector<SavedProperty>          mSavedProperties;
+    bool                                mDidSetProperty = false;
+    UInt32                              mCFObjectCount = 0;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriverTests__BGM_PropertyFuzzer */
+
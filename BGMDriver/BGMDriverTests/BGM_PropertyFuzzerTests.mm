@@ -0,0 +1,222 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PropertyFuzzerTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Runs BGM_PropertyFuzzer's seeds, and random mutations of them, as part of the normal tests. The
+//  coverage-guided fuzzing is done with libFuzzer instead. See Fuzz/README.md.
+//
+//  These environment variables control the random inputs:
+//
+//      BGM_FUZZ_SECONDS                  How long to run them for. 1 by default.
+//      BGM_FUZZ_MIN_EXECS_PER_SECOND     If set, the test fails if fewer inputs than this were run
+//                                        per second.
+//
+
+// Local Includes
+#include "BGM_Device.h"
+#include "BGM_PropertyFuzzer.h"
+#include "BGM_TestUtils.h"
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CACFDictionary.h"
+
+// STL Includes
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+
+static Float64 GetEnvFloat64(const char* inName, Float64 inDefault)
+{
+    const char* theValue = getenv(inName);
+    return (theValue != nullptr) ? atof(theValue) : inDefault;
+}
+
+static CFTypeRef __nullable CopyCustomProperty(BGM_Device& inDevice,
+                                               const AudioObjectPropertyAddress& inAddress)
+{
+    CFTypeRef theValue = nullptr;
+    UInt32 theSize = 0;
+    inDevice.GetPropertyData(kObjectID_Device,
+                             0,
+                             inAddress,
+                             0,
+                             nullptr,
+                             sizeof(CFTypeRef),
+                             theSize,
+                             &theValue);
+    return theValue;
+}
+
+@interface BGM_PropertyFuzzerTests : XCTestCase {
+    std::unique_ptr<BGM_PropertyFuzzer> fuzzer;
+}
+
+@end
+
+@implementation BGM_PropertyFuzzerTests
+
+- (void) setUp {
+    [super setUp];
+    fuzzer.reset(new BGM_PropertyFuzzer);
+}
+
+- (void) tearDown {
+    fuzzer.reset();
+    [super tearDown];
+}
+
+- (void) testSeedsCoverEveryCustomProperty {
+    BGM_Device& theDevice = fuzzer->GetDevice();
+
+    const AudioObjectPropertyAddress theInfoListAddress = {
+        kAudioObjectPropertyCustomPropertyInfoList,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMaster
+    };
+    UInt32 theSize = theDevice.GetPropertyDataSize(kObjectID_Device, 0, theInfoListAddress, 0, nullptr);
+    std::vector<AudioServerPlugInCustomPropertyInfo> theInfoList(theSize / sizeof(AudioServerPlugInCustomPropertyInfo));
+    theDevice.GetPropertyData(kObjectID_Device,
+                              0,
+                              theInfoListAddress,
+                              0,
+                              nullptr,
+                              theSize,
+                              theSize,
+                              theInfoList.data());
+
+    const std::vector<AudioObjectPropertySelector> theKnownProperties =
+            BGM_PropertyFuzzer::GetCustomProperties();
+    const std::vector<BGM_PropertyFuzzer::Seed> theSeeds = BGM_PropertyFuzzer::GetSeeds();
+
+    for(const AudioServerPlugInCustomPropertyInfo& theInfo : theInfoList)
+    {
+        const char theName[] = {
+            static_cast<char>(theInfo.mSelector >> 24),
+            static_cast<char>(theInfo.mSelector >> 16),
+            static_cast<char>(theInfo.mSelector >> 8),
+            static_cast<char>(theInfo.mSelector),
+            '\0'
+        };
+
+        // The fuzzer only passes CF objects for the custom properties it knows about.
+        XCTAssert(std::find(theKnownProperties.begin(), theKnownProperties.end(), theInfo.mSelector) !=
+                          theKnownProperties.end(),
+                  "BGM_PropertyFuzzer doesn't know about '%s'",
+                  theName);
+
+        const std::string theSeedName = std::string("custom-") + theName;
+        XCTAssert(std::any_of(theSeeds.begin(), theSeeds.end(), [&](const BGM_PropertyFuzzer::Seed& inSeed) {
+                      return inSeed.mName == theSeedName;
+                  }),
+                  "No seed for '%s'",
+                  theName);
+    }
+}
+
+- (void) testSeedsLeaveDeviceUnchanged {
+    BGM_Device& theDevice = fuzzer->GetDevice();
+
+    for(const BGM_PropertyFuzzer::Seed& theSeed : BGM_PropertyFuzzer::GetSeeds())
+    {
+        fuzzer->RunInput(theSeed.mData.data(), theSeed.mData.size());
+
+        // The seeds set each property, so they should all have been set back.
+        CFTypeRef theValue = CopyCustomProperty(theDevice, kBGMLoopbackSharedMemoryAddress);
+        XCTAssertEqual(theValue, kCFBooleanFalse, "%s", theSeed.mName.c_str());
+
+        theValue = CopyCustomProperty(theDevice, kBGMBoostLimiterAddress);
+        XCTAssertEqual(theValue, kCFBooleanFalse, "%s", theSeed.mName.c_str());
+
+        theValue = CopyCustomProperty(theDevice, kBGMCaptureTapsAddress);
+        XCTAssertEqual(CFArrayGetCount(static_cast<CFArrayRef>(theValue)), 0, "%s", theSeed.mName.c_str());
+        CFRelease(theValue);
+
+        CACFDictionary theTraceSettings(static_cast<CFDictionaryRef>(CopyCustomProperty(theDevice, kBGMIOTraceAddress)),
+                                        true);
+        bool theTraceEnabled = true;
+        theTraceSettings.GetBool(CFSTR(kBGMIOTraceKey_Enabled), theTraceEnabled);
+        XCTAssertFalse(theTraceEnabled, "%s", theSeed.mName.c_str());
+    }
+}
+
+- (void) testEmptyAndTruncatedInputs {
+    fuzzer->RunInput(nullptr, 0);
+
+    // Every prefix of a seed decodes to something.
+    for(const BGM_PropertyFuzzer::Seed& theSeed : BGM_PropertyFuzzer::GetSeeds())
+    {
+        for(size_t theLength = 0; theLength <= theSeed.mData.size(); theLength++)
+        {
+            fuzzer->RunInput(theSeed.mData.data(), theLength);
+        }
+    }
+}
+
+- (void) testMutatedInputs {
+    const Float64 theSeconds = GetEnvFloat64("BGM_FUZZ_SECONDS", 1.0);
+    const Float64 theMinExecsPerSecond = GetEnvFloat64("BGM_FUZZ_MIN_EXECS_PER_SECOND", 0.0);
+
+    const std::vector<BGM_PropertyFuzzer::Seed> theSeeds = BGM_PropertyFuzzer::GetSeeds();
+
+    // A fixed seed so failures can be reproduced.
+    std::mt19937 theRandom(1);
+    std::vector<UInt8> theInput;
+    UInt64 theExecs = 0;
+
+    const auto theStartTime = std::chrono::steady_clock::now();
+    std::chrono::duration<Float64> theElapsed(0);
+
+    while(theElapsed.count() < theSeconds)
+    {
+        theInput = theSeeds[theRandom() % theSeeds.size()].mData;
+
+        // Overwrite some bytes, and sometimes truncate the input or append random bytes.
+        const UInt32 theMutations = theRandom() % 8;
+
+        for(UInt32 i = 0; i < theMutations && !theInput.empty(); i++)
+        {
+            theInput[theRandom() % theInput.size()] = static_cast<UInt8>(theRandom());
+        }
+
+        if(theRandom() % 4 == 0)
+        {
+            theInput.resize(theRandom() % (theInput.size() + 64), static_cast<UInt8>(theRandom()));
+        }
+
+        fuzzer->RunInput(theInput.data(), theInput.size());
+        theExecs++;
+
+        theElapsed = std::chrono::steady_clock::now() - theStartTime;
+    }
+
+    const Float64 theExecsPerSecond = theExecs / theElapsed.count();
+    NSLog(@"BGM_PropertyFuzzerTests: %llu inputs, %.0f per second", theExecs, theExecsPerSecond);
+
+    XCTAssertGreaterThanOrEqual(theExecsPerSecond, theMinExecsPerSecond);
+}
+
+@end
+
@@ -0,0 +1,402 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PropertyTableTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Checks that HasProperty, IsPropertySettable and GetPropertyDataSize give the same answers for
+//  BGMDevice and the objects it owns as they did before they were changed to look the properties up
+//  in BGM_PropertyTables. The expected answers were written out from the switch statements the
+//  tables replaced.
+//
+
+// Local Includes
+#include "BGM_Device.h"
+#include "BGM_PropertyFuzzer.h"
+#include "BGM_TestUtils.h"
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+
+// Subclass BGM_Device so the tests can create their own instance.
+class BGM_PropertyTableTestDevice
+:
+    public BGM_Device
+{
+
+public:
+    BGM_PropertyTableTestDevice()
+    :
+        BGM_Device(kObjectID_Device,
+                   CFSTR(kDeviceName),
+                   CFSTR(kBGMDeviceUID),
+                   CFSTR(kBGMDeviceModelUID),
+                   kObjectID_Stream_Input,
+                   kObjectID_Stream_Output,
+                   kObjectID_Volume_Output_Master,
+                   kObjectID_Mute_Output_Master)
+    {
+        Activate();
+    }
+
+};
+
+// The scopes the expected sizes are given for, in order.
+static const AudioObjectPropertyScope kScopes[] = {
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyScopeInput,
+    kAudioObjectPropertyScopeOutput
+};
+
+struct BGM_ExpectedProperty
+{
+    bool        mInputOrOutputOnly;
+    bool        mIsSettable;
+    // The size of the property's data in each of kScopes.
+    UInt32      mSizes[3];
+};
+
+typedef std::map<AudioObjectPropertySelector, BGM_ExpectedProperty> BGM_ExpectedProperties;
+
+static BGM_ExpectedProperty Property(bool inIsSettable, size_t inSize)
+{
+    const UInt32 theSize = static_cast<UInt32>(inSize);
+    return { false, inIsSettable, { theSize, theSize, theSize } };
+}
+
+static BGM_ExpectedProperty InputOrOutputProperty(size_t inSize)
+{
+    const UInt32 theSize = static_cast<UInt32>(inSize);
+    return { true, false, { theSize, theSize, theSize } };
+}
+
+// The properties every object has, from BGM_Object.
+static BGM_ExpectedProperties ObjectProperties()
+{
+    return {
+        { kAudioObjectPropertyBaseClass, Property(false, sizeof(AudioClassID)) },
+        { kAudioObjectPropertyClass, Property(false, sizeof(AudioClassID)) },
+        { kAudioObjectPropertyOwner, Property(false, sizeof(AudioObjectID)) },
+        { kAudioObjectPropertyOwnedObjects, Property(false, 0) }
+    };
+}
+
+static BGM_ExpectedProperties DeviceProperties()
+{
+    // Activate enables both of the device's output controls.
+    const UInt32 kOutputControls = 2;
+
+    BGM_ExpectedProperties theProperties = ObjectProperties();
+
+    // The device's owned objects and streams depend on the scope.
+    theProperties[kAudioObjectPropertyOwnedObjects] = {
+        false, false, {
+            (1 + 1 + kOutputControls) * sizeof(AudioObjectID),
+            1 * sizeof(AudioObjectID),
+            (1 + kOutputControls) * sizeof(AudioObjectID)
+        }
+    };
+    theProperties[kAudioDevicePropertyStreams] = {
+        false, false, { 2 * sizeof(AudioObjectID), sizeof(AudioObjectID), sizeof(AudioObjectID) }
+    };
+
+    const BGM_ExpectedProperties theOtherProperties = {
+        // From BGM_AbstractDevice.
+        { kAudioObjectPropertyName, Property(false, sizeof(CFStringRef)) },
+        { kAudioObjectPropertyManufacturer, Property(false, sizeof(CFStringRef)) },
+        { kAudioDevicePropertyDeviceUID, Property(false, sizeof(CFStringRef)) },
+        { kAudioDevicePropertyModelUID, Property(false, sizeof(CFStringRef)) },
+        { kAudioDevicePropertyTransportType, Property(false, sizeof(UInt32)) },
+        { kAudioDevicePropertyRelatedDevices, Property(false, sizeof(AudioObjectID)) },
+        { kAudioDevicePropertyClockDomain, Property(false, sizeof(UInt32)) },
+        { kAudioDevicePropertyDeviceIsAlive, Property(false, sizeof(AudioClassID)) },
+        { kAudioDevicePropertyDeviceIsRunning, Property(false, sizeof(UInt32)) },
+        { kAudioDevicePropertyIsHidden, Property(false, sizeof(UInt32)) },
+        { kAudioDevicePropertyZeroTimeStampPeriod, Property(false, sizeof(UInt32)) },
+        // From BGM_Device.
+        { kAudioObjectPropertyControlList, Property(false, kOutputControls * sizeof(AudioObjectID)) },
+        { kAudioDevicePropertyNominalSampleRate, Property(true, sizeof(Float64)) },
+        { kAudioDevicePropertyAvailableNominalSampleRates,
+          Property(false, (kBGMNumStandardSampleRates + 1) * sizeof(AudioValueRange)) },
+        { kAudioDevicePropertyLatency, InputOrOutputProperty(sizeof(UInt32)) },
+        { kAudioDevicePropertySafetyOffset, InputOrOutputProperty(sizeof(UInt32)) },
+        { kAudioDevicePropertyDeviceCanBeDefaultDevice, InputOrOutputProperty(sizeof(UInt32)) },
+        { kAudioDevicePropertyDeviceCanBeDefaultSystemDevice, InputOrOutputProperty(sizeof(UInt32)) },
+        { kAudioDevicePropertyPreferredChannelsForStereo, InputOrOutputProperty(2 * sizeof(UInt32)) },
+        { kAudioDevicePropertyPreferredChannelLayout,
+          InputOrOutputProperty(offsetof(AudioChannelLayout, mChannelDescriptions) +
+                                (2 * sizeof(AudioChannelDescription))) },
+        { kAudioDevicePropertyIcon, Property(false, sizeof(CFURLRef)) },
+        { kAudioObjectPropertyCustomPropertyInfoList,
+          Property(false, 12 * sizeof(AudioServerPlugInCustomPropertyInfo)) },
+        // BGMDevice's custom properties.
+        { kAudioDeviceCustomPropertyDeviceAudibleState, Property(false, sizeof(CFNumberRef)) },
+        { kAudioDeviceCustomPropertyMusicPlayerProcessID, Property(true, sizeof(CFPropertyListRef)) },
+        { kAudioDeviceCustomPropertyMusicPlayerBundleID, Property(true, sizeof(CFStringRef)) },
+        { kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp,
+          Property(false, sizeof(CFBooleanRef)) },
+        { kAudioDeviceCustomPropertyAppVolumes, Property(true, sizeof(CFPropertyListRef)) },
+        { kAudioDeviceCustomPropertyEnabledOutputControls, Property(true, sizeof(CFArrayRef)) },
+        { kAudioDeviceCustomPropertyLoopbackSharedMemory, Property(true, sizeof(CFBooleanRef)) },
+        { kAudioDeviceCustomPropertyCaptureTaps, Property(true, sizeof(CFArrayRef)) },
+        { kAudioDeviceCustomPropertyBoostLimiter, Property(true, sizeof(CFBooleanRef)) },
+        { kAudioDeviceCustomPropertyMusicDucking, Property(true, sizeof(CFDictionaryRef)) },
+        { kAudioDeviceCustomPropertyIOProfile, Property(true, sizeof(CFDictionaryRef)) },
+        { kAudioDeviceCustomPropertyIOTrace, Property(true, sizeof(CFDictionaryRef)) }
+    };
+
+    theProperties.insert(theOtherProperties.begin(), theOtherProperties.end());
+
+    return theProperties;
+}
+
+static BGM_ExpectedProperties StreamProperties()
+{
+    const size_t kAvailableFormatsSize =
+            (kBGMNumStandardSampleRates + 1) * sizeof(AudioStreamRangedDescription);
+
+    BGM_ExpectedProperties theProperties = ObjectProperties();
+
+    const BGM_ExpectedProperties theStreamProperties = {
+        { kAudioStreamPropertyIsActive, Property(true, sizeof(UInt32)) },
+        { kAudioStreamPropertyDirection, Property(false, sizeof(UInt32)) },
+        { kAudioStreamPropertyTerminalType, Property(false, sizeof(UInt32)) },
+        { kAudioStreamPropertyStartingChannel, Property(false, sizeof(UInt32)) },
+        { kAudioStreamPropertyLatency, Property(false, sizeof(UInt32)) },
+        { kAudioStreamPropertyVirtualFormat, Property(true, sizeof(AudioStreamBasicDescription)) },
+        { kAudioStreamPropertyPhysicalFormat, Property(true, sizeof(AudioStreamBasicDescription)) },
+        { kAudioStreamPropertyAvailableVirtualFormats, Property(false, kAvailableFormatsSize) },
+        { kAudioStreamPropertyAvailablePhysicalFormats, Property(false, kAvailableFormatsSize) }
+    };
+
+    theProperties.insert(theStreamProperties.begin(), theStreamProperties.end());
+
+    return theProperties;
+}
+
+static BGM_ExpectedProperties ControlProperties(const BGM_ExpectedProperties& inSubclassProperties)
+{
+    BGM_ExpectedProperties theProperties = ObjectProperties();
+
+    theProperties[kAudioControlPropertyScope] = Property(false, sizeof(AudioObjectPropertyScope));
+    theProperties[kAudioControlPropertyElement] = Property(false, sizeof(AudioObjectPropertyElement));
+    theProperties.insert(inSubclassProperties.begin(), inSubclassProperties.end());
+
+    return theProperties;
+}
+
+static std::string SelectorName(AudioObjectPropertySelector inSelector)
+{
+    const char theName[] = {
+        static_cast<char>(inSelector >> 24),
+        static_cast<char>(inSelector >> 16),
+        static_cast<char>(inSelector >> 8),
+        static_cast<char>(inSelector),
+        '\0'
+    };
+
+    return theName;
+}
+
+static std::vector<AudioObjectPropertySelector> AllSelectors()
+{
+    std::vector<AudioObjectPropertySelector> theSelectors = BGM_PropertyFuzzer::GetStandardProperties();
+    const std::vector<AudioObjectPropertySelector> theCustomSelectors =
+            BGM_PropertyFuzzer::GetCustomProperties();
+
+    theSelectors.insert(theSelectors.end(), theCustomSelectors.begin(), theCustomSelectors.end());
+
+    // Selectors no object has, including ones either side of every object's table.
+    theSelectors.push_back(0);
+    theSelectors.push_back('aaaa');
+    theSelectors.push_back('zzzz');
+    theSelectors.push_back(0xFFFFFFFF);
+
+    return theSelectors;
+}
+
+@interface BGM_PropertyTableTests : XCTestCase {
+    BGM_PropertyTableTestDevice* testDevice;
+}
+
+@end
+
+@implementation BGM_PropertyTableTests
+
+- (void) setUp {
+    [super setUp];
+    testDevice = new BGM_PropertyTableTestDevice();
+}
+
+- (void) tearDown {
+    delete testDevice;
+    [super tearDown];
+}
+
+- (void) testDeviceProperties {
+    [self checkObject:kObjectID_Device expected:DeviceProperties()];
+}
+
+- (void) testStreamProperties {
+    [self checkObject:kObjectID_Stream_Input expected:StreamProperties()];
+    [self checkObject:kObjectID_Stream_Output expected:StreamProperties()];
+}
+
+- (void) testVolumeControlProperties {
+    [self checkObject:kObjectID_Volume_Output_Master
+             expected:ControlProperties({
+                 { kAudioLevelControlPropertyScalarValue, Property(true, sizeof(Float32)) },
+                 { kAudioLevelControlPropertyDecibelValue, Property(true, sizeof(Float32)) },
+                 { kAudioLevelControlPropertyDecibelRange, Property(false, sizeof(AudioValueRange)) },
+                 { kAudioLevelControlPropertyConvertScalarToDecibels, Property(false, sizeof(Float32)) },
+                 { kAudioLevelControlPropertyConvertDecibelsToScalar, Property(false, sizeof(Float32)) }
+             })];
+}
+
+- (void) testMuteControlProperties {
+    [self checkObject:kObjectID_Mute_Output_Master
+             expected:ControlProperties({
+                 { kAudioBooleanControlPropertyValue, Property(true, sizeof(UInt32)) }
+             })];
+}
+
+- (void) testCustomPropertyInfoList {
+    const AudioObjectPropertyAddress theAddress = {
+        kAudioObjectPropertyCustomPropertyInfoList,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMaster
+    };
+
+    UInt32 theSize = testDevice->GetPropertyDataSize(kObjectID_Device, 0, theAddress, 0, nullptr);
+    std::vector<AudioServerPlugInCustomPropertyInfo> theInfo(theSize / sizeof(AudioServerPlugInCustomPropertyInfo));
+    testDevice->GetPropertyData(kObjectID_Device, 0, theAddress, 0, nullptr, theSize, theSize, theInfo.data());
+
+    XCTAssertEqual(theSize, static_cast<UInt32>(theInfo.size() * sizeof(AudioServerPlugInCustomPropertyInfo)));
+
+    // The list used to be written out by hand, in this order. It's in selector order now, which the
+    // HAL doesn't care about.
+    const std::vector<std::pair<AudioObjectPropertySelector, AudioServerPlugInCustomPropertyDataType>> theExpected = {
+        { kAudioDeviceCustomPropertyAppVolumes, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+        { kAudioDeviceCustomPropertyMusicPlayerProcessID, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+        { kAudioDeviceCustomPropertyMusicPlayerBundleID, kAudioServerPlugInCustomPropertyDataTypeCFString },
+        { kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+        { kAudioDeviceCustomPropertyDeviceAudibleState, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+        { kAudioDeviceCustomPropertyEnabledOutputControls, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+        { kAudioDeviceCustomPropertyLoopbackSharedMemory, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+        { kAudioDeviceCustomPropertyCaptureTaps, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+        { kAudioDeviceCustomPropertyBoostLimiter, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+        { kAudioDeviceCustomPropertyMusicDucking, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+        { kAudioDeviceCustomPropertyIOProfile, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList },
+        { kAudioDeviceCustomPropertyIOTrace, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList }
+    };
+
+    XCTAssertEqual(theInfo.size(), theExpected.size());
+
+    for(const auto& theExpectedInfo : theExpected)
+    {
+        auto theFound = std::find_if(theInfo.begin(), theInfo.end(), [&](const AudioServerPlugInCustomPropertyInfo& inInfo) {
+            return inInfo.mSelector == theExpectedInfo.first;
+        });
+
+        XCTAssert(theFound != theInfo.end(), "Missing '%s'", SelectorName(theExpectedInfo.first).c_str());
+
+        if(theFound != theInfo.end())
+        {
+            XCTAssertEqual(theFound->mPropertyDataType, theExpectedInfo.second);
+            XCTAssertEqual(theFound->mQualifierDataType, kAudioServerPlugInCustomPropertyDataTypeNone);
+        }
+    }
+
+    // Asking for fewer items than there are only returns that many.
+    theSize = 3 * sizeof(AudioServerPlugInCustomPropertyInfo);
+    testDevice->GetPropertyData(kObjectID_Device, 0, theAddress, 0, nullptr, theSize, theSize, theInfo.data());
+    XCTAssertEqual(theSize, static_cast<UInt32>(3 * sizeof(AudioServerPlugInCustomPropertyInfo)));
+}
+
+// Checks the device's answers for inObjectID against inExpected for every selector the fuzzer knows
+// about, plus some that no object has, in the global, input and output scopes.
+- (void) checkObject:(AudioObjectID)inObjectID expected:(const BGM_ExpectedProperties&)inExpected {
+    for(AudioObjectPropertySelector theSelector : AllSelectors())
+    {
+        auto theExpected = inExpected.find(theSelector);
+        const std::string theName = SelectorName(theSelector);
+
+        for(size_t i = 0; i < 3; i++)
+        {
+            const AudioObjectPropertyAddress theAddress = {
+                theSelector,
+                kScopes[i],
+                kAudioObjectPropertyElementMaster
+            };
+
+            const bool theHasProperty = testDevice->HasProperty(inObjectID, 0, theAddress);
+
+            if(theExpected != inExpected.end())
+            {
+                const bool theShouldHaveProperty = !theExpected->second.mInputOrOutputOnly ||
+                        (kScopes[i] != kAudioObjectPropertyScopeGlobal);
+
+                XCTAssertEqual(theHasProperty, theShouldHaveProperty, "object %u, '%s', scope %zu", inObjectID, theName.c_str(), i);
+                XCTAssertEqual(testDevice->IsPropertySettable(inObjectID, 0, theAddress),
+                               theExpected->second.mIsSettable,
+                               "object %u, '%s', scope %zu",
+                               inObjectID,
+                               theName.c_str(),
+                               i);
+                XCTAssertEqual(testDevice->GetPropertyDataSize(inObjectID, 0, theAddress, 0, nullptr),
+                               theExpected->second.mSizes[i],
+                               "object %u, '%s', scope %zu",
+                               inObjectID,
+                               theName.c_str(),
+                               i);
+            }
+            else
+            {
+                XCTAssertFalse(theHasProperty, "object %u, '%s', scope %zu", inObjectID, theName.c_str(), i);
+                [self checkUnknownProperty:^{ testDevice->IsPropertySettable(inObjectID, 0, theAddress); }
+                                      name:theName];
+                [self checkUnknownProperty:^{ testDevice->GetPropertyDataSize(inObjectID, 0, theAddress, 0, nullptr); }
+                                      name:theName];
+            }
+        }
+    }
+}
+
+- (void) checkUnknownProperty:(void (^)(void))inCall name:(const std::string&)inName {
+    try
+    {
+        inCall();
+        XCTFail("'%s' should have been unknown", inName.c_str());
+    }
+    catch(const CAException& e)
+    {
+        XCTAssertEqual(e.GetError(), kAudioHardwareUnknownPropertyError, "'%s'", inName.c_str());
+    }
+}
+
+@end
+
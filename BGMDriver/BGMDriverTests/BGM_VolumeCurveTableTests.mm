@@ -0,0 +1,258 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_VolumeCurveTableTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Checks that BGM_VolumeCurveTable's conversions give exactly the same results as CAVolumeCurve's.
+//
+
+// Unit Include
+#include "BGM_VolumeCurveTable.h"
+
+// Local Includes
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CAVolumeCurve.h"
+
+// STL Includes
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+
+static const UInt32 kNumTransferFunctions = CAVolumeCurve::kPow12Over1Curve + 1;
+
+// Compares the bits, so -0.0 and 0.0 are different and NaN is equal to itself.
+static bool IsIdentical(Float32 inA, Float32 inB)
+{
+    return memcmp(&inA, &inB, sizeof(Float32)) == 0;
+}
+
+// Some scalar values to convert: a sweep of [0, 1], a little outside it and a few floats on either
+// side of each raw step's scalar value and of the midpoints between them, which is where
+// ConvertScalarToRaw's rounding changes its answer.
+static std::vector<Float32> ScalarsToTest(const CAVolumeCurve& inCurve)
+{
+    std::vector<Float32> theScalars = { -1.0f, -0.0f, 1.5f, std::numeric_limits<Float32>::infinity() };
+
+    for(int i = 0; i <= 10000; i++)
+    {
+        theScalars.push_back(i / 10000.0f);
+    }
+
+    for(SInt32 theRaw = inCurve.GetMinimumRaw(); theRaw <= inCurve.GetMaximumRaw(); theRaw++)
+    {
+        Float32 theCentre = inCurve.ConvertRawToScalar(theRaw);
+        Float32 theMidpoint = (theCentre + inCurve.ConvertRawToScalar(theRaw + 1)) / 2;
+
+        for(Float32 theValue : { theCentre, theMidpoint })
+        {
+            Float32 theBelow = theValue;
+            Float32 theAbove = theValue;
+            theScalars.push_back(theValue);
+
+            for(int i = 0; i < 8; i++)
+            {
+                theBelow = nextafterf(theBelow, -1.0f);
+                theAbove = nextafterf(theAbove, 2.0f);
+                theScalars.push_back(theBelow);
+                theScalars.push_back(theAbove);
+            }
+        }
+    }
+
+    return theScalars;
+}
+
+// The same for dB values.
+static std::vector<Float32> DBsToTest(const CAVolumeCurve& inCurve)
+{
+    const Float32 theMinDB = inCurve.GetMinimumDB();
+    const Float32 theMaxDB = inCurve.GetMaximumDB();
+    std::vector<Float32> theDBs = { theMinDB - 100.0f, theMaxDB + 100.0f };
+
+    for(int i = 0; i <= 10000; i++)
+    {
+        theDBs.push_back(theMinDB + ((theMaxDB - theMinDB) * i / 10000.0f));
+    }
+
+    for(SInt32 theRaw = inCurve.GetMinimumRaw(); theRaw <= inCurve.GetMaximumRaw(); theRaw++)
+    {
+        Float32 theCentre = inCurve.ConvertRawToDB(theRaw);
+        Float32 theMidpoint = (theCentre + inCurve.ConvertRawToDB(theRaw + 1)) / 2;
+
+        for(Float32 theValue : { theCentre, theMidpoint })
+        {
+            Float32 theBelow = theValue;
+            Float32 theAbove = theValue;
+            theDBs.push_back(theValue);
+
+            for(int i = 0; i < 8; i++)
+            {
+                theBelow = nextafterf(theBelow, theMinDB - 1.0f);
+                theAbove = nextafterf(theAbove, theMaxDB + 1.0f);
+                theDBs.push_back(theBelow);
+                theDBs.push_back(theAbove);
+            }
+        }
+    }
+
+    return theDBs;
+}
+
+@interface BGM_VolumeCurveTableTests : XCTestCase
+
+@end
+
+@implementation BGM_VolumeCurveTableTests
+
+// Checks every conversion against inCurve's. Returns the number of conversions that didn't match,
+// rather than asserting for each one, so a broken table doesn't log thousands of failures.
+- (UInt32) mismatchesBetween:(const BGM_VolumeCurveTable&)inTable andCurve:(const CAVolumeCurve&)inCurve {
+    UInt32 theMismatches = 0;
+
+    XCTAssertEqual(inTable.GetMinimumRaw(), inCurve.GetMinimumRaw());
+    XCTAssertEqual(inTable.GetMaximumRaw(), inCurve.GetMaximumRaw());
+    XCTAssertEqual(inTable.GetMinimumDB(), inCurve.GetMinimumDB());
+    XCTAssertEqual(inTable.GetMaximumDB(), inCurve.GetMaximumDB());
+
+    for(SInt32 theRaw = inCurve.GetMinimumRaw() - 10; theRaw <= inCurve.GetMaximumRaw() + 10; theRaw++)
+    {
+        theMismatches += !IsIdentical(inTable.ConvertRawToScalar(theRaw), inCurve.ConvertRawToScalar(theRaw));
+        theMismatches += !IsIdentical(inTable.ConvertRawToDB(theRaw), inCurve.ConvertRawToDB(theRaw));
+    }
+
+    for(Float32 theScalar : ScalarsToTest(inCurve))
+    {
+        theMismatches += (inTable.ConvertScalarToRaw(theScalar) != inCurve.ConvertScalarToRaw(theScalar));
+        theMismatches += !IsIdentical(inTable.ConvertScalarToDB(theScalar), inCurve.ConvertScalarToDB(theScalar));
+    }
+
+    for(Float32 theDB : DBsToTest(inCurve))
+    {
+        theMismatches += (inTable.ConvertDBToRaw(theDB) != inCurve.ConvertDBToRaw(theDB));
+        theMismatches += !IsIdentical(inTable.ConvertDBToScalar(theDB), inCurve.ConvertDBToScalar(theDB));
+    }
+
+    return theMismatches;
+}
+
+- (void) testStandardCurves {
+    // The ranges BGM_VolumeControl and BGM_Clients use, with each transfer function.
+    for(UInt32 theTransferFunction = 0; theTransferFunction < kNumTransferFunctions; theTransferFunction++)
+    {
+        CAVolumeCurve theControlCurve;
+        theControlCurve.AddRange(0, 96, -96.0f, 0.0f);
+        theControlCurve.SetTransferFunction(theTransferFunction);
+
+        BGM_VolumeCurveTable theControlTable(0, 96, -96.0f, 0.0f, theTransferFunction);
+        XCTAssert(theControlTable.IsTabulated());
+        XCTAssertEqual([self mismatchesBetween:theControlTable andCurve:theControlCurve], 0,
+                       @"Transfer function %u", theTransferFunction);
+
+        CAVolumeCurve theAppCurve;
+        theAppCurve.AddRange(kAppRelativeVolumeMinRawValue,
+                             kAppRelativeVolumeMaxRawValue,
+                             kAppRelativeVolumeMinDbValue,
+                             kAppRelativeVolumeMaxDbValue);
+        theAppCurve.SetTransferFunction(theTransferFunction);
+
+        BGM_VolumeCurveTable theAppTable(theAppCurve);
+        XCTAssert(theAppTable.IsTabulated());
+        XCTAssertEqual([self mismatchesBetween:theAppTable andCurve:theAppCurve], 0,
+                       @"Transfer function %u", theTransferFunction);
+    }
+}
+
+- (void) testCustomCurves {
+    // Several ranges, offset raw values and a dB range small enough that CAVolumeCurve doesn't
+    // apply the transfer function.
+    CAVolumeCurve theMultiRangeCurve;
+    theMultiRangeCurve.AddRange(-40, -10, -72.0f, -30.0f);
+    theMultiRangeCurve.AddRange(-10, 20, -30.0f, -6.0f);
+    theMultiRangeCurve.AddRange(20, 300, -6.0f, 6.0f);
+
+    CAVolumeCurve theNarrowCurve;
+    theNarrowCurve.AddRange(10, 30, -20.0f, 0.0f);
+
+    for(const CAVolumeCurve& theBaseCurve : { theMultiRangeCurve, theNarrowCurve })
+    {
+        for(UInt32 theTransferFunction = 0; theTransferFunction < kNumTransferFunctions; theTransferFunction++)
+        {
+            CAVolumeCurve theCurve = theBaseCurve;
+            theCurve.SetTransferFunction(theTransferFunction);
+
+            BGM_VolumeCurveTable theTable(theCurve);
+            XCTAssert(theTable.IsTabulated());
+            XCTAssertEqual([self mismatchesBetween:theTable andCurve:theCurve], 0,
+                           @"Transfer function %u", theTransferFunction);
+        }
+    }
+}
+
+- (void) testSetTransferFunction {
+    BGM_VolumeCurveTable theTable(0, 96, -96.0f, 0.0f);
+    theTable.SetTransferFunction(CAVolumeCurve::kPow4Over1Curve);
+
+    CAVolumeCurve theCurve;
+    theCurve.AddRange(0, 96, -96.0f, 0.0f);
+    theCurve.SetTransferFunction(CAVolumeCurve::kPow4Over1Curve);
+
+    XCTAssertEqual(theTable.GetCurve().GetTransferFunction(), CAVolumeCurve::kPow4Over1Curve);
+    XCTAssertEqual([self mismatchesBetween:theTable andCurve:theCurve], 0);
+}
+
+- (void) testUntabulatedCurves {
+    // Too many raw steps to tabulate, so the table should just call CAVolumeCurve.
+    CAVolumeCurve theLargeCurve;
+    theLargeCurve.AddRange(0, BGM_VolumeCurveTable::kMaxRawSteps + 1, -96.0f, 0.0f);
+
+    BGM_VolumeCurveTable theLargeTable(theLargeCurve);
+    XCTAssertFalse(theLargeTable.IsTabulated());
+
+    for(Float32 theScalar : { 0.0f, 0.25f, 0.5f, 0.999f, 1.0f })
+    {
+        XCTAssertEqual(theLargeTable.ConvertScalarToRaw(theScalar), theLargeCurve.ConvertScalarToRaw(theScalar));
+    }
+
+    // CAVolumeCurve can't convert with a curve that has no ranges, but the table shouldn't fail to
+    // build.
+    BGM_VolumeCurveTable theEmptyTable { CAVolumeCurve() };
+    XCTAssertFalse(theEmptyTable.IsTabulated());
+
+    // The largest curve that can be tabulated.
+    BGM_VolumeCurveTable theLargestTable(0, BGM_VolumeCurveTable::kMaxRawSteps, -96.0f, 0.0f);
+    XCTAssert(theLargestTable.IsTabulated());
+}
+
+- (void) testNaN {
+    // CAVolumeCurve clamps NaN scalars to 0. It doesn't handle NaN dB values, but the table gives
+    // the minimum volume for them as well.
+    BGM_VolumeCurveTable theTable(0, 96, -96.0f, 0.0f);
+    const Float32 theNaN = std::numeric_limits<Float32>::quiet_NaN();
+
+    XCTAssertEqual(theTable.ConvertScalarToRaw(theNaN), theTable.GetCurve().ConvertScalarToRaw(theNaN));
+    XCTAssertEqual(theTable.ConvertScalarToRaw(theNaN), 0);
+    XCTAssertEqual(theTable.ConvertDBToRaw(theNaN), 0);
+}
+
+@end
+
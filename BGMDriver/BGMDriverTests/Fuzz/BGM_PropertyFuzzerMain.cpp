@@ -0,0 +1,61 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PropertyFuzzerMain.cpp
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  libFuzzer's entry points for BGM_PropertyFuzzer. Built by build_fuzzers.sh, not by Xcode. See
+//  README.md.
+//
+
+// Local Includes
+#include "BGM_PropertyFuzzer.h"
+
+// STL Includes
+#include <cstdint>
+#include <cstdlib>
+
+
+// Created once and reused for every input, since creating a BGM_Device is much slower than running
+// an input. Never destroyed, because libFuzzer exits without returning.
+static BGM_PropertyFuzzer* gFuzzer = nullptr;
+
+extern "C" int LLVMFuzzerInitialize(int* argc, char*** argv)
+{
+    #pragma unused (argc, argv)
+
+    // Write the seed corpus and exit, if asked to, so build_fuzzers.sh doesn't need another tool to
+    // generate it.
+    const char* theSeedDirectory = getenv("BGM_FUZZ_WRITE_SEEDS");
+
+    if(theSeedDirectory != nullptr)
+    {
+        BGM_PropertyFuzzer::WriteSeeds(theSeedDirectory);
+        exit(0);
+    }
+
+    gFuzzer = new BGM_PropertyFuzzer;
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* inData, size_t inSize)
+{
+    gFuzzer->RunInput(inData, inSize);
+    return 0;
+}
+
@@ -0,0 +1,110 @@
+#!/bin/bash
+# vim: tw=0:
+
+# This file is part of Background Music.
+#
+# Background Music is free software: you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation, either version 2 of the
+# License, or (at your option) any later version.
+#
+# Background Music is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+#
+# build_fuzzers.sh
+# BGMDriverTests
+#
+# Copyright © 2026 Kyle Neideck
+#
+# Builds the libFuzzer harnesses for BGMDriver and generates their seed corpora. See README.md.
+#
+# Environment variables:
+#   CXX         The clang++ to build with. Has to include libFuzzer, which Apple's doesn't. Defaults
+#               to Homebrew's LLVM.
+#   BUILD_DIR   Where to put the fuzzers and corpora. Defaults to build/ in this directory.
+#   SANITIZERS  Defaults to "address,undefined".
+#
+
+# Safe mode
+set -euo pipefail
+IFS=$'\n\t'
+
+# The dir containing this script
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+TESTS_DIR="$( cd "${SCRIPT_DIR}/.." && pwd )"
+DRIVER_DIR="$( cd "${TESTS_DIR}/../BGMDriver" && pwd )"
+PUBLIC_UTILITY_DIR="$( cd "${TESTS_DIR}/../PublicUtility" && pwd )"
+SHARED_SOURCE_DIR="$( cd "${TESTS_DIR}/../../SharedSource" && pwd )"
+
+if [[ -z "${CXX:-}" ]]; then
+    if ! LLVM_PREFIX="$(brew --prefix llvm 2>/dev/null)"; then
+        echo "Couldn't find LLVM. Install it with \"brew install llvm\" or set CXX." >&2
+        exit 1
+    fi
+    CXX="${LLVM_PREFIX}/bin/clang++"
+fi
+
+BUILD_DIR="${BUILD_DIR:-${SCRIPT_DIR}/build}"
+SANITIZERS="${SANITIZERS:-address,undefined}"
+OBJ_DIR="${BUILD_DIR}/obj"
+
+mkdir -p "${OBJ_DIR}"
+
+# The release build's definitions, so the fuzzers aren't slowed down by debug logging.
+COMMON_FLAGS=(-g -O1 -fno-omit-frame-pointer
+              "-fsanitize=fuzzer-no-link,${SANITIZERS}"
+              -mmacosx-version-min=10.9
+              -DDEBUG=0 -DCoreAudio_Debug=0 -DCoreAudio_UseSysLog=1 -DCoreAudio_StopOnAssert=0
+              -DCoreAudio_ThreadStampMessages=0
+              "-I${DRIVER_DIR}" "-I${DRIVER_DIR}/DeviceClients" "-I${PUBLIC_UTILITY_DIR}"
+              "-I${SHARED_SOURCE_DIR}" "-I${TESTS_DIR}")
+
+# The driver's sources, minus the HAL plugin's entry points, and the fuzzers' shared sources.
+SOURCES=()
+for SOURCE in "${DRIVER_DIR}"/*.cpp "${DRIVER_DIR}"/*.m "${DRIVER_DIR}"/DeviceClients/*.cpp \
+              "${PUBLIC_UTILITY_DIR}"/*.cpp "${SHARED_SOURCE_DIR}"/BGM_Utils.cpp \
+              "${TESTS_DIR}"/BGM_MockHost.cpp "${TESTS_DIR}"/BGM_PropertyFuzzer.cpp; do
+    if [[ "$(basename "${SOURCE}")" != "BGM_PlugInInterface.cpp" ]]; then
+        SOURCES+=("${SOURCE}")
+    fi
+done
+
+OBJECTS=()
+for SOURCE in "${SOURCES[@]}"; do
+    OBJECT="${OBJ_DIR}/$(basename "${SOURCE}").o"
+
+    if [[ "${SOURCE}" == *.m ]]; then
+        "${CXX}" -x objective-c -fobjc-arc "${COMMON_FLAGS[@]}" -c "${SOURCE}" -o "${OBJECT}"
+    else
+        "${CXX}" -std=c++11 -stdlib=libc++ "${COMMON_FLAGS[@]}" -c "${SOURCE}" -o "${OBJECT}"
+    fi
+
+    OBJECTS+=("${OBJECT}")
+done
+
+FRAMEWORKS=(-framework CoreFoundation -framework CoreAudio -framework Foundation
+            -framework Accelerate)
+
+echo "Building BGMPropertyFuzzer"
+"${CXX}" -std=c++11 -stdlib=libc++ "${COMMON_FLAGS[@]}" "-fsanitize=fuzzer,${SANITIZERS}" \
+    "${SCRIPT_DIR}/BGM_PropertyFuzzerMain.cpp" "${OBJECTS[@]}" "${FRAMEWORKS[@]}" \
+    -o "${BUILD_DIR}/BGMPropertyFuzzer"
+
+# Generate the seed corpus. The fuzzer adds the inputs it finds to the same directory when it runs,
+# so only write the seeds if it doesn't exist yet.
+CORPUS_DIR="${BUILD_DIR}/corpus/property"
+
+if [[ ! -d "${CORPUS_DIR}" ]]; then
+    mkdir -p "${CORPUS_DIR}"
+    BGM_FUZZ_WRITE_SEEDS="${CORPUS_DIR}" "${BUILD_DIR}/BGMPropertyFuzzer"
+fi
+
+echo "Done. To run it:"
+echo "    \"${BUILD_DIR}/BGMPropertyFuzzer\" \"${CORPUS_DIR}\""
+
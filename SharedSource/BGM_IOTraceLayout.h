@@ -0,0 +1,151 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOTraceLayout.h
+//  SharedSource
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The format of the IO traces BGMDriver records while kAudioDeviceCustomPropertyIOTrace is
+//  enabled. See BGM_Types.h and BGM_IOTraceRecorder.h.
+//
+//  This header is plain C with no Apple dependencies so traces can be read on any POSIX system,
+//  e.g. with SharedSource/IOTrace.
+//
+//  A trace is a BGMIOTraceFileHeader followed by records. Each record is a BGMIOTraceRecordHeader
+//  followed by mPayloadSize bytes of payload and then zero padding up to the next multiple of
+//  kBGMIOTraceRecordAlignment bytes. Everything is in the recording machine's byte order, which is
+//  little-endian on every Mac BGMDriver supports.
+//
+//  The records are the calls the HAL made to the device, in the order BGMDriver received them:
+//  clients being added and removed, clients starting and stopping IO, IO operations and properties
+//  being set. Recording starts with records that recreate the device's state at the time, e.g. one
+//  kBGMIOTraceRecord_AddClient per existing client, so a trace can be replayed on a new device.
+//
+
+#ifndef SharedSource__BGM_IOTraceLayout
+#define SharedSource__BGM_IOTraceLayout
+
+// System Includes
+#include <stdint.h>
+
+
+// 'BGMT'
+#define kBGMIOTraceMagic                    0x42474D54u
+// Incremented whenever the format changes incompatibly.
+#define kBGMIOTraceVersion                  1u
+#define kBGMIOTraceRecordAlignment          8u
+
+// BGMIOTraceFileHeader flags
+//
+// The IO operation records include the audio the HAL passed to the driver.
+#define kBGMIOTraceFlag_IncludesBuffers     (1u << 0)
+
+// Record types
+//
+// 'addc' and 'remc'. The payload is a BGMIOTraceClientPayload.
+#define kBGMIOTraceRecord_AddClient         0x61646463u
+#define kBGMIOTraceRecord_RemoveClient      0x72656D63u
+// 'stio' and 'spio'. The payload is a BGMIOTraceClientIOPayload.
+#define kBGMIOTraceRecord_StartIO           0x7374696Fu
+#define kBGMIOTraceRecord_StopIO            0x7370696Fu
+// 'ioop'. The payload is a BGMIOTraceIOOperationPayload.
+#define kBGMIOTraceRecord_IOOperation       0x696F6F70u
+// 'setp'. The payload is a BGMIOTraceSetPropertyPayload.
+#define kBGMIOTraceRecord_SetProperty       0x73657470u
+// 'cfgc'. The payload is a BGMIOTraceConfigChangePayload.
+#define kBGMIOTraceRecord_ConfigChange      0x63666763u
+
+// The IO operation IDs from AudioServerPlugIn.h that BGMDriver records.
+#define kBGMIOTraceOperation_ReadInput      0x72656164u     // 'read'
+#define kBGMIOTraceOperation_ProcessOutput  0x706F7574u     // 'pout'
+#define kBGMIOTraceOperation_ProcessMix     0x706D6978u     // 'pmix'
+#define kBGMIOTraceOperation_WriteMix       0x72697465u     // 'rite'
+
+typedef struct BGMIOTraceFileHeader
+{
+    uint32_t            mMagic;
+    uint32_t            mVersion;
+    uint32_t            mHeaderSize;
+    uint32_t            mFlags;
+    // The device's nominal sample rate when recording started.
+    double              mSampleRate;
+    // The number of channels in the audio buffers. Samples are interleaved 32-bit floats.
+    uint32_t            mChannelsPerFrame;
+    uint32_t            mReserved;
+} BGMIOTraceFileHeader;
+
+typedef struct BGMIOTraceRecordHeader
+{
+    uint32_t            mType;
+    // Not including the padding.
+    uint32_t            mPayloadSize;
+    // The time the driver received the call, in nanoseconds since recording started.
+    uint64_t            mNanos;
+} BGMIOTraceRecordHeader;
+
+// Followed by mBundleIDLength bytes of the client's bundle ID in UTF-8, not null-terminated.
+typedef struct BGMIOTraceClientPayload
+{
+    uint32_t            mClientID;
+    int32_t             mProcessID;
+    uint32_t            mIsNativeEndian;
+    uint32_t            mBundleIDLength;
+} BGMIOTraceClientPayload;
+
+typedef struct BGMIOTraceClientIOPayload
+{
+    uint32_t            mClientID;
+    uint32_t            mReserved;
+} BGMIOTraceClientIOPayload;
+
+// Followed by mBufferSize bytes of audio, as the HAL passed it to the driver (i.e. before the
+// driver processed it). mBufferSize is 0 if the trace doesn't include buffers and for ReadInput,
+// which has no audio going into the driver.
+typedef struct BGMIOTraceIOOperationPayload
+{
+    uint32_t            mOperationID;
+    uint32_t            mClientID;
+    uint32_t            mIOBufferFrameSize;
+    uint32_t            mBufferSize;
+    double              mInputSampleTime;
+    double              mOutputSampleTime;
+} BGMIOTraceIOOperationPayload;
+
+// Followed by mDataSize bytes of data. If mIsPropertyList is non-zero, the data is the property's
+// CF value serialized as a binary property list. Otherwise, it's the data that was passed to
+// SetPropertyData.
+typedef struct BGMIOTraceSetPropertyPayload
+{
+    uint32_t            mObjectID;
+    uint32_t            mSelector;
+    uint32_t            mScope;
+    uint32_t            mElement;
+    int32_t             mClientProcessID;
+    uint32_t            mIsPropertyList;
+    uint32_t            mDataSize;
+    uint32_t            mReserved;
+} BGMIOTraceSetPropertyPayload;
+
+// The change action BGMDriver passed to PerformConfigChange, after the HAL stopped IO for it. See
+// BGM_Device::ChangeAction.
+typedef struct BGMIOTraceConfigChangePayload
+{
+    uint64_t            mChangeAction;
+} BGMIOTraceConfigChangePayload;
+
+#endif /* SharedSource__BGM_IOTraceLayout */
+
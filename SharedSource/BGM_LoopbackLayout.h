@@ -0,0 +1,117 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_LoopbackLayout.h
+//  SharedSource
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The layout of the shared memory segments BGMDriver mirrors its loopback audio into. See
+//  kAudioDeviceCustomPropertyLoopbackSharedMemory in BGM_Types.h.
+//
+//  This header is plain C with no Apple dependencies so consumers can include it on any POSIX
+//  system. BGMDriver is the only writer. Consumers map the segment read-only, so they can't
+//  affect the driver beyond the cost of the mapping itself.
+//
+//  A segment is a BGMLoopbackSegmentHeader followed (at mDataOffset) by a ring of
+//  mCapacityFrames frames of interleaved, native-endian Float32 audio. The frame with sample time
+//  T is stored at ring index (T & (mCapacityFrames - 1)).
+//
+//  The writer publishes a cycle's audio like this:
+//
+//    1. mWriteInProgressEndSampleTime = T + N (release)
+//    2. Write frames [T, T + N) into the ring.
+//    3. mWriteEndSampleTime = T + N (release)
+//
+//  So a reader that copies frames [S, E) with E <= mWriteEndSampleTime knows its copy is intact if,
+//  after the copy (and an acquire fence), S >= mWriteInProgressEndSampleTime - mCapacityFrames and
+//  mResetCount hasn't changed (and wasn't odd). The writer never waits for readers. A reader that
+//  falls behind just loses the frames that were overwritten and has to skip ahead.
+//
+
+#ifndef SharedSource__BGM_LoopbackLayout
+#define SharedSource__BGM_LoopbackLayout
+
+// System Includes
+#include <stdint.h>
+
+
+// Segment names
+
+// POSIX shared memory names are limited to 31 characters on macOS, including the leading slash.
+#define kBGMLoopbackSegmentName             "/BGMDevice.loopback"
+#define kBGMLoopbackSegmentName_UISounds    "/BGMDevice_UISounds.loopback"
+// Per-app capture taps (see kAudioDeviceCustomPropertyCaptureTaps) use the same layout. Their names
+// are these prefixes followed by the index of the tap, e.g. "/BGMDevice.tap.0".
+#define kBGMCaptureTapSegmentNamePrefix             "/BGMDevice.tap."
+#define kBGMCaptureTapSegmentNamePrefix_UISounds    "/BGMDevice_UISounds.tap."
+// The devices created with kAudioPlugInCustomPropertyDynamicDevices are named by their index, since
+// their UIDs could be too long, e.g. "/BGMDevice.3.loopback" and "/BGMDevice.3.tap.0". (printf
+// formats.) The property also gives each device's loopback segment name.
+#define kBGMLoopbackSegmentNameFormat_Dynamic           "/BGMDevice.%u.loopback"
+#define kBGMCaptureTapSegmentNamePrefixFormat_Dynamic   "/BGMDevice.%u.tap."
+
+// Segment permissions
+
+// The segments are only readable by coreaudiod's user by default, since they'd otherwise let any
+// process read the system's audio without the microphone permission the HAL requires for
+// BGMDevice's input stream. If a group with this name exists, the driver makes the segments
+// readable by its members. _coreaudiod has to be a member as well. See LoopbackReader/README.md.
+#define kBGMLoopbackReadersGroupName        "_bgmloopback"
+
+// Segment layout
+
+// 'BGML'
+#define kBGMLoopbackSegmentMagic            0x42474D4Cu
+// Incremented whenever the layout changes incompatibly.
+#define kBGMLoopbackSegmentVersion          1u
+// The audio data starts at a page-aligned offset so consumers can mmap it directly.
+#define kBGMLoopbackSegmentDataOffset       4096u
+
+typedef struct BGMLoopbackSegmentHeader
+{
+    // Constant after the segment has been created.
+    uint32_t            mMagic;
+    uint32_t            mVersion;
+    uint32_t            mHeaderSize;
+    uint32_t            mDataOffset;
+    uint32_t            mChannelsPerFrame;
+    uint32_t            mBytesPerFrame;
+    // Always a power of two.
+    uint32_t            mCapacityFrames;
+    uint32_t            mReserved0;
+
+    // Guards mSampleRate. Odd while the writer is changing it.
+    uint64_t            mFormatSequence;
+    double              mSampleRate;
+
+    // Incremented twice when the sample times jump backwards or by more than the capacity of the
+    // ring, e.g. when IO restarts. Odd while the writer is resetting the sample times below.
+    // Readers should resynchronise when it changes.
+    uint64_t            mResetCount;
+    // The first sample time written since the last reset. Frames before this are invalid.
+    int64_t             mValidStartSampleTime;
+    // The end (exclusive) of the frames the writer is currently writing. Frames before
+    // mWriteInProgressEndSampleTime - mCapacityFrames may be overwritten at any time.
+    int64_t             mWriteInProgressEndSampleTime;
+    // The end (exclusive) of the frames that have been completely written.
+    int64_t             mWriteEndSampleTime;
+    // The number of times the driver has written to the segment. Only for diagnostics.
+    uint64_t            mWriteCount;
+} BGMLoopbackSegmentHeader;
+
+#endif /* SharedSource__BGM_LoopbackLayout */
+
@@ -73,6 +73,24 @@ enum
     kObjectID_Stream_Input_UI_Sounds            = 10,  // Belongs to kObjectID_Device_UI_Sounds
     kObjectID_Stream_Output_UI_Sounds           = 11,  // Belongs to kObjectID_Device_UI_Sounds
     kObjectID_Volume_Output_Master_UI_Sounds    = 12,  // Belongs to kObjectID_Device_UI_Sounds
+    // The devices created with kAudioPlugInCustomPropertyDynamicDevices use the IDs from here on.
+    // See kBGMDynamicDeviceObjectIDs.
+    kObjectID_FirstDynamic                      = 16
+};
+
+// The maximum number of devices kAudioPlugInCustomPropertyDynamicDevices can create.
+#define kBGMMaxDynamicDevices           32
+
+// Each dynamic device gets a block of this many object IDs, starting at kObjectID_FirstDynamic for
+// the first device. Its objects' IDs are at these offsets into the block.
+#define kBGMDynamicDeviceObjectIDs      5
+enum
+{
+    kBGMDynamicDeviceObjectIDOffset_Device          = 0,
+    kBGMDynamicDeviceObjectIDOffset_Stream_Input    = 1,
+    kBGMDynamicDeviceObjectIDOffset_Stream_Output   = 2,
+    kBGMDynamicDeviceObjectIDOffset_Volume          = 3,
+    kBGMDynamicDeviceObjectIDOffset_Mute            = 4
 };
 
 // AudioObjectPropertyElement docs: "Elements are numbered sequentially where 0 represents the
@@ -84,9 +102,27 @@ static const AudioObjectPropertyElement kMasterChannel = kAudioObjectPropertyEle
 enum
 {
     // A CFBoolean. True if the null device is enabled. Settable, false by default.
-    kAudioPlugInCustomPropertyNullDeviceActive = 'nuld'
+    kAudioPlugInCustomPropertyNullDeviceActive = 'nuld',
+    // A CFArray of CFDictionaries, one for each extra instance of BGMDevice the driver should publish,
+    // e.g. to play one group of apps through separately from another. Each device has its own
+    // streams, controls, clients and loopback audio. Settable, empty by default. Setting it creates
+    // the devices that aren't in the current list and destroys the ones that are no longer in it.
+    // At most kBGMMaxDynamicDevices. See the dictionary keys below.
+    kAudioPlugInCustomPropertyDynamicDevices   = 'dynd'
 };
 
+// kAudioPlugInCustomPropertyDynamicDevices keys
+//
+// The device's UID as a CFString. Required when setting the property. Has to be unique and can't be
+// one of the UIDs of the devices the driver always publishes.
+#define kBGMDynamicDeviceKey_UID            "uid"
+// The device's name as a CFString. Optional when setting the property. The UID is used by default.
+#define kBGMDynamicDeviceKey_Name           "name"
+// The name of the device's loopback shared memory segment as a CFString, e.g.
+// "/BGMDevice.0.loopback". Ignored when setting the property. See
+// kAudioDeviceCustomPropertyLoopbackSharedMemory.
+#define kBGMDynamicDeviceKey_SegmentName    "shm"
+
 #pragma mark BGMDevice Custom Properties
 
 enum
@@ -120,7 +156,36 @@ enum
     kAudioDeviceCustomPropertyAppVolumes                              = 'apvs',
     // A CFArray of CFBooleans indicating which of BGMDevice's controls are enabled. All controls are enabled
     // by default. This property is settable. See the array indices below for more info.
-    kAudioDeviceCustomPropertyEnabledOutputControls                   = 'bgct'
+    kAudioDeviceCustomPropertyEnabledOutputControls                   = 'bgct',
+    // A CFBoolean. True if the device is mirroring its loopback audio into a shared memory segment that
+    // local processes can read without becoming clients of the device. Settable, false by default. See
+    // BGM_LoopbackLayout.h and SharedSource/LoopbackReader.
+    kAudioDeviceCustomPropertyLoopbackSharedMemory                    = 'lshm',
+    // A CFArray of CFDictionaries, one for each app whose audio is being captured on its own into a
+    // loopback shared memory segment (a "capture tap"). The taps get each app's audio after its
+    // relative volume and pan position have been applied. Settable, empty by default. Setting it
+    // replaces the set of tapped apps. See the dictionary keys below.
+    kAudioDeviceCustomPropertyCaptureTaps                             = 'ctap',
+    // A CFBoolean. True if the device's output goes through a look-ahead limiter instead of each app's
+    // audio being clipped when its relative volume boosts it above full scale. The limiter delays the
+    // audio by a few milliseconds, which is added to the output stream's kAudioStreamPropertyLatency.
+    // Settable, false by default. Changing it requires a configuration change, so it takes effect
+    // asynchronously.
+    kAudioDeviceCustomPropertyBoostLimiter                            = 'blim',
+    // A CFDictionary of settings for ducking, i.e. turning down, the music player while other apps are
+    // playing audio. An alternative to BGMApp pausing the music player, which reacts within an IO cycle
+    // instead of after a delay. See the dictionary keys below and BGM_Ducker.h. Settable. Keys left out
+    // when setting the property keep their current values. Disabled by default.
+    kAudioDeviceCustomPropertyMusicDucking                            = 'mdck',
+    // A CFDictionary of histograms of how long BGMDriver's IO operations take, for working out whether
+    // it's the cause of "Audio IO Overload" messages in the system log. See the dictionary keys below and
+    // BGM_IOProfiler.h. Only has the histograms if BGMDriver was built with BGM_IO_PROFILING=1. Setting
+    // the property to any CFDictionary clears the histograms.
+    kAudioDeviceCustomPropertyIOProfile                               = 'iopf',
+    // A CFDictionary for recording the calls the HAL makes to the device into a trace file, which can
+    // be replayed offline. See the dictionary keys below, BGM_IOTraceLayout.h and SharedSource/IOTrace.
+    // Settable. Not recording by default.
+    kAudioDeviceCustomPropertyIOTrace                                 = 'iotr'
 };
 
 // The number of silent/audible frames before BGMDriver will change kAudioDeviceCustomPropertyDeviceAudibleState
@@ -153,6 +218,62 @@ enum BGMDeviceAudibleState : SInt32
 // The app's bundle ID as a CFString. May be omitted if kBGMAppVolumesKey_ProcessID is present.
 #define kBGMAppVolumesKey_BundleID          "bid"
 
+// kAudioDeviceCustomPropertyCaptureTaps keys
+//
+// The app's bundle ID as a CFString. Required when setting the property.
+#define kBGMCaptureTapsKey_BundleID         "bid"
+// The name of the tap's shared memory segment as a CFString, e.g. "/BGMDevice.tap.0". Ignored when
+// setting the property. Read the segment with SharedSource/LoopbackReader.
+#define kBGMCaptureTapsKey_SegmentName      "shm"
+
+// kAudioDeviceCustomPropertyMusicDucking keys
+//
+// A CFBoolean. True if the music player should be ducked.
+#define kBGMMusicDuckingKey_Enabled         "enb"
+// A CFNumber<Float32> between 0 and 1. The gain to duck the music player's audio to.
+#define kBGMMusicDuckingKey_Gain            "gain"
+// A CFNumber<Float32> greater than 0. The peak sample value in the other apps' audio (after their relative
+// volumes are applied) that causes ducking.
+#define kBGMMusicDuckingKey_Threshold       "thr"
+// CFNumber<Float64>s. The times, in seconds, to duck the music, to keep it ducked after the other apps
+// stop playing audio and then to bring it back up.
+#define kBGMMusicDuckingKey_AttackSeconds   "atk"
+#define kBGMMusicDuckingKey_HoldSeconds     "hld"
+#define kBGMMusicDuckingKey_ReleaseSeconds  "rel"
+
+// kAudioDeviceCustomPropertyIOProfile keys
+//
+// A CFBoolean. True if BGMDriver was built with profiling enabled.
+#define kBGMIOProfileKey_Enabled            "enb"
+// A CFDictionary of the operations' names (e.g. "ProcessOutput") to their histograms, which are
+// dictionaries with the keys below. Times are in nanoseconds.
+#define kBGMIOProfileKey_Operations         "ops"
+// CFNumber<UInt64>s. The number of times the operation was timed, their total and the longest.
+#define kBGMIOProfileKey_Count              "cnt"
+#define kBGMIOProfileKey_TotalNanos         "tot"
+#define kBGMIOProfileKey_MaxNanos           "max"
+// A CFArray of the non-empty buckets, each a CFArray of two CFNumber<UInt64>s: the shortest time
+// in the bucket and the number of times in it. Each bucket ends where the next possible one starts.
+#define kBGMIOProfileKey_Buckets            "bkt"
+
+// kAudioDeviceCustomPropertyIOTrace keys
+//
+// A CFBoolean. True while recording. Setting it to true starts a new trace and setting it to false
+// stops recording and writes the trace to a new file.
+#define kBGMIOTraceKey_Enabled              "enb"
+// A CFString. The path of the last trace the driver wrote. Traces are written to a directory only
+// coreaudiod's user can read, since they can include audio. Ignored when setting the property.
+#define kBGMIOTraceKey_Path                 "path"
+// A CFBoolean. True if the audio passed to each IO operation should be recorded. False by default.
+#define kBGMIOTraceKey_IncludeBuffers       "buf"
+// A CFNumber<UInt64>. The size of the buffer the trace is recorded into. 16 MB by default and at most
+// 64 MB. Records that don't fit are dropped.
+#define kBGMIOTraceKey_CapacityBytes        "cap"
+// CFNumber<UInt64>s. The size of the trace so far and the number of records dropped because the
+// buffer was full. Ignored when setting the property.
+#define kBGMIOTraceKey_UsedBytes            "used"
+#define kBGMIOTraceKey_DroppedRecords       "drop"
+
 // Volume curve range for app volumes
 #define kAppRelativeVolumeMaxRawValue   100
 #define kAppRelativeVolumeMinRawValue   0
@@ -173,6 +294,16 @@ enum
     kBGMEnabledOutputControlsIndex_Mute   = 1
 };
 
+#pragma mark Sample Rates
+
+// The sample rates BGMDevice lists individually in kAudioDevicePropertyAvailableNominalSampleRates
+// and its streams' available formats, so they show up in Audio MIDI Setup. It also accepts any
+// other rate, so it can always be set to match the output device.
+#define kBGMNumStandardSampleRates  6
+static const Float64 kBGMStandardSampleRates[kBGMNumStandardSampleRates] = {
+    44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0
+};
+
 #pragma mark BGMDevice Custom Property Addresses
 
 // For convenience.
@@ -213,6 +344,42 @@ static const AudioObjectPropertyAddress kBGMEnabledOutputControlsAddress = {
     kAudioObjectPropertyElementMaster
 };
 
+static const AudioObjectPropertyAddress kBGMLoopbackSharedMemoryAddress = {
+    kAudioDeviceCustomPropertyLoopbackSharedMemory,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kBGMCaptureTapsAddress = {
+    kAudioDeviceCustomPropertyCaptureTaps,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kBGMBoostLimiterAddress = {
+    kAudioDeviceCustomPropertyBoostLimiter,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kBGMMusicDuckingAddress = {
+    kAudioDeviceCustomPropertyMusicDucking,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kBGMIOProfileAddress = {
+    kAudioDeviceCustomPropertyIOProfile,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kBGMIOTraceAddress = {
+    kAudioDeviceCustomPropertyIOTrace,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
 #pragma mark XPC Return Codes
 
 enum {
@@ -0,0 +1,269 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMIOTraceReader.c
+//  SharedSource
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMIOTraceReader.h"
+
+// System Includes
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+struct BGMIOTraceReader
+{
+    uint8_t*                            mData;
+    size_t                              mSize;
+    // The offset of the first record.
+    size_t                              mRecordsOffset;
+    // The offset of the next record.
+    size_t                              mPosition;
+};
+
+static size_t   BGMAlignRecordSize(size_t inSize)
+{
+    return (inSize + kBGMIOTraceRecordAlignment - 1) & ~(size_t)(kBGMIOTraceRecordAlignment - 1);
+}
+
+// Takes ownership of inData.
+static BGMIOTraceReader*    BGMIOTraceReaderCreate(uint8_t* inData, size_t inSize)
+{
+    const BGMIOTraceFileHeader* theHeader = (const BGMIOTraceFileHeader*)inData;
+
+    int theHeaderIsValid =
+            inSize >= sizeof(BGMIOTraceFileHeader) &&
+            theHeader->mMagic == kBGMIOTraceMagic &&
+            theHeader->mVersion == kBGMIOTraceVersion &&
+            theHeader->mHeaderSize >= sizeof(BGMIOTraceFileHeader) &&
+            theHeader->mHeaderSize <= inSize &&
+            (theHeader->mHeaderSize % kBGMIOTraceRecordAlignment) == 0 &&
+            theHeader->mChannelsPerFrame > 0;
+
+    BGMIOTraceReader* theReader = theHeaderIsValid ? calloc(1, sizeof(BGMIOTraceReader)) : NULL;
+
+    if(theReader == NULL)
+    {
+        free(inData);
+        errno = theHeaderIsValid ? ENOMEM : EPROTO;
+        return NULL;
+    }
+
+    theReader->mData = inData;
+    theReader->mSize = inSize;
+    theReader->mRecordsOffset = theHeader->mHeaderSize;
+    theReader->mPosition = theHeader->mHeaderSize;
+
+    return theReader;
+}
+
+BGMIOTraceReader*   BGMIOTraceReaderOpen(const char* inPath)
+{
+    if(inPath == NULL)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    FILE* theFile = fopen(inPath, "rb");
+
+    if(theFile == NULL)
+    {
+        return NULL;
+    }
+
+    uint8_t* theData = NULL;
+    size_t theSize = 0;
+    long theFileSize = -1;
+
+    if(fseek(theFile, 0, SEEK_END) == 0)
+    {
+        theFileSize = ftell(theFile);
+    }
+
+    if(theFileSize >= 0 && fseek(theFile, 0, SEEK_SET) == 0)
+    {
+        theSize = (size_t)theFileSize;
+        // Allocate at least one byte so an empty file gets EPROTO rather than ENOMEM.
+        theData = malloc(theSize > 0 ? theSize : 1);
+
+        if(theData == NULL)
+        {
+            errno = ENOMEM;
+        }
+        else if(fread(theData, 1, theSize, theFile) != theSize)
+        {
+            free(theData);
+            theData = NULL;
+            errno = EIO;
+        }
+    }
+
+    int theErrno = errno;
+    fclose(theFile);
+
+    if(theData == NULL)
+    {
+        errno = theErrno;
+        return NULL;
+    }
+
+    return BGMIOTraceReaderCreate(theData, theSize);
+}
+
+BGMIOTraceReader*   BGMIOTraceReaderOpenData(const void* inData, size_t inSize)
+{
+    if(inData == NULL)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    uint8_t* theData = malloc(inSize > 0 ? inSize : 1);
+
+    if(theData == NULL)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    memcpy(theData, inData, inSize);
+
+    return BGMIOTraceReaderCreate(theData, inSize);
+}
+
+void    BGMIOTraceReaderClose(BGMIOTraceReader* inReader)
+{
+    if(inReader != NULL)
+    {
+        free(inReader->mData);
+        free(inReader);
+    }
+}
+
+const BGMIOTraceFileHeader* BGMIOTraceReaderGetFileHeader(const BGMIOTraceReader* inReader)
+{
+    return (const BGMIOTraceFileHeader*)inReader->mData;
+}
+
+// Returns non-zero if a payload of inPayloadSize bytes is big enough for a record of type inType,
+// including the variable-length data after the payload struct.
+static int  BGMPayloadSizeIsValid(uint32_t inType, const void* inPayload, uint32_t inPayloadSize)
+{
+    switch(inType)
+    {
+        case kBGMIOTraceRecord_AddClient:
+        case kBGMIOTraceRecord_RemoveClient:
+            return inPayloadSize >= sizeof(BGMIOTraceClientPayload) &&
+                    ((const BGMIOTraceClientPayload*)inPayload)->mBundleIDLength <=
+                            inPayloadSize - sizeof(BGMIOTraceClientPayload);
+
+        case kBGMIOTraceRecord_StartIO:
+        case kBGMIOTraceRecord_StopIO:
+            return inPayloadSize >= sizeof(BGMIOTraceClientIOPayload);
+
+        case kBGMIOTraceRecord_IOOperation:
+            return inPayloadSize >= sizeof(BGMIOTraceIOOperationPayload) &&
+                    ((const BGMIOTraceIOOperationPayload*)inPayload)->mBufferSize <=
+                            inPayloadSize - sizeof(BGMIOTraceIOOperationPayload);
+
+        case kBGMIOTraceRecord_SetProperty:
+            return inPayloadSize >= sizeof(BGMIOTraceSetPropertyPayload) &&
+                    ((const BGMIOTraceSetPropertyPayload*)inPayload)->mDataSize <=
+                            inPayloadSize - sizeof(BGMIOTraceSetPropertyPayload);
+
+        case kBGMIOTraceRecord_ConfigChange:
+            return inPayloadSize >= sizeof(BGMIOTraceConfigChangePayload);
+
+        default:
+            // Unknown types are allowed so newer traces can add them. Readers should skip them.
+            return 1;
+    }
+}
+
+BGMIOTraceReaderStatus  BGMIOTraceReaderNext(BGMIOTraceReader* inReader,
+                                             const BGMIOTraceRecordHeader** outHeader,
+                                             const void** outPayload)
+{
+    if(inReader == NULL || outHeader == NULL || outPayload == NULL)
+    {
+        return kBGMIOTraceReader_BadArgument;
+    }
+
+    *outHeader = NULL;
+    *outPayload = NULL;
+
+    if(inReader->mPosition >= inReader->mSize)
+    {
+        return kBGMIOTraceReader_End;
+    }
+
+    const size_t theRemaining = inReader->mSize - inReader->mPosition;
+
+    if(theRemaining < sizeof(BGMIOTraceRecordHeader))
+    {
+        return kBGMIOTraceReader_Truncated;
+    }
+
+    const BGMIOTraceRecordHeader* theHeader =
+            (const BGMIOTraceRecordHeader*)(inReader->mData + inReader->mPosition);
+
+    if(theHeader->mPayloadSize > theRemaining - sizeof(BGMIOTraceRecordHeader))
+    {
+        return kBGMIOTraceReader_Truncated;
+    }
+
+    const void* thePayload = theHeader + 1;
+
+    if(!BGMPayloadSizeIsValid(theHeader->mType, thePayload, theHeader->mPayloadSize))
+    {
+        return kBGMIOTraceReader_BadRecord;
+    }
+
+    // The padding after the last record can be left off.
+    size_t theRecordSize = BGMAlignRecordSize(sizeof(BGMIOTraceRecordHeader) + theHeader->mPayloadSize);
+    inReader->mPosition = theRecordSize < theRemaining ? inReader->mPosition + theRecordSize : inReader->mSize;
+
+    *outHeader = theHeader;
+    *outPayload = thePayload;
+
+    return kBGMIOTraceReader_OK;
+}
+
+void    BGMIOTraceReaderRewind(BGMIOTraceReader* inReader)
+{
+    inReader->mPosition = inReader->mRecordsOffset;
+}
+
+uint64_t    BGMIOTraceHash(uint64_t inHash, const void* inData, size_t inSize)
+{
+    const uint8_t* theBytes = (const uint8_t*)inData;
+
+    for(size_t i = 0; i < inSize; i++)
+    {
+        inHash ^= theBytes[i];
+        inHash *= 0x100000001B3ull;
+    }
+
+    return inHash;
+}
+
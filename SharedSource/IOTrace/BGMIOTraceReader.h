@@ -0,0 +1,86 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMIOTraceReader.h
+//  SharedSource
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  A small C library for reading the IO traces BGMDriver records. It only depends on the C
+//  standard library, so it also builds on Linux. See BGM_IOTraceLayout.h for the format.
+//
+//  The reader checks each record's size against its type, so the payload pointers it returns can
+//  be cast to the payload structs in BGM_IOTraceLayout.h and the data following them read safely.
+//
+//  A BGMIOTraceReader isn't thread safe.
+//
+
+#ifndef SharedSource__BGMIOTraceReader
+#define SharedSource__BGMIOTraceReader
+
+// Local Includes
+#include "BGM_IOTraceLayout.h"
+
+// System Includes
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef enum BGMIOTraceReaderStatus
+{
+    kBGMIOTraceReader_OK                = 0,
+    // There are no more records.
+    kBGMIOTraceReader_End               = 1,
+    // The trace ends part way through a record, e.g. because the driver was stopped while it was
+    // writing the file.
+    kBGMIOTraceReader_Truncated         = 2,
+    // A record's payload is too small for its type.
+    kBGMIOTraceReader_BadRecord         = 3,
+    kBGMIOTraceReader_BadArgument       = 4
+} BGMIOTraceReaderStatus;
+
+typedef struct BGMIOTraceReader BGMIOTraceReader;
+
+// Read a trace file into memory. Returns NULL and sets errno on failure. errno is set to EPROTO if
+// the file isn't a trace or has an unsupported version.
+BGMIOTraceReader*       BGMIOTraceReaderOpen(const char* inPath);
+// The same, but copies the trace from memory.
+BGMIOTraceReader*       BGMIOTraceReaderOpenData(const void* inData, size_t inSize);
+void                    BGMIOTraceReaderClose(BGMIOTraceReader* inReader);
+
+const BGMIOTraceFileHeader* BGMIOTraceReaderGetFileHeader(const BGMIOTraceReader* inReader);
+
+// Return the next record's header and a pointer to its payload. The pointers stay valid until the
+// reader is closed.
+BGMIOTraceReaderStatus  BGMIOTraceReaderNext(BGMIOTraceReader* inReader,
+                                             const BGMIOTraceRecordHeader** outHeader,
+                                             const void** outPayload);
+// Go back to the first record.
+void                    BGMIOTraceReaderRewind(BGMIOTraceReader* inReader);
+
+// 64-bit FNV-1a, for comparing the audio from two runs. Start with kBGMIOTraceHashInitialValue and
+// pass the previous result back in to hash more data.
+#define kBGMIOTraceHashInitialValue     0xCBF29CE484222325ull
+uint64_t                BGMIOTraceHash(uint64_t inHash, const void* inData, size_t inSize);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* SharedSource__BGMIOTraceReader */
+
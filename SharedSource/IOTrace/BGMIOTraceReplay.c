@@ -0,0 +1,364 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMIOTraceReplay.c
+//  SharedSource
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Replays the timeline of an IO trace recorded by BGMDriver, either as fast as possible or at
+//  the speed it was recorded, and reports what the HAL asked the driver to do: the records, a hash
+//  of the audio passed to each IO operation and the timing of the IO cycles. See README.md in this
+//  directory for build instructions.
+//
+//  This only needs the C standard library and POSIX clocks, so it runs on Linux. It doesn't run the driver's audio
+//  processing, which needs CoreAudio. BGM_IOTraceTests in BGMDriverTests replays traces through
+//  BGM_Device and hashes its output.
+//
+//  Usage: BGMIOTraceReplay [-r] [-v] trace
+//      -r  Replay in real time, i.e. wait until each record's time before handling it, and report
+//          how late the records were handled.
+//      -v  Print each record.
+//
+
+// For clock_gettime and nanosleep, which strict C11 doesn't declare on Linux. This has to come
+// before any includes.
+#define _POSIX_C_SOURCE 199309L
+
+// Local Includes
+#include "BGMIOTraceReader.h"
+
+// System Includes
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+#define kNumOperations      4
+
+typedef struct BGMOperationStats
+{
+    const char*         mName;
+    uint32_t            mOperationID;
+    uint64_t            mCount;
+    uint64_t            mFrames;
+    // The hash of the audio passed to the operation, in order.
+    uint64_t            mHash;
+} BGMOperationStats;
+
+typedef struct BGMIntervalStats
+{
+    uint64_t            mCount;
+    uint64_t            mTotalNanos;
+    uint64_t            mMinNanos;
+    uint64_t            mMaxNanos;
+} BGMIntervalStats;
+
+static void     BGMIntervalStatsAdd(BGMIntervalStats* ioStats, uint64_t inNanos)
+{
+    if(ioStats->mCount == 0 || inNanos < ioStats->mMinNanos)
+    {
+        ioStats->mMinNanos = inNanos;
+    }
+
+    if(inNanos > ioStats->mMaxNanos)
+    {
+        ioStats->mMaxNanos = inNanos;
+    }
+
+    ioStats->mCount++;
+    ioStats->mTotalNanos += inNanos;
+}
+
+static void     BGMIntervalStatsPrint(const char* inName, const BGMIntervalStats* inStats)
+{
+    if(inStats->mCount == 0)
+    {
+        printf("%s: none\n", inName);
+        return;
+    }
+
+    printf("%s: %llu, min %.3f ms, mean %.3f ms, max %.3f ms\n",
+           inName,
+           (unsigned long long)inStats->mCount,
+           (double)inStats->mMinNanos / 1e6,
+           (double)inStats->mTotalNanos / (double)inStats->mCount / 1e6,
+           (double)inStats->mMaxNanos / 1e6);
+}
+
+static uint64_t BGMNowNanos(void)
+{
+    struct timespec theTime;
+    clock_gettime(CLOCK_MONOTONIC, &theTime);
+    return ((uint64_t)theTime.tv_sec * 1000000000ull) + (uint64_t)theTime.tv_nsec;
+}
+
+static void     BGMSleepUntil(uint64_t inNanos)
+{
+    uint64_t theNow = BGMNowNanos();
+
+    while(theNow < inNanos)
+    {
+        uint64_t theRemaining = inNanos - theNow;
+        struct timespec theInterval = { (time_t)(theRemaining / 1000000000ull),
+                                        (long)(theRemaining % 1000000000ull) };
+        nanosleep(&theInterval, NULL);
+        theNow = BGMNowNanos();
+    }
+}
+
+static const char*  BGMRecordTypeName(uint32_t inType)
+{
+    switch(inType)
+    {
+        case kBGMIOTraceRecord_AddClient:       return "AddClient";
+        case kBGMIOTraceRecord_RemoveClient:    return "RemoveClient";
+        case kBGMIOTraceRecord_StartIO:         return "StartIO";
+        case kBGMIOTraceRecord_StopIO:          return "StopIO";
+        case kBGMIOTraceRecord_IOOperation:     return "IOOperation";
+        case kBGMIOTraceRecord_SetProperty:     return "SetProperty";
+        case kBGMIOTraceRecord_ConfigChange:    return "ConfigChange";
+    }
+
+    return "Unknown";
+}
+
+// Writes a four char code, e.g. a property selector, to outString, which must have room for five
+// chars.
+static const char*  BGMFourCC(uint32_t inCode, char outString[5])
+{
+    for(int i = 0; i < 4; i++)
+    {
+        char theChar = (char)((inCode >> (24 - (8 * i))) & 0xFF);
+        outString[i] = (theChar >= 0x20 && theChar < 0x7F) ? theChar : '?';
+    }
+
+    outString[4] = '\0';
+
+    return outString;
+}
+
+static void     BGMPrintRecord(const BGMIOTraceRecordHeader* inHeader, const void* inPayload)
+{
+    char theFourCC[5];
+
+    printf("%12.6f %-12s", (double)inHeader->mNanos / 1e9, BGMRecordTypeName(inHeader->mType));
+
+    switch(inHeader->mType)
+    {
+        case kBGMIOTraceRecord_AddClient:
+        case kBGMIOTraceRecord_RemoveClient:
+            {
+                const BGMIOTraceClientPayload* theClient = inPayload;
+                printf(" client %u pid %d bundle ID \"%.*s\"",
+                       theClient->mClientID,
+                       theClient->mProcessID,
+                       (int)theClient->mBundleIDLength,
+                       (const char*)(theClient + 1));
+            }
+            break;
+
+        case kBGMIOTraceRecord_StartIO:
+        case kBGMIOTraceRecord_StopIO:
+            printf(" client %u", ((const BGMIOTraceClientIOPayload*)inPayload)->mClientID);
+            break;
+
+        case kBGMIOTraceRecord_IOOperation:
+            {
+                const BGMIOTraceIOOperationPayload* theOperation = inPayload;
+                printf(" '%s' client %u frames %u input time %.0f output time %.0f buffer %u bytes",
+                       BGMFourCC(theOperation->mOperationID, theFourCC),
+                       theOperation->mClientID,
+                       theOperation->mIOBufferFrameSize,
+                       theOperation->mInputSampleTime,
+                       theOperation->mOutputSampleTime,
+                       theOperation->mBufferSize);
+            }
+            break;
+
+        case kBGMIOTraceRecord_SetProperty:
+            {
+                const BGMIOTraceSetPropertyPayload* theProperty = inPayload;
+                printf(" object %u '%s' pid %d %s %u bytes",
+                       theProperty->mObjectID,
+                       BGMFourCC(theProperty->mSelector, theFourCC),
+                       theProperty->mClientProcessID,
+                       theProperty->mIsPropertyList ? "plist" : "raw",
+                       theProperty->mDataSize);
+            }
+            break;
+
+        case kBGMIOTraceRecord_ConfigChange:
+            printf(" action %llu",
+                   (unsigned long long)((const BGMIOTraceConfigChangePayload*)inPayload)->mChangeAction);
+            break;
+    }
+
+    printf("\n");
+}
+
+int main(int argc, const char* argv[])
+{
+    int theRealTime = 0;
+    int theVerbose = 0;
+    const char* thePath = NULL;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-r") == 0)
+        {
+            theRealTime = 1;
+        }
+        else if(strcmp(argv[i], "-v") == 0)
+        {
+            theVerbose = 1;
+        }
+        else
+        {
+            thePath = argv[i];
+        }
+    }
+
+    if(thePath == NULL)
+    {
+        fprintf(stderr, "Usage: %s [-r] [-v] trace\n", argv[0]);
+        return 2;
+    }
+
+    BGMIOTraceReader* theReader = BGMIOTraceReaderOpen(thePath);
+
+    if(theReader == NULL)
+    {
+        fprintf(stderr, "Couldn't read %s: %s\n", thePath, strerror(errno));
+        return 1;
+    }
+
+    const BGMIOTraceFileHeader* theFileHeader = BGMIOTraceReaderGetFileHeader(theReader);
+
+    printf("%s: %.0f Hz, %u channels, %s\n",
+           thePath,
+           theFileHeader->mSampleRate,
+           theFileHeader->mChannelsPerFrame,
+           (theFileHeader->mFlags & kBGMIOTraceFlag_IncludesBuffers) ? "with audio" : "without audio");
+
+    BGMOperationStats theOperations[kNumOperations] = {
+        { "ReadInput",      kBGMIOTraceOperation_ReadInput,     0, 0, kBGMIOTraceHashInitialValue },
+        { "ProcessOutput",  kBGMIOTraceOperation_ProcessOutput, 0, 0, kBGMIOTraceHashInitialValue },
+        { "ProcessMix",     kBGMIOTraceOperation_ProcessMix,    0, 0, kBGMIOTraceHashInitialValue },
+        { "WriteMix",       kBGMIOTraceOperation_WriteMix,      0, 0, kBGMIOTraceHashInitialValue }
+    };
+
+    uint64_t theRecordCount = 0;
+    uint64_t theOtherRecordCount = 0;
+    uint64_t theLastNanos = 0;
+    // WriteMix happens once per IO cycle, so the time between them is the IO cycle's period.
+    uint64_t theLastWriteMixNanos = 0;
+    int theHaveWriteMix = 0;
+    BGMIntervalStats theCycleIntervals = { 0 };
+    BGMIntervalStats theLateness = { 0 };
+
+    const uint64_t theReplayStart = BGMNowNanos();
+    const BGMIOTraceRecordHeader* theHeader;
+    const void* thePayload;
+    BGMIOTraceReaderStatus theStatus;
+
+    while((theStatus = BGMIOTraceReaderNext(theReader, &theHeader, &thePayload)) == kBGMIOTraceReader_OK)
+    {
+        if(theRealTime)
+        {
+            BGMSleepUntil(theReplayStart + theHeader->mNanos);
+            BGMIntervalStatsAdd(&theLateness, BGMNowNanos() - (theReplayStart + theHeader->mNanos));
+        }
+
+        if(theVerbose)
+        {
+            BGMPrintRecord(theHeader, thePayload);
+        }
+
+        theRecordCount++;
+        theLastNanos = theHeader->mNanos;
+
+        if(theHeader->mType != kBGMIOTraceRecord_IOOperation)
+        {
+            theOtherRecordCount++;
+            continue;
+        }
+
+        const BGMIOTraceIOOperationPayload* theOperation = thePayload;
+
+        for(int i = 0; i < kNumOperations; i++)
+        {
+            if(theOperations[i].mOperationID == theOperation->mOperationID)
+            {
+                theOperations[i].mCount++;
+                theOperations[i].mFrames += theOperation->mIOBufferFrameSize;
+                theOperations[i].mHash = BGMIOTraceHash(theOperations[i].mHash,
+                                                        theOperation + 1,
+                                                        theOperation->mBufferSize);
+            }
+        }
+
+        if(theOperation->mOperationID == kBGMIOTraceOperation_WriteMix)
+        {
+            if(theHaveWriteMix)
+            {
+                BGMIntervalStatsAdd(&theCycleIntervals, theHeader->mNanos - theLastWriteMixNanos);
+            }
+
+            theLastWriteMixNanos = theHeader->mNanos;
+            theHaveWriteMix = 1;
+        }
+    }
+
+    printf("%llu records over %.3f s, %llu not IO operations\n",
+           (unsigned long long)theRecordCount,
+           (double)theLastNanos / 1e9,
+           (unsigned long long)theOtherRecordCount);
+
+    for(int i = 0; i < kNumOperations; i++)
+    {
+        printf("%-14s %8llu operations %10llu frames  audio hash %016llx\n",
+               theOperations[i].mName,
+               (unsigned long long)theOperations[i].mCount,
+               (unsigned long long)theOperations[i].mFrames,
+               (unsigned long long)theOperations[i].mHash);
+    }
+
+    BGMIntervalStatsPrint("IO cycle intervals", &theCycleIntervals);
+
+    if(theRealTime)
+    {
+        BGMIntervalStatsPrint("Replay lateness", &theLateness);
+    }
+    else
+    {
+        printf("Replayed in %.3f ms\n", (double)(BGMNowNanos() - theReplayStart) / 1e6);
+    }
+
+    BGMIOTraceReaderClose(theReader);
+
+    if(theStatus != kBGMIOTraceReader_End)
+    {
+        fprintf(stderr, "Stopped early: the trace is %s\n",
+                theStatus == kBGMIOTraceReader_Truncated ? "truncated" : "corrupt");
+        return 1;
+    }
+
+    return 0;
+}
+
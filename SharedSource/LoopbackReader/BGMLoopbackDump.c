@@ -0,0 +1,160 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMLoopbackDump.c
+//  SharedSource
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  A demo consumer for BGMLoopbackReader. Reads a loopback segment and writes the audio to stdout
+//  as raw interleaved 32-bit float samples, reporting the format and any dropped frames on stderr.
+//  See README.md in this directory for build instructions.
+//
+//  Usage: BGMLoopbackDump [segment name] [seconds]
+//
+//  For example, to record ten seconds of BGMDevice's output:
+//      ./BGMLoopbackDump /BGMDevice.loopback 10 > out.raw
+//
+
+// For nanosleep, which strict C11 doesn't declare on Linux. This has to come before any includes.
+#define _POSIX_C_SOURCE 199309L
+
+// Local Includes
+#include "BGMLoopbackReader.h"
+
+// System Includes
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+// How long to sleep when there's no new audio.
+#define kPollIntervalNs     (5 * 1000 * 1000)
+#define kMaxFramesPerRead   4096
+
+static const char*  StatusName(BGMLoopbackReaderStatus inStatus)
+{
+    switch(inStatus)
+    {
+        case kBGMLoopbackReader_OK:             return "ok";
+        case kBGMLoopbackReader_NoData:         return "no data";
+        case kBGMLoopbackReader_Overrun:        return "overrun";
+        case kBGMLoopbackReader_Reset:          return "reset";
+        case kBGMLoopbackReader_SegmentClosed:  return "segment closed";
+        case kBGMLoopbackReader_BadArgument:    return "bad argument";
+    }
+
+    return "unknown";
+}
+
+int main(int argc, const char* argv[])
+{
+    const char* theSegmentName = argc > 1 ? argv[1] : kBGMLoopbackSegmentName;
+    double theSeconds = argc > 2 ? atof(argv[2]) : 0.0;
+
+    BGMLoopbackReader* theReader = BGMLoopbackReaderOpen(theSegmentName);
+
+    if(theReader == NULL)
+    {
+        fprintf(stderr, "Couldn't open %s: %s\n", theSegmentName, strerror(errno));
+        return 1;
+    }
+
+    const uint32_t theChannels = BGMLoopbackReaderGetChannelsPerFrame(theReader);
+    const double theSampleRate = BGMLoopbackReaderGetSampleRate(theReader);
+
+    fprintf(stderr,
+            "Reading %s: %u channels, %.0f Hz, %u frame ring. Output is f32le.\n",
+            theSegmentName,
+            theChannels,
+            theSampleRate,
+            BGMLoopbackReaderGetCapacityFrames(theReader));
+
+    float* theBuffer = malloc(sizeof(float) * theChannels * kMaxFramesPerRead);
+
+    if(theBuffer == NULL)
+    {
+        BGMLoopbackReaderClose(theReader);
+        return 1;
+    }
+
+    const uint64_t theFramesToRead = (uint64_t)(theSeconds * theSampleRate);
+    uint64_t theFramesRead = 0;
+    uint64_t theDiscontinuities = 0;
+    int theExitStatus = 0;
+
+    while(theFramesToRead == 0 || theFramesRead < theFramesToRead)
+    {
+        uint32_t theFrameCount = 0;
+        int64_t theSampleTime = 0;
+
+        BGMLoopbackReaderStatus theStatus = BGMLoopbackReaderRead(theReader,
+                                                                  theBuffer,
+                                                                  kMaxFramesPerRead,
+                                                                  &theFrameCount,
+                                                                  &theSampleTime);
+
+        if(theStatus == kBGMLoopbackReader_SegmentClosed ||
+           theStatus == kBGMLoopbackReader_BadArgument)
+        {
+            fprintf(stderr, "Stopping: %s\n", StatusName(theStatus));
+            theExitStatus = 1;
+            break;
+        }
+
+        if(theStatus == kBGMLoopbackReader_Overrun || theStatus == kBGMLoopbackReader_Reset)
+        {
+            theDiscontinuities++;
+            fprintf(stderr, "Discontinuity (%s) at sample time %lld\n",
+                    StatusName(theStatus),
+                    (long long)theSampleTime);
+        }
+
+        if(theFrameCount == 0)
+        {
+            struct timespec theInterval = { 0, kPollIntervalNs };
+            nanosleep(&theInterval, NULL);
+            continue;
+        }
+
+        if(theFramesToRead != 0 && theFramesRead + theFrameCount > theFramesToRead)
+        {
+            theFrameCount = (uint32_t)(theFramesToRead - theFramesRead);
+        }
+
+        if(fwrite(theBuffer, sizeof(float) * theChannels, theFrameCount, stdout) != theFrameCount)
+        {
+            fprintf(stderr, "Couldn't write to stdout: %s\n", strerror(errno));
+            theExitStatus = 1;
+            break;
+        }
+
+        theFramesRead += theFrameCount;
+    }
+
+    fprintf(stderr,
+            "Read %llu frames with %llu discontinuities.\n",
+            (unsigned long long)theFramesRead,
+            (unsigned long long)theDiscontinuities);
+
+    free(theBuffer);
+    BGMLoopbackReaderClose(theReader);
+
+    return theExitStatus;
+}
+
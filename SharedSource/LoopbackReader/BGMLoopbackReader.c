@@ -0,0 +1,373 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMLoopbackReader.c
+//  SharedSource
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMLoopbackReader.h"
+
+// System Includes
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define BGMLoadAcquire(field)   __atomic_load_n(&(field), __ATOMIC_ACQUIRE)
+#define BGMLoadRelaxed(field)   __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+// The number of times BGMLoopbackReaderRead retries if the frames it copied were overwritten.
+#define kMaxReadAttempts        4
+
+struct BGMLoopbackReader
+{
+    const BGMLoopbackSegmentHeader*     mHeader;
+    const float*                        mData;
+    size_t                              mMappedSize;
+    uint32_t                            mCapacityFrames;
+    uint32_t                            mChannelsPerFrame;
+
+    // The sample time of the next frame to return.
+    int64_t                             mPosition;
+    // The value of mResetCount the last time we read the header.
+    uint64_t                            mResetCount;
+    // The frames returned by the last call to BGMLoopbackReaderPeek.
+    uint32_t                            mPeekedFrameCount;
+    uint64_t                            mPeekedResetCount;
+};
+
+static int64_t  BGMMax64(int64_t inA, int64_t inB)
+{
+    return inA > inB ? inA : inB;
+}
+
+BGMLoopbackReader*  BGMLoopbackReaderOpen(const char* inSegmentName)
+{
+    if(inSegmentName == NULL)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    int theFD = shm_open(inSegmentName, O_RDONLY, 0);
+
+    if(theFD < 0)
+    {
+        return NULL;
+    }
+
+    struct stat theStat;
+    void* theMapping = MAP_FAILED;
+
+    if(fstat(theFD, &theStat) != 0)
+    {
+        // fstat set errno.
+    }
+    else if(theStat.st_size < (off_t)kBGMLoopbackSegmentDataOffset)
+    {
+        errno = EPROTO;
+    }
+    else
+    {
+        theMapping = mmap(NULL, (size_t)theStat.st_size, PROT_READ, MAP_SHARED, theFD, 0);
+    }
+
+    int theErrno = errno;
+    close(theFD);
+
+    if(theMapping == MAP_FAILED)
+    {
+        errno = theErrno;
+        return NULL;
+    }
+
+    const BGMLoopbackSegmentHeader* theHeader = (const BGMLoopbackSegmentHeader*)theMapping;
+    const size_t theSize = (size_t)theStat.st_size;
+
+    // The driver writes the magic number last, so check it first.
+    int theLayoutIsValid =
+            BGMLoadAcquire(theHeader->mMagic) == kBGMLoopbackSegmentMagic &&
+            theHeader->mVersion == kBGMLoopbackSegmentVersion &&
+            theHeader->mHeaderSize >= sizeof(BGMLoopbackSegmentHeader) &&
+            theHeader->mChannelsPerFrame > 0 &&
+            theHeader->mBytesPerFrame == theHeader->mChannelsPerFrame * sizeof(float) &&
+            theHeader->mCapacityFrames > 0 &&
+            (theHeader->mCapacityFrames & (theHeader->mCapacityFrames - 1)) == 0 &&
+            theHeader->mDataOffset >= theHeader->mHeaderSize &&
+            theHeader->mDataOffset +
+                    ((size_t)theHeader->mCapacityFrames * theHeader->mBytesPerFrame) <= theSize;
+
+    BGMLoopbackReader* theReader = theLayoutIsValid ? calloc(1, sizeof(BGMLoopbackReader)) : NULL;
+
+    if(theReader == NULL)
+    {
+        munmap(theMapping, theSize);
+        errno = theLayoutIsValid ? ENOMEM : EPROTO;
+        return NULL;
+    }
+
+    theReader->mHeader = theHeader;
+    theReader->mData = (const float*)((const char*)theMapping + theHeader->mDataOffset);
+    theReader->mMappedSize = theSize;
+    theReader->mCapacityFrames = theHeader->mCapacityFrames;
+    theReader->mChannelsPerFrame = theHeader->mChannelsPerFrame;
+
+    BGMLoopbackReaderSeekToLatest(theReader, 0);
+
+    return theReader;
+}
+
+void    BGMLoopbackReaderClose(BGMLoopbackReader* inReader)
+{
+    if(inReader != NULL)
+    {
+        munmap((void*)inReader->mHeader, inReader->mMappedSize);
+        free(inReader);
+    }
+}
+
+uint32_t    BGMLoopbackReaderGetChannelsPerFrame(const BGMLoopbackReader* inReader)
+{
+    return inReader->mChannelsPerFrame;
+}
+
+uint32_t    BGMLoopbackReaderGetCapacityFrames(const BGMLoopbackReader* inReader)
+{
+    return inReader->mCapacityFrames;
+}
+
+double  BGMLoopbackReaderGetSampleRate(const BGMLoopbackReader* inReader)
+{
+    // The sample rate is guarded by a sequence lock. Retry until we read it while it wasn't being
+    // changed. The driver only changes it when IO is stopped, so this won't spin for long.
+    for(;;)
+    {
+        uint64_t theSequence = BGMLoadAcquire(inReader->mHeader->mFormatSequence);
+
+        if((theSequence & 1) == 0)
+        {
+            double theSampleRate = inReader->mHeader->mSampleRate;
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+            if(BGMLoadRelaxed(inReader->mHeader->mFormatSequence) == theSequence)
+            {
+                return theSampleRate;
+            }
+        }
+    }
+}
+
+int64_t     BGMLoopbackReaderGetPosition(const BGMLoopbackReader* inReader)
+{
+    return inReader->mPosition;
+}
+
+int64_t     BGMLoopbackReaderGetWriteEnd(const BGMLoopbackReader* inReader)
+{
+    return BGMLoadAcquire(inReader->mHeader->mWriteEndSampleTime);
+}
+
+void    BGMLoopbackReaderSeekToLatest(BGMLoopbackReader* inReader, uint32_t inFramesBehind)
+{
+    if(inFramesBehind > inReader->mCapacityFrames)
+    {
+        inFramesBehind = inReader->mCapacityFrames;
+    }
+
+    inReader->mResetCount = BGMLoadAcquire(inReader->mHeader->mResetCount);
+    int64_t theEnd = BGMLoadAcquire(inReader->mHeader->mWriteEndSampleTime);
+    int64_t theValidStart = BGMLoadRelaxed(inReader->mHeader->mValidStartSampleTime);
+
+    inReader->mPosition = BGMMax64(theValidStart, theEnd - (int64_t)inFramesBehind);
+    inReader->mPeekedFrameCount = 0;
+}
+
+BGMLoopbackReaderStatus BGMLoopbackReaderPeek(BGMLoopbackReader* inReader,
+                                              uint32_t inMaxFrames,
+                                              BGMLoopbackRegion outRegions[2],
+                                              uint32_t* outFrameCount,
+                                              int64_t* outSampleTime)
+{
+    if(inReader == NULL || outRegions == NULL || outFrameCount == NULL)
+    {
+        return kBGMLoopbackReader_BadArgument;
+    }
+
+    const BGMLoopbackSegmentHeader* theHeader = inReader->mHeader;
+
+    *outFrameCount = 0;
+    outRegions[0].mData = outRegions[1].mData = NULL;
+    outRegions[0].mFrameCount = outRegions[1].mFrameCount = 0;
+    inReader->mPeekedFrameCount = 0;
+
+    if(BGMLoadAcquire(theHeader->mMagic) != kBGMLoopbackSegmentMagic)
+    {
+        return kBGMLoopbackReader_SegmentClosed;
+    }
+
+    uint64_t theResetCount = BGMLoadAcquire(theHeader->mResetCount);
+
+    if((theResetCount & 1) != 0)
+    {
+        // The driver is in the middle of resetting its sample times.
+        return kBGMLoopbackReader_NoData;
+    }
+
+    int64_t theEnd = BGMLoadAcquire(theHeader->mWriteEndSampleTime);
+    int64_t theValidStart = BGMLoadRelaxed(theHeader->mValidStartSampleTime);
+    int64_t theOldestFrame = BGMMax64(theValidStart, theEnd - (int64_t)inReader->mCapacityFrames);
+
+    BGMLoopbackReaderStatus theStatus = kBGMLoopbackReader_OK;
+
+    if(theResetCount != inReader->mResetCount || inReader->mPosition > theEnd)
+    {
+        inReader->mResetCount = theResetCount;
+        inReader->mPosition = theOldestFrame;
+        theStatus = kBGMLoopbackReader_Reset;
+    }
+    else if(inReader->mPosition < theOldestFrame)
+    {
+        inReader->mPosition = theOldestFrame;
+        theStatus = kBGMLoopbackReader_Overrun;
+    }
+
+    int64_t theAvailableFrames = theEnd - inReader->mPosition;
+    uint32_t theFrameCount =
+            theAvailableFrames < (int64_t)inMaxFrames ? (uint32_t)theAvailableFrames : inMaxFrames;
+
+    if(theFrameCount == 0)
+    {
+        return theStatus == kBGMLoopbackReader_OK ? kBGMLoopbackReader_NoData : theStatus;
+    }
+
+    uint32_t theOffset = (uint32_t)(inReader->mPosition & (int64_t)(inReader->mCapacityFrames - 1));
+    uint32_t theFirstPartFrames = inReader->mCapacityFrames - theOffset;
+
+    if(theFirstPartFrames > theFrameCount)
+    {
+        theFirstPartFrames = theFrameCount;
+    }
+
+    outRegions[0].mData = inReader->mData + ((size_t)theOffset * inReader->mChannelsPerFrame);
+    outRegions[0].mFrameCount = theFirstPartFrames;
+
+    if(theFrameCount > theFirstPartFrames)
+    {
+        outRegions[1].mData = inReader->mData;
+        outRegions[1].mFrameCount = theFrameCount - theFirstPartFrames;
+    }
+
+    *outFrameCount = theFrameCount;
+
+    if(outSampleTime != NULL)
+    {
+        *outSampleTime = inReader->mPosition;
+    }
+
+    inReader->mPeekedFrameCount = theFrameCount;
+    inReader->mPeekedResetCount = theResetCount;
+
+    return theStatus;
+}
+
+BGMLoopbackReaderStatus BGMLoopbackReaderCommit(BGMLoopbackReader* inReader)
+{
+    if(inReader == NULL)
+    {
+        return kBGMLoopbackReader_BadArgument;
+    }
+
+    // Make sure our reads of the audio data happen before we check whether it was overwritten.
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    int64_t theInProgressEnd = BGMLoadRelaxed(inReader->mHeader->mWriteInProgressEndSampleTime);
+    uint64_t theResetCount = BGMLoadRelaxed(inReader->mHeader->mResetCount);
+
+    int theFramesWereIntact =
+            theResetCount == inReader->mPeekedResetCount &&
+            inReader->mPosition >= theInProgressEnd - (int64_t)inReader->mCapacityFrames;
+
+    inReader->mPosition += inReader->mPeekedFrameCount;
+    inReader->mPeekedFrameCount = 0;
+
+    return theFramesWereIntact ? kBGMLoopbackReader_OK : kBGMLoopbackReader_Overrun;
+}
+
+BGMLoopbackReaderStatus BGMLoopbackReaderRead(BGMLoopbackReader* inReader,
+                                              float* outBuffer,
+                                              uint32_t inMaxFrames,
+                                              uint32_t* outFrameCount,
+                                              int64_t* outSampleTime)
+{
+    if(inReader == NULL || outBuffer == NULL || outFrameCount == NULL)
+    {
+        return kBGMLoopbackReader_BadArgument;
+    }
+
+    const size_t theBytesPerFrame = inReader->mChannelsPerFrame * sizeof(float);
+    BGMLoopbackReaderStatus theStatus = kBGMLoopbackReader_OK;
+
+    *outFrameCount = 0;
+
+    for(int theAttempt = 0; theAttempt < kMaxReadAttempts; theAttempt++)
+    {
+        BGMLoopbackRegion theRegions[2];
+        uint32_t theFrameCount;
+
+        BGMLoopbackReaderStatus thePeekStatus =
+                BGMLoopbackReaderPeek(inReader, inMaxFrames, theRegions, &theFrameCount, outSampleTime);
+
+        if(theFrameCount == 0)
+        {
+            // Report the first discontinuity if there was one, even though there's no audio.
+            return theStatus == kBGMLoopbackReader_OK ? thePeekStatus : theStatus;
+        }
+
+        if(thePeekStatus != kBGMLoopbackReader_OK && theStatus == kBGMLoopbackReader_OK)
+        {
+            theStatus = thePeekStatus;
+        }
+
+        memcpy(outBuffer, theRegions[0].mData, theRegions[0].mFrameCount * theBytesPerFrame);
+
+        if(theRegions[1].mFrameCount > 0)
+        {
+            memcpy((char*)outBuffer + (theRegions[0].mFrameCount * theBytesPerFrame),
+                   theRegions[1].mData,
+                   theRegions[1].mFrameCount * theBytesPerFrame);
+        }
+
+        if(BGMLoopbackReaderCommit(inReader) == kBGMLoopbackReader_OK)
+        {
+            *outFrameCount = theFrameCount;
+            return theStatus;
+        }
+
+        // The driver overwrote some of the frames while we were copying them, so we've lost them.
+        // Try again from the oldest frame that's still available.
+        theStatus = kBGMLoopbackReader_Overrun;
+    }
+
+    return theStatus;
+}
+
@@ -0,0 +1,114 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMLoopbackReader.h
+//  SharedSource
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  A small C library for reading the loopback audio BGMDriver mirrors into shared memory. It
+//  only depends on POSIX, so it also builds on Linux, e.g. for consumers that read a segment
+//  written by something other than BGMDriver. See BGM_LoopbackLayout.h for the segment layout.
+//
+//  Readers never block the driver. If a reader falls too far behind, the frames it missed are
+//  lost and the next read returns kBGMLoopbackReader_Overrun.
+//
+//  A BGMLoopbackReader isn't thread safe, but any number of readers can read the same segment.
+//
+
+#ifndef SharedSource__BGMLoopbackReader
+#define SharedSource__BGMLoopbackReader
+
+// Local Includes
+#include "BGM_LoopbackLayout.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef enum BGMLoopbackReaderStatus
+{
+    // The frames returned are contiguous with the frames returned by the previous read.
+    kBGMLoopbackReader_OK               = 0,
+    // No new frames have been written since the previous read.
+    kBGMLoopbackReader_NoData           = 1,
+    // The reader fell behind and some frames were overwritten before it could read them. Any
+    // frames returned start at the oldest frame still available.
+    kBGMLoopbackReader_Overrun          = 2,
+    // The driver restarted its sample times, usually because IO stopped and started again. Any
+    // frames returned start at the beginning of the new sample times.
+    kBGMLoopbackReader_Reset            = 3,
+    // The driver closed the segment. Close the reader and open a new one.
+    kBGMLoopbackReader_SegmentClosed    = 4,
+    kBGMLoopbackReader_BadArgument      = 5
+} BGMLoopbackReaderStatus;
+
+typedef struct BGMLoopbackReader BGMLoopbackReader;
+
+// A run of frames in the shared ring, for reading without copying.
+typedef struct BGMLoopbackRegion
+{
+    const float*        mData;
+    uint32_t            mFrameCount;
+} BGMLoopbackRegion;
+
+// Map the named segment (e.g. kBGMLoopbackSegmentName) read-only. The reader starts at the most
+// recently written frame. Returns NULL and sets errno on failure. errno is set to EPROTO if the
+// segment exists but has an unsupported layout.
+BGMLoopbackReader*      BGMLoopbackReaderOpen(const char* inSegmentName);
+void                    BGMLoopbackReaderClose(BGMLoopbackReader* inReader);
+
+uint32_t                BGMLoopbackReaderGetChannelsPerFrame(const BGMLoopbackReader* inReader);
+uint32_t                BGMLoopbackReaderGetCapacityFrames(const BGMLoopbackReader* inReader);
+double                  BGMLoopbackReaderGetSampleRate(const BGMLoopbackReader* inReader);
+
+// The sample time of the next frame the reader will return.
+int64_t                 BGMLoopbackReaderGetPosition(const BGMLoopbackReader* inReader);
+// The end (exclusive) of the frames the driver has finished writing.
+int64_t                 BGMLoopbackReaderGetWriteEnd(const BGMLoopbackReader* inReader);
+// Move the reader to inFramesBehind frames before the most recently written frame. Use 0 to skip
+// everything that has already been written.
+void                    BGMLoopbackReaderSeekToLatest(BGMLoopbackReader* inReader,
+                                                      uint32_t inFramesBehind);
+
+// Zero-copy reads: BGMLoopbackReaderPeek returns pointers directly into the shared ring for up to
+// inMaxFrames frames (in up to two regions, because the ring wraps) and their sample time. Read
+// the audio in place and then call BGMLoopbackReaderCommit, which returns
+// kBGMLoopbackReader_Overrun if the driver overwrote any of the frames while you were reading them,
+// in which case you should discard whatever you read. Either way, the reader moves past them.
+//
+// Peek returns kBGMLoopbackReader_OK, _Overrun or _Reset if it returned any frames.
+BGMLoopbackReaderStatus BGMLoopbackReaderPeek(BGMLoopbackReader* inReader,
+                                              uint32_t inMaxFrames,
+                                              BGMLoopbackRegion outRegions[2],
+                                              uint32_t* outFrameCount,
+                                              int64_t* outSampleTime);
+BGMLoopbackReaderStatus BGMLoopbackReaderCommit(BGMLoopbackReader* inReader);
+
+// Copy up to inMaxFrames interleaved frames into outBuffer. Retries (skipping ahead) if the driver
+// overwrites the frames during the copy, so the frames returned are never torn.
+BGMLoopbackReaderStatus BGMLoopbackReaderRead(BGMLoopbackReader* inReader,
+                                              float* outBuffer,
+                                              uint32_t inMaxFrames,
+                                              uint32_t* outFrameCount,
+                                              int64_t* outSampleTime);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* SharedSource__BGMLoopbackReader */
+